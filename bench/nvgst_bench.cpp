@@ -0,0 +1,1468 @@
+// nvgst-bench: runs synthetic `videotestsrc ! <element> ! fakesink` pipelines
+// for every element in the plugin and reports throughput, per-frame latency
+// percentiles, CPU time and peak RSS as stable text and JSON.
+//
+// Each case runs in a forked child so that CPU time and peak RSS (taken from
+// wait4()) belong to that case alone. The parent never initializes
+// GStreamer.
+//
+// Latency is the time from a PTS first entering the element under test
+// (named "dut") to that PTS first leaving it, so batching elements report
+// the latency of the earliest frame of each batch.
+
+#include <gst/gst.h>
+
+#include <glob.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/draw_list.h"
+#include "core/msg_broker.h"
+#include "core/objects.h"
+#include "core/reid.h"
+#include "core/tensor.h"
+#include "gstnvdrawmeta.h"
+#include "gstnvobjectmeta.h"
+#include "gstnvroimeta.h"
+#include "gstnvtensormeta.h"
+
+namespace {
+
+struct Params {
+  const char* format;
+  int width;
+  int height;
+  int batch;
+  int frames;
+  const char* pattern;
+  // Prefix for files a case writes; they are removed after each case.
+  const char* scratch;
+};
+
+// Builds the launch description for one parameter set; the element under
+// test must be named "dut", or "dut_in" and "dut_out" for a sink/source
+// pair.
+using PipelineBuilder = std::function<std::string(const Params&)>;
+
+// Optional hook run on "dut" (or "dut_in") before the pipeline starts, e.g.
+// to attach metadata upstream of it.
+using PipelineSetup = std::function<bool(GstElement* dut, const Params&)>;
+
+struct ChildResult;
+
+// Measures an nvgstcore piece directly, in place of a pipeline, where the
+// per-buffer cost of a pipeline would hide it. Frames and latencies count
+// the case's own unit of work.
+using CoreRun = std::function<void(const Params&, ChildResult*)>;
+
+struct Resolution {
+  int width;
+  int height;
+};
+
+struct BenchCase {
+  const char* name;
+  std::vector<const char*> formats;
+  std::vector<int> batches;
+  PipelineBuilder build;
+  PipelineSetup setup = nullptr;
+  // Replaces the standard resolutions, e.g. for cases about buffer rate
+  // rather than pixels.
+  std::vector<Resolution> resolutions = {};
+  // GST_TRACERS for the child, e.g. to measure a tracer's overhead.
+  const char* tracers = nullptr;
+  // Pads of "dut" to measure between when buffers take more than one path
+  // through it; all of its pads otherwise.
+  std::vector<const char*> pads = {};
+  // Runs instead of a pipeline; build is not used then.
+  CoreRun run = nullptr;
+};
+
+struct ChildResult {
+  int ok;
+  uint64_t frames;
+  uint64_t wall_ns;
+  double p50_us;
+  double p99_us;
+  double p999_us;
+  char error[256];
+  // Shown next to the status, e.g. a search case's accuracy.
+  char note[64];
+};
+
+struct Result {
+  const char* name;
+  Params params;
+  ChildResult child;
+  double cpu_s;
+  long peak_rss_kb;
+};
+
+constexpr uint64_t kWarmupFrames = 10;
+
+uint64_t now_ns() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+std::string source(const Params& p) {
+  char buf[256];
+  std::snprintf(buf, sizeof(buf),
+                "videotestsrc num-buffers=%d pattern=%s ! "
+                "video/x-raw,format=%s,width=%d,height=%d,framerate=30/1",
+                p.frames, p.pattern, p.format, p.width, p.height);
+  return buf;
+}
+
+// A live source producing rate buffers per second for as long as --frames
+// buffers take at 1000 per second, for thread-boundary cases where the
+// buffer rate matters and the pixels do not.
+std::string paced_source(const Params& p, int rate) {
+  char buf[256];
+  std::snprintf(buf, sizeof(buf),
+                "videotestsrc is-live=true num-buffers=%d pattern=%s ! "
+                "video/x-raw,format=%s,width=%d,height=%d,framerate=%d/1",
+                p.frames * (rate / 1000), p.pattern, p.format, p.width, p.height, rate);
+  return buf;
+}
+
+// N sources feeding dut.sink_0 .. dut.sink_{N-1} (or a named muxer).
+std::string sources(const Params& p, const char* mux) {
+  std::string s;
+  for (int i = 0; i < p.batch; i++)
+    s += " " + source(p) + " ! " + mux + ".sink_" + std::to_string(i);
+  return s;
+}
+
+std::string sinks(const Params& p, const char* demux) {
+  std::string s;
+  for (int i = 0; i < p.batch; i++)
+    s += std::string(" ") + demux + ".src_" + std::to_string(i) + " ! fakesink sync=false async=false";
+  return s;
+}
+
+// compositor laid out like nvtiler's automatic grid, as the baseline for
+// the nvtiler cases.
+std::string compositor_grid(const Params& p, int width, int height) {
+  int columns = 1;
+  while (columns * columns < p.batch)
+    columns++;
+  const int rows = (p.batch + columns - 1) / columns;
+  std::string s = "compositor name=dut";
+  for (int i = 0; i < p.batch; i++) {
+    const int x = i % columns * width / columns;
+    const int y = i / columns * height / rows;
+    const std::string pad = " sink_" + std::to_string(i) + "::";
+    s += pad + "xpos=" + std::to_string(x) + pad + "ypos=" + std::to_string(y) + pad +
+         "width=" + std::to_string((i % columns + 1) * width / columns - x) + pad +
+         "height=" + std::to_string((i / columns + 1) * height / rows - y);
+  }
+  return s + " ! video/x-raw,format=BGRx,width=" + std::to_string(width) +
+         ",height=" + std::to_string(height);
+}
+
+// nvlatency writing every record it matches, for the traced twins of the
+// nvlatency-off cases.
+constexpr const char* kLatencyTracer = "nvlatency(location=/dev/null)";
+
+// Boxes with a track label each, as a detector and tracker upstream of
+// nvosd would attach them.
+constexpr int kOsdBoxes = 500;
+
+struct OsdAnnotator {
+  const GstMetaInfo* info;
+  int width;
+  int height;
+  uint32_t seed;
+};
+
+GstPadProbeReturn annotate_probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+  auto* annotator = static_cast<OsdAnnotator*>(user_data);
+  GstBuffer* buf = gst_buffer_make_writable(GST_PAD_PROBE_INFO_BUFFER(info));
+  GST_PAD_PROBE_INFO_DATA(info) = buf;
+
+  auto* meta = reinterpret_cast<GstNvDrawMeta*>(gst_buffer_add_meta(buf, annotator->info, nullptr));
+  nvgst::DrawList* list = meta->list;
+  list->reserve(2 * kOsdBoxes, kOsdBoxes * 12);
+
+  const int box_w = std::max(annotator->width / 20, 8);
+  const int box_h = std::max(annotator->height / 10, 8);
+  char label[32];
+  for (int i = 0; i < kOsdBoxes; i++) {
+    // xorshift, so boxes move between frames like tracked objects would
+    uint32_t& x = annotator->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    const int bx = static_cast<int>(x % static_cast<uint32_t>(annotator->width - box_w));
+    const int by = static_cast<int>((x >> 16) % static_cast<uint32_t>(annotator->height - box_h));
+    std::snprintf(label, sizeof(label), "person %d", i);
+    list->add_rect(0, bx, by, box_w, box_h, 0x00ff00ff, 2);
+    list->add_text(0, bx, std::max(by - 16, 0), label, 16, 0xffffffff, 0x000000a0);
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+bool attach_osd_annotator(GstElement* dut, const Params& p) {
+  const GstMetaInfo* info = gst_meta_get_info("GstNvDrawMeta");
+  GstPad* sinkpad = gst_element_get_static_pad(dut, "sink");
+  GstPad* peer = sinkpad ? gst_pad_get_peer(sinkpad) : nullptr;
+  if (sinkpad)
+    gst_object_unref(sinkpad);
+  if (info == nullptr || peer == nullptr) {
+    if (peer)
+      gst_object_unref(peer);
+    return false;
+  }
+
+  auto* annotator = new OsdAnnotator{info, p.width, p.height, 2463534242u};
+  gst_pad_add_probe(peer, GST_PAD_PROBE_TYPE_BUFFER, annotate_probe, annotator,
+                    [](gpointer data) { delete static_cast<OsdAnnotator*>(data); });
+  gst_object_unref(peer);
+  return true;
+}
+
+// Detections per frame for nvtracker, walking across the frame on a grid
+// with some jitter, as a detector would report a crowd.
+constexpr int kTrackerObjects = 200;
+
+struct DetectionSource {
+  const GstMetaInfo* info;
+  int width;
+  int height;
+  int frames_per_buffer;
+  int objects;
+  uint64_t buffers;
+  uint32_t seed;
+};
+
+GstPadProbeReturn detect_probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+  auto* source = static_cast<DetectionSource*>(user_data);
+  GstBuffer* buf = gst_buffer_make_writable(GST_PAD_PROBE_INFO_BUFFER(info));
+  GST_PAD_PROBE_INFO_DATA(info) = buf;
+
+  auto* meta = reinterpret_cast<GstNvObjectMeta*>(gst_buffer_add_meta(buf, source->info, nullptr));
+  nvgst::ObjectList* objects = meta->objects;
+  objects->reserve(static_cast<size_t>(source->frames_per_buffer) * source->objects);
+
+  const int columns = 20;
+  const float cell_w = static_cast<float>(source->width) / columns;
+  const float cell_h = static_cast<float>(source->height) / std::max(source->objects / columns, 1);
+  const float step = static_cast<float>(source->buffers++ % 64);
+  for (int f = 0; f < source->frames_per_buffer; f++) {
+    for (int i = 0; i < source->objects; i++) {
+      uint32_t& x = source->seed;
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      const float jitter = static_cast<float>(x % 5) - 2.0f;
+      objects->push_back({static_cast<uint32_t>(f), i % 3, 0.9f,
+                          (i % columns) * cell_w + step * 0.25f + jitter,
+                          (i / columns) * cell_h + step * 0.125f + jitter, cell_w * 0.6f,
+                          cell_h * 0.8f, nvgst::kNoTrack, {}});
+    }
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+// Attaches count detections per frame to the buffers entering element.
+bool attach_detections_to(GstElement* element, const Params& p, int count = kTrackerObjects) {
+  const GstMetaInfo* info = gst_meta_get_info("GstNvObjectMeta");
+  GstPad* sinkpad = gst_element_get_static_pad(element, "sink");
+  GstPad* peer = sinkpad ? gst_pad_get_peer(sinkpad) : nullptr;
+  if (sinkpad)
+    gst_object_unref(sinkpad);
+  if (info == nullptr || peer == nullptr) {
+    if (peer)
+      gst_object_unref(peer);
+    return false;
+  }
+
+  auto* source = new DetectionSource{info, p.width, p.height, p.batch, count, 0, 2463534242u};
+  gst_pad_add_probe(peer, GST_PAD_PROBE_TYPE_BUFFER, detect_probe, source,
+                    [](gpointer data) { delete static_cast<DetectionSource*>(data); });
+  gst_object_unref(peer);
+  return true;
+}
+
+bool attach_detections(GstElement* dut, const Params& p) {
+  return attach_detections_to(dut, p);
+}
+
+// Another element of the pipeline dut is in, or nullptr.
+GstElement* find_element(GstElement* dut, const char* name) {
+  GstObject* parent = gst_object_get_parent(GST_OBJECT(dut));
+  if (parent == nullptr)
+    return nullptr;
+  GstElement* element = GST_IS_BIN(parent) ? gst_bin_get_by_name(GST_BIN(parent), name) : nullptr;
+  gst_object_unref(parent);
+  return element;
+}
+
+// Stands in for a secondary classifier behind nvclassifycache: labels every
+// tracked object the cache did not answer for, so the cache stores it.
+constexpr int32_t kBenchClassifier = 1;
+
+GstPadProbeReturn classify_probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+  auto* object_info = static_cast<const GstMetaInfo*>(user_data);
+  GstBuffer* buf = gst_buffer_make_writable(GST_PAD_PROBE_INFO_BUFFER(info));
+  GST_PAD_PROBE_INFO_DATA(info) = buf;
+
+  auto* meta = reinterpret_cast<GstNvObjectMeta*>(gst_buffer_get_meta(buf, object_info->api));
+  if (meta == nullptr)
+    return GST_PAD_PROBE_OK;
+  for (nvgst::DetectedObject& object : *meta->objects) {
+    if (object.track_id == nvgst::kNoTrack)
+      continue;
+    nvgst::ObjectAttribute* attribute = nvgst::add_attribute(object, kBenchClassifier);
+    if (attribute == nullptr || attribute->cached)
+      continue;
+    attribute->label = static_cast<int32_t>(object.track_id % 10);
+    attribute->confidence = 0.9f;
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+// Detections go in front of the element named "tracker", the stand-in
+// classifier behind the element named "classifier".
+bool attach_classifier(GstElement* dut, const Params& p) {
+  const GstMetaInfo* info = gst_meta_get_info("GstNvObjectMeta");
+  GstElement* tracker = find_element(dut, "tracker");
+  GstElement* classifier = find_element(dut, "classifier");
+  GstPad* srcpad = classifier ? gst_element_get_static_pad(classifier, "src") : nullptr;
+  bool ok = info != nullptr && tracker != nullptr && srcpad != nullptr &&
+            attach_detections_to(tracker, p);
+  if (ok)
+    gst_pad_add_probe(srcpad, GST_PAD_PROBE_TYPE_BUFFER, classify_probe,
+                      const_cast<GstMetaInfo*>(info), nullptr);
+  if (srcpad)
+    gst_object_unref(srcpad);
+  if (classifier)
+    gst_object_unref(classifier);
+  if (tracker)
+    gst_object_unref(tracker);
+  return ok;
+}
+
+// Raw YOLOv8-style output for nvpostprocess: {frames, 4 + 80, 8400}, built
+// once and shared by every buffer, with a few hundred candidates per frame
+// over the confidence threshold.
+constexpr int kDetectorClasses = 80;
+constexpr int kDetectorCandidates = 8400;
+
+struct TensorSource {
+  const GstMetaInfo* info;
+  nvgst::Tensor tensor;
+};
+
+GstPadProbeReturn tensor_probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+  auto* source = static_cast<TensorSource*>(user_data);
+  GstBuffer* buf = gst_buffer_make_writable(GST_PAD_PROBE_INFO_BUFFER(info));
+  GST_PAD_PROBE_INFO_DATA(info) = buf;
+
+  auto* meta = reinterpret_cast<GstNvTensorMeta*>(gst_buffer_add_meta(buf, source->info, nullptr));
+  meta->tensors->push_back(source->tensor);
+  return GST_PAD_PROBE_OK;
+}
+
+bool attach_detector_output(GstElement* dut, const Params& p) {
+  const GstMetaInfo* info = gst_meta_get_info("GstNvTensorMeta");
+  GstPad* sinkpad = gst_element_get_static_pad(dut, "sink");
+  GstPad* peer = sinkpad ? gst_pad_get_peer(sinkpad) : nullptr;
+  if (sinkpad)
+    gst_object_unref(sinkpad);
+  if (info == nullptr || peer == nullptr) {
+    if (peer)
+      gst_object_unref(peer);
+    return false;
+  }
+
+  const size_t n = kDetectorCandidates;
+  const size_t per_frame = (4 + kDetectorClasses) * n;
+  auto* source = new TensorSource{info, {}};
+  source->tensor.info = {"output0", {p.batch, 4 + kDetectorClasses, kDetectorCandidates}};
+  source->tensor.data.reset(new float[per_frame * p.batch], std::default_delete<float[]>());
+  uint32_t x = 2463534242u;
+  for (int f = 0; f < p.batch; f++) {
+    float* d = source->tensor.data.get() + per_frame * f;
+    for (size_t i = 0; i < per_frame; i++) {
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      const float u = static_cast<float>(x >> 8) / 16777216.0f;
+      const size_t row = i / n;
+      if (row < 2)
+        d[i] = u * 640.0f;
+      else if (row < 4)
+        d[i] = 16.0f + u * 96.0f;
+      else
+        d[i] = u > 0.9995f ? u : u * 0.2f;
+    }
+  }
+  gst_pad_add_probe(peer, GST_PAD_PROBE_TYPE_BUFFER, tensor_probe, source,
+                    [](gpointer data) { delete static_cast<TensorSource*>(data); });
+  gst_object_unref(peer);
+  return true;
+}
+
+// Objects per frame in the nvmsgbroker cases.
+constexpr int kBrokerObjects = 20;
+// Frames per batch in the serializer cases, nvmsgbroker's default.
+constexpr uint32_t kBrokerBatch = 32;
+
+bool attach_broker_detections(GstElement* dut, const Params& p) {
+  return attach_detections_to(dut, p, kBrokerObjects);
+}
+
+void fail(ChildResult* result, const char* fmt, ...) G_GNUC_PRINTF(2, 3);
+
+void fail(ChildResult* result, const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  std::vsnprintf(result->error, sizeof(result->error), fmt, args);
+  va_end(args);
+  result->ok = 0;
+}
+
+double percentile_us(const std::vector<uint64_t>& sorted, double q) {
+  if (sorted.empty())
+    return 0.0;
+  size_t rank = static_cast<size_t>(q * static_cast<double>(sorted.size()) + 0.5);
+  rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+  return static_cast<double>(sorted[rank - 1]) / 1000.0;
+}
+
+void set_latencies(std::vector<uint64_t>* latencies, ChildResult* result) {
+  std::sort(latencies->begin(), latencies->end());
+  result->p50_us = percentile_us(*latencies, 0.50);
+  result->p99_us = percentile_us(*latencies, 0.99);
+  result->p999_us = percentile_us(*latencies, 0.999);
+}
+
+// nvmsgbroker's serialization and sender without the pipeline around it:
+// a hundred times --frames frames of kBrokerObjects objects, a quarter of
+// them with a classifier label, in batches sent to /dev/null. Latency is
+// per frame appended.
+void run_serializer(nvgst::MessageFormat format, const Params& p, ChildResult* result) {
+  std::vector<nvgst::DetectedObject> objects(kBrokerObjects);
+  for (int i = 0; i < kBrokerObjects; i++) {
+    nvgst::DetectedObject& object = objects[i];
+    object = {};
+    object.class_id = i % 3;
+    object.confidence = 0.5f + static_cast<float>(i) * 0.02f;
+    object.x = static_cast<float>(i) * 31.5f;
+    object.y = static_cast<float>(i) * 17.25f;
+    object.width = 64.0f;
+    object.height = 48.25f;
+    object.track_id = static_cast<uint64_t>(i + 1);
+    if (i % 4 == 0)
+      object.attributes[0] = {1, 7, 0.75f, false};
+  }
+
+  nvgst::MessageSender sender;
+  sender.start(nvgst::create_message_transport("file:///dev/null"), 16,
+               nvgst::SendBackpressure::kBlock);
+  sender.set_batching(format, kBrokerBatch, 0);
+  const uint64_t frames = static_cast<uint64_t>(p.frames) * 100;
+  std::vector<uint64_t> latencies;
+  latencies.reserve(frames);
+  const uint64_t start = now_ns();
+  for (uint64_t f = 0; f < frames; f++) {
+    const uint64_t t = now_ns();
+    sender.append({0, f, static_cast<int64_t>(f * 33333333), 0, objects.data(), objects.size()});
+    if (f >= kWarmupFrames)
+      latencies.push_back(now_ns() - t);
+  }
+  sender.stop();
+
+  result->ok = 1;
+  result->frames = frames;
+  result->wall_ns = now_ns() - start;
+  set_latencies(&latencies, result);
+  if (sender.sent() != frames)
+    fail(result, "%" PRIu64 " of %" PRIu64 " frames sent", sender.sent(), frames);
+}
+
+// Stands in for an encoder in front of nvrecord: one keyframe every
+// kGopFrames buffers, the rest delta units. With trigger, the first buffer
+// starts a recording that lasts the whole run.
+constexpr uint64_t kGopFrames = 30;
+
+struct GopMarker {
+  GstElement* record;
+  bool trigger;
+  uint64_t buffers;
+};
+
+GstPadProbeReturn gop_probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+  auto* marker = static_cast<GopMarker*>(user_data);
+  GstBuffer* buf = gst_buffer_make_writable(GST_PAD_PROBE_INFO_BUFFER(info));
+  GST_PAD_PROBE_INFO_DATA(info) = buf;
+
+  if (marker->buffers % kGopFrames != 0)
+    GST_BUFFER_FLAG_SET(buf, GST_BUFFER_FLAG_DELTA_UNIT);
+  if (marker->buffers++ == 0 && marker->trigger)
+    g_signal_emit_by_name(marker->record, "trigger");
+  return GST_PAD_PROBE_OK;
+}
+
+bool mark_gops(GstElement* dut, bool trigger) {
+  GstPad* sinkpad = gst_element_get_static_pad(dut, "sink");
+  GstPad* peer = sinkpad ? gst_pad_get_peer(sinkpad) : nullptr;
+  if (sinkpad)
+    gst_object_unref(sinkpad);
+  if (peer == nullptr)
+    return false;
+
+  auto* marker = new GopMarker{dut, trigger, 0};
+  gst_pad_add_probe(peer, GST_PAD_PROBE_TYPE_BUFFER, gop_probe, marker,
+                    [](gpointer data) { delete static_cast<GopMarker*>(data); });
+  gst_object_unref(peer);
+  return true;
+}
+
+// Where a case writes files of its own; see Params::scratch.
+std::string scratch_path(const Params& p, const char* name) {
+  return std::string(p.scratch) + name;
+}
+
+// A scene for nvanalytics scaled to the frame: lines across the crowd in
+// three directions and a 4x3 grid of zones, rectangles and diamonds in
+// turn, every other one with a dwell time.
+bool write_analytics_config(const std::string& path, int width, int height) {
+  FILE* f = std::fopen(path.c_str(), "w");
+  if (f == nullptr)
+    return false;
+  for (int i = 0; i < 6; i++) {
+    const int x = width * (2 * i + 1) / 12;
+    std::fprintf(f, "[line:v%d]\npoints=%d,0;%d,%d\n\n", i, x, x, height);
+  }
+  for (int i = 0; i < 4; i++) {
+    const int y = height * (2 * i + 1) / 8;
+    std::fprintf(f, "[line:h%d]\npoints=0,%d;%d,%d\ndirection=positive\n\n", i, y, width, y);
+  }
+  std::fprintf(f, "[line:d0]\npoints=0,0;%d,%d\n\n", width, height);
+  std::fprintf(f, "[line:d1]\npoints=0,%d;%d,0\nclasses=1\n\n", height, width);
+  const int cell_w = width / 4;
+  const int cell_h = height / 3;
+  for (int i = 0; i < 12; i++) {
+    const int x0 = (i % 4) * cell_w + cell_w / 10;
+    const int y0 = (i / 4) * cell_h + cell_h / 10;
+    const int x1 = x0 + cell_w * 8 / 10;
+    const int y1 = y0 + cell_h * 8 / 10;
+    if (i % 2 == 0) {
+      std::fprintf(f, "[zone:z%d]\npoints=%d,%d;%d,%d;%d,%d;%d,%d\n", i, x0, y0, x1, y0, x1, y1, x0,
+                   y1);
+    } else {
+      const int cx = (x0 + x1) / 2;
+      const int cy = (y0 + y1) / 2;
+      std::fprintf(f, "[zone:z%d]\npoints=%d,%d;%d,%d;%d,%d;%d,%d\ndwell-time=1\n", i, cx, y0, x1,
+                   cy, cx, y1, x0, cy);
+    }
+    std::fprintf(f, "\n");
+  }
+  return std::fclose(f) == 0;
+}
+
+// Detections in front of the element named "tracker", for cases behind it.
+bool attach_tracked_detections(GstElement* dut, const Params& p) {
+  GstElement* tracker = find_element(dut, "tracker");
+  if (tracker == nullptr)
+    return false;
+  const bool ok = attach_detections_to(tracker, p);
+  gst_object_unref(tracker);
+  return ok;
+}
+
+// The scene above on dut, behind a tracker.
+bool attach_analytics(GstElement* dut, const Params& p) {
+  const std::string path = scratch_path(p, "analytics.ini");
+  if (!write_analytics_config(path, p.width, p.height))
+    return false;
+  g_object_set(dut, "config-location", path.c_str(), nullptr);
+  return attach_tracked_detections(dut, p);
+}
+
+// Re-ID embedding length in the nvreid cases.
+constexpr int kReidDim = 256;
+
+// Stands in for a re-ID network between nvroipack and nvreid: one row per
+// ROI, a direction fixed per track plus some noise, added to the buffer's
+// tensors as "embeddings".
+struct Embedder {
+  const GstMetaInfo* roi_info;
+  const GstMetaInfo* tensor_info;
+  uint32_t seed;
+};
+
+GstPadProbeReturn embed_probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+  auto* embedder = static_cast<Embedder*>(user_data);
+  GstBuffer* buf = gst_buffer_make_writable(GST_PAD_PROBE_INFO_BUFFER(info));
+  GST_PAD_PROBE_INFO_DATA(info) = buf;
+
+  auto* rmeta = reinterpret_cast<GstNvRoiMeta*>(gst_buffer_get_meta(buf, embedder->roi_info->api));
+  auto* tmeta =
+      reinterpret_cast<GstNvTensorMeta*>(gst_buffer_get_meta(buf, embedder->tensor_info->api));
+  if (rmeta == nullptr || tmeta == nullptr || rmeta->rois->empty())
+    return GST_PAD_PROBE_OK;
+
+  const size_t rows = rmeta->rois->size();
+  nvgst::Tensor tensor;
+  tensor.info = {"embeddings", {static_cast<int>(rows), kReidDim}};
+  tensor.data.reset(new float[rows * kReidDim], std::default_delete<float[]>());
+  for (size_t r = 0; r < rows; r++) {
+    uint32_t track = static_cast<uint32_t>((*rmeta->rois)[r].track_id) * 2654435761u | 1u;
+    float* row = tensor.data.get() + r * kReidDim;
+    for (int d = 0; d < kReidDim; d++) {
+      track ^= track << 13;
+      track ^= track >> 17;
+      track ^= track << 5;
+      uint32_t& x = embedder->seed;
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      row[d] = static_cast<float>(track >> 8) / 16777216.0f - 0.5f +
+               (static_cast<float>(x >> 8) / 16777216.0f - 0.5f) * 0.2f;
+    }
+  }
+  tmeta->tensors->push_back(tensor);
+  return GST_PAD_PROBE_OK;
+}
+
+// Detections in front of "tracker", embeddings behind "embedder".
+bool attach_embeddings(GstElement* dut, const Params& p) {
+  const GstMetaInfo* roi_info = gst_meta_get_info("GstNvRoiMeta");
+  const GstMetaInfo* tensor_info = gst_meta_get_info("GstNvTensorMeta");
+  GstElement* embedder = find_element(dut, "embedder");
+  GstPad* srcpad = embedder ? gst_element_get_static_pad(embedder, "src") : nullptr;
+  const bool ok = roi_info != nullptr && tensor_info != nullptr && srcpad != nullptr &&
+                  attach_tracked_detections(dut, p);
+  if (ok) {
+    gst_pad_add_probe(srcpad, GST_PAD_PROBE_TYPE_BUFFER, embed_probe,
+                      new Embedder{roi_info, tensor_info, 2463534242u},
+                      [](gpointer data) { delete static_cast<Embedder*>(data); });
+  }
+  if (srcpad)
+    gst_object_unref(srcpad);
+  if (embedder)
+    gst_object_unref(embedder);
+  return ok;
+}
+
+// nvreid's index without the pipeline: kReidPeople people seen kReidViews
+// times each, as noisy views of one embedding spread over 100 cameras,
+// then --frames searches for new views of them. Latency is per search; the
+// note gives the top-1 hits and the index's size.
+constexpr int kReidPeople = 20000;
+constexpr int kReidViews = 12;
+
+void run_reid_index(bool quantize, const Params& p, ChildResult* result) {
+  std::mt19937 rng(1);
+  std::normal_distribution<float> gauss;
+  std::vector<float> people(static_cast<size_t>(kReidPeople) * kReidDim);
+  for (float& v : people)
+    v = gauss(rng);
+  std::vector<float> view(kReidDim);
+  auto make_view = [&](int person) {
+    const float* base = &people[static_cast<size_t>(person) * kReidDim];
+    for (int d = 0; d < kReidDim; d++)
+      view[d] = base[d] + 0.8f * gauss(rng);
+  };
+
+  nvgst::EmbeddingIndex index;
+  nvgst::EmbeddingIndexConfig config;
+  config.dim = kReidDim;
+  config.quantize = quantize;
+  config.retention = 0;
+  if (!index.configure(config)) {
+    fail(result, "cannot configure the index");
+    return;
+  }
+  for (int i = 0; i < kReidPeople * kReidViews; i++) {
+    const int person = i % kReidPeople;
+    make_view(person);
+    nvgst::ReidEntry entry;
+    entry.source = static_cast<uint32_t>(i % 100);
+    entry.track_id = static_cast<uint64_t>(i + 1);
+    // The person, to score the searches by.
+    entry.class_id = person;
+    entry.first_seen = entry.last_seen = static_cast<uint64_t>(i);
+    index.add(entry, view.data());
+  }
+
+  std::vector<uint64_t> latencies;
+  std::vector<nvgst::ReidMatch> matches;
+  nvgst::ReidFilter filter;
+  filter.min_similarity = 0.3f;
+  uint64_t busy = 0;
+  int hits = 0;
+  for (int i = 0; i < p.frames; i++) {
+    const int person = (i * 97) % kReidPeople;
+    make_view(person);
+    const uint64_t t = now_ns();
+    index.search(view.data(), filter, 5, &matches);
+    const uint64_t elapsed = now_ns() - t;
+    busy += elapsed;
+    if (static_cast<uint64_t>(i) >= kWarmupFrames)
+      latencies.push_back(elapsed);
+    if (!matches.empty() && matches[0].entry.class_id == person)
+      hits++;
+  }
+
+  result->ok = 1;
+  result->frames = static_cast<uint64_t>(p.frames);
+  result->wall_ns = busy;
+  set_latencies(&latencies, result);
+  std::snprintf(result->note, sizeof(result->note), "top-1 %d/%d, %zu tracks, %.0f MB", hits,
+                p.frames, index.size(), static_cast<double>(index.memory()) / 1e6);
+}
+
+// Writes the batches p describes, with detections, through nvcapturesink
+// to path. Runs before the case's own pipeline, for the replay cases.
+bool write_capture(const Params& p, const std::string& path) {
+  const std::string description =
+      "nvbatchmux name=mux ! identity name=tap ! nvcapturesink location=" + path +
+      sources(p, "mux");
+  GError* error = nullptr;
+  GstElement* pipeline = gst_parse_launch(description.c_str(), &error);
+  if (pipeline == nullptr || error != nullptr) {
+    g_clear_error(&error);
+    if (pipeline)
+      gst_object_unref(pipeline);
+    return false;
+  }
+  GstElement* tap = gst_bin_get_by_name(GST_BIN(pipeline), "tap");
+  bool ok = tap != nullptr && attach_detections_to(tap, p);
+  if (tap)
+    gst_object_unref(tap);
+  if (ok) {
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    GstBus* bus = gst_element_get_bus(pipeline);
+    GstMessage* msg = gst_bus_timed_pop_filtered(
+        bus, GST_CLOCK_TIME_NONE, static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+    ok = msg != nullptr && GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS;
+    if (msg)
+      gst_message_unref(msg);
+    gst_object_unref(bus);
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+  }
+  gst_object_unref(pipeline);
+  return ok;
+}
+
+std::string replay_path(const Params& p) {
+  return scratch_path(p, "replay.nvcap");
+}
+
+bool record_replay(GstElement* dut, const Params& p) {
+  return write_capture(p, replay_path(p));
+}
+
+const char* other_format(const char* format) {
+  return std::strcmp(format, "RGBA") == 0 ? "NV12" : "RGBA";
+}
+
+std::vector<BenchCase> make_cases() {
+  const std::vector<const char*> all_formats = {"NV12", "I420", "RGBA", "BGRx"};
+  const std::vector<int> single = {1};
+  const std::vector<int> batches = {1, 4, 8};
+  const std::vector<int> walls = {4, 16};
+  const std::vector<Resolution> tiny = {{16, 16}};
+  // 16 KiB per buffer, as a 4 Mbit/s stream at 30 fps.
+  const std::vector<Resolution> encoded = {{128, 128}};
+  // For cases without a pipeline.
+  const std::vector<const char*> no_format = {"-"};
+  const std::vector<Resolution> no_frame = {{0, 0}};
+
+  // A converter and a queue, and a chain of a hundred times as many tiny
+  // buffers where the tracer's per-push cost dominates.
+  const PipelineBuilder traced = [](const Params& p) {
+    return source(p) + " ! nvconvert name=dut ! video/x-raw,format=RGBA ! queue ! "
+                       "fakesink sync=false";
+  };
+  const PipelineBuilder traced_tiny = [](const Params& p) {
+    Params many = p;
+    many.frames *= 100;
+    return source(many) + " ! identity name=dut ! queue ! identity ! fakesink sync=false";
+  };
+
+  return {
+      {"nvconvert", all_formats, single,
+       [](const Params& p) {
+         return source(p) + " ! nvconvert name=dut ! video/x-raw,format=" + other_format(p.format) +
+                " ! fakesink sync=false";
+       }},
+      {"nvconvert-scale", all_formats, single,
+       [](const Params& p) {
+         return source(p) + " ! nvconvert name=dut ! video/x-raw,width=" + std::to_string(p.width / 2) +
+                ",height=" + std::to_string(p.height / 2) + " ! fakesink sync=false";
+       }},
+      {"nvbatchmux", {"NV12"}, batches,
+       [](const Params& p) {
+         return "nvbatchmux name=dut ! fakesink sync=false" + sources(p, "dut");
+       }},
+      {"nvbatchmux-contiguous", {"NV12"}, batches,
+       [](const Params& p) {
+         return "nvbatchmux name=dut zero-copy=false ! fakesink sync=false" + sources(p, "dut");
+       }},
+      {"nvbatchdemux", {"NV12"}, batches,
+       [](const Params& p) {
+         return "nvbatchmux name=mux zero-copy=false ! nvbatchdemux name=dut" + sources(p, "mux") +
+                sinks(p, "dut");
+       }},
+      {"nvlatency-off", {"NV12"}, single, traced},
+      {"nvlatency-on", {"NV12"}, single, traced, nullptr, {}, kLatencyTracer},
+      {"nvlatency-off-tiny", {"GRAY8"}, single, traced_tiny, nullptr, tiny},
+      {"nvlatency-on-tiny", {"GRAY8"}, single, traced_tiny, nullptr, tiny, kLatencyTracer},
+      {"nvtiler", {"NV12"}, walls,
+       [](const Params& p) {
+         return "nvtiler name=dut width=1920 height=1080 ! video/x-raw,format=BGRx ! "
+                "fakesink sync=false" + sources(p, "dut");
+       }},
+      {"nvtiler-redraw", {"NV12"}, walls,
+       [](const Params& p) {
+         return "nvtiler name=dut width=1920 height=1080 skip-unchanged=false ! "
+                "video/x-raw,format=BGRx ! fakesink sync=false" + sources(p, "dut");
+       }},
+      {"compositor-grid", {"NV12"}, walls,
+       [](const Params& p) {
+         return compositor_grid(p, 1920, 1080) + " ! fakesink sync=false" + sources(p, "dut");
+       }},
+      {"nvshm", all_formats, single,
+       [](const Params& p) {
+         std::string path = "socket-path=/tmp/nvgst-bench-" + std::to_string(getpid()) + ".sock";
+         return source(p) + " ! nvshmsink name=dut_in sync=false async=false " + path + "  nvshmsrc name=dut_out " + path +
+                " ! fakesink sync=false";
+       }},
+      {"nvosd", {"NV12", "RGBA"}, single,
+       [](const Params& p) { return source(p) + " ! nvosd name=dut ! fakesink sync=false"; },
+       attach_osd_annotator},
+      {"nvtracker", {"NV12"}, {1, 8, 30},
+       [](const Params& p) {
+         return "nvbatchmux name=mux ! nvtracker name=dut ! fakesink sync=false" + sources(p, "mux");
+       },
+       attach_detections},
+      {"nvtracker-greedy", {"NV12"}, {1, 8, 30},
+       [](const Params& p) {
+         return "nvbatchmux name=mux ! nvtracker name=dut association=greedy ! fakesink sync=false" +
+                sources(p, "mux");
+       },
+       attach_detections},
+      {"nvpostprocess", {"NV12"}, {1, 4, 8},
+       [](const Params& p) {
+         return "nvbatchmux name=mux ! nvpostprocess name=dut ! fakesink sync=false" + sources(p, "mux");
+       },
+       attach_detector_output},
+      // Measured from the cache's sink to its result_src, across the
+      // stand-in classifier.
+      {"nvclassifycache", {"NV12"}, {1, 8},
+       [](const Params& p) {
+         return "nvbatchmux name=mux ! nvtracker name=tracker ! "
+                "nvclassifycache name=dut classifier-id=1 "
+                "dut.src ! identity name=classifier ! dut.result_sink "
+                "dut.result_src ! fakesink sync=false" + sources(p, "mux");
+       },
+       attach_classifier, {}, nullptr, {"sink", "result_src"}},
+      // Keeping the pre-event ring only, and recording the whole run.
+      {"nvrecord-idle", {"GRAY8"}, single,
+       [](const Params& p) {
+         return source(p) + " ! nvrecord name=dut sync=false location=" +
+                scratch_path(p, "record%05d.bin");
+       },
+       [](GstElement* dut, const Params& p) { return mark_gops(dut, false); }, encoded},
+      {"nvrecord", {"GRAY8"}, single,
+       [](const Params& p) {
+         return source(p) + " ! nvrecord name=dut sync=false post-event-time=3600000000000 " +
+                "location=" + scratch_path(p, "record%05d.bin");
+       },
+       [](GstElement* dut, const Params& p) { return mark_gops(dut, true); }, encoded},
+      {"nvmsgbroker-json", {"NV12"}, {1, 8},
+       [](const Params& p) {
+         return "nvbatchmux name=mux ! nvmsgbroker name=dut sync=false format=json "
+                "backpressure=block location=file://" + scratch_path(p, "messages.ndjson") +
+                sources(p, "mux");
+       },
+       attach_broker_detections},
+      {"nvmsgbroker-binary", {"NV12"}, {1, 8},
+       [](const Params& p) {
+         return "nvbatchmux name=mux ! nvmsgbroker name=dut sync=false format=binary "
+                "backpressure=block location=file://" + scratch_path(p, "messages.bin") +
+                sources(p, "mux");
+       },
+       attach_broker_detections},
+      {"broker-serialize-json", no_format, single, nullptr, nullptr, no_frame, nullptr, {},
+       [](const Params& p, ChildResult* r) { run_serializer(nvgst::MessageFormat::kJson, p, r); }},
+      {"broker-serialize-binary", no_format, single, nullptr, nullptr, no_frame, nullptr, {},
+       [](const Params& p, ChildResult* r) {
+         run_serializer(nvgst::MessageFormat::kBinary, p, r);
+       }},
+      {"nvmotiongate", {"NV12", "RGBA"}, single,
+       [](const Params& p) { return source(p) + " ! nvmotiongate name=dut ! fakesink sync=false"; }},
+      {"nvmotiongate-batched", {"NV12"}, {4, 8},
+       [](const Params& p) {
+         return "nvbatchmux name=mux ! nvmotiongate name=dut ! fakesink sync=false" + sources(p, "mux");
+       }},
+      {"nvroipack", {"NV12", "RGBA"}, {1, 4, 8},
+       [](const Params& p) {
+         return "nvbatchmux name=mux ! nvroipack name=dut max-rois=64 ! fakesink sync=false" +
+                sources(p, "mux");
+       },
+       attach_detections},
+      {"nvdewarp", {"NV12", "RGBA"}, single,
+       [](const Params& p) {
+         return source(p) + " ! nvdewarp name=dut cache-dir=\"\" ! fakesink sync=false";
+       }},
+      {"nvpyramid", {"NV12", "RGBA"}, single,
+       [](const Params& p) {
+         return source(p) + " ! nvpyramid name=dut levels=1280x720,640x360,320x180" +
+                " dut.src_0 ! fakesink sync=false async=false" +
+                " dut.src_1 ! fakesink sync=false async=false" +
+                " dut.src_2 ! fakesink sync=false async=false";
+       }},
+      {"nvanalytics", {"NV12"}, {1, 8},
+       [](const Params& p) {
+         return "nvbatchmux name=mux ! nvtracker name=tracker ! nvanalytics name=dut ! "
+                "fakesink sync=false" + sources(p, "mux");
+       },
+       attach_analytics},
+      // A crop of every track once it has been seen for a second, so the
+      // workers encode while the streaming thread keeps picking crops.
+      {"nvsnapshot", {"NV12", "RGBA"}, {1, 4},
+       [](const Params& p) {
+         return "nvbatchmux name=mux ! nvtracker name=tracker ! nvsnapshot name=dut max-age=30 "
+                "location=" + scratch_path(p, "snapshot%06d.jpg") + " ! fakesink sync=false" +
+                sources(p, "mux");
+       },
+       attach_tracked_detections},
+      // A short linger, so tracks lost when the detections jump back get indexed.
+      {"nvreid", {"NV12"}, {1, 8},
+       [](const Params& p) {
+         return "nvbatchmux name=mux ! nvtracker name=tracker ! "
+                "nvroipack max-rois=64 width=64 height=128 ! identity name=embedder ! "
+                "nvreid name=dut linger=200000000 ! fakesink sync=false" + sources(p, "mux");
+       },
+       attach_embeddings},
+      {"reid-index-int8", no_format, single, nullptr, nullptr, no_frame, nullptr, {},
+       [](const Params& p, ChildResult* r) { run_reid_index(true, p, r); }},
+      {"reid-index-f32", no_format, single, nullptr, nullptr, no_frame, nullptr, {},
+       [](const Params& p, ChildResult* r) { run_reid_index(false, p, r); }},
+      {"nvcapturesink", {"NV12", "RGBA"}, single,
+       [](const Params& p) {
+         return source(p) + " ! nvcapturesink name=dut location=" +
+                scratch_path(p, "capture.nvcap");
+       }},
+      {"nvcapturesink-batch", {"NV12"}, {1, 8},
+       [](const Params& p) {
+         return "nvbatchmux name=mux ! nvcapturesink name=dut location=" +
+                scratch_path(p, "capture.nvcap") + sources(p, "mux");
+       },
+       attach_detections},
+      // Replay cases play a capture of the same batches, written first.
+      {"nvreplaysrc", {"NV12", "RGBA"}, {1, 8},
+       [](const Params& p) {
+         return "nvreplaysrc name=dut location=" + replay_path(p) + " ! fakesink sync=false";
+       },
+       record_replay},
+      {"nvreplaysrc-preload", {"NV12"}, {1, 8},
+       [](const Params& p) {
+         return "nvreplaysrc name=dut preload=true location=" + replay_path(p) +
+                " ! fakesink sync=false";
+       },
+       record_replay},
+      {"nvtracker-replay", {"NV12"}, {1, 8},
+       [](const Params& p) {
+         return "nvreplaysrc location=" + replay_path(p) +
+                " ! nvtracker name=dut ! fakesink sync=false";
+       },
+       record_replay},
+      {"nvredact", {"NV12", "RGBA"}, {1, 4},
+       [](const Params& p) {
+         return "nvbatchmux name=mux ! nvredact name=dut classes=1 mode=blur passes=3 ! "
+                "fakesink sync=false" + sources(p, "mux");
+       },
+       attach_detections},
+      {"nvbgsub", {"NV12", "RGBA"}, {1, 4},
+       [](const Params& p) {
+         return "nvbatchmux name=mux ! nvbgsub name=dut ! fakesink sync=false" + sources(p, "mux");
+       }},
+      {"queue-1k", {"GRAY8"}, single,
+       [](const Params& p) {
+         return paced_source(p, 1000) + " ! queue name=dut ! fakesink sync=false";
+       },
+       nullptr, tiny},
+      {"nvqueue-1k", {"GRAY8"}, single,
+       [](const Params& p) {
+         return paced_source(p, 1000) + " ! nvqueue name=dut ! fakesink sync=false";
+       },
+       nullptr, tiny},
+      {"queue-10k", {"GRAY8"}, single,
+       [](const Params& p) {
+         return paced_source(p, 10000) + " ! queue name=dut ! fakesink sync=false";
+       },
+       nullptr, tiny},
+      {"nvqueue-10k", {"GRAY8"}, single,
+       [](const Params& p) {
+         return paced_source(p, 10000) + " ! nvqueue name=dut ! fakesink sync=false";
+       },
+       nullptr, tiny},
+      {"queue-100k", {"GRAY8"}, single,
+       [](const Params& p) {
+         return paced_source(p, 100000) + " ! queue name=dut ! fakesink sync=false";
+       },
+       nullptr, tiny},
+      {"nvqueue-100k", {"GRAY8"}, single,
+       [](const Params& p) {
+         return paced_source(p, 100000) + " ! nvqueue name=dut ! fakesink sync=false";
+       },
+       nullptr, tiny},
+      {"nvinfer", {"NV12"}, single,
+       [](const Params& p) { return source(p) + " ! nvinfer name=dut ! fakesink sync=false"; }},
+      {"nvinfer-batched", {"NV12"}, {4, 8},
+       [](const Params& p) {
+         return "nvbatchmux name=mux ! nvinfer name=dut workers=4 ! fakesink sync=false" + sources(p, "mux");
+       }},
+  };
+}
+
+// Shared by the probes of one pipeline; sink pads of muxers run on several
+// streaming threads.
+struct ProbeState {
+  std::mutex lock;
+  std::unordered_map<GstClockTime, uint64_t> arrivals;
+  std::vector<uint64_t> latencies;
+  uint64_t frames_in = 0;
+  uint64_t first_ns = 0;
+  uint64_t last_ns = 0;
+  // dut is a source: frames are counted as it produces them.
+  bool source = false;
+};
+
+GstPadProbeReturn sink_probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+  auto* state = static_cast<ProbeState*>(user_data);
+  GstBuffer* buf = GST_PAD_PROBE_INFO_BUFFER(info);
+  uint64_t t = now_ns();
+
+  std::lock_guard<std::mutex> guard(state->lock);
+  if (state->frames_in++ == 0)
+    state->first_ns = t;
+  // Overtaken by src_probe when dut has source pads; a sink ends here.
+  state->last_ns = t;
+  state->arrivals.emplace(GST_BUFFER_PTS(buf), t);
+  return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn src_probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+  auto* state = static_cast<ProbeState*>(user_data);
+  GstBuffer* buf = GST_PAD_PROBE_INFO_BUFFER(info);
+  uint64_t t = now_ns();
+
+  std::lock_guard<std::mutex> guard(state->lock);
+  state->last_ns = t;
+  if (state->source) {
+    if (state->frames_in++ == 0)
+      state->first_ns = t;
+    return GST_PAD_PROBE_OK;
+  }
+  auto it = state->arrivals.find(GST_BUFFER_PTS(buf));
+  if (it == state->arrivals.end())
+    return GST_PAD_PROBE_OK;
+  if (state->frames_in > kWarmupFrames)
+    state->latencies.push_back(t - it->second);
+  state->arrivals.erase(it);
+  return GST_PAD_PROBE_OK;
+}
+
+void add_probe(GstPad* pad, ProbeState* state) {
+  gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER,
+                    GST_PAD_DIRECTION(pad) == GST_PAD_SINK ? sink_probe : src_probe, state, nullptr);
+}
+
+gboolean probe_existing_pad(GstElement* element, GstPad* pad, gpointer user_data) {
+  add_probe(pad, static_cast<ProbeState*>(user_data));
+  return TRUE;
+}
+
+void on_pad_added(GstElement* element, GstPad* pad, gpointer user_data) {
+  add_probe(pad, static_cast<ProbeState*>(user_data));
+}
+
+// Runs in the child process.
+void run_pipeline(const std::string& description, const BenchCase& bench_case,
+                  const Params& params, ChildResult* result) {
+  GError* error = nullptr;
+  GstElement* pipeline;
+  GstElement* dut;
+  GstElement* dut_out = nullptr;
+  GstBus* bus;
+  GstMessage* msg;
+  ProbeState state;
+
+  pipeline = gst_parse_launch(description.c_str(), &error);
+  if (pipeline == nullptr || error != nullptr) {
+    fail(result, "parse: %s", error ? error->message : "unknown error");
+    g_clear_error(&error);
+    if (pipeline)
+      gst_object_unref(pipeline);
+    return;
+  }
+
+  dut = gst_bin_get_by_name(GST_BIN(pipeline), "dut");
+  if (dut == nullptr) {
+    // A sink/source pair measured end to end: buffers enter dut_in and
+    // leave dut_out.
+    dut_out = gst_bin_get_by_name(GST_BIN(pipeline), "dut_out");
+    if (dut_out != nullptr)
+      dut = gst_bin_get_by_name(GST_BIN(pipeline), "dut_in");
+  }
+  if (dut == nullptr) {
+    fail(result, "no element named dut (or dut_in and dut_out)");
+    if (dut_out)
+      gst_object_unref(dut_out);
+    gst_object_unref(pipeline);
+    return;
+  }
+  state.source = dut->numsinkpads == 0 && dut_out == nullptr;
+  if (bench_case.setup && !bench_case.setup(dut, params)) {
+    fail(result, "setup failed");
+    gst_object_unref(dut);
+    if (dut_out)
+      gst_object_unref(dut_out);
+    gst_object_unref(pipeline);
+    return;
+  }
+  if (bench_case.pads.empty()) {
+    gst_element_foreach_pad(dut, probe_existing_pad, &state);
+    g_signal_connect(dut, "pad-added", G_CALLBACK(on_pad_added), &state);
+  }
+  for (const char* name : bench_case.pads) {
+    GstPad* pad = gst_element_get_static_pad(dut, name);
+    if (pad == nullptr) {
+      fail(result, "dut has no pad %s", name);
+      gst_object_unref(dut);
+      if (dut_out)
+        gst_object_unref(dut_out);
+      gst_object_unref(pipeline);
+      return;
+    }
+    add_probe(pad, &state);
+    gst_object_unref(pad);
+  }
+  if (dut_out)
+    gst_element_foreach_pad(dut_out, probe_existing_pad, &state);
+
+  uint64_t start = now_ns();
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus(pipeline);
+  msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE,
+                                   static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+  uint64_t end = now_ns();
+
+  result->ok = 1;
+  if (msg != nullptr && GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+    GError* err = nullptr;
+    gst_message_parse_error(msg, &err, nullptr);
+    fail(result, "%s", err->message);
+    g_clear_error(&err);
+  }
+  if (msg)
+    gst_message_unref(msg);
+
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(bus);
+  gst_object_unref(dut);
+  if (dut_out)
+    gst_object_unref(dut_out);
+  gst_object_unref(pipeline);
+
+  std::lock_guard<std::mutex> guard(state.lock);
+  result->frames = state.frames_in;
+  result->wall_ns = state.last_ns > state.first_ns ? state.last_ns - state.first_ns : end - start;
+  set_latencies(&state.latencies, result);
+}
+
+bool write_all(int fd, const void* data, size_t size) {
+  const char* p = static_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t n = write(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+bool read_all(int fd, void* data, size_t size) {
+  char* p = static_cast<char*>(data);
+  while (size > 0) {
+    ssize_t n = read(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+Result run_case(const BenchCase& bench_case, const Params& params) {
+  Result result{};
+  result.name = bench_case.name;
+  result.params = params;
+
+  int fds[2];
+  if (pipe(fds) != 0) {
+    fail(&result.child, "pipe: %s", std::strerror(errno));
+    return result;
+  }
+
+  std::string description = bench_case.build ? bench_case.build(params) : std::string();
+  pid_t pid = fork();
+  if (pid < 0) {
+    fail(&result.child, "fork: %s", std::strerror(errno));
+    close(fds[0]);
+    close(fds[1]);
+    return result;
+  }
+
+  if (pid == 0) {
+    ChildResult child{};
+    close(fds[0]);
+#ifdef NVGST_BENCH_PLUGIN_DIR
+    // Prefer the freshly built plugin over an installed one.
+    const char* path = std::getenv("GST_PLUGIN_PATH");
+    std::string plugin_path = NVGST_BENCH_PLUGIN_DIR;
+    if (path && *path)
+      plugin_path += std::string(":") + path;
+    setenv("GST_PLUGIN_PATH", plugin_path.c_str(), 1);
+#endif
+    if (bench_case.tracers != nullptr)
+      setenv("GST_TRACERS", bench_case.tracers, 1);
+    gst_init(nullptr, nullptr);
+    if (bench_case.run)
+      bench_case.run(params, &child);
+    else
+      run_pipeline(description, bench_case, params, &child);
+    bool written = write_all(fds[1], &child, sizeof(child));
+    close(fds[1]);
+    _exit(written ? 0 : 1);
+  }
+
+  close(fds[1]);
+  if (!read_all(fds[0], &result.child, sizeof(result.child)))
+    fail(&result.child, "child exited without a result");
+  close(fds[0]);
+
+  int status = 0;
+  rusage usage{};
+  while (wait4(pid, &status, 0, &usage) < 0 && errno == EINTR) {
+  }
+  result.cpu_s = static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+                 static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+  result.peak_rss_kb = usage.ru_maxrss;
+  if (result.child.ok && !(WIFEXITED(status) && WEXITSTATUS(status) == 0))
+    fail(&result.child, "child exited with status %d", status);
+
+  glob_t files{};
+  if (glob((std::string(params.scratch) + "*").c_str(), 0, nullptr, &files) == 0) {
+    for (size_t i = 0; i < files.gl_pathc; i++)
+      unlink(files.gl_pathv[i]);
+  }
+  globfree(&files);
+
+  return result;
+}
+
+double fps(const Result& r) {
+  if (r.child.wall_ns == 0)
+    return 0.0;
+  return static_cast<double>(r.child.frames) * 1e9 / static_cast<double>(r.child.wall_ns);
+}
+
+std::string status(const Result& r) {
+  if (!r.child.ok)
+    return r.child.error;
+  return r.child.note[0] ? std::string("ok, ") + r.child.note : "ok";
+}
+
+void write_text(FILE* out, const std::vector<Result>& results, int frames) {
+  std::fprintf(out, "# nvgst-bench %s frames=%d warmup=%" PRIu64 "\n", NVGST_BENCH_VERSION, frames,
+               kWarmupFrames);
+  std::fprintf(out, "%-24s %-6s %-11s %5s %10s %10s %10s %10s %8s %11s %s\n", "case", "format", "resolution",
+               "batch", "fps", "p50_us", "p99_us", "p999_us", "cpu_s", "peak_rss_kb", "status");
+  for (const Result& r : results) {
+    char resolution[32];
+    std::snprintf(resolution, sizeof(resolution), "%dx%d", r.params.width, r.params.height);
+    std::fprintf(out, "%-24s %-6s %-11s %5d %10.1f %10.1f %10.1f %10.1f %8.2f %11ld %s\n", r.name,
+                 r.params.format, resolution, r.params.batch, fps(r), r.child.p50_us, r.child.p99_us,
+                 r.child.p999_us, r.cpu_s, r.peak_rss_kb, status(r).c_str());
+  }
+}
+
+std::string json_escape(const char* s) {
+  std::string out;
+  for (; *s; s++) {
+    unsigned char c = static_cast<unsigned char>(*s);
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += static_cast<char>(c);
+    } else if (c < 0x20) {
+      char buf[8];
+      std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += static_cast<char>(c);
+    }
+  }
+  return out;
+}
+
+void write_json(FILE* out, const std::vector<Result>& results, int frames) {
+  std::fprintf(out, "{\n  \"version\": \"%s\",\n  \"frames\": %d,\n  \"warmup_frames\": %" PRIu64
+                    ",\n  \"results\": [",
+               NVGST_BENCH_VERSION, frames, kWarmupFrames);
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result& r = results[i];
+    std::fprintf(out,
+                 "%s\n    {\"case\": \"%s\", \"format\": \"%s\", \"width\": %d, \"height\": %d, "
+                 "\"batch\": %d, \"frames\": %" PRIu64 ", \"fps\": %.1f, "
+                 "\"latency_us\": {\"p50\": %.1f, \"p99\": %.1f, \"p99.9\": %.1f}, "
+                 "\"cpu_time_s\": %.3f, \"peak_rss_kb\": %ld, \"ok\": %s, \"error\": \"%s\", "
+                 "\"note\": \"%s\"}",
+                 i ? "," : "", r.name, r.params.format, r.params.width, r.params.height, r.params.batch,
+                 r.child.frames, fps(r), r.child.p50_us, r.child.p99_us, r.child.p999_us, r.cpu_s,
+                 r.peak_rss_kb, r.child.ok ? "true" : "false", json_escape(r.child.error).c_str(),
+                 json_escape(r.child.note).c_str());
+  }
+  std::fprintf(out, "\n  ]\n}\n");
+}
+
+void usage(const char* argv0) {
+  std::fprintf(stderr,
+               "usage: %s [--frames N] [--filter SUBSTRING] [--quick] [--pattern NAME]\n"
+               "          [--output FILE] [--json FILE] [--list]\n"
+               "  --frames N     buffers per source (default 300)\n"
+               "  --filter S     only run cases whose name contains S\n"
+               "  --quick        720p only\n"
+               "  --pattern P    videotestsrc pattern (default black)\n"
+               "  --output FILE  text report (default bench_output.txt, - for stdout)\n"
+               "  --json FILE    JSON report (default bench_output.json)\n"
+               "  --list         print the case names and exit\n",
+               argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int frames = 300;
+  bool quick = false;
+  bool list = false;
+  const char* filter = nullptr;
+  const char* pattern = "black";
+  const char* text_path = "bench_output.txt";
+  const char* json_path = "bench_output.json";
+
+  for (int i = 1; i < argc; i++) {
+    auto value = [&](const char* flag) -> const char* {
+      if (i + 1 >= argc) {
+        std::fprintf(stderr, "%s needs a value\n", flag);
+        std::exit(2);
+      }
+      return argv[++i];
+    };
+    if (std::strcmp(argv[i], "--frames") == 0) {
+      frames = std::atoi(value("--frames"));
+    } else if (std::strcmp(argv[i], "--filter") == 0) {
+      filter = value("--filter");
+    } else if (std::strcmp(argv[i], "--quick") == 0) {
+      quick = true;
+    } else if (std::strcmp(argv[i], "--pattern") == 0) {
+      pattern = value("--pattern");
+    } else if (std::strcmp(argv[i], "--output") == 0) {
+      text_path = value("--output");
+    } else if (std::strcmp(argv[i], "--json") == 0) {
+      json_path = value("--json");
+    } else if (std::strcmp(argv[i], "--list") == 0) {
+      list = true;
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (frames <= static_cast<int>(kWarmupFrames)) {
+    std::fprintf(stderr, "--frames must be above %" PRIu64 "\n", kWarmupFrames);
+    return 2;
+  }
+
+  std::vector<Resolution> resolutions = {{640, 360}, {1280, 720}, {1920, 1080}};
+  if (quick)
+    resolutions = {{1280, 720}};
+
+  const std::string scratch = "/tmp/nvgst-bench-" + std::to_string(getpid()) + "-";
+  std::vector<Result> results;
+  bool all_ok = true;
+  for (const BenchCase& bench_case : make_cases()) {
+    if (filter && std::strstr(bench_case.name, filter) == nullptr)
+      continue;
+    if (list) {
+      std::printf("%s\n", bench_case.name);
+      continue;
+    }
+    for (const char* format : bench_case.formats) {
+      const std::vector<Resolution>& sizes =
+          bench_case.resolutions.empty() ? resolutions : bench_case.resolutions;
+      for (const Resolution& res : sizes) {
+        for (int batch : bench_case.batches) {
+          Params params{format, res.width, res.height, batch, frames, pattern, scratch.c_str()};
+          Result r = run_case(bench_case, params);
+          std::fprintf(stderr, "%-24s %-4s %4dx%-4d b%-2d %10.1f fps %s\n", r.name, format, res.width,
+                       res.height, batch, fps(r), r.child.ok ? "" : r.child.error);
+          all_ok = all_ok && r.child.ok;
+          results.push_back(r);
+        }
+      }
+    }
+  }
+  if (list)
+    return 0;
+
+  FILE* text = std::strcmp(text_path, "-") == 0 ? stdout : std::fopen(text_path, "w");
+  if (text == nullptr) {
+    std::fprintf(stderr, "cannot write %s: %s\n", text_path, std::strerror(errno));
+    return 1;
+  }
+  write_text(text, results, frames);
+  if (text != stdout)
+    std::fclose(text);
+
+  FILE* json = std::fopen(json_path, "w");
+  if (json == nullptr) {
+    std::fprintf(stderr, "cannot write %s: %s\n", json_path, std::strerror(errno));
+    return 1;
+  }
+  write_json(json, results, frames);
+  std::fclose(json);
+
+  return all_ok ? 0 : 1;
+}
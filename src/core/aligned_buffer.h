@@ -0,0 +1,67 @@
+// Owning, aligned, uninitialized byte buffer for scratch memory that is sized
+// once at configure time and reused for every frame.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+
+#include "core/frame.h"
+
+namespace nvgst {
+
+class AlignedBuffer {
+ public:
+  AlignedBuffer() = default;
+  explicit AlignedBuffer(size_t size) { reserve(size); }
+  ~AlignedBuffer() { std::free(data_); }
+
+  AlignedBuffer(const AlignedBuffer&) = delete;
+  AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+  AlignedBuffer(AlignedBuffer&& other) noexcept
+      : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+  AlignedBuffer& operator=(AlignedBuffer&& other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+
+  // Grows the buffer to at least size bytes. Existing contents are not
+  // preserved when the buffer has to grow. Returns false on allocation
+  // failure, leaving the buffer empty.
+  bool reserve(size_t size) {
+    if (size <= size_)
+      return true;
+    std::free(data_);
+    size_ = 0;
+    data_ = static_cast<uint8_t*>(
+        std::aligned_alloc(kFrameAlign, align_up(size, static_cast<size_t>(kFrameAlign))));
+    if (data_ == nullptr)
+      return false;
+    size_ = size;
+    return true;
+  }
+
+  void reset() {
+    std::free(data_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  uint8_t* data() { return data_; }
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  template <typename T>
+  T* as() {
+    return reinterpret_cast<T*>(data_);
+  }
+
+ private:
+  uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace nvgst
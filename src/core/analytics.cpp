@@ -0,0 +1,375 @@
+#include "core/analytics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace nvgst {
+
+namespace {
+
+// Largest grid side in cells; the cell size grows beyond it.
+constexpr int kMaxGridSide = 512;
+
+struct Rect {
+  float x0;
+  float y0;
+  float x1;
+  float y1;
+};
+
+// Positive when p is on the right of a -> b on screen (y down).
+float side(AnalyticsPoint a, AnalyticsPoint b, AnalyticsPoint p) {
+  return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+}
+
+bool counts_class(const std::vector<int32_t>& classes, int32_t class_id) {
+  return classes.empty() || std::find(classes.begin(), classes.end(), class_id) != classes.end();
+}
+
+// Whether segment a-b touches the rectangle: the bounding boxes overlap
+// and the rectangle's corners are not all on one side of the segment.
+bool segment_hits_rect(AnalyticsPoint a, AnalyticsPoint b, const Rect& r) {
+  if (std::max(a.x, b.x) < r.x0 || std::min(a.x, b.x) > r.x1 || std::max(a.y, b.y) < r.y0 ||
+      std::min(a.y, b.y) > r.y1)
+    return false;
+  const float s[4] = {side(a, b, {r.x0, r.y0}), side(a, b, {r.x1, r.y0}),
+                      side(a, b, {r.x0, r.y1}), side(a, b, {r.x1, r.y1})};
+  const bool all_positive = s[0] > 0.0f && s[1] > 0.0f && s[2] > 0.0f && s[3] > 0.0f;
+  const bool all_negative = s[0] < 0.0f && s[1] < 0.0f && s[2] < 0.0f && s[3] < 0.0f;
+  return !all_positive && !all_negative;
+}
+
+// Cells [*first, *last] of an axis of n cells of side cell from origin
+// that cover [lo, hi], clamped to the axis. Returns false when [lo, hi]
+// misses the axis entirely.
+bool cell_span(float lo, float hi, float origin, float cell, int n, int* first, int* last) {
+  const float f = std::floor((lo - origin) / cell);
+  const float l = std::floor((hi - origin) / cell);
+  if (l < 0.0f || f >= n)
+    return false;
+  *first = f < 0.0f ? 0 : static_cast<int>(f);
+  *last = l >= n ? n - 1 : static_cast<int>(l);
+  return true;
+}
+
+// Even-odd rule.
+bool point_in_polygon(const std::vector<AnalyticsPoint>& polygon, AnalyticsPoint p) {
+  bool inside = false;
+  const size_t n = polygon.size();
+  for (size_t i = 0, j = n - 1; i < n; j = i++) {
+    const AnalyticsPoint& a = polygon[i];
+    const AnalyticsPoint& b = polygon[j];
+    if ((a.y > p.y) != (b.y > p.y) && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x)
+      inside = !inside;
+  }
+  return inside;
+}
+
+AnalyticsPoint anchor_of(const DetectedObject& object, AnalyticsAnchor anchor) {
+  AnalyticsPoint p;
+  p.x = object.x + object.width * 0.5f;
+  p.y = anchor == AnalyticsAnchor::kBottomCenter ? object.y + object.height
+                                                 : object.y + object.height * 0.5f;
+  return p;
+}
+
+}  // namespace
+
+bool RoiAnalytics::configure(const AnalyticsConfig& config) {
+  if (!(config.cell_size >= 1.0f))
+    return false;
+  for (const AnalyticsLine& line : config.lines) {
+    if (line.a.x == line.b.x && line.a.y == line.b.y)
+      return false;
+  }
+  for (const AnalyticsZone& zone : config.zones) {
+    if (zone.polygon.size() < 3)
+      return false;
+  }
+
+  config_ = config;
+  build_grid();
+  reset();
+  return true;
+}
+
+void RoiAnalytics::reset() {
+  line_counts_.assign(config_.lines.size(), AnalyticsCount());
+  zone_counts_.assign(config_.zones.size(), AnalyticsCount());
+  tracks_.clear();
+}
+
+void RoiAnalytics::build_grid() {
+  float x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY;
+  auto extend = [&](AnalyticsPoint p) {
+    x0 = std::min(x0, p.x);
+    y0 = std::min(y0, p.y);
+    x1 = std::max(x1, p.x);
+    y1 = std::max(y1, p.y);
+  };
+  for (const AnalyticsLine& line : config_.lines) {
+    extend(line.a);
+    extend(line.b);
+  }
+  for (const AnalyticsZone& zone : config_.zones) {
+    for (AnalyticsPoint p : zone.polygon)
+      extend(p);
+  }
+
+  line_offsets_.assign(1, 0);
+  line_items_.clear();
+  zone_offsets_.assign(1, 0);
+  zone_items_.clear();
+  line_stamps_.assign(config_.lines.size(), 0);
+  stamp_ = 0;
+  columns_ = rows_ = 0;
+  if (x0 > x1)
+    return;
+
+  cell_ = std::max(config_.cell_size, std::max(x1 - x0, y1 - y0) / kMaxGridSide);
+  origin_x_ = x0;
+  origin_y_ = y0;
+  columns_ = static_cast<int>((x1 - x0) / cell_) + 1;
+  rows_ = static_cast<int>((y1 - y0) / cell_) + 1;
+  const int n_cells = columns_ * rows_;
+
+  // Per cell lists, filled by walking each shape's bounding box of cells.
+  std::vector<std::vector<int32_t>> lines(n_cells);
+  std::vector<std::vector<uint32_t>> zones(n_cells);
+  auto cell_rect = [&](int column, int row) {
+    Rect r;
+    r.x0 = origin_x_ + column * cell_;
+    r.y0 = origin_y_ + row * cell_;
+    r.x1 = r.x0 + cell_;
+    r.y1 = r.y0 + cell_;
+    return r;
+  };
+  for (size_t i = 0; i < config_.lines.size(); i++) {
+    const AnalyticsLine& line = config_.lines[i];
+    int c0 = 0, c1 = -1, r0 = 0, r1 = -1;
+    cell_span(std::min(line.a.x, line.b.x), std::max(line.a.x, line.b.x), origin_x_, cell_,
+              columns_, &c0, &c1);
+    cell_span(std::min(line.a.y, line.b.y), std::max(line.a.y, line.b.y), origin_y_, cell_, rows_,
+              &r0, &r1);
+    for (int r = r0; r <= r1; r++) {
+      for (int c = c0; c <= c1; c++) {
+        if (segment_hits_rect(line.a, line.b, cell_rect(c, r)))
+          lines[r * columns_ + c].push_back(static_cast<int32_t>(i));
+      }
+    }
+  }
+
+  for (size_t i = 0; i < config_.zones.size(); i++) {
+    const std::vector<AnalyticsPoint>& polygon = config_.zones[i].polygon;
+    float zx0 = INFINITY, zy0 = INFINITY, zx1 = -INFINITY, zy1 = -INFINITY;
+    for (AnalyticsPoint p : polygon) {
+      zx0 = std::min(zx0, p.x);
+      zy0 = std::min(zy0, p.y);
+      zx1 = std::max(zx1, p.x);
+      zy1 = std::max(zy1, p.y);
+    }
+    int c0 = 0, c1 = -1, r0 = 0, r1 = -1;
+    cell_span(zx0, zx1, origin_x_, cell_, columns_, &c0, &c1);
+    cell_span(zy0, zy1, origin_y_, cell_, rows_, &r0, &r1);
+    for (int r = r0; r <= r1; r++) {
+      for (int c = c0; c <= c1; c++) {
+        const Rect rect = cell_rect(c, r);
+        bool boundary = false;
+        for (size_t e = 0, prev = polygon.size() - 1; e < polygon.size() && !boundary; prev = e++)
+          boundary = segment_hits_rect(polygon[prev], polygon[e], rect);
+        // Without an edge through it the cell is wholly inside or outside.
+        const uint32_t entry = static_cast<uint32_t>(i) << 1;
+        const AnalyticsPoint center = {(rect.x0 + rect.x1) * 0.5f, (rect.y0 + rect.y1) * 0.5f};
+        if (boundary)
+          zones[r * columns_ + c].push_back(entry);
+        else if (point_in_polygon(polygon, center))
+          zones[r * columns_ + c].push_back(entry | 1);
+      }
+    }
+  }
+
+  line_offsets_.resize(n_cells + 1);
+  zone_offsets_.resize(n_cells + 1);
+  for (int c = 0; c < n_cells; c++) {
+    line_items_.insert(line_items_.end(), lines[c].begin(), lines[c].end());
+    zone_items_.insert(zone_items_.end(), zones[c].begin(), zones[c].end());
+    line_offsets_[c + 1] = static_cast<uint32_t>(line_items_.size());
+    zone_offsets_[c + 1] = static_cast<uint32_t>(zone_items_.size());
+  }
+}
+
+bool RoiAnalytics::cell_of(AnalyticsPoint p, int* column, int* row) const {
+  const float cx = std::floor((p.x - origin_x_) / cell_);
+  const float cy = std::floor((p.y - origin_y_) / cell_);
+  if (!(cx >= 0.0f && cx < columns_ && cy >= 0.0f && cy < rows_))
+    return false;
+  *column = static_cast<int>(cx);
+  *row = static_cast<int>(cy);
+  return true;
+}
+
+int RoiAnalytics::find_zones(AnalyticsPoint p, int32_t class_id, int32_t* zones, int max) {
+  int column, row;
+  if (!cell_of(p, &column, &row))
+    return 0;
+
+  const int cell = row * columns_ + column;
+  int n = 0;
+  for (uint32_t k = zone_offsets_[cell]; k < zone_offsets_[cell + 1]; k++) {
+    const uint32_t entry = zone_items_[k];
+    const int32_t i = static_cast<int32_t>(entry >> 1);
+    const AnalyticsZone& zone = config_.zones[i];
+    if (!counts_class(zone.classes, class_id))
+      continue;
+    if ((entry & 1) || point_in_polygon(zone.polygon, p)) {
+      zone_counts_[i].occupancy++;
+      if (n < max)
+        zones[n++] = i;
+    }
+  }
+  return n;
+}
+
+void RoiAnalytics::cross_lines(const TrackState& track, AnalyticsPoint p,
+                               const DetectedObject& object, int index,
+                               std::vector<AnalyticsEvent>* events) {
+  const AnalyticsPoint q = track.last;
+  if (columns_ == 0 || (q.x == p.x && q.y == p.y))
+    return;
+
+  // Steps are short, so the cells around them hold few lines; a line seen
+  // in several of them is tested once.
+  if (++stamp_ == 0) {
+    std::fill(line_stamps_.begin(), line_stamps_.end(), 0);
+    stamp_ = 1;
+  }
+  int c0, c1, r0, r1;
+  if (!cell_span(std::min(p.x, q.x), std::max(p.x, q.x), origin_x_, cell_, columns_, &c0, &c1) ||
+      !cell_span(std::min(p.y, q.y), std::max(p.y, q.y), origin_y_, cell_, rows_, &r0, &r1))
+    return;
+
+  for (int r = r0; r <= r1; r++) {
+    for (int c = c0; c <= c1; c++) {
+      const int cell = r * columns_ + c;
+      for (uint32_t k = line_offsets_[cell]; k < line_offsets_[cell + 1]; k++) {
+        const int32_t i = line_items_[k];
+        if (line_stamps_[i] == stamp_)
+          continue;
+        line_stamps_[i] = stamp_;
+
+        const AnalyticsLine& line = config_.lines[i];
+        // An anchor on the line counts as being on its left, so touching
+        // it and going back is not a crossing.
+        const bool was_right = side(line.a, line.b, q) > 0.0f;
+        const bool is_right = side(line.a, line.b, p) > 0.0f;
+        if (was_right == is_right)
+          continue;
+        if (side(q, p, line.a) * side(q, p, line.b) > 0.0f)
+          continue;
+        if (!counts_class(line.classes, object.class_id))
+          continue;
+
+        const int32_t direction = is_right ? 1 : -1;
+        if ((line.direction == LineDirection::kPositive && direction < 0) ||
+            (line.direction == LineDirection::kNegative && direction > 0))
+          continue;
+        if (direction > 0)
+          line_counts_[i].in++;
+        else
+          line_counts_[i].out++;
+        events->push_back(
+            {AnalyticsEventType::kLineCrossed, i, object.track_id, index, direction, 0});
+      }
+    }
+  }
+}
+
+void RoiAnalytics::update_zones(TrackState* track, const int32_t* zones, int n_zones,
+                                const DetectedObject& object, int index, uint64_t time,
+                                std::vector<AnalyticsEvent>* events) {
+  TrackState next;
+  next.n_zones = n_zones;
+
+  for (int k = 0; k < track->n_zones; k++) {
+    const int32_t zone = track->zones[k];
+    if (std::find(zones, zones + n_zones, zone) == zones + n_zones) {
+      zone_counts_[zone].out++;
+      events->push_back({AnalyticsEventType::kZoneExited, zone, object.track_id, index, 0,
+                         time - track->entered[k]});
+    }
+  }
+
+  for (int k = 0; k < n_zones; k++) {
+    const int32_t zone = zones[k];
+    const int32_t* prev = std::find(track->zones, track->zones + track->n_zones, zone);
+    next.zones[k] = zone;
+    if (prev == track->zones + track->n_zones) {
+      zone_counts_[zone].in++;
+      events->push_back(
+          {AnalyticsEventType::kZoneEntered, zone, object.track_id, index, 0, 0});
+      next.entered[k] = time;
+      next.dwelled[k] = false;
+      continue;
+    }
+
+    const int j = static_cast<int>(prev - track->zones);
+    const uint64_t threshold = config_.zones[zone].dwell_threshold;
+    next.entered[k] = track->entered[j];
+    next.dwelled[k] = track->dwelled[j];
+    if (threshold > 0 && !next.dwelled[k] && time - next.entered[k] >= threshold) {
+      next.dwelled[k] = true;
+      events->push_back({AnalyticsEventType::kDwell, zone, object.track_id, index, 0,
+                         time - next.entered[k]});
+    }
+  }
+
+  track->n_zones = next.n_zones;
+  std::copy(next.zones, next.zones + n_zones, track->zones);
+  std::copy(next.entered, next.entered + n_zones, track->entered);
+  std::copy(next.dwelled, next.dwelled + n_zones, track->dwelled);
+}
+
+void RoiAnalytics::expire(uint64_t time, std::vector<AnalyticsEvent>* events) {
+  for (auto it = tracks_.begin(); it != tracks_.end();) {
+    const TrackState& track = it->second;
+    if (time < track.seen || time - track.seen <= config_.track_timeout) {
+      ++it;
+      continue;
+    }
+    for (int k = 0; k < track.n_zones; k++) {
+      zone_counts_[track.zones[k]].out++;
+      events->push_back({AnalyticsEventType::kZoneExited, track.zones[k], it->first, -1, 0,
+                         track.seen - track.entered[k]});
+    }
+    it = tracks_.erase(it);
+  }
+}
+
+void RoiAnalytics::update(const DetectedObject* const* objects, int n, uint64_t time,
+                          std::vector<AnalyticsEvent>* events) {
+  int32_t zones[kMaxTrackZones];
+
+  for (AnalyticsCount& count : zone_counts_)
+    count.occupancy = 0;
+
+  for (int i = 0; i < n; i++) {
+    const DetectedObject& object = *objects[i];
+    const AnalyticsPoint p = anchor_of(object, config_.anchor);
+    const int n_zones = find_zones(p, object.class_id, zones,
+                                   object.track_id == kNoTrack ? 0 : kMaxTrackZones);
+    if (object.track_id == kNoTrack)
+      continue;
+
+    auto [it, added] = tracks_.try_emplace(object.track_id);
+    TrackState& track = it->second;
+    if (!added)
+      cross_lines(track, p, object, i, events);
+    update_zones(&track, zones, n_zones, object, i, time, events);
+    track.last = p;
+    track.seen = time;
+  }
+
+  expire(time, events);
+}
+
+}  // namespace nvgst
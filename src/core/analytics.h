@@ -0,0 +1,179 @@
+// Line crossing, zone occupancy and dwell time over tracked objects.
+//
+// Lines and zones are fixed per configuration, so configure() files them
+// into a uniform grid over the area they cover: each cell lists the lines
+// passing through it and the zones overlapping it, and marks the zones
+// that cover the whole cell so objects there need no polygon test. An
+// object is only tested against the entries of the cells it touches, which
+// keeps the cost per object flat however many zones a scene has.
+//
+// Each object is reduced to one anchor point of its box. A track crosses a
+// line when the step from its previous anchor to the current one cuts the
+// line, and enters or leaves a zone when its anchor does. Objects without
+// a track id only add to occupancy.
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/objects.h"
+
+namespace nvgst {
+
+// Zones a track can be inside at once; further overlapping zones still
+// count it in their occupancy but raise no events for it.
+constexpr int kMaxTrackZones = 16;
+
+struct AnalyticsPoint {
+  float x = 0.0f;
+  float y = 0.0f;
+};
+
+// Which crossings a line reports. Positive crossings end on the right of
+// a -> b as seen on screen (y down), negative ones on its left.
+enum class LineDirection {
+  kBoth,
+  kPositive,
+  kNegative,
+};
+
+struct AnalyticsLine {
+  std::string name;
+  AnalyticsPoint a;
+  AnalyticsPoint b;
+  LineDirection direction = LineDirection::kBoth;
+  // Class ids counted; empty counts every class.
+  std::vector<int32_t> classes;
+};
+
+struct AnalyticsZone {
+  std::string name;
+  // At least 3 points; self-intersecting polygons use the even-odd rule.
+  std::vector<AnalyticsPoint> polygon;
+  // Time inside after which a dwell event is raised, once per visit; 0
+  // raises none.
+  uint64_t dwell_threshold = 0;
+  std::vector<int32_t> classes;
+};
+
+enum class AnalyticsAnchor {
+  // Where the object stands: right for people and vehicles seen from above
+  // at an angle.
+  kBottomCenter,
+  kCenter,
+};
+
+struct AnalyticsConfig {
+  std::vector<AnalyticsLine> lines;
+  std::vector<AnalyticsZone> zones;
+  AnalyticsAnchor anchor = AnalyticsAnchor::kBottomCenter;
+  // Grid cell side in pixels; grown when the grid would get too large.
+  float cell_size = 64.0f;
+  // Times are in the caller's unit; the default assumes nanoseconds.
+  // Tracks not seen for this long leave their zones.
+  uint64_t track_timeout = 2000000000;
+};
+
+enum class AnalyticsEventType {
+  kLineCrossed,
+  kZoneEntered,
+  kZoneExited,
+  kDwell,
+};
+
+struct AnalyticsEvent {
+  AnalyticsEventType type;
+  // Index into the configured lines or zones, after the type.
+  int32_t roi;
+  uint64_t track_id;
+  // Index of the object in the array passed to update(); -1 on exits of
+  // tracks that timed out.
+  int32_t object;
+  // Lines: +1 for positive crossings, -1 for negative ones.
+  int32_t direction;
+  // Exits and dwell: time since the track entered the zone.
+  uint64_t duration;
+};
+
+struct AnalyticsCount {
+  // Zones: objects inside on the last frame.
+  uint32_t occupancy = 0;
+  // Lines: positive and negative crossings. Zones: entries and exits.
+  uint64_t in = 0;
+  uint64_t out = 0;
+};
+
+// One stream's analytics. Not thread-safe.
+class RoiAnalytics {
+ public:
+  // Fails on degenerate lines, zones with fewer than 3 points or a bad
+  // cell size. Drops tracks and counts.
+  bool configure(const AnalyticsConfig& config);
+  const AnalyticsConfig& config() const { return config_; }
+
+  // Forgets tracks and counts.
+  void reset();
+  // Forgets tracks but keeps the counts, for when timestamps jump. Zones
+  // lose their tracks without exit events.
+  void clear_tracks() { tracks_.clear(); }
+
+  // Evaluates one frame's objects at time, appending its events. Tracks
+  // not seen for track_timeout leave their zones at the end.
+  void update(const DetectedObject* const* objects, int n, uint64_t time,
+              std::vector<AnalyticsEvent>* events);
+
+  // Per configured line and zone, in order.
+  const std::vector<AnalyticsCount>& line_counts() const { return line_counts_; }
+  const std::vector<AnalyticsCount>& zone_counts() const { return zone_counts_; }
+
+  int n_tracks() const { return static_cast<int>(tracks_.size()); }
+
+ private:
+  struct TrackState {
+    AnalyticsPoint last;
+    uint64_t seen = 0;
+    int n_zones = 0;
+    int32_t zones[kMaxTrackZones];
+    uint64_t entered[kMaxTrackZones];
+    bool dwelled[kMaxTrackZones];
+  };
+
+  void build_grid();
+  bool cell_of(AnalyticsPoint p, int* column, int* row) const;
+  // Adds the object at p to the occupancy of the zones containing it that
+  // count class_id and writes the first max of them to zones.
+  int find_zones(AnalyticsPoint p, int32_t class_id, int32_t* zones, int max);
+  void cross_lines(const TrackState& track, AnalyticsPoint p, const DetectedObject& object,
+                   int index, std::vector<AnalyticsEvent>* events);
+  void update_zones(TrackState* track, const int32_t* zones, int n_zones,
+                    const DetectedObject& object, int index, uint64_t time,
+                    std::vector<AnalyticsEvent>* events);
+  void expire(uint64_t time, std::vector<AnalyticsEvent>* events);
+
+  AnalyticsConfig config_;
+  std::vector<AnalyticsCount> line_counts_;
+  std::vector<AnalyticsCount> zone_counts_;
+
+  // Grid over the bounding box of all lines and zones. Cell entries are
+  // stored compressed: the lines of cell c are line_items_[line_offsets_[c]]
+  // up to line_offsets_[c + 1], and the same for zones, whose entries are
+  // zone << 1 | 1 when the zone covers the whole cell.
+  float origin_x_ = 0.0f;
+  float origin_y_ = 0.0f;
+  float cell_ = 64.0f;
+  int columns_ = 0;
+  int rows_ = 0;
+  std::vector<uint32_t> line_offsets_;
+  std::vector<int32_t> line_items_;
+  std::vector<uint32_t> zone_offsets_;
+  std::vector<uint32_t> zone_items_;
+  // Lines already tested for the current step, by stamp.
+  std::vector<uint32_t> line_stamps_;
+  uint32_t stamp_ = 0;
+
+  std::unordered_map<uint64_t, TrackState> tracks_;
+};
+
+}  // namespace nvgst
@@ -0,0 +1,211 @@
+#include "core/assignment.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace nvgst {
+
+int AssignmentSolver::solve(const float* score, int rows, int cols, float min_score,
+                            AssignmentMethod method, int* row_match) {
+  std::fill(row_match, row_match + rows, -1);
+  if (rows <= 0 || cols <= 0)
+    return 0;
+
+  find_components(score, rows, cols, min_score);
+  col_taken_.assign(cols, 0);
+
+  const int n_comps = static_cast<int>(row_start_.size()) - 1;
+  for (int k = 0; k < n_comps; k++) {
+    const int* r = comp_rows_.data() + row_start_[k];
+    const int* c = comp_cols_.data() + col_start_[k];
+    const int nr = row_start_[k + 1] - row_start_[k];
+    const int nc = col_start_[k + 1] - col_start_[k];
+    if (nr == 1 && nc == 1)
+      row_match[r[0]] = c[0];
+    else if (method == AssignmentMethod::kHungarian)
+      solve_hungarian(score, cols, min_score, r, nr, c, nc, row_match);
+    else
+      solve_greedy(score, cols, r, nr, row_match);
+  }
+
+  int matched = 0;
+  for (int i = 0; i < rows; i++)
+    matched += row_match[i] >= 0;
+  return matched;
+}
+
+// Collects the feasible pairs in one pass over the matrix, then walks
+// them depth first. Rows and columns without any feasible pair belong to
+// no component and stay unmatched.
+void AssignmentSolver::find_components(const float* score, int rows, int cols, float min_score) {
+  row_offset_.resize(rows + 1);
+  row_edges_.clear();
+  col_offset_.assign(cols + 1, 0);
+  for (int r = 0; r < rows; r++) {
+    row_offset_[r] = static_cast<int>(row_edges_.size());
+    const float* row = score + static_cast<size_t>(r) * cols;
+    for (int c = 0; c < cols; c++) {
+      if (row[c] >= min_score) {
+        row_edges_.push_back(c);
+        col_offset_[c + 1]++;
+      }
+    }
+  }
+  row_offset_[rows] = static_cast<int>(row_edges_.size());
+  for (int c = 0; c < cols; c++)
+    col_offset_[c + 1] += col_offset_[c];
+  col_edges_.resize(row_edges_.size());
+  stack_.assign(col_offset_.begin(), col_offset_.end() - 1);
+  for (int r = 0; r < rows; r++) {
+    for (int e = row_offset_[r]; e < row_offset_[r + 1]; e++)
+      col_edges_[stack_[row_edges_[e]]++] = r;
+  }
+
+  row_comp_.assign(rows, -1);
+  col_comp_.assign(cols, -1);
+  comp_rows_.clear();
+  comp_cols_.clear();
+  row_start_.assign(1, 0);
+  col_start_.assign(1, 0);
+
+  int n_comps = 0;
+  for (int seed = 0; seed < rows; seed++) {
+    if (row_comp_[seed] >= 0 || row_offset_[seed] == row_offset_[seed + 1])
+      continue;
+
+    row_comp_[seed] = n_comps;
+    comp_rows_.push_back(seed);
+    stack_.assign(1, seed);
+    while (!stack_.empty()) {
+      const int node = stack_.back();
+      stack_.pop_back();
+      if (node < rows) {
+        for (int e = row_offset_[node]; e < row_offset_[node + 1]; e++) {
+          const int c = row_edges_[e];
+          if (col_comp_[c] < 0) {
+            col_comp_[c] = n_comps;
+            comp_cols_.push_back(c);
+            stack_.push_back(rows + c);
+          }
+        }
+      } else {
+        const int c = node - rows;
+        for (int e = col_offset_[c]; e < col_offset_[c + 1]; e++) {
+          const int r = col_edges_[e];
+          if (row_comp_[r] < 0) {
+            row_comp_[r] = n_comps;
+            comp_rows_.push_back(r);
+            stack_.push_back(r);
+          }
+        }
+      }
+    }
+    row_start_.push_back(static_cast<int>(comp_rows_.size()));
+    col_start_.push_back(static_cast<int>(comp_cols_.size()));
+    n_comps++;
+  }
+}
+
+// Minimizes the sum of -score over an n x m cost matrix with n <= m
+// (transposing the component when it has more rows than columns).
+// Infeasible pairs cost 0, the same as leaving both sides unmatched, and
+// are dropped from the result.
+void AssignmentSolver::solve_hungarian(const float* score, int cols, float min_score,
+                                       const int* comp_rows, int n_rows, const int* comp_cols,
+                                       int n_cols, int* row_match) {
+  const bool transposed = n_rows > n_cols;
+  const int n = transposed ? n_cols : n_rows;
+  const int m = transposed ? n_rows : n_cols;
+
+  cost_.resize(static_cast<size_t>(n) * m);
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < m; j++) {
+      const int r = comp_rows[transposed ? j : i];
+      const int c = comp_cols[transposed ? i : j];
+      const float v = score[static_cast<size_t>(r) * cols + c];
+      cost_[static_cast<size_t>(i) * m + j] = v >= min_score ? -v : 0.0f;
+    }
+  }
+
+  constexpr double kInf = std::numeric_limits<double>::infinity();
+  u_.assign(n + 1, 0.0);
+  v_.assign(m + 1, 0.0);
+  p_.assign(m + 1, 0);
+  way_.assign(m + 1, 0);
+  for (int i = 1; i <= n; i++) {
+    p_[0] = i;
+    int j0 = 0;
+    minv_.assign(m + 1, kInf);
+    used_.assign(m + 1, 0);
+    do {
+      used_[j0] = 1;
+      const int i0 = p_[j0];
+      const float* a = cost_.data() + static_cast<size_t>(i0 - 1) * m - 1;
+      double delta = kInf;
+      int j1 = 0;
+      for (int j = 1; j <= m; j++) {
+        if (used_[j])
+          continue;
+        const double cur = a[j] - u_[i0] - v_[j];
+        if (cur < minv_[j]) {
+          minv_[j] = cur;
+          way_[j] = j0;
+        }
+        if (minv_[j] < delta) {
+          delta = minv_[j];
+          j1 = j;
+        }
+      }
+      for (int j = 0; j <= m; j++) {
+        if (used_[j]) {
+          u_[p_[j]] += delta;
+          v_[j] -= delta;
+        } else {
+          minv_[j] -= delta;
+        }
+      }
+      j0 = j1;
+    } while (p_[j0] != 0);
+    do {
+      const int j1 = way_[j0];
+      p_[j0] = p_[j1];
+      j0 = j1;
+    } while (j0 != 0);
+  }
+
+  for (int j = 1; j <= m; j++) {
+    if (p_[j] == 0)
+      continue;
+    const int i = p_[j] - 1;
+    const int r = comp_rows[transposed ? j - 1 : i];
+    const int c = comp_cols[transposed ? i : j - 1];
+    if (score[static_cast<size_t>(r) * cols + c] >= min_score)
+      row_match[r] = c;
+  }
+}
+
+void AssignmentSolver::solve_greedy(const float* score, int cols, const int* comp_rows,
+                                    int n_rows, int* row_match) {
+  pairs_.clear();
+  for (int i = 0; i < n_rows; i++) {
+    const int r = comp_rows[i];
+    for (int e = row_offset_[r]; e < row_offset_[r + 1]; e++) {
+      const int c = row_edges_[e];
+      pairs_.push_back({score[static_cast<size_t>(r) * cols + c], r, c});
+    }
+  }
+  std::sort(pairs_.begin(), pairs_.end(), [](const Pair& a, const Pair& b) {
+    if (a.score != b.score)
+      return a.score > b.score;
+    return a.row != b.row ? a.row < b.row : a.col < b.col;
+  });
+
+  for (const Pair& pair : pairs_) {
+    if (row_match[pair.row] >= 0 || col_taken_[pair.col])
+      continue;
+    row_match[pair.row] = pair.col;
+    col_taken_[pair.col] = 1;
+  }
+}
+
+}  // namespace nvgst
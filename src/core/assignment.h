@@ -0,0 +1,74 @@
+// Rectangular assignment between rows and columns of a score matrix, as
+// used by the tracker to pair detections with tracks. Pairs scoring below
+// a threshold are never matched, so the feasible pairs form a sparse
+// bipartite graph; it is split into connected components and each one is
+// solved on its own, which turns the usual crowd of isolated one-to-one
+// pairs into a copy and keeps the Hungarian solver on small matrices.
+//
+// All scratch arrays are members and only grow, so a solver kept across
+// frames does not allocate once it has seen its largest frame.
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace nvgst {
+
+enum class AssignmentMethod {
+  // Maximum total score over the feasible pairs of each component.
+  kHungarian,
+  // Highest scoring free pair first; ties go to the lower row, then column.
+  kGreedy,
+};
+
+class AssignmentSolver {
+ public:
+  // score is rows x cols, row-major, higher is better. Writes the matched
+  // column of each row to row_match (-1 when unmatched) and returns the
+  // number of matches. Only pairs with score >= min_score are matched.
+  int solve(const float* score, int rows, int cols, float min_score, AssignmentMethod method,
+            int* row_match);
+
+ private:
+  void find_components(const float* score, int rows, int cols, float min_score);
+  void solve_hungarian(const float* score, int cols, float min_score, const int* comp_rows,
+                       int n_rows, const int* comp_cols, int n_cols, int* row_match);
+  void solve_greedy(const float* score, int cols, const int* comp_rows, int n_rows,
+                    int* row_match);
+
+  // Feasible pairs by row and by column, compressed: the partners of row r
+  // are row_edges_[row_offset_[r] .. row_offset_[r + 1]).
+  std::vector<int> row_offset_;
+  std::vector<int> row_edges_;
+  std::vector<int> col_offset_;
+  std::vector<int> col_edges_;
+
+  // Components: rows and columns listed component by component, with the
+  // start of each component in both lists.
+  std::vector<int> row_comp_;
+  std::vector<int> col_comp_;
+  std::vector<int> comp_rows_;
+  std::vector<int> comp_cols_;
+  std::vector<int> row_start_;
+  std::vector<int> col_start_;
+  std::vector<int> stack_;
+
+  // Hungarian scratch, 1-based as in the classic O(n^2 m) formulation.
+  std::vector<float> cost_;
+  std::vector<double> u_;
+  std::vector<double> v_;
+  std::vector<double> minv_;
+  std::vector<int> p_;
+  std::vector<int> way_;
+  std::vector<uint8_t> used_;
+
+  struct Pair {
+    float score;
+    int row;
+    int col;
+  };
+  std::vector<Pair> pairs_;
+  std::vector<uint8_t> col_taken_;
+};
+
+}  // namespace nvgst
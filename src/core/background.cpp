@@ -0,0 +1,215 @@
+#include "core/background.h"
+
+#include <algorithm>
+
+namespace nvgst {
+
+namespace {
+
+// Rows one uint16_t accumulator can sum without overflow.
+constexpr int kMaxBlockRows = 257;
+
+// Variances in squared 8-bit levels: new components start wide, and
+// learned ones stay within a range that keeps sensor noise background
+// and the Q4 planes in int16.
+constexpr float kInitVar = 15.0f * 15.0f;
+constexpr float kMinVar = 2.0f * 2.0f;
+constexpr float kMaxVar = 40.0f * 40.0f;
+
+}  // namespace
+
+bool BackgroundSubtractor::configure(const BackgroundConfig& config) {
+  if (config.width <= 0 || config.height <= 0)
+    return false;
+  if (config.scale < 1 || config.scale >= kMaxBlockRows)
+    return false;
+  if (!(config.learning_rate > 0.0f && config.learning_rate <= 1.0f))
+    return false;
+  if (!(config.threshold > 0.0f) || !(config.background_weight >= 0.0f) ||
+      config.background_weight > 1.0f || config.min_area < 0)
+    return false;
+
+  int channels;
+  int pixel_stride;
+  switch (config.format) {
+    case PixelFormat::kNV12:
+    case PixelFormat::kI420:
+      channels = 1;
+      pixel_stride = 1;
+      break;
+    case PixelFormat::kRGBA:
+    case PixelFormat::kBGRx:
+      channels = 3;
+      pixel_stride = 4;
+      break;
+    default:
+      return false;
+  }
+
+  const int model_width = (config.width + config.scale - 1) / config.scale;
+  const int model_height = (config.height + config.scale - 1) / config.scale;
+  if (model_width != model_width_ || model_height != model_height_ ||
+      config.format != config_.format || config.width != config_.width ||
+      config.height != config_.height)
+    reset();
+
+  config_ = config;
+  kernels_ = &simd::kernels(config.simd);
+  model_width_ = model_width;
+  model_height_ = model_height;
+  channels_ = channels;
+  pixel_stride_ = pixel_stride;
+
+  params_.alpha = config.learning_rate;
+  params_.threshold = config.threshold * config.threshold;
+  params_.init_var = kInitVar;
+  params_.min_var = kMinVar;
+  params_.max_var = kMaxVar;
+  params_.background_weight = config.background_weight;
+
+  x_edge_.resize(model_width + 1);
+  for (int i = 0; i <= model_width; i++)
+    x_edge_[i] = std::min(i * config.scale, config.width);
+  y_edge_.resize(model_height + 1);
+  for (int i = 0; i <= model_height; i++)
+    y_edge_[i] = std::min(i * config.scale, config.height);
+
+  const size_t n = static_cast<size_t>(model_width) * model_height;
+  acc_.resize(static_cast<size_t>(config.width) * pixel_stride);
+  thumb_.resize(n);
+  mask_.resize(n);
+  model_.resize(3 * simd::kMixtureComponents * n);
+  return true;
+}
+
+void BackgroundSubtractor::reset() {
+  have_model_ = false;
+}
+
+void BackgroundSubtractor::downscale(const FrameView& frame) {
+  const int row_bytes = config_.width * pixel_stride_;
+  for (int ty = 0; ty < model_height_; ty++) {
+    std::fill(acc_.begin(), acc_.end(), 0);
+    for (int y = y_edge_[ty]; y < y_edge_[ty + 1]; y++)
+      kernels_->accumulate_row(frame.data[0] + static_cast<size_t>(y) * frame.stride[0],
+                               acc_.data(), row_bytes);
+
+    const int rows = y_edge_[ty + 1] - y_edge_[ty];
+    uint8_t* dst = thumb_.data() + static_cast<size_t>(ty) * model_width_;
+    for (int tx = 0; tx < model_width_; tx++) {
+      uint32_t sum = 0;
+      for (int x = x_edge_[tx]; x < x_edge_[tx + 1]; x++) {
+        const uint16_t* px = acc_.data() + x * pixel_stride_;
+        for (int c = 0; c < channels_; c++)
+          sum += px[c];
+      }
+      const uint32_t count =
+          static_cast<uint32_t>((x_edge_[tx + 1] - x_edge_[tx]) * rows * channels_);
+      dst[tx] = static_cast<uint8_t>((sum + count / 2) / count);
+    }
+  }
+}
+
+uint32_t BackgroundSubtractor::find(uint32_t label) {
+  while (parent_[label] != label) {
+    parent_[label] = parent_[parent_[label]];
+    label = parent_[label];
+  }
+  return label;
+}
+
+void BackgroundSubtractor::label(std::vector<ForegroundBlob>* blobs) {
+  runs_.clear();
+  parent_.clear();
+
+  // Runs of each row, joined to the runs of the row above they touch,
+  // diagonals included.
+  size_t above_begin = 0;
+  size_t above_end = 0;
+  for (int y = 0; y < model_height_; y++) {
+    const uint8_t* row = mask_.data() + static_cast<size_t>(y) * model_width_;
+    const size_t row_begin = runs_.size();
+    size_t above = above_begin;
+    int x = 0;
+    while (x < model_width_) {
+      if (row[x] == 0) {
+        x++;
+        continue;
+      }
+      const int x0 = x;
+      while (x < model_width_ && row[x] != 0)
+        x++;
+
+      const uint32_t label = static_cast<uint32_t>(parent_.size());
+      parent_.push_back(label);
+      runs_.push_back({x0, x, y, label});
+
+      while (above < above_end && runs_[above].x1 < x0)
+        above++;
+      for (size_t a = above; a < above_end && runs_[a].x0 <= x; a++) {
+        const uint32_t root_a = find(runs_[a].label);
+        const uint32_t root_b = find(label);
+        if (root_a != root_b)
+          parent_[std::max(root_a, root_b)] = std::min(root_a, root_b);
+      }
+    }
+    above_begin = row_begin;
+    above_end = runs_.size();
+  }
+
+  // Roots are the smallest label of their blob, so blobs come out in
+  // raster order of their first run.
+  stats_.resize(parent_.size());
+  for (const Run& run : runs_) {
+    const uint32_t root = find(run.label);
+    BlobStats& s = stats_[root];
+    if (root == run.label) {
+      s = {run.x0, run.y, run.x1, run.y + 1, 0};
+    } else {
+      s.x0 = std::min(s.x0, run.x0);
+      s.x1 = std::max(s.x1, run.x1);
+      s.y1 = run.y + 1;
+    }
+    s.area += run.x1 - run.x0;
+  }
+
+  blobs->clear();
+  for (const Run& run : runs_) {
+    if (find(run.label) != run.label)
+      continue;
+    const BlobStats& s = stats_[run.label];
+    ForegroundBlob blob{x_edge_[s.x0], y_edge_[s.y0], x_edge_[s.x1], y_edge_[s.y1], 0};
+    blob.area = s.area * config_.scale * config_.scale;
+    if (blob.area >= config_.min_area)
+      blobs->push_back(blob);
+  }
+}
+
+void BackgroundSubtractor::update(const FrameView& frame, std::vector<ForegroundBlob>* blobs) {
+  const int n = model_width_ * model_height_;
+  const size_t plane = static_cast<size_t>(n);
+  downscale(frame);
+
+  if (!have_model_) {
+    // The first frame is the background: one component per pixel at full
+    // weight, the others empty.
+    std::fill(model_.begin(), model_.end(), 0);
+    for (int k = 0; k < simd::kMixtureComponents; k++) {
+      std::fill_n(model_.data() + (3 * k + 1) * plane, n,
+                  static_cast<int16_t>(kInitVar * simd::kMixtureVarScale));
+    }
+    for (int i = 0; i < n; i++)
+      model_[i] = static_cast<int16_t>(thumb_[i] * simd::kMixtureMeanScale);
+    std::fill_n(model_.data() + 2 * plane, n,
+                static_cast<int16_t>(simd::kMixtureWeightScale));
+    std::fill(mask_.begin(), mask_.end(), 0);
+    have_model_ = true;
+    blobs->clear();
+    return;
+  }
+
+  kernels_->mixture_update(thumb_.data(), model_.data(), plane, mask_.data(), n, params_);
+  label(blobs);
+}
+
+}  // namespace nvgst
@@ -0,0 +1,27 @@
+// Layout of a contiguous batch: max_frames frame slots of one format and
+// size, each slot aligned so every frame keeps kFrameAlign plane alignment.
+#pragma once
+
+#include "core/frame.h"
+
+namespace nvgst {
+
+struct BatchLayout {
+  FrameLayout frame;
+  size_t slot_size = 0;
+  int max_frames = 0;
+  size_t size = 0;
+
+  size_t slot_offset(int index) const { return slot_size * static_cast<size_t>(index); }
+};
+
+inline BatchLayout make_batch_layout(PixelFormat format, int width, int height, int max_frames) {
+  BatchLayout layout;
+  layout.frame = make_frame_layout(format, width, height);
+  layout.slot_size = align_up(layout.frame.size, static_cast<size_t>(kFrameAlign));
+  layout.max_frames = max_frames;
+  layout.size = layout.slot_size * static_cast<size_t>(max_frames);
+  return layout;
+}
+
+}  // namespace nvgst
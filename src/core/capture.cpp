@@ -0,0 +1,387 @@
+#include "core/capture.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+namespace nvgst {
+namespace {
+
+constexpr char kFileMagic[8] = {'N', 'V', 'G', 'S', 'T', 'C', 'A', 'P'};
+constexpr char kTrailerMagic[8] = {'N', 'V', 'G', 'S', 'T', 'I', 'D', 'X'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kRecordMagic = 0x4352564e;  // "NVRC"
+constexpr size_t kBlockAlign = 16;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint64_t reserved[6];
+};
+
+struct RecordHeader {
+  uint32_t magic;
+  uint32_t kind;
+  // Whole record, header included; a multiple of kCaptureAlign.
+  uint64_t size;
+  uint64_t pts;
+  uint64_t dts;
+  uint64_t duration;
+  uint64_t offset;
+  uint64_t offset_end;
+  uint32_t flags;
+  uint32_t n_blocks;
+};
+
+struct BlockHeader {
+  uint32_t type;
+  uint32_t reserved;
+  uint64_t size;
+};
+
+struct Trailer {
+  char magic[8];
+  uint64_t index_offset;
+  uint64_t records;
+  uint64_t reserved[5];
+};
+
+static_assert(sizeof(FileHeader) == kCaptureAlign, "file header layout");
+static_assert(sizeof(RecordHeader) == kCaptureAlign, "record header layout");
+static_assert(sizeof(BlockHeader) == kBlockAlign, "block header layout");
+static_assert(sizeof(Trailer) == kCaptureAlign, "trailer layout");
+static_assert(sizeof(CaptureIndexEntry) == 40, "index entry layout");
+
+size_t align_up(size_t n, size_t align) { return (n + align - 1) / align * align; }
+
+void append(std::vector<uint8_t>* bytes, const void* data, size_t size) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  bytes->insert(bytes->end(), p, p + size);
+}
+
+void append_block(std::vector<uint8_t>* bytes, uint32_t type, uint64_t size) {
+  const BlockHeader header = {type, 0, size};
+  append(bytes, &header, sizeof(header));
+}
+
+}  // namespace
+
+uint8_t* CaptureBlocks::add(uint32_t type, size_t size) {
+  append_block(&bytes_, type, size);
+  const size_t at = bytes_.size();
+  bytes_.resize(at + align_up(size, kBlockAlign), 0);
+  count_++;
+  return bytes_.data() + at;
+}
+
+void CaptureBlocks::add(uint32_t type, const void* data, size_t size) {
+  if (size > 0)
+    memcpy(add(type, size), data, size);
+  else
+    add(type, 0);
+}
+
+// Every chunk handed to the RecordWriter: bytes owned here, or the caller's
+// token for bytes written from where they are.
+struct CaptureWriter::Token {
+  RecordTokenRelease release;
+  void* user;
+  std::vector<uint8_t> bytes;
+};
+
+void CaptureWriter::release_token(void* token) {
+  Token* owned = static_cast<Token*>(token);
+  if (owned->user != nullptr)
+    owned->release(owned->user);
+  delete owned;
+}
+
+bool CaptureWriter::open(const std::string& path, bool use_uring) {
+  close();
+
+  // The writer thread opens the file again; creating it here reports a bad
+  // path to the caller instead of at close().
+  const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (fd < 0)
+    return false;
+  ::close(fd);
+
+  error_ = 0;
+  writer_.reset(new RecordWriter(release_token));
+  writer_->start(
+      [this](const RecordWriter::FileResult& result) {
+        if (error_ == 0)
+          error_ = result.error;
+      },
+      use_uring);
+  writer_->open(0, path);
+  open_ = true;
+
+  FileHeader header = {};
+  memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+  header.version = kVersion;
+  header.header_size = sizeof(FileHeader);
+  std::vector<uint8_t> bytes;
+  append(&bytes, &header, sizeof(header));
+  offset_ = 0;
+  index_.clear();
+  queue(&bytes);
+  return true;
+}
+
+void CaptureWriter::queue(std::vector<uint8_t>* bytes) {
+  Token* token = new Token{release_, nullptr, std::move(*bytes)};
+  offset_ += token->bytes.size();
+  writer_->write({token->bytes.data(), token->bytes.size(), token});
+}
+
+bool CaptureWriter::write(const CaptureRecordInfo& info, const CaptureBlocks& blocks,
+                          const Segment* segments, size_t n_segments) {
+  if (!open_)
+    return false;
+
+  // The owned bytes before, between and after the segments.
+  std::vector<std::vector<uint8_t>> parts(n_segments + 1);
+  RecordHeader header = {};
+  append(&parts[0], &header, sizeof(header));
+  append(&parts[0], blocks.bytes().data(), blocks.bytes().size());
+  uint32_t n_blocks = blocks.count();
+  size_t size = parts[0].size();
+
+  for (size_t i = 0; i < n_segments; i++) {
+    std::vector<uint8_t>& part = parts[i];
+    size_t at = size - part.size();
+    if (i > 0) {
+      // The previous segment's tail up to the block alignment.
+      part.resize(align_up(size, kBlockAlign) - size, 0);
+      size += part.size();
+    }
+    // A pad block moves the data block's payload to the next 64 bytes.
+    const size_t gap = align_up(size + sizeof(BlockHeader), kCaptureAlign) -
+                       sizeof(BlockHeader) - size;
+    if (gap > 0) {
+      append_block(&part, kCapturePadBlock, gap - sizeof(BlockHeader));
+      part.resize(part.size() + gap - sizeof(BlockHeader), 0);
+      n_blocks++;
+    }
+    append_block(&part, kCaptureDataBlock, segments[i].size);
+    n_blocks++;
+    size = at + part.size() + segments[i].size;
+  }
+  const size_t tail = align_up(size, kCaptureAlign) - size;
+  parts[n_segments].resize(parts[n_segments].size() + tail, 0);
+  size += tail;
+
+  const uint64_t limit = max_backlog_;
+  const uint64_t level = writer_->backlog();
+  if (limit != 0 && level > 0 && level + size > limit)
+    return false;
+
+  header.magic = kRecordMagic;
+  header.kind = static_cast<uint32_t>(info.kind);
+  header.size = size;
+  header.pts = info.pts;
+  header.dts = info.dts;
+  header.duration = info.duration;
+  header.offset = info.offset;
+  header.offset_end = info.offset_end;
+  header.flags = info.flags;
+  header.n_blocks = n_blocks;
+  memcpy(parts[0].data(), &header, sizeof(header));
+
+  index_.push_back({offset_, size, info.pts, info.duration, header.kind, info.flags});
+  for (size_t i = 0; i < n_segments; i++) {
+    queue(&parts[i]);
+    Token* token = new Token{release_, segments[i].token, {}};
+    offset_ += segments[i].size;
+    writer_->write({segments[i].data, segments[i].size, token});
+  }
+  queue(&parts[n_segments]);
+  return true;
+}
+
+int CaptureWriter::close() {
+  if (!open_)
+    return error_;
+
+  std::vector<uint8_t> bytes;
+  Trailer trailer = {};
+  memcpy(trailer.magic, kTrailerMagic, sizeof(kTrailerMagic));
+  trailer.index_offset = offset_;
+  trailer.records = index_.size();
+  append(&bytes, index_.data(), index_.size() * sizeof(CaptureIndexEntry));
+  append(&bytes, &trailer, sizeof(trailer));
+  queue(&bytes);
+
+  writer_->close();
+  writer_->stop();
+  writer_.reset();
+  open_ = false;
+  return error_;
+}
+
+bool CaptureReader::open(const std::string& path, bool populate, std::string* error) {
+  close();
+
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    *error = path + ": " + strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+    ::close(fd);
+    *error = path + ": not a capture file";
+    return false;
+  }
+  const size_t size = static_cast<size_t>(st.st_size);
+  void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED | (populate ? MAP_POPULATE : 0), fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    *error = path + ": " + strerror(errno);
+    return false;
+  }
+  data_ = static_cast<uint8_t*>(data);
+  size_ = size;
+
+  const FileHeader* header = reinterpret_cast<const FileHeader*>(data_);
+  if (memcmp(header->magic, kFileMagic, sizeof(kFileMagic)) != 0 ||
+      header->version != kVersion || header->header_size != sizeof(FileHeader)) {
+    close();
+    *error = path + ": not a capture file, or of another version";
+    return false;
+  }
+  if (!populate)
+    madvise(data_, size_, MADV_SEQUENTIAL);
+
+  complete_ = load_index();
+  if (!complete_)
+    rebuild_index();
+  for (size_t i = 0; i < index_.size(); i++) {
+    if (index_[i].kind == static_cast<uint32_t>(CaptureRecordKind::kCaps))
+      caps_.push_back(i);
+  }
+  return true;
+}
+
+void CaptureReader::close() {
+  if (data_ != nullptr)
+    munmap(data_, size_);
+  data_ = nullptr;
+  size_ = 0;
+  complete_ = false;
+  index_.clear();
+  caps_.clear();
+}
+
+bool CaptureReader::load_index() {
+  if (size_ < sizeof(FileHeader) + sizeof(Trailer))
+    return false;
+  const Trailer* trailer = reinterpret_cast<const Trailer*>(data_ + size_ - sizeof(Trailer));
+  if (memcmp(trailer->magic, kTrailerMagic, sizeof(kTrailerMagic)) != 0)
+    return false;
+  const uint64_t end = size_ - sizeof(Trailer);
+  if (trailer->index_offset < sizeof(FileHeader) || trailer->index_offset > end ||
+      trailer->records != (end - trailer->index_offset) / sizeof(CaptureIndexEntry) ||
+      (end - trailer->index_offset) % sizeof(CaptureIndexEntry) != 0)
+    return false;
+
+  const CaptureIndexEntry* entries =
+      reinterpret_cast<const CaptureIndexEntry*>(data_ + trailer->index_offset);
+  for (uint64_t i = 0; i < trailer->records; i++) {
+    // A damaged index must not point read() outside the records.
+    const CaptureIndexEntry& entry = entries[i];
+    if (entry.offset < sizeof(FileHeader) || entry.offset > trailer->index_offset ||
+        entry.size < sizeof(RecordHeader) || entry.size > trailer->index_offset - entry.offset) {
+      index_.clear();
+      return false;
+    }
+    index_.push_back(entry);
+  }
+  return true;
+}
+
+void CaptureReader::rebuild_index() {
+  index_.clear();
+  for (size_t at = sizeof(FileHeader); at + sizeof(RecordHeader) <= size_;) {
+    const RecordHeader* header = reinterpret_cast<const RecordHeader*>(data_ + at);
+    if (header->magic != kRecordMagic || header->size < sizeof(RecordHeader) ||
+        header->size % kCaptureAlign != 0 || header->size > size_ - at)
+      break;
+    index_.push_back({at, header->size, header->pts, header->duration, header->kind,
+                      header->flags});
+    at += header->size;
+  }
+}
+
+bool CaptureReader::read(size_t i, CaptureRecord* record) const {
+  const CaptureIndexEntry& entry = index_[i];
+  const RecordHeader* header = reinterpret_cast<const RecordHeader*>(data_ + entry.offset);
+  if (header->magic != kRecordMagic || header->size != entry.size)
+    return false;
+
+  record->info.kind = static_cast<CaptureRecordKind>(header->kind);
+  record->info.flags = header->flags;
+  record->info.pts = header->pts;
+  record->info.dts = header->dts;
+  record->info.duration = header->duration;
+  record->info.offset = header->offset;
+  record->info.offset_end = header->offset_end;
+  record->offset = entry.offset;
+  record->blocks.clear();
+
+  const uint64_t end = entry.offset + entry.size;
+  uint64_t at = entry.offset + sizeof(RecordHeader);
+  for (uint32_t b = 0; b < header->n_blocks; b++) {
+    at = align_up(at, kBlockAlign);
+    if (at + sizeof(BlockHeader) > end)
+      return false;
+    const BlockHeader* block = reinterpret_cast<const BlockHeader*>(data_ + at);
+    at += sizeof(BlockHeader);
+    if (block->size > end - at)
+      return false;
+    if (block->type != kCapturePadBlock)
+      record->blocks.push_back({block->type, data_ + at, static_cast<size_t>(block->size)});
+    at += block->size;
+  }
+  return true;
+}
+
+size_t CaptureReader::seek(uint64_t pts) const {
+  for (size_t i = 0; i < index_.size(); i++) {
+    const CaptureIndexEntry& entry = index_[i];
+    if (entry.kind == static_cast<uint32_t>(CaptureRecordKind::kBuffer) &&
+        entry.pts != UINT64_MAX && entry.pts >= pts)
+      return i;
+  }
+  return index_.size();
+}
+
+long CaptureReader::caps_before(size_t i) const {
+  long found = -1;
+  for (size_t caps : caps_) {
+    if (caps > i)
+      break;
+    found = static_cast<long>(caps);
+  }
+  return found;
+}
+
+void CaptureReader::prefetch(size_t first, size_t count) const {
+  if (first >= index_.size() || count == 0)
+    return;
+  const size_t last = std::min(first + count, index_.size()) - 1;
+  const long page = sysconf(_SC_PAGESIZE);
+  const size_t begin = index_[first].offset / page * page;
+  const size_t end = index_[last].offset + index_[last].size;
+  madvise(data_ + begin, end - begin, MADV_WILLNEED);
+}
+
+}  // namespace nvgst
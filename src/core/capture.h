@@ -0,0 +1,198 @@
+// Capture files: raw buffers and their metadata, laid out so that a reader
+// can replay them straight from a read-only mapping of the file. A file is
+// a header, one record per buffer or caps change, an index of the records
+// and a trailer pointing at the index.
+//
+// A record is a 64-byte header and typed blocks. Blocks start on 16-byte
+// boundaries; data blocks (the buffer's bytes) start on 64-byte ones, with
+// pad blocks in between, so the mapped pages can be handed downstream as
+// buffer memory without copying and keep the alignment SIMD kernels want.
+// The container only knows data and pad blocks; callers number their own
+// from kCaptureUserBlock.
+//
+// CaptureWriter appends records through a RecordWriter thread: the record
+// header and inline blocks are copied, data blocks are written from where
+// they are and their tokens released afterwards. Everything is in host
+// byte order; a capture is meant to be replayed on the kind of machine that
+// wrote it. A file whose writer never finished (no trailer) is still
+// readable: the reader rebuilds the index by walking the records.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/record.h"
+
+namespace nvgst {
+
+constexpr size_t kCaptureAlign = 64;
+constexpr uint32_t kCapturePadBlock = 0;
+constexpr uint32_t kCaptureDataBlock = 1;
+constexpr uint32_t kCaptureUserBlock = 16;
+
+enum class CaptureRecordKind : uint32_t {
+  kBuffer = 1,
+  // Format change; applies to the buffer records after it.
+  kCaps = 2,
+};
+
+// Times are nanoseconds, UINT64_MAX when unset (GST_CLOCK_TIME_NONE).
+struct CaptureRecordInfo {
+  CaptureRecordKind kind = CaptureRecordKind::kBuffer;
+  uint32_t flags = 0;
+  uint64_t pts = UINT64_MAX;
+  uint64_t dts = UINT64_MAX;
+  uint64_t duration = UINT64_MAX;
+  uint64_t offset = UINT64_MAX;
+  uint64_t offset_end = UINT64_MAX;
+};
+
+// One record in the index at the end of the file.
+struct CaptureIndexEntry {
+  uint64_t offset;
+  uint64_t size;
+  uint64_t pts;
+  uint64_t duration;
+  uint32_t kind;
+  uint32_t flags;
+};
+
+// Inline blocks of one record, built by the caller and copied into it.
+class CaptureBlocks {
+ public:
+  // Appends a block of size bytes and returns its payload, zeroed, to be
+  // filled in before the next add().
+  uint8_t* add(uint32_t type, size_t size);
+  void add(uint32_t type, const void* data, size_t size);
+
+  void clear() {
+    bytes_.clear();
+    count_ = 0;
+  }
+  uint32_t count() const { return count_; }
+  const std::vector<uint8_t>& bytes() const { return bytes_; }
+
+ private:
+  std::vector<uint8_t> bytes_;
+  uint32_t count_ = 0;
+};
+
+// One producing thread.
+class CaptureWriter {
+ public:
+  // Bytes of a data block, written from where they are. The token goes to
+  // the release function once they are on disk or given up on.
+  struct Segment {
+    const void* data;
+    size_t size;
+    void* token;
+  };
+
+  explicit CaptureWriter(RecordTokenRelease release) : release_(release) {}
+  ~CaptureWriter() { close(); }
+
+  CaptureWriter(const CaptureWriter&) = delete;
+  CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+  // Creates (or truncates) path and writes the file header; false, with
+  // errno set, when it cannot be created. use_uring = false forces the
+  // pwritev path.
+  bool open(const std::string& path, bool use_uring = true);
+  bool is_open() const { return open_; }
+
+  // 0 = unlimited.
+  void set_max_backlog(uint64_t bytes) { max_backlog_ = bytes; }
+  uint64_t backlog() const { return writer_ ? writer_->backlog() : 0; }
+
+  // Appends a record of blocks followed by one data block per segment.
+  // False, keeping the tokens with the caller, when the record would take
+  // the backlog over the limit; nothing is queued then.
+  bool write(const CaptureRecordInfo& info, const CaptureBlocks& blocks,
+             const Segment* segments, size_t n_segments);
+
+  // Writes the index and trailer, then waits for every write. Returns the
+  // errno of the first failed write, 0 when the file is complete.
+  int close();
+
+  // Since open().
+  uint64_t records() const { return index_.size(); }
+  uint64_t bytes() const { return offset_; }
+
+ private:
+  struct Token;
+  static void release_token(void* token);
+  void queue(std::vector<uint8_t>* bytes);
+
+  RecordTokenRelease release_;
+  std::unique_ptr<RecordWriter> writer_;
+  bool open_ = false;
+  uint64_t max_backlog_ = 0;
+  uint64_t offset_ = 0;
+  std::vector<CaptureIndexEntry> index_;
+  int error_ = 0;
+};
+
+// A block of a record, pointing into the mapping.
+struct CaptureBlock {
+  uint32_t type;
+  const uint8_t* data;
+  size_t size;
+};
+
+struct CaptureRecord {
+  CaptureRecordInfo info;
+  // Offset of the record in the file.
+  uint64_t offset = 0;
+  std::vector<CaptureBlock> blocks;
+};
+
+// Read-only mapping of a capture file. Thread-safe once open.
+class CaptureReader {
+ public:
+  CaptureReader() = default;
+  ~CaptureReader() { close(); }
+
+  CaptureReader(const CaptureReader&) = delete;
+  CaptureReader& operator=(const CaptureReader&) = delete;
+
+  // Maps path and loads its index. With populate the whole file is read
+  // into memory up front, so that replay never waits for the disk.
+  bool open(const std::string& path, bool populate, std::string* error);
+  void close();
+
+  // Whether the file had its index; false when it was rebuilt.
+  bool complete() const { return complete_; }
+  size_t size() const { return index_.size(); }
+  const CaptureIndexEntry& entry(size_t i) const { return index_[i]; }
+
+  // Decodes record i; false when it is damaged.
+  bool read(size_t i, CaptureRecord* record) const;
+
+  // The first buffer record with a pts at or after pts (records without
+  // one are skipped over), size() when there is none.
+  size_t seek(uint64_t pts) const;
+  // The last caps record at or before i, or -1.
+  long caps_before(size_t i) const;
+
+  // Asks the kernel to read records [first, first + count) ahead.
+  void prefetch(size_t first, size_t count) const;
+
+  const uint8_t* data() const { return data_; }
+  size_t bytes() const { return size_; }
+
+ private:
+  bool load_index();
+  void rebuild_index();
+
+  uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  bool complete_ = false;
+  std::vector<CaptureIndexEntry> index_;
+  // Positions of the caps records in index_.
+  std::vector<size_t> caps_;
+};
+
+}  // namespace nvgst
@@ -0,0 +1,184 @@
+#include "core/convert.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace nvgst {
+
+namespace {
+
+inline uint8_t* row_ptr(const FrameView& f, int plane, int y) {
+  return f.data[plane] + static_cast<ptrdiff_t>(y) * f.stride[plane];
+}
+
+void copy_frame(const FrameView& src, const FrameView& dst) {
+  for (int p = 0; p < format_n_planes(src.format); p++) {
+    const int bytes = plane_width(src.format, p, src.width) * plane_pixel_stride(src.format, p);
+    const int rows = plane_height(src.format, p, src.height);
+    for (int y = 0; y < rows; y++)
+      std::memcpy(row_ptr(dst, p, y), row_ptr(src, p, y), bytes);
+  }
+}
+
+}  // namespace
+
+bool VideoConverter::configure(const ConvertConfig& config) {
+  if (format_n_planes(config.in_format) == 0 || format_n_planes(config.out_format) == 0)
+    return false;
+  if (config.in_width <= 0 || config.in_height <= 0 || config.out_width <= 0 ||
+      config.out_height <= 0)
+    return false;
+
+  config_ = config;
+  kernels_ = &simd::kernels(config.simd);
+  yuv_to_rgb_ = &simd::yuv_to_rgb_coeffs(config.matrix);
+  rgb_to_yuv_ = &simd::rgb_to_yuv_coeffs(config.matrix);
+
+  const int max_width = std::max(config.in_width, config.out_width);
+  chroma_row_stride_ = align_up((max_width + 1) / 2, kFrameAlign);
+  if (!chroma_rows_.reserve(2 * static_cast<size_t>(chroma_row_stride_)))
+    return false;
+
+  scaling_ = config.in_width != config.out_width || config.in_height != config.out_height;
+  if (!scaling_)
+    return true;
+
+  const bool convert = config.in_format != config.out_format;
+  scale_first_ = static_cast<int64_t>(config.out_width) * config.out_height <
+                 static_cast<int64_t>(config.in_width) * config.in_height;
+
+  // Scaling always happens in one format: the input format when scaling
+  // first, otherwise the output format.
+  const PixelFormat scale_format = scale_first_ ? config.in_format : config.out_format;
+  size_t scratch = 0;
+  for (int p = 0; p < format_n_planes(scale_format); p++) {
+    const int channels = plane_pixel_stride(scale_format, p);
+    if (!scalers_[p].configure(plane_width(scale_format, p, config.in_width),
+                               plane_height(scale_format, p, config.in_height),
+                               plane_width(scale_format, p, config.out_width),
+                               plane_height(scale_format, p, config.out_height), channels))
+      return false;
+    scratch = std::max(scratch, scalers_[p].scratch_size());
+  }
+  if (!scale_scratch_.reserve(scratch))
+    return false;
+
+  if (convert) {
+    tmp_layout_ = scale_first_
+                      ? make_frame_layout(config.in_format, config.out_width, config.out_height)
+                      : make_frame_layout(config.out_format, config.in_width, config.in_height);
+    if (!tmp_frame_.reserve(tmp_layout_.size))
+      return false;
+  } else {
+    tmp_frame_.reset();
+  }
+  return true;
+}
+
+bool VideoConverter::is_identity() const {
+  return config_.in_format == config_.out_format && !scaling_;
+}
+
+void VideoConverter::convert(const FrameView& src, const FrameView& dst) {
+  if (!scaling_) {
+    convert_color(src, dst);
+    return;
+  }
+  if (src.format == dst.format) {
+    scale(src, dst);
+    return;
+  }
+
+  FrameView tmp = make_frame_view(tmp_layout_, tmp_frame_.data());
+  if (scale_first_) {
+    scale(src, tmp);
+    convert_color(tmp, dst);
+  } else {
+    convert_color(src, tmp);
+    scale(tmp, dst);
+  }
+}
+
+void VideoConverter::scale(const FrameView& src, const FrameView& dst) {
+  for (int p = 0; p < format_n_planes(src.format); p++)
+    scalers_[p].scale_rows(src.data[p], src.stride[p], dst.data[p], dst.stride[p], 0,
+                           scalers_[p].dst_height(), scale_scratch_.data(), *kernels_);
+}
+
+void VideoConverter::convert_color(const FrameView& src, const FrameView& dst) {
+  const simd::Kernels& k = *kernels_;
+  const int width = src.width;
+  const int height = src.height;
+  const int cw = (width + 1) / 2;
+  const int ch = (height + 1) / 2;
+  uint8_t* u_row = chroma_rows_.data();
+  uint8_t* v_row = u_row + chroma_row_stride_;
+
+  if (src.format == dst.format) {
+    copy_frame(src, dst);
+    return;
+  }
+
+  const bool src_yuv = format_is_yuv(src.format);
+  const bool dst_yuv = format_is_yuv(dst.format);
+
+  if (src_yuv && dst_yuv) {
+    for (int y = 0; y < height; y++)
+      std::memcpy(row_ptr(dst, 0, y), row_ptr(src, 0, y), width);
+    for (int cy = 0; cy < ch; cy++) {
+      if (src.format == PixelFormat::kNV12)
+        k.split_uv_row(row_ptr(src, 1, cy), row_ptr(dst, 1, cy), row_ptr(dst, 2, cy), cw);
+      else
+        k.merge_uv_row(row_ptr(src, 1, cy), row_ptr(src, 2, cy), row_ptr(dst, 1, cy), cw);
+    }
+    return;
+  }
+
+  if (!src_yuv && !dst_yuv) {
+    // RGBA <-> BGRx: the formats differ, so red and blue always swap.
+    for (int y = 0; y < height; y++)
+      k.swizzle_rgb_row(row_ptr(src, 0, y), row_ptr(dst, 0, y), width, true);
+    return;
+  }
+
+  if (src_yuv) {
+    const bool bgr = dst.format == PixelFormat::kBGRx;
+    const bool nv12 = src.format == PixelFormat::kNV12;
+    for (int y = 0; y < height; y++) {
+      const int cy = y / 2;
+      const uint8_t* u = u_row;
+      const uint8_t* v = v_row;
+      if (!nv12) {
+        u = row_ptr(src, 1, cy);
+        v = row_ptr(src, 2, cy);
+      } else if ((y & 1) == 0) {
+        k.split_uv_row(row_ptr(src, 1, cy), u_row, v_row, cw);
+      }
+      k.yuv_to_rgb_row(row_ptr(src, 0, y), u, v, row_ptr(dst, 0, y), width, *yuv_to_rgb_, bgr);
+    }
+    return;
+  }
+
+  // RGB to YUV, one pair of luma rows and their chroma row at a time so the
+  // source rows are still in cache for the chroma pass.
+  const bool bgr = src.format == PixelFormat::kBGRx;
+  const bool nv12 = dst.format == PixelFormat::kNV12;
+  for (int cy = 0; cy < ch; cy++) {
+    const int y0 = 2 * cy;
+    const int y1 = y0 + 1 < height ? y0 + 1 : y0;
+    const uint8_t* row0 = row_ptr(src, 0, y0);
+    const uint8_t* row1 = row_ptr(src, 0, y1);
+    k.rgb_to_y_row(row0, row_ptr(dst, 0, y0), width, *rgb_to_yuv_, bgr);
+    if (y1 != y0)
+      k.rgb_to_y_row(row1, row_ptr(dst, 0, y1), width, *rgb_to_yuv_, bgr);
+    if (nv12) {
+      k.rgb_to_uv_row(row0, row1, u_row, v_row, width, *rgb_to_yuv_, bgr);
+      k.merge_uv_row(u_row, v_row, row_ptr(dst, 1, cy), cw);
+    } else {
+      k.rgb_to_uv_row(row0, row1, row_ptr(dst, 1, cy), row_ptr(dst, 2, cy), width, *rgb_to_yuv_,
+                      bgr);
+    }
+  }
+}
+
+}  // namespace nvgst
@@ -0,0 +1,62 @@
+// Colorspace conversion and scaling between NV12, I420, RGBA and BGRx.
+#pragma once
+
+#include "core/aligned_buffer.h"
+#include "core/frame.h"
+#include "core/kernels.h"
+#include "core/scaler.h"
+
+namespace nvgst {
+
+struct ConvertConfig {
+  PixelFormat in_format = PixelFormat::kUnknown;
+  int in_width = 0;
+  int in_height = 0;
+  PixelFormat out_format = PixelFormat::kUnknown;
+  int out_width = 0;
+  int out_height = 0;
+  ColorMatrix matrix = ColorMatrix::kBT601;
+  SimdLevel simd = SimdLevel::kAvx2;
+};
+
+// Converts frames for one fixed configuration. All scratch memory (chroma
+// rows and, when scaling and converting at once, an intermediate frame) is
+// allocated by configure(), so convert() never allocates.
+//
+// When both the format and the size change, scaling runs on whichever side
+// has fewer pixels so the more expensive step touches less data.
+//
+// Not thread-safe: one converter per streaming thread.
+class VideoConverter {
+ public:
+  bool configure(const ConvertConfig& config);
+
+  const ConvertConfig& config() const { return config_; }
+  SimdLevel simd_level() const { return kernels_->level; }
+
+  // True when the configuration is an identity and the caller can pass
+  // frames through untouched.
+  bool is_identity() const;
+
+  void convert(const FrameView& src, const FrameView& dst);
+
+ private:
+  void convert_color(const FrameView& src, const FrameView& dst);
+  void scale(const FrameView& src, const FrameView& dst);
+
+  ConvertConfig config_;
+  const simd::Kernels* kernels_ = &simd::kernels(SimdLevel::kScalar);
+  const simd::YuvToRgbCoeffs* yuv_to_rgb_ = nullptr;
+  const simd::RgbToYuvCoeffs* rgb_to_yuv_ = nullptr;
+
+  bool scaling_ = false;
+  bool scale_first_ = false;
+  PlaneScaler scalers_[3];
+  FrameLayout tmp_layout_;
+  AlignedBuffer tmp_frame_;
+  AlignedBuffer chroma_rows_;
+  AlignedBuffer scale_scratch_;
+  int chroma_row_stride_ = 0;
+};
+
+}  // namespace nvgst
@@ -0,0 +1,61 @@
+#include "core/cpu_features.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace nvgst {
+
+namespace {
+
+SimdLevel probe_cpu() {
+#if defined(NVGST_HAVE_X86_SIMD)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return SimdLevel::kAvx2;
+  if (__builtin_cpu_supports("sse4.1"))
+    return SimdLevel::kSse41;
+#endif
+  return SimdLevel::kScalar;
+}
+
+SimdLevel env_limit(SimdLevel detected) {
+  const char* env = std::getenv("NVGST_SIMD");
+  if (env == nullptr || *env == '\0')
+    return detected;
+
+  SimdLevel wanted = detected;
+  if (std::strcmp(env, "scalar") == 0)
+    wanted = SimdLevel::kScalar;
+  else if (std::strcmp(env, "sse4.1") == 0 || std::strcmp(env, "sse41") == 0)
+    wanted = SimdLevel::kSse41;
+  else if (std::strcmp(env, "avx2") == 0)
+    wanted = SimdLevel::kAvx2;
+
+  return wanted < detected ? wanted : detected;
+}
+
+}  // namespace
+
+SimdLevel detect_simd_level() {
+  static const SimdLevel level = env_limit(probe_cpu());
+  return level;
+}
+
+SimdLevel clamp_simd_level(SimdLevel requested) {
+  SimdLevel max = detect_simd_level();
+  return requested < max ? requested : max;
+}
+
+const char* simd_level_name(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::kAvx2:
+      return "avx2";
+    case SimdLevel::kSse41:
+      return "sse4.1";
+    case SimdLevel::kScalar:
+      break;
+  }
+  return "scalar";
+}
+
+}  // namespace nvgst
@@ -0,0 +1,22 @@
+// Runtime CPU feature detection used to pick SIMD kernel tables.
+#pragma once
+
+namespace nvgst {
+
+enum class SimdLevel {
+  kScalar = 0,
+  kSse41 = 1,
+  kAvx2 = 2,
+};
+
+// Highest level supported by both the CPU and this build. The result can be
+// lowered (never raised) with NVGST_SIMD=scalar|sse4.1|avx2 in the
+// environment, which is mostly useful for benchmarking the fallbacks.
+SimdLevel detect_simd_level();
+
+// Clamps a requested level to what detect_simd_level() allows.
+SimdLevel clamp_simd_level(SimdLevel requested);
+
+const char* simd_level_name(SimdLevel level);
+
+}  // namespace nvgst
@@ -0,0 +1,380 @@
+#include "core/dewarp.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace nvgst {
+
+namespace {
+
+// Output rows per task, even so that chroma rows split with luma rows.
+constexpr int kSliceRows = 16;
+
+constexpr char kCacheMagic[4] = {'N', 'V', 'D', 'W'};
+// Bump whenever the table contents change for the same configuration.
+constexpr uint32_t kCacheVersion = 1;
+
+struct CacheHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t key;
+  uint64_t count;
+};
+
+constexpr double kPi = 3.14159265358979323846;
+
+double radians(float degrees) {
+  return degrees * (kPi / 180.0);
+}
+
+// FNV-1a over the fields that determine the tables.
+class Hasher {
+ public:
+  template <typename T>
+  void add(const T& value) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+    for (size_t i = 0; i < sizeof(T); i++) {
+      hash_ ^= p[i];
+      hash_ *= 0x100000001b3ull;
+    }
+  }
+  uint64_t value() const { return hash_; }
+
+ private:
+  uint64_t hash_ = 0xcbf29ce484222325ull;
+};
+
+uint64_t table_key(const DewarpConfig& config, bool yuv) {
+  Hasher h;
+  h.add(kCacheVersion);
+  h.add(yuv);
+  h.add(config.width);
+  h.add(config.height);
+  h.add(static_cast<int>(config.projection));
+  h.add(config.lens_fov);
+  h.add(config.center_x);
+  h.add(config.center_y);
+  h.add(config.radius);
+  h.add(config.view_width);
+  h.add(config.view_height);
+  for (const DewarpView& view : config.views) {
+    h.add(view.pan);
+    h.add(view.tilt);
+    h.add(view.fov);
+  }
+  return h.value();
+}
+
+// Left (top) tap and Q8 weight for source coordinate s of a plane axis of
+// size samples, clamped so that both taps are inside.
+void make_tap(double s, int size, uint32_t* index, uint32_t* frac) {
+  s = std::min(std::max(s, 0.0), static_cast<double>(size - 1));
+  int i = std::min(static_cast<int>(s), size - 2);
+  int f = static_cast<int>(std::lround((s - i) * 256.0));
+  if (f >= 256) {
+    if (i < size - 2) {
+      i++;
+      f = 0;
+    } else {
+      f = 255;
+    }
+  }
+  *index = static_cast<uint32_t>(i);
+  *frac = static_cast<uint32_t>(f);
+}
+
+bool read_all(int fd, void* data, size_t size) {
+  uint8_t* p = static_cast<uint8_t*>(data);
+  while (size > 0) {
+    const ssize_t n = ::read(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+bool write_all(int fd, const void* data, size_t size) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  while (size > 0) {
+    const ssize_t n = ::write(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+}  // namespace
+
+bool Dewarper::configure(const DewarpConfig& config, const std::string& cache_dir,
+                         ThreadPool* pool) {
+  bool yuv;
+  switch (config.format) {
+    case PixelFormat::kNV12:
+    case PixelFormat::kI420:
+      yuv = true;
+      break;
+    case PixelFormat::kRGBA:
+    case PixelFormat::kBGRx:
+      yuv = false;
+      break;
+    default:
+      return false;
+  }
+  // Both taps of each axis inside every plane, coordinates in 16 bits.
+  const int min_size = yuv ? 4 : 2;
+  if (config.width < min_size || config.height < min_size || config.width > 65535 ||
+      config.height > 65535 || config.view_width <= 0 || config.view_height <= 0 ||
+      config.views.empty())
+    return false;
+  if (yuv && ((config.view_width | config.view_height) & 1))
+    return false;
+  for (const DewarpView& view : config.views) {
+    if (!(view.fov > 0.0f && view.fov < 180.0f))
+      return false;
+  }
+  if (config.projection == DewarpProjection::kFisheye &&
+      !(config.lens_fov > 0.0f && config.radius > 0.0f))
+    return false;
+
+  kernels_ = &simd::kernels(config.simd);
+  const uint64_t key = table_key(config, yuv);
+  if (key == key_ && !taps_.empty()) {
+    config_ = config;
+    return true;
+  }
+
+  config_ = config;
+  yuv_ = yuv;
+  key_ = key;
+  from_cache_ = false;
+
+  const size_t views = config.views.size();
+  size_t count = views * config.view_width * config.view_height;
+  if (yuv)
+    count += views * (config.view_width / 2) * (config.view_height / 2);
+  taps_.assign(count, 0);
+  frac_.assign(count, 0);
+
+  std::string path;
+  if (!cache_dir.empty()) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/dewarp-%016llx.lut",
+                  static_cast<unsigned long long>(key));
+    path = cache_dir + name;
+    if (load(path)) {
+      from_cache_ = true;
+      return true;
+    }
+  }
+
+  build(pool);
+  // A failed save only costs the next start the same build.
+  if (!path.empty())
+    save(path);
+  return true;
+}
+
+size_t Dewarper::table_bytes() const {
+  return taps_.size() * sizeof(uint32_t) + frac_.size() * sizeof(uint16_t);
+}
+
+bool Dewarper::load(const std::string& path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  CacheHeader header;
+  struct stat st;
+  const size_t count = taps_.size();
+  const size_t size = sizeof(header) + count * (sizeof(uint32_t) + sizeof(uint16_t));
+  bool ok = ::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == size &&
+            read_all(fd, &header, sizeof(header)) &&
+            std::memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) == 0 &&
+            header.version == kCacheVersion && header.key == key_ && header.count == count &&
+            read_all(fd, taps_.data(), count * sizeof(uint32_t)) &&
+            read_all(fd, frac_.data(), count * sizeof(uint16_t));
+  ::close(fd);
+  // A damaged file must not send remap_row outside the source.
+  return ok && taps_in_range();
+}
+
+bool Dewarper::taps_in_range() const {
+  const size_t luma = config_.views.size() * config_.view_width * config_.view_height;
+  for (size_t i = 0; i < taps_.size(); i++) {
+    const bool chroma = i >= luma;
+    const uint32_t width = chroma ? (config_.width + 1) / 2 : config_.width;
+    const uint32_t height = chroma ? (config_.height + 1) / 2 : config_.height;
+    if ((taps_[i] & 0xffff) > width - 2 || taps_[i] >> 16 > height - 2)
+      return false;
+  }
+  return true;
+}
+
+// Written under a temporary name and renamed, so concurrent starts never
+// read a partial file.
+bool Dewarper::save(const std::string& path) const {
+  const std::string tmp = path + ".tmp." + std::to_string(::getpid());
+  const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return false;
+
+  CacheHeader header;
+  std::memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+  header.version = kCacheVersion;
+  header.key = key_;
+  header.count = taps_.size();
+  bool ok = write_all(fd, &header, sizeof(header)) &&
+            write_all(fd, taps_.data(), taps_.size() * sizeof(uint32_t)) &&
+            write_all(fd, frac_.data(), frac_.size() * sizeof(uint16_t));
+  ok = ::close(fd) == 0 && ok;
+  if (ok)
+    ok = ::rename(tmp.c_str(), path.c_str()) == 0;
+  if (!ok)
+    ::unlink(tmp.c_str());
+  return ok;
+}
+
+void Dewarper::build(ThreadPool* pool) {
+  const int slices = (config_.view_height + kSliceRows - 1) / kSliceRows;
+  const int planes = yuv_ ? 2 : 1;
+  const int per_view = slices * planes;
+  pool->run(n_views() * per_view, [this, slices, per_view](int task, int) {
+    const int view = task / per_view;
+    const bool chroma = task % per_view >= slices;
+    const int y = task % slices * kSliceRows;
+    const int y_end = std::min(y + kSliceRows, config_.view_height);
+    if (chroma)
+      build_rows(view, true, y / 2, y_end / 2);
+    else
+      build_rows(view, false, y, y_end);
+  });
+}
+
+// Casts a ray through the center of every output sample, in luma pixels of
+// the view, and maps it into the source plane.
+void Dewarper::build_rows(int view, bool chroma, int y_begin, int y_end) {
+  const DewarpConfig& c = config_;
+  const DewarpView& v = c.views[view];
+  const int vw = chroma ? c.view_width / 2 : c.view_width;
+  const int vh = chroma ? c.view_height / 2 : c.view_height;
+  const int sw = chroma ? (c.width + 1) / 2 : c.width;
+  const int sh = chroma ? (c.height + 1) / 2 : c.height;
+  const double scale = chroma ? 0.5 : 1.0;
+
+  size_t base = static_cast<size_t>(view) * vw * vh;
+  if (chroma)
+    base += c.views.size() * c.view_width * c.view_height;
+  uint32_t* taps = taps_.data() + base;
+  uint16_t* frac = frac_.data() + base;
+
+  // View basis in source space: right, down and forward.
+  const double p = radians(v.pan);
+  const double t = radians(v.tilt);
+  const double sp = std::sin(p), cp = std::cos(p);
+  const double st = std::sin(t), ct = std::cos(t);
+  double r[3], d[3], f[3];
+  if (c.projection == DewarpProjection::kFisheye) {
+    // Lens frame: x right, y down on the image, z along the lens axis.
+    r[0] = -sp, r[1] = cp, r[2] = 0.0;
+    d[0] = -ct * cp, d[1] = -ct * sp, d[2] = st;
+    f[0] = st * cp, f[1] = st * sp, f[2] = ct;
+  } else {
+    // Sphere frame: x right, y down, z toward longitude 0.
+    r[0] = cp, r[1] = 0.0, r[2] = -sp;
+    d[0] = st * sp, d[1] = ct, d[2] = st * cp;
+    f[0] = ct * sp, f[1] = -st, f[2] = ct * cp;
+  }
+  const double focal = c.view_width / 2.0 / std::tan(radians(v.fov) / 2.0);
+
+  const double half_lens = radians(c.lens_fov) / 2.0;
+  const double radius = c.radius * std::min(c.width, c.height) / 2.0;
+  const double cx = c.center_x * c.width;
+  const double cy = c.center_y * c.height;
+
+  for (int y = y_begin; y < y_end; y++) {
+    const double py = (chroma ? 2.0 * y + 1.0 : y + 0.5) - c.view_height / 2.0;
+    for (int x = 0; x < vw; x++) {
+      const double px = (chroma ? 2.0 * x + 1.0 : x + 0.5) - c.view_width / 2.0;
+      const double dx = r[0] * px + d[0] * py + f[0] * focal;
+      const double dy = r[1] * px + d[1] * py + f[1] * focal;
+      const double dz = r[2] * px + d[2] * py + f[2] * focal;
+
+      double sx, sy;
+      if (c.projection == DewarpProjection::kFisheye) {
+        const double theta = std::atan2(std::hypot(dx, dy), dz);
+        const double phi = std::atan2(dy, dx);
+        const double rho = std::min(theta / half_lens, 1.0) * radius;
+        sx = cx + rho * std::cos(phi);
+        sy = cy + rho * std::sin(phi);
+      } else {
+        const double lon = std::atan2(dx, dz);
+        const double lat = std::atan2(-dy, std::hypot(dx, dz));
+        sx = (lon / (2.0 * kPi) + 0.5) * c.width;
+        sy = (0.5 - lat / kPi) * c.height;
+      }
+
+      uint32_t ix, iy, fx, fy;
+      make_tap(sx * scale - 0.5, sw, &ix, &fx);
+      make_tap(sy * scale - 0.5, sh, &iy, &fy);
+      const size_t i = static_cast<size_t>(y) * vw + x;
+      taps[i] = ix | iy << 16;
+      frac[i] = static_cast<uint16_t>(fx | fy << 8);
+    }
+  }
+}
+
+void Dewarper::run(const FrameView& src, const FrameView* views, ThreadPool* pool) {
+  if (taps_.empty())
+    return;
+  const int slices = (config_.view_height + kSliceRows - 1) / kSliceRows;
+  pool->run(n_views() * slices, [&](int task, int) {
+    const simd::Kernels& k = *kernels_;
+    const int view = task / slices;
+    const int y_begin = task % slices * kSliceRows;
+    const int y_end = std::min(y_begin + kSliceRows, config_.view_height);
+    const FrameView& dst = views[view];
+    const int vw = config_.view_width;
+    const size_t luma = static_cast<size_t>(view) * vw * config_.view_height;
+
+    const int bpp = yuv_ ? 1 : 4;
+    for (int y = y_begin; y < y_end; y++) {
+      const size_t i = luma + static_cast<size_t>(y) * vw;
+      k.remap_row(src.data[0], src.stride[0], taps_.data() + i, frac_.data() + i,
+                  dst.data[0] + static_cast<ptrdiff_t>(y) * dst.stride[0], vw, bpp);
+    }
+    if (!yuv_)
+      return;
+
+    const int cw = vw / 2;
+    const size_t chroma = config_.views.size() * vw * config_.view_height +
+                          static_cast<size_t>(view) * cw * (config_.view_height / 2);
+    for (int y = y_begin / 2; y < y_end / 2; y++) {
+      const size_t i = chroma + static_cast<size_t>(y) * cw;
+      if (config_.format == PixelFormat::kNV12) {
+        k.remap_row(src.data[1], src.stride[1], taps_.data() + i, frac_.data() + i,
+                    dst.data[1] + static_cast<ptrdiff_t>(y) * dst.stride[1], cw, 2);
+      } else {
+        for (int plane = 1; plane < 3; plane++)
+          k.remap_row(src.data[plane], src.stride[plane], taps_.data() + i, frac_.data() + i,
+                      dst.data[plane] + static_cast<ptrdiff_t>(y) * dst.stride[plane], cw, 1);
+      }
+    }
+  });
+}
+
+}  // namespace nvgst
@@ -0,0 +1,104 @@
+// Fisheye and equirectangular dewarping into perspective views.
+//
+// The projection is evaluated once per configuration, not per frame: for
+// every output sample a remap table holds the top-left source tap and the
+// Q8 bilinear weights, and each frame is then only Kernels::remap_row over
+// the tables, cut into slices of rows that run on a ThreadPool. 4:2:0
+// input gets a second table for the chroma planes at half resolution.
+//
+// Tables do not depend on strides, so they can be kept on disk: with a
+// cache directory, configure() loads the file for its configuration when
+// there is one and writes it otherwise.
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/frame.h"
+#include "core/kernels.h"
+#include "core/thread_pool.h"
+
+namespace nvgst {
+
+enum class DewarpProjection {
+  // Equidistant fisheye: the angle from the lens axis grows linearly with
+  // the distance from the image circle's center.
+  kFisheye,
+  // Full sphere, longitude across and latitude down the frame.
+  kEquirect,
+};
+
+// A perspective view, angles in degrees. For fisheye input pan turns
+// around the lens axis and tilt is the angle between the view's center and
+// the axis, with the lens axis pointing down on screen (ceiling mounts).
+// For equirectangular input pan is the longitude and tilt the latitude.
+struct DewarpView {
+  float pan = 0.0f;
+  float tilt = 0.0f;
+  // Horizontal field of view.
+  float fov = 90.0f;
+};
+
+struct DewarpConfig {
+  PixelFormat format = PixelFormat::kUnknown;
+  int width = 0;
+  int height = 0;
+  DewarpProjection projection = DewarpProjection::kFisheye;
+  // Fisheye lens: field of view across the image circle in degrees, circle
+  // center as a fraction of the frame size and radius as a fraction of
+  // half the shorter side. Directions outside the lens repeat its rim.
+  float lens_fov = 180.0f;
+  float center_x = 0.5f;
+  float center_y = 0.5f;
+  float radius = 1.0f;
+  // Size of every view; even for 4:2:0 formats.
+  int view_width = 640;
+  int view_height = 480;
+  std::vector<DewarpView> views;
+  SimdLevel simd = SimdLevel::kAvx2;
+};
+
+// Not thread-safe: one dewarper per streaming thread.
+class Dewarper {
+ public:
+  // Builds the remap tables on the pool's workers, or loads them from
+  // cache_dir (none when empty). Keeps the current tables when only the
+  // SIMD level changed. Fails on an unsupported format or geometry.
+  bool configure(const DewarpConfig& config, const std::string& cache_dir, ThreadPool* pool);
+  const DewarpConfig& config() const { return config_; }
+
+  int n_views() const { return static_cast<int>(config_.views.size()); }
+  // Whether the last configure() that built tables found them on disk.
+  bool from_cache() const { return from_cache_; }
+  // Bytes of remap tables held in memory.
+  size_t table_bytes() const;
+
+  // Writes view i to views[i], each view_width x view_height in the source
+  // format. src must match the configured format and size.
+  void run(const FrameView& src, const FrameView* views, ThreadPool* pool);
+
+ private:
+  bool load(const std::string& path);
+  // Whether every tap leaves room for its right and lower neighbours in
+  // its plane; weights are the two bytes of a frac entry, so any value is
+  // in range.
+  bool taps_in_range() const;
+  bool save(const std::string& path) const;
+  void build(ThreadPool* pool);
+  void build_rows(int view, bool chroma, int y_begin, int y_end);
+
+  DewarpConfig config_;
+  const simd::Kernels* kernels_ = &simd::kernels(SimdLevel::kScalar);
+  uint64_t key_ = 0;
+  bool yuv_ = false;
+  bool from_cache_ = false;
+
+  // Per view, view_width x view_height luma (or RGB) taps, then for 4:2:0
+  // input per view the chroma taps at half size. A tap is column | row << 16
+  // of its top-left source sample; frac holds the matching weights.
+  std::vector<uint32_t> taps_;
+  std::vector<uint16_t> frac_;
+};
+
+}  // namespace nvgst
@@ -0,0 +1,109 @@
+// Draw commands attached to frames by analytics elements and rendered by
+// nvosd. Header-only, so code outside the plugin can fill a list it got
+// through GstNvDrawMeta.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace nvgst {
+
+enum class DrawKind : uint8_t {
+  kRect,
+  kFilledRect,
+  kLine,
+  kText,
+};
+
+// Colors are 0xRRGGBBAA; an alpha of 0 draws nothing.
+struct DrawCommand {
+  DrawKind kind;
+  uint8_t thickness;   // rectangle outlines and lines
+  uint16_t font_size;  // text line height in pixels
+  uint32_t frame;      // frame index in a batch, 0 otherwise
+  // Rectangles span [x0, x1) x [y0, y1); lines run from (x0, y0) to
+  // (x1, y1); text starts with its top-left corner at (x0, y0).
+  int32_t x0, y0, x1, y1;
+  uint32_t color;
+  uint32_t background;  // box behind text
+  uint32_t text_offset;
+  uint32_t text_length;
+};
+
+class DrawList {
+ public:
+  void clear() {
+    commands_.clear();
+    text_.clear();
+  }
+
+  void reserve(size_t commands, size_t text_bytes = 0) {
+    commands_.reserve(commands);
+    text_.reserve(text_bytes);
+  }
+
+  void add_rect(uint32_t frame, int x, int y, int width, int height, uint32_t color,
+                int thickness = 2) {
+    push(DrawKind::kRect, frame, x, y, x + width, y + height, color, thickness);
+  }
+
+  void add_filled_rect(uint32_t frame, int x, int y, int width, int height, uint32_t color) {
+    push(DrawKind::kFilledRect, frame, x, y, x + width, y + height, color, 0);
+  }
+
+  void add_line(uint32_t frame, int x0, int y0, int x1, int y1, uint32_t color,
+                int thickness = 2) {
+    push(DrawKind::kLine, frame, x0, y0, x1, y1, color, thickness);
+  }
+
+  void add_text(uint32_t frame, int x, int y, const char* text, int font_size, uint32_t color,
+                uint32_t background = 0) {
+    DrawCommand& cmd = push(DrawKind::kText, frame, x, y, x, y, color, 0);
+    const size_t length = std::strlen(text);
+    cmd.font_size = static_cast<uint16_t>(font_size);
+    cmd.background = background;
+    cmd.text_offset = static_cast<uint32_t>(text_.size());
+    cmd.text_length = static_cast<uint32_t>(length);
+    text_.append(text, length);
+  }
+
+  // Appends all of other's commands.
+  void append(const DrawList& other) {
+    const uint32_t base = static_cast<uint32_t>(text_.size());
+    for (DrawCommand cmd : other.commands_) {
+      cmd.text_offset += base;
+      commands_.push_back(cmd);
+    }
+    text_ += other.text_;
+  }
+
+  const std::vector<DrawCommand>& commands() const { return commands_; }
+  size_t size() const { return commands_.size(); }
+  bool empty() const { return commands_.empty(); }
+  const char* text(const DrawCommand& cmd) const { return text_.data() + cmd.text_offset; }
+
+ private:
+  DrawCommand& push(DrawKind kind, uint32_t frame, int x0, int y0, int x1, int y1, uint32_t color,
+                    int thickness) {
+    DrawCommand cmd{};
+    cmd.kind = kind;
+    cmd.thickness = static_cast<uint8_t>(thickness < 1 ? 1 : (thickness > 255 ? 255 : thickness));
+    cmd.frame = frame;
+    cmd.x0 = x0;
+    cmd.y0 = y0;
+    cmd.x1 = x1;
+    cmd.y1 = y1;
+    cmd.color = color;
+    commands_.push_back(cmd);
+    return commands_.back();
+  }
+
+  std::vector<DrawCommand> commands_;
+  // Text of all commands back to back, not NUL-separated.
+  std::string text_;
+};
+
+}  // namespace nvgst
@@ -0,0 +1,98 @@
+#include "core/frame.h"
+
+namespace nvgst {
+
+int format_n_planes(PixelFormat format) {
+  switch (format) {
+    case PixelFormat::kNV12:
+      return 2;
+    case PixelFormat::kI420:
+      return 3;
+    case PixelFormat::kRGBA:
+    case PixelFormat::kBGRx:
+      return 1;
+    case PixelFormat::kUnknown:
+      break;
+  }
+  return 0;
+}
+
+bool format_is_yuv(PixelFormat format) {
+  return format == PixelFormat::kNV12 || format == PixelFormat::kI420;
+}
+
+const char* format_name(PixelFormat format) {
+  switch (format) {
+    case PixelFormat::kNV12:
+      return "NV12";
+    case PixelFormat::kI420:
+      return "I420";
+    case PixelFormat::kRGBA:
+      return "RGBA";
+    case PixelFormat::kBGRx:
+      return "BGRx";
+    case PixelFormat::kUnknown:
+      break;
+  }
+  return "unknown";
+}
+
+int plane_width(PixelFormat format, int plane, int width) {
+  if (format_is_yuv(format) && plane > 0)
+    return (width + 1) / 2;
+  return width;
+}
+
+int plane_height(PixelFormat format, int plane, int height) {
+  if (format_is_yuv(format) && plane > 0)
+    return (height + 1) / 2;
+  return height;
+}
+
+int plane_pixel_stride(PixelFormat format, int plane) {
+  switch (format) {
+    case PixelFormat::kNV12:
+      return plane == 0 ? 1 : 2;
+    case PixelFormat::kI420:
+      return 1;
+    case PixelFormat::kRGBA:
+    case PixelFormat::kBGRx:
+      return 4;
+    case PixelFormat::kUnknown:
+      break;
+  }
+  return 0;
+}
+
+FrameLayout make_frame_layout(PixelFormat format, int width, int height, int align) {
+  FrameLayout layout;
+  layout.format = format;
+  layout.width = width;
+  layout.height = height;
+  layout.n_planes = format_n_planes(format);
+
+  size_t offset = 0;
+  for (int p = 0; p < layout.n_planes; p++) {
+    int row_bytes = plane_width(format, p, width) * plane_pixel_stride(format, p);
+    layout.stride[p] = align_up(row_bytes, align);
+    layout.offset[p] = offset;
+    offset += align_up(static_cast<size_t>(layout.stride[p]) * plane_height(format, p, height),
+                       static_cast<size_t>(align));
+  }
+  layout.size = offset;
+  return layout;
+}
+
+FrameView make_frame_view(const FrameLayout& layout, uint8_t* base) {
+  FrameView view;
+  view.format = layout.format;
+  view.width = layout.width;
+  view.height = layout.height;
+  for (int p = 0; p < layout.n_planes; p++) {
+    view.data[p] = base + layout.offset[p];
+    view.stride[p] = layout.stride[p];
+  }
+  return view;
+}
+
+}  // namespace nvgst
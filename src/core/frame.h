@@ -0,0 +1,69 @@
+// Plain views over raw video frames, shared by all CPU kernels.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace nvgst {
+
+enum class PixelFormat {
+  kUnknown = 0,
+  kNV12,
+  kI420,
+  kRGBA,
+  kBGRx,
+};
+
+enum class ColorMatrix {
+  kBT601,
+  kBT709,
+};
+
+// Alignment used for pooled frames and scratch rows. 64 bytes covers a
+// cache line and an AVX2 register pair.
+constexpr int kFrameAlign = 64;
+
+inline int align_up(int value, int align) {
+  return (value + align - 1) / align * align;
+}
+
+inline size_t align_up(size_t value, size_t align) {
+  return (value + align - 1) / align * align;
+}
+
+int format_n_planes(PixelFormat format);
+bool format_is_yuv(PixelFormat format);
+const char* format_name(PixelFormat format);
+
+// Width and height of a plane in samples (not bytes).
+int plane_width(PixelFormat format, int plane, int width);
+int plane_height(PixelFormat format, int plane, int height);
+// Bytes per sample for a plane (2 for interleaved NV12 chroma, 4 for RGB).
+int plane_pixel_stride(PixelFormat format, int plane);
+
+// Describes the memory layout of one frame. Offsets are relative to the
+// start of a single contiguous allocation.
+struct FrameLayout {
+  PixelFormat format = PixelFormat::kUnknown;
+  int width = 0;
+  int height = 0;
+  int n_planes = 0;
+  int stride[3] = {0, 0, 0};
+  size_t offset[3] = {0, 0, 0};
+  size_t size = 0;
+};
+
+// Computes a layout whose plane strides and offsets are multiples of align.
+FrameLayout make_frame_layout(PixelFormat format, int width, int height, int align = kFrameAlign);
+
+struct FrameView {
+  PixelFormat format = PixelFormat::kUnknown;
+  int width = 0;
+  int height = 0;
+  uint8_t* data[3] = {nullptr, nullptr, nullptr};
+  int stride[3] = {0, 0, 0};
+};
+
+FrameView make_frame_view(const FrameLayout& layout, uint8_t* base);
+
+}  // namespace nvgst
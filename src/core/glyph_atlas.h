@@ -0,0 +1,73 @@
+// Anti-aliased coverage masks for the built-in 5x9 bitmap font, rasterized
+// once per text size and then reused for every label on every frame.
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace nvgst {
+
+// Glyphs for one line height. Every printable ASCII character gets a cell
+// of cell_width() x height() coverage bytes (0 = transparent, 255 = fully
+// covered); characters outside that range are drawn as '?'.
+class GlyphAtlas {
+ public:
+  static constexpr int kMinSize = 6;
+  static constexpr int kMaxSize = 256;
+
+  // Columns of a cell row that have any coverage, [begin, end); empty rows
+  // have begin == end.
+  struct RowExtent {
+    uint16_t begin;
+    uint16_t end;
+  };
+
+  struct Glyph {
+    const uint8_t* coverage;  // height() rows of cell_width() bytes
+    const RowExtent* rows;
+  };
+
+  // size is the line height in pixels, clamped to [kMinSize, kMaxSize].
+  explicit GlyphAtlas(int size);
+
+  int height() const { return height_; }
+  int cell_width() const { return cell_width_; }
+  int text_width(int length) const { return length * cell_width_; }
+
+  Glyph glyph(char c) const;
+
+ private:
+  int height_ = 0;
+  int cell_width_ = 0;
+  std::vector<uint8_t> coverage_;
+  std::vector<RowExtent> rows_;
+};
+
+// Atlases for the sizes in use, keeping the most recently used few.
+class GlyphCache {
+ public:
+  explicit GlyphCache(size_t capacity = 8) : capacity_(capacity) {}
+
+  // Never drops an atlas, so everything returned stays valid until the
+  // next trim().
+  const GlyphAtlas& get(int size);
+
+  // Drops the least recently used atlases beyond capacity.
+  void trim();
+
+  void clear() { entries_.clear(); }
+
+ private:
+  struct Entry {
+    int size;
+    uint64_t last_use;
+    std::unique_ptr<GlyphAtlas> atlas;
+  };
+
+  size_t capacity_;
+  uint64_t clock_ = 0;
+  std::vector<Entry> entries_;
+};
+
+}  // namespace nvgst
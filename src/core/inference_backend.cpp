@@ -0,0 +1,186 @@
+#include "core/inference_backend.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+namespace nvgst {
+
+namespace {
+
+struct ConvLayer {
+  int in_channels;
+  int out_channels;
+  int in_size;  // square input
+  int out_size;
+  const float* weights;  // [out][in][3][3]
+  const float* bias;
+};
+
+constexpr int kConv1Channels = 8;
+constexpr int kConv2Channels = 16;
+
+constexpr size_t conv_weight_count(int in, int out) {
+  return static_cast<size_t>(out) * in * 9 + out;
+}
+
+// 3x3, stride 2, zero padding 1, followed by ReLU. The tap loops are
+// outermost so the inner loop is a plain multiply-add over an output row.
+void conv3x3s2_relu(const ConvLayer& layer, const float* in, float* out) {
+  const int n = layer.in_size;
+  const int m = layer.out_size;
+  for (int oc = 0; oc < layer.out_channels; oc++) {
+    float* dst = out + static_cast<size_t>(oc) * m * m;
+    std::fill(dst, dst + static_cast<size_t>(m) * m, layer.bias[oc]);
+    for (int ic = 0; ic < layer.in_channels; ic++) {
+      const float* src = in + static_cast<size_t>(ic) * n * n;
+      const float* w = layer.weights + (static_cast<size_t>(oc) * layer.in_channels + ic) * 9;
+      for (int ky = 0; ky < 3; ky++) {
+        // Output rows and columns whose tap lands inside the input.
+        const int y_begin = ky == 0 ? 1 : 0;
+        const int y_end = std::min(m, (n - ky) / 2 + 1);
+        for (int kx = 0; kx < 3; kx++) {
+          const float wv = w[ky * 3 + kx];
+          const int x_begin = kx == 0 ? 1 : 0;
+          const int x_end = std::min(m, (n - kx) / 2 + 1);
+          for (int oy = y_begin; oy < y_end; oy++) {
+            const float* s = src + static_cast<size_t>(2 * oy + ky - 1) * n + kx - 1;
+            float* d = dst + static_cast<size_t>(oy) * m;
+            for (int ox = x_begin; ox < x_end; ox++)
+              d[ox] += wv * s[2 * ox];
+          }
+        }
+      }
+    }
+    for (int i = 0; i < m * m; i++)
+      dst[i] = std::max(dst[i], 0.0f);
+  }
+}
+
+class ReferenceBackend : public InferenceBackend {
+ public:
+  bool load(const std::string& model, std::string* error) override {
+    weights_.resize(reference_weight_count());
+    if (model.empty()) {
+      init_weights();
+    } else if (!read_weights(model, error)) {
+      return false;
+    }
+
+    const float* w = weights_.data();
+    conv1_ = {3, kConv1Channels, kReferenceSize, kReferenceSize / 2, w,
+              w + kConv1Channels * 3 * 9};
+    w += conv_weight_count(3, kConv1Channels);
+    conv2_ = {kConv1Channels, kConv2Channels, kReferenceSize / 2, kReferenceSize / 4, w,
+              w + kConv2Channels * kConv1Channels * 9};
+    w += conv_weight_count(kConv1Channels, kConv2Channels);
+    fc_weights_ = w;
+    fc_bias_ = w + kReferenceClasses * kConv2Channels;
+
+    input_ = {"image", {3, kReferenceSize, kReferenceSize}};
+    outputs_ = {{"logits", {kReferenceClasses}}};
+    act1_.resize(static_cast<size_t>(kConv1Channels) * conv1_.out_size * conv1_.out_size);
+    act2_.resize(static_cast<size_t>(kConv2Channels) * conv2_.out_size * conv2_.out_size);
+    return true;
+  }
+
+  const TensorInfo& input() const override { return input_; }
+  const std::vector<TensorInfo>& outputs() const override { return outputs_; }
+
+  bool infer(const float* input, int batch, float* const* outputs) override {
+    const size_t in_count = input_.count();
+    const int area = conv2_.out_size * conv2_.out_size;
+    for (int b = 0; b < batch; b++) {
+      conv3x3s2_relu(conv1_, input + b * in_count, act1_.data());
+      conv3x3s2_relu(conv2_, act1_.data(), act2_.data());
+
+      float pooled[kConv2Channels];
+      for (int c = 0; c < kConv2Channels; c++) {
+        const float* a = act2_.data() + static_cast<size_t>(c) * area;
+        float sum = 0.0f;
+        for (int i = 0; i < area; i++)
+          sum += a[i];
+        pooled[c] = sum / static_cast<float>(area);
+      }
+
+      float* logits = outputs[0] + static_cast<size_t>(b) * kReferenceClasses;
+      for (int k = 0; k < kReferenceClasses; k++) {
+        const float* w = fc_weights_ + k * kConv2Channels;
+        float sum = fc_bias_[k];
+        for (int c = 0; c < kConv2Channels; c++)
+          sum += w[c] * pooled[c];
+        logits[k] = sum;
+      }
+    }
+    return true;
+  }
+
+ private:
+  // He-style uniform weights from a fixed xorshift sequence, so every
+  // instance computes the same function.
+  void init_weights() {
+    uint32_t state = 0x9e3779b9u;
+    auto next = [&state] {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      return static_cast<float>(state) / 4294967296.0f * 2.0f - 1.0f;
+    };
+    auto fill = [&next](float* w, size_t count, int fan_in) {
+      const float limit = std::sqrt(6.0f / static_cast<float>(fan_in));
+      for (size_t i = 0; i < count; i++)
+        w[i] = next() * limit;
+    };
+
+    float* w = weights_.data();
+    fill(w, kConv1Channels * 3 * 9, 3 * 9);
+    std::fill_n(w + kConv1Channels * 3 * 9, kConv1Channels, 0.01f);
+    w += conv_weight_count(3, kConv1Channels);
+    fill(w, kConv2Channels * kConv1Channels * 9, kConv1Channels * 9);
+    std::fill_n(w + kConv2Channels * kConv1Channels * 9, kConv2Channels, 0.01f);
+    w += conv_weight_count(kConv1Channels, kConv2Channels);
+    fill(w, kReferenceClasses * kConv2Channels, kConv2Channels);
+    std::fill_n(w + kReferenceClasses * kConv2Channels, kReferenceClasses, 0.0f);
+  }
+
+  bool read_weights(const std::string& path, std::string* error) {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (f == nullptr) {
+      *error = "cannot open " + path;
+      return false;
+    }
+    const size_t read = std::fread(weights_.data(), sizeof(float), weights_.size() + 1, f);
+    std::fclose(f);
+    if (read != weights_.size()) {
+      *error = path + ": expected " + std::to_string(weights_.size()) + " float32 weights";
+      return false;
+    }
+    return true;
+  }
+
+  std::vector<float> weights_;
+  ConvLayer conv1_;
+  ConvLayer conv2_;
+  const float* fc_weights_ = nullptr;
+  const float* fc_bias_ = nullptr;
+  TensorInfo input_;
+  std::vector<TensorInfo> outputs_;
+  std::vector<float> act1_;
+  std::vector<float> act2_;
+};
+
+}  // namespace
+
+size_t reference_weight_count() {
+  return conv_weight_count(3, kConv1Channels) + conv_weight_count(kConv1Channels, kConv2Channels) +
+         static_cast<size_t>(kReferenceClasses) * kConv2Channels + kReferenceClasses;
+}
+
+std::unique_ptr<InferenceBackend> create_inference_backend(const std::string& name) {
+  if (name == "reference")
+    return std::unique_ptr<InferenceBackend>(new ReferenceBackend());
+  return nullptr;
+}
+
+}  // namespace nvgst
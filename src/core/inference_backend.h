@@ -0,0 +1,49 @@
+// Interface between the inference engine and whatever runs the network.
+// A backend instance is only ever used by one thread at a time; the engine
+// creates one per worker, so backends need no locking of their own.
+//
+// Backends are looked up by name through create_inference_backend(). The
+// only one built in is "reference", a tiny fixed CNN in plain C++ that
+// needs no runtime and no GPU; wrappers around real runtimes plug in next
+// to it.
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/tensor.h"
+
+namespace nvgst {
+
+class InferenceBackend {
+ public:
+  virtual ~InferenceBackend() = default;
+
+  // Loads the model; model is backend specific (usually a file path).
+  // Returns false with a description in *error when it cannot be used.
+  virtual bool load(const std::string& model, std::string* error) = 0;
+
+  // Shapes are per frame, without the batch dimension. The input is a
+  // planar {3, height, width} image.
+  virtual const TensorInfo& input() const = 0;
+  virtual const std::vector<TensorInfo>& outputs() const = 0;
+
+  // Runs batch frames packed back to back in input and writes output i,
+  // batch frames back to back, to outputs[i].
+  virtual bool infer(const float* input, int batch, float* const* outputs) = 0;
+};
+
+// Null for an unknown name.
+std::unique_ptr<InferenceBackend> create_inference_backend(const std::string& name);
+
+// "reference" network: two 3x3 stride-2 convolutions with ReLU (3 -> 8 ->
+// 16 channels), global average pooling and a fully connected layer to
+// kReferenceClasses logits, on a 3 x kReferenceSize x kReferenceSize input.
+// An empty model uses fixed pseudo-random weights; otherwise it names a
+// file of raw float32 weights and biases, layer by layer.
+constexpr int kReferenceSize = 128;
+constexpr int kReferenceClasses = 10;
+size_t reference_weight_count();
+
+}  // namespace nvgst
@@ -0,0 +1,213 @@
+#include "core/inference_engine.h"
+
+namespace nvgst {
+
+bool InferenceEngine::start(const InferenceConfig& config, std::string* error) {
+  stop();
+
+  if (config.workers < 1 || config.requests < 2 || config.max_batch < 1) {
+    *error = "invalid engine configuration";
+    return false;
+  }
+
+  for (int i = 0; i < config.workers; i++) {
+    std::unique_ptr<InferenceBackend> backend = create_inference_backend(config.backend);
+    if (!backend) {
+      *error = "unknown backend " + config.backend;
+      backends_.clear();
+      return false;
+    }
+    if (!backend->load(config.model, error)) {
+      backends_.clear();
+      return false;
+    }
+    backends_.push_back(std::move(backend));
+  }
+
+  config_ = config;
+  input_ = backends_[0]->input();
+  outputs_ = backends_[0]->outputs();
+  if (input_.shape.size() != 3 || input_.shape[0] != 3) {
+    *error = "backend input is not a planar 3-channel image";
+    backends_.clear();
+    return false;
+  }
+
+  const size_t frame = input_.count();
+  const size_t per_request = align_up(frame * config.max_batch, static_cast<size_t>(16));
+  if (!arena_.reserve(per_request * config.requests * sizeof(float))) {
+    *error = "cannot allocate the input tensor arena";
+    backends_.clear();
+    return false;
+  }
+
+  pools_.clear();
+  for (const TensorInfo& info : outputs_)
+    pools_.push_back(TensorPool::create(info.count() * config.max_batch));
+
+  std::lock_guard<std::mutex> guard(lock_);
+  requests_.assign(config.requests, Request());
+  state_.assign(config.requests, State::kFree);
+  free_.clear();
+  work_.clear();
+  order_.clear();
+  for (int i = 0; i < config.requests; i++) {
+    requests_[i].index = i;
+    requests_[i].input = arena_.as<float>() + per_request * i;
+    free_.push_back(i);
+  }
+  running_ = 0;
+  flushing_ = false;
+  stopping_ = false;
+
+  for (int i = 0; i < config.workers; i++)
+    workers_.emplace_back(&InferenceEngine::run, this, i);
+  return true;
+}
+
+void InferenceEngine::stop() {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    stopping_ = true;
+  }
+  cond_.notify_all();
+  for (std::thread& worker : workers_)
+    worker.join();
+  workers_.clear();
+  backends_.clear();
+
+  // The consumer may still be waking up in next().
+  std::lock_guard<std::mutex> guard(lock_);
+  requests_.clear();
+  state_.clear();
+  free_.clear();
+  work_.clear();
+  order_.clear();
+}
+
+InferenceEngine::Request* InferenceEngine::acquire() {
+  std::unique_lock<std::mutex> lock(lock_);
+  cond_.wait(lock, [this] { return !free_.empty() || interrupted(); });
+  if (interrupted())
+    return nullptr;
+
+  const int i = free_.front();
+  free_.pop_front();
+  state_[i] = State::kFilling;
+  requests_[i].batch = 0;
+  requests_[i].ok = false;
+  return &requests_[i];
+}
+
+void InferenceEngine::submit(Request* request) {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    const int i = request->index;
+    order_.push_back(i);
+    if (request->batch > 0) {
+      state_[i] = State::kQueued;
+      work_.push_back(i);
+    } else {
+      request->ok = true;
+      state_[i] = State::kDone;
+    }
+  }
+  cond_.notify_all();
+}
+
+bool InferenceEngine::drain() {
+  std::unique_lock<std::mutex> lock(lock_);
+  cond_.wait(lock, [this] { return free_.size() == requests_.size() || interrupted(); });
+  return !interrupted();
+}
+
+InferenceEngine::Request* InferenceEngine::next() {
+  std::unique_lock<std::mutex> lock(lock_);
+  cond_.wait(lock, [this] {
+    return (!order_.empty() && state_[order_.front()] == State::kDone) || interrupted();
+  });
+  if (interrupted())
+    return nullptr;
+
+  const int i = order_.front();
+  order_.pop_front();
+  state_[i] = State::kConsuming;
+  return &requests_[i];
+}
+
+void InferenceEngine::release(Request* request) {
+  request->outputs.clear();
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    state_[request->index] = State::kFree;
+    free_.push_back(request->index);
+  }
+  cond_.notify_all();
+}
+
+void InferenceEngine::set_flushing(bool flushing) {
+  std::unique_lock<std::mutex> lock(lock_);
+  if (flushing) {
+    flushing_ = true;
+    for (int i : work_) {
+      requests_[i].ok = false;
+      state_[i] = State::kDone;
+    }
+    work_.clear();
+    lock.unlock();
+    cond_.notify_all();
+    return;
+  }
+
+  cond_.wait(lock, [this] { return running_ == 0 || stopping_; });
+  order_.clear();
+  free_.clear();
+  for (size_t i = 0; i < requests_.size(); i++) {
+    requests_[i].outputs.clear();
+    requests_[i].batch = 0;
+    state_[i] = State::kFree;
+    free_.push_back(static_cast<int>(i));
+  }
+  flushing_ = false;
+}
+
+void InferenceEngine::run(int worker) {
+  InferenceBackend* backend = backends_[worker].get();
+  std::vector<float*> outputs(outputs_.size());
+
+  std::unique_lock<std::mutex> lock(lock_);
+  for (;;) {
+    cond_.wait(lock, [this] { return !work_.empty() || stopping_; });
+    if (stopping_)
+      return;
+
+    const int i = work_.front();
+    work_.pop_front();
+    state_[i] = State::kRunning;
+    running_++;
+    Request& request = requests_[i];
+    lock.unlock();
+
+    bool ok = true;
+    request.outputs.resize(outputs_.size());
+    for (size_t o = 0; o < outputs_.size(); o++) {
+      Tensor& tensor = request.outputs[o];
+      tensor.info = outputs_[o];
+      tensor.info.shape.insert(tensor.info.shape.begin(), request.batch);
+      tensor.data = pools_[o]->acquire();
+      ok = ok && tensor.data != nullptr;
+      outputs[o] = tensor.data.get();
+    }
+    ok = ok && backend->infer(request.input, request.batch, outputs.data());
+    if (!ok)
+      request.outputs.clear();
+
+    lock.lock();
+    request.ok = ok;
+    state_[i] = State::kDone;
+    running_--;
+    cond_.notify_all();
+  }
+}
+
+}  // namespace nvgst
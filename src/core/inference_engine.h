@@ -0,0 +1,120 @@
+// Runs inference requests on a pool of worker threads while the caller
+// keeps preprocessing, and hands the results back in submission order.
+//
+// A request is one batch of up to max_batch frames. Its input lives in a
+// tensor arena allocated once by start(), so the producer packs frames
+// straight into the memory the backend reads. Outputs come from per-output
+// TensorPools and leave the engine as shared tensors, so they can outlive
+// the request without a copy. The fixed number of requests bounds the work
+// in flight: acquire() blocks while all of them are in use.
+//
+// Requests with batch 0 skip inference and only keep their place in the
+// order, which lets the caller queue events between frames.
+//
+// One producer thread calls acquire() and submit(); one consumer thread
+// calls next() and release().
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/aligned_buffer.h"
+#include "core/inference_backend.h"
+#include "core/tensor.h"
+
+namespace nvgst {
+
+struct InferenceConfig {
+  std::string backend = "reference";
+  std::string model;
+  int workers = 2;
+  // Requests in flight, including the one being filled and the one being
+  // consumed.
+  int requests = 4;
+  int max_batch = 1;
+};
+
+class InferenceEngine {
+ public:
+  struct Request {
+    int index = 0;
+    // max_batch frames of input().count() floats each.
+    float* input = nullptr;
+    int batch = 0;
+    // Set once the request comes out of next(): false when the backend
+    // failed or the request was dropped by a flush.
+    bool ok = false;
+    // One tensor per backend output, with the batch as first dimension.
+    std::vector<Tensor> outputs;
+  };
+
+  InferenceEngine() = default;
+  ~InferenceEngine() { stop(); }
+
+  InferenceEngine(const InferenceEngine&) = delete;
+  InferenceEngine& operator=(const InferenceEngine&) = delete;
+
+  // Creates and loads one backend per worker and starts the workers.
+  // Returns false with a description in *error.
+  bool start(const InferenceConfig& config, std::string* error);
+  // Joins the workers and drops every request.
+  void stop();
+  bool running() const { return !workers_.empty(); }
+
+  const InferenceConfig& config() const { return config_; }
+  const TensorInfo& input() const { return input_; }
+  const std::vector<TensorInfo>& outputs() const { return outputs_; }
+
+  // Producer: a free request with batch 0. Blocks while none is free;
+  // null once flushing or stopped.
+  Request* acquire();
+  // Producer: queues request behind every request submitted before it.
+  void submit(Request* request);
+  // Producer: blocks until every submitted request has been released.
+  // False when interrupted by a flush or stop.
+  bool drain();
+
+  // Consumer: the oldest submitted request, once its inference finished.
+  // Blocks; null once flushing or stopped.
+  Request* next();
+  // Consumer: hands a request from next() back, dropping its outputs.
+  void release(Request* request);
+
+  // Setting makes acquire(), next() and drain() return at once and marks
+  // queued requests as dropped; running inferences still finish. Clearing
+  // waits for the workers to go idle and frees every request, including
+  // ones the producer or consumer still held.
+  void set_flushing(bool flushing);
+
+ private:
+  enum class State { kFree, kFilling, kQueued, kRunning, kDone, kConsuming };
+
+  void run(int worker);
+  bool interrupted() const { return flushing_ || stopping_; }
+
+  InferenceConfig config_;
+  TensorInfo input_;
+  std::vector<TensorInfo> outputs_;
+  std::vector<std::unique_ptr<InferenceBackend>> backends_;
+  std::vector<std::shared_ptr<TensorPool>> pools_;
+  AlignedBuffer arena_;
+
+  std::mutex lock_;
+  std::condition_variable cond_;
+  std::vector<Request> requests_;
+  std::vector<State> state_;
+  std::deque<int> free_;
+  std::deque<int> work_;
+  std::deque<int> order_;
+  int running_ = 0;
+  bool flushing_ = false;
+  bool stopping_ = false;
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace nvgst
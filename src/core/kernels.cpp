@@ -0,0 +1,22 @@
+#include "core/kernels_internal.h"
+
+namespace nvgst {
+namespace simd {
+
+const Kernels& kernels(SimdLevel level) {
+  level = clamp_simd_level(level);
+#if defined(NVGST_HAVE_X86_SIMD)
+  if (level == SimdLevel::kAvx2)
+    return avx2_kernels();
+  if (level == SimdLevel::kSse41)
+    return sse41_kernels();
+#endif
+  return scalar_kernels();
+}
+
+const Kernels& kernels() {
+  return kernels(detect_simd_level());
+}
+
+}  // namespace simd
+}  // namespace nvgst
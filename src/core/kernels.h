@@ -0,0 +1,195 @@
+// Row kernels with scalar, SSE4.1 and AVX2 implementations.
+//
+// Each SIMD table starts as a copy of the scalar table and overrides the
+// entries it accelerates, so every level is always complete. All fixed-point
+// kernels use the same integer formulas at every level and therefore produce
+// bit-identical output.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "core/cpu_features.h"
+#include "core/frame.h"
+
+namespace nvgst {
+namespace simd {
+
+// Q13 coefficients for limited-range YUV to RGB:
+//   R = cy*(Y-16)                + crv*(V-128)
+//   G = cy*(Y-16) - cgu*(U-128)  - cgv*(V-128)
+//   B = cy*(Y-16) + cbu*(U-128)
+struct YuvToRgbCoeffs {
+  int16_t cy, crv, cgu, cgv, cbu;
+};
+
+// Q13 coefficients for RGB to limited-range YUV. The luma offset (16) and
+// chroma offset (128) are added by the kernels.
+struct RgbToYuvCoeffs {
+  int16_t yr, yg, yb;
+  int16_t ur, ug, ub;
+  int16_t vr, vg, vb;
+};
+
+// Components per pixel of the background model updated by mixture_update.
+constexpr int kMixtureComponents = 3;
+// Fixed-point scales of its mean, variance and weight planes.
+constexpr float kMixtureMeanScale = 128.0f;
+constexpr float kMixtureVarScale = 16.0f;
+constexpr float kMixtureWeightScale = 32767.0f;
+
+// Background model parameters, in 8-bit sample units.
+struct MixtureParams {
+  // Learning rate: weights decay by (1 - alpha) per frame.
+  float alpha;
+  // Squared distance, in variances, within which a sample matches.
+  float threshold;
+  float init_var;
+  float min_var;
+  float max_var;
+  // Weight the matched component needs for a sample to be background.
+  float background_weight;
+};
+
+const YuvToRgbCoeffs& yuv_to_rgb_coeffs(ColorMatrix matrix);
+const RgbToYuvCoeffs& rgb_to_yuv_coeffs(ColorMatrix matrix);
+
+struct Kernels {
+  SimdLevel level;
+
+  // One row of 4:2:0 YUV to packed 32-bit RGB. u and v hold (width + 1) / 2
+  // samples. Writes RGBA, or BGRx when bgr is set; the fourth byte is 0xff.
+  void (*yuv_to_rgb_row)(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst,
+                         int width, const YuvToRgbCoeffs& c, bool bgr);
+
+  // Luma for one row of packed 32-bit RGB (RGBA, or BGRx when bgr is set).
+  void (*rgb_to_y_row)(const uint8_t* src, uint8_t* y, int width, const RgbToYuvCoeffs& c,
+                       bool bgr);
+
+  // 4:2:0 chroma from two packed RGB rows, averaging each 2x2 block. Pass
+  // the same row twice for the last row of an odd-height frame.
+  void (*rgb_to_uv_row)(const uint8_t* src0, const uint8_t* src1, uint8_t* u, uint8_t* v,
+                        int width, const RgbToYuvCoeffs& c, bool bgr);
+
+  // Interleaved UV (NV12 chroma) to/from separate U and V rows of n samples.
+  void (*split_uv_row)(const uint8_t* uv, uint8_t* u, uint8_t* v, int n);
+  void (*merge_uv_row)(const uint8_t* u, const uint8_t* v, uint8_t* uv, int n);
+
+  // Copies n 32-bit pixels, optionally swapping bytes 0 and 2, and sets the
+  // fourth byte to 0xff.
+  void (*swizzle_rgb_row)(const uint8_t* src, uint8_t* dst, int n, bool swap_rb);
+
+  // dst = (a * (256 - frac) + b * frac + 128) >> 8 over n bytes, frac in
+  // [0, 256].
+  void (*lerp_row)(const uint8_t* a, const uint8_t* b, uint8_t* dst, int n, int frac);
+
+  // Blends n 32-bit pixels of src over opaque dst:
+  //   a   = src[3] * alpha / 255
+  //   dst = (src * a + dst * (255 - a)) / 255
+  // with alpha in [0, 255] and rounded divisions. src carries its alpha in
+  // the fourth byte and is in dst channel order, or has bytes 0 and 2
+  // swapped when swap_rb is set. The fourth byte of dst is set to 0xff.
+  void (*blend_row)(const uint8_t* src, uint8_t* dst, int n, int alpha, bool swap_rb);
+
+  // Solid spans of n pixels of bpp bytes (1, 2 or 4). pattern holds one
+  // pixel, its first byte in the low bits. With the same rounding as
+  // blend_row:
+  //   fill_span:       dst = pattern
+  //   blend_span:      dst = (pattern * alpha + dst * (255 - alpha)) / 255
+  //   blend_mask_span: as blend_span with alpha * mask[i] / 255 for pixel i
+  void (*fill_span)(uint8_t* dst, int n, uint32_t pattern, int bpp);
+  void (*blend_span)(uint8_t* dst, int n, uint32_t pattern, int bpp, int alpha);
+  void (*blend_mask_span)(uint8_t* dst, const uint8_t* mask, int n, uint32_t pattern, int bpp,
+                          int alpha);
+
+  // Intersection over union of box (x0, y0, x1, y1) with n boxes whose
+  // corners are in separate arrays; 0 where the union is empty.
+  void (*iou_row)(const float* x0, const float* y0, const float* x1, const float* y1, int n,
+                  const float box[4], float* iou);
+
+  // n independent constant-velocity Kalman filters over one coordinate:
+  // state (pos, vel), covariance [p00 p01; p01 p11], one array each.
+  // Predict adds process noise q_pos and q_vel scaled by scale[i]^2; update
+  // folds in measurement z[i] with variance r[i], and r[i] = +inf leaves a
+  // filter unchanged. Float results are identical at every level.
+  void (*kalman_predict)(float* pos, float* vel, float* p00, float* p01, float* p11,
+                         const float* scale, float q_pos, float q_vel, int n);
+  void (*kalman_update)(float* pos, float* vel, float* p00, float* p01, float* p11,
+                        const float* z, const float* r, int n);
+
+  // Splits n 4-byte pixels into three float planes, byte 0 into c0 and so
+  // on, as (value - offset[c]) * scale[c]. The fourth byte is ignored.
+  void (*planar_f32_row)(const uint8_t* src, int n, float* c0, float* c1, float* c2,
+                         const float offset[3], const float scale[3]);
+
+  // Column-wise maximum over count rows of n floats, stride floats apart:
+  // best[i] is the largest rows[r * stride + i] and index[i] the first r
+  // holding it.
+  void (*argmax_rows)(const float* rows, size_t stride, int count, int n, float* best,
+                      int32_t* index);
+  // Writes the indices i with v[i] >= threshold to index, in order, and
+  // returns how many there are. index needs room for n entries.
+  int (*select_above)(const float* v, int n, float threshold, int32_t* index);
+
+  // acc[i] += src[i] over n bytes; box filters sum up to 257 rows of 8-bit
+  // samples this way without overflow.
+  void (*accumulate_row)(const uint8_t* src, uint16_t* acc, int n);
+  // Sum of absolute differences of n bytes.
+  uint32_t (*sad_row)(const uint8_t* a, const uint8_t* b, int n);
+
+  // Horizontal bilinear pass over 32-bit pixels: dst pixel i blends the
+  // pixels at byte offsets x0[i] and x1[i] of src with lerp_row's rounding
+  // and weight frac[i] in [0, 256] for the second one.
+  void (*lerp_pixels)(const uint8_t* src, const int32_t* x0, const int32_t* x1,
+                      const uint16_t* frac, uint8_t* dst, int n);
+
+  // Bilinear remap of n samples of bpp bytes (1, 2 or 4): dst sample i
+  // blends the 2x2 block whose top-left sample is at column taps[i] & 0xffff
+  // and row taps[i] >> 16 of src, rows stride bytes apart. frac[i] & 0xff
+  // weighs the right column and frac[i] >> 8 the lower row; both rows are
+  // blended with lerp_row's rounding, then the two results. The whole block
+  // must lie inside src.
+  void (*remap_row)(const uint8_t* src, int stride, const uint32_t* taps, const uint16_t* frac,
+                    uint8_t* dst, int n, int bpp);
+
+  // One row of a summed-area table over n bytes of bpp interleaved
+  // channels: dst[i] = above[i] + the sum of src[j] for j <= i in the
+  // channel of i. Sums wrap modulo 2^32, which box sums taken as
+  // differences do not notice.
+  void (*integral_row)(const uint8_t* src, const uint32_t* above, uint32_t* dst, int n, int bpp);
+  // Box means from two summed-area rows: with
+  //   sum = bottom[i + width] - bottom[i] - top[i + width] + top[i]
+  // dst[i] = (int) ((float) sum * scale + 0.5f) over n bytes. Sums must
+  // stay below 2^31; results are identical at every level.
+  void (*box_mean_row)(const uint32_t* top, const uint32_t* bottom, int width, uint8_t* dst,
+                       int n, float scale);
+
+  // Updates the Gaussian mixture of n pixels with samples src and writes
+  // 0xff to fg where a sample is foreground, 0 elsewhere. model holds
+  // 3 * kMixtureComponents int16 planes, plane elements apart; component k
+  // has its mean (Q7) in plane 3k, its variance (Q4) in 3k + 1 and its
+  // weight (weight * 32767) in 3k + 2. A sample updates the heaviest
+  // component it matches or, failing that, replaces the lightest. All
+  // arithmetic is float32 with the same operations at every level, so
+  // models stay bit-identical.
+  void (*mixture_update)(const uint8_t* src, int16_t* model, size_t plane, uint8_t* fg, int n,
+                         const MixtureParams& params);
+  // Dot products of query with count rows of n floats, stride floats
+  // apart, into out. Each level adds the products up in its own order, so
+  // results may differ in the last bits between levels.
+  void (*dot_rows_f32)(const float* query, const float* rows, size_t stride, int count, int n,
+                       float* out);
+  // The same over int8 rows, stride bytes apart. Values must lie in
+  // [-127, 127] and n must not exceed 65536; results are exact at every
+  // level.
+  void (*dot_rows_s8)(const int8_t* query, const int8_t* rows, size_t stride, int count, int n,
+                      int32_t* out);
+};
+
+const Kernels& kernels(SimdLevel level);
+
+// Kernels for detect_simd_level().
+const Kernels& kernels();
+
+}  // namespace simd
+}  // namespace nvgst
@@ -0,0 +1,917 @@
+// AVX2 kernels. This file is compiled with -mavx2 and must only be reached
+// through kernels() after runtime detection.
+//
+// Most AVX2 integer instructions operate on two independent 128-bit lanes;
+// the comments on each permute state the element order it repairs.
+#include <immintrin.h>
+
+#include "core/kernels_internal.h"
+
+namespace nvgst {
+namespace simd {
+
+namespace {
+
+inline __m256i pair16(int lo, int hi) {
+  return _mm256_set1_epi32(static_cast<int>(
+      static_cast<uint16_t>(lo) | (static_cast<uint32_t>(static_cast<uint16_t>(hi)) << 16)));
+}
+
+inline __m256i dot2x2_q13(__m256i a, __m256i b, __m256i ab, __m256i c, __m256i d, __m256i cd) {
+  __m256i lo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), ab),
+                                _mm256_madd_epi16(_mm256_unpacklo_epi16(c, d), cd));
+  __m256i hi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), ab),
+                                _mm256_madd_epi16(_mm256_unpackhi_epi16(c, d), cd));
+  // unpacklo/unpackhi followed by packs restores the original lane order.
+  return _mm256_packs_epi32(_mm256_srai_epi32(lo, 13), _mm256_srai_epi32(hi, 13));
+}
+
+inline void yuv16_to_rgb16(__m256i y, __m256i u, __m256i v, const __m256i coef[5], __m256i* r,
+                           __m256i* g, __m256i* b) {
+  const __m256i one = _mm256_set1_epi16(1);
+  const __m256i zero = _mm256_setzero_si256();
+  *r = dot2x2_q13(y, v, coef[0], one, zero, coef[4]);
+  *g = dot2x2_q13(y, u, coef[1], v, one, coef[2]);
+  *b = dot2x2_q13(y, u, coef[3], one, zero, coef[4]);
+}
+
+// c0..c2 hold 32 samples in the order produced by packus of two in-order
+// int16 vectors: [0-7, 16-23 | 8-15, 24-31].
+inline void store_rgbx32(uint8_t* dst, __m256i c0, __m256i c1, __m256i c2) {
+  const __m256i a = _mm256_set1_epi8(static_cast<char>(0xff));
+  __m256i c01_lo = _mm256_unpacklo_epi8(c0, c1);  // [0-7 | 8-15]
+  __m256i c01_hi = _mm256_unpackhi_epi8(c0, c1);  // [16-23 | 24-31]
+  __m256i c2a_lo = _mm256_unpacklo_epi8(c2, a);
+  __m256i c2a_hi = _mm256_unpackhi_epi8(c2, a);
+  __m256i p0 = _mm256_unpacklo_epi16(c01_lo, c2a_lo);  // [0-3 | 8-11]
+  __m256i p1 = _mm256_unpackhi_epi16(c01_lo, c2a_lo);  // [4-7 | 12-15]
+  __m256i p2 = _mm256_unpacklo_epi16(c01_hi, c2a_hi);  // [16-19 | 24-27]
+  __m256i p3 = _mm256_unpackhi_epi16(c01_hi, c2a_hi);  // [20-23 | 28-31]
+  __m256i* out = reinterpret_cast<__m256i*>(dst);
+  _mm256_storeu_si256(out, _mm256_permute2x128_si256(p0, p1, 0x20));
+  _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(p0, p1, 0x31));
+  _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(p2, p3, 0x20));
+  _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+}
+
+void yuv_to_rgb_row(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width,
+                    const YuvToRgbCoeffs& c, bool bgr) {
+  const __m256i coef[5] = {pair16(c.cy, c.crv), pair16(c.cy, -c.cgu), pair16(-c.cgv, 4096),
+                           pair16(c.cy, c.cbu), pair16(4096, 0)};
+  const __m256i y_off = _mm256_set1_epi16(16);
+  const __m256i uv_off = _mm256_set1_epi16(128);
+
+  int x = 0;
+  for (; x + 32 <= width; x += 32) {
+    __m128i u8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(u + x / 2));
+    __m128i v8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + x / 2));
+    __m256i r[2], g[2], b[2];
+    for (int h = 0; h < 2; h++) {
+      __m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x + 16 * h));
+      __m128i uu = h == 0 ? _mm_unpacklo_epi8(u8, u8) : _mm_unpackhi_epi8(u8, u8);
+      __m128i vv = h == 0 ? _mm_unpacklo_epi8(v8, v8) : _mm_unpackhi_epi8(v8, v8);
+      yuv16_to_rgb16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(y8), y_off),
+                     _mm256_sub_epi16(_mm256_cvtepu8_epi16(uu), uv_off),
+                     _mm256_sub_epi16(_mm256_cvtepu8_epi16(vv), uv_off), coef, &r[h], &g[h],
+                     &b[h]);
+    }
+    __m256i r8 = _mm256_packus_epi16(r[0], r[1]);
+    __m256i g8 = _mm256_packus_epi16(g[0], g[1]);
+    __m256i b8 = _mm256_packus_epi16(b[0], b[1]);
+    if (bgr)
+      store_rgbx32(dst + 4 * x, b8, g8, r8);
+    else
+      store_rgbx32(dst + 4 * x, r8, g8, b8);
+  }
+  scalar::yuv_to_rgb_row(y, u, v, dst, width, c, bgr, x);
+}
+
+inline __m256i rgb_coef(int r, int g, int b, bool bgr) {
+  return bgr ? _mm256_setr_epi16(b, g, r, 0, b, g, r, 0, b, g, r, 0, b, g, r, 0)
+             : _mm256_setr_epi16(r, g, b, 0, r, g, b, 0, r, g, b, 0, r, g, b, 0);
+}
+
+// Eight int32 dot products for the eight 32-bit pixels in px, in order.
+inline __m256i dot_rgb8(__m256i px, __m256i coef) {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(px, zero), coef);  // [0,1 | 4,5]
+  __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(px, zero), coef);  // [2,3 | 6,7]
+  return _mm256_hadd_epi32(lo, hi);                                      // [0-3 | 4-7]
+}
+
+void rgb_to_y_row(const uint8_t* src, uint8_t* y, int width, const RgbToYuvCoeffs& c, bool bgr) {
+  const __m256i coef = rgb_coef(c.yr, c.yg, c.yb, bgr);
+  const __m256i bias = _mm256_set1_epi32((16 << 13) + 4096);
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+  int x = 0;
+  for (; x + 32 <= width; x += 32) {
+    const __m256i* p = reinterpret_cast<const __m256i*>(src + 4 * x);
+    __m256i s[4];
+    for (int i = 0; i < 4; i++)
+      s[i] = _mm256_srai_epi32(
+          _mm256_add_epi32(dot_rgb8(_mm256_loadu_si256(p + i), coef), bias), 13);
+    // Dwords of four pixels come out as [0, 8, 16, 24 | 4, 12, 20, 28].
+    __m256i out = _mm256_packus_epi16(_mm256_packs_epi32(s[0], s[1]),
+                                      _mm256_packs_epi32(s[2], s[3]));
+    out = _mm256_permutevar8x32_epi32(out, order);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(y + x), out);
+  }
+  scalar::rgb_to_y_row(src, y, width, c, bgr, x);
+}
+
+// 2x2 block sums for eight pixels from two rows: [P01, P23 | P45, P67].
+inline __m256i sum_2x2(__m256i a, __m256i b) {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+  __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+  lo = _mm256_add_epi16(lo, _mm256_srli_si256(lo, 8));
+  hi = _mm256_add_epi16(hi, _mm256_srli_si256(hi, 8));
+  return _mm256_unpacklo_epi64(lo, hi);
+}
+
+// Packs two hadd results holding chroma [0,1,4,5 | 2,3,6,7] and
+// [8,9,12,13 | 10,11,14,15] into 16 ordered bytes.
+inline __m128i pack_chroma16(__m256i a, __m256i b) {
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  __m256i w = _mm256_permutevar8x32_epi32(_mm256_packs_epi32(a, b), order);
+  __m256i bytes = _mm256_packus_epi16(w, w);  // [0-7, 0-7 | 8-15, 8-15]
+  return _mm256_castsi256_si128(_mm256_permute4x64_epi64(bytes, _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+void rgb_to_uv_row(const uint8_t* src0, const uint8_t* src1, uint8_t* u, uint8_t* v, int width,
+                   const RgbToYuvCoeffs& c, bool bgr) {
+  const __m256i ucoef = rgb_coef(c.ur, c.ug, c.ub, bgr);
+  const __m256i vcoef = rgb_coef(c.vr, c.vg, c.vb, bgr);
+  const __m256i bias = _mm256_set1_epi32((128 << 15) + (1 << 14));
+
+  // 32 pixels (16 chroma samples) per iteration; only full pixel pairs.
+  int cx = 0;
+  for (; 2 * cx + 32 <= width; cx += 16) {
+    const __m256i* p0 = reinterpret_cast<const __m256i*>(src0 + 8 * cx);
+    const __m256i* p1 = reinterpret_cast<const __m256i*>(src1 + 8 * cx);
+    __m256i sum[4];
+    for (int i = 0; i < 4; i++)
+      sum[i] = sum_2x2(_mm256_loadu_si256(p0 + i), _mm256_loadu_si256(p1 + i));
+
+    __m256i u32[2], v32[2];
+    for (int i = 0; i < 2; i++) {
+      __m256i ua = _mm256_madd_epi16(sum[2 * i], ucoef);
+      __m256i ub = _mm256_madd_epi16(sum[2 * i + 1], ucoef);
+      __m256i va = _mm256_madd_epi16(sum[2 * i], vcoef);
+      __m256i vb = _mm256_madd_epi16(sum[2 * i + 1], vcoef);
+      u32[i] = _mm256_srai_epi32(_mm256_add_epi32(_mm256_hadd_epi32(ua, ub), bias), 15);
+      v32[i] = _mm256_srai_epi32(_mm256_add_epi32(_mm256_hadd_epi32(va, vb), bias), 15);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(u + cx), pack_chroma16(u32[0], u32[1]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(v + cx), pack_chroma16(v32[0], v32[1]));
+  }
+  scalar::rgb_to_uv_row(src0, src1, u, v, width, c, bgr, cx);
+}
+
+void split_uv_row(const uint8_t* uv, uint8_t* u, uint8_t* v, int n) {
+  const __m256i mask = _mm256_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15, 0, 2,
+                                        4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+  int i = 0;
+  for (; i + 32 <= n; i += 32) {
+    const __m256i* p = reinterpret_cast<const __m256i*>(uv + 2 * i);
+    __m256i a = _mm256_shuffle_epi8(_mm256_loadu_si256(p), mask);      // [u0 v0 | u1 v1]
+    __m256i b = _mm256_shuffle_epi8(_mm256_loadu_si256(p + 1), mask);  // [u2 v2 | u3 v3]
+    __m256i uu = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+    __m256i vv = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(u + i), uu);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(v + i), vv);
+  }
+  scalar::split_uv_row(uv, u, v, n, i);
+}
+
+void merge_uv_row(const uint8_t* u, const uint8_t* v, uint8_t* uv, int n) {
+  int i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(u + i));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i));
+    __m256i lo = _mm256_unpacklo_epi8(a, b);  // [0-7 | 16-23]
+    __m256i hi = _mm256_unpackhi_epi8(a, b);  // [8-15 | 24-31]
+    __m256i* p = reinterpret_cast<__m256i*>(uv + 2 * i);
+    _mm256_storeu_si256(p, _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256(p + 1, _mm256_permute2x128_si256(lo, hi, 0x31));
+  }
+  scalar::merge_uv_row(u, v, uv, n, i);
+}
+
+void swizzle_rgb_row(const uint8_t* src, uint8_t* dst, int n, bool swap_rb) {
+  const __m256i mask =
+      swap_rb ? _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3,
+                                 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15)
+              : _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3,
+                                 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xff000000u));
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 4 * i));
+    px = _mm256_or_si256(_mm256_shuffle_epi8(px, mask), alpha);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4 * i), px);
+  }
+  scalar::swizzle_rgb_row(src, dst, n, swap_rb, i);
+}
+
+void lerp_row(const uint8_t* a, const uint8_t* b, uint8_t* dst, int n, int frac) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i wa = _mm256_set1_epi16(static_cast<int16_t>(256 - frac));
+  const __m256i wb = _mm256_set1_epi16(static_cast<int16_t>(frac));
+  const __m256i round = _mm256_set1_epi16(128);
+  int i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(va, zero), wa),
+                                  _mm256_mullo_epi16(_mm256_unpacklo_epi8(vb, zero), wb));
+    __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(va, zero), wa),
+                                  _mm256_mullo_epi16(_mm256_unpackhi_epi8(vb, zero), wb));
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 8);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(lo, hi));
+  }
+  scalar::lerp_row(a, b, dst, n, frac, i);
+}
+
+// (t + 128) / 255 rounded, as in the scalar kernel.
+inline __m256i div255(__m256i t) {
+  t = _mm256_add_epi16(t, _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+// Four pixels (two per lane) widened to 16 bits: source alpha scaled by the
+// global alpha, then the blend itself.
+inline __m256i blend_px4(__m256i s, __m256i d, __m256i alpha) {
+  __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, 0xff), 0xff);
+  a = div255(_mm256_mullo_epi16(a, alpha));
+  const __m256i ia = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+  return div255(_mm256_add_epi16(_mm256_mullo_epi16(s, a), _mm256_mullo_epi16(d, ia)));
+}
+
+void blend_row(const uint8_t* src, uint8_t* dst, int n, int alpha, bool swap_rb) {
+  const __m256i mask =
+      swap_rb ? _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3,
+                                 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15)
+              : _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3,
+                                 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i va = _mm256_set1_epi16(static_cast<int16_t>(alpha));
+  const __m256i opaque = _mm256_set1_epi32(static_cast<int>(0xff000000u));
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 4 * i));
+    __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + 4 * i));
+    s = _mm256_shuffle_epi8(s, mask);
+    // unpack and pack work per lane, so pixel order survives the round trip
+    __m256i lo = blend_px4(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero), va);
+    __m256i hi = blend_px4(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero), va);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4 * i),
+                        _mm256_or_si256(_mm256_packus_epi16(lo, hi), opaque));
+  }
+  scalar::blend_row(src, dst, n, alpha, swap_rb, i);
+}
+
+void fill_span(uint8_t* dst, int n, uint32_t pattern, int bpp) {
+  const __m256i p = _mm256_set1_epi32(static_cast<int>(replicate_pattern(pattern, bpp)));
+  const int bytes = n * bpp;
+  int i = 0;
+  for (; i + 32 <= bytes; i += 32)
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), p);
+  scalar::fill_span(dst, n, pattern, bpp, i / bpp);
+}
+
+void blend_span(uint8_t* dst, int n, uint32_t pattern, int bpp, int alpha) {
+  const __m256i zero = _mm256_setzero_si256();
+  // The pattern repeats every 4 bytes, so every unpacked half matches it.
+  const __m256i p = _mm256_unpacklo_epi8(
+      _mm256_set1_epi32(static_cast<int>(replicate_pattern(pattern, bpp))), zero);
+  const __m256i pa = _mm256_mullo_epi16(p, _mm256_set1_epi16(static_cast<int16_t>(alpha)));
+  const __m256i ia = _mm256_set1_epi16(static_cast<int16_t>(255 - alpha));
+  const int bytes = n * bpp;
+  int i = 0;
+  for (; i + 32 <= bytes; i += 32) {
+    __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+    __m256i lo =
+        div255(_mm256_add_epi16(pa, _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), ia)));
+    __m256i hi =
+        div255(_mm256_add_epi16(pa, _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), ia)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(lo, hi));
+  }
+  scalar::blend_span(dst, n, pattern, bpp, alpha, i / bpp);
+}
+
+// 32 bytes of coverage, one per destination byte, for 32 / bpp pixels.
+// The widening loads keep memory order across both lanes.
+inline __m256i expand_mask(const uint8_t* mask, int bpp) {
+  if (bpp == 1)
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask));
+  if (bpp == 2) {
+    const __m256i m =
+        _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(mask)));
+    return _mm256_or_si256(m, _mm256_slli_epi16(m, 8));
+  }
+  const __m256i m = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(mask)));
+  return _mm256_mullo_epi32(m, _mm256_set1_epi32(0x01010101));
+}
+
+inline __m256i blend_mask16(__m256i p, __m256i m, __m256i d, __m256i alpha) {
+  const __m256i a = div255(_mm256_mullo_epi16(m, alpha));
+  const __m256i ia = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+  return div255(_mm256_add_epi16(_mm256_mullo_epi16(p, a), _mm256_mullo_epi16(d, ia)));
+}
+
+void blend_mask_span(uint8_t* dst, const uint8_t* mask, int n, uint32_t pattern, int bpp,
+                     int alpha) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i p = _mm256_unpacklo_epi8(
+      _mm256_set1_epi32(static_cast<int>(replicate_pattern(pattern, bpp))), zero);
+  const __m256i va = _mm256_set1_epi16(static_cast<int16_t>(alpha));
+  const int step = 32 / bpp;
+  int x = 0;
+  for (; x + step <= n; x += step) {
+    uint8_t* d8 = dst + x * bpp;
+    const __m256i m = expand_mask(mask + x, bpp);
+    const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(d8));
+    // unpack and pack work per lane on mask and destination alike
+    __m256i lo =
+        blend_mask16(p, _mm256_unpacklo_epi8(m, zero), _mm256_unpacklo_epi8(d, zero), va);
+    __m256i hi =
+        blend_mask16(p, _mm256_unpackhi_epi8(m, zero), _mm256_unpackhi_epi8(d, zero), va);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(d8), _mm256_packus_epi16(lo, hi));
+  }
+  scalar::blend_mask_span(dst, mask, n, pattern, bpp, alpha, x);
+}
+
+// Operand order of the min/max calls matches std::min/std::max, so equal
+// inputs (including signed zeros) pick the same value as the scalar code.
+void iou_row(const float* x0, const float* y0, const float* x1, const float* y1, int n,
+             const float box[4], float* iou) {
+  const __m256 bx0 = _mm256_set1_ps(box[0]);
+  const __m256 by0 = _mm256_set1_ps(box[1]);
+  const __m256 bx1 = _mm256_set1_ps(box[2]);
+  const __m256 by1 = _mm256_set1_ps(box[3]);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 box_area = _mm256_set1_ps((box[2] - box[0]) * (box[3] - box[1]));
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256 ax0 = _mm256_loadu_ps(x0 + i);
+    const __m256 ay0 = _mm256_loadu_ps(y0 + i);
+    const __m256 ax1 = _mm256_loadu_ps(x1 + i);
+    const __m256 ay1 = _mm256_loadu_ps(y1 + i);
+    const __m256 iw =
+        _mm256_max_ps(_mm256_sub_ps(_mm256_min_ps(bx1, ax1), _mm256_max_ps(bx0, ax0)), zero);
+    const __m256 ih =
+        _mm256_max_ps(_mm256_sub_ps(_mm256_min_ps(by1, ay1), _mm256_max_ps(by0, ay0)), zero);
+    const __m256 inter = _mm256_mul_ps(iw, ih);
+    const __m256 area = _mm256_mul_ps(_mm256_sub_ps(ax1, ax0), _mm256_sub_ps(ay1, ay0));
+    const __m256 uni = _mm256_sub_ps(_mm256_add_ps(area, box_area), inter);
+    const __m256 valid = _mm256_cmp_ps(uni, zero, _CMP_GT_OQ);
+    _mm256_storeu_ps(iou + i, _mm256_and_ps(_mm256_div_ps(inter, uni), valid));
+  }
+  scalar::iou_row(x0, y0, x1, y1, n, box, iou, i);
+}
+
+void kalman_predict(float* pos, float* vel, float* p00, float* p01, float* p11, const float* scale,
+                    float q_pos, float q_vel, int n) {
+  const __m256 qp = _mm256_set1_ps(q_pos);
+  const __m256 qv = _mm256_set1_ps(q_vel);
+  const __m256 two = _mm256_set1_ps(2.0f);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256 s = _mm256_loadu_ps(scale + i);
+    const __m256 s2 = _mm256_mul_ps(s, s);
+    const __m256 a = _mm256_loadu_ps(p00 + i);
+    const __m256 b = _mm256_loadu_ps(p01 + i);
+    const __m256 c = _mm256_loadu_ps(p11 + i);
+    _mm256_storeu_ps(pos + i, _mm256_add_ps(_mm256_loadu_ps(pos + i), _mm256_loadu_ps(vel + i)));
+    const __m256 p = _mm256_add_ps(_mm256_add_ps(a, _mm256_mul_ps(two, b)), c);
+    _mm256_storeu_ps(p00 + i, _mm256_add_ps(p, _mm256_mul_ps(qp, s2)));
+    _mm256_storeu_ps(p01 + i, _mm256_add_ps(b, c));
+    _mm256_storeu_ps(p11 + i, _mm256_add_ps(c, _mm256_mul_ps(qv, s2)));
+  }
+  scalar::kalman_predict(pos, vel, p00, p01, p11, scale, q_pos, q_vel, n, i);
+}
+
+void kalman_update(float* pos, float* vel, float* p00, float* p01, float* p11, const float* z,
+                   const float* r, int n) {
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256 a = _mm256_loadu_ps(p00 + i);
+    const __m256 b = _mm256_loadu_ps(p01 + i);
+    const __m256 c = _mm256_loadu_ps(p11 + i);
+    const __m256 x = _mm256_loadu_ps(pos + i);
+    const __m256 s = _mm256_add_ps(a, _mm256_loadu_ps(r + i));
+    const __m256 k0 = _mm256_div_ps(a, s);
+    const __m256 k1 = _mm256_div_ps(b, s);
+    const __m256 y = _mm256_sub_ps(_mm256_loadu_ps(z + i), x);
+    _mm256_storeu_ps(pos + i, _mm256_add_ps(x, _mm256_mul_ps(k0, y)));
+    _mm256_storeu_ps(vel + i, _mm256_add_ps(_mm256_loadu_ps(vel + i), _mm256_mul_ps(k1, y)));
+    _mm256_storeu_ps(p11 + i, _mm256_sub_ps(c, _mm256_mul_ps(k1, b)));
+    _mm256_storeu_ps(p01 + i, _mm256_sub_ps(b, _mm256_mul_ps(k0, b)));
+    _mm256_storeu_ps(p00 + i, _mm256_sub_ps(a, _mm256_mul_ps(k0, a)));
+  }
+  scalar::kalman_update(pos, vel, p00, p01, p11, z, r, n, i);
+}
+
+void planar_f32_row(const uint8_t* src, int n, float* c0, float* c1, float* c2,
+                    const float offset[3], const float scale[3]) {
+  const __m256i mask = _mm256_set1_epi32(0xff);
+  float* dst[3] = {c0, c1, c2};
+  __m256 off[3];
+  __m256 mul[3];
+  for (int c = 0; c < 3; c++) {
+    off[c] = _mm256_set1_ps(offset[c]);
+    mul[c] = _mm256_set1_ps(scale[c]);
+  }
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 4 * i));
+    for (int c = 0; c < 3; c++) {
+      const __m256 v = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(px, 8 * c), mask));
+      _mm256_storeu_ps(dst[c] + i, _mm256_mul_ps(_mm256_sub_ps(v, off[c]), mul[c]));
+    }
+  }
+  scalar::planar_f32_row(src, n, c0, c1, c2, offset, scale, i);
+}
+
+void argmax_rows(const float* rows, size_t stride, int count, int n, float* best,
+                 int32_t* index) {
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 b = _mm256_loadu_ps(rows + i);
+    __m256i k = _mm256_setzero_si256();
+    for (int r = 1; r < count; r++) {
+      const __m256 v = _mm256_loadu_ps(rows + r * stride + i);
+      const __m256 gt = _mm256_cmp_ps(v, b, _CMP_GT_OQ);
+      b = _mm256_blendv_ps(b, v, gt);
+      k = _mm256_blendv_epi8(k, _mm256_set1_epi32(r), _mm256_castps_si256(gt));
+    }
+    _mm256_storeu_ps(best + i, b);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(index + i), k);
+  }
+  scalar::argmax_rows(rows, stride, count, n, best, index, i);
+}
+
+int select_above(const float* v, int n, float threshold, int32_t* index) {
+  const __m256 t = _mm256_set1_ps(threshold);
+  int count = 0;
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(v + i), t, _CMP_GE_OQ));
+    while (mask != 0) {
+      index[count++] = i + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  return count + scalar::select_above(v, n, threshold, index + count, i);
+}
+
+void accumulate_row(const uint8_t* src, uint16_t* acc, int n) {
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m256i s =
+        _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+    __m256i* a = reinterpret_cast<__m256i*>(acc + i);
+    _mm256_storeu_si256(a, _mm256_add_epi16(_mm256_loadu_si256(a), s));
+  }
+  scalar::accumulate_row(src, acc, n, i);
+}
+
+uint32_t sad_row(const uint8_t* a, const uint8_t* b, int n) {
+  __m256i sum = _mm256_setzero_si256();
+  int i = 0;
+  for (; i + 32 <= n; i += 32) {
+    const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    sum = _mm256_add_epi64(sum, _mm256_sad_epu8(va, vb));
+  }
+  const __m128i half =
+      _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+  const uint32_t total =
+      static_cast<uint32_t>(_mm_cvtsi128_si32(half) + _mm_extract_epi32(half, 2));
+  return total + scalar::sad_row(a, b, n, i);
+}
+
+void lerp_pixels(const uint8_t* src, const int32_t* x0, const int32_t* x1, const uint16_t* frac,
+                 uint8_t* dst, int n) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i full = _mm256_set1_epi16(256);
+  const __m256i round = _mm256_set1_epi16(128);
+  const int* base = reinterpret_cast<const int*>(src);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256i i0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x0 + i));
+    const __m256i i1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x1 + i));
+    const __m256i a = _mm256_i32gather_epi32(base, i0, 1);
+    const __m256i b = _mm256_i32gather_epi32(base, i1, 1);
+    // Each weight repeated over the four channels of its pixel. Per lane,
+    // unpacklo covers pixels 0-1 (4-5) and unpackhi pixels 2-3 (6-7) of
+    // both the weights and the pixels, and packus puts them back in order.
+    __m256i f = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(frac + i)));
+    f = _mm256_or_si256(f, _mm256_slli_epi32(f, 16));
+    const __m256i f_lo = _mm256_unpacklo_epi32(f, f);
+    const __m256i f_hi = _mm256_unpackhi_epi32(f, f);
+    __m256i lo = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_sub_epi16(full, f_lo)),
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), f_lo));
+    __m256i hi = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_sub_epi16(full, f_hi)),
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), f_hi));
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 8);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4 * i), _mm256_packus_epi16(lo, hi));
+  }
+  scalar::lerp_pixels(src, x0, x1, frac, dst, n, i);
+}
+
+// Byte offsets of the top-left samples of eight taps.
+inline __m256i tap_offsets(const uint32_t* taps, __m256i stride, int shift) {
+  const __m256i t = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(taps));
+  const __m256i x = _mm256_and_si256(t, _mm256_set1_epi32(0xffff));
+  return _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(t, 16), stride),
+                          _mm256_sll_epi32(x, _mm_cvtsi32_si128(shift)));
+}
+
+// (lo * (256 - f) + hi * f + 128) >> 8 for 32-bit lanes holding the
+// 16-bit pair lo | hi << 16 and the weight pair (256 - f) | f << 16.
+inline __m256i lerp_pair(__m256i pair, __m256i weights) {
+  return _mm256_srli_epi32(
+      _mm256_add_epi32(_mm256_madd_epi16(pair, weights), _mm256_set1_epi32(128)), 8);
+}
+
+inline __m256i weight_pair(__m256i f) {
+  return _mm256_or_si256(_mm256_sub_epi32(_mm256_set1_epi32(256), f), _mm256_slli_epi32(f, 16));
+}
+
+// Gathers cannot load less than 32 bits, so every gather is placed to end
+// inside the 2x2 block: one-byte samples read the lower row from two bytes
+// before the block, two-byte samples read exactly a row of the block.
+void remap_row(const uint8_t* src, int stride, const uint32_t* taps, const uint16_t* frac,
+               uint8_t* dst, int n, int bpp) {
+  const __m256i vstride = _mm256_set1_epi32(stride);
+  const __m256i low = _mm256_set1_epi32(0xff);
+  const __m256i pairs = _mm256_set1_epi32(0x00ff00ff);
+  const int* top = reinterpret_cast<const int*>(src);
+  const int* bottom = reinterpret_cast<const int*>(src + stride);
+  int i = 0;
+  if (bpp == 4) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i full = _mm256_set1_epi16(256);
+    const __m256i round = _mm256_set1_epi16(128);
+    const int* top1 = reinterpret_cast<const int*>(src + 4);
+    const int* bottom1 = reinterpret_cast<const int*>(src + stride + 4);
+    for (; i + 8 <= n; i += 8) {
+      const __m256i off = tap_offsets(taps + i, vstride, 2);
+      const __m256i a = _mm256_i32gather_epi32(top, off, 1);
+      const __m256i b = _mm256_i32gather_epi32(top1, off, 1);
+      const __m256i c = _mm256_i32gather_epi32(bottom, off, 1);
+      const __m256i d = _mm256_i32gather_epi32(bottom1, off, 1);
+      // Each weight repeated over the four channels of its pixel, ordered
+      // as in lerp_pixels.
+      const __m256i f =
+          _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(frac + i)));
+      __m256i fx = _mm256_and_si256(f, low);
+      __m256i fy = _mm256_srli_epi32(f, 8);
+      fx = _mm256_or_si256(fx, _mm256_slli_epi32(fx, 16));
+      fy = _mm256_or_si256(fy, _mm256_slli_epi32(fy, 16));
+      const __m256i fx_lo = _mm256_unpacklo_epi32(fx, fx);
+      const __m256i fx_hi = _mm256_unpackhi_epi32(fx, fx);
+      const __m256i fy_lo = _mm256_unpacklo_epi32(fy, fy);
+      const __m256i fy_hi = _mm256_unpackhi_epi32(fy, fy);
+      auto lerp = [&](__m256i p, __m256i q, __m256i w) {
+        return _mm256_srli_epi16(
+            _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(p, _mm256_sub_epi16(full, w)),
+                                              _mm256_mullo_epi16(q, w)),
+                             round),
+            8);
+      };
+      const __m256i top_lo =
+          lerp(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero), fx_lo);
+      const __m256i top_hi =
+          lerp(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero), fx_hi);
+      const __m256i bottom_lo =
+          lerp(_mm256_unpacklo_epi8(c, zero), _mm256_unpacklo_epi8(d, zero), fx_lo);
+      const __m256i bottom_hi =
+          lerp(_mm256_unpackhi_epi8(c, zero), _mm256_unpackhi_epi8(d, zero), fx_hi);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4 * i),
+                          _mm256_packus_epi16(lerp(top_lo, bottom_lo, fy_lo),
+                                              lerp(top_hi, bottom_hi, fy_hi)));
+    }
+  } else if (bpp == 2) {
+    for (; i + 8 <= n; i += 8) {
+      const __m256i off = tap_offsets(taps + i, vstride, 1);
+      // Bytes c0 c1 c0' c1' of the left and right sample of each row.
+      const __m256i a = _mm256_i32gather_epi32(top, off, 1);
+      const __m256i c = _mm256_i32gather_epi32(bottom, off, 1);
+      const __m256i f =
+          _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(frac + i)));
+      const __m256i wx = weight_pair(_mm256_and_si256(f, low));
+      const __m256i wy = weight_pair(_mm256_srli_epi32(f, 8));
+      const __m256i t0 = lerp_pair(_mm256_and_si256(a, pairs), wx);
+      const __m256i t1 = lerp_pair(_mm256_and_si256(_mm256_srli_epi32(a, 8), pairs), wx);
+      const __m256i b0 = lerp_pair(_mm256_and_si256(c, pairs), wx);
+      const __m256i b1 = lerp_pair(_mm256_and_si256(_mm256_srli_epi32(c, 8), pairs), wx);
+      const __m256i r0 = lerp_pair(_mm256_or_si256(t0, _mm256_slli_epi32(b0, 16)), wy);
+      const __m256i r1 = lerp_pair(_mm256_or_si256(t1, _mm256_slli_epi32(b1, 16)), wy);
+      // packus leaves pixels [0-3, 0-3 | 4-7, 4-7]; the permute gathers
+      // the first quarter of each lane.
+      const __m256i px = _mm256_or_si256(r0, _mm256_slli_epi32(r1, 8));
+      const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(px, px), 0x08);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i), _mm256_castsi256_si128(packed));
+    }
+  } else if (bpp == 1) {
+    const int* bottom_end = reinterpret_cast<const int*>(src + stride - 2);
+    for (; i + 8 <= n; i += 8) {
+      const __m256i off = tap_offsets(taps + i, vstride, 0);
+      // Left and right sample in bytes 0-1 of the top gather and bytes 2-3
+      // of the bottom one.
+      const __m256i a = _mm256_i32gather_epi32(top, off, 1);
+      const __m256i c = _mm256_srli_epi32(_mm256_i32gather_epi32(bottom_end, off, 1), 16);
+      const __m256i f =
+          _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(frac + i)));
+      const __m256i wx = weight_pair(_mm256_and_si256(f, low));
+      const __m256i wy = weight_pair(_mm256_srli_epi32(f, 8));
+      auto spread = [&](__m256i v) {
+        return _mm256_or_si256(_mm256_and_si256(v, low),
+                               _mm256_slli_epi32(_mm256_and_si256(v, _mm256_set1_epi32(0xff00)),
+                                                 8));
+      };
+      const __m256i t = lerp_pair(spread(a), wx);
+      const __m256i b = lerp_pair(spread(c), wx);
+      const __m256i r = lerp_pair(_mm256_or_si256(t, _mm256_slli_epi32(b, 16)), wy);
+      // Pixels [0-3 | 4-7] narrowed to the first four bytes of each lane.
+      __m256i packed = _mm256_packus_epi32(r, r);
+      packed = _mm256_packus_epi16(packed, packed);
+      packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0));
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm256_castsi256_si128(packed));
+    }
+  }
+  scalar::remap_row(src, stride, taps, frac, dst, n, bpp, i);
+}
+
+// Prefix sums of eight uint32 lanes per channel, plus the running sums:
+// in-lane first, then the low lane's totals carried into the high lane.
+inline __m256i prefix8(__m256i x, __m256i* carry, int bpp) {
+  if (bpp == 1) {
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+    x = _mm256_add_epi32(x, _mm256_shuffle_epi32(_mm256_permute2x128_si256(x, x, 0x08),
+                                                 _MM_SHUFFLE(3, 3, 3, 3)));
+    x = _mm256_add_epi32(x, *carry);
+    *carry = _mm256_permutevar8x32_epi32(x, _mm256_set1_epi32(7));
+  } else if (bpp == 2) {
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+    x = _mm256_add_epi32(x, _mm256_shuffle_epi32(_mm256_permute2x128_si256(x, x, 0x08),
+                                                 _MM_SHUFFLE(3, 2, 3, 2)));
+    x = _mm256_add_epi32(x, *carry);
+    *carry = _mm256_permutevar8x32_epi32(x, _mm256_setr_epi32(6, 7, 6, 7, 6, 7, 6, 7));
+  } else {
+    x = _mm256_add_epi32(x, _mm256_permute2x128_si256(x, x, 0x08));
+    x = _mm256_add_epi32(x, *carry);
+    *carry = _mm256_permute2x128_si256(x, x, 0x11);
+  }
+  return x;
+}
+
+void integral_row(const uint8_t* src, const uint32_t* above, uint32_t* dst, int n, int bpp) {
+  int i = 0;
+  if (bpp == 1 || bpp == 2 || bpp == 4) {
+    __m256i carry = _mm256_setzero_si256();
+    for (; i + 16 <= n; i += 16) {
+      const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      const __m256i x0 = prefix8(_mm256_cvtepu8_epi32(s), &carry, bpp);
+      const __m256i x1 = prefix8(_mm256_cvtepu8_epi32(_mm_srli_si128(s, 8)), &carry, bpp);
+      const __m256i* a = reinterpret_cast<const __m256i*>(above + i);
+      __m256i* d = reinterpret_cast<__m256i*>(dst + i);
+      _mm256_storeu_si256(d, _mm256_add_epi32(_mm256_loadu_si256(a), x0));
+      _mm256_storeu_si256(d + 1, _mm256_add_epi32(_mm256_loadu_si256(a + 1), x1));
+    }
+  }
+  scalar::integral_row(src, above, dst, n, bpp, i);
+}
+
+inline __m256i box_mean8(const uint32_t* top, const uint32_t* bottom, int width, __m256 scale,
+                         __m256 half) {
+  const __m256i t0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(top));
+  const __m256i t1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(top + width));
+  const __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bottom));
+  const __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bottom + width));
+  const __m256i sum = _mm256_add_epi32(_mm256_sub_epi32(_mm256_sub_epi32(b1, b0), t1), t0);
+  return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(sum), scale), half));
+}
+
+void box_mean_row(const uint32_t* top, const uint32_t* bottom, int width, uint8_t* dst, int n,
+                  float scale) {
+  const __m256 vscale = _mm256_set1_ps(scale);
+  const __m256 half = _mm256_set1_ps(0.5f);
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  int i = 0;
+  for (; i + 32 <= n; i += 32) {
+    const __m256i m0 = box_mean8(top + i, bottom + i, width, vscale, half);
+    const __m256i m1 = box_mean8(top + i + 8, bottom + i + 8, width, vscale, half);
+    const __m256i m2 = box_mean8(top + i + 16, bottom + i + 16, width, vscale, half);
+    const __m256i m3 = box_mean8(top + i + 24, bottom + i + 24, width, vscale, half);
+    // Packing works per 128-bit lane; the permute restores pixel order.
+    const __m256i packed =
+        _mm256_packus_epi16(_mm256_packus_epi32(m0, m1), _mm256_packus_epi32(m2, m3));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                        _mm256_permutevar8x32_epi32(packed, order));
+  }
+  scalar::box_mean_row(top, bottom, width, dst, n, scale, i);
+}
+
+
+inline __m256 load_q16(const int16_t* src, __m256 scale) {
+  const __m128i q = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+  return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(q)), scale);
+}
+
+inline void store_q16(int16_t* dst, __m256 value, __m256 scale) {
+  const __m256i q = _mm256_cvtps_epi32(_mm256_mul_ps(value, scale));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+                   _mm_packs_epi32(_mm256_castsi256_si128(q), _mm256_extracti128_si256(q, 1)));
+}
+
+void mixture_update(const uint8_t* src, int16_t* model, size_t plane, uint8_t* fg, int n,
+                    const MixtureParams& params) {
+  constexpr int kK = kMixtureComponents;
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 ones = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+  const __m256 alpha = _mm256_set1_ps(params.alpha);
+  const __m256 keep = _mm256_set1_ps(1.0f - params.alpha);
+  const __m256 threshold = _mm256_set1_ps(params.threshold);
+  const __m256 init_var = _mm256_set1_ps(params.init_var);
+  const __m256 min_var = _mm256_set1_ps(params.min_var);
+  const __m256 max_var = _mm256_set1_ps(params.max_var);
+  const __m256 background = _mm256_set1_ps(params.background_weight);
+  const __m256 mean_in = _mm256_set1_ps(1.0f / kMixtureMeanScale);
+  const __m256 var_in = _mm256_set1_ps(1.0f / kMixtureVarScale);
+  const __m256 weight_in = _mm256_set1_ps(1.0f / kMixtureWeightScale);
+  const __m256 mean_out = _mm256_set1_ps(kMixtureMeanScale);
+  const __m256 var_out = _mm256_set1_ps(kMixtureVarScale);
+  const __m256 weight_out = _mm256_set1_ps(kMixtureWeightScale);
+
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256 x = _mm256_cvtepi32_ps(
+        _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i))));
+    __m256 m[kK], v[kK], w[kK], sel[kK];
+    for (int k = 0; k < kK; k++) {
+      m[k] = load_q16(model + (3 * k) * plane + i, mean_in);
+      v[k] = load_q16(model + (3 * k + 1) * plane + i, var_in);
+      w[k] = load_q16(model + (3 * k + 2) * plane + i, weight_in);
+    }
+
+    // Heaviest matching component, as a one-hot lane mask per component.
+    __m256 best_w = zero;
+    for (int k = 0; k < kK; k++) {
+      const __m256 d = _mm256_sub_ps(x, m[k]);
+      const __m256 match = _mm256_cmp_ps(_mm256_mul_ps(d, d), _mm256_mul_ps(threshold, v[k]),
+                                         _CMP_LT_OQ);
+      const __m256 c = _mm256_and_ps(match, _mm256_cmp_ps(w[k], best_w, _CMP_GT_OQ));
+      best_w = _mm256_blendv_ps(best_w, w[k], c);
+      for (int j = 0; j < k; j++)
+        sel[j] = _mm256_andnot_ps(c, sel[j]);
+      sel[k] = c;
+    }
+
+    __m256 matched = zero;
+    __m256 w_best = zero;
+    for (int k = 0; k < kK; k++) {
+      w[k] = _mm256_add_ps(_mm256_mul_ps(w[k], keep), _mm256_and_ps(sel[k], alpha));
+      matched = _mm256_or_ps(matched, sel[k]);
+      w_best = _mm256_or_ps(w_best, _mm256_and_ps(sel[k], w[k]));
+    }
+
+    const __m256 rho = _mm256_div_ps(alpha, _mm256_max_ps(w_best, alpha));
+    for (int k = 0; k < kK; k++) {
+      const __m256 d = _mm256_sub_ps(x, m[k]);
+      const __m256 mean = _mm256_add_ps(m[k], _mm256_mul_ps(rho, d));
+      const __m256 step = _mm256_mul_ps(rho, _mm256_sub_ps(_mm256_mul_ps(d, d), v[k]));
+      __m256 var = _mm256_add_ps(v[k], step);
+      var = _mm256_min_ps(_mm256_max_ps(var, min_var), max_var);
+      m[k] = _mm256_blendv_ps(m[k], mean, sel[k]);
+      v[k] = _mm256_blendv_ps(v[k], var, sel[k]);
+    }
+
+    // Unmatched samples replace the lightest component.
+    __m256 low_w = w[0];
+    sel[0] = ones;
+    for (int k = 1; k < kK; k++) {
+      const __m256 c = _mm256_cmp_ps(w[k], low_w, _CMP_LT_OQ);
+      low_w = _mm256_blendv_ps(low_w, w[k], c);
+      for (int j = 0; j < k; j++)
+        sel[j] = _mm256_andnot_ps(c, sel[j]);
+      sel[k] = c;
+    }
+    for (int k = 0; k < kK; k++) {
+      const __m256 r = _mm256_andnot_ps(matched, sel[k]);
+      m[k] = _mm256_blendv_ps(m[k], x, r);
+      v[k] = _mm256_blendv_ps(v[k], init_var, r);
+      w[k] = _mm256_blendv_ps(w[k], alpha, r);
+      store_q16(model + (3 * k) * plane + i, m[k], mean_out);
+      store_q16(model + (3 * k + 1) * plane + i, v[k], var_out);
+      store_q16(model + (3 * k + 2) * plane + i, w[k], weight_out);
+    }
+
+    const __m256 light = _mm256_cmp_ps(w_best, background, _CMP_LT_OQ);
+    const __m256i f = _mm256_castps_si256(_mm256_or_ps(_mm256_andnot_ps(matched, ones), light));
+    const __m128i f16 = _mm_packs_epi32(_mm256_castsi256_si128(f), _mm256_extracti128_si256(f, 1));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(fg + i), _mm_packs_epi16(f16, f16));
+  }
+  scalar::mixture_update(src, model, plane, fg, n, params, i);
+}
+
+inline float horizontal_sum(__m256 v) {
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+  return _mm_cvtss_f32(s);
+}
+
+inline int32_t horizontal_sum(__m256i v) {
+  __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(s);
+}
+
+void dot_rows_f32(const float* query, const float* rows, size_t stride, int count, int n,
+                  float* out) {
+  for (int r = 0; r < count; r++) {
+    const float* row = rows + r * stride;
+    __m256 s0 = _mm256_setzero_ps();
+    __m256 s1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+      s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_loadu_ps(query + i), _mm256_loadu_ps(row + i)));
+      s1 = _mm256_add_ps(
+          s1, _mm256_mul_ps(_mm256_loadu_ps(query + i + 8), _mm256_loadu_ps(row + i + 8)));
+    }
+    if (i + 8 <= n) {
+      s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_loadu_ps(query + i), _mm256_loadu_ps(row + i)));
+      i += 8;
+    }
+    out[r] = horizontal_sum(_mm256_add_ps(s0, s1)) + scalar::dot_f32(query, row, n, i);
+  }
+}
+
+// As the SSE4.1 version: |a| * (b with the sign of a) through maddubs.
+void dot_rows_s8(const int8_t* query, const int8_t* rows, size_t stride, int count, int n,
+                 int32_t* out) {
+  const __m256i ones = _mm256_set1_epi16(1);
+  for (int r = 0; r < count; r++) {
+    const int8_t* row = rows + r * stride;
+    __m256i sum = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+      const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(query + i));
+      const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+      const __m256i p = _mm256_maddubs_epi16(_mm256_sign_epi8(a, a), _mm256_sign_epi8(b, a));
+      sum = _mm256_add_epi32(sum, _mm256_madd_epi16(p, ones));
+    }
+    out[r] = horizontal_sum(sum) + scalar::dot_s8(query, row, n, i);
+  }
+}
+
+}  // namespace
+
+const Kernels& avx2_kernels() {
+  static const Kernels table = [] {
+    Kernels k = scalar_kernels();
+    k.level = SimdLevel::kAvx2;
+    k.yuv_to_rgb_row = yuv_to_rgb_row;
+    k.rgb_to_y_row = rgb_to_y_row;
+    k.rgb_to_uv_row = rgb_to_uv_row;
+    k.split_uv_row = split_uv_row;
+    k.merge_uv_row = merge_uv_row;
+    k.swizzle_rgb_row = swizzle_rgb_row;
+    k.lerp_row = lerp_row;
+    k.blend_row = blend_row;
+    k.fill_span = fill_span;
+    k.blend_span = blend_span;
+    k.blend_mask_span = blend_mask_span;
+    k.iou_row = iou_row;
+    k.kalman_predict = kalman_predict;
+    k.kalman_update = kalman_update;
+    k.planar_f32_row = planar_f32_row;
+    k.argmax_rows = argmax_rows;
+    k.select_above = select_above;
+    k.accumulate_row = accumulate_row;
+    k.sad_row = sad_row;
+    k.lerp_pixels = lerp_pixels;
+    k.remap_row = remap_row;
+    k.integral_row = integral_row;
+    k.box_mean_row = box_mean_row;
+    k.mixture_update = mixture_update;
+    k.dot_rows_f32 = dot_rows_f32;
+    k.dot_rows_s8 = dot_rows_s8;
+    return k;
+  }();
+  return table;
+}
+
+}  // namespace simd
+}  // namespace nvgst
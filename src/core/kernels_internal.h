@@ -0,0 +1,78 @@
+// Private to the kernel translation units: scalar entry points reused for
+// SIMD loop tails, and the per-level table getters.
+#pragma once
+
+#include "core/kernels.h"
+
+namespace nvgst {
+namespace simd {
+
+// One span pixel repeated to fill 32 bits, so that byte i of a span is
+// byte (i & 3) of the result for every bpp.
+inline uint32_t replicate_pattern(uint32_t pattern, int bpp) {
+  if (bpp == 1)
+    return (pattern & 0xff) * 0x01010101u;
+  if (bpp == 2)
+    return (pattern & 0xffff) * 0x00010001u;
+  return pattern;
+}
+
+namespace scalar {
+
+void yuv_to_rgb_row(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width,
+                    const YuvToRgbCoeffs& c, bool bgr, int x_begin = 0);
+void rgb_to_y_row(const uint8_t* src, uint8_t* y, int width, const RgbToYuvCoeffs& c, bool bgr,
+                  int x_begin = 0);
+void rgb_to_uv_row(const uint8_t* src0, const uint8_t* src1, uint8_t* u, uint8_t* v, int width,
+                   const RgbToYuvCoeffs& c, bool bgr, int cx_begin = 0);
+void split_uv_row(const uint8_t* uv, uint8_t* u, uint8_t* v, int n, int begin = 0);
+void merge_uv_row(const uint8_t* u, const uint8_t* v, uint8_t* uv, int n, int begin = 0);
+void swizzle_rgb_row(const uint8_t* src, uint8_t* dst, int n, bool swap_rb, int begin = 0);
+void lerp_row(const uint8_t* a, const uint8_t* b, uint8_t* dst, int n, int frac, int begin = 0);
+void blend_row(const uint8_t* src, uint8_t* dst, int n, int alpha, bool swap_rb, int begin = 0);
+void fill_span(uint8_t* dst, int n, uint32_t pattern, int bpp, int begin = 0);
+void blend_span(uint8_t* dst, int n, uint32_t pattern, int bpp, int alpha, int begin = 0);
+void blend_mask_span(uint8_t* dst, const uint8_t* mask, int n, uint32_t pattern, int bpp, int alpha,
+                     int begin = 0);
+void iou_row(const float* x0, const float* y0, const float* x1, const float* y1, int n,
+             const float box[4], float* iou, int begin = 0);
+void kalman_predict(float* pos, float* vel, float* p00, float* p01, float* p11, const float* scale,
+                    float q_pos, float q_vel, int n, int begin = 0);
+void kalman_update(float* pos, float* vel, float* p00, float* p01, float* p11, const float* z,
+                   const float* r, int n, int begin = 0);
+void planar_f32_row(const uint8_t* src, int n, float* c0, float* c1, float* c2, const float offset[3],
+                    const float scale[3], int begin = 0);
+void argmax_rows(const float* rows, size_t stride, int count, int n, float* best, int32_t* index,
+                 int begin = 0);
+int select_above(const float* v, int n, float threshold, int32_t* index, int begin = 0);
+void accumulate_row(const uint8_t* src, uint16_t* acc, int n, int begin = 0);
+uint32_t sad_row(const uint8_t* a, const uint8_t* b, int n, int begin = 0);
+void lerp_pixels(const uint8_t* src, const int32_t* x0, const int32_t* x1, const uint16_t* frac,
+                 uint8_t* dst, int n, int begin = 0);
+void remap_row(const uint8_t* src, int stride, const uint32_t* taps, const uint16_t* frac,
+               uint8_t* dst, int n, int bpp, int begin = 0);
+void integral_row(const uint8_t* src, const uint32_t* above, uint32_t* dst, int n, int bpp,
+                  int begin = 0);
+void box_mean_row(const uint32_t* top, const uint32_t* bottom, int width, uint8_t* dst, int n,
+                  float scale, int begin = 0);
+void mixture_update(const uint8_t* src, int16_t* model, size_t plane, uint8_t* fg, int n,
+                    const MixtureParams& params, int begin = 0);
+// Dot products of a and b from element begin on, for the tails of SIMD
+// rows; the dot_rows_* functions below start at row begin instead.
+float dot_f32(const float* a, const float* b, int n, int begin = 0);
+int32_t dot_s8(const int8_t* a, const int8_t* b, int n, int begin = 0);
+void dot_rows_f32(const float* query, const float* rows, size_t stride, int count, int n,
+                  float* out, int begin = 0);
+void dot_rows_s8(const int8_t* query, const int8_t* rows, size_t stride, int count, int n,
+                 int32_t* out, int begin = 0);
+
+}  // namespace scalar
+
+const Kernels& scalar_kernels();
+#if defined(NVGST_HAVE_X86_SIMD)
+const Kernels& sse41_kernels();
+const Kernels& avx2_kernels();
+#endif
+
+}  // namespace simd
+}  // namespace nvgst
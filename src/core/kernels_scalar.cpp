@@ -0,0 +1,480 @@
+#include "core/kernels_internal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace nvgst {
+namespace simd {
+
+namespace {
+
+constexpr YuvToRgbCoeffs kYuvToRgb601 = {9539, 13075, 3209, 6660, 16525};
+constexpr YuvToRgbCoeffs kYuvToRgb709 = {9539, 14686, 1747, 4366, 17305};
+
+constexpr RgbToYuvCoeffs kRgbToYuv601 = {2104, 4130, 802, -1214, -2384, 3598, 3598, -3013, -585};
+constexpr RgbToYuvCoeffs kRgbToYuv709 = {1496, 5032, 508, -824, -2774, 3598, 3598, -3268, -330};
+
+inline uint8_t clamp_u8(int v) {
+  return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// t / 255 rounded, for t + 128 <= 65535: exact and cheap in 16-bit lanes.
+inline int div255(int t) {
+  return (t + 128 + ((t + 128) >> 8)) >> 8;
+}
+
+}  // namespace
+
+const YuvToRgbCoeffs& yuv_to_rgb_coeffs(ColorMatrix matrix) {
+  return matrix == ColorMatrix::kBT709 ? kYuvToRgb709 : kYuvToRgb601;
+}
+
+const RgbToYuvCoeffs& rgb_to_yuv_coeffs(ColorMatrix matrix) {
+  return matrix == ColorMatrix::kBT709 ? kRgbToYuv709 : kRgbToYuv601;
+}
+
+namespace scalar {
+
+void yuv_to_rgb_row(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width,
+                    const YuvToRgbCoeffs& c, bool bgr, int x_begin) {
+  const int ri = bgr ? 2 : 0;
+  const int bi = bgr ? 0 : 2;
+  for (int x = x_begin; x < width; x++) {
+    int yy = c.cy * (y[x] - 16);
+    int uu = u[x >> 1] - 128;
+    int vv = v[x >> 1] - 128;
+    uint8_t* px = dst + 4 * x;
+    px[ri] = clamp_u8((yy + c.crv * vv + 4096) >> 13);
+    px[1] = clamp_u8((yy - c.cgu * uu - c.cgv * vv + 4096) >> 13);
+    px[bi] = clamp_u8((yy + c.cbu * uu + 4096) >> 13);
+    px[3] = 0xff;
+  }
+}
+
+void rgb_to_y_row(const uint8_t* src, uint8_t* y, int width, const RgbToYuvCoeffs& c, bool bgr,
+                  int x_begin) {
+  const int ri = bgr ? 2 : 0;
+  const int bi = bgr ? 0 : 2;
+  for (int x = x_begin; x < width; x++) {
+    const uint8_t* px = src + 4 * x;
+    int sum = c.yr * px[ri] + c.yg * px[1] + c.yb * px[bi];
+    y[x] = clamp_u8((sum + (16 << 13) + 4096) >> 13);
+  }
+}
+
+void rgb_to_uv_row(const uint8_t* src0, const uint8_t* src1, uint8_t* u, uint8_t* v, int width,
+                   const RgbToYuvCoeffs& c, bool bgr, int cx_begin) {
+  const int ri = bgr ? 2 : 0;
+  const int bi = bgr ? 0 : 2;
+  const int cw = (width + 1) / 2;
+  for (int cx = cx_begin; cx < cw; cx++) {
+    int x0 = 2 * cx;
+    int x1 = x0 + 1 < width ? x0 + 1 : x0;
+    const uint8_t* a0 = src0 + 4 * x0;
+    const uint8_t* a1 = src0 + 4 * x1;
+    const uint8_t* b0 = src1 + 4 * x0;
+    const uint8_t* b1 = src1 + 4 * x1;
+    int r = a0[ri] + a1[ri] + b0[ri] + b1[ri];
+    int g = a0[1] + a1[1] + b0[1] + b1[1];
+    int b = a0[bi] + a1[bi] + b0[bi] + b1[bi];
+    u[cx] = clamp_u8((c.ur * r + c.ug * g + c.ub * b + (128 << 15) + (1 << 14)) >> 15);
+    v[cx] = clamp_u8((c.vr * r + c.vg * g + c.vb * b + (128 << 15) + (1 << 14)) >> 15);
+  }
+}
+
+void split_uv_row(const uint8_t* uv, uint8_t* u, uint8_t* v, int n, int begin) {
+  for (int i = begin; i < n; i++) {
+    u[i] = uv[2 * i];
+    v[i] = uv[2 * i + 1];
+  }
+}
+
+void merge_uv_row(const uint8_t* u, const uint8_t* v, uint8_t* uv, int n, int begin) {
+  for (int i = begin; i < n; i++) {
+    uv[2 * i] = u[i];
+    uv[2 * i + 1] = v[i];
+  }
+}
+
+void swizzle_rgb_row(const uint8_t* src, uint8_t* dst, int n, bool swap_rb, int begin) {
+  const int ri = swap_rb ? 2 : 0;
+  const int bi = swap_rb ? 0 : 2;
+  for (int i = begin; i < n; i++) {
+    const uint8_t* s = src + 4 * i;
+    uint8_t* d = dst + 4 * i;
+    uint8_t r = s[ri];
+    uint8_t g = s[1];
+    uint8_t b = s[bi];
+    d[0] = r;
+    d[1] = g;
+    d[2] = b;
+    d[3] = 0xff;
+  }
+}
+
+void lerp_row(const uint8_t* a, const uint8_t* b, uint8_t* dst, int n, int frac, int begin) {
+  const int inv = 256 - frac;
+  for (int i = begin; i < n; i++)
+    dst[i] = static_cast<uint8_t>((a[i] * inv + b[i] * frac + 128) >> 8);
+}
+
+void blend_row(const uint8_t* src, uint8_t* dst, int n, int alpha, bool swap_rb, int begin) {
+  const int ri = swap_rb ? 2 : 0;
+  const int bi = swap_rb ? 0 : 2;
+  for (int i = begin; i < n; i++) {
+    const uint8_t* s = src + 4 * i;
+    uint8_t* d = dst + 4 * i;
+    const int a = div255(s[3] * alpha);
+    const int ia = 255 - a;
+    d[0] = static_cast<uint8_t>(div255(s[ri] * a + d[0] * ia));
+    d[1] = static_cast<uint8_t>(div255(s[1] * a + d[1] * ia));
+    d[2] = static_cast<uint8_t>(div255(s[bi] * a + d[2] * ia));
+    d[3] = 0xff;
+  }
+}
+
+void fill_span(uint8_t* dst, int n, uint32_t pattern, int bpp, int begin) {
+  const uint32_t p = replicate_pattern(pattern, bpp);
+  for (int i = begin * bpp; i < n * bpp; i++)
+    dst[i] = static_cast<uint8_t>(p >> (8 * (i & 3)));
+}
+
+void blend_span(uint8_t* dst, int n, uint32_t pattern, int bpp, int alpha, int begin) {
+  const uint32_t p = replicate_pattern(pattern, bpp);
+  const int ia = 255 - alpha;
+  for (int i = begin * bpp; i < n * bpp; i++) {
+    const int c = (p >> (8 * (i & 3))) & 0xff;
+    dst[i] = static_cast<uint8_t>(div255(c * alpha + dst[i] * ia));
+  }
+}
+
+void blend_mask_span(uint8_t* dst, const uint8_t* mask, int n, uint32_t pattern, int bpp, int alpha,
+                     int begin) {
+  for (int x = begin; x < n; x++) {
+    const int a = div255(mask[x] * alpha);
+    const int ia = 255 - a;
+    for (int k = 0; k < bpp; k++) {
+      uint8_t* d = dst + x * bpp + k;
+      const int c = (pattern >> (8 * k)) & 0xff;
+      *d = static_cast<uint8_t>(div255(c * a + *d * ia));
+    }
+  }
+}
+
+void iou_row(const float* x0, const float* y0, const float* x1, const float* y1, int n,
+             const float box[4], float* iou, int begin) {
+  const float box_area = (box[2] - box[0]) * (box[3] - box[1]);
+  for (int i = begin; i < n; i++) {
+    const float iw = std::max(0.0f, std::min(x1[i], box[2]) - std::max(x0[i], box[0]));
+    const float ih = std::max(0.0f, std::min(y1[i], box[3]) - std::max(y0[i], box[1]));
+    const float inter = iw * ih;
+    const float area = (x1[i] - x0[i]) * (y1[i] - y0[i]);
+    const float uni = area + box_area - inter;
+    iou[i] = uni > 0.0f ? inter / uni : 0.0f;
+  }
+}
+
+void kalman_predict(float* pos, float* vel, float* p00, float* p01, float* p11, const float* scale,
+                    float q_pos, float q_vel, int n, int begin) {
+  for (int i = begin; i < n; i++) {
+    const float s2 = scale[i] * scale[i];
+    pos[i] = pos[i] + vel[i];
+    p00[i] = p00[i] + 2.0f * p01[i] + p11[i] + q_pos * s2;
+    p01[i] = p01[i] + p11[i];
+    p11[i] = p11[i] + q_vel * s2;
+  }
+}
+
+void kalman_update(float* pos, float* vel, float* p00, float* p01, float* p11, const float* z,
+                   const float* r, int n, int begin) {
+  for (int i = begin; i < n; i++) {
+    const float s = p00[i] + r[i];
+    const float k0 = p00[i] / s;
+    const float k1 = p01[i] / s;
+    const float y = z[i] - pos[i];
+    pos[i] = pos[i] + k0 * y;
+    vel[i] = vel[i] + k1 * y;
+    p11[i] = p11[i] - k1 * p01[i];
+    p01[i] = p01[i] - k0 * p01[i];
+    p00[i] = p00[i] - k0 * p00[i];
+  }
+}
+
+void planar_f32_row(const uint8_t* src, int n, float* c0, float* c1, float* c2, const float offset[3],
+                    const float scale[3], int begin) {
+  for (int i = begin; i < n; i++) {
+    const uint8_t* p = src + 4 * i;
+    c0[i] = (static_cast<float>(p[0]) - offset[0]) * scale[0];
+    c1[i] = (static_cast<float>(p[1]) - offset[1]) * scale[1];
+    c2[i] = (static_cast<float>(p[2]) - offset[2]) * scale[2];
+  }
+}
+
+void argmax_rows(const float* rows, size_t stride, int count, int n, float* best, int32_t* index,
+                 int begin) {
+  for (int i = begin; i < n; i++) {
+    float b = rows[i];
+    int32_t k = 0;
+    for (int r = 1; r < count; r++) {
+      const float v = rows[r * stride + i];
+      if (v > b) {
+        b = v;
+        k = r;
+      }
+    }
+    best[i] = b;
+    index[i] = k;
+  }
+}
+
+int select_above(const float* v, int n, float threshold, int32_t* index, int begin) {
+  int count = 0;
+  for (int i = begin; i < n; i++) {
+    if (v[i] >= threshold)
+      index[count++] = i;
+  }
+  return count;
+}
+
+void accumulate_row(const uint8_t* src, uint16_t* acc, int n, int begin) {
+  for (int i = begin; i < n; i++)
+    acc[i] = static_cast<uint16_t>(acc[i] + src[i]);
+}
+
+uint32_t sad_row(const uint8_t* a, const uint8_t* b, int n, int begin) {
+  uint32_t sum = 0;
+  for (int i = begin; i < n; i++)
+    sum += static_cast<uint32_t>(std::abs(a[i] - b[i]));
+  return sum;
+}
+
+void lerp_pixels(const uint8_t* src, const int32_t* x0, const int32_t* x1, const uint16_t* frac,
+                 uint8_t* dst, int n, int begin) {
+  for (int i = begin; i < n; i++) {
+    const uint8_t* a = src + x0[i];
+    const uint8_t* b = src + x1[i];
+    const int f = frac[i];
+    const int inv = 256 - f;
+    for (int c = 0; c < 4; c++)
+      dst[4 * i + c] = static_cast<uint8_t>((a[c] * inv + b[c] * f + 128) >> 8);
+  }
+}
+
+void remap_row(const uint8_t* src, int stride, const uint32_t* taps, const uint16_t* frac,
+               uint8_t* dst, int n, int bpp, int begin) {
+  for (int i = begin; i < n; i++) {
+    const uint8_t* a = src + static_cast<ptrdiff_t>(taps[i] >> 16) * stride +
+                       static_cast<ptrdiff_t>(taps[i] & 0xffff) * bpp;
+    const uint8_t* c = a + stride;
+    const int fx = frac[i] & 0xff;
+    const int fy = frac[i] >> 8;
+    for (int k = 0; k < bpp; k++) {
+      const int top = (a[k] * (256 - fx) + a[bpp + k] * fx + 128) >> 8;
+      const int bottom = (c[k] * (256 - fx) + c[bpp + k] * fx + 128) >> 8;
+      dst[bpp * i + k] = static_cast<uint8_t>((top * (256 - fy) + bottom * fy + 128) >> 8);
+    }
+  }
+}
+
+void integral_row(const uint8_t* src, const uint32_t* above, uint32_t* dst, int n, int bpp,
+                  int begin) {
+  // Running sums per channel, picked up from what is already written.
+  uint32_t run[4] = {0, 0, 0, 0};
+  for (int c = 0; c < bpp && begin - bpp + c >= 0; c++)
+    run[c] = dst[begin - bpp + c] - above[begin - bpp + c];
+  for (int i = begin; i < n; i++) {
+    uint32_t& r = run[(i - begin) % bpp];
+    r += src[i];
+    dst[i] = above[i] + r;
+  }
+}
+
+void box_mean_row(const uint32_t* top, const uint32_t* bottom, int width, uint8_t* dst, int n,
+                  float scale, int begin) {
+  for (int i = begin; i < n; i++) {
+    const uint32_t sum = bottom[i + width] - bottom[i] - top[i + width] + top[i];
+    const float mean = static_cast<float>(static_cast<int32_t>(sum)) * scale + 0.5f;
+    dst[i] = static_cast<uint8_t>(static_cast<int>(mean));
+  }
+}
+
+void mixture_update(const uint8_t* src, int16_t* model, size_t plane, uint8_t* fg, int n,
+                    const MixtureParams& params, int begin) {
+  constexpr int kK = kMixtureComponents;
+  const float keep = 1.0f - params.alpha;
+  // Rounds to nearest even like cvtps2dq, saturating like packssdw.
+  auto store = [](float value) {
+    return static_cast<int16_t>(std::min(std::max(std::lrint(value), -32768L), 32767L));
+  };
+
+  for (int i = begin; i < n; i++) {
+    const float x = static_cast<float>(src[i]);
+    float m[kK], v[kK], w[kK];
+    for (int k = 0; k < kK; k++) {
+      m[k] = static_cast<float>(model[(3 * k) * plane + i]) * (1.0f / kMixtureMeanScale);
+      v[k] = static_cast<float>(model[(3 * k + 1) * plane + i]) * (1.0f / kMixtureVarScale);
+      w[k] = static_cast<float>(model[(3 * k + 2) * plane + i]) * (1.0f / kMixtureWeightScale);
+    }
+
+    int best = -1;
+    float best_w = 0.0f;
+    for (int k = 0; k < kK; k++) {
+      const float d = x - m[k];
+      if (d * d < params.threshold * v[k] && w[k] > best_w) {
+        best = k;
+        best_w = w[k];
+      }
+    }
+
+    for (int k = 0; k < kK; k++) {
+      w[k] = w[k] * keep;
+      if (k == best)
+        w[k] = w[k] + params.alpha;
+    }
+
+    float w_best = 0.0f;
+    if (best >= 0) {
+      w_best = w[best];
+      const float rho = params.alpha / std::max(w_best, params.alpha);
+      const float d = x - m[best];
+      m[best] = m[best] + rho * d;
+      const float var = v[best] + rho * (d * d - v[best]);
+      v[best] = std::min(std::max(var, params.min_var), params.max_var);
+    } else {
+      int low = 0;
+      for (int k = 1; k < kK; k++) {
+        if (w[k] < w[low])
+          low = k;
+      }
+      m[low] = x;
+      v[low] = params.init_var;
+      w[low] = params.alpha;
+    }
+    fg[i] = best < 0 || w_best < params.background_weight ? 0xff : 0;
+
+    for (int k = 0; k < kK; k++) {
+      model[(3 * k) * plane + i] = store(m[k] * kMixtureMeanScale);
+      model[(3 * k + 1) * plane + i] = store(v[k] * kMixtureVarScale);
+      model[(3 * k + 2) * plane + i] = store(w[k] * kMixtureWeightScale);
+    }
+  }
+}
+
+float dot_f32(const float* a, const float* b, int n, int begin) {
+  float sum = 0.0f;
+  for (int i = begin; i < n; i++)
+    sum += a[i] * b[i];
+  return sum;
+}
+
+int32_t dot_s8(const int8_t* a, const int8_t* b, int n, int begin) {
+  int32_t sum = 0;
+  for (int i = begin; i < n; i++)
+    sum += a[i] * b[i];
+  return sum;
+}
+
+void dot_rows_f32(const float* query, const float* rows, size_t stride, int count, int n,
+                  float* out, int begin) {
+  for (int r = begin; r < count; r++)
+    out[r] = dot_f32(query, rows + r * stride, n);
+}
+
+void dot_rows_s8(const int8_t* query, const int8_t* rows, size_t stride, int count, int n,
+                 int32_t* out, int begin) {
+  for (int r = begin; r < count; r++)
+    out[r] = dot_s8(query, rows + r * stride, n);
+}
+
+}  // namespace scalar
+
+const Kernels& scalar_kernels() {
+  static const Kernels table = [] {
+    Kernels k{};
+    k.level = SimdLevel::kScalar;
+    k.yuv_to_rgb_row = [](const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst,
+                          int width, const YuvToRgbCoeffs& c, bool bgr) {
+      scalar::yuv_to_rgb_row(y, u, v, dst, width, c, bgr);
+    };
+    k.rgb_to_y_row = [](const uint8_t* src, uint8_t* y, int width, const RgbToYuvCoeffs& c,
+                        bool bgr) { scalar::rgb_to_y_row(src, y, width, c, bgr); };
+    k.rgb_to_uv_row = [](const uint8_t* src0, const uint8_t* src1, uint8_t* u, uint8_t* v,
+                         int width, const RgbToYuvCoeffs& c, bool bgr) {
+      scalar::rgb_to_uv_row(src0, src1, u, v, width, c, bgr);
+    };
+    k.split_uv_row = [](const uint8_t* uv, uint8_t* u, uint8_t* v, int n) {
+      scalar::split_uv_row(uv, u, v, n);
+    };
+    k.merge_uv_row = [](const uint8_t* u, const uint8_t* v, uint8_t* uv, int n) {
+      scalar::merge_uv_row(u, v, uv, n);
+    };
+    k.swizzle_rgb_row = [](const uint8_t* src, uint8_t* dst, int n, bool swap_rb) {
+      scalar::swizzle_rgb_row(src, dst, n, swap_rb);
+    };
+    k.lerp_row = [](const uint8_t* a, const uint8_t* b, uint8_t* dst, int n, int frac) {
+      scalar::lerp_row(a, b, dst, n, frac);
+    };
+    k.blend_row = [](const uint8_t* src, uint8_t* dst, int n, int alpha, bool swap_rb) {
+      scalar::blend_row(src, dst, n, alpha, swap_rb);
+    };
+    k.fill_span = [](uint8_t* dst, int n, uint32_t pattern, int bpp) {
+      scalar::fill_span(dst, n, pattern, bpp);
+    };
+    k.blend_span = [](uint8_t* dst, int n, uint32_t pattern, int bpp, int alpha) {
+      scalar::blend_span(dst, n, pattern, bpp, alpha);
+    };
+    k.blend_mask_span = [](uint8_t* dst, const uint8_t* mask, int n, uint32_t pattern, int bpp,
+                           int alpha) { scalar::blend_mask_span(dst, mask, n, pattern, bpp, alpha); };
+    k.iou_row = [](const float* x0, const float* y0, const float* x1, const float* y1, int n,
+                   const float box[4], float* iou) { scalar::iou_row(x0, y0, x1, y1, n, box, iou); };
+    k.kalman_predict = [](float* pos, float* vel, float* p00, float* p01, float* p11,
+                          const float* scale, float q_pos, float q_vel, int n) {
+      scalar::kalman_predict(pos, vel, p00, p01, p11, scale, q_pos, q_vel, n);
+    };
+    k.kalman_update = [](float* pos, float* vel, float* p00, float* p01, float* p11, const float* z,
+                         const float* r, int n) {
+      scalar::kalman_update(pos, vel, p00, p01, p11, z, r, n);
+    };
+    k.planar_f32_row = [](const uint8_t* src, int n, float* c0, float* c1, float* c2,
+                          const float offset[3], const float scale[3]) {
+      scalar::planar_f32_row(src, n, c0, c1, c2, offset, scale);
+    };
+    k.argmax_rows = [](const float* rows, size_t stride, int count, int n, float* best,
+                       int32_t* index) { scalar::argmax_rows(rows, stride, count, n, best, index); };
+    k.select_above = [](const float* v, int n, float threshold, int32_t* index) {
+      return scalar::select_above(v, n, threshold, index);
+    };
+    k.accumulate_row = [](const uint8_t* src, uint16_t* acc, int n) {
+      scalar::accumulate_row(src, acc, n);
+    };
+    k.sad_row = [](const uint8_t* a, const uint8_t* b, int n) { return scalar::sad_row(a, b, n); };
+    k.lerp_pixels = [](const uint8_t* src, const int32_t* x0, const int32_t* x1,
+                       const uint16_t* frac, uint8_t* dst, int n) {
+      scalar::lerp_pixels(src, x0, x1, frac, dst, n);
+    };
+    k.remap_row = [](const uint8_t* src, int stride, const uint32_t* taps, const uint16_t* frac,
+                     uint8_t* dst, int n, int bpp) {
+      scalar::remap_row(src, stride, taps, frac, dst, n, bpp);
+    };
+    k.integral_row = [](const uint8_t* src, const uint32_t* above, uint32_t* dst, int n,
+                        int bpp) { scalar::integral_row(src, above, dst, n, bpp); };
+    k.box_mean_row = [](const uint32_t* top, const uint32_t* bottom, int width, uint8_t* dst,
+                        int n, float scale) {
+      scalar::box_mean_row(top, bottom, width, dst, n, scale);
+    };
+    k.mixture_update = [](const uint8_t* src, int16_t* model, size_t plane, uint8_t* fg, int n,
+                          const MixtureParams& params) {
+      scalar::mixture_update(src, model, plane, fg, n, params);
+    };
+    k.dot_rows_f32 = [](const float* query, const float* rows, size_t stride, int count, int n,
+                        float* out) { scalar::dot_rows_f32(query, rows, stride, count, n, out); };
+    k.dot_rows_s8 = [](const int8_t* query, const int8_t* rows, size_t stride, int count, int n,
+                       int32_t* out) { scalar::dot_rows_s8(query, rows, stride, count, n, out); };
+    return k;
+  }();
+  return table;
+}
+
+}  // namespace simd
+}  // namespace nvgst
@@ -0,0 +1,785 @@
+// SSE4.1 kernels. This file is compiled with -msse4.1 and must only be
+// reached through kernels() after runtime detection.
+#include <immintrin.h>
+
+#include <cstring>
+
+#include "core/kernels_internal.h"
+
+namespace nvgst {
+namespace simd {
+
+namespace {
+
+inline __m128i pair16(int lo, int hi) {
+  return _mm_set1_epi32(static_cast<int>(static_cast<uint16_t>(lo) |
+                                         (static_cast<uint32_t>(static_cast<uint16_t>(hi)) << 16)));
+}
+
+// Computes (madd(a:b, ab) + madd(c:d, cd)) >> 13 for eight int16 lanes and
+// returns the eight results as saturated int16.
+inline __m128i dot2x2_q13(__m128i a, __m128i b, __m128i ab, __m128i c, __m128i d, __m128i cd) {
+  __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a, b), ab),
+                             _mm_madd_epi16(_mm_unpacklo_epi16(c, d), cd));
+  __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a, b), ab),
+                             _mm_madd_epi16(_mm_unpackhi_epi16(c, d), cd));
+  return _mm_packs_epi32(_mm_srai_epi32(lo, 13), _mm_srai_epi32(hi, 13));
+}
+
+// Eight pixels of R, G and B as int16 from int16 (Y-16), (U-128), (V-128).
+inline void yuv8_to_rgb16(__m128i y, __m128i u, __m128i v, const __m128i coef[5], __m128i* r,
+                          __m128i* g, __m128i* b) {
+  const __m128i one = _mm_set1_epi16(1);
+  // coef: {cy, crv}, {cy, -cgu}, {-cgv, 4096}, {cy, cbu}, {4096, 0}
+  *r = dot2x2_q13(y, v, coef[0], one, _mm_setzero_si128(), coef[4]);
+  *g = dot2x2_q13(y, u, coef[1], v, one, coef[2]);
+  *b = dot2x2_q13(y, u, coef[3], one, _mm_setzero_si128(), coef[4]);
+}
+
+inline void store_rgbx16(uint8_t* dst, __m128i c0, __m128i c1, __m128i c2) {
+  const __m128i a = _mm_set1_epi8(static_cast<char>(0xff));
+  __m128i c01_lo = _mm_unpacklo_epi8(c0, c1);
+  __m128i c01_hi = _mm_unpackhi_epi8(c0, c1);
+  __m128i c2a_lo = _mm_unpacklo_epi8(c2, a);
+  __m128i c2a_hi = _mm_unpackhi_epi8(c2, a);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi16(c01_lo, c2a_lo));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_unpackhi_epi16(c01_lo, c2a_lo));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 32), _mm_unpacklo_epi16(c01_hi, c2a_hi));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 48), _mm_unpackhi_epi16(c01_hi, c2a_hi));
+}
+
+void yuv_to_rgb_row(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width,
+                    const YuvToRgbCoeffs& c, bool bgr) {
+  const __m128i coef[5] = {pair16(c.cy, c.crv), pair16(c.cy, -c.cgu), pair16(-c.cgv, 4096),
+                           pair16(c.cy, c.cbu), pair16(4096, 0)};
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i y_off = _mm_set1_epi16(16);
+  const __m128i uv_off = _mm_set1_epi16(128);
+
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    __m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x));
+    __m128i u8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + x / 2));
+    __m128i v8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + x / 2));
+    __m128i uu = _mm_unpacklo_epi8(u8, u8);
+    __m128i vv = _mm_unpacklo_epi8(v8, v8);
+
+    __m128i r[2], g[2], b[2];
+    yuv8_to_rgb16(_mm_sub_epi16(_mm_unpacklo_epi8(y8, zero), y_off),
+                  _mm_sub_epi16(_mm_unpacklo_epi8(uu, zero), uv_off),
+                  _mm_sub_epi16(_mm_unpacklo_epi8(vv, zero), uv_off), coef, &r[0], &g[0], &b[0]);
+    yuv8_to_rgb16(_mm_sub_epi16(_mm_unpackhi_epi8(y8, zero), y_off),
+                  _mm_sub_epi16(_mm_unpackhi_epi8(uu, zero), uv_off),
+                  _mm_sub_epi16(_mm_unpackhi_epi8(vv, zero), uv_off), coef, &r[1], &g[1], &b[1]);
+
+    __m128i r8 = _mm_packus_epi16(r[0], r[1]);
+    __m128i g8 = _mm_packus_epi16(g[0], g[1]);
+    __m128i b8 = _mm_packus_epi16(b[0], b[1]);
+    if (bgr)
+      store_rgbx16(dst + 4 * x, b8, g8, r8);
+    else
+      store_rgbx16(dst + 4 * x, r8, g8, b8);
+  }
+  scalar::yuv_to_rgb_row(y, u, v, dst, width, c, bgr, x);
+}
+
+// Sums each pixel's weighted channels: returns four int32 dot products for
+// the four 32-bit pixels in px.
+inline __m128i dot_rgb4(__m128i px, __m128i coef) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), coef);
+  __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), coef);
+  return _mm_hadd_epi32(lo, hi);
+}
+
+inline __m128i rgb_coef(int r, int g, int b, bool bgr) {
+  return bgr ? _mm_setr_epi16(b, g, r, 0, b, g, r, 0) : _mm_setr_epi16(r, g, b, 0, r, g, b, 0);
+}
+
+void rgb_to_y_row(const uint8_t* src, uint8_t* y, int width, const RgbToYuvCoeffs& c, bool bgr) {
+  const __m128i coef = rgb_coef(c.yr, c.yg, c.yb, bgr);
+  const __m128i bias = _mm_set1_epi32((16 << 13) + 4096);
+
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const __m128i* p = reinterpret_cast<const __m128i*>(src + 4 * x);
+    __m128i s[4];
+    for (int i = 0; i < 4; i++)
+      s[i] = _mm_srai_epi32(_mm_add_epi32(dot_rgb4(_mm_loadu_si128(p + i), coef), bias), 13);
+    __m128i out = _mm_packus_epi16(_mm_packs_epi32(s[0], s[1]), _mm_packs_epi32(s[2], s[3]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(y + x), out);
+  }
+  scalar::rgb_to_y_row(src, y, width, c, bgr, x);
+}
+
+// Sums 2x2 blocks of four pixels from two rows into two int16x4 pixels.
+inline __m128i sum_2x2(__m128i a, __m128i b) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+  __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+  lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+  hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+  return _mm_unpacklo_epi64(lo, hi);
+}
+
+void rgb_to_uv_row(const uint8_t* src0, const uint8_t* src1, uint8_t* u, uint8_t* v, int width,
+                   const RgbToYuvCoeffs& c, bool bgr) {
+  const __m128i ucoef = rgb_coef(c.ur, c.ug, c.ub, bgr);
+  const __m128i vcoef = rgb_coef(c.vr, c.vg, c.vb, bgr);
+  const __m128i bias = _mm_set1_epi32((128 << 15) + (1 << 14));
+
+  // 16 pixels (8 chroma samples) per iteration; only full pixel pairs.
+  int cx = 0;
+  for (; 2 * cx + 16 <= width; cx += 8) {
+    const __m128i* p0 = reinterpret_cast<const __m128i*>(src0 + 8 * cx);
+    const __m128i* p1 = reinterpret_cast<const __m128i*>(src1 + 8 * cx);
+    __m128i sum[4];
+    for (int i = 0; i < 4; i++)
+      sum[i] = sum_2x2(_mm_loadu_si128(p0 + i), _mm_loadu_si128(p1 + i));
+
+    __m128i u32[2], v32[2];
+    for (int i = 0; i < 2; i++) {
+      __m128i ua = _mm_madd_epi16(sum[2 * i], ucoef);
+      __m128i ub = _mm_madd_epi16(sum[2 * i + 1], ucoef);
+      __m128i va = _mm_madd_epi16(sum[2 * i], vcoef);
+      __m128i vb = _mm_madd_epi16(sum[2 * i + 1], vcoef);
+      u32[i] = _mm_srai_epi32(_mm_add_epi32(_mm_hadd_epi32(ua, ub), bias), 15);
+      v32[i] = _mm_srai_epi32(_mm_add_epi32(_mm_hadd_epi32(va, vb), bias), 15);
+    }
+    __m128i u16 = _mm_packs_epi32(u32[0], u32[1]);
+    __m128i v16 = _mm_packs_epi32(v32[0], v32[1]);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(u + cx), _mm_packus_epi16(u16, u16));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(v + cx), _mm_packus_epi16(v16, v16));
+  }
+  scalar::rgb_to_uv_row(src0, src1, u, v, width, c, bgr, cx);
+}
+
+void split_uv_row(const uint8_t* uv, uint8_t* u, uint8_t* v, int n) {
+  const __m128i mask = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m128i* p = reinterpret_cast<const __m128i*>(uv + 2 * i);
+    __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(p), mask);
+    __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(p + 1), mask);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(u + i), _mm_unpacklo_epi64(a, b));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(v + i), _mm_unpackhi_epi64(a, b));
+  }
+  scalar::split_uv_row(uv, u, v, n, i);
+}
+
+void merge_uv_row(const uint8_t* u, const uint8_t* v, uint8_t* uv, int n) {
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(u + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i));
+    __m128i* p = reinterpret_cast<__m128i*>(uv + 2 * i);
+    _mm_storeu_si128(p, _mm_unpacklo_epi8(a, b));
+    _mm_storeu_si128(p + 1, _mm_unpackhi_epi8(a, b));
+  }
+  scalar::merge_uv_row(u, v, uv, n, i);
+}
+
+void swizzle_rgb_row(const uint8_t* src, uint8_t* dst, int n, bool swap_rb) {
+  const __m128i mask = swap_rb
+                           ? _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15)
+                           : _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000u));
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+    px = _mm_or_si128(_mm_shuffle_epi8(px, mask), alpha);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * i), px);
+  }
+  scalar::swizzle_rgb_row(src, dst, n, swap_rb, i);
+}
+
+void lerp_row(const uint8_t* a, const uint8_t* b, uint8_t* dst, int n, int frac) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i wa = _mm_set1_epi16(static_cast<int16_t>(256 - frac));
+  const __m128i wb = _mm_set1_epi16(static_cast<int16_t>(frac));
+  const __m128i round = _mm_set1_epi16(128);
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), wa),
+                               _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wb));
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), wa),
+                               _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), wb));
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+  }
+  scalar::lerp_row(a, b, dst, n, frac, i);
+}
+
+// (t + 128) / 255 rounded, as in the scalar kernel.
+inline __m128i div255(__m128i t) {
+  t = _mm_add_epi16(t, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// Two pixels widened to 16 bits: source alpha scaled by the global alpha,
+// then the blend itself.
+inline __m128i blend_px2(__m128i s, __m128i d, __m128i alpha) {
+  __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xff), 0xff);
+  a = div255(_mm_mullo_epi16(a, alpha));
+  const __m128i ia = _mm_sub_epi16(_mm_set1_epi16(255), a);
+  return div255(_mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(d, ia)));
+}
+
+void blend_row(const uint8_t* src, uint8_t* dst, int n, int alpha, bool swap_rb) {
+  const __m128i mask = swap_rb
+                           ? _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15)
+                           : _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i va = _mm_set1_epi16(static_cast<int16_t>(alpha));
+  const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xff000000u));
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + 4 * i));
+    s = _mm_shuffle_epi8(s, mask);
+    __m128i lo = blend_px2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero), va);
+    __m128i hi = blend_px2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero), va);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * i),
+                     _mm_or_si128(_mm_packus_epi16(lo, hi), opaque));
+  }
+  scalar::blend_row(src, dst, n, alpha, swap_rb, i);
+}
+
+void fill_span(uint8_t* dst, int n, uint32_t pattern, int bpp) {
+  const __m128i p = _mm_set1_epi32(static_cast<int>(replicate_pattern(pattern, bpp)));
+  const int bytes = n * bpp;
+  int i = 0;
+  for (; i + 16 <= bytes; i += 16)
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), p);
+  scalar::fill_span(dst, n, pattern, bpp, i / bpp);
+}
+
+void blend_span(uint8_t* dst, int n, uint32_t pattern, int bpp, int alpha) {
+  const __m128i zero = _mm_setzero_si128();
+  // The pattern repeats every 4 bytes, so both unpacked halves match it.
+  const __m128i p = _mm_unpacklo_epi8(
+      _mm_set1_epi32(static_cast<int>(replicate_pattern(pattern, bpp))), zero);
+  const __m128i pa = _mm_mullo_epi16(p, _mm_set1_epi16(static_cast<int16_t>(alpha)));
+  const __m128i ia = _mm_set1_epi16(static_cast<int16_t>(255 - alpha));
+  const int bytes = n * bpp;
+  int i = 0;
+  for (; i + 16 <= bytes; i += 16) {
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+    __m128i lo = div255(_mm_add_epi16(pa, _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), ia)));
+    __m128i hi = div255(_mm_add_epi16(pa, _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), ia)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+  }
+  scalar::blend_span(dst, n, pattern, bpp, alpha, i / bpp);
+}
+
+// 16 bytes of coverage, one per destination byte, for 16 / bpp pixels.
+inline __m128i expand_mask(const uint8_t* mask, int bpp) {
+  if (bpp == 1)
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask));
+  if (bpp == 2)
+    return _mm_shuffle_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(mask)),
+                            _mm_setr_epi8(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7));
+  int m;
+  std::memcpy(&m, mask, sizeof(m));
+  return _mm_shuffle_epi8(_mm_cvtsi32_si128(m),
+                          _mm_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3));
+}
+
+inline __m128i blend_mask16(__m128i p, __m128i m, __m128i d, __m128i alpha) {
+  const __m128i a = div255(_mm_mullo_epi16(m, alpha));
+  const __m128i ia = _mm_sub_epi16(_mm_set1_epi16(255), a);
+  return div255(_mm_add_epi16(_mm_mullo_epi16(p, a), _mm_mullo_epi16(d, ia)));
+}
+
+void blend_mask_span(uint8_t* dst, const uint8_t* mask, int n, uint32_t pattern, int bpp,
+                     int alpha) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i p = _mm_unpacklo_epi8(
+      _mm_set1_epi32(static_cast<int>(replicate_pattern(pattern, bpp))), zero);
+  const __m128i va = _mm_set1_epi16(static_cast<int16_t>(alpha));
+  const int step = 16 / bpp;
+  int x = 0;
+  for (; x + step <= n; x += step) {
+    uint8_t* d8 = dst + x * bpp;
+    const __m128i m = expand_mask(mask + x, bpp);
+    const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(d8));
+    __m128i lo = blend_mask16(p, _mm_unpacklo_epi8(m, zero), _mm_unpacklo_epi8(d, zero), va);
+    __m128i hi = blend_mask16(p, _mm_unpackhi_epi8(m, zero), _mm_unpackhi_epi8(d, zero), va);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d8), _mm_packus_epi16(lo, hi));
+  }
+  scalar::blend_mask_span(dst, mask, n, pattern, bpp, alpha, x);
+}
+
+// Operand order of the min/max calls matches std::min/std::max, so equal
+// inputs (including signed zeros) pick the same value as the scalar code.
+void iou_row(const float* x0, const float* y0, const float* x1, const float* y1, int n,
+             const float box[4], float* iou) {
+  const __m128 bx0 = _mm_set1_ps(box[0]);
+  const __m128 by0 = _mm_set1_ps(box[1]);
+  const __m128 bx1 = _mm_set1_ps(box[2]);
+  const __m128 by1 = _mm_set1_ps(box[3]);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 box_area = _mm_set1_ps((box[2] - box[0]) * (box[3] - box[1]));
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m128 ax0 = _mm_loadu_ps(x0 + i);
+    const __m128 ay0 = _mm_loadu_ps(y0 + i);
+    const __m128 ax1 = _mm_loadu_ps(x1 + i);
+    const __m128 ay1 = _mm_loadu_ps(y1 + i);
+    const __m128 iw =
+        _mm_max_ps(_mm_sub_ps(_mm_min_ps(bx1, ax1), _mm_max_ps(bx0, ax0)), zero);
+    const __m128 ih =
+        _mm_max_ps(_mm_sub_ps(_mm_min_ps(by1, ay1), _mm_max_ps(by0, ay0)), zero);
+    const __m128 inter = _mm_mul_ps(iw, ih);
+    const __m128 area = _mm_mul_ps(_mm_sub_ps(ax1, ax0), _mm_sub_ps(ay1, ay0));
+    const __m128 uni = _mm_sub_ps(_mm_add_ps(area, box_area), inter);
+    const __m128 valid = _mm_cmpgt_ps(uni, zero);
+    _mm_storeu_ps(iou + i, _mm_and_ps(_mm_div_ps(inter, uni), valid));
+  }
+  scalar::iou_row(x0, y0, x1, y1, n, box, iou, i);
+}
+
+void kalman_predict(float* pos, float* vel, float* p00, float* p01, float* p11, const float* scale,
+                    float q_pos, float q_vel, int n) {
+  const __m128 qp = _mm_set1_ps(q_pos);
+  const __m128 qv = _mm_set1_ps(q_vel);
+  const __m128 two = _mm_set1_ps(2.0f);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m128 s = _mm_loadu_ps(scale + i);
+    const __m128 s2 = _mm_mul_ps(s, s);
+    const __m128 a = _mm_loadu_ps(p00 + i);
+    const __m128 b = _mm_loadu_ps(p01 + i);
+    const __m128 c = _mm_loadu_ps(p11 + i);
+    _mm_storeu_ps(pos + i, _mm_add_ps(_mm_loadu_ps(pos + i), _mm_loadu_ps(vel + i)));
+    const __m128 p = _mm_add_ps(_mm_add_ps(a, _mm_mul_ps(two, b)), c);
+    _mm_storeu_ps(p00 + i, _mm_add_ps(p, _mm_mul_ps(qp, s2)));
+    _mm_storeu_ps(p01 + i, _mm_add_ps(b, c));
+    _mm_storeu_ps(p11 + i, _mm_add_ps(c, _mm_mul_ps(qv, s2)));
+  }
+  scalar::kalman_predict(pos, vel, p00, p01, p11, scale, q_pos, q_vel, n, i);
+}
+
+void kalman_update(float* pos, float* vel, float* p00, float* p01, float* p11, const float* z,
+                   const float* r, int n) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m128 a = _mm_loadu_ps(p00 + i);
+    const __m128 b = _mm_loadu_ps(p01 + i);
+    const __m128 c = _mm_loadu_ps(p11 + i);
+    const __m128 x = _mm_loadu_ps(pos + i);
+    const __m128 s = _mm_add_ps(a, _mm_loadu_ps(r + i));
+    const __m128 k0 = _mm_div_ps(a, s);
+    const __m128 k1 = _mm_div_ps(b, s);
+    const __m128 y = _mm_sub_ps(_mm_loadu_ps(z + i), x);
+    _mm_storeu_ps(pos + i, _mm_add_ps(x, _mm_mul_ps(k0, y)));
+    _mm_storeu_ps(vel + i, _mm_add_ps(_mm_loadu_ps(vel + i), _mm_mul_ps(k1, y)));
+    _mm_storeu_ps(p11 + i, _mm_sub_ps(c, _mm_mul_ps(k1, b)));
+    _mm_storeu_ps(p01 + i, _mm_sub_ps(b, _mm_mul_ps(k0, b)));
+    _mm_storeu_ps(p00 + i, _mm_sub_ps(a, _mm_mul_ps(k0, a)));
+  }
+  scalar::kalman_update(pos, vel, p00, p01, p11, z, r, n, i);
+}
+
+void planar_f32_row(const uint8_t* src, int n, float* c0, float* c1, float* c2,
+                    const float offset[3], const float scale[3]) {
+  const __m128i mask = _mm_set1_epi32(0xff);
+  float* dst[3] = {c0, c1, c2};
+  __m128 off[3];
+  __m128 mul[3];
+  for (int c = 0; c < 3; c++) {
+    off[c] = _mm_set1_ps(offset[c]);
+    mul[c] = _mm_set1_ps(scale[c]);
+  }
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+    for (int c = 0; c < 3; c++) {
+      const __m128 v = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(px, 8 * c), mask));
+      _mm_storeu_ps(dst[c] + i, _mm_mul_ps(_mm_sub_ps(v, off[c]), mul[c]));
+    }
+  }
+  scalar::planar_f32_row(src, n, c0, c1, c2, offset, scale, i);
+}
+
+void argmax_rows(const float* rows, size_t stride, int count, int n, float* best,
+                 int32_t* index) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 b = _mm_loadu_ps(rows + i);
+    __m128i k = _mm_setzero_si128();
+    for (int r = 1; r < count; r++) {
+      const __m128 v = _mm_loadu_ps(rows + r * stride + i);
+      const __m128 gt = _mm_cmpgt_ps(v, b);
+      b = _mm_blendv_ps(b, v, gt);
+      k = _mm_blendv_epi8(k, _mm_set1_epi32(r), _mm_castps_si128(gt));
+    }
+    _mm_storeu_ps(best + i, b);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(index + i), k);
+  }
+  scalar::argmax_rows(rows, stride, count, n, best, index, i);
+}
+
+int select_above(const float* v, int n, float threshold, int32_t* index) {
+  const __m128 t = _mm_set1_ps(threshold);
+  int count = 0;
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    int mask = _mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(v + i), t));
+    while (mask != 0) {
+      index[count++] = i + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  return count + scalar::select_above(v, n, threshold, index + count, i);
+}
+
+void accumulate_row(const uint8_t* src, uint16_t* acc, int n) {
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m128i s = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+    __m128i* a = reinterpret_cast<__m128i*>(acc + i);
+    _mm_storeu_si128(a, _mm_add_epi16(_mm_loadu_si128(a), s));
+  }
+  scalar::accumulate_row(src, acc, n, i);
+}
+
+uint32_t sad_row(const uint8_t* a, const uint8_t* b, int n) {
+  __m128i sum = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+    const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+    sum = _mm_add_epi64(sum, _mm_sad_epu8(va, vb));
+  }
+  const uint32_t total =
+      static_cast<uint32_t>(_mm_cvtsi128_si32(sum) + _mm_extract_epi32(sum, 2));
+  return total + scalar::sad_row(a, b, n, i);
+}
+
+inline __m128i load_pixels(const uint8_t* src, const int32_t* x) {
+  uint32_t p[4];
+  for (int j = 0; j < 4; j++)
+    std::memcpy(&p[j], src + x[j], 4);
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+// No gather before AVX2: the taps are loaded one by one, the blend runs
+// on four pixels at a time.
+void lerp_pixels(const uint8_t* src, const int32_t* x0, const int32_t* x1, const uint16_t* frac,
+                 uint8_t* dst, int n) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i full = _mm_set1_epi16(256);
+  const __m128i round = _mm_set1_epi16(128);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m128i a = load_pixels(src, x0 + i);
+    const __m128i b = load_pixels(src, x1 + i);
+    // Each weight repeated over the four channels of its pixel.
+    __m128i f = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(frac + i)));
+    f = _mm_or_si128(f, _mm_slli_epi32(f, 16));
+    const __m128i f_lo = _mm_unpacklo_epi32(f, f);
+    const __m128i f_hi = _mm_unpackhi_epi32(f, f);
+    __m128i lo =
+        _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_sub_epi16(full, f_lo)),
+                      _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), f_lo));
+    __m128i hi =
+        _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_sub_epi16(full, f_hi)),
+                      _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), f_hi));
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * i), _mm_packus_epi16(lo, hi));
+  }
+  scalar::lerp_pixels(src, x0, x1, frac, dst, n, i);
+}
+
+// One 32-bit pixel of remap_row: the row pairs are loaded whole, their
+// channels interleaved into 16-bit (left, right) pairs and blended with
+// madd, first across and then down.
+inline __m128i remap_pixel(const uint8_t* a, int stride, int frac) {
+  const __m128i interleave = _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m128i round = _mm_set1_epi32(128);
+  const int fx = frac & 0xff;
+  const int fy = frac >> 8;
+  const __m128i wx = _mm_set1_epi32((256 - fx) | (fx << 16));
+  const __m128i wy = _mm_set1_epi32((256 - fy) | (fy << 16));
+  const __m128i top = _mm_cvtepu8_epi16(
+      _mm_shuffle_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(a)), interleave));
+  const __m128i bottom = _mm_cvtepu8_epi16(
+      _mm_shuffle_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(a + stride)), interleave));
+  const __m128i t = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(top, wx), round), 8);
+  const __m128i b = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(bottom, wx), round), 8);
+  return _mm_srli_epi32(
+      _mm_add_epi32(_mm_madd_epi16(_mm_or_si128(t, _mm_slli_epi32(b, 16)), wy), round), 8);
+}
+
+// Only 32-bit pixels are vectorized; planar samples stay scalar without
+// gathers.
+void remap_row(const uint8_t* src, int stride, const uint32_t* taps, const uint16_t* frac,
+               uint8_t* dst, int n, int bpp) {
+  int i = 0;
+  if (bpp == 4) {
+    for (; i + 4 <= n; i += 4) {
+      __m128i p[4];
+      for (int j = 0; j < 4; j++) {
+        const uint32_t t = taps[i + j];
+        p[j] = remap_pixel(src + static_cast<ptrdiff_t>(t >> 16) * stride +
+                               static_cast<ptrdiff_t>(t & 0xffff) * 4,
+                           stride, frac[i + j]);
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * i),
+                       _mm_packus_epi16(_mm_packus_epi32(p[0], p[1]), _mm_packus_epi32(p[2], p[3])));
+    }
+  }
+  scalar::remap_row(src, stride, taps, frac, dst, n, bpp, i);
+}
+
+// Prefix sums of four uint32 lanes per channel, plus the running sums.
+inline __m128i prefix4(__m128i x, __m128i* carry, int bpp) {
+  if (bpp == 1) {
+    x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+    x = _mm_add_epi32(_mm_add_epi32(x, _mm_slli_si128(x, 8)), *carry);
+    *carry = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+  } else if (bpp == 2) {
+    x = _mm_add_epi32(_mm_add_epi32(x, _mm_slli_si128(x, 8)), *carry);
+    *carry = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 2, 3, 2));
+  } else {
+    x = _mm_add_epi32(x, *carry);
+    *carry = x;
+  }
+  return x;
+}
+
+void integral_row(const uint8_t* src, const uint32_t* above, uint32_t* dst, int n, int bpp) {
+  int i = 0;
+  if (bpp == 1 || bpp == 2 || bpp == 4) {
+    __m128i carry = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+      __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      for (int j = 0; j < 16; j += 4) {
+        const __m128i x = prefix4(_mm_cvtepu8_epi32(s), &carry, bpp);
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + i + j));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + j), _mm_add_epi32(a, x));
+        s = _mm_srli_si128(s, 4);
+      }
+    }
+  }
+  scalar::integral_row(src, above, dst, n, bpp, i);
+}
+
+inline __m128i box_mean4(const uint32_t* top, const uint32_t* bottom, int width, __m128 scale,
+                         __m128 half) {
+  const __m128i t0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top));
+  const __m128i t1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + width));
+  const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom));
+  const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + width));
+  const __m128i sum = _mm_add_epi32(_mm_sub_epi32(_mm_sub_epi32(b1, b0), t1), t0);
+  return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(sum), scale), half));
+}
+
+void box_mean_row(const uint32_t* top, const uint32_t* bottom, int width, uint8_t* dst, int n,
+                  float scale) {
+  const __m128 vscale = _mm_set1_ps(scale);
+  const __m128 half = _mm_set1_ps(0.5f);
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m128i m0 = box_mean4(top + i, bottom + i, width, vscale, half);
+    const __m128i m1 = box_mean4(top + i + 4, bottom + i + 4, width, vscale, half);
+    const __m128i m2 = box_mean4(top + i + 8, bottom + i + 8, width, vscale, half);
+    const __m128i m3 = box_mean4(top + i + 12, bottom + i + 12, width, vscale, half);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_packus_epi16(_mm_packus_epi32(m0, m1), _mm_packus_epi32(m2, m3)));
+  }
+  scalar::box_mean_row(top, bottom, width, dst, n, scale, i);
+}
+
+inline __m128 load_q16(const int16_t* src, __m128 scale) {
+  const __m128i q = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+  return _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(q)), scale);
+}
+
+inline void store_q16(int16_t* dst, __m128 value, __m128 scale) {
+  const __m128i q = _mm_cvtps_epi32(_mm_mul_ps(value, scale));
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packs_epi32(q, q));
+}
+
+void mixture_update(const uint8_t* src, int16_t* model, size_t plane, uint8_t* fg, int n,
+                    const MixtureParams& params) {
+  constexpr int kK = kMixtureComponents;
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 ones = _mm_castsi128_ps(_mm_set1_epi32(-1));
+  const __m128 alpha = _mm_set1_ps(params.alpha);
+  const __m128 keep = _mm_set1_ps(1.0f - params.alpha);
+  const __m128 threshold = _mm_set1_ps(params.threshold);
+  const __m128 init_var = _mm_set1_ps(params.init_var);
+  const __m128 min_var = _mm_set1_ps(params.min_var);
+  const __m128 max_var = _mm_set1_ps(params.max_var);
+  const __m128 background = _mm_set1_ps(params.background_weight);
+  const __m128 mean_in = _mm_set1_ps(1.0f / kMixtureMeanScale);
+  const __m128 var_in = _mm_set1_ps(1.0f / kMixtureVarScale);
+  const __m128 weight_in = _mm_set1_ps(1.0f / kMixtureWeightScale);
+  const __m128 mean_out = _mm_set1_ps(kMixtureMeanScale);
+  const __m128 var_out = _mm_set1_ps(kMixtureVarScale);
+  const __m128 weight_out = _mm_set1_ps(kMixtureWeightScale);
+
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    int32_t bytes;
+    std::memcpy(&bytes, src + i, 4);
+    const __m128 x = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes)));
+    __m128 m[kK], v[kK], w[kK], sel[kK];
+    for (int k = 0; k < kK; k++) {
+      m[k] = load_q16(model + (3 * k) * plane + i, mean_in);
+      v[k] = load_q16(model + (3 * k + 1) * plane + i, var_in);
+      w[k] = load_q16(model + (3 * k + 2) * plane + i, weight_in);
+    }
+
+    // Heaviest matching component, as a one-hot lane mask per component.
+    __m128 best_w = zero;
+    for (int k = 0; k < kK; k++) {
+      const __m128 d = _mm_sub_ps(x, m[k]);
+      const __m128 match = _mm_cmplt_ps(_mm_mul_ps(d, d), _mm_mul_ps(threshold, v[k]));
+      const __m128 c = _mm_and_ps(match, _mm_cmpgt_ps(w[k], best_w));
+      best_w = _mm_blendv_ps(best_w, w[k], c);
+      for (int j = 0; j < k; j++)
+        sel[j] = _mm_andnot_ps(c, sel[j]);
+      sel[k] = c;
+    }
+
+    __m128 matched = zero;
+    __m128 w_best = zero;
+    for (int k = 0; k < kK; k++) {
+      w[k] = _mm_add_ps(_mm_mul_ps(w[k], keep), _mm_and_ps(sel[k], alpha));
+      matched = _mm_or_ps(matched, sel[k]);
+      w_best = _mm_or_ps(w_best, _mm_and_ps(sel[k], w[k]));
+    }
+
+    const __m128 rho = _mm_div_ps(alpha, _mm_max_ps(w_best, alpha));
+    for (int k = 0; k < kK; k++) {
+      const __m128 d = _mm_sub_ps(x, m[k]);
+      const __m128 mean = _mm_add_ps(m[k], _mm_mul_ps(rho, d));
+      const __m128 step = _mm_mul_ps(rho, _mm_sub_ps(_mm_mul_ps(d, d), v[k]));
+      __m128 var = _mm_add_ps(v[k], step);
+      var = _mm_min_ps(_mm_max_ps(var, min_var), max_var);
+      m[k] = _mm_blendv_ps(m[k], mean, sel[k]);
+      v[k] = _mm_blendv_ps(v[k], var, sel[k]);
+    }
+
+    // Unmatched samples replace the lightest component.
+    __m128 low_w = w[0];
+    sel[0] = ones;
+    for (int k = 1; k < kK; k++) {
+      const __m128 c = _mm_cmplt_ps(w[k], low_w);
+      low_w = _mm_blendv_ps(low_w, w[k], c);
+      for (int j = 0; j < k; j++)
+        sel[j] = _mm_andnot_ps(c, sel[j]);
+      sel[k] = c;
+    }
+    for (int k = 0; k < kK; k++) {
+      const __m128 r = _mm_andnot_ps(matched, sel[k]);
+      m[k] = _mm_blendv_ps(m[k], x, r);
+      v[k] = _mm_blendv_ps(v[k], init_var, r);
+      w[k] = _mm_blendv_ps(w[k], alpha, r);
+      store_q16(model + (3 * k) * plane + i, m[k], mean_out);
+      store_q16(model + (3 * k + 1) * plane + i, v[k], var_out);
+      store_q16(model + (3 * k + 2) * plane + i, w[k], weight_out);
+    }
+
+    const __m128i f = _mm_castps_si128(
+        _mm_or_ps(_mm_andnot_ps(matched, ones), _mm_cmplt_ps(w_best, background)));
+    const __m128i f16 = _mm_packs_epi32(f, f);
+    const int32_t mask = _mm_cvtsi128_si32(_mm_packs_epi16(f16, f16));
+    std::memcpy(fg + i, &mask, 4);
+  }
+  scalar::mixture_update(src, model, plane, fg, n, params, i);
+}
+
+inline float horizontal_sum(__m128 v) {
+  v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+  v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+  return _mm_cvtss_f32(v);
+}
+
+inline int32_t horizontal_sum(__m128i v) {
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(v);
+}
+
+void dot_rows_f32(const float* query, const float* rows, size_t stride, int count, int n,
+                  float* out) {
+  for (int r = 0; r < count; r++) {
+    const float* row = rows + r * stride;
+    __m128 s0 = _mm_setzero_ps();
+    __m128 s1 = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+      s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(query + i), _mm_loadu_ps(row + i)));
+      s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(query + i + 4), _mm_loadu_ps(row + i + 4)));
+    }
+    out[r] = horizontal_sum(_mm_add_ps(s0, s1)) + scalar::dot_f32(query, row, n, i);
+  }
+}
+
+// Signed bytes multiplied with maddubs, which wants its first operand
+// unsigned: |a| * (b with the sign of a). Pairs of products stay within
+// int16 for values in [-127, 127].
+void dot_rows_s8(const int8_t* query, const int8_t* rows, size_t stride, int count, int n,
+                 int32_t* out) {
+  const __m128i ones = _mm_set1_epi16(1);
+  for (int r = 0; r < count; r++) {
+    const int8_t* row = rows + r * stride;
+    __m128i sum = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+      const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(query + i));
+      const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+      const __m128i p = _mm_maddubs_epi16(_mm_sign_epi8(a, a), _mm_sign_epi8(b, a));
+      sum = _mm_add_epi32(sum, _mm_madd_epi16(p, ones));
+    }
+    out[r] = horizontal_sum(sum) + scalar::dot_s8(query, row, n, i);
+  }
+}
+
+}  // namespace
+
+const Kernels& sse41_kernels() {
+  static const Kernels table = [] {
+    Kernels k = scalar_kernels();
+    k.level = SimdLevel::kSse41;
+    k.yuv_to_rgb_row = yuv_to_rgb_row;
+    k.rgb_to_y_row = rgb_to_y_row;
+    k.rgb_to_uv_row = rgb_to_uv_row;
+    k.split_uv_row = split_uv_row;
+    k.merge_uv_row = merge_uv_row;
+    k.swizzle_rgb_row = swizzle_rgb_row;
+    k.lerp_row = lerp_row;
+    k.blend_row = blend_row;
+    k.fill_span = fill_span;
+    k.blend_span = blend_span;
+    k.blend_mask_span = blend_mask_span;
+    k.iou_row = iou_row;
+    k.kalman_predict = kalman_predict;
+    k.kalman_update = kalman_update;
+    k.planar_f32_row = planar_f32_row;
+    k.argmax_rows = argmax_rows;
+    k.select_above = select_above;
+    k.accumulate_row = accumulate_row;
+    k.sad_row = sad_row;
+    k.lerp_pixels = lerp_pixels;
+    k.remap_row = remap_row;
+    k.integral_row = integral_row;
+    k.box_mean_row = box_mean_row;
+    k.mixture_update = mixture_update;
+    k.dot_rows_f32 = dot_rows_f32;
+    k.dot_rows_s8 = dot_rows_s8;
+    return k;
+  }();
+  return table;
+}
+
+}  // namespace simd
+}  // namespace nvgst
@@ -0,0 +1,287 @@
+#include "core/latency_trace.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <new>
+
+namespace nvgst {
+
+namespace {
+
+std::atomic<uint64_t> next_collector_id{1};
+
+void copy_name(char (&dst)[32], const char* src) {
+  std::strncpy(dst, src, sizeof(dst) - 1);
+  dst[sizeof(dst) - 1] = '\0';
+}
+
+class FileTraceSink : public TraceSink {
+ public:
+  explicit FileTraceSink(FILE* file) : file_(file) {
+    std::setvbuf(file_, nullptr, _IOFBF, 1 << 20);
+    std::fprintf(file_, "# ts_ns kind element pts latency_ns thread\n");
+  }
+  ~FileTraceSink() override { std::fclose(file_); }
+
+  void write(const LatencyRecord* records, size_t n) override {
+    for (size_t i = 0; i < n; i++) {
+      const LatencyRecord& r = records[i];
+      std::fprintf(file_, "%" PRIu64 " %s %s %" PRIu64 " %" PRIu64 " %u\n", r.ts_ns,
+                   latency_kind_name(r.kind), r.element, r.pts, r.latency_ns, r.thread);
+    }
+  }
+
+  void flush() override { std::fflush(file_); }
+
+ private:
+  FILE* file_;
+};
+
+class ShmTraceSink : public TraceSink {
+ public:
+  ShmTraceSink(void* base, size_t size, uint32_t capacity)
+      : base_(base), size_(size), capacity_(capacity) {
+    header_ = new (base_) ShmTraceHeader();
+    std::memcpy(header_->magic, kShmTraceMagic, sizeof(header_->magic));
+    header_->record_size = sizeof(LatencyRecord);
+    header_->capacity = capacity_;
+    header_->write_count.store(0, std::memory_order_release);
+    records_ = reinterpret_cast<LatencyRecord*>(static_cast<uint8_t*>(base_) + sizeof(ShmTraceHeader));
+  }
+  ~ShmTraceSink() override { munmap(base_, size_); }
+
+  void write(const LatencyRecord* records, size_t n) override {
+    uint64_t count = header_->write_count.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < n; i++)
+      records_[(count + i) % capacity_] = records[i];
+    header_->write_count.store(count + n, std::memory_order_release);
+  }
+
+ private:
+  void* base_;
+  size_t size_;
+  uint32_t capacity_;
+  ShmTraceHeader* header_;
+  LatencyRecord* records_;
+};
+
+}  // namespace
+
+const char* latency_kind_name(LatencyKind kind) {
+  switch (kind) {
+    case LatencyKind::kProcessing:
+      return "proc";
+    case LatencyKind::kDwell:
+      return "dwell";
+  }
+  return "unknown";
+}
+
+std::unique_ptr<TraceSink> open_file_trace_sink(const std::string& path) {
+  FILE* file = std::fopen(path.c_str(), "w");
+  if (file == nullptr)
+    return nullptr;
+  return std::unique_ptr<TraceSink>(new FileTraceSink(file));
+}
+
+std::unique_ptr<TraceSink> open_shm_trace_sink(const std::string& name, uint32_t capacity) {
+  if (capacity == 0)
+    return nullptr;
+
+  size_t size = sizeof(ShmTraceHeader) + sizeof(LatencyRecord) * static_cast<size_t>(capacity);
+  int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+  if (fd < 0)
+    return nullptr;
+  if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    close(fd);
+    return nullptr;
+  }
+  void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+    return nullptr;
+
+  return std::unique_ptr<TraceSink>(new ShmTraceSink(base, size, capacity));
+}
+
+void LatencyTracker::on_event(const TraceEvent& ev, uint32_t thread, std::vector<LatencyRecord>* out) {
+  if (ev.from != nullptr) {
+    auto it = pending_.find(Key{ev.from, ev.pts});
+    if (it != pending_.end()) {
+      LatencyRecord r;
+      r.ts_ns = ev.ts_ns;
+      r.pts = ev.pts;
+      r.latency_ns = ev.ts_ns - it->second.ts_ns;
+      r.thread = thread;
+      r.kind = it->second.thread == thread ? LatencyKind::kProcessing : LatencyKind::kDwell;
+      r.reserved = 0;
+      auto name = names_.find(ev.from);
+      if (name != names_.end()) {
+        copy_name(r.element, name->second.c_str());
+      } else {
+        std::snprintf(r.element, sizeof(r.element), "%p", ev.from);
+      }
+      out->push_back(r);
+      pending_.erase(it);
+    }
+  }
+  if (ev.to != nullptr)
+    pending_[Key{ev.to, ev.pts}] = Entry{ev.ts_ns, thread};
+}
+
+void LatencyTracker::prune(uint64_t cutoff_ns) {
+  for (auto it = pending_.begin(); it != pending_.end();) {
+    if (it->second.ts_ns < cutoff_ns)
+      it = pending_.erase(it);
+    else
+      ++it;
+  }
+}
+
+// Releases the thread's ring to the flush thread when the thread exits; the
+// ring is freed once drained.
+struct TraceCollector::LocalRing {
+  uint64_t owner = 0;
+  std::shared_ptr<Ring> ring;
+
+  ~LocalRing() {
+    if (ring)
+      ring->retired.store(true, std::memory_order_release);
+  }
+};
+
+TraceCollector::TraceCollector(std::unique_ptr<TraceSink> sink, const Config& config)
+    : id_(next_collector_id.fetch_add(1)), config_(config), sink_(std::move(sink)) {
+  scratch_.resize(1024);
+  thread_ = std::thread(&TraceCollector::run, this);
+}
+
+TraceCollector::~TraceCollector() {
+  {
+    std::lock_guard<std::mutex> guard(stop_lock_);
+    stopping_ = true;
+  }
+  stop_cond_.notify_one();
+  thread_.join();
+}
+
+TraceCollector::Ring* TraceCollector::local_ring() {
+  static thread_local LocalRing local;
+
+  if (local.owner == id_)
+    return local.ring.get();
+
+  if (local.ring)
+    local.ring->retired.store(true, std::memory_order_release);
+  local.ring.reset();
+  local.owner = id_;
+
+  auto ring = std::make_shared<Ring>();
+  if (!ring->events.init(config_.ring_capacity))
+    return nullptr;
+
+  std::lock_guard<std::mutex> guard(rings_lock_);
+  ring->index = next_ring_index_++;
+  rings_.push_back(ring);
+  local.ring = std::move(ring);
+  return local.ring.get();
+}
+
+void TraceCollector::record(const TraceEvent& ev) {
+  Ring* ring = local_ring();
+  if (ring == nullptr || !ring->events.try_push(ev))
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TraceCollector::set_element_name(const void* element, const char* name) {
+  std::lock_guard<std::mutex> guard(names_lock_);
+  new_names_.emplace_back(element, name);
+}
+
+void TraceCollector::run() {
+  std::unique_lock<std::mutex> lock(stop_lock_);
+  while (!stopping_) {
+    stop_cond_.wait_for(lock, std::chrono::milliseconds(config_.flush_interval_ms));
+    bool final_drain = stopping_;
+    lock.unlock();
+    drain(final_drain);
+    lock.lock();
+  }
+}
+
+void TraceCollector::drain(bool final_drain) {
+  {
+    std::lock_guard<std::mutex> guard(names_lock_);
+    for (auto& name : new_names_)
+      tracker_.set_name(name.first, name.second);
+    new_names_.clear();
+  }
+
+  std::vector<std::shared_ptr<Ring>> rings;
+  {
+    std::lock_guard<std::mutex> guard(rings_lock_);
+    rings = rings_;
+  }
+
+  size_t carried = events_.size();
+  bool any_retired = false;
+  for (auto& ring : rings) {
+    // Everything a retired thread pushed happens-before the flag, so a ring
+    // seen retired before draining is empty afterwards.
+    bool retired = ring->retired.load(std::memory_order_acquire);
+    size_t n;
+    while ((n = ring->events.pop_bulk(scratch_.data(), scratch_.size())) > 0) {
+      for (size_t i = 0; i < n; i++) {
+        events_.emplace_back(scratch_[i], ring->index);
+        newest_ts_ = std::max(newest_ts_, scratch_[i].ts_ns);
+      }
+    }
+    any_retired = any_retired || retired;
+  }
+  if (any_retired) {
+    std::lock_guard<std::mutex> guard(rings_lock_);
+    rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                                [](const std::shared_ptr<Ring>& r) {
+                                  return r->retired.load(std::memory_order_acquire) && r->events.empty();
+                                }),
+                 rings_.end());
+  }
+
+  if (events_.size() > carried) {
+    auto by_ts = [](const std::pair<TraceEvent, uint32_t>& a, const std::pair<TraceEvent, uint32_t>& b) {
+      return a.first.ts_ns < b.first.ts_ns;
+    };
+    std::stable_sort(events_.begin() + static_cast<std::ptrdiff_t>(carried), events_.end(), by_ts);
+    std::inplace_merge(events_.begin(), events_.begin() + static_cast<std::ptrdiff_t>(carried), events_.end(),
+                       by_ts);
+  }
+
+  uint64_t cutoff = std::numeric_limits<uint64_t>::max();
+  if (!final_drain)
+    cutoff = newest_ts_ > config_.holdback_ns ? newest_ts_ - config_.holdback_ns : 0;
+
+  size_t processed = 0;
+  for (; processed < events_.size() && events_[processed].first.ts_ns <= cutoff; processed++)
+    tracker_.on_event(events_[processed].first, events_[processed].second, &records_);
+  events_.erase(events_.begin(), events_.begin() + static_cast<std::ptrdiff_t>(processed));
+
+  if (!records_.empty()) {
+    sink_->write(records_.data(), records_.size());
+    written_.fetch_add(records_.size(), std::memory_order_relaxed);
+    records_.clear();
+  }
+  if (!final_drain && cutoff > config_.max_pending_ns)
+    tracker_.prune(cutoff - config_.max_pending_ns);
+  sink_->flush();
+}
+
+}  // namespace nvgst
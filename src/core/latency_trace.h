@@ -0,0 +1,182 @@
+// Per-element latency tracing: streaming threads append raw push events to
+// their own lock-free ring; a background thread drains the rings, matches
+// buffers entering and leaving each element and writes latency records to a
+// file or a shared-memory segment.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "core/spsc_ring.h"
+
+namespace nvgst {
+
+// One buffer push from element `from` into element `to`: the buffer leaves
+// `from` and enters `to` at ts_ns. Either side may be null (unknown).
+struct TraceEvent {
+  uint64_t ts_ns;
+  const void* from;
+  const void* to;
+  uint64_t pts;
+};
+
+enum class LatencyKind : uint16_t {
+  // Buffer entered and left the element on the same thread.
+  kProcessing = 0,
+  // Buffer left on another thread than it entered (queues).
+  kDwell = 1,
+};
+
+const char* latency_kind_name(LatencyKind kind);
+
+// 64 bytes, also the record layout of the shared-memory segment.
+struct LatencyRecord {
+  uint64_t ts_ns;       // time the buffer left the element
+  uint64_t pts;
+  uint64_t latency_ns;
+  uint32_t thread;      // ring index of the thread the buffer left on
+  LatencyKind kind;
+  uint16_t reserved;
+  char element[32];     // NUL-terminated, truncated
+};
+static_assert(sizeof(LatencyRecord) == 64, "LatencyRecord is part of the shm layout");
+
+class TraceSink {
+ public:
+  virtual ~TraceSink() = default;
+  virtual void write(const LatencyRecord* records, size_t n) = 0;
+  virtual void flush() {}
+};
+
+// Text, one record per line: "ts_ns kind element pts latency_ns thread".
+std::unique_ptr<TraceSink> open_file_trace_sink(const std::string& path);
+
+// POSIX shared memory object (shm_open name) holding a ShmTraceHeader
+// followed by capacity LatencyRecords used as a ring. A reader polls
+// write_count and reads record (i % capacity) for each new i; it has fallen
+// behind when write_count - i > capacity.
+constexpr char kShmTraceMagic[8] = {'N', 'V', 'L', 'A', 'T', '0', '1', '\0'};
+
+struct ShmTraceHeader {
+  char magic[8];
+  uint32_t record_size;
+  uint32_t capacity;
+  std::atomic<uint64_t> write_count;
+  uint8_t pad[40];
+};
+static_assert(sizeof(ShmTraceHeader) == 64, "records start on a cache line");
+
+std::unique_ptr<TraceSink> open_shm_trace_sink(const std::string& name, uint32_t capacity);
+
+// Matches enter/leave events per (element, pts). Single-threaded; owned by
+// the collector's flush thread.
+class LatencyTracker {
+ public:
+  // Appends a record to out when ev closes a pending entry of ev.from.
+  void on_event(const TraceEvent& ev, uint32_t thread, std::vector<LatencyRecord>* out);
+
+  // Drops entries that entered before cutoff_ns (buffers that were dropped,
+  // reached a sink, or changed PTS).
+  void prune(uint64_t cutoff_ns);
+
+  // Name lookup for records; entries are copied into each record.
+  void set_name(const void* element, const std::string& name) { names_[element] = name; }
+
+  size_t pending() const { return pending_.size(); }
+
+ private:
+  struct Key {
+    const void* element;
+    uint64_t pts;
+    bool operator==(const Key& o) const { return element == o.element && pts == o.pts; }
+  };
+  struct KeyHash {
+    size_t operator()(const Key& k) const {
+      return std::hash<const void*>()(k.element) ^ (std::hash<uint64_t>()(k.pts) * 0x9e3779b97f4a7c15ull);
+    }
+  };
+  struct Entry {
+    uint64_t ts_ns;
+    uint32_t thread;
+  };
+
+  std::unordered_map<Key, Entry, KeyHash> pending_;
+  std::unordered_map<const void*, std::string> names_;
+};
+
+class TraceCollector {
+ public:
+  struct Config {
+    size_t ring_capacity = 16384;     // events per thread
+    int flush_interval_ms = 100;
+    // Events are processed in timestamp order once they are this much older
+    // than the newest event seen, so pushes that raced a drain still match.
+    uint64_t holdback_ns = 50000000;
+    // Pending entries older than this are dropped.
+    uint64_t max_pending_ns = 10000000000ull;
+  };
+
+  TraceCollector(std::unique_ptr<TraceSink> sink, const Config& config);
+  ~TraceCollector();
+
+  TraceCollector(const TraceCollector&) = delete;
+  TraceCollector& operator=(const TraceCollector&) = delete;
+
+  // Hot path, any thread: appends to the calling thread's ring. The first
+  // call on a thread allocates and registers its ring.
+  void record(const TraceEvent& ev);
+
+  // Any thread, rare: names used for element pointers in records.
+  void set_element_name(const void* element, const char* name);
+
+  // Events lost because a thread's ring was full.
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+  uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Ring {
+    SpscRing<TraceEvent> events;
+    uint32_t index = 0;
+    std::atomic<bool> retired{false};
+  };
+  struct LocalRing;
+
+  Ring* local_ring();
+  void run();
+  void drain(bool final_drain);
+
+  const uint64_t id_;
+  const Config config_;
+  std::unique_ptr<TraceSink> sink_;
+
+  std::mutex rings_lock_;
+  std::vector<std::shared_ptr<Ring>> rings_;
+  uint32_t next_ring_index_ = 0;
+
+  std::mutex names_lock_;
+  std::vector<std::pair<const void*, std::string>> new_names_;
+
+  // flush thread only
+  LatencyTracker tracker_;
+  std::vector<std::pair<TraceEvent, uint32_t>> events_;
+  std::vector<TraceEvent> scratch_;
+  std::vector<LatencyRecord> records_;
+  uint64_t newest_ts_ = 0;
+
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> written_{0};
+
+  std::mutex stop_lock_;
+  std::condition_variable stop_cond_;
+  bool stopping_ = false;
+  std::thread thread_;
+};
+
+}  // namespace nvgst
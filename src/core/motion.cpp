@@ -0,0 +1,124 @@
+#include "core/motion.h"
+
+#include <algorithm>
+
+namespace nvgst {
+
+namespace {
+
+// Rows one uint16_t accumulator can sum without overflow.
+constexpr int kMaxBlockRows = 257;
+
+}  // namespace
+
+bool MotionGate::configure(const MotionConfig& config) {
+  if (config.width <= 0 || config.height <= 0)
+    return false;
+  if (config.thumb_width <= 0 || config.thumb_height <= 0)
+    return false;
+  if (!(config.threshold >= 0.0f) || config.refresh_interval < 0)
+    return false;
+
+  int channels;
+  int pixel_stride;
+  switch (config.format) {
+    case PixelFormat::kNV12:
+    case PixelFormat::kI420:
+      channels = 1;
+      pixel_stride = 1;
+      break;
+    case PixelFormat::kRGBA:
+    case PixelFormat::kBGRx:
+      channels = 3;
+      pixel_stride = 4;
+      break;
+    default:
+      return false;
+  }
+
+  const int thumb_width = std::min(config.thumb_width, config.width);
+  const int thumb_height = std::min(config.thumb_height, config.height);
+  if ((config.height + thumb_height - 1) / thumb_height > kMaxBlockRows)
+    return false;
+
+  if (thumb_width != thumb_width_ || thumb_height != thumb_height_ ||
+      config.format != config_.format || config.width != config_.width ||
+      config.height != config_.height)
+    reset();
+
+  config_ = config;
+  kernels_ = &simd::kernels(config.simd);
+  thumb_width_ = thumb_width;
+  thumb_height_ = thumb_height;
+  channels_ = channels;
+  pixel_stride_ = pixel_stride;
+
+  x_edge_.resize(thumb_width + 1);
+  for (int i = 0; i <= thumb_width; i++)
+    x_edge_[i] = static_cast<int>(static_cast<int64_t>(i) * config.width / thumb_width);
+  y_edge_.resize(thumb_height + 1);
+  for (int i = 0; i <= thumb_height; i++)
+    y_edge_[i] = static_cast<int>(static_cast<int64_t>(i) * config.height / thumb_height);
+
+  acc_.resize(static_cast<size_t>(config.width) * pixel_stride);
+  thumb_.resize(static_cast<size_t>(thumb_width) * thumb_height);
+  reference_.resize(thumb_.size());
+  return true;
+}
+
+void MotionGate::reset() {
+  have_reference_ = false;
+  skipped_ = 0;
+}
+
+void MotionGate::downscale(const FrameView& frame) {
+  const int row_bytes = config_.width * pixel_stride_;
+  for (int ty = 0; ty < thumb_height_; ty++) {
+    std::fill(acc_.begin(), acc_.end(), 0);
+    for (int y = y_edge_[ty]; y < y_edge_[ty + 1]; y++)
+      kernels_->accumulate_row(frame.data[0] + static_cast<size_t>(y) * frame.stride[0],
+                               acc_.data(), row_bytes);
+
+    const int rows = y_edge_[ty + 1] - y_edge_[ty];
+    uint8_t* dst = thumb_.data() + static_cast<size_t>(ty) * thumb_width_;
+    for (int tx = 0; tx < thumb_width_; tx++) {
+      uint32_t sum = 0;
+      for (int x = x_edge_[tx]; x < x_edge_[tx + 1]; x++) {
+        const uint16_t* px = acc_.data() + x * pixel_stride_;
+        for (int c = 0; c < channels_; c++)
+          sum += px[c];
+      }
+      const uint32_t count =
+          static_cast<uint32_t>((x_edge_[tx + 1] - x_edge_[tx]) * rows * channels_);
+      dst[tx] = static_cast<uint8_t>((sum + count / 2) / count);
+    }
+  }
+}
+
+MotionResult MotionGate::update(const FrameView& frame) {
+  MotionResult result;
+  downscale(frame);
+
+  if (!have_reference_) {
+    result.score = 255.0f;
+    result.moving = true;
+  } else {
+    const uint32_t sad = kernels_->sad_row(thumb_.data(), reference_.data(),
+                                           static_cast<int>(thumb_.size()));
+    result.score = static_cast<float>(sad) / static_cast<float>(thumb_.size());
+    result.moving = result.score > config_.threshold;
+    result.refresh = !result.moving && config_.refresh_interval > 0 &&
+                     skipped_ >= config_.refresh_interval;
+  }
+
+  if (result.passed()) {
+    reference_.swap(thumb_);
+    have_reference_ = true;
+    skipped_ = 0;
+  } else {
+    skipped_++;
+  }
+  return result;
+}
+
+}  // namespace nvgst
@@ -0,0 +1,78 @@
+// Decides whether a frame shows anything new, for skipping inference on
+// static scenes. Each frame is box-filtered down to a small luma
+// thumbnail (Kernels::accumulate_row sums source rows, so every source
+// pixel counts and sensor noise averages out) and compared with the
+// thumbnail of the last frame that was let through by
+// Kernels::sad_row. Comparing against the last passed frame rather than
+// the previous one means slow drifts add up until they count as motion.
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/frame.h"
+#include "core/kernels.h"
+
+namespace nvgst {
+
+struct MotionConfig {
+  PixelFormat format = PixelFormat::kUnknown;
+  int width = 0;
+  int height = 0;
+  // Capped at the frame size.
+  int thumb_width = 64;
+  int thumb_height = 36;
+  // Mean absolute luma difference per thumbnail pixel, 0-255, above
+  // which a frame counts as moving.
+  float threshold = 1.0f;
+  // Static frames in a row after which one is passed anyway; 0 never
+  // forces one.
+  int refresh_interval = 30;
+  SimdLevel simd = SimdLevel::kAvx2;
+};
+
+struct MotionResult {
+  // Mean absolute difference to the last passed frame.
+  float score = 0.0f;
+  bool moving = false;
+  // Passed only because refresh_interval ran out.
+  bool refresh = false;
+
+  bool passed() const { return moving || refresh; }
+};
+
+// One per source; not thread-safe.
+class MotionGate {
+ public:
+  // Forgets the reference frame when the thumbnail layout changes.
+  bool configure(const MotionConfig& config);
+  const MotionConfig& config() const { return config_; }
+
+  // Forgets the reference frame; the next frame is passed as moving.
+  void reset();
+
+  MotionResult update(const FrameView& frame);
+
+ private:
+  void downscale(const FrameView& frame);
+
+  MotionConfig config_;
+  const simd::Kernels* kernels_ = &simd::kernels(SimdLevel::kScalar);
+  int thumb_width_ = 0;
+  int thumb_height_ = 0;
+  // Samples per pixel summed from a packed row (1 for luma planes, the 3
+  // color bytes of RGBA/BGRx) and bytes between pixels.
+  int channels_ = 1;
+  int pixel_stride_ = 1;
+  // Thumbnail pixel i covers source columns [x_edge_[i], x_edge_[i + 1]),
+  // rows likewise.
+  std::vector<int> x_edge_;
+  std::vector<int> y_edge_;
+  std::vector<uint16_t> acc_;
+  std::vector<uint8_t> thumb_;
+  std::vector<uint8_t> reference_;
+  bool have_reference_ = false;
+  int skipped_ = 0;
+};
+
+}  // namespace nvgst
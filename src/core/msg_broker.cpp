@@ -0,0 +1,563 @@
+#include "core/msg_broker.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace nvgst {
+
+namespace {
+
+template <size_t N>
+char* put(char* p, const char (&text)[N]) {
+  std::memcpy(p, text, N - 1);
+  return p + N - 1;
+}
+
+template <typename T>
+char* put_number(char* p, T value) {
+  return std::to_chars(p, p + 24, value).ptr;
+}
+
+// Shortest representation that reads back to the same float.
+char* put_float(char* p, float value) {
+  if (!std::isfinite(value))
+    return put(p, "null");
+  return std::to_chars(p, p + 32, value).ptr;
+}
+
+int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+size_t count_objects(const FrameMessage& message) {
+  size_t n = 0;
+  for (size_t i = 0; i < message.count; i++)
+    n += message.objects[i].frame == message.index;
+  return n;
+}
+
+}  // namespace
+
+void MessageBatch::reset(MessageFormat format, int64_t now_ns) {
+  format_ = format;
+  size_ = 0;
+  frames_ = 0;
+  opened_ = now_ns;
+  if (format_ == MessageFormat::kBinary) {
+    std::memset(reserve(sizeof(WireBatchHeader)), 0, sizeof(WireBatchHeader));
+    size_ += sizeof(WireBatchHeader);
+  }
+}
+
+uint8_t* MessageBatch::reserve(size_t n) {
+  if (size_ + n > data_.size())
+    data_.resize(std::max(size_ + n, data_.size() * 2));
+  return data_.data() + size_;
+}
+
+void MessageBatch::append(const FrameMessage& message) {
+  if (format_ == MessageFormat::kBinary)
+    append_binary(message);
+  else
+    append_json(message);
+  frames_++;
+}
+
+void MessageBatch::append_json(const FrameMessage& message) {
+  const size_t objects = count_objects(message);
+  char* const begin =
+      reinterpret_cast<char*>(reserve(kJsonFrameBound + objects * kJsonObjectBound));
+  char* p = begin;
+
+  p = put(p, "{\"source\":");
+  p = put_number(p, message.source);
+  p = put(p, ",\"frame\":");
+  p = put_number(p, message.frame);
+  p = put(p, ",\"pts\":");
+  p = message.pts < 0 ? put(p, "null") : put_number(p, message.pts);
+  p = put(p, ",\"objects\":[");
+
+  bool first = true;
+  for (size_t i = 0; i < message.count; i++) {
+    const DetectedObject& object = message.objects[i];
+    if (object.frame != message.index)
+      continue;
+    if (!first)
+      *p++ = ',';
+    first = false;
+
+    p = put(p, "{\"class\":");
+    p = put_number(p, object.class_id);
+    p = put(p, ",\"track\":");
+    p = put_number(p, object.track_id);
+    p = put(p, ",\"confidence\":");
+    p = put_float(p, object.confidence);
+    p = put(p, ",\"box\":[");
+    p = put_float(p, object.x);
+    *p++ = ',';
+    p = put_float(p, object.y);
+    *p++ = ',';
+    p = put_float(p, object.width);
+    *p++ = ',';
+    p = put_float(p, object.height);
+    *p++ = ']';
+
+    bool attributes = false;
+    for (const ObjectAttribute& attribute : object.attributes) {
+      if (attribute.classifier == kNoClassifier)
+        continue;
+      p = attributes ? put(p, ",{\"classifier\":") : put(p, ",\"attributes\":[{\"classifier\":");
+      attributes = true;
+      p = put_number(p, attribute.classifier);
+      p = put(p, ",\"label\":");
+      p = put_number(p, attribute.label);
+      p = put(p, ",\"confidence\":");
+      p = put_float(p, attribute.confidence);
+      *p++ = '}';
+    }
+    if (attributes)
+      *p++ = ']';
+    *p++ = '}';
+  }
+  p = put(p, "]}\n");
+  size_ += static_cast<size_t>(p - begin);
+}
+
+void MessageBatch::append_binary(const FrameMessage& message) {
+  const size_t objects = count_objects(message);
+  uint8_t* const begin = reserve(sizeof(WireFrame) + objects * kBinaryObjectBound);
+  uint8_t* p = begin + sizeof(WireFrame);
+
+  for (size_t i = 0; i < message.count; i++) {
+    const DetectedObject& object = message.objects[i];
+    if (object.frame != message.index)
+      continue;
+    WireObject wire = {object.track_id, object.class_id, object.confidence, object.x, object.y,
+                       object.width, object.height, 0, 0};
+    uint8_t* attributes = p + sizeof(WireObject);
+    for (const ObjectAttribute& attribute : object.attributes) {
+      if (attribute.classifier == kNoClassifier)
+        continue;
+      const WireAttribute out = {attribute.classifier, attribute.label, attribute.confidence,
+                                 attribute.cached ? 1u : 0u};
+      std::memcpy(attributes, &out, sizeof(out));
+      attributes += sizeof(out);
+      wire.attributes++;
+    }
+    std::memcpy(p, &wire, sizeof(wire));
+    p = attributes;
+  }
+
+  const WireFrame frame = {static_cast<uint32_t>(p - begin), message.source, message.frame,
+                           message.pts, static_cast<uint32_t>(objects), 0};
+  std::memcpy(begin, &frame, sizeof(frame));
+  size_ += static_cast<size_t>(p - begin);
+}
+
+void MessageBatch::finish() {
+  if (format_ != MessageFormat::kBinary || size_ < sizeof(WireBatchHeader))
+    return;
+  WireBatchHeader header;
+  std::memcpy(header.magic, kWireMagic, sizeof(header.magic));
+  header.version = kWireVersion;
+  header.reserved = 0;
+  header.frames = frames_;
+  header.size = static_cast<uint32_t>(size_ - sizeof(WireBatchHeader));
+  std::memcpy(data_.data(), &header, sizeof(header));
+}
+
+namespace {
+
+// Transports over one file descriptor.
+class FdTransport : public MessageTransport {
+ public:
+  ~FdTransport() override { disconnect(); }
+
+  bool send(const uint8_t* data, size_t size) override {
+    while (size > 0) {
+      // MSG_NOSIGNAL: a closed peer is an error, not SIGPIPE.
+      ssize_t n = socket_ ? ::send(fd_, data, size, MSG_NOSIGNAL) : ::write(fd_, data, size);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      data += n;
+      size -= static_cast<size_t>(n);
+    }
+    return true;
+  }
+
+  void disconnect() override {
+    if (fd_ >= 0)
+      ::close(fd_);
+    fd_ = -1;
+  }
+
+ protected:
+  bool fail(const std::string& what, std::string* error) {
+    *error = what + ": " + std::strerror(errno);
+    disconnect();
+    return false;
+  }
+
+  int fd_ = -1;
+  bool socket_ = true;
+};
+
+class FileTransport : public FdTransport {
+ public:
+  explicit FileTransport(std::string path) : path_(std::move(path)) { socket_ = false; }
+
+  bool connect(std::string* error) override {
+    disconnect();
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+    return fd_ >= 0 || fail("open " + path_, error);
+  }
+
+ private:
+  std::string path_;
+};
+
+class UnixTransport : public FdTransport {
+ public:
+  explicit UnixTransport(std::string path) : path_(std::move(path)) {}
+
+  bool connect(std::string* error) override {
+    disconnect();
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path_.size() >= sizeof(addr.sun_path)) {
+      *error = "socket path too long: " + path_;
+      return false;
+    }
+    std::memcpy(addr.sun_path, path_.c_str(), path_.size() + 1);
+
+    fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0)
+      return fail("socket", error);
+    if (::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+      return fail("connect " + path_, error);
+    return true;
+  }
+
+ private:
+  std::string path_;
+};
+
+class TcpTransport : public FdTransport {
+ public:
+  TcpTransport(std::string host, std::string port)
+      : host_(std::move(host)), port_(std::move(port)) {}
+
+  bool connect(std::string* error) override {
+    disconnect();
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    const int status = getaddrinfo(host_.c_str(), port_.c_str(), &hints, &found);
+    if (status != 0) {
+      *error = "resolve " + host_ + ": " + gai_strerror(status);
+      return false;
+    }
+
+    std::string failure;
+    for (addrinfo* ai = found; ai != nullptr; ai = ai->ai_next) {
+      fd_ = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+      if (fd_ >= 0 && ::connect(fd_, ai->ai_addr, ai->ai_addrlen) == 0)
+        break;
+      failure = std::strerror(errno);
+      disconnect();
+    }
+    freeaddrinfo(found);
+    if (fd_ < 0) {
+      *error = "connect " + host_ + ":" + port_ + ": " + failure;
+      return false;
+    }
+    // Batches are already coalesced; do not hold the tail of one back.
+    const int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return true;
+  }
+
+ private:
+  std::string host_;
+  std::string port_;
+};
+
+bool strip_prefix(const std::string& uri, const char* prefix, std::string* rest) {
+  const size_t n = std::strlen(prefix);
+  if (uri.compare(0, n, prefix) != 0)
+    return false;
+  *rest = uri.substr(n);
+  return true;
+}
+
+}  // namespace
+
+std::unique_ptr<MessageTransport> create_message_transport(const std::string& uri) {
+  std::string rest;
+  if (strip_prefix(uri, "file://", &rest) && !rest.empty())
+    return std::unique_ptr<MessageTransport>(new FileTransport(rest));
+  if (strip_prefix(uri, "unix://", &rest) && !rest.empty())
+    return std::unique_ptr<MessageTransport>(new UnixTransport(rest));
+  if (strip_prefix(uri, "tcp://", &rest)) {
+    const size_t colon = rest.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == rest.size())
+      return nullptr;
+    std::string host = rest.substr(0, colon);
+    // [::1]:9000
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']')
+      host = host.substr(1, host.size() - 2);
+    return std::unique_ptr<MessageTransport>(new TcpTransport(host, rest.substr(colon + 1)));
+  }
+  return nullptr;
+}
+
+void MessageSender::start(std::unique_ptr<MessageTransport> transport, size_t max_pending,
+                          SendBackpressure backpressure, int retry_ms) {
+  stop();
+  transport_ = std::move(transport);
+  max_pending_ = std::max<size_t>(max_pending, 1);
+  backpressure_ = backpressure;
+  retry_ms_ = std::max(retry_ms, 1);
+  stopping_ = false;
+  flushing_ = false;
+  due_ = -1;
+  thread_ = std::thread(&MessageSender::run, this);
+}
+
+void MessageSender::stop() {
+  if (!thread_.joinable())
+    return;
+  // The open batch goes out with the queued ones, whatever the
+  // backpressure.
+  MessageBatch* open;
+  {
+    std::lock_guard<std::mutex> guard(open_lock_);
+    open = open_;
+    open_ = nullptr;
+  }
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (open != nullptr) {
+      open->finish();
+      queue_.push_back(open);
+    }
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  not_full_.notify_all();
+  thread_.join();
+
+  transport_->disconnect();
+  transport_.reset();
+  connected_.store(false, std::memory_order_relaxed);
+}
+
+void MessageSender::set_flushing(bool flushing) {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    flushing_ = flushing;
+  }
+  not_full_.notify_all();
+}
+
+void MessageSender::set_batching(MessageFormat format, uint32_t max_frames, int64_t max_age_ns) {
+  std::lock_guard<std::mutex> open(open_lock_);
+  format_ = format;
+  max_frames_ = std::max<uint32_t>(max_frames, 1);
+  max_age_ns_ = std::max<int64_t>(max_age_ns, 0);
+  if (open_ == nullptr)
+    return;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    due_ = max_age_ns_ > 0 ? open_->opened() + max_age_ns_ : -1;
+  }
+  wake_.notify_one();
+}
+
+bool MessageSender::append(const FrameMessage& message) {
+  std::unique_lock<std::mutex> open(open_lock_);
+  if (open_ == nullptr) {
+    const int64_t now = now_ns();
+    MessageBatch* batch = acquire();
+    batch->reset(format_, now);
+    open_ = batch;
+    if (max_age_ns_ > 0) {
+      {
+        std::lock_guard<std::mutex> guard(lock_);
+        due_ = now + max_age_ns_;
+      }
+      wake_.notify_one();
+    }
+  }
+  open_->append(message);
+  if (open_->frames() < max_frames_)
+    return true;
+
+  MessageBatch* full = open_;
+  open_ = nullptr;
+  open.unlock();
+  return submit(full);
+}
+
+bool MessageSender::flush() {
+  std::unique_lock<std::mutex> open(open_lock_);
+  MessageBatch* batch = open_;
+  open_ = nullptr;
+  open.unlock();
+  return batch == nullptr || submit(batch);
+}
+
+MessageBatch* MessageSender::acquire() {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (free_.empty()) {
+    batches_.emplace_back(new MessageBatch());
+    return batches_.back().get();
+  }
+  MessageBatch* batch = free_.back();
+  free_.pop_back();
+  return batch;
+}
+
+void MessageSender::drop(MessageBatch* batch) {
+  dropped_.fetch_add(batch->frames(), std::memory_order_relaxed);
+  free_.push_back(batch);
+}
+
+bool MessageSender::submit(MessageBatch* batch) {
+  batch->finish();
+
+  std::unique_lock<std::mutex> guard(lock_);
+  if (queue_.size() >= max_pending_) {
+    switch (backpressure_) {
+      case SendBackpressure::kBlock:
+        not_full_.wait(guard, [this] {
+          return queue_.size() < max_pending_ || flushing_ || stopping_;
+        });
+        break;
+      case SendBackpressure::kDropOldest:
+        drop(queue_.front());
+        queue_.pop_front();
+        break;
+      case SendBackpressure::kDropNewest:
+        break;
+    }
+  }
+  if (queue_.size() >= max_pending_ || stopping_) {
+    drop(batch);
+    return false;
+  }
+  queue_.push_back(batch);
+  guard.unlock();
+  wake_.notify_one();
+  return true;
+}
+
+std::string MessageSender::last_error() const {
+  std::lock_guard<std::mutex> guard(lock_);
+  return error_;
+}
+
+MessageBatch* MessageSender::take_aged() {
+  std::lock_guard<std::mutex> open(open_lock_);
+  if (open_ == nullptr || max_age_ns_ == 0)
+    return nullptr;
+  const int64_t due = open_->opened() + max_age_ns_;
+  if (now_ns() < due) {
+    std::lock_guard<std::mutex> guard(lock_);
+    due_ = due;
+    return nullptr;
+  }
+  MessageBatch* batch = open_;
+  open_ = nullptr;
+  batch->finish();
+  return batch;
+}
+
+void MessageSender::run() {
+  const std::chrono::milliseconds retry(retry_ms_);
+  std::unique_lock<std::mutex> guard(lock_);
+  for (;;) {
+    MessageBatch* batch = nullptr;
+    if (!queue_.empty()) {
+      batch = queue_.front();
+      queue_.pop_front();
+      guard.unlock();
+      not_full_.notify_one();
+    } else if (stopping_) {
+      return;
+    } else if (due_ >= 0 && now_ns() >= due_) {
+      // The open batch is newer than anything queued, so it only goes
+      // out once the queue is empty; it bypasses the queue, and with it
+      // the backpressure, because this thread is the one that drains it.
+      due_ = -1;
+      guard.unlock();
+      batch = take_aged();
+      if (batch == nullptr) {
+        guard.lock();
+        continue;
+      }
+    } else {
+      if (due_ < 0)
+        wake_.wait(guard);
+      else
+        wake_.wait_for(guard, std::chrono::nanoseconds(due_ - now_ns()));
+      continue;
+    }
+
+    bool sent = false;
+    std::string error;
+    for (;;) {
+      if (!connected_.load(std::memory_order_relaxed) && transport_->connect(&error))
+        connected_.store(true, std::memory_order_relaxed);
+      if (connected_.load(std::memory_order_relaxed)) {
+        if (transport_->send(batch->data(), batch->size())) {
+          sent = true;
+          break;
+        }
+        error = std::string("send: ") + std::strerror(errno);
+        transport_->disconnect();
+        connected_.store(false, std::memory_order_relaxed);
+      }
+
+      // Waits for the next attempt; on shutdown the batch is given up.
+      guard.lock();
+      error_ = error;
+      const bool stopping = wake_.wait_for(guard, retry, [this] { return stopping_; });
+      guard.unlock();
+      if (stopping)
+        break;
+    }
+
+    guard.lock();
+    if (sent) {
+      error_.clear();
+      sent_.fetch_add(batch->frames(), std::memory_order_relaxed);
+      free_.push_back(batch);
+    } else {
+      drop(batch);
+    }
+  }
+}
+
+}  // namespace nvgst
@@ -0,0 +1,254 @@
+// Metadata egress. The streaming thread serializes each frame's objects
+// into a MessageBatch, a byte arena that is cleared and reused rather than
+// freed, so steady-state serialization allocates nothing. Full batches go
+// to a MessageSender, whose thread pushes them through a MessageTransport
+// and hands the arenas back; it also sends a batch that has been open for
+// too long, whether or not more frames arrive. At most max_pending batches
+// wait for the transport; beyond that the sender blocks or drops, as
+// configured.
+//
+// Formats:
+//   JSON    one object per frame and line (NDJSON):
+//           {"source":0,"frame":12,"pts":400000000,"objects":[{"class":2,
+//           "track":5,"confidence":0.91,"box":[10.5,20,64,48],
+//           "attributes":[{"classifier":1,"label":3,"confidence":0.8}]}]}
+//           "pts" is null when unknown; "attributes" only lists set ones.
+//   binary  per batch a WireBatchHeader, then per frame a WireFrame
+//           followed by its WireObjects, each followed by its
+//           WireAttributes. Little-endian, sizes in bytes.
+//
+// Transports are looked up by URI scheme through create_message_transport():
+// file:// appends to a file, unix:// and tcp:// are stream sockets. Broker
+// clients such as Kafka or MQTT plug in next to them.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/objects.h"
+
+namespace nvgst {
+
+enum class MessageFormat {
+  kJson,
+  kBinary,
+};
+
+constexpr char kWireMagic[4] = {'N', 'V', 'M', 'B'};
+constexpr uint16_t kWireVersion = 1;
+
+struct WireBatchHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t reserved;
+  uint32_t frames;
+  // Bytes of the frames after this header.
+  uint32_t size;
+};
+static_assert(sizeof(WireBatchHeader) == 16, "wire layout");
+
+struct WireFrame {
+  // Bytes of this frame including its objects.
+  uint32_t size;
+  uint32_t source;
+  uint64_t frame;
+  // ns, -1 when unknown.
+  int64_t pts;
+  uint32_t objects;
+  uint32_t reserved;
+};
+static_assert(sizeof(WireFrame) == 32, "wire layout");
+
+struct WireObject {
+  uint64_t track_id;
+  int32_t class_id;
+  float confidence;
+  float x;
+  float y;
+  float width;
+  float height;
+  uint32_t attributes;
+  uint32_t reserved;
+};
+static_assert(sizeof(WireObject) == 40, "wire layout");
+
+struct WireAttribute {
+  int32_t classifier;
+  int32_t label;
+  float confidence;
+  // 1 when reused from an earlier frame of the track.
+  uint32_t cached;
+};
+static_assert(sizeof(WireAttribute) == 16, "wire layout");
+
+// Upper bounds of one serialized frame (header and closing "]}\n") and of
+// one object, attributes included, so a frame reserves its space once and
+// then writes unchecked. The JSON worst cases, with 32-bit fields at their
+// minimum, 64-bit ones at their maximum and floats at the 15 characters of
+// their longest shortest form, are 90 bytes per frame; 153 per object with
+// its separator and the closing bracket of its attribute list; 90 for the
+// first attribute, which opens the list, and 76 for each later one.
+constexpr size_t kJsonFrameBound = 160;
+constexpr size_t kJsonObjectBaseBound = 160;
+constexpr size_t kJsonAttributeBound = 96;
+constexpr size_t kJsonObjectBound = kJsonObjectBaseBound + kMaxAttributes * kJsonAttributeBound;
+constexpr size_t kBinaryObjectBound = sizeof(WireObject) + kMaxAttributes * sizeof(WireAttribute);
+
+// One frame's metadata: the objects of objects[0, count) whose frame field
+// equals index (the frame's position in its batch).
+struct FrameMessage {
+  uint32_t source;
+  uint64_t frame;
+  int64_t pts;
+  uint32_t index;
+  const DetectedObject* objects;
+  size_t count;
+};
+
+class MessageBatch {
+ public:
+  // Empties the batch, keeping its memory.
+  void reset(MessageFormat format, int64_t now_ns);
+  void append(const FrameMessage& message);
+  // Completes the binary header; call before sending.
+  void finish();
+
+  const uint8_t* data() const { return data_.data(); }
+  size_t size() const { return size_; }
+  uint32_t frames() const { return frames_; }
+  // Time of reset(), for batching by age.
+  int64_t opened() const { return opened_; }
+
+ private:
+  // Room for n more bytes; the returned pointer is valid until the next
+  // call.
+  uint8_t* reserve(size_t n);
+  void append_json(const FrameMessage& message);
+  void append_binary(const FrameMessage& message);
+
+  MessageFormat format_ = MessageFormat::kJson;
+  std::vector<uint8_t> data_;
+  size_t size_ = 0;
+  uint32_t frames_ = 0;
+  int64_t opened_ = 0;
+};
+
+class MessageTransport {
+ public:
+  virtual ~MessageTransport() = default;
+  // (Re)establishes the connection; false with a description in *error
+  // while that is not possible.
+  virtual bool connect(std::string* error) = 0;
+  // Sends all of data; false when the connection broke.
+  virtual bool send(const uint8_t* data, size_t size) = 0;
+  virtual void disconnect() = 0;
+};
+
+// "file:///path", "unix:///path" or "tcp://host:port"; null for anything
+// else.
+std::unique_ptr<MessageTransport> create_message_transport(const std::string& uri);
+
+enum class SendBackpressure {
+  // Wait for the sender to free a slot.
+  kBlock,
+  // Drop the oldest batch that is not being sent.
+  kDropOldest,
+  // Drop the new batch.
+  kDropNewest,
+};
+
+class MessageSender {
+ public:
+  MessageSender() = default;
+  ~MessageSender() { stop(); }
+
+  MessageSender(const MessageSender&) = delete;
+  MessageSender& operator=(const MessageSender&) = delete;
+
+  // Starts the sender thread; it connects on its own and reconnects every
+  // retry_ms after a failure.
+  void start(std::unique_ptr<MessageTransport> transport, size_t max_pending,
+             SendBackpressure backpressure, int retry_ms = 1000);
+  // Sends what is queued if the transport is connected, drops it
+  // otherwise, and joins the thread.
+  void stop();
+
+  // Any thread: makes a blocked submit() drop its batch and return.
+  void set_flushing(bool flushing);
+
+  // Batching for append(): batches are opened in format and queued once
+  // they hold max_frames frames or, by the sender thread, once they are
+  // max_age_ns old (0 for no age limit). The format applies to the next
+  // batch opened, so flush() before changing it.
+  void set_batching(MessageFormat format, uint32_t max_frames, int64_t max_age_ns);
+
+  // Producing thread. append() serializes a frame into the open batch,
+  // opening one first, and queues the batch when it is full; false when a
+  // batch was dropped. flush() queues the open batch, if any.
+  bool append(const FrameMessage& message);
+  bool flush();
+
+  // Producing thread, for callers batching on their own. acquire()
+  // returns an arena to fill (reset by the caller); every acquired batch
+  // goes back through submit().
+  MessageBatch* acquire();
+  // Finishes and queues the batch; false when it was dropped.
+  bool submit(MessageBatch* batch);
+
+  // Frames sent, and frames dropped by backpressure or given up on at
+  // stop().
+  uint64_t sent() const { return sent_.load(std::memory_order_relaxed); }
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+  bool connected() const { return connected_.load(std::memory_order_relaxed); }
+  // Last connection error, empty while connected.
+  std::string last_error() const;
+
+ private:
+  void run();
+  // Takes the open batch if it is old enough to send, otherwise sets
+  // due_ to when it will be.
+  MessageBatch* take_aged();
+  // Counts the batch as dropped and returns it to the free list; called
+  // with the lock held.
+  void drop(MessageBatch* batch);
+
+  std::unique_ptr<MessageTransport> transport_;
+  size_t max_pending_ = 1;
+  SendBackpressure backpressure_ = SendBackpressure::kBlock;
+  int retry_ms_ = 1000;
+
+  // The batch append() fills; taken before lock_ when both are held.
+  std::mutex open_lock_;
+  MessageBatch* open_ = nullptr;
+  MessageFormat format_ = MessageFormat::kJson;
+  uint32_t max_frames_ = 1;
+  int64_t max_age_ns_ = 0;
+
+  mutable std::mutex lock_;
+  std::condition_variable wake_;
+  std::condition_variable not_full_;
+  std::deque<MessageBatch*> queue_;
+  std::vector<MessageBatch*> free_;
+  std::vector<std::unique_ptr<MessageBatch>> batches_;
+  bool stopping_ = false;
+  bool flushing_ = false;
+  // When the open batch is old enough to send, -1 when there is none or
+  // it has no age limit.
+  int64_t due_ = -1;
+  std::string error_;
+  std::thread thread_;
+
+  std::atomic<uint64_t> sent_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<bool> connected_{false};
+};
+
+}  // namespace nvgst
@@ -0,0 +1,68 @@
+// Objects found in frames: written by detectors, given track ids by the
+// tracker, labelled by secondary classifiers and read by later analytics.
+// Header-only, so code outside the plugin can fill a list it got through
+// GstNvObjectMeta.
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace nvgst {
+
+// Track ids start at 1; 0 marks an object no tracker has confirmed.
+constexpr uint64_t kNoTrack = 0;
+
+// Marks an unused attribute slot.
+constexpr int32_t kNoClassifier = -1;
+constexpr int kMaxAttributes = 4;
+
+// Label a secondary classifier (vehicle make, color, ...) gave an object.
+struct ObjectAttribute {
+  int32_t classifier = kNoClassifier;
+  int32_t label = 0;
+  float confidence = 0.0f;
+  // Reused from an earlier frame of the track rather than computed for
+  // this one.
+  bool cached = false;
+};
+
+struct DetectedObject {
+  uint32_t frame;  // frame index in a batch, 0 otherwise
+  int32_t class_id;
+  float confidence;
+  // Box in pixels of the frame.
+  float x;
+  float y;
+  float width;
+  float height;
+  uint64_t track_id;
+  ObjectAttribute attributes[kMaxAttributes];
+};
+
+inline ObjectAttribute* find_attribute(DetectedObject& object, int32_t classifier) {
+  for (ObjectAttribute& attribute : object.attributes) {
+    if (attribute.classifier == classifier)
+      return &attribute;
+  }
+  return nullptr;
+}
+
+inline const ObjectAttribute* find_attribute(const DetectedObject& object, int32_t classifier) {
+  return find_attribute(const_cast<DetectedObject&>(object), classifier);
+}
+
+// The attribute of classifier, or a free slot claimed for it; nullptr
+// when all slots belong to other classifiers.
+inline ObjectAttribute* add_attribute(DetectedObject& object, int32_t classifier) {
+  ObjectAttribute* attribute = find_attribute(object, classifier);
+  if (attribute == nullptr) {
+    attribute = find_attribute(object, kNoClassifier);
+    if (attribute != nullptr)
+      attribute->classifier = classifier;
+  }
+  return attribute;
+}
+
+using ObjectList = std::vector<DetectedObject>;
+
+}  // namespace nvgst
@@ -0,0 +1,432 @@
+#include "core/osd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace nvgst {
+
+namespace {
+
+inline uint8_t* row_ptr(const FrameView& f, int plane, int y) {
+  return f.data[plane] + static_cast<ptrdiff_t>(y) * f.stride[plane];
+}
+
+}  // namespace
+
+bool OsdRenderer::configure(const OsdConfig& config) {
+  if (config.format == PixelFormat::kUnknown || config.width <= 0 || config.height <= 0)
+    return false;
+
+  config_ = config;
+  kernels_ = &simd::kernels(config.simd);
+  for (int plane = 0; plane < format_n_planes(config.format); plane++)
+    bpp_[plane] = plane_pixel_stride(config.format, plane);
+  row_start_.assign(static_cast<size_t>(config.height) + 1, 0);
+  chroma_mask_.assign(static_cast<size_t>(config.width) / 2 + 1, 0);
+  runs_.clear();
+  active_.clear();
+  paints_.clear();
+  return true;
+}
+
+uint32_t OsdRenderer::add_paint(uint32_t color) {
+  if (!paints_.empty() && color == last_color_)
+    return last_paint_;
+
+  const uint8_t rgba[4] = {static_cast<uint8_t>(color >> 24), static_cast<uint8_t>(color >> 16),
+                           static_cast<uint8_t>(color >> 8), 0xff};
+  Paint paint{};
+  paint.alpha = color & 0xff;
+
+  switch (config_.format) {
+    case PixelFormat::kRGBA:
+      paint.pattern[0] = rgba[0] | rgba[1] << 8 | rgba[2] << 16 | 0xffu << 24;
+      break;
+    case PixelFormat::kBGRx:
+      paint.pattern[0] = rgba[2] | rgba[1] << 8 | rgba[0] << 16 | 0xffu << 24;
+      break;
+    default: {
+      // One pixel through the reference converters, so boxes match what
+      // nvconvert would produce for the same color.
+      const simd::Kernels& k = simd::kernels(SimdLevel::kScalar);
+      const simd::RgbToYuvCoeffs& c = simd::rgb_to_yuv_coeffs(config_.matrix);
+      uint8_t y, u, v;
+      k.rgb_to_y_row(rgba, &y, 1, c, false);
+      k.rgb_to_uv_row(rgba, rgba, &u, &v, 1, c, false);
+      paint.pattern[0] = y;
+      if (config_.format == PixelFormat::kNV12) {
+        paint.pattern[1] = u | v << 8;
+      } else {
+        paint.pattern[1] = u;
+        paint.pattern[2] = v;
+      }
+      break;
+    }
+  }
+
+  paints_.push_back(paint);
+  last_color_ = color;
+  last_paint_ = static_cast<uint32_t>(paints_.size() - 1);
+  return last_paint_;
+}
+
+void OsdRenderer::add_box(int x0, int y0, int x1, int y1, uint32_t paint) {
+  x0 = std::max(x0, 0);
+  x1 = std::min(x1, config_.width);
+  y0 = std::max(y0, 0);
+  y1 = std::min(y1, config_.height);
+  if (x1 <= x0 || y1 <= y0)
+    return;
+  runs_.push_back(Run{x0, x1, y0, y1, paint, nullptr, nullptr, 0, 0});
+}
+
+void OsdRenderer::add_rect(const DrawCommand& cmd, uint32_t paint) {
+  const int x0 = std::min(cmd.x0, cmd.x1);
+  const int x1 = std::max(cmd.x0, cmd.x1);
+  const int y0 = std::min(cmd.y0, cmd.y1);
+  const int y1 = std::max(cmd.y0, cmd.y1);
+  const int t = cmd.thickness;
+
+  if (cmd.kind == DrawKind::kFilledRect || 2 * t >= x1 - x0 || 2 * t >= y1 - y0) {
+    add_box(x0, y0, x1, y1, paint);
+    return;
+  }
+  // The outline grows inwards, so the box keeps its size at any thickness.
+  add_box(x0, y0, x1, y0 + t, paint);
+  add_box(x0, y0 + t, x0 + t, y1 - t, paint);
+  add_box(x1 - t, y0 + t, x1, y1 - t, paint);
+  add_box(x0, y1 - t, x1, y1, paint);
+}
+
+void OsdRenderer::add_line(const DrawCommand& cmd, uint32_t paint) {
+  const int t = cmd.thickness;
+  const double ax = cmd.x0 + 0.5;
+  const double ay = cmd.y0 + 0.5;
+  const double bx = cmd.x1 + 0.5;
+  const double by = cmd.y1 + 0.5;
+  const double length = std::hypot(bx - ax, by - ay);
+  if (length < 0.5) {
+    add_box(cmd.x0 - t / 2, cmd.y0 - t / 2, cmd.x0 - t / 2 + t, cmd.y0 - t / 2 + t, paint);
+    return;
+  }
+
+  // The line is the quad swept by a t wide segment between the two pixel
+  // centers; each row gets the pixels whose centers fall inside it.
+  const double nx = -(by - ay) / length * t / 2;
+  const double ny = (bx - ax) / length * t / 2;
+  const double vx[4] = {ax + nx, bx + nx, bx - nx, ax - nx};
+  const double vy[4] = {ay + ny, by + ny, by - ny, ay - ny};
+
+  const double top = std::min({vy[0], vy[1], vy[2], vy[3]});
+  const double bottom = std::max({vy[0], vy[1], vy[2], vy[3]});
+  const int y_begin = std::max(static_cast<int>(std::floor(top)), 0);
+  const int y_end = std::min(static_cast<int>(std::ceil(bottom)), config_.height);
+
+  for (int y = y_begin; y < y_end; y++) {
+    const double yc = y + 0.5;
+    double left = HUGE_VAL;
+    double right = -HUGE_VAL;
+    for (int e = 0; e < 4; e++) {
+      const int a = e;
+      const int b = (e + 1) & 3;
+      if (yc < std::min(vy[a], vy[b]) || yc > std::max(vy[a], vy[b]))
+        continue;
+      if (vy[a] == vy[b]) {
+        left = std::min({left, vx[a], vx[b]});
+        right = std::max({right, vx[a], vx[b]});
+        continue;
+      }
+      const double x = vx[a] + (yc - vy[a]) * (vx[b] - vx[a]) / (vy[b] - vy[a]);
+      left = std::min(left, x);
+      right = std::max(right, x);
+    }
+    if (left > right)
+      continue;
+    int x0 = static_cast<int>(std::ceil(left - 0.5));
+    int x1 = static_cast<int>(std::floor(right - 0.5)) + 1;
+    if (x1 <= x0) {
+      // Thinner than a pixel on this row: keep the line connected.
+      x0 = static_cast<int>(std::floor((left + right) / 2));
+      x1 = x0 + 1;
+    }
+    add_box(x0, y, x1, y + 1, paint);
+  }
+}
+
+namespace {
+
+// Characters [*first, *last) of a text at x with cells of cell_width are at
+// least partly inside [0, width).
+inline void visible_chars(int x, int length, int cell_width, int width, int* first, int* last) {
+  *first = x < 0 ? std::min(-x / cell_width, length) : 0;
+  *last = x < width ? std::min((width - x + cell_width - 1) / cell_width, length) : 0;
+}
+
+}  // namespace
+
+void OsdRenderer::reserve_text(const DrawList& list, uint32_t frame_index) {
+  size_t bytes = 0;
+  size_t rows = 0;
+  for (const DrawCommand& cmd : list.commands()) {
+    if (cmd.kind != DrawKind::kText || cmd.frame != frame_index)
+      continue;
+    const GlyphAtlas& atlas = glyphs_.get(cmd.font_size);
+    int first, last;
+    visible_chars(cmd.x0, static_cast<int>(cmd.text_length), atlas.cell_width(), config_.width,
+                  &first, &last);
+    if (last > first) {
+      bytes += static_cast<size_t>(last - first) * atlas.cell_width() * atlas.height();
+      rows += atlas.height();
+    }
+  }
+  if (strips_.size() < bytes)
+    strips_.resize(bytes);
+  if (strip_rows_.size() < rows)
+    strip_rows_.resize(rows);
+  strips_used_ = 0;
+  strip_rows_used_ = 0;
+}
+
+void OsdRenderer::add_text(const DrawCommand& cmd, const char* text, uint32_t paint) {
+  const GlyphAtlas& atlas = glyphs_.get(cmd.font_size);
+  const int length = static_cast<int>(cmd.text_length);
+  const int cell = atlas.cell_width();
+  const int height = atlas.height();
+
+  if (cmd.background & 0xff)
+    add_box(cmd.x0, cmd.y0, cmd.x0 + atlas.text_width(length), cmd.y0 + height,
+            add_paint(cmd.background));
+  if ((cmd.color & 0xff) == 0)
+    return;
+
+  const int y0 = std::max(cmd.y0, 0);
+  const int y1 = std::min(cmd.y0 + height, config_.height);
+  int first, last;
+  visible_chars(cmd.x0, length, cell, config_.width, &first, &last);
+  if (y1 <= y0 || last <= first)
+    return;
+
+  // Copy the visible cells side by side, tracking the covered columns of
+  // each strip row.
+  const int strip_width = (last - first) * cell;
+  uint8_t* strip = strips_.data() + strips_used_;
+  GlyphAtlas::RowExtent* rows = strip_rows_.data() + strip_rows_used_;
+  strips_used_ += static_cast<size_t>(strip_width) * height;
+  strip_rows_used_ += height;
+
+  for (int r = 0; r < height; r++)
+    rows[r] = GlyphAtlas::RowExtent{static_cast<uint16_t>(strip_width), 0};
+  for (int i = first; i < last; i++) {
+    const GlyphAtlas::Glyph glyph = atlas.glyph(text[i]);
+    const int offset = (i - first) * cell;
+    for (int r = 0; r < height; r++) {
+      std::memcpy(strip + r * strip_width + offset, glyph.coverage + r * cell, cell);
+      const GlyphAtlas::RowExtent& extent = glyph.rows[r];
+      if (extent.begin < extent.end) {
+        rows[r].begin = std::min<uint16_t>(rows[r].begin, offset + extent.begin);
+        rows[r].end = std::max<uint16_t>(rows[r].end, offset + extent.end);
+      }
+    }
+  }
+
+  const int x = cmd.x0 + first * cell;
+  const int skip = y0 - cmd.y0;
+  runs_.push_back(Run{std::max(x, 0), std::min(x + strip_width, config_.width), y0, y1, paint,
+                      strip + skip * strip_width, rows + skip, x, strip_width});
+}
+
+int OsdRenderer::draw(const FrameView& dst, const DrawList& list, uint32_t frame_index) {
+  if (dst.format != config_.format || dst.width != config_.width ||
+      dst.height != config_.height)
+    return 0;
+
+  runs_.clear();
+  paints_.clear();
+  glyphs_.trim();
+  reserve_text(list, frame_index);
+
+  int drawn = 0;
+  for (const DrawCommand& cmd : list.commands()) {
+    if (cmd.frame != frame_index)
+      continue;
+    const size_t before = runs_.size();
+    const bool visible = (cmd.color & 0xff) != 0;
+    switch (cmd.kind) {
+      case DrawKind::kRect:
+      case DrawKind::kFilledRect:
+        if (visible)
+          add_rect(cmd, add_paint(cmd.color));
+        break;
+      case DrawKind::kLine:
+        if (visible)
+          add_line(cmd, add_paint(cmd.color));
+        break;
+      case DrawKind::kText:
+        if (visible || (cmd.background & 0xff))
+          add_text(cmd, list.text(cmd), visible ? add_paint(cmd.color) : 0);
+        break;
+    }
+    if (runs_.size() != before)
+      drawn++;
+  }
+  if (runs_.empty())
+    return 0;
+
+  sort_runs();
+  active_.clear();
+  if (format_is_yuv(config_.format))
+    draw_yuv(dst);
+  else
+    draw_rgb(dst);
+  return drawn;
+}
+
+void OsdRenderer::sort_runs() {
+  // Counting sort by first row. It is stable, so each bucket stays in
+  // command order.
+  std::fill(row_start_.begin(), row_start_.end(), 0);
+  for (const Run& run : runs_)
+    row_start_[run.y0 + 1]++;
+  for (size_t y = 1; y < row_start_.size(); y++)
+    row_start_[y] += row_start_[y - 1];
+
+  order_.resize(runs_.size());
+  for (size_t i = 0; i < runs_.size(); i++)
+    order_[row_start_[runs_[i].y0]++] = static_cast<uint32_t>(i);
+  // Every bucket start moved to the next bucket; shift them back.
+  for (size_t y = row_start_.size() - 1; y > 0; y--)
+    row_start_[y] = row_start_[y - 1];
+  row_start_[0] = 0;
+}
+
+void OsdRenderer::enter_row(int y) {
+  const int begin = row_start_[y];
+  const int end = row_start_[y + 1];
+  if (begin == end)
+    return;
+  if (active_.empty()) {
+    active_.assign(order_.begin() + begin, order_.begin() + end);
+    return;
+  }
+  merged_.clear();
+  std::merge(active_.begin(), active_.end(), order_.begin() + begin, order_.begin() + end,
+             std::back_inserter(merged_));
+  active_.swap(merged_);
+}
+
+void OsdRenderer::retire_rows(int y_end) {
+  active_.erase(std::remove_if(active_.begin(), active_.end(),
+                               [&](uint32_t i) { return runs_[i].y1 <= y_end; }),
+                active_.end());
+}
+
+bool OsdRenderer::run_span(const Run& run, int y, int* x0, int* x1,
+                           const uint8_t** mask) const {
+  if (run.mask == nullptr) {
+    *x0 = run.x0;
+    *x1 = run.x1;
+    *mask = nullptr;
+    return true;
+  }
+  const int r = y - run.y0;
+  const GlyphAtlas::RowExtent& extent = run.extents[r];
+  *x0 = std::max(run.mask_x + extent.begin, run.x0);
+  *x1 = std::min(run.mask_x + extent.end, run.x1);
+  *mask = run.mask + r * run.mask_stride + (*x0 - run.mask_x);
+  return *x0 < *x1;
+}
+
+void OsdRenderer::draw_span(const FrameView& dst, int plane, int y, int x0, int x1,
+                            uint32_t pattern, int alpha, const uint8_t* mask) {
+  const int bpp = bpp_[plane];
+  uint8_t* p = row_ptr(dst, plane, y) + static_cast<ptrdiff_t>(x0) * bpp;
+  if (mask != nullptr)
+    kernels_->blend_mask_span(p, mask, x1 - x0, pattern, bpp, alpha);
+  else if (alpha == 255)
+    kernels_->fill_span(p, x1 - x0, pattern, bpp);
+  else
+    kernels_->blend_span(p, x1 - x0, pattern, bpp, alpha);
+}
+
+void OsdRenderer::draw_luma_row(const FrameView& dst, int y) {
+  int x0, x1;
+  const uint8_t* mask;
+  for (uint32_t i : active_) {
+    const Run& run = runs_[i];
+    if (run.y1 <= y || !run_span(run, y, &x0, &x1, &mask))
+      continue;
+    const Paint& paint = paints_[run.paint];
+    draw_span(dst, 0, y, x0, x1, paint.pattern[0], paint.alpha, mask);
+  }
+}
+
+void OsdRenderer::draw_rgb(const FrameView& dst) {
+  for (int y = 0; y < config_.height; y++) {
+    enter_row(y);
+    if (active_.empty())
+      continue;
+    draw_luma_row(dst, y);
+    retire_rows(y + 1);
+  }
+}
+
+void OsdRenderer::draw_yuv(const FrameView& dst) {
+  const int chroma_height = plane_height(config_.format, 1, config_.height);
+  int x0, x1;
+  const uint8_t* mask;
+
+  for (int cy = 0; cy < chroma_height; cy++) {
+    const int even = 2 * cy;
+    const int odd = even + 1 < config_.height ? even + 1 : even;
+
+    enter_row(even);
+    draw_luma_row(dst, even);
+    if (odd != even) {
+      enter_row(odd);
+      draw_luma_row(dst, odd);
+    }
+    if (active_.empty())
+      continue;
+
+    // Chroma from the runs on the even row, plus opaque solid runs that
+    // only start on the odd row. active_ keeps them in command order.
+    for (uint32_t i : active_) {
+      const Run& run = runs_[i];
+      const Paint& paint = paints_[run.paint];
+      if (run.y0 <= even) {
+        if (run_span(run, even, &x0, &x1, &mask))
+          draw_chroma(dst, cy, x0, x1, mask, paint);
+      } else if (run.mask == nullptr && paint.alpha == 255) {
+        draw_chroma(dst, cy, run.x0, run.x1, nullptr, paint);
+      }
+    }
+    retire_rows(odd + 1);
+  }
+}
+
+void OsdRenderer::draw_chroma(const FrameView& dst, int cy, int x0, int x1, const uint8_t* mask,
+                              const Paint& paint) {
+  const int cx0 = x0 / 2;
+  const int cx1 = (x1 + 1) / 2;
+  const uint8_t* chroma_mask = nullptr;
+
+  if (mask != nullptr) {
+    // Average coverage of the two luma samples under each chroma sample;
+    // samples outside the span count as uncovered.
+    for (int cx = cx0; cx < cx1; cx++) {
+      const int a = 2 * cx;
+      const int b = a + 1;
+      const int ma = a >= x0 ? mask[a - x0] : 0;
+      const int mb = b < x1 ? mask[b - x0] : 0;
+      chroma_mask_[cx - cx0] = static_cast<uint8_t>((ma + mb + 1) >> 1);
+    }
+    chroma_mask = chroma_mask_.data();
+  }
+
+  draw_span(dst, 1, cy, cx0, cx1, paint.pattern[1], paint.alpha, chroma_mask);
+  if (config_.format == PixelFormat::kI420)
+    draw_span(dst, 2, cy, cx0, cx1, paint.pattern[2], paint.alpha, chroma_mask);
+}
+
+}  // namespace nvgst
@@ -0,0 +1,108 @@
+// Rasterizer behind nvosd. All commands of a frame are first turned into
+// clipped runs (a span repeated over a range of rows, or a glyph cell),
+// bucketed by first row, and then drawn in a single top-to-bottom walk over
+// the frame through the Kernels span functions, so each row is touched once
+// while it is in cache no matter how many boxes cross it. Text comes from a
+// GlyphCache: a label's cells are copied side by side into a coverage strip,
+// so it costs one masked blend per row and no glyph is rasterized per
+// frame.
+//
+// On 4:2:0 frames chroma is painted once per 2x2 block from the runs
+// covering the even luma row; opaque runs starting on the odd row are added
+// too, so one pixel wide lines keep their color.
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/draw_list.h"
+#include "core/frame.h"
+#include "core/glyph_atlas.h"
+#include "core/kernels.h"
+
+namespace nvgst {
+
+struct OsdConfig {
+  PixelFormat format = PixelFormat::kUnknown;  // NV12, I420, RGBA or BGRx
+  int width = 0;
+  int height = 0;
+  ColorMatrix matrix = ColorMatrix::kBT601;
+  SimdLevel simd = SimdLevel::kAvx2;
+};
+
+class OsdRenderer {
+ public:
+  bool configure(const OsdConfig& config);
+  const OsdConfig& config() const { return config_; }
+
+  // Draws the commands of list addressed to frame_index into dst, in list
+  // order. dst must match the configured format and size. Returns the
+  // number of commands that touched the frame.
+  int draw(const FrameView& dst, const DrawList& list, uint32_t frame_index = 0);
+
+ private:
+  // A color in the frame's format: one pattern per plane plus opacity.
+  struct Paint {
+    uint32_t pattern[3];
+    int alpha;
+  };
+
+  // Rows [y0, y1) of a solid span [x0, x1), or of a text strip whose
+  // column 0 is at mask_x, with mask and extents advanced to row y0. Both
+  // ranges are clipped to the frame. Runs are drawn in the order they were
+  // added, so later commands paint over earlier ones.
+  struct Run {
+    int x0, x1;
+    int y0, y1;
+    uint32_t paint;
+    const uint8_t* mask;
+    const GlyphAtlas::RowExtent* extents;
+    int mask_x;
+    int mask_stride;
+  };
+
+  uint32_t add_paint(uint32_t color);
+  void add_box(int x0, int y0, int x1, int y1, uint32_t paint);
+  void add_rect(const DrawCommand& cmd, uint32_t paint);
+  void add_line(const DrawCommand& cmd, uint32_t paint);
+  void add_text(const DrawCommand& cmd, const char* text, uint32_t paint);
+
+  void reserve_text(const DrawList& list, uint32_t frame_index);
+  void sort_runs();
+  void enter_row(int y);
+  void retire_rows(int y_end);
+  // The part of run on row y; false when it leaves the row empty.
+  bool run_span(const Run& run, int y, int* x0, int* x1, const uint8_t** mask) const;
+  void draw_span(const FrameView& dst, int plane, int y, int x0, int x1, uint32_t pattern,
+                 int alpha, const uint8_t* mask);
+  void draw_luma_row(const FrameView& dst, int y);
+  void draw_chroma(const FrameView& dst, int cy, int x0, int x1, const uint8_t* mask,
+                   const Paint& paint);
+  void draw_rgb(const FrameView& dst);
+  void draw_yuv(const FrameView& dst);
+
+  OsdConfig config_;
+  const simd::Kernels* kernels_ = &simd::kernels(SimdLevel::kScalar);
+  int bpp_[3] = {0, 0, 0};
+  GlyphCache glyphs_;
+  // Most labels and boxes share a few colors; the last one is reused.
+  uint32_t last_color_ = 0;
+  uint32_t last_paint_ = 0;
+  std::vector<Paint> paints_;
+  std::vector<Run> runs_;
+  // Run indices bucketed by first row; row_start_ has height + 1 offsets.
+  std::vector<uint32_t> order_;
+  std::vector<int> row_start_;
+  // Indices of the runs covering the current row, in ascending order.
+  std::vector<uint32_t> active_;
+  std::vector<uint32_t> merged_;
+  // Text strips of the current frame, sized up front so runs can point
+  // into them.
+  std::vector<uint8_t> strips_;
+  std::vector<GlyphAtlas::RowExtent> strip_rows_;
+  size_t strips_used_ = 0;
+  size_t strip_rows_used_ = 0;
+  std::vector<uint8_t> chroma_mask_;
+};
+
+}  // namespace nvgst
@@ -0,0 +1,298 @@
+#include "core/postprocess.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace nvgst {
+
+namespace {
+
+inline float sigmoid(float x) { return 1.0f / (1.0f + std::exp(-x)); }
+
+// Sorts ascending for scores >= 0, so the inverse sorts best first.
+inline uint32_t score_bits(float score) {
+  const float s = score + 0.0f;  // -0 to +0
+  uint32_t bits;
+  std::memcpy(&bits, &s, sizeof(bits));
+  return bits;
+}
+
+constexpr int kMaxClasses = 0xffff;
+
+}  // namespace
+
+bool DetectionPostprocessor::configure(const DetectionConfig& config) {
+  if (config.input_width <= 0 || config.input_height <= 0)
+    return false;
+  if (config.frame_width <= 0 || config.frame_height <= 0)
+    return false;
+  if (!(config.confidence_threshold >= 0.0f && config.confidence_threshold <= 1.0f))
+    return false;
+  if (!(config.iou_threshold > 0.0f && config.iou_threshold <= 1.0f))
+    return false;
+  if (config.pre_nms_top_k < 0 || config.max_detections < 0)
+    return false;
+
+  grid_x_.clear();
+  grid_y_.clear();
+  stride_.clear();
+  anchor_w_.clear();
+  anchor_h_.clear();
+  if (config.layout == DetectionLayout::kAnchorBased) {
+    const size_t levels = config.strides.size();
+    if (levels == 0 || config.anchors.empty() || config.anchors.size() % (2 * levels) != 0)
+      return false;
+    const size_t per_level = config.anchors.size() / (2 * levels);
+    for (size_t l = 0; l < levels; l++) {
+      const int stride = config.strides[l];
+      if (stride <= 0)
+        return false;
+      const float* anchors = config.anchors.data() + 2 * per_level * l;
+      for (int y = 0; y < config.input_height / stride; y++) {
+        for (int x = 0; x < config.input_width / stride; x++) {
+          for (size_t a = 0; a < per_level; a++) {
+            grid_x_.push_back(static_cast<float>(x));
+            grid_y_.push_back(static_cast<float>(y));
+            stride_.push_back(static_cast<float>(stride));
+            anchor_w_.push_back(anchors[2 * a]);
+            anchor_h_.push_back(anchors[2 * a + 1]);
+          }
+        }
+      }
+    }
+  }
+
+  config_ = config;
+  kernels_ = &simd::kernels(config.simd);
+  scale_x_ = static_cast<float>(config.frame_width) / static_cast<float>(config.input_width);
+  scale_y_ = static_cast<float>(config.frame_height) / static_cast<float>(config.input_height);
+  return true;
+}
+
+bool DetectionPostprocessor::run(const Tensor& output, int frames, ObjectList* out) {
+  const std::vector<int>& shape = output.info.shape;
+  if (shape.size() != 3 || shape[0] != frames || !output.data)
+    return false;
+
+  int classes;
+  int candidates;
+  if (config_.layout == DetectionLayout::kAnchorFree) {
+    classes = shape[1] - 4;
+    candidates = shape[2];
+  } else {
+    classes = shape[2] - 5;
+    candidates = shape[1];
+    if (candidates != anchor_candidates())
+      return false;
+  }
+  if (classes < 1 || classes > kMaxClasses || candidates < 1)
+    return false;
+
+  x0_.clear();
+  y0_.clear();
+  x1_.clear();
+  y1_.clear();
+  score_.clear();
+  class_id_.clear();
+  frame_.clear();
+
+  const size_t per_frame = static_cast<size_t>(shape[1]) * shape[2];
+  for (int f = 0; f < frames; f++) {
+    const float* data = output.data.get() + per_frame * f;
+    if (config_.layout == DetectionLayout::kAnchorFree)
+      decode_anchor_free(data, classes, candidates, f);
+    else
+      decode_anchor_based(data, classes, candidates, f);
+  }
+
+  suppress(out);
+  return true;
+}
+
+void DetectionPostprocessor::decode_anchor_free(const float* data, int classes, int candidates,
+                                                uint32_t frame) {
+  const size_t n = static_cast<size_t>(candidates);
+  best_.resize(n);
+  class_.resize(n);
+  selected_.resize(n);
+
+  kernels_->argmax_rows(data + 4 * n, n, classes, candidates, best_.data(), class_.data());
+  const int count = kernels_->select_above(best_.data(), candidates,
+                                           config_.confidence_threshold, selected_.data());
+  selected_.resize(count);
+  keep_top_k(config_.pre_nms_top_k);
+
+  for (int32_t i : selected_)
+    add_candidate(frame, class_[i], best_[i], data[i], data[n + i], data[2 * n + i],
+                  data[3 * n + i]);
+}
+
+// Rows are interleaved here, so instead of vector passes over the classes
+// the objectness logit is checked first: a candidate cannot reach the
+// threshold when its objectness alone does not, which rules out nearly all
+// rows with one compare and leaves the class argmax to the few that remain.
+void DetectionPostprocessor::decode_anchor_based(const float* data, int classes, int candidates,
+                                                 uint32_t frame) {
+  const size_t row = static_cast<size_t>(classes) + 5;
+  const float threshold = config_.confidence_threshold;
+  const float min_logit = threshold <= 0.0f ? -std::numeric_limits<float>::infinity()
+                                            : std::log(threshold / (1.0f - threshold));
+  best_.resize(candidates);
+  class_.resize(candidates);
+  selected_.clear();
+
+  for (int i = 0; i < candidates; i++) {
+    const float* r = data + row * i;
+    if (!(r[4] >= min_logit))
+      continue;
+    const float* logits = r + 5;
+    int32_t k = 0;
+    for (int c = 1; c < classes; c++) {
+      if (logits[c] > logits[k])
+        k = c;
+    }
+    const float score = sigmoid(r[4]) * sigmoid(logits[k]);
+    if (score >= threshold) {
+      best_[i] = score;
+      class_[i] = k;
+      selected_.push_back(i);
+    }
+  }
+  keep_top_k(config_.pre_nms_top_k);
+
+  for (int32_t i : selected_) {
+    const float* r = data + row * i;
+    const float stride = stride_[i];
+    const float cx = (sigmoid(r[0]) * 2.0f - 0.5f + grid_x_[i]) * stride;
+    const float cy = (sigmoid(r[1]) * 2.0f - 0.5f + grid_y_[i]) * stride;
+    const float tw = sigmoid(r[2]) * 2.0f;
+    const float th = sigmoid(r[3]) * 2.0f;
+    add_candidate(frame, class_[i], best_[i], cx, cy, tw * tw * anchor_w_[i],
+                  th * th * anchor_h_[i]);
+  }
+}
+
+// Keeps the limit best of selected_ by best_, ties to the lower index.
+void DetectionPostprocessor::keep_top_k(int limit) {
+  if (limit == 0 || selected_.size() <= static_cast<size_t>(limit))
+    return;
+  const float* best = best_.data();
+  std::nth_element(selected_.begin(), selected_.begin() + limit, selected_.end(),
+                   [best](int32_t a, int32_t b) {
+                     return best[a] > best[b] || (best[a] == best[b] && a < b);
+                   });
+  selected_.resize(limit);
+}
+
+void DetectionPostprocessor::add_candidate(uint32_t frame, int32_t class_id, float score, float cx,
+                                           float cy, float w, float h) {
+  const float fw = static_cast<float>(config_.frame_width);
+  const float fh = static_cast<float>(config_.frame_height);
+  const float x0 = std::min(std::max((cx - 0.5f * w) * scale_x_, 0.0f), fw);
+  const float y0 = std::min(std::max((cy - 0.5f * h) * scale_y_, 0.0f), fh);
+  const float x1 = std::min(std::max((cx + 0.5f * w) * scale_x_, 0.0f), fw);
+  const float y1 = std::min(std::max((cy + 0.5f * h) * scale_y_, 0.0f), fh);
+  if (!(x1 > x0 && y1 > y0))
+    return;
+
+  x0_.push_back(x0);
+  y0_.push_back(y0);
+  x1_.push_back(x1);
+  y1_.push_back(y1);
+  score_.push_back(score);
+  class_id_.push_back(class_id);
+  frame_.push_back(frame);
+}
+
+void DetectionPostprocessor::suppress(ObjectList* out) {
+  const int n = static_cast<int>(score_.size());
+  order_.resize(n);
+  for (int i = 0; i < n; i++) {
+    const uint64_t group = config_.class_agnostic ? 0 : static_cast<uint64_t>(class_id_[i]);
+    order_[i].first = (static_cast<uint64_t>(frame_[i]) << 48) | (group << 32) |
+                      static_cast<uint32_t>(~score_bits(score_[i]));
+    order_[i].second = i;
+  }
+  std::sort(order_.begin(), order_.end());
+
+  sx0_.resize(n);
+  sy0_.resize(n);
+  sx1_.resize(n);
+  sy1_.resize(n);
+  iou_.resize(n);
+  for (int i = 0; i < n; i++) {
+    const int32_t c = order_[i].second;
+    sx0_[i] = x0_[c];
+    sy0_[i] = y0_[c];
+    sx1_[i] = x1_[c];
+    sy1_[i] = y1_[c];
+  }
+  suppressed_.assign(n, 0);
+  kept_.clear();
+
+  // Segments share frame and class; within one, each kept box suppresses
+  // what it overlaps further down.
+  for (int begin = 0; begin < n;) {
+    const uint64_t group = order_[begin].first >> 32;
+    int end = begin + 1;
+    while (end < n && order_[end].first >> 32 == group)
+      end++;
+
+    for (int i = begin; i < end; i++) {
+      if (suppressed_[i])
+        continue;
+      kept_.push_back(i);
+      const int rest = end - i - 1;
+      if (rest == 0)
+        break;
+      const float box[4] = {sx0_[i], sy0_[i], sx1_[i], sy1_[i]};
+      kernels_->iou_row(&sx0_[i + 1], &sy0_[i + 1], &sx1_[i + 1], &sy1_[i + 1], rest, box,
+                        iou_.data());
+      for (int j = 0; j < rest; j++)
+        suppressed_[i + 1 + j] |= iou_[j] > config_.iou_threshold;
+    }
+    begin = end;
+  }
+
+  // kept_ is in frame order; rank each frame's boxes across classes.
+  const float* score = score_.data();
+  auto better = [this, score](int32_t a, int32_t b) {
+    const float sa = score[order_[a].second];
+    const float sb = score[order_[b].second];
+    return sa > sb || (sa == sb && a < b);
+  };
+  out->reserve(out->size() + kept_.size());
+  const int kept = static_cast<int>(kept_.size());
+  for (int begin = 0; begin < kept;) {
+    const uint32_t frame = frame_[order_[kept_[begin]].second];
+    int end = begin + 1;
+    while (end < kept && frame_[order_[kept_[end]].second] == frame)
+      end++;
+
+    int limit = end - begin;
+    if (config_.max_detections > 0)
+      limit = std::min(limit, config_.max_detections);
+    std::partial_sort(kept_.begin() + begin, kept_.begin() + begin + limit, kept_.begin() + end,
+                      better);
+
+    for (int k = begin; k < begin + limit; k++) {
+      const int32_t s = kept_[k];
+      const int32_t c = order_[s].second;
+      DetectedObject object;
+      object.frame = frame;
+      object.class_id = class_id_[c];
+      object.confidence = score_[c];
+      object.x = sx0_[s];
+      object.y = sy0_[s];
+      object.width = sx1_[s] - sx0_[s];
+      object.height = sy1_[s] - sy0_[s];
+      object.track_id = kNoTrack;
+      out->push_back(object);
+    }
+    begin = end;
+  }
+}
+
+}  // namespace nvgst
@@ -0,0 +1,124 @@
+// Turns raw detector outputs into objects: decodes boxes and scores,
+// drops candidates under the confidence threshold, keeps the best
+// pre_nms_top_k per frame and runs class-aware non-maximum suppression,
+// for every frame of a batch in one run() call.
+//
+// Decoding works on whole tensors with SIMD kernels where the layout
+// allows it (Kernels::argmax_rows over the class rows of channel-first
+// outputs, Kernels::select_above to compact survivors). Candidates of all
+// frames go into one structure-of-arrays list that is sorted once by
+// frame, class and score, so NMS is one Kernels::iou_row call per kept box
+// over the rest of its class. All scratch arrays are members and keep
+// their capacity from call to call.
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "core/kernels.h"
+#include "core/objects.h"
+#include "core/tensor.h"
+
+namespace nvgst {
+
+enum class DetectionLayout {
+  // {frames, 4 + classes, candidates}, YOLOv8 style: rows of center x,
+  // center y, width, height in network pixels, then one row of
+  // probabilities per class.
+  kAnchorFree,
+  // {frames, candidates, 5 + classes}, raw YOLOv5 style heads: per
+  // candidate logits tx, ty, tw, th, objectness, then one per class.
+  // Candidates are ordered by stride, grid row, grid column and anchor;
+  // boxes decode against the grid cell and the anchor.
+  kAnchorBased,
+};
+
+struct DetectionConfig {
+  DetectionLayout layout = DetectionLayout::kAnchorFree;
+  // Network input, the pixels boxes are decoded in.
+  int input_width = 640;
+  int input_height = 640;
+  // Frames the objects are written for; boxes are scaled and clipped to
+  // them.
+  int frame_width = 0;
+  int frame_height = 0;
+  float confidence_threshold = 0.25f;
+  // Candidates overlapping a better one of the same class by more than
+  // this are suppressed.
+  float iou_threshold = 0.45f;
+  // Per frame, 0 for no limit.
+  int pre_nms_top_k = 1000;
+  int max_detections = 300;
+  // Suppress across classes too.
+  bool class_agnostic = false;
+  // kAnchorBased: feature map strides and, for each in turn, the same
+  // number of anchor (width, height) pairs in network pixels. The default
+  // is YOLOv5's.
+  std::vector<int> strides = {8, 16, 32};
+  std::vector<float> anchors = {10,  13, 16,  30,  33, 23,  30,  61,  62,
+                                45,  59, 119, 116, 90, 156, 198, 373, 326};
+  SimdLevel simd = SimdLevel::kAvx2;
+};
+
+// Not thread-safe: one postprocessor per streaming thread.
+class DetectionPostprocessor {
+ public:
+  bool configure(const DetectionConfig& config);
+  const DetectionConfig& config() const { return config_; }
+
+  // Candidates per frame the anchor grid of a kAnchorBased config
+  // produces.
+  int anchor_candidates() const { return static_cast<int>(grid_x_.size()); }
+
+  // Decodes frames frames of output, whose first dimension is the frame,
+  // and appends the objects to out, frame by frame and best first. Returns
+  // false when the tensor does not match the layout.
+  bool run(const Tensor& output, int frames, ObjectList* out);
+
+ private:
+  void decode_anchor_free(const float* data, int classes, int candidates, uint32_t frame);
+  void decode_anchor_based(const float* data, int classes, int candidates, uint32_t frame);
+  void keep_top_k(int limit);
+  void add_candidate(uint32_t frame, int32_t class_id, float score, float cx, float cy, float w,
+                     float h);
+  void suppress(ObjectList* out);
+
+  DetectionConfig config_;
+  const simd::Kernels* kernels_ = &simd::kernels(SimdLevel::kScalar);
+  float scale_x_ = 1.0f;
+  float scale_y_ = 1.0f;
+
+  // kAnchorBased grid, one entry per candidate.
+  std::vector<float> grid_x_;
+  std::vector<float> grid_y_;
+  std::vector<float> stride_;
+  std::vector<float> anchor_w_;
+  std::vector<float> anchor_h_;
+
+  // Per frame decode scratch.
+  std::vector<float> best_;
+  std::vector<int32_t> class_;
+  std::vector<int32_t> selected_;
+
+  // Candidates of the whole batch, in decode order.
+  std::vector<float> x0_;
+  std::vector<float> y0_;
+  std::vector<float> x1_;
+  std::vector<float> y1_;
+  std::vector<float> score_;
+  std::vector<int32_t> class_id_;
+  std::vector<uint32_t> frame_;
+  // (frame, class, score) sort key and candidate index.
+  std::vector<std::pair<uint64_t, int32_t>> order_;
+  // Candidates in sorted order, what NMS runs on.
+  std::vector<float> sx0_;
+  std::vector<float> sy0_;
+  std::vector<float> sx1_;
+  std::vector<float> sy1_;
+  std::vector<float> iou_;
+  std::vector<uint8_t> suppressed_;
+  std::vector<int32_t> kept_;
+};
+
+}  // namespace nvgst
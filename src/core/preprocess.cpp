@@ -0,0 +1,72 @@
+#include "core/preprocess.h"
+
+#include <utility>
+
+namespace nvgst {
+
+bool TensorPreprocessor::configure(const PreprocessConfig& config) {
+  if (config.width <= 0 || config.height <= 0 || config.out_width <= 0 || config.out_height <= 0)
+    return false;
+  if (format_n_planes(config.format) == 0)
+    return false;
+
+  config_ = config;
+  kernels_ = &simd::kernels(config.simd);
+
+  const bool packed_input =
+      config.format == PixelFormat::kRGBA || config.format == PixelFormat::kBGRx;
+  direct_ = packed_input && config.width == config.out_width && config.height == config.out_height;
+  if (direct_) {
+    swap_ = (config.format == PixelFormat::kBGRx) != config.bgr;
+    packed_.reset();
+    return true;
+  }
+
+  // Convert into the byte order of the planes so packing needs no swap.
+  ConvertConfig cc;
+  cc.in_format = config.format;
+  cc.in_width = config.width;
+  cc.in_height = config.height;
+  cc.out_format = config.bgr ? PixelFormat::kBGRx : PixelFormat::kRGBA;
+  cc.out_width = config.out_width;
+  cc.out_height = config.out_height;
+  cc.matrix = config.matrix;
+  cc.simd = config.simd;
+  if (!converter_.configure(cc))
+    return false;
+  swap_ = false;
+  packed_layout_ = make_frame_layout(cc.out_format, config.out_width, config.out_height);
+  return packed_.reserve(packed_layout_.size);
+}
+
+size_t TensorPreprocessor::tensor_size() const {
+  return static_cast<size_t>(3) * config_.out_width * config_.out_height;
+}
+
+void TensorPreprocessor::run(const FrameView& src, float* dst) {
+  FrameView packed = src;
+  if (!direct_) {
+    packed = make_frame_view(packed_layout_, packed_.data());
+    converter_.convert(src, packed);
+  }
+
+  const int w = config_.out_width;
+  const size_t plane = static_cast<size_t>(w) * config_.out_height;
+  float* c0 = dst;
+  float* c2 = dst + 2 * plane;
+  float offset[3] = {config_.offset[0], config_.offset[1], config_.offset[2]};
+  float scale[3] = {config_.scale[0], config_.scale[1], config_.scale[2]};
+  if (swap_) {
+    std::swap(c0, c2);
+    std::swap(offset[0], offset[2]);
+    std::swap(scale[0], scale[2]);
+  }
+
+  for (int y = 0; y < config_.out_height; y++) {
+    const size_t row = static_cast<size_t>(y) * w;
+    kernels_->planar_f32_row(packed.data[0] + static_cast<ptrdiff_t>(y) * packed.stride[0], w,
+                             c0 + row, dst + plane + row, c2 + row, offset, scale);
+  }
+}
+
+}  // namespace nvgst
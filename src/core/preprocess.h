@@ -0,0 +1,54 @@
+// Turns frames into the planar float input of a network: scaling and
+// colorspace conversion through VideoConverter into one packed RGB
+// scratch frame, then Kernels::planar_f32_row to split, normalize and
+// write the channel planes straight into the request's tensor. RGBA and
+// BGRx frames that already have the network's size skip the converter and
+// are packed from the input buffer directly.
+#pragma once
+
+#include "core/aligned_buffer.h"
+#include "core/convert.h"
+#include "core/frame.h"
+#include "core/kernels.h"
+
+namespace nvgst {
+
+struct PreprocessConfig {
+  PixelFormat format = PixelFormat::kUnknown;
+  int width = 0;
+  int height = 0;
+  ColorMatrix matrix = ColorMatrix::kBT601;
+  int out_width = 0;
+  int out_height = 0;
+  // Planes in B, G, R order instead of R, G, B.
+  bool bgr = false;
+  // Per plane: (value - offset) * scale, in plane order.
+  float offset[3] = {0.0f, 0.0f, 0.0f};
+  float scale[3] = {1.0f / 255.0f, 1.0f / 255.0f, 1.0f / 255.0f};
+  SimdLevel simd = SimdLevel::kAvx2;
+};
+
+// Not thread-safe: one preprocessor per streaming thread.
+class TensorPreprocessor {
+ public:
+  bool configure(const PreprocessConfig& config);
+  const PreprocessConfig& config() const { return config_; }
+
+  // Floats written per frame: 3 * out_width * out_height.
+  size_t tensor_size() const;
+
+  // Writes the three planes of src to dst, one after the other.
+  void run(const FrameView& src, float* dst);
+
+ private:
+  PreprocessConfig config_;
+  const simd::Kernels* kernels_ = &simd::kernels(SimdLevel::kScalar);
+  bool direct_ = false;
+  // Byte 0 of a packed pixel goes to plane 0 unless swapped with byte 2.
+  bool swap_ = false;
+  VideoConverter converter_;
+  FrameLayout packed_layout_;
+  AlignedBuffer packed_;
+};
+
+}  // namespace nvgst
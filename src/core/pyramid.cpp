@@ -0,0 +1,97 @@
+#include "core/pyramid.h"
+
+#include <algorithm>
+
+namespace nvgst {
+
+namespace {
+
+// Luma (or RGB) source rows per band: small enough that a band of a 4K
+// frame plus its chroma stays in L2 while every level reads it.
+constexpr int kBandRows = 32;
+
+}  // namespace
+
+bool PyramidScaler::configure(const PyramidConfig& config, const ThreadPool* pool) {
+  const PixelFormat format = config.format;
+  if (format == PixelFormat::kUnknown || config.width <= 0 || config.height <= 0 ||
+      config.levels.empty())
+    return false;
+  const bool yuv = format_is_yuv(format);
+  for (const PyramidLevel& level : config.levels) {
+    if (level.width <= 0 || level.height <= 0)
+      return false;
+    if (yuv && (level.width % 2 != 0 || level.height % 2 != 0))
+      return false;
+  }
+
+  const int n_levels = static_cast<int>(config.levels.size());
+  n_planes_ = format_n_planes(format);
+  scalers_.assign(static_cast<size_t>(n_levels) * 3, PlaneScaler());
+  layout_ = PyramidLayout();
+  size_t scratch = 0;
+  for (int i = 0; i < n_levels; i++) {
+    const PyramidLevel& level = config.levels[i];
+    for (int p = 0; p < n_planes_; p++) {
+      PlaneScaler& scaler = scalers_[i * 3 + p];
+      if (!scaler.configure(plane_width(format, p, config.width),
+                            plane_height(format, p, config.height),
+                            plane_width(format, p, level.width),
+                            plane_height(format, p, level.height), plane_pixel_stride(format, p)))
+        return false;
+      scratch = std::max(scratch, scaler.scratch_size());
+    }
+    // Levels are laid out back to back; frame layouts end aligned.
+    layout_.levels.push_back(make_frame_layout(format, level.width, level.height));
+    layout_.offset.push_back(layout_.size);
+    layout_.size += layout_.levels.back().size;
+  }
+
+  scratch_stride_ = scratch;
+  scratch_workers_ = pool ? pool->size() : 1;
+  if (!scratch_.reserve(scratch_stride_ * scratch_workers_))
+    return false;
+
+  n_bands_ = (config.height + kBandRows - 1) / kBandRows;
+  config_ = config;
+  kernels_ = &simd::kernels(config.simd);
+  return true;
+}
+
+void PyramidScaler::level_views(uint8_t* base, FrameView* views) const {
+  for (size_t i = 0; i < layout_.levels.size(); i++)
+    views[i] = make_frame_view(layout_.levels[i], base + layout_.offset[i]);
+}
+
+void PyramidScaler::run_band(const FrameView& src, const FrameView* levels, int band,
+                             uint8_t* scratch) const {
+  const bool last = band == n_bands_ - 1;
+  for (int p = 0; p < n_planes_; p++) {
+    const int rows = plane_height(config_.format, p, kBandRows);
+    for (int i = 0; i < n_levels(); i++) {
+      const PlaneScaler& scaler = scalers_[i * 3 + p];
+      const int y_begin = scaler.first_row(band * rows);
+      const int y_end = last ? scaler.dst_height() : scaler.first_row((band + 1) * rows);
+      if (y_begin < y_end)
+        scaler.scale_rows(src.data[p], src.stride[p], levels[i].data[p], levels[i].stride[p],
+                          y_begin, y_end, scratch, *kernels_);
+    }
+  }
+}
+
+void PyramidScaler::run(const FrameView& src, const FrameView* levels, ThreadPool* pool) {
+  uint8_t* scratch = scratch_.data();
+  const size_t stride = scratch_stride_;
+  // A pool that grew after configure() has no scratch for its new workers.
+  const int workers = pool ? pool->size() : 1;
+  if (workers == 1 || workers > scratch_workers_ || n_bands_ == 1) {
+    for (int band = 0; band < n_bands_; band++)
+      run_band(src, levels, band, scratch);
+    return;
+  }
+  pool->run(n_bands_, [&](int band, int worker) {
+    run_band(src, levels, band, scratch + stride * worker);
+  });
+}
+
+}  // namespace nvgst
@@ -0,0 +1,84 @@
+// Multi-resolution scaling of one frame into an image pyramid.
+//
+// Every level has its own bilinear PlaneScaler per plane, so the taps and
+// weights for each (source, level) size pair are computed once by
+// configure(). run() then walks the source once: it is cut into bands of
+// rows, and the task for a band produces the rows of every level whose
+// taps start inside the band, reading the band while it is still in cache
+// instead of streaming the full frame once per level.
+//
+// All levels live in one allocation: PyramidScaler::layout() places each
+// level's planes at aligned offsets so a single pooled buffer holds the
+// whole pyramid.
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "core/aligned_buffer.h"
+#include "core/frame.h"
+#include "core/kernels.h"
+#include "core/scaler.h"
+#include "core/thread_pool.h"
+
+namespace nvgst {
+
+struct PyramidLevel {
+  int width = 0;
+  int height = 0;
+};
+
+struct PyramidConfig {
+  PixelFormat format = PixelFormat::kUnknown;
+  int width = 0;
+  int height = 0;
+  // Any sizes, in any order; even for 4:2:0 formats. A level of the source
+  // size is a plain copy.
+  std::vector<PyramidLevel> levels;
+  SimdLevel simd = SimdLevel::kAvx2;
+};
+
+// Where each level sits in the pyramid buffer.
+struct PyramidLayout {
+  std::vector<FrameLayout> levels;
+  // Start of each level, a multiple of kFrameAlign.
+  std::vector<size_t> offset;
+  size_t size = 0;
+};
+
+// Not thread-safe: one scaler per streaming thread.
+class PyramidScaler {
+ public:
+  // Fails on an unsupported format or size. Scratch rows are sized for the
+  // pool as started at this point.
+  bool configure(const PyramidConfig& config, const ThreadPool* pool);
+  const PyramidConfig& config() const { return config_; }
+
+  int n_levels() const { return static_cast<int>(config_.levels.size()); }
+  const PyramidLayout& layout() const { return layout_; }
+  SimdLevel simd_level() const { return kernels_->level; }
+
+  // Views of the levels in a buffer of layout().size bytes.
+  void level_views(uint8_t* base, FrameView* views) const;
+
+  // Writes level i to levels[i]. src must match the configured format and
+  // size; levels are usually level_views() of one buffer but may be
+  // anywhere.
+  void run(const FrameView& src, const FrameView* levels, ThreadPool* pool);
+
+ private:
+  void run_band(const FrameView& src, const FrameView* levels, int band, uint8_t* scratch) const;
+
+  PyramidConfig config_;
+  const simd::Kernels* kernels_ = &simd::kernels(SimdLevel::kScalar);
+  PyramidLayout layout_;
+  int n_planes_ = 0;
+  int n_bands_ = 0;
+  // n_levels * 3 scalers, level-major.
+  std::vector<PlaneScaler> scalers_;
+  AlignedBuffer scratch_;
+  size_t scratch_stride_ = 0;
+  int scratch_workers_ = 0;
+};
+
+}  // namespace nvgst
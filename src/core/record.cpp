@@ -0,0 +1,475 @@
+#include "core/record.h"
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+namespace nvgst {
+
+void PreEventRing::set_limits(int64_t duration, uint64_t max_bytes) {
+  duration_ = std::max<int64_t>(duration, 0);
+  max_bytes_ = max_bytes;
+}
+
+void PreEventRing::push(const Entry& entry) {
+  if (keyframes_.empty() && !entry.keyframe) {
+    release_(entry.token);
+    return;
+  }
+  if (entry.keyframe)
+    keyframes_.push_back(base_ + entries_.size());
+  entries_.push_back(entry);
+  bytes_ += entry.bytes;
+
+  if (entry.time >= 0) {
+    const int64_t cutoff = entry.time - duration_;
+    while (keyframes_.size() >= 2) {
+      const int64_t next = entries_[keyframes_[1] - base_].time;
+      if (next < 0 || next > cutoff)
+        break;
+      drop_front_gop();
+    }
+  }
+  while (max_bytes_ != 0 && bytes_ > max_bytes_ && keyframes_.size() >= 2)
+    drop_front_gop();
+}
+
+void PreEventRing::drop_front_gop() {
+  const uint64_t end = keyframes_[1];
+  keyframes_.pop_front();
+  while (base_ < end) {
+    bytes_ -= entries_.front().bytes;
+    release_(entries_.front().token);
+    entries_.pop_front();
+    base_++;
+  }
+}
+
+long PreEventRing::find_keyframe(int64_t time) const {
+  if (keyframes_.empty())
+    return -1;
+  // Keyframe times only go up, even in streams with B-frames.
+  auto later = std::upper_bound(
+      keyframes_.begin(), keyframes_.end(), time,
+      [this](int64_t t, uint64_t k) { return t < entries_[k - base_].time; });
+  if (later != keyframes_.begin())
+    --later;
+  return static_cast<long>(*later - base_);
+}
+
+void PreEventRing::clear() {
+  for (const Entry& entry : entries_)
+    release_(entry.token);
+  base_ += entries_.size();
+  entries_.clear();
+  keyframes_.clear();
+  bytes_ = 0;
+}
+
+// Where the writer thread sends its writes. Each write carries a tag that
+// comes back with its result: bytes written or -errno.
+class RecordWriter::Backend {
+ public:
+  virtual ~Backend() = default;
+  virtual bool full() const = 0;
+  virtual void writev(int fd, const iovec* iov, int count, uint64_t offset, void* tag) = 0;
+  // Starts the queued writes; with wait, returns once at least one has
+  // completed.
+  virtual void submit(bool wait) = 0;
+  virtual bool complete(void** tag, int64_t* result) = 0;
+};
+
+// pwritev() on the writer thread: every write has completed by the time
+// submit() returns.
+class RecordWriter::SyncBackend : public RecordWriter::Backend {
+ public:
+  bool full() const override { return false; }
+
+  void writev(int fd, const iovec* iov, int count, uint64_t offset, void* tag) override {
+    ssize_t n = pwritev(fd, iov, count, static_cast<off_t>(offset));
+    done_.push_back({tag, n < 0 ? -static_cast<int64_t>(errno) : n});
+  }
+
+  void submit(bool) override {}
+
+  bool complete(void** tag, int64_t* result) override {
+    if (next_ == done_.size()) {
+      done_.clear();
+      next_ = 0;
+      return false;
+    }
+    *tag = done_[next_].first;
+    *result = done_[next_].second;
+    next_++;
+    return true;
+  }
+
+ private:
+  std::vector<std::pair<void*, int64_t>> done_;
+  size_t next_ = 0;
+};
+
+// io_uring through the raw syscalls, so there is no liburing dependency.
+// Only the writer thread touches the rings.
+class RecordWriter::UringBackend : public RecordWriter::Backend {
+ public:
+  ~UringBackend() override {
+    if (sqes_ != nullptr)
+      munmap(sqes_, sqes_size_);
+    if (cq_ring_ != nullptr && cq_ring_ != sq_ring_)
+      munmap(cq_ring_, cq_size_);
+    if (sq_ring_ != nullptr)
+      munmap(sq_ring_, sq_size_);
+    if (fd_ >= 0)
+      ::close(fd_);
+  }
+
+  // False when the kernel has no io_uring or does not let us use it.
+  bool init(unsigned entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd_ < 0)
+      return false;
+
+    sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single)
+      sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+    sq_ring_ = map(sq_size_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == nullptr)
+      return false;
+    cq_ring_ = single ? sq_ring_ : map(cq_size_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == nullptr)
+      return false;
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+    if (sqes_ == nullptr)
+      return false;
+
+    uint8_t* sq = static_cast<uint8_t*>(sq_ring_);
+    uint8_t* cq = static_cast<uint8_t*>(cq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    // The completion ring is at least as large, so it never overflows.
+    entries_ = params.sq_entries;
+    return true;
+  }
+
+  bool full() const override { return in_flight_ >= entries_; }
+
+  void writev(int fd, const iovec* iov, int count, uint64_t offset, void* tag) override {
+    const unsigned tail = *sq_tail_;
+    const unsigned index = tail & sq_mask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(iov);
+    sqe->len = static_cast<uint32_t>(count);
+    sqe->off = offset;
+    sqe->user_data = reinterpret_cast<uint64_t>(tag);
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    queued_++;
+    in_flight_++;
+  }
+
+  void submit(bool wait) override {
+    for (;;) {
+      const unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+      const long n = syscall(__NR_io_uring_enter, fd_, queued_, wait ? 1 : 0, flags, nullptr, 0);
+      if (n >= 0) {
+        // Entries the kernel did not take yet go with the next call.
+        queued_ -= std::min(queued_, static_cast<unsigned>(n));
+        return;
+      }
+      if (errno != EINTR)
+        return;
+    }
+  }
+
+  bool complete(void** tag, int64_t* result) override {
+    const unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE))
+      return false;
+    const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+    *tag = reinterpret_cast<void*>(cqe.user_data);
+    *result = cqe.res;
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    in_flight_--;
+    return true;
+  }
+
+ private:
+  void* map(size_t size, off_t offset) {
+    void* ptr =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+  }
+
+  int fd_ = -1;
+  void* sq_ring_ = nullptr;
+  void* cq_ring_ = nullptr;
+  size_t sq_size_ = 0;
+  size_t cq_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+  unsigned* sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned* sq_array_ = nullptr;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+  unsigned entries_ = 0;
+  // Written to the ring but not yet handed to the kernel.
+  unsigned queued_ = 0;
+  unsigned in_flight_ = 0;
+};
+
+namespace {
+
+// Writes in flight at once on io_uring.
+constexpr unsigned kUringEntries = 64;
+// Chunks gathered into one write.
+constexpr size_t kMaxIov = 64;
+
+}  // namespace
+
+struct RecordWriter::File {
+  uint64_t id;
+  std::string path;
+  int fd = -1;
+  // Where the next write goes; also the bytes submitted so far.
+  uint64_t offset = 0;
+  uint64_t written = 0;
+  int error = 0;
+  int in_flight = 0;
+  bool closing = false;
+};
+
+// Consecutive chunks of one file written with one writev.
+struct RecordWriter::Request {
+  File* file = nullptr;
+  uint64_t offset = 0;
+  uint64_t size = 0;
+  uint64_t done = 0;
+  std::vector<iovec> iov;
+  std::vector<void*> tokens;
+  // First iovec not completely written yet.
+  size_t first = 0;
+};
+
+RecordWriter::RecordWriter(RecordTokenRelease release) : release_(release) {}
+
+RecordWriter::~RecordWriter() { stop(); }
+
+bool RecordWriter::start(FileDone done, bool use_uring) {
+  stop();
+
+  std::unique_ptr<Backend> backend;
+  if (use_uring) {
+    std::unique_ptr<UringBackend> uring(new UringBackend());
+    if (uring->init(kUringEntries))
+      backend = std::move(uring);
+  }
+  uring_ = backend != nullptr;
+  if (backend == nullptr)
+    backend.reset(new SyncBackend());
+
+  stopping_ = false;
+  thread_ = std::thread([this, done, owned = std::move(backend)]() { run(done, owned.get()); });
+  return true;
+}
+
+void RecordWriter::stop() {
+  if (!thread_.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  thread_.join();
+}
+
+void RecordWriter::push(Op op) {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    ops_.push_back(std::move(op));
+  }
+  wake_.notify_one();
+}
+
+void RecordWriter::open(uint64_t id, const std::string& path) {
+  push({Op::kOpen, {nullptr, 0, nullptr}, id, path});
+}
+
+bool RecordWriter::write(const Chunk& chunk) {
+  const uint64_t limit = max_backlog_.load(std::memory_order_relaxed);
+  const uint64_t level = backlog_.load(std::memory_order_relaxed);
+  if (limit != 0 && level + chunk.size > limit)
+    return false;
+  backlog_.fetch_add(chunk.size, std::memory_order_relaxed);
+  push({Op::kWrite, chunk, 0, std::string()});
+  return true;
+}
+
+void RecordWriter::close() { push({Op::kClose, {nullptr, 0, nullptr}, 0, std::string()}); }
+
+size_t RecordWriter::issue(const std::vector<Op>& ops, size_t next, Backend* backend) {
+  while (next < ops.size() && !backend->full()) {
+    const Op& op = ops[next];
+    File* file = files_.empty() || files_.back()->closing ? nullptr : files_.back().get();
+
+    if (op.kind == Op::kOpen) {
+      if (file != nullptr)
+        file->closing = true;
+      std::unique_ptr<File> opened(new File());
+      opened->id = op.id;
+      opened->path = op.path;
+      opened->fd = ::open(op.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+      if (opened->fd < 0)
+        opened->error = errno;
+      files_.push_back(std::move(opened));
+      next++;
+      continue;
+    }
+    if (op.kind == Op::kClose) {
+      if (file != nullptr)
+        file->closing = true;
+      next++;
+      continue;
+    }
+
+    // Gathers this write and the ones right after it.
+    std::unique_ptr<Request> request(new Request());
+    while (next < ops.size() && ops[next].kind == Op::kWrite && request->iov.size() < kMaxIov) {
+      const Chunk& chunk = ops[next].chunk;
+      if (chunk.size > 0)
+        request->iov.push_back({const_cast<void*>(chunk.data), chunk.size});
+      request->tokens.push_back(chunk.token);
+      request->size += chunk.size;
+      next++;
+    }
+    request->file = file;
+    if (file == nullptr || file->fd < 0 || file->error != 0 || request->iov.empty()) {
+      release(request.release());
+      continue;
+    }
+    request->offset = file->offset;
+    file->offset += request->size;
+    file->in_flight++;
+    in_flight_++;
+    Request* raw = request.release();
+    backend->writev(file->fd, raw->iov.data(), static_cast<int>(raw->iov.size()), raw->offset, raw);
+  }
+  return next;
+}
+
+void RecordWriter::release(Request* request) {
+  for (void* token : request->tokens)
+    release_(token);
+  backlog_.fetch_sub(request->size, std::memory_order_relaxed);
+  delete request;
+}
+
+void RecordWriter::finish(Request* request, int64_t result, Backend* backend) {
+  File* file = request->file;
+  file->in_flight--;
+  in_flight_--;
+
+  const bool retry = result == -EINTR || result == -EAGAIN;
+  if (!retry && result <= 0) {
+    if (file->error == 0)
+      file->error = result < 0 ? static_cast<int>(-result) : EIO;
+    release(request);
+    return;
+  }
+  if (!retry) {
+    request->done += static_cast<uint64_t>(result);
+    file->written += static_cast<uint64_t>(result);
+    for (uint64_t left = static_cast<uint64_t>(result); left > 0;) {
+      iovec& iov = request->iov[request->first];
+      if (left < iov.iov_len) {
+        iov.iov_base = static_cast<uint8_t*>(iov.iov_base) + left;
+        iov.iov_len -= left;
+        break;
+      }
+      left -= iov.iov_len;
+      request->first++;
+    }
+  }
+  if (request->done == request->size) {
+    release(request);
+    return;
+  }
+
+  // Short write: the rest goes out as a new write right after it.
+  file->in_flight++;
+  in_flight_++;
+  backend->writev(file->fd, request->iov.data() + request->first,
+                  static_cast<int>(request->iov.size() - request->first),
+                  request->offset + request->done, request);
+}
+
+void RecordWriter::close_files(const FileDone& done, bool all) {
+  while (!files_.empty()) {
+    File* file = files_.front().get();
+    if (file->in_flight > 0 || !(file->closing || all))
+      break;
+    if (file->fd >= 0 && ::close(file->fd) != 0 && file->error == 0)
+      file->error = errno;
+    if (done)
+      done({file->id, file->path, file->written, file->error});
+    files_.pop_front();
+  }
+}
+
+void RecordWriter::run(const FileDone& done, Backend* backend) {
+  std::vector<Op> ops;
+  size_t next = 0;
+  for (;;) {
+    if (next == ops.size()) {
+      ops.clear();
+      next = 0;
+      std::unique_lock<std::mutex> guard(lock_);
+      if (in_flight_ == 0) {
+        wake_.wait(guard, [this] { return !ops_.empty() || stopping_; });
+        if (ops_.empty()) {
+          guard.unlock();
+          close_files(done, true);
+          return;
+        }
+      }
+      ops.swap(ops_);
+    }
+
+    next = issue(ops, next, backend);
+    // Waits for the disk only when nothing else can be done meanwhile.
+    backend->submit(in_flight_ > 0 && (backend->full() || next == ops.size()));
+
+    void* tag;
+    int64_t result;
+    while (backend->complete(&tag, &result))
+      finish(static_cast<Request*>(tag), result, backend);
+    close_files(done, false);
+  }
+}
+
+}  // namespace nvgst
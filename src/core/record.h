@@ -0,0 +1,164 @@
+// Event-triggered recording of an encoded stream. PreEventRing keeps the
+// last few seconds of buffers as whole GOPs, so a recording can start at
+// the keyframe before the event; RecordWriter owns the files on a thread of
+// its own, so a slow or stalled disk never reaches the streaming thread.
+//
+// The writer thread submits writes through io_uring when the kernel allows
+// it (several writes in flight, one syscall per batch) and falls back to
+// pwritev() on the same thread otherwise. Either way the streaming thread
+// only appends to a queue; when the bytes not yet written exceed the
+// backlog limit, write() refuses the chunk and the caller decides what to
+// drop.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nvgst {
+
+// Releases a token handed to PreEventRing or RecordWriter once its data is
+// no longer needed.
+using RecordTokenRelease = void (*)(void* token);
+
+// Buffers of the last duration, trimmed by whole GOPs so that the oldest
+// entry is always a keyframe. Not thread-safe.
+class PreEventRing {
+ public:
+  struct Entry {
+    void* token;
+    // Running time in ns, -1 when unknown.
+    int64_t time;
+    uint64_t bytes;
+    bool keyframe;
+  };
+
+  explicit PreEventRing(RecordTokenRelease release) : release_(release) {}
+  ~PreEventRing() { clear(); }
+
+  PreEventRing(const PreEventRing&) = delete;
+  PreEventRing& operator=(const PreEventRing&) = delete;
+
+  // Keeps a keyframe at or before the newest time - duration, and drops
+  // older GOPs while above max_bytes (0 = unlimited). The GOP being
+  // received is never dropped.
+  void set_limits(int64_t duration, uint64_t max_bytes);
+
+  // Takes the token. Entries before the first keyframe are released at
+  // once, since no recording could start from them.
+  void push(const Entry& entry);
+
+  // Position of the newest keyframe at or before time, of the oldest
+  // keyframe when all are later, or -1 when the ring is empty.
+  long find_keyframe(int64_t time) const;
+
+  size_t size() const { return entries_.size(); }
+  const Entry& operator[](size_t i) const { return entries_[i]; }
+  uint64_t bytes() const { return bytes_; }
+
+  void clear();
+
+ private:
+  void drop_front_gop();
+
+  RecordTokenRelease release_;
+  int64_t duration_ = 0;
+  uint64_t max_bytes_ = 0;
+  std::deque<Entry> entries_;
+  // Keyframe positions counted from the first entry ever pushed.
+  std::deque<uint64_t> keyframes_;
+  uint64_t base_ = 0;
+  uint64_t bytes_ = 0;
+};
+
+class RecordWriter {
+ public:
+  struct Chunk {
+    const void* data;
+    size_t size;
+    // Released once the data is written or given up on.
+    void* token;
+  };
+
+  struct FileResult {
+    uint64_t id;
+    std::string path;
+    uint64_t bytes;
+    // errno of the first failure, 0 when every byte was written.
+    int error;
+  };
+  // Called on the writer thread once a file is closed.
+  using FileDone = std::function<void(const FileResult&)>;
+
+  explicit RecordWriter(RecordTokenRelease release);
+  ~RecordWriter();
+
+  RecordWriter(const RecordWriter&) = delete;
+  RecordWriter& operator=(const RecordWriter&) = delete;
+
+  // Starts the writer thread; use_uring = false forces the pwritev path.
+  bool start(FileDone done, bool use_uring = true);
+  // Writes and closes everything queued, then joins the thread.
+  void stop();
+  // Writer thread running on io_uring. Valid after start().
+  bool uring() const { return uring_; }
+
+  // Any thread. 0 = unlimited.
+  void set_max_backlog(uint64_t bytes) { max_backlog_.store(bytes, std::memory_order_relaxed); }
+  // Bytes queued or in flight.
+  uint64_t backlog() const { return backlog_.load(std::memory_order_relaxed); }
+
+  // One producing thread. Requests are carried out in order; each file is
+  // closed before the next one is opened.
+  void open(uint64_t id, const std::string& path);
+  // False, keeping the token with the caller, when the chunk would take
+  // the backlog over the limit.
+  bool write(const Chunk& chunk);
+  void close();
+
+ private:
+  struct Op {
+    enum Kind { kOpen, kWrite, kClose } kind;
+    Chunk chunk;
+    uint64_t id;
+    std::string path;
+  };
+  class Backend;
+  class SyncBackend;
+  class UringBackend;
+  struct File;
+  struct Request;
+
+  void push(Op op);
+  void run(const FileDone& done, Backend* backend);
+  size_t issue(const std::vector<Op>& ops, size_t next, Backend* backend);
+  void finish(Request* request, int64_t result, Backend* backend);
+  void release(Request* request);
+  void close_files(const FileDone& done, bool all);
+
+  RecordTokenRelease release_;
+  std::mutex lock_;
+  std::condition_variable wake_;
+  std::vector<Op> ops_;
+  bool stopping_ = false;
+  std::thread thread_;
+  bool uring_ = false;
+
+  std::atomic<uint64_t> max_backlog_{0};
+  std::atomic<uint64_t> backlog_{0};
+
+  // Writer thread only: files not closed yet, oldest first, and requests
+  // submitted but not completed.
+  std::deque<std::unique_ptr<File>> files_;
+  int in_flight_ = 0;
+};
+
+}  // namespace nvgst
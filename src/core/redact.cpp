@@ -0,0 +1,219 @@
+#include "core/redact.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace nvgst {
+
+namespace {
+
+// Largest radius whose window sums stay below 2^31 for box_mean_row.
+constexpr int kMaxRadius = 255;
+constexpr int kMaxBlockSize = 4096;
+constexpr int kMaxPasses = 3;
+
+// The box mean of one channel at summed-area indices a (left) and b
+// (right), with box_mean_row's rounding.
+inline uint8_t box_mean(const uint32_t* top, const uint32_t* bottom, int a, int b, float scale) {
+  const uint32_t sum = bottom[b] - bottom[a] - top[b] + top[a];
+  return static_cast<uint8_t>(
+      static_cast<int>(static_cast<float>(static_cast<int32_t>(sum)) * scale + 0.5f));
+}
+
+}  // namespace
+
+bool Redactor::configure(const RedactConfig& config) {
+  if (config.format == PixelFormat::kUnknown || config.width <= 0 || config.height <= 0)
+    return false;
+  if (config.block_size < 1 || config.block_size > kMaxBlockSize)
+    return false;
+  if (config.radius < 1 || config.radius > kMaxRadius)
+    return false;
+  if (config.passes < 1 || config.passes > kMaxPasses)
+    return false;
+
+  config_ = config;
+  kernels_ = &simd::kernels(config.simd);
+  n_planes_ = format_n_planes(config.format);
+  for (int plane = 0; plane < n_planes_; plane++)
+    bpp_[plane] = plane_pixel_stride(config.format, plane);
+
+  if (format_is_yuv(config.format)) {
+    config_.block_size += config_.block_size & 1;
+    black_[0] = 16;
+    black_[1] = config.format == PixelFormat::kNV12 ? 0x8080 : 128;
+    black_[2] = 128;
+  } else {
+    black_[0] = 0xffu << 24;
+  }
+  return true;
+}
+
+void Redactor::build_integral(const uint8_t* src, int stride, const Area& area, int bpp) {
+  const int width = area.x1 - area.x0;
+  const int height = area.y1 - area.y0;
+  integral_stride_ = (width + 1) * bpp;
+  const size_t size = static_cast<size_t>(height + 1) * integral_stride_;
+  if (integral_.size() < size)
+    integral_.resize(size);
+
+  std::fill_n(integral_.data(), integral_stride_, 0u);
+  for (int y = 0; y < height; y++) {
+    const uint32_t* above = integral_.data() + static_cast<size_t>(y) * integral_stride_;
+    uint32_t* row = integral_.data() + static_cast<size_t>(y + 1) * integral_stride_;
+    std::fill_n(row, bpp, 0u);
+    kernels_->integral_row(src + static_cast<ptrdiff_t>(y) * stride, above + bpp, row + bpp,
+                           width * bpp, bpp);
+  }
+}
+
+void Redactor::blur_plane(uint8_t* data, int stride, int width, int height, int bpp,
+                          const Area& rect, int radius) {
+  const int passes = config_.passes;
+  auto grow = [&](int by) {
+    return Area{std::max(rect.x0 - by, 0), std::max(rect.y0 - by, 0),
+                std::min(rect.x1 + by, width), std::min(rect.y1 + by, height)};
+  };
+
+  // Passes before the last write the box grown by the radii still to come.
+  const Area staged = grow((passes - 1) * radius);
+  const int scratch_stride = (staged.x1 - staged.x0) * bpp;
+  if (passes > 1) {
+    const size_t size = static_cast<size_t>(staged.y1 - staged.y0) * scratch_stride;
+    if (scratch_.size() < size)
+      scratch_.resize(size);
+  }
+
+  for (int pass = 1; pass <= passes; pass++) {
+    const Area in = grow((passes - pass + 1) * radius);
+    const Area out = grow((passes - pass) * radius);
+
+    if (pass == 1) {
+      build_integral(data + static_cast<ptrdiff_t>(in.y0) * stride + in.x0 * bpp, stride, in, bpp);
+    } else {
+      build_integral(scratch_.data() + static_cast<ptrdiff_t>(in.y0 - staged.y0) * scratch_stride +
+                         (in.x0 - staged.x0) * bpp,
+                     scratch_stride, in, bpp);
+    }
+
+    // dst + y * dst_stride + x * bpp addresses sample (x, y) of the plane.
+    uint8_t* dst = data;
+    int dst_stride = stride;
+    if (pass < passes) {
+      dst = scratch_.data() - static_cast<ptrdiff_t>(staged.y0) * scratch_stride -
+            staged.x0 * bpp;
+      dst_stride = scratch_stride;
+    }
+
+    // Columns whose window the plane edges do not clip.
+    const int mid0 = std::min(std::max(out.x0, radius), out.x1);
+    const int mid1 = std::max(std::min(out.x1, width - radius), mid0);
+    const int window = (2 * radius + 1) * bpp;
+
+    for (int y = out.y0; y < out.y1; y++) {
+      const int ya = std::max(y - radius, 0);
+      const int yb = std::min(y + radius + 1, height);
+      const uint32_t* top = integral_.data() + static_cast<size_t>(ya - in.y0) * integral_stride_;
+      const uint32_t* bottom =
+          integral_.data() + static_cast<size_t>(yb - in.y0) * integral_stride_;
+      uint8_t* row = dst + static_cast<ptrdiff_t>(y) * dst_stride;
+
+      auto edge = [&](int x) {
+        const int xa = std::max(x - radius, 0) - in.x0;
+        const int xb = std::min(x + radius + 1, width) - in.x0;
+        const float scale = 1.0f / static_cast<float>((xb - xa) * (yb - ya));
+        for (int c = 0; c < bpp; c++)
+          row[x * bpp + c] = box_mean(top, bottom, xa * bpp + c, xb * bpp + c, scale);
+      };
+
+      for (int x = out.x0; x < mid0; x++)
+        edge(x);
+      if (mid1 > mid0) {
+        const int offset = (mid0 - radius - in.x0) * bpp;
+        kernels_->box_mean_row(top + offset, bottom + offset, window, row + mid0 * bpp,
+                               (mid1 - mid0) * bpp,
+                               1.0f / static_cast<float>((2 * radius + 1) * (yb - ya)));
+      }
+      for (int x = mid1; x < out.x1; x++)
+        edge(x);
+    }
+  }
+}
+
+void Redactor::pixelate_plane(uint8_t* data, int stride, int bpp, const Area& rect, int block) {
+  const int row_bytes = (rect.x1 - rect.x0) * bpp;
+  if (row_.size() < static_cast<size_t>(row_bytes))
+    row_.resize(row_bytes);
+
+  build_integral(data + static_cast<ptrdiff_t>(rect.y0) * stride + rect.x0 * bpp, stride, rect,
+                 bpp);
+
+  for (int by = rect.y0; by < rect.y1;) {
+    const int by1 = std::min((by / block + 1) * block, rect.y1);
+    const uint32_t* top = integral_.data() + static_cast<size_t>(by - rect.y0) * integral_stride_;
+    const uint32_t* bottom =
+        integral_.data() + static_cast<size_t>(by1 - rect.y0) * integral_stride_;
+
+    for (int bx = rect.x0; bx < rect.x1;) {
+      const int bx1 = std::min((bx / block + 1) * block, rect.x1);
+      const int a = (bx - rect.x0) * bpp;
+      const int b = (bx1 - rect.x0) * bpp;
+      const float scale = 1.0f / static_cast<float>((bx1 - bx) * (by1 - by));
+      uint32_t pattern = 0;
+      for (int c = 0; c < bpp; c++)
+        pattern |= static_cast<uint32_t>(box_mean(top, bottom, a + c, b + c, scale)) << (8 * c);
+      kernels_->fill_span(row_.data() + a, bx1 - bx, pattern, bpp);
+      bx = bx1;
+    }
+
+    for (int y = by; y < by1; y++)
+      std::memcpy(data + static_cast<ptrdiff_t>(y) * stride + rect.x0 * bpp, row_.data(),
+                  row_bytes);
+    by = by1;
+  }
+}
+
+int64_t Redactor::redact(const FrameView& frame, const RedactRect* rects, int n) {
+  const bool yuv = format_is_yuv(config_.format);
+  int64_t pixels = 0;
+
+  for (int i = 0; i < n; i++) {
+    const int x0 = std::max(rects[i].x0, 0);
+    const int y0 = std::max(rects[i].y0, 0);
+    const int x1 = std::min(rects[i].x1, config_.width);
+    const int y1 = std::min(rects[i].y1, config_.height);
+    if (x0 >= x1 || y0 >= y1)
+      continue;
+    pixels += static_cast<int64_t>(x1 - x0) * (y1 - y0);
+
+    for (int plane = 0; plane < n_planes_; plane++) {
+      const bool sub = yuv && plane > 0;
+      const Area area = sub ? Area{x0 >> 1, y0 >> 1, (x1 + 1) >> 1, (y1 + 1) >> 1}
+                            : Area{x0, y0, x1, y1};
+      const int width = plane_width(config_.format, plane, config_.width);
+      const int height = plane_height(config_.format, plane, config_.height);
+      const int bpp = bpp_[plane];
+      uint8_t* data = frame.data[plane];
+      const int stride = frame.stride[plane];
+
+      switch (config_.mode) {
+        case RedactMode::kPixelate:
+          pixelate_plane(data, stride, bpp, area,
+                         sub ? config_.block_size / 2 : config_.block_size);
+          break;
+        case RedactMode::kBlur:
+          blur_plane(data, stride, width, height, bpp, area,
+                     sub ? (config_.radius + 1) / 2 : config_.radius);
+          break;
+        case RedactMode::kFill:
+          for (int y = area.y0; y < area.y1; y++)
+            kernels_->fill_span(data + static_cast<ptrdiff_t>(y) * stride + area.x0 * bpp,
+                                area.x1 - area.x0, black_[plane], bpp);
+          break;
+      }
+    }
+  }
+  return pixels;
+}
+
+}  // namespace nvgst
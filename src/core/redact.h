@@ -0,0 +1,86 @@
+// In-place redaction of boxes in a frame: pixelation, box blur or a solid
+// fill, touching only the pixels inside each box.
+//
+// Blur and pixelation read their input through a summed-area table built
+// over just the box (plus the blur radius), so any block or window mean
+// costs four lookups whatever its size and the work per box is linear in
+// its area. Several blur passes approach a Gaussian; passes before the last
+// run on a scratch copy of the box grown by the radius still needed, so the
+// frame outside the box is never written.
+//
+// 4:2:0 chroma is redacted over the chroma samples the box covers, with
+// half the radius and block size, so blocks line up across planes.
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/cpu_features.h"
+#include "core/frame.h"
+#include "core/kernels.h"
+
+namespace nvgst {
+
+enum class RedactMode {
+  kPixelate,
+  kBlur,
+  kFill,
+};
+
+struct RedactConfig {
+  PixelFormat format = PixelFormat::kUnknown;  // NV12, I420, RGBA or BGRx
+  int width = 0;
+  int height = 0;
+  RedactMode mode = RedactMode::kPixelate;
+  // Pixelate: side of the blocks, aligned to the frame so they stay put as
+  // boxes move. Rounded up to even on 4:2:0 formats.
+  int block_size = 16;
+  // Blur: the window is 2 * radius + 1 pixels square, clipped to the frame.
+  int radius = 8;
+  // Blur: box passes; 3 is close to a Gaussian of sigma ~ radius.
+  int passes = 1;
+  SimdLevel simd = SimdLevel::kAvx2;
+};
+
+// A box in pixels, [x0, x1) x [y0, y1); clipped to the frame.
+struct RedactRect {
+  int x0, y0, x1, y1;
+};
+
+class Redactor {
+ public:
+  bool configure(const RedactConfig& config);
+  const RedactConfig& config() const { return config_; }
+
+  // Redacts each rect of frame in place, in order; overlapping rects are
+  // redacted again. frame must match the configured format and size.
+  // Returns the number of pixels redacted.
+  int64_t redact(const FrameView& frame, const RedactRect* rects, int n);
+
+ private:
+  // Part of one plane, in samples of that plane.
+  struct Area {
+    int x0, y0, x1, y1;
+  };
+
+  void build_integral(const uint8_t* src, int stride, const Area& area, int bpp);
+  void blur_plane(uint8_t* data, int stride, int width, int height, int bpp, const Area& rect,
+                  int radius);
+  void pixelate_plane(uint8_t* data, int stride, int bpp, const Area& rect, int block);
+
+  RedactConfig config_;
+  const simd::Kernels* kernels_ = &simd::kernels(SimdLevel::kScalar);
+  int n_planes_ = 0;
+  int bpp_[3] = {0, 0, 0};
+  // Fill pattern per plane.
+  uint32_t black_[3] = {0, 0, 0};
+  // Summed-area table of the current area: (height + 1) rows of
+  // (width + 1) * bpp sums, the first row and column zero.
+  std::vector<uint32_t> integral_;
+  int integral_stride_ = 0;
+  // Intermediate blur passes, and one row of block means.
+  std::vector<uint8_t> scratch_;
+  std::vector<uint8_t> row_;
+};
+
+}  // namespace nvgst
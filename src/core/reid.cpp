@@ -0,0 +1,353 @@
+#include "core/reid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace nvgst {
+
+namespace {
+
+// Spherical k-means rounds when training the lists.
+constexpr int kTrainIterations = 8;
+
+float norm(const float* v, int n) {
+  float sum = 0.0f;
+  for (int i = 0; i < n; i++)
+    sum += v[i] * v[i];
+  return std::sqrt(sum);
+}
+
+bool better(const ReidMatch& a, const ReidMatch& b) {
+  return a.similarity > b.similarity;
+}
+
+bool accepts(const ReidFilter& filter, const ReidEntry& entry) {
+  return (filter.source < 0 || entry.source == filter.source) &&
+         (filter.exclude_source < 0 || entry.source != filter.exclude_source) &&
+         (filter.class_id < 0 || entry.class_id == filter.class_id) &&
+         (entry.track_id != filter.self_track || entry.source != filter.self_source);
+}
+
+}  // namespace
+
+bool EmbeddingIndex::configure(const EmbeddingIndexConfig& config) {
+  if (config.dim <= 0 || config.dim > 65536 || config.lists < 1 || config.probes < 1 ||
+      config.train_size < 1)
+    return false;
+
+  const bool layout_changed =
+      lists_.empty() || config.dim != config_.dim || config.quantize != config_.quantize;
+  config_ = config;
+  kernels_ = &simd::kernels(config.simd);
+  if (layout_changed) {
+    vector_stride_ = align_up(static_cast<size_t>(config.dim), size_t{8});
+    stride_ = config.quantize ? align_up(static_cast<size_t>(config.dim), size_t{32})
+                              : vector_stride_;
+    query_.assign(vector_stride_, 0.0f);
+    query_code_.assign(stride_, 0);
+    clear();
+  }
+  return true;
+}
+
+void EmbeddingIndex::clear() {
+  lists_.assign(1, List());
+  centroids_.clear();
+  size_ = 0;
+  oldest_ = UINT64_MAX;
+}
+
+bool EmbeddingIndex::prepare(const float* src) {
+  const int dim = config_.dim;
+  const float length = norm(src, dim);
+  if (!(length > 0.0f))
+    return false;
+
+  float max_abs = 0.0f;
+  for (int i = 0; i < dim; i++) {
+    query_[i] = src[i] / length;
+    max_abs = std::max(max_abs, std::fabs(query_[i]));
+  }
+  if (config_.quantize) {
+    query_scale_ = max_abs / 127.0f;
+    const float inv = 1.0f / query_scale_;
+    for (int i = 0; i < dim; i++)
+      query_code_[i] = static_cast<int8_t>(std::lrint(query_[i] * inv));
+  }
+  return true;
+}
+
+void EmbeddingIndex::append(List& list, const ReidEntry& entry) {
+  if (config_.quantize) {
+    list.codes.insert(list.codes.end(), query_code_.begin(), query_code_.end());
+    list.scales.push_back(query_scale_);
+  } else {
+    list.values.insert(list.values.end(), query_.begin(), query_.end());
+  }
+  list.entries.push_back(entry);
+  oldest_ = std::min(oldest_, entry.last_seen);
+}
+
+void EmbeddingIndex::decode(const List& list, size_t row, float* out) const {
+  if (config_.quantize) {
+    const int8_t* code = list.codes.data() + row * stride_;
+    const float scale = list.scales[row];
+    for (int i = 0; i < config_.dim; i++)
+      out[i] = code[i] * scale;
+  } else {
+    std::memcpy(out, list.values.data() + row * stride_, config_.dim * sizeof(float));
+  }
+}
+
+int EmbeddingIndex::nearest_list() {
+  if (centroids_.empty())
+    return 0;
+  const int count = static_cast<int>(lists_.size());
+  scores_.resize(count);
+  kernels_->dot_rows_f32(query_.data(), centroids_.data(), vector_stride_, count, config_.dim,
+                         scores_.data());
+  return static_cast<int>(std::max_element(scores_.begin(), scores_.end()) - scores_.begin());
+}
+
+bool EmbeddingIndex::add(const ReidEntry& entry, const float* embedding) {
+  if (kernels_ == nullptr || !prepare(embedding))
+    return false;
+  append(lists_[nearest_list()], entry);
+  size_++;
+  if (centroids_.empty() && size_ >= static_cast<size_t>(config_.train_size) &&
+      config_.lists > 1)
+    train();
+  return true;
+}
+
+// Spherical k-means over everything stored, seeded with evenly spaced
+// entries; the entries are then moved to the list of their centroid.
+void EmbeddingIndex::train() {
+  const int dim = config_.dim;
+  const size_t vs = vector_stride_;
+  const int n = static_cast<int>(size_);
+  const int k = std::min(config_.lists, n);
+
+  std::vector<float> data(static_cast<size_t>(n) * vs, 0.0f);
+  std::vector<ReidEntry> entries;
+  entries.reserve(n);
+  for (const List& list : lists_) {
+    for (size_t r = 0; r < list.entries.size(); r++) {
+      decode(list, r, data.data() + entries.size() * vs);
+      entries.push_back(list.entries[r]);
+    }
+  }
+
+  centroids_.assign(static_cast<size_t>(k) * vs, 0.0f);
+  for (int c = 0; c < k; c++) {
+    const size_t seed = static_cast<size_t>(c) * n / k;
+    std::memcpy(&centroids_[c * vs], &data[seed * vs], dim * sizeof(float));
+  }
+
+  std::vector<float> sums(static_cast<size_t>(k) * vs);
+  scores_.resize(k);
+  for (int iteration = 0; iteration < kTrainIterations; iteration++) {
+    std::fill(sums.begin(), sums.end(), 0.0f);
+    for (int i = 0; i < n; i++) {
+      const float* v = &data[i * vs];
+      kernels_->dot_rows_f32(v, centroids_.data(), vs, k, dim, scores_.data());
+      const int best =
+          static_cast<int>(std::max_element(scores_.begin(), scores_.end()) - scores_.begin());
+      float* sum = &sums[best * vs];
+      for (int d = 0; d < dim; d++)
+        sum[d] += v[d];
+    }
+    // Mean directions; a centroid that lost all its members keeps its place.
+    for (int c = 0; c < k; c++) {
+      const float length = norm(&sums[c * vs], dim);
+      if (length > 0.0f) {
+        for (int d = 0; d < dim; d++)
+          centroids_[c * vs + d] = sums[c * vs + d] / length;
+      }
+    }
+  }
+
+  lists_.assign(k, List());
+  oldest_ = UINT64_MAX;
+  for (int i = 0; i < n; i++) {
+    prepare(&data[i * vs]);
+    append(lists_[nearest_list()], entries[i]);
+  }
+}
+
+void EmbeddingIndex::scan(const List& list, const ReidFilter& filter) {
+  const int count = static_cast<int>(list.entries.size());
+  if (count == 0)
+    return;
+
+  scores_.resize(count);
+  if (config_.quantize) {
+    dots_.resize(count);
+    kernels_->dot_rows_s8(query_code_.data(), list.codes.data(), stride_, count, config_.dim,
+                          dots_.data());
+    for (int r = 0; r < count; r++)
+      scores_[r] = static_cast<float>(dots_[r]) * query_scale_ * list.scales[r];
+  } else {
+    kernels_->dot_rows_f32(query_.data(), list.values.data(), stride_, count, config_.dim,
+                           scores_.data());
+  }
+
+  for (int r = 0; r < count; r++) {
+    if (scores_[r] >= filter.min_similarity && accepts(filter, list.entries[r]))
+      candidates_.push_back({list.entries[r], scores_[r]});
+  }
+}
+
+size_t EmbeddingIndex::search(const float* embedding, const ReidFilter& filter, int k,
+                              std::vector<ReidMatch>* matches) {
+  matches->clear();
+  if (kernels_ == nullptr || size_ == 0 || k <= 0 || !prepare(embedding))
+    return 0;
+
+  candidates_.clear();
+  if (centroids_.empty()) {
+    scan(lists_[0], filter);
+  } else {
+    const int count = static_cast<int>(lists_.size());
+    const int probes = std::min(config_.probes, count);
+    scores_.resize(count);
+    kernels_->dot_rows_f32(query_.data(), centroids_.data(), vector_stride_, count, config_.dim,
+                           scores_.data());
+    order_.resize(count);
+    for (int c = 0; c < count; c++)
+      order_[c] = c;
+    std::partial_sort(order_.begin(), order_.begin() + probes, order_.end(),
+                      [this](int a, int b) { return scores_[a] > scores_[b]; });
+    // scan() reuses scores_, so the probed lists are picked first.
+    order_.resize(probes);
+    for (int c : order_)
+      scan(lists_[c], filter);
+  }
+
+  const size_t n = std::min(candidates_.size(), static_cast<size_t>(k));
+  std::partial_sort(candidates_.begin(), candidates_.begin() + n, candidates_.end(), better);
+  matches->assign(candidates_.begin(), candidates_.begin() + n);
+  return n;
+}
+
+bool EmbeddingIndex::find(uint32_t source, uint64_t track_id, float* embedding) const {
+  // Newest first: a track id seen again after it was indexed has two entries.
+  for (const List& list : lists_) {
+    for (size_t r = list.entries.size(); r-- > 0;) {
+      const ReidEntry& entry = list.entries[r];
+      if (entry.source == source && entry.track_id == track_id) {
+        decode(list, r, embedding);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+size_t EmbeddingIndex::evict(uint64_t now) {
+  const uint64_t retention = config_.retention;
+  if (retention == 0 || now < retention || oldest_ >= now - retention)
+    return 0;
+
+  const uint64_t cutoff = now - retention;
+  size_t dropped = 0;
+  oldest_ = UINT64_MAX;
+  for (List& list : lists_) {
+    size_t kept = 0;
+    for (size_t r = 0; r < list.entries.size(); r++) {
+      const ReidEntry& entry = list.entries[r];
+      if (entry.last_seen < cutoff)
+        continue;
+      if (kept != r) {
+        list.entries[kept] = entry;
+        if (config_.quantize) {
+          std::memcpy(&list.codes[kept * stride_], &list.codes[r * stride_], stride_);
+          list.scales[kept] = list.scales[r];
+        } else {
+          std::memcpy(&list.values[kept * stride_], &list.values[r * stride_],
+                      stride_ * sizeof(float));
+        }
+      }
+      oldest_ = std::min(oldest_, entry.last_seen);
+      kept++;
+    }
+    dropped += list.entries.size() - kept;
+    list.entries.resize(kept);
+    list.scales.resize(config_.quantize ? kept : 0);
+    list.codes.resize(config_.quantize ? kept * stride_ : 0);
+    list.values.resize(config_.quantize ? 0 : kept * stride_);
+  }
+  size_ -= dropped;
+  return dropped;
+}
+
+size_t EmbeddingIndex::memory() const {
+  size_t bytes = centroids_.capacity() * sizeof(float);
+  for (const List& list : lists_) {
+    bytes += list.codes.capacity() + list.values.capacity() * sizeof(float) +
+             list.scales.capacity() * sizeof(float) + list.entries.capacity() * sizeof(ReidEntry);
+  }
+  return bytes;
+}
+
+void TrackEmbeddings::configure(int dim, const TrackEmbeddingConfig& config) {
+  if (dim != dim_)
+    tracks_.clear();
+  dim_ = dim;
+  config_ = config;
+}
+
+TrackEmbedding* TrackEmbeddings::add(uint32_t source, const DetectedObject& object, uint64_t now,
+                                     const float* embedding) {
+  const float length = norm(embedding, dim_);
+  if (!(length > 0.0f))
+    return nullptr;
+
+  auto it = tracks_.find({source, object.track_id});
+  if (it == tracks_.end()) {
+    it = tracks_.emplace(Key{source, object.track_id}, TrackEmbedding()).first;
+    TrackEmbedding& track = it->second;
+    track.entry.source = source;
+    track.entry.track_id = object.track_id;
+    track.entry.first_seen = now;
+    track.sum.assign(dim_, 0.0f);
+  }
+
+  TrackEmbedding& track = it->second;
+  const float inv = 1.0f / length;
+  for (int i = 0; i < dim_; i++)
+    track.sum[i] += embedding[i] * inv;
+  track.samples++;
+  track.entry.class_id = object.class_id;
+  track.entry.last_seen = std::max(track.entry.last_seen, now);
+  return &track;
+}
+
+const TrackEmbedding* TrackEmbeddings::find(uint32_t source, uint64_t track_id) const {
+  auto it = tracks_.find({source, track_id});
+  return it != tracks_.end() ? &it->second : nullptr;
+}
+
+void TrackEmbeddings::expire(uint64_t now, std::vector<TrackEmbedding>* finished) {
+  for (auto it = tracks_.begin(); it != tracks_.end();) {
+    TrackEmbedding& track = it->second;
+    if (now < track.entry.last_seen || now - track.entry.last_seen <= config_.linger) {
+      ++it;
+      continue;
+    }
+    if (track.samples >= config_.min_samples)
+      finished->push_back(std::move(track));
+    it = tracks_.erase(it);
+  }
+}
+
+void TrackEmbeddings::flush(std::vector<TrackEmbedding>* finished) {
+  for (auto& item : tracks_) {
+    if (item.second.samples >= config_.min_samples)
+      finished->push_back(std::move(item.second));
+  }
+  tracks_.clear();
+}
+
+}  // namespace nvgst
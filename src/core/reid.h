@@ -0,0 +1,211 @@
+// Cross-camera re-identification: appearance embeddings of tracks (one
+// vector per object crop from a re-ID network) are averaged per track and
+// kept in an in-memory index that answers "which earlier tracks looked
+// like this one", on any camera or on one in particular.
+//
+// The index is an inverted file (IVF): vectors are L2-normalized, so the
+// dot product is their cosine similarity, and each is stored in the list
+// of its nearest centroid. A search scores the centroids, then only the
+// probes best lists, with SIMD dot products over rows stored back to back.
+// Until train_size vectors have come in there is a single list scanned in
+// full; then the centroids are trained once with spherical k-means on what
+// is stored, a pause of tens of milliseconds, and the entries are spread
+// over their lists. With 128 lists and 8 probes a search reads about 6% of
+// the index. With quantize set, rows are int8 with one scale each (a
+// quarter of the memory, and integer dot products), which costs well under
+// 1% of similarity.
+//
+// Entries carry the time their track was last seen and are evicted once
+// older than the retention; lists are compacted in place, keeping their
+// order.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "core/kernels.h"
+#include "core/objects.h"
+
+namespace nvgst {
+
+// One finished track in the index.
+struct ReidEntry {
+  uint32_t source = 0;
+  uint64_t track_id = kNoTrack;
+  int32_t class_id = -1;
+  // When the track was first and last seen, in the caller's time unit.
+  uint64_t first_seen = 0;
+  uint64_t last_seen = 0;
+};
+
+struct ReidMatch {
+  ReidEntry entry;
+  float similarity = 0.0f;
+};
+
+// Which entries a search may return.
+struct ReidFilter {
+  // Only entries of this source; -1 for any.
+  int64_t source = -1;
+  // Never entries of this source; -1 for none. Matching across cameras
+  // sets it to the querying track's own source.
+  int64_t exclude_source = -1;
+  // Only entries of this class; -1 for any.
+  int32_t class_id = -1;
+  // The querying track, never returned itself.
+  uint32_t self_source = 0;
+  uint64_t self_track = kNoTrack;
+  float min_similarity = 0.0f;
+};
+
+struct EmbeddingIndexConfig {
+  // Embedding length.
+  int dim = 0;
+  // Store int8 rows instead of float ones.
+  bool quantize = true;
+  // Lists after training.
+  int lists = 128;
+  // Lists scanned per search.
+  int probes = 8;
+  // Entries stored before the lists are trained.
+  int train_size = 2048;
+  // Entries last seen longer ago than this are evicted; 0 keeps them.
+  // Times are in the caller's unit; the default assumes nanoseconds.
+  uint64_t retention = 7200ull * 1000000000ull;
+  SimdLevel simd = SimdLevel::kAvx2;
+};
+
+// Not thread-safe.
+class EmbeddingIndex {
+ public:
+  // Drops every entry when dim or quantize changes.
+  bool configure(const EmbeddingIndexConfig& config);
+  const EmbeddingIndexConfig& config() const { return config_; }
+
+  // Adds a track with its embedding of dim floats, which need not be
+  // normalized; false when it is all zeros.
+  bool add(const ReidEntry& entry, const float* embedding);
+
+  // The k best entries for embedding that pass filter, best first, into
+  // matches; returns how many there are.
+  size_t search(const float* embedding, const ReidFilter& filter, int k,
+                std::vector<ReidMatch>* matches);
+
+  // The stored (normalized, dequantized) embedding of a track into
+  // embedding, which takes dim floats; false when it is not in the index.
+  bool find(uint32_t source, uint64_t track_id, float* embedding) const;
+
+  // Drops entries last seen before now - retention; returns how many.
+  // Cheap when there is nothing to drop.
+  size_t evict(uint64_t now);
+
+  void clear();
+  size_t size() const { return size_; }
+  size_t lists() const { return lists_.size(); }
+  // Bytes held by rows, entries and centroids.
+  size_t memory() const;
+
+ private:
+  struct List {
+    std::vector<int8_t> codes;
+    std::vector<float> values;
+    std::vector<float> scales;
+    std::vector<ReidEntry> entries;
+  };
+
+  // Normalizes src into query_ (and its int8 form); false when zero.
+  bool prepare(const float* src);
+  void append(List& list, const ReidEntry& entry);
+  void decode(const List& list, size_t row, float* out) const;
+  int nearest_list();
+  void train();
+  void scan(const List& list, const ReidFilter& filter);
+
+  EmbeddingIndexConfig config_;
+  const simd::Kernels* kernels_ = nullptr;
+  // Row length in floats or bytes, a multiple of 32 bytes; centroids are
+  // float rows of vector_stride_.
+  size_t stride_ = 0;
+  size_t vector_stride_ = 0;
+  std::vector<List> lists_;
+  std::vector<float> centroids_;
+  size_t size_ = 0;
+  // Oldest last_seen held; evict() has nothing to do before it expires.
+  uint64_t oldest_ = UINT64_MAX;
+
+  // Scratch of the current query.
+  std::vector<float> query_;
+  std::vector<int8_t> query_code_;
+  float query_scale_ = 0.0f;
+  std::vector<float> scores_;
+  std::vector<int32_t> dots_;
+  std::vector<int> order_;
+  std::vector<ReidMatch> candidates_;
+};
+
+struct TrackEmbeddingConfig {
+  // Tracks without a new embedding for this long are finished. Times are
+  // in the caller's unit; the default assumes nanoseconds.
+  uint64_t linger = 2000000000;
+  // Embeddings a track needs before it is searched for or indexed.
+  int min_samples = 3;
+};
+
+// A track's running mean embedding.
+struct TrackEmbedding {
+  ReidEntry entry;
+  std::vector<float> sum;
+  int samples = 0;
+  // Set once the track has been searched for.
+  bool searched = false;
+};
+
+// Collects the embeddings of live tracks. Not thread-safe.
+class TrackEmbeddings {
+ public:
+  // Drops all tracks when dim changes.
+  void configure(int dim, const TrackEmbeddingConfig& config);
+  const TrackEmbeddingConfig& config() const { return config_; }
+  int dim() const { return dim_; }
+
+  // Folds one embedding of dim floats of a track in, normalized so that
+  // every crop weighs the same; returns the track, or nullptr when the
+  // embedding is all zeros.
+  TrackEmbedding* add(uint32_t source, const DetectedObject& object, uint64_t now,
+                      const float* embedding);
+
+  // The live track, or nullptr.
+  const TrackEmbedding* find(uint32_t source, uint64_t track_id) const;
+
+  // Moves the tracks without an embedding since now - linger (all of them
+  // with flush) that reached min_samples to finished; the others are
+  // dropped.
+  void expire(uint64_t now, std::vector<TrackEmbedding>* finished);
+  void flush(std::vector<TrackEmbedding>* finished);
+
+  void reset() { tracks_.clear(); }
+  size_t size() const { return tracks_.size(); }
+
+ private:
+  struct Key {
+    uint32_t source;
+    uint64_t track_id;
+    bool operator==(const Key& other) const {
+      return source == other.source && track_id == other.track_id;
+    }
+  };
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      return std::hash<uint64_t>()(key.track_id * 0x9e3779b97f4a7c15ull ^ key.source);
+    }
+  };
+
+  int dim_ = 0;
+  TrackEmbeddingConfig config_;
+  std::unordered_map<Key, TrackEmbedding, KeyHash> tracks_;
+};
+
+}  // namespace nvgst
@@ -0,0 +1,229 @@
+#include "core/roi_pack.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace nvgst {
+
+namespace {
+
+// Output rows per task: small enough that a few large ROIs still spread
+// over every worker, large enough to keep the task overhead negligible.
+constexpr int kSliceRows = 16;
+
+// Maps destination sample i to a left source tap and a Q8 weight for the
+// right tap, centers aligned and clamped at the edges as in PlaneScaler.
+void build_axis(int src_size, int dst_size, int32_t* index, uint16_t* frac) {
+  const double ratio = static_cast<double>(src_size) / dst_size;
+  for (int i = 0; i < dst_size; i++) {
+    double s = (i + 0.5) * ratio - 0.5;
+    if (s < 0.0)
+      s = 0.0;
+    int i0 = static_cast<int>(std::floor(s));
+    int f = static_cast<int>(std::lround((s - i0) * 256.0));
+    if (f == 256) {
+      i0++;
+      f = 0;
+    }
+    if (i0 >= src_size - 1) {
+      i0 = src_size - 1;
+      f = 0;
+    }
+    index[i] = i0;
+    frac[i] = static_cast<uint16_t>(f);
+  }
+}
+
+}  // namespace
+
+bool RoiPacker::configure(const RoiPackConfig& config) {
+  if (config.width <= 0 || config.height <= 0 || config.out_width <= 0 || config.out_height <= 0)
+    return false;
+  switch (config.format) {
+    case PixelFormat::kNV12:
+    case PixelFormat::kI420:
+      yuv_ = true;
+      swap_ = false;
+      break;
+    case PixelFormat::kRGBA:
+    case PixelFormat::kBGRx:
+      yuv_ = false;
+      swap_ = (config.format == PixelFormat::kBGRx) != config.bgr;
+      break;
+    default:
+      return false;
+  }
+
+  config_ = config;
+  kernels_ = &simd::kernels(config.simd);
+  yuv_to_rgb_ = &simd::yuv_to_rgb_coeffs(config.matrix);
+
+  // Vertical blend of a crop row, chroma rows (interleaved, then U and V),
+  // the crop in RGB and the scaled output row.
+  const size_t align = kFrameAlign;
+  const size_t row = align_up(static_cast<size_t>(config.width) * 4, align);
+  const size_t chroma = align_up(static_cast<size_t>(config.width) / 2 + 1, align);
+  const size_t out = align_up(static_cast<size_t>(config.out_width) * 4, align);
+  scratch_stride_ = 2 * row + 4 * chroma + out;
+  return true;
+}
+
+size_t RoiPacker::roi_size() const {
+  return static_cast<size_t>(3) * config_.out_width * config_.out_height;
+}
+
+RoiPacker::Crop RoiPacker::clip(const Roi& roi) const {
+  const int w = config_.width;
+  const int h = config_.height;
+  int x0 = std::min(std::max(static_cast<int>(std::floor(roi.x)), 0), w - 1);
+  int y0 = std::min(std::max(static_cast<int>(std::floor(roi.y)), 0), h - 1);
+  int x1 = std::min(std::max(static_cast<int>(std::ceil(roi.x + roi.width)), x0 + 1), w);
+  int y1 = std::min(std::max(static_cast<int>(std::ceil(roi.y + roi.height)), y0 + 1), h);
+  if (yuv_) {
+    // Whole chroma samples only, so chroma rows line up with luma rows.
+    x0 &= ~1;
+    y0 &= ~1;
+    x1 = std::min(x1 + (x1 & 1), w);
+    y1 = std::min(y1 + (y1 & 1), h);
+  }
+  return {roi.frame, x0, y0, x1 - x0, y1 - y0};
+}
+
+void RoiPacker::build_taps(int index, const Crop& crop) {
+  const int ow = config_.out_width;
+  const int oh = config_.out_height;
+  int32_t* x0 = x0_.data() + static_cast<size_t>(index) * ow;
+  int32_t* x1 = x1_.data() + static_cast<size_t>(index) * ow;
+
+  build_axis(crop.width, ow, x0, x_frac_.data() + static_cast<size_t>(index) * ow);
+  for (int i = 0; i < ow; i++) {
+    x1[i] = (x0[i] + (x0[i] + 1 < crop.width ? 1 : 0)) * 4;
+    x0[i] *= 4;
+  }
+  build_axis(crop.height, oh, y_index_.data() + static_cast<size_t>(index) * oh,
+             y_frac_.data() + static_cast<size_t>(index) * oh);
+  if (yuv_)
+    build_axis((crop.height + 1) / 2, oh, cy_index_.data() + static_cast<size_t>(index) * oh,
+               cy_frac_.data() + static_cast<size_t>(index) * oh);
+}
+
+void RoiPacker::pack_rows(const FrameView& frame, int index, int y_begin, int y_end, float* dst,
+                          int worker) {
+  const simd::Kernels& k = *kernels_;
+  const Crop& crop = crops_[index];
+  const int ow = config_.out_width;
+  const int oh = config_.out_height;
+  const size_t plane = static_cast<size_t>(ow) * oh;
+
+  const size_t align = kFrameAlign;
+  const size_t row_bytes = align_up(static_cast<size_t>(config_.width) * 4, align);
+  const size_t chroma_bytes = align_up(static_cast<size_t>(config_.width) / 2 + 1, align);
+  uint8_t* vrow = scratch_.data() + scratch_stride_ * worker;
+  uint8_t* rgb = vrow + row_bytes;
+  uint8_t* uv = rgb + row_bytes;
+  uint8_t* u = uv + 2 * chroma_bytes;
+  uint8_t* v = u + chroma_bytes;
+  uint8_t* out = v + chroma_bytes;
+
+  const int32_t* x0 = x0_.data() + static_cast<size_t>(index) * ow;
+  const int32_t* x1 = x1_.data() + static_cast<size_t>(index) * ow;
+  const uint16_t* x_frac = x_frac_.data() + static_cast<size_t>(index) * ow;
+  const int32_t* y_index = y_index_.data() + static_cast<size_t>(index) * oh;
+  const uint16_t* y_frac = y_frac_.data() + static_cast<size_t>(index) * oh;
+  const int32_t* cy_index = cy_index_.data() + static_cast<size_t>(index) * oh;
+  const uint16_t* cy_frac = cy_frac_.data() + static_cast<size_t>(index) * oh;
+
+  float* c0 = dst;
+  float* c2 = dst + 2 * plane;
+  float offset[3] = {config_.offset[0], config_.offset[1], config_.offset[2]};
+  float scale[3] = {config_.scale[0], config_.scale[1], config_.scale[2]};
+  if (swap_) {
+    std::swap(c0, c2);
+    std::swap(offset[0], offset[2]);
+    std::swap(scale[0], scale[2]);
+  }
+
+  // Blends crop rows sy and sy + 1 of a plane over n bytes, or points
+  // straight at row sy when the lower one has no weight.
+  auto blend = [&k](const uint8_t* base, int stride, int sy, int f, int n, uint8_t* tmp) {
+    const uint8_t* row0 = base + static_cast<ptrdiff_t>(sy) * stride;
+    if (f == 0)
+      return row0;
+    k.lerp_row(row0, row0 + stride, tmp, n, f);
+    return static_cast<const uint8_t*>(tmp);
+  };
+
+  const int cw = (crop.width + 1) / 2;
+  for (int y = y_begin; y < y_end; y++) {
+    const uint8_t* src;
+    if (!yuv_) {
+      const uint8_t* base = frame.data[0] + static_cast<ptrdiff_t>(crop.y) * frame.stride[0] +
+                            static_cast<ptrdiff_t>(crop.x) * 4;
+      src = blend(base, frame.stride[0], y_index[y], y_frac[y], crop.width * 4, vrow);
+    } else {
+      const uint8_t* luma =
+          frame.data[0] + static_cast<ptrdiff_t>(crop.y) * frame.stride[0] + crop.x;
+      const uint8_t* yrow = blend(luma, frame.stride[0], y_index[y], y_frac[y], crop.width, vrow);
+      const ptrdiff_t chroma_row = static_cast<ptrdiff_t>(crop.y / 2) * frame.stride[1];
+      const uint8_t* urow;
+      const uint8_t* vrow_c;
+      if (config_.format == PixelFormat::kNV12) {
+        const uint8_t* base = frame.data[1] + chroma_row + crop.x;
+        k.split_uv_row(blend(base, frame.stride[1], cy_index[y], cy_frac[y], cw * 2, uv), u, v,
+                       cw);
+        urow = u;
+        vrow_c = v;
+      } else {
+        const uint8_t* ubase = frame.data[1] + chroma_row + crop.x / 2;
+        const uint8_t* vbase =
+            frame.data[2] + static_cast<ptrdiff_t>(crop.y / 2) * frame.stride[2] + crop.x / 2;
+        urow = blend(ubase, frame.stride[1], cy_index[y], cy_frac[y], cw, u);
+        vrow_c = blend(vbase, frame.stride[2], cy_index[y], cy_frac[y], cw, v);
+      }
+      k.yuv_to_rgb_row(yrow, urow, vrow_c, rgb, crop.width, *yuv_to_rgb_, config_.bgr);
+      src = rgb;
+    }
+
+    k.lerp_pixels(src, x0, x1, x_frac, out, ow);
+    const size_t o = static_cast<size_t>(y) * ow;
+    k.planar_f32_row(out, ow, c0 + o, dst + plane + o, c2 + o, offset, scale);
+  }
+}
+
+bool RoiPacker::run(const FrameView* frames, const Roi* rois, int n, float* dst,
+                    ThreadPool* pool) {
+  if (n <= 0)
+    return true;
+  if (!scratch_.reserve(scratch_stride_ * pool->size()))
+    return false;
+
+  const size_t nw = static_cast<size_t>(n) * config_.out_width;
+  const size_t nh = static_cast<size_t>(n) * config_.out_height;
+  crops_.resize(n);
+  x0_.resize(nw);
+  x1_.resize(nw);
+  x_frac_.resize(nw);
+  y_index_.resize(nh);
+  y_frac_.resize(nh);
+  if (yuv_) {
+    cy_index_.resize(nh);
+    cy_frac_.resize(nh);
+  }
+  for (int i = 0; i < n; i++) {
+    crops_[i] = clip(rois[i]);
+    build_taps(i, crops_[i]);
+  }
+
+  const int slices = (config_.out_height + kSliceRows - 1) / kSliceRows;
+  const size_t size = roi_size();
+  pool->run(n * slices, [&](int task, int worker) {
+    const int index = task / slices;
+    const int y_begin = (task % slices) * kSliceRows;
+    const int y_end = std::min(y_begin + kSliceRows, config_.out_height);
+    pack_rows(frames[crops_[index].frame], index, y_begin, y_end, dst + index * size, worker);
+  });
+  return true;
+}
+
+}  // namespace nvgst
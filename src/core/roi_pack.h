@@ -0,0 +1,101 @@
+// Crops object boxes out of frames and packs them, scaled and normalized,
+// into one NCHW float tensor for a secondary network, so every ROI of a
+// batch goes through a single request instead of one per object.
+//
+// Each ROI is scaled straight from the source frame with no intermediate
+// image: per output row, Kernels::lerp_row blends the two source rows over
+// the crop only, 4:2:0 input is turned into RGB at crop width by
+// Kernels::yuv_to_rgb_row, Kernels::lerp_pixels does the horizontal pass
+// from per-ROI tap tables and Kernels::planar_f32_row writes the three
+// normalized planes. ROIs are cut into slices of rows that run in
+// parallel on a ThreadPool, each worker with its own scratch rows, so one
+// large ROI does not hold up the rest.
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/aligned_buffer.h"
+#include "core/frame.h"
+#include "core/kernels.h"
+#include "core/thread_pool.h"
+
+namespace nvgst {
+
+struct RoiPackConfig {
+  PixelFormat format = PixelFormat::kUnknown;
+  int width = 0;
+  int height = 0;
+  ColorMatrix matrix = ColorMatrix::kBT601;
+  int out_width = 224;
+  int out_height = 224;
+  // Planes in B, G, R order instead of R, G, B.
+  bool bgr = false;
+  // Per plane: (value - offset) * scale, in plane order.
+  float offset[3] = {0.0f, 0.0f, 0.0f};
+  float scale[3] = {1.0f / 255.0f, 1.0f / 255.0f, 1.0f / 255.0f};
+  SimdLevel simd = SimdLevel::kAvx2;
+};
+
+// Box in pixels of frame number frame.
+struct Roi {
+  int frame;
+  float x;
+  float y;
+  float width;
+  float height;
+};
+
+// Not thread-safe: one packer per streaming thread.
+class RoiPacker {
+ public:
+  bool configure(const RoiPackConfig& config);
+  const RoiPackConfig& config() const { return config_; }
+
+  // Floats written per ROI: 3 * out_width * out_height.
+  size_t roi_size() const;
+
+  // Writes ROI i of frames[rois[i].frame] to dst + i * roi_size(). Boxes
+  // are clipped to the frame and, for 4:2:0 input, widened to even
+  // coordinates; a box outside the frame still yields one edge pixel.
+  // Returns false when scratch for the pool's workers cannot be allocated.
+  bool run(const FrameView* frames, const Roi* rois, int n, float* dst, ThreadPool* pool);
+
+ private:
+  struct Crop {
+    int frame;
+    int x;
+    int y;
+    int width;
+    int height;
+  };
+
+  Crop clip(const Roi& roi) const;
+  void build_taps(int index, const Crop& crop);
+  void pack_rows(const FrameView& frame, int index, int y_begin, int y_end, float* dst,
+                 int worker);
+
+  RoiPackConfig config_;
+  const simd::Kernels* kernels_ = &simd::kernels(SimdLevel::kScalar);
+  const simd::YuvToRgbCoeffs* yuv_to_rgb_ = nullptr;
+  bool yuv_ = false;
+  // Byte 0 of a packed pixel goes to plane 0 unless swapped with byte 2.
+  bool swap_ = false;
+
+  // Per ROI, out_width horizontal taps as byte offsets into an RGB row of
+  // the crop, and out_height vertical taps as crop rows, luma then chroma.
+  std::vector<Crop> crops_;
+  std::vector<int32_t> x0_;
+  std::vector<int32_t> x1_;
+  std::vector<uint16_t> x_frac_;
+  std::vector<int32_t> y_index_;
+  std::vector<uint16_t> y_frac_;
+  std::vector<int32_t> cy_index_;
+  std::vector<uint16_t> cy_frac_;
+
+  // Per worker scratch rows.
+  size_t scratch_stride_ = 0;
+  AlignedBuffer scratch_;
+};
+
+}  // namespace nvgst
@@ -0,0 +1,126 @@
+#include "core/scaler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace nvgst {
+
+namespace {
+
+// Maps destination sample i to a left source tap and a Q8 weight for the
+// right tap, clamping at the edges.
+void build_taps(int src_size, int dst_size, std::vector<int>* index, std::vector<uint16_t>* frac) {
+  index->resize(dst_size);
+  frac->resize(dst_size);
+  const double ratio = static_cast<double>(src_size) / dst_size;
+  for (int i = 0; i < dst_size; i++) {
+    double s = (i + 0.5) * ratio - 0.5;
+    if (s < 0.0)
+      s = 0.0;
+    int i0 = static_cast<int>(std::floor(s));
+    int f = static_cast<int>(std::lround((s - i0) * 256.0));
+    if (f == 256) {
+      i0++;
+      f = 0;
+    }
+    if (i0 >= src_size - 1) {
+      i0 = src_size - 1;
+      f = 0;
+    }
+    (*index)[i] = i0;
+    (*frac)[i] = static_cast<uint16_t>(f);
+  }
+}
+
+}  // namespace
+
+bool PlaneScaler::configure(int src_width, int src_height, int dst_width, int dst_height,
+                            int channels) {
+  if (src_width <= 0 || src_height <= 0 || dst_width <= 0 || dst_height <= 0)
+    return false;
+  if (channels != 1 && channels != 2 && channels != 4)
+    return false;
+
+  src_width_ = src_width;
+  src_height_ = src_height;
+  dst_width_ = dst_width;
+  channels_ = channels;
+
+  std::vector<int> x_index;
+  build_taps(src_width, dst_width, &x_index, &x_frac_);
+  x_offset0_.resize(dst_width);
+  x_offset1_.resize(dst_width);
+  for (int x = 0; x < dst_width; x++) {
+    int x1 = x_index[x] + 1 < src_width ? x_index[x] + 1 : x_index[x];
+    x_offset0_[x] = x_index[x] * channels;
+    x_offset1_[x] = x1 * channels;
+  }
+
+  build_taps(src_height, dst_height, &y_index_, &y_frac_);
+  return true;
+}
+
+int PlaneScaler::first_row(int src_row) const {
+  return static_cast<int>(std::lower_bound(y_index_.begin(), y_index_.end(), src_row) -
+                          y_index_.begin());
+}
+
+size_t PlaneScaler::scratch_size() const {
+  return align_up(static_cast<size_t>(src_width_) * channels_, static_cast<size_t>(kFrameAlign));
+}
+
+template <int kChannels>
+void PlaneScaler::scale_row_h(const uint8_t* src, uint8_t* dst) const {
+  for (int x = 0; x < dst_width_; x++) {
+    const uint8_t* a = src + x_offset0_[x];
+    const uint8_t* b = src + x_offset1_[x];
+    const int f = x_frac_[x];
+    const int inv = 256 - f;
+    for (int c = 0; c < kChannels; c++)
+      dst[x * kChannels + c] = static_cast<uint8_t>((a[c] * inv + b[c] * f + 128) >> 8);
+  }
+}
+
+void PlaneScaler::scale_rows(const uint8_t* src, int src_stride, uint8_t* dst, int dst_stride,
+                             int y_begin, int y_end, uint8_t* scratch,
+                             const simd::Kernels& k) const {
+  const int row_bytes = src_width_ * channels_;
+  const bool same_width = src_width_ == dst_width_;
+
+  for (int y = y_begin; y < y_end; y++) {
+    const int sy = y_index_[y];
+    const int f = y_frac_[y];
+    const uint8_t* row0 = src + static_cast<ptrdiff_t>(sy) * src_stride;
+    uint8_t* out = dst + static_cast<ptrdiff_t>(y) * dst_stride;
+
+    // Vertical pass straight into the destination when no horizontal pass
+    // follows, otherwise into the scratch row.
+    const uint8_t* hrow = row0;
+    if (f != 0) {
+      const uint8_t* row1 = row0 + (sy + 1 < src_height_ ? src_stride : 0);
+      uint8_t* vrow = same_width ? out : scratch;
+      k.lerp_row(row0, row1, vrow, row_bytes, f);
+      hrow = vrow;
+    } else if (same_width) {
+      std::memcpy(out, row0, row_bytes);
+    }
+    if (same_width)
+      continue;
+
+    switch (channels_) {
+      case 1:
+        scale_row_h<1>(hrow, out);
+        break;
+      case 2:
+        scale_row_h<2>(hrow, out);
+        break;
+      default:
+        k.lerp_pixels(hrow, x_offset0_.data(), x_offset1_.data(), x_frac_.data(), out,
+                      dst_width_);
+        break;
+    }
+  }
+}
+
+}  // namespace nvgst
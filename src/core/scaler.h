@@ -0,0 +1,50 @@
+// Bilinear plane scaler with tables precomputed at configure time.
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/kernels.h"
+
+namespace nvgst {
+
+// Scales one plane of interleaved 8-bit samples (1, 2 or 4 channels).
+// Sample centers are aligned, matching videoscale's bilinear method. The
+// vertical pass runs through Kernels::lerp_row; the horizontal pass is
+// Kernels::lerp_pixels for 4 channels and a table-driven scalar loop
+// specialised per channel count otherwise.
+class PlaneScaler {
+ public:
+  bool configure(int src_width, int src_height, int dst_width, int dst_height, int channels);
+
+  int dst_height() const { return static_cast<int>(y_index_.size()); }
+  // First destination row whose taps start at source row src_row or
+  // below it; rows [first_row(a), first_row(b)) only read source rows
+  // [a, b + 1).
+  int first_row(int src_row) const;
+
+  // Bytes of scratch needed by scale_rows().
+  size_t scratch_size() const;
+
+  // Produces destination rows [y_begin, y_end). scratch must hold
+  // scratch_size() bytes and not be shared with a concurrent call.
+  void scale_rows(const uint8_t* src, int src_stride, uint8_t* dst, int dst_stride, int y_begin,
+                  int y_end, uint8_t* scratch, const simd::Kernels& k) const;
+
+ private:
+  template <int kChannels>
+  void scale_row_h(const uint8_t* src, uint8_t* dst) const;
+
+  int src_width_ = 0;
+  int src_height_ = 0;
+  int dst_width_ = 0;
+  int channels_ = 0;
+  // Horizontal taps as byte offsets into the source row.
+  std::vector<int32_t> x_offset0_;
+  std::vector<int32_t> x_offset1_;
+  std::vector<uint16_t> x_frac_;
+  std::vector<int> y_index_;
+  std::vector<uint16_t> y_frac_;
+};
+
+}  // namespace nvgst
@@ -0,0 +1,706 @@
+#include "core/shm_transport.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+namespace nvgst {
+
+namespace {
+
+constexpr char kSegmentMagic[8] = {'N', 'V', 'S', 'H', 'M', '0', '1', '\0'};
+constexpr uint32_t kProtocolVersion = 1;
+constexpr size_t kMaxPayload = 64 * 1024;
+
+enum MsgType : uint32_t {
+  kMsgHello = 1,    // producer -> consumer, carries the segment fd
+  kMsgCaps = 2,     // producer -> consumer, caps string
+  kMsgFrame = 3,    // producer -> consumer, ShmFrameInfo
+  kMsgEos = 4,      // producer -> consumer
+  kMsgRelease = 5,  // consumer -> producer, slot index; only a wakeup
+};
+
+struct MsgHeader {
+  uint32_t type;
+  uint32_t size;
+};
+
+struct Hello {
+  uint32_t version;
+  uint32_t client;
+};
+
+// First bytes of the segment, followed by the slot state words; slot data
+// starts on a page boundary at data_offset.
+struct SegmentHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t slot_count;
+  uint64_t slot_size;
+  uint64_t slot_stride;
+  uint64_t data_offset;
+  uint8_t pad[24];
+};
+static_assert(sizeof(SegmentHeader) == 64, "state words start on a cache line");
+
+constexpr uint64_t kActiveShift = 0;
+constexpr uint64_t kPendingShift = 16;
+constexpr uint64_t kSeqShift = 32;
+constexpr uint64_t kRefMask = 0xffffffffull;
+
+uint64_t active_bit(uint32_t client) {
+  return 1ull << (kActiveShift + client);
+}
+
+uint64_t pending_bit(uint32_t client) {
+  return 1ull << (kPendingShift + client);
+}
+
+size_t page_align(size_t size) {
+  size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return (size + page - 1) / page * page;
+}
+
+bool fill_address(const std::string& path, sockaddr_un* addr) {
+  if (path.empty() || path.size() >= sizeof(addr->sun_path))
+    return false;
+  std::memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  std::memcpy(addr->sun_path, path.c_str(), path.size());
+  return true;
+}
+
+// Non-blocking; a message is either sent whole or not at all.
+bool send_message(int sock, uint32_t type, const void* payload, size_t size, int fd) {
+  if (size > kMaxPayload)
+    return false;
+
+  MsgHeader header{type, static_cast<uint32_t>(size)};
+  iovec iov[2];
+  iov[0].iov_base = &header;
+  iov[0].iov_len = sizeof(header);
+  iov[1].iov_base = const_cast<void*>(payload);
+  iov[1].iov_len = size;
+
+  msghdr msg{};
+  msg.msg_iov = iov;
+  msg.msg_iovlen = size > 0 ? 2 : 1;
+
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+  if (fd >= 0) {
+    std::memset(control, 0, sizeof(control));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+  }
+
+  ssize_t n;
+  do {
+    n = sendmsg(sock, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+  } while (n < 0 && errno == EINTR);
+  return n == static_cast<ssize_t>(sizeof(header) + size);
+}
+
+}  // namespace
+
+ShmProducer::ShmProducer(TokenRelease release) : token_release_(release) {}
+
+ShmProducer::~ShmProducer() {
+  stop();
+  if (base_ != nullptr)
+    munmap(base_, segment_size_);
+  if (memfd_ >= 0)
+    close(memfd_);
+}
+
+bool ShmProducer::start(const std::string& socket_path) {
+  sockaddr_un addr;
+  if (running_ || !fill_address(socket_path, &addr))
+    return false;
+
+  int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return false;
+  // A previous producer that crashed leaves its socket file behind.
+  unlink(socket_path.c_str());
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 8) != 0) {
+    close(fd);
+    return false;
+  }
+  int wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake < 0) {
+    close(fd);
+    unlink(socket_path.c_str());
+    return false;
+  }
+
+  listen_fd_ = fd;
+  wake_fd_ = wake;
+  socket_path_ = socket_path;
+  running_ = true;
+  thread_ = std::thread(&ShmProducer::run, this);
+  return true;
+}
+
+void ShmProducer::stop() {
+  std::vector<void*> tokens;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (!running_)
+      return;
+    running_ = false;
+  }
+  uint64_t one = 1;
+  if (write(wake_fd_, &one, sizeof(one)) < 0) {
+    // the thread also wakes up for the next client message
+  }
+  thread_.join();
+
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    while (!clients_.empty())
+      drop_client(clients_.size() - 1);
+    for (uint32_t s = 0; s < slot_count_; s++) {
+      if (in_flight_[s])
+        state_[s].store(static_cast<uint64_t>(slot_seq_[s]) << kSeqShift, std::memory_order_release);
+    }
+    collect_released(&tokens);
+  }
+  release_tokens(&tokens);
+  slot_freed_.notify_all();
+
+  unlink(socket_path_.c_str());
+  close(listen_fd_);
+  close(wake_fd_);
+  listen_fd_ = wake_fd_ = -1;
+}
+
+bool ShmProducer::configure(uint32_t slot_count, size_t slot_size) {
+  std::lock_guard<std::mutex> guard(lock_);
+
+  if (base_ != nullptr)
+    return slot_size <= slot_size_;
+  if (slot_count == 0 || slot_size == 0)
+    return false;
+
+  size_t stride = page_align(slot_size);
+  size_t data_offset = page_align(sizeof(SegmentHeader) + sizeof(uint64_t) * slot_count);
+  size_t total = data_offset + stride * slot_count;
+
+  int fd = memfd_create("nvgst-shm", MFD_CLOEXEC);
+  if (fd < 0)
+    return false;
+  if (ftruncate(fd, static_cast<off_t>(total)) != 0) {
+    close(fd);
+    return false;
+  }
+  void* base = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+
+  memfd_ = fd;
+  base_ = static_cast<uint8_t*>(base);
+  segment_size_ = total;
+  auto* header = new (base_) SegmentHeader();
+  std::memcpy(header->magic, kSegmentMagic, sizeof(header->magic));
+  header->version = kProtocolVersion;
+  header->slot_count = slot_count;
+  header->slot_size = slot_size;
+  header->slot_stride = stride;
+  header->data_offset = data_offset;
+  state_ = reinterpret_cast<std::atomic<uint64_t>*>(base_ + sizeof(SegmentHeader));
+  for (uint32_t s = 0; s < slot_count; s++)
+    new (&state_[s]) std::atomic<uint64_t>(0);
+  data_ = base_ + data_offset;
+  slot_count_ = slot_count;
+  slot_size_ = slot_size;
+  slot_stride_ = stride;
+
+  held_.assign(slot_count, 0);
+  in_flight_.assign(slot_count, 0);
+  slot_seq_.assign(slot_count, 0);
+  tokens_.assign(slot_count, nullptr);
+
+  for (auto& client : clients_) {
+    if (!client.hello_sent)
+      send_hello(&client);
+  }
+  return true;
+}
+
+bool ShmProducer::slot_of(const void* data, uint32_t* slot) const {
+  auto* p = static_cast<const uint8_t*>(data);
+  if (data_ == nullptr || p < data_ || p >= data_ + slot_stride_ * slot_count_)
+    return false;
+  *slot = static_cast<uint32_t>(static_cast<size_t>(p - data_) / slot_stride_);
+  return true;
+}
+
+bool ShmProducer::slot_free(uint32_t slot) const {
+  return !held_[slot] && !in_flight_[slot];
+}
+
+int ShmProducer::acquire(ShmBackpressure mode) {
+  std::vector<void*> tokens;
+  std::unique_lock<std::mutex> lock(lock_);
+  int slot = -1;
+
+  while (running_ && !flushing_ && base_ != nullptr) {
+    collect_released(&tokens);
+    for (uint32_t s = 0; s < slot_count_; s++) {
+      if (slot_free(s)) {
+        slot = static_cast<int>(s);
+        break;
+      }
+    }
+    if (slot >= 0) {
+      held_[slot] = 1;
+      break;
+    }
+    if (mode == ShmBackpressure::kDropNewest)
+      break;
+
+    if (mode == ShmBackpressure::kDropOldest) {
+      int oldest = -1;
+      uint32_t oldest_age = 0;
+      for (uint32_t s = 0; s < slot_count_; s++) {
+        uint64_t w = state_[s].load(std::memory_order_acquire);
+        if (!in_flight_[s] || (w & 0xffff) != 0 || (w & kRefMask) == 0)
+          continue;
+        uint32_t age = next_seq_ - slot_seq_[s];
+        if (oldest < 0 || age > oldest_age) {
+          oldest = static_cast<int>(s);
+          oldest_age = age;
+        }
+      }
+      if (oldest >= 0) {
+        uint64_t w = state_[oldest].load(std::memory_order_acquire);
+        // fails when a consumer claimed the frame meanwhile; rescan
+        while ((w & 0xffff) == 0 && (w & kRefMask) != 0) {
+          if (state_[oldest].compare_exchange_weak(w, w & ~kRefMask, std::memory_order_acq_rel)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            break;
+          }
+        }
+        continue;
+      }
+    }
+
+    if (!tokens.empty()) {
+      // Releasing a token may free a slot held by the caller's memory.
+      lock.unlock();
+      release_tokens(&tokens);
+      lock.lock();
+      continue;
+    }
+    // Releases normally wake us up; the timeout covers release messages
+    // lost to a full socket.
+    slot_freed_.wait_for(lock, std::chrono::milliseconds(100));
+  }
+  lock.unlock();
+
+  release_tokens(&tokens);
+  return slot;
+}
+
+void ShmProducer::release(uint32_t slot) {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (slot < slot_count_)
+      held_[slot] = 0;
+  }
+  slot_freed_.notify_all();
+}
+
+bool ShmProducer::publish(const ShmFrameInfo& info, void* token) {
+  std::vector<void*> tokens;
+  bool published = true;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    uint32_t slot = info.slot;
+
+    if (base_ != nullptr && slot < slot_count_)
+      collect_released(&tokens);
+    if (base_ == nullptr || slot >= slot_count_ || info.data_offset + info.size > slot_size_) {
+      tokens.push_back(token);
+    } else if (in_flight_[slot]) {
+      published = false;
+    } else {
+      uint32_t seq = next_seq_++;
+      uint64_t mask = 0;
+
+      for (const auto& client : clients_) {
+        if (client.hello_sent)
+          mask |= pending_bit(client.index);
+      }
+      if (running_ && mask != 0) {
+        ShmFrameInfo msg = info;
+        msg.seq = seq;
+        slot_seq_[slot] = seq;
+        tokens_[slot] = token;
+        in_flight_[slot] = 1;
+        state_[slot].store((static_cast<uint64_t>(seq) << kSeqShift) | mask, std::memory_order_release);
+        for (auto& client : clients_) {
+          if (client.hello_sent && !send_to(&client, kMsgFrame, &msg, sizeof(msg))) {
+            state_[slot].fetch_and(~pending_bit(client.index), std::memory_order_acq_rel);
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+        collect_released(&tokens);
+      } else {
+        tokens.push_back(token);
+      }
+    }
+  }
+  release_tokens(&tokens);
+  return published;
+}
+
+void ShmProducer::set_caps(const std::string& caps) {
+  std::lock_guard<std::mutex> guard(lock_);
+  caps_ = caps;
+  for (auto& client : clients_) {
+    if (client.hello_sent)
+      send_to(&client, kMsgCaps, caps_.data(), caps_.size());
+  }
+}
+
+void ShmProducer::send_eos() {
+  std::lock_guard<std::mutex> guard(lock_);
+  for (auto& client : clients_) {
+    if (client.hello_sent)
+      send_to(&client, kMsgEos, nullptr, 0);
+  }
+}
+
+void ShmProducer::set_flushing(bool flushing) {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    flushing_ = flushing;
+  }
+  slot_freed_.notify_all();
+}
+
+uint32_t ShmProducer::consumers() const {
+  std::lock_guard<std::mutex> guard(lock_);
+  return static_cast<uint32_t>(clients_.size());
+}
+
+bool ShmProducer::send_to(Client* client, uint32_t type, const void* payload, size_t size, int fd) {
+  return send_message(client->fd, type, payload, size, fd);
+}
+
+bool ShmProducer::send_hello(Client* client) {
+  Hello hello{kProtocolVersion, client->index};
+  if (!send_to(client, kMsgHello, &hello, sizeof(hello), memfd_))
+    return false;
+  client->hello_sent = true;
+  if (!caps_.empty())
+    send_to(client, kMsgCaps, caps_.data(), caps_.size());
+  return true;
+}
+
+void ShmProducer::accept_client() {
+  int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+  if (fd < 0)
+    return;
+  if (clients_.size() >= kShmMaxConsumers) {
+    close(fd);
+    return;
+  }
+
+  Client client;
+  client.fd = fd;
+  while (client_mask_ & (1u << client.index))
+    client.index++;
+  client_mask_ |= 1u << client.index;
+  if (base_ != nullptr)
+    send_hello(&client);
+  clients_.push_back(client);
+}
+
+void ShmProducer::drop_client(size_t i) {
+  Client client = clients_[i];
+  uint64_t bits = active_bit(client.index) | pending_bit(client.index);
+
+  for (uint32_t s = 0; s < slot_count_; s++)
+    state_[s].fetch_and(~bits, std::memory_order_acq_rel);
+  close(client.fd);
+  client_mask_ &= ~(1u << client.index);
+  clients_.erase(clients_.begin() + static_cast<std::ptrdiff_t>(i));
+}
+
+void ShmProducer::collect_released(std::vector<void*>* tokens) {
+  for (uint32_t s = 0; s < slot_count_; s++) {
+    if (in_flight_[s] && (state_[s].load(std::memory_order_acquire) & kRefMask) == 0) {
+      in_flight_[s] = 0;
+      if (tokens_[s] != nullptr)
+        tokens->push_back(tokens_[s]);
+      tokens_[s] = nullptr;
+    }
+  }
+}
+
+void ShmProducer::release_tokens(std::vector<void*>* tokens) {
+  for (void* token : *tokens) {
+    if (token != nullptr)
+      token_release_(token);
+  }
+  tokens->clear();
+}
+
+void ShmProducer::run() {
+  std::vector<pollfd> fds;
+  std::vector<void*> tokens;
+  MsgHeader rx[16];
+
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      if (!running_)
+        break;
+      fds.clear();
+      fds.push_back({listen_fd_, POLLIN, 0});
+      fds.push_back({wake_fd_, POLLIN, 0});
+      for (const auto& client : clients_)
+        fds.push_back({client.fd, POLLIN, 0});
+    }
+
+    if (poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR)
+      break;
+
+    if (fds[1].revents & POLLIN) {
+      uint64_t value;
+      if (read(wake_fd_, &value, sizeof(value)) < 0) {
+        // spurious wakeup
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      if (!running_)
+        break;
+      if (fds[0].revents & POLLIN)
+        accept_client();
+
+      for (size_t p = 2; p < fds.size(); p++) {
+        if (fds[p].revents == 0)
+          continue;
+        size_t i = 0;
+        while (i < clients_.size() && clients_[i].fd != fds[p].fd)
+          i++;
+        if (i == clients_.size())
+          continue;
+
+        bool gone = (fds[p].revents & (POLLHUP | POLLERR)) != 0;
+        // Release messages only wake us up; the state words are the truth.
+        for (;;) {
+          ssize_t n = recv(fds[p].fd, rx, sizeof(rx), MSG_DONTWAIT);
+          if (n > 0)
+            continue;
+          if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+            gone = true;
+          if (n == 0 || errno != EINTR)
+            break;
+        }
+        if (gone)
+          drop_client(i);
+      }
+      collect_released(&tokens);
+    }
+
+    release_tokens(&tokens);
+    slot_freed_.notify_all();
+  }
+}
+
+ShmConsumer::ShmConsumer() : rx_(sizeof(MsgHeader) + kMaxPayload) {}
+
+ShmConsumer::~ShmConsumer() {
+  if (fd_ >= 0)
+    close(fd_);
+  if (wake_fd_ >= 0)
+    close(wake_fd_);
+  if (base_ != nullptr)
+    munmap(base_, segment_size_);
+}
+
+bool ShmConsumer::connect(const std::string& socket_path) {
+  sockaddr_un addr;
+  if (fd_ >= 0 || !fill_address(socket_path, &addr))
+    return false;
+
+  int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return false;
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    close(fd);
+    return false;
+  }
+  int wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake < 0) {
+    close(fd);
+    return false;
+  }
+  fd_ = fd;
+  wake_fd_ = wake;
+  return true;
+}
+
+bool ShmConsumer::map_segment(const void* payload, size_t size, int fd) {
+  Hello hello;
+  struct stat st;
+
+  if (base_ != nullptr || size != sizeof(hello) || fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(SegmentHeader))
+    return false;
+  std::memcpy(&hello, payload, sizeof(hello));
+  if (hello.version != kProtocolVersion || hello.client >= kShmMaxConsumers)
+    return false;
+
+  size_t total = static_cast<size_t>(st.st_size);
+  void* base = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED)
+    return false;
+
+  const auto* header = static_cast<const SegmentHeader*>(base);
+  if (std::memcmp(header->magic, kSegmentMagic, sizeof(kSegmentMagic)) != 0 ||
+      header->version != kProtocolVersion || header->slot_count == 0 || header->slot_size > header->slot_stride ||
+      header->data_offset < sizeof(SegmentHeader) + sizeof(uint64_t) * header->slot_count ||
+      header->data_offset + header->slot_stride * header->slot_count > total) {
+    munmap(base, total);
+    return false;
+  }
+
+  base_ = static_cast<uint8_t*>(base);
+  segment_size_ = total;
+  index_ = hello.client;
+  state_ = reinterpret_cast<std::atomic<uint64_t>*>(base_ + sizeof(SegmentHeader));
+  data_ = base_ + header->data_offset;
+  slot_count_ = header->slot_count;
+  slot_size_ = header->slot_size;
+  slot_stride_ = header->slot_stride;
+  return true;
+}
+
+bool ShmConsumer::claim(uint32_t slot, uint32_t seq) {
+  uint64_t w = state_[slot].load(std::memory_order_acquire);
+  for (;;) {
+    if ((w >> kSeqShift) != seq || !(w & pending_bit(index_)))
+      return false;
+    uint64_t claimed = (w & ~pending_bit(index_)) | active_bit(index_);
+    if (state_[slot].compare_exchange_weak(w, claimed, std::memory_order_acq_rel))
+      return true;
+  }
+}
+
+ShmConsumer::Event ShmConsumer::next(ShmFrameInfo* frame, std::string* caps) {
+  for (;;) {
+    pollfd fds[2] = {{fd_, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      return Event::kClosed;
+    }
+    if (fds[1].revents & POLLIN)
+      return Event::kInterrupted;
+
+    iovec iov{rx_.data(), rx_.size()};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n = recvmsg(fd_, &msg, MSG_CMSG_CLOEXEC);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < static_cast<ssize_t>(sizeof(MsgHeader)) || (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)))
+      return Event::kClosed;
+
+    int fd = -1;
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+
+    MsgHeader header;
+    std::memcpy(&header, rx_.data(), sizeof(header));
+    const uint8_t* payload = rx_.data() + sizeof(header);
+    if (header.size != static_cast<size_t>(n) - sizeof(header)) {
+      if (fd >= 0)
+        close(fd);
+      return Event::kClosed;
+    }
+
+    if (header.type == kMsgHello) {
+      bool mapped = fd >= 0 && map_segment(payload, header.size, fd);
+      if (fd >= 0)
+        close(fd);
+      if (!mapped)
+        return Event::kClosed;
+      continue;
+    }
+    if (fd >= 0)
+      close(fd);
+
+    switch (header.type) {
+      case kMsgCaps:
+        caps->assign(reinterpret_cast<const char*>(payload), header.size);
+        return Event::kCaps;
+      case kMsgEos:
+        return Event::kEos;
+      case kMsgFrame:
+        if (base_ == nullptr || header.size != sizeof(ShmFrameInfo))
+          return Event::kClosed;
+        std::memcpy(frame, payload, sizeof(*frame));
+        if (frame->slot >= slot_count_ || frame->data_offset > slot_size_ || frame->size > slot_size_ - frame->data_offset)
+          return Event::kClosed;
+        if (claim(frame->slot, frame->seq))
+          return Event::kFrame;
+        skipped_.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      default:
+        return Event::kClosed;
+    }
+  }
+}
+
+void ShmConsumer::release(uint32_t slot) {
+  uint32_t msg = slot;
+  state_[slot].fetch_and(~active_bit(index_), std::memory_order_acq_rel);
+  send_message(fd_, kMsgRelease, &msg, sizeof(msg), -1);
+}
+
+void ShmConsumer::interrupt() {
+  uint64_t one = 1;
+  if (write(wake_fd_, &one, sizeof(one)) < 0) {
+    // already interrupted
+  }
+}
+
+void ShmConsumer::clear_interrupt() {
+  uint64_t value;
+  if (read(wake_fd_, &value, sizeof(value)) < 0) {
+    // was not interrupted
+  }
+}
+
+}  // namespace nvgst
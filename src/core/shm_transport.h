@@ -0,0 +1,226 @@
+// Zero-copy frame transport between processes on one host. The producer
+// owns a memfd-backed segment holding a ring of fixed-size slots; only slot
+// indices and per-frame metadata travel over a SOCK_SEQPACKET unix socket,
+// and consumers receive the segment fd once (SCM_RIGHTS) and read frames in
+// place.
+//
+// Every slot has a 64-bit state word in the segment:
+//
+//   seq (32) | pending consumers (16) | active consumers (16)
+//
+// Publishing a slot sets one pending bit per connected consumer. A consumer
+// claims a frame by atomically moving its bit from pending to active (only
+// if seq still matches) and releases it by clearing its active bit. The
+// producer reuses a slot once the low 32 bits are zero and it no longer
+// holds the slot itself; drop-oldest backpressure may clear pending bits of
+// frames no consumer has claimed yet, which makes their claims fail.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nvgst {
+
+constexpr uint32_t kShmMaxConsumers = 16;
+constexpr uint32_t kShmMaxPlanes = 4;
+
+// Per-frame metadata sent with each slot index. Times are nanoseconds,
+// UINT64_MAX when unset (GST_CLOCK_TIME_NONE).
+struct ShmFrameInfo {
+  uint32_t slot;
+  uint32_t seq;
+  uint64_t data_offset;  // from the start of the slot
+  uint64_t size;
+  uint64_t pts;
+  uint64_t dts;
+  uint64_t duration;
+  uint64_t offset;
+  uint64_t offset_end;
+  uint32_t flags;
+  uint32_t n_planes;  // 0 when the producer had no plane layout
+  uint64_t plane_offset[kShmMaxPlanes];  // from data_offset
+  int32_t stride[kShmMaxPlanes];
+};
+
+enum class ShmBackpressure {
+  // Wait until a consumer releases a slot.
+  kBlock,
+  // Take back the oldest frame no consumer has claimed yet; waits only when
+  // every slot is being read.
+  kDropOldest,
+  // Drop the new frame.
+  kDropNewest,
+};
+
+class ShmProducer {
+ public:
+  // Releases a token passed to publish() once every consumer is done with
+  // the slot. Called without internal locks held.
+  using TokenRelease = void (*)(void* token);
+
+  explicit ShmProducer(TokenRelease release);
+  ~ShmProducer();
+
+  ShmProducer(const ShmProducer&) = delete;
+  ShmProducer& operator=(const ShmProducer&) = delete;
+
+  // Listens on socket_path (replacing a stale socket file) and starts the
+  // thread that accepts consumers and handles their releases.
+  bool start(const std::string& socket_path);
+  // Disconnects all consumers and releases every outstanding token. Slots
+  // stay mapped until the producer is destroyed.
+  void stop();
+
+  // Creates the segment on first use. Later calls succeed when the
+  // existing slots are large enough. Consumers that connected earlier get
+  // the segment now.
+  bool configure(uint32_t slot_count, size_t slot_size);
+  bool configured() const { return base_ != nullptr; }
+  uint32_t slot_count() const { return slot_count_; }
+  size_t slot_size() const { return slot_size_; }
+
+  uint8_t* slot_data(uint32_t slot) const { return data_ + static_cast<size_t>(slot) * slot_stride_; }
+  // Slot containing data, if data points into the segment.
+  bool slot_of(const void* data, uint32_t* slot) const;
+
+  // Takes a free slot for writing, applying mode when none is free.
+  // Returns -1 when the frame has to be dropped or the producer is
+  // flushing or stopped.
+  int acquire(ShmBackpressure mode);
+  // Gives back a slot taken with acquire().
+  void release(uint32_t slot);
+
+  // Sends the slot to every connected consumer. Takes ownership of token
+  // (may be null) and releases it when all consumers have released the
+  // slot, immediately if there are none. Returns false without publishing
+  // when the slot is still in flight from an earlier publish.
+  bool publish(const ShmFrameInfo& info, void* token);
+
+  // Sent to consumers now and to every consumer that connects later.
+  void set_caps(const std::string& caps);
+  void send_eos();
+
+  // Makes acquire() return -1 instead of waiting.
+  void set_flushing(bool flushing);
+
+  uint32_t consumers() const;
+  // Frames taken back by drop-oldest or not delivered because a consumer's
+  // socket was full.
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Client {
+    int fd = -1;
+    uint32_t index = 0;
+    bool hello_sent = false;
+  };
+
+  void run();
+  void accept_client();
+  bool send_hello(Client* client);
+  void drop_client(size_t i);
+  // Moves slots whose state word dropped to zero out of flight and appends
+  // their tokens to tokens. Needs lock_.
+  void collect_released(std::vector<void*>* tokens);
+  void release_tokens(std::vector<void*>* tokens);
+  bool slot_free(uint32_t slot) const;
+  bool send_to(Client* client, uint32_t type, const void* payload, size_t size, int fd = -1);
+
+  const TokenRelease token_release_;
+
+  mutable std::mutex lock_;
+  std::condition_variable slot_freed_;
+  bool flushing_ = false;
+  bool running_ = false;
+  std::string caps_;
+  std::vector<Client> clients_;
+  uint32_t client_mask_ = 0;
+
+  int listen_fd_ = -1;
+  int wake_fd_ = -1;
+  std::string socket_path_;
+  std::thread thread_;
+
+  int memfd_ = -1;
+  uint8_t* base_ = nullptr;
+  size_t segment_size_ = 0;
+  std::atomic<uint64_t>* state_ = nullptr;
+  uint8_t* data_ = nullptr;
+  uint32_t slot_count_ = 0;
+  size_t slot_size_ = 0;
+  size_t slot_stride_ = 0;
+
+  // needs lock_
+  std::vector<uint8_t> held_;
+  std::vector<uint8_t> in_flight_;
+  std::vector<uint32_t> slot_seq_;
+  std::vector<void*> tokens_;
+  uint32_t next_seq_ = 1;
+
+  std::atomic<uint64_t> dropped_{0};
+};
+
+class ShmConsumer {
+ public:
+  enum class Event {
+    kFrame,
+    kCaps,
+    kEos,
+    // interrupt() was called.
+    kInterrupted,
+    // The producer went away or sent something unexpected.
+    kClosed,
+  };
+
+  ShmConsumer();
+  ~ShmConsumer();
+
+  ShmConsumer(const ShmConsumer&) = delete;
+  ShmConsumer& operator=(const ShmConsumer&) = delete;
+
+  bool connect(const std::string& socket_path);
+
+  // Blocks for the next event. Frames are returned claimed and must be
+  // given back with release(); frames the producer took back before they
+  // could be claimed are skipped.
+  Event next(ShmFrameInfo* frame, std::string* caps);
+
+  const uint8_t* slot_data(uint32_t slot) const { return data_ + static_cast<size_t>(slot) * slot_stride_; }
+  size_t slot_size() const { return slot_size_; }
+
+  // Any thread.
+  void release(uint32_t slot);
+
+  // Makes a blocked or the next next() call return kInterrupted until
+  // clear_interrupt().
+  void interrupt();
+  void clear_interrupt();
+
+  // Frames announced but taken back by the producer before being claimed.
+  uint64_t skipped() const { return skipped_.load(std::memory_order_relaxed); }
+
+ private:
+  bool map_segment(const void* hello, size_t size, int fd);
+  bool claim(uint32_t slot, uint32_t seq);
+
+  int fd_ = -1;
+  int wake_fd_ = -1;
+  uint32_t index_ = 0;
+  uint8_t* base_ = nullptr;
+  size_t segment_size_ = 0;
+  std::atomic<uint64_t>* state_ = nullptr;
+  uint8_t* data_ = nullptr;
+  uint32_t slot_count_ = 0;
+  size_t slot_size_ = 0;
+  size_t slot_stride_ = 0;
+  std::vector<uint8_t> rx_;
+  std::atomic<uint64_t> skipped_{0};
+};
+
+}  // namespace nvgst
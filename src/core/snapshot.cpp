@@ -0,0 +1,593 @@
+#include "core/snapshot.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+
+#include <jpeglib.h>
+
+#include "core/scaler.h"
+
+namespace nvgst {
+
+namespace {
+
+// A kept crop is only replaced by one scoring this much better, so a
+// track whose box grows slowly is not copied on every frame.
+constexpr float kRecopyGain = 1.1f;
+
+// Output buffer of a fresh vector.
+constexpr size_t kInitialJpegSize = 64 * 1024;
+
+bool write_all(int fd, const void* data, size_t size) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  while (size > 0) {
+    const ssize_t n = ::write(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+// Written under a temporary name and renamed, so whoever watches the
+// directory never reads a partial file.
+bool write_file(const std::string& path, const std::vector<uint8_t>& data, std::string* error) {
+  const std::string tmp = path + ".tmp";
+  const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    *error = "open " + tmp + ": " + std::strerror(errno);
+    return false;
+  }
+  bool ok = write_all(fd, data.data(), data.size());
+  ok = ::close(fd) == 0 && ok;
+  if (ok)
+    ok = ::rename(tmp.c_str(), path.c_str()) == 0;
+  if (!ok) {
+    *error = "write " + path + ": " + std::strerror(errno);
+    ::unlink(tmp.c_str());
+  }
+  return ok;
+}
+
+// Copies n samples and repeats the last one up to padded.
+inline void pad_row(const uint8_t* src, uint8_t* dst, int n, int padded) {
+  std::memcpy(dst, src, n);
+  std::memset(dst + n, src[n - 1], padded - n);
+}
+
+}  // namespace
+
+bool SnapshotImage::assign(const FrameView& frame, SnapshotRect rect) {
+  int x0 = std::max(rect.x0, 0);
+  int y0 = std::max(rect.y0, 0);
+  int x1 = std::min(rect.x1, frame.width);
+  int y1 = std::min(rect.y1, frame.height);
+  if (format_is_yuv(frame.format)) {
+    x0 &= ~1;
+    y0 &= ~1;
+    x1 = std::min(x1 + (x1 & 1), frame.width);
+    y1 = std::min(y1 + (y1 & 1), frame.height);
+  }
+  if (x1 <= x0 || y1 <= y0)
+    return false;
+
+  rect_ = {x0, y0, x1, y1};
+  layout_ = make_frame_layout(frame.format, x1 - x0, y1 - y0);
+  if (!pixels_.reserve(layout_.size))
+    return false;
+  uint8_t* base = pixels_.data();
+  for (int p = 0; p < layout_.n_planes; p++) {
+    const int bpp = plane_pixel_stride(frame.format, p);
+    const int row_bytes = plane_width(frame.format, p, layout_.width) * bpp;
+    const int rows = plane_height(frame.format, p, layout_.height);
+    const uint8_t* src = frame.data[p] +
+                         static_cast<size_t>(plane_height(frame.format, p, y0)) * frame.stride[p] +
+                         plane_width(frame.format, p, x0) * bpp;
+    uint8_t* dst = base + layout_.offset[p];
+    for (int y = 0; y < rows; y++) {
+      std::memcpy(dst + static_cast<size_t>(y) * layout_.stride[p],
+                  src + static_cast<size_t>(y) * frame.stride[p], row_bytes);
+    }
+  }
+  return true;
+}
+
+SnapshotRect snapshot_crop(const DetectedObject& object, float padding) {
+  const float px = object.width * padding;
+  const float py = object.height * padding;
+  return {static_cast<int>(std::floor(object.x - px)), static_cast<int>(std::floor(object.y - py)),
+          static_cast<int>(std::ceil(object.x + object.width + px)),
+          static_cast<int>(std::ceil(object.y + object.height + py))};
+}
+
+// ---- TrackSnapshots ----
+
+void TrackSnapshots::configure(const TrackSnapshotConfig& config) {
+  config_ = config;
+}
+
+bool TrackSnapshots::wanted(int32_t class_id) const {
+  return config_.classes.empty() ||
+         std::find(config_.classes.begin(), config_.classes.end(), class_id) !=
+             config_.classes.end();
+}
+
+float TrackSnapshots::score(const DetectedObject& object, int width, int height) {
+  const float x0 = std::max(object.x, 0.0f);
+  const float y0 = std::max(object.y, 0.0f);
+  const float x1 = std::min(object.x + object.width, static_cast<float>(width));
+  const float y1 = std::min(object.y + object.height, static_cast<float>(height));
+  if (x1 <= x0 || y1 <= y0)
+    return 0.0f;
+  const bool cut = object.x <= 0.0f || object.y <= 0.0f ||
+                   object.x + object.width >= static_cast<float>(width) ||
+                   object.y + object.height >= static_cast<float>(height);
+  const float score = object.confidence * std::sqrt((x1 - x0) * (y1 - y0));
+  return cut ? 0.5f * score : score;
+}
+
+SnapshotImage TrackSnapshots::take_image() {
+  if (spare_.empty())
+    return SnapshotImage();
+  SnapshotImage image = std::move(spare_.back());
+  spare_.pop_back();
+  return image;
+}
+
+void TrackSnapshots::recycle(SnapshotImage&& image) {
+  spare_.push_back(std::move(image));
+}
+
+void TrackSnapshots::emit(Track& track) {
+  ready_.push_back(std::move(track.best));
+  track.have = false;
+  track.emitted = true;
+}
+
+void TrackSnapshots::offer(uint32_t source, int64_t pts, const FrameView& frame,
+                           const DetectedObject* objects, size_t n, uint32_t index) {
+  Source& state = sources_[source];
+  const uint64_t now = ++state.frame;
+
+  for (size_t i = 0; i < n; i++) {
+    const DetectedObject& object = objects[i];
+    if (object.frame != index || object.track_id == kNoTrack || !wanted(object.class_id))
+      continue;
+
+    auto it = state.tracks.find(object.track_id);
+    if (it == state.tracks.end()) {
+      it = state.tracks.emplace(object.track_id, Track()).first;
+      it->second.first_seen = now;
+      it->second.best.image = take_image();
+    }
+    Track& track = it->second;
+    track.last_seen = now;
+    if (track.emitted)
+      continue;
+
+    const float score = TrackSnapshots::score(object, frame.width, frame.height);
+    if (!track.have || score > track.best.score * kRecopyGain) {
+      const SnapshotRect rect = snapshot_crop(object, config_.padding);
+      const int width = std::min(rect.x1, frame.width) - std::max(rect.x0, 0);
+      const int height = std::min(rect.y1, frame.height) - std::max(rect.y0, 0);
+      if (width >= config_.min_size && height >= config_.min_size &&
+          track.best.image.assign(frame, rect)) {
+        SnapshotInfo& info = track.best.info;
+        info.source = source;
+        info.track_id = object.track_id;
+        info.class_id = object.class_id;
+        info.confidence = object.confidence;
+        info.pts = pts;
+        info.rect = track.best.image.rect();
+        track.best.score = score;
+        track.have = true;
+      }
+    }
+    const uint64_t age = now - track.first_seen + 1;
+    if (config_.max_age > 0 && track.have && age >= static_cast<uint64_t>(config_.max_age))
+      emit(track);
+  }
+
+  for (auto it = state.tracks.begin(); it != state.tracks.end();) {
+    Track& track = it->second;
+    if (now - track.last_seen <= static_cast<uint64_t>(config_.linger)) {
+      ++it;
+      continue;
+    }
+    if (track.have)
+      emit(track);
+    else if (!track.emitted)
+      recycle(std::move(track.best.image));
+    it = state.tracks.erase(it);
+  }
+}
+
+void TrackSnapshots::flush() {
+  for (auto& entry : sources_) {
+    for (auto& track : entry.second.tracks) {
+      if (track.second.have)
+        emit(track.second);
+    }
+  }
+  sources_.clear();
+}
+
+void TrackSnapshots::reset() {
+  sources_.clear();
+  ready_.clear();
+}
+
+void TrackSnapshots::take(std::vector<SnapshotCandidate>* ready) {
+  for (SnapshotCandidate& candidate : ready_)
+    ready->push_back(std::move(candidate));
+  ready_.clear();
+}
+
+size_t TrackSnapshots::tracks() const {
+  size_t n = 0;
+  for (const auto& entry : sources_)
+    n += entry.second.tracks.size();
+  return n;
+}
+
+// ---- JpegEncoder ----
+
+// libjpeg reports errors through error_exit, which must not return:
+// it jumps back to encode() with the message.
+struct JpegEncoder::State {
+  struct Error {
+    jpeg_error_mgr pub;
+    std::jmp_buf jump;
+    char message[JMSG_LENGTH_MAX];
+  };
+
+  // Appends to a vector, doubling it when full.
+  struct Destination {
+    jpeg_destination_mgr pub;
+    std::vector<uint8_t>* out;
+  };
+
+  jpeg_compress_struct cinfo;
+  Error error;
+  Destination destination;
+  bool created = false;
+
+  static void error_exit(j_common_ptr cinfo) {
+    Error* error = reinterpret_cast<Error*>(cinfo->err);
+    cinfo->err->format_message(cinfo, error->message);
+    std::longjmp(error->jump, 1);
+  }
+
+  // Warnings would go to stderr.
+  static void output_message(j_common_ptr cinfo) {}
+
+  static void init_destination(j_compress_ptr cinfo) {
+    Destination* dest = reinterpret_cast<Destination*>(cinfo->dest);
+    dest->out->resize(std::max(dest->out->capacity(), kInitialJpegSize));
+    dest->pub.next_output_byte = dest->out->data();
+    dest->pub.free_in_buffer = dest->out->size();
+  }
+
+  static boolean empty_output_buffer(j_compress_ptr cinfo) {
+    Destination* dest = reinterpret_cast<Destination*>(cinfo->dest);
+    const size_t used = dest->out->size();
+    dest->out->resize(used * 2);
+    dest->pub.next_output_byte = dest->out->data() + used;
+    dest->pub.free_in_buffer = dest->out->size() - used;
+    return TRUE;
+  }
+
+  static void term_destination(j_compress_ptr cinfo) {
+    Destination* dest = reinterpret_cast<Destination*>(cinfo->dest);
+    dest->out->resize(dest->out->size() - dest->pub.free_in_buffer);
+  }
+};
+
+JpegEncoder::JpegEncoder() : state_(new State()) {
+  State& s = *state_;
+  s.cinfo.err = jpeg_std_error(&s.error.pub);
+  s.error.pub.error_exit = State::error_exit;
+  s.error.pub.output_message = State::output_message;
+  s.destination.pub.init_destination = State::init_destination;
+  s.destination.pub.empty_output_buffer = State::empty_output_buffer;
+  s.destination.pub.term_destination = State::term_destination;
+  s.destination.out = nullptr;
+}
+
+JpegEncoder::~JpegEncoder() {
+  if (state_->created)
+    jpeg_destroy_compress(&state_->cinfo);
+}
+
+// Nothing with a destructor may live in this frame or below it while
+// libjpeg runs, since errors longjmp over them.
+bool JpegEncoder::encode(const FrameView& frame, int quality, std::vector<uint8_t>* out,
+                         std::string* error) {
+  if (frame.width <= 0 || frame.height <= 0 || frame.width > JPEG_MAX_DIMENSION ||
+      frame.height > JPEG_MAX_DIMENSION || format_n_planes(frame.format) == 0) {
+    *error = "unsupported image";
+    return false;
+  }
+
+  State& s = *state_;
+  if (setjmp(s.error.jump)) {
+    if (s.created)
+      jpeg_abort_compress(&s.cinfo);
+    *error = s.error.message;
+    return false;
+  }
+  if (!s.created) {
+    jpeg_create_compress(&s.cinfo);
+    s.cinfo.dest = &s.destination.pub;
+    s.created = true;
+  }
+  s.destination.out = out;
+  return compress(frame, std::clamp(quality, 1, 100), out);
+}
+
+bool JpegEncoder::compress(const FrameView& frame, int quality, std::vector<uint8_t>* out) {
+  jpeg_compress_struct& cinfo = state_->cinfo;
+  const bool yuv = format_is_yuv(frame.format);
+
+  cinfo.image_width = static_cast<JDIMENSION>(frame.width);
+  cinfo.image_height = static_cast<JDIMENSION>(frame.height);
+  if (yuv) {
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_YCbCr;
+  } else {
+    cinfo.input_components = 4;
+    cinfo.in_color_space = frame.format == PixelFormat::kRGBA ? JCS_EXT_RGBX : JCS_EXT_BGRX;
+  }
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, quality, TRUE);
+  if (yuv) {
+    // The planes are already 4:2:0: hand them over as they are.
+    cinfo.raw_data_in = TRUE;
+    cinfo.comp_info[0].h_samp_factor = 2;
+    cinfo.comp_info[0].v_samp_factor = 2;
+    for (int c = 1; c < 3; c++) {
+      cinfo.comp_info[c].h_samp_factor = 1;
+      cinfo.comp_info[c].v_samp_factor = 1;
+    }
+  }
+
+  jpeg_start_compress(&cinfo, TRUE);
+  if (yuv)
+    write_yuv(frame);
+  else
+    write_rgb(frame);
+  jpeg_finish_compress(&cinfo);
+  return true;
+}
+
+// Raw data goes in 16 luma and 8 chroma rows at a time, each padded to
+// whole 8x8 blocks; rows past the bottom repeat the last one.
+void JpegEncoder::write_yuv(const FrameView& frame) {
+  jpeg_compress_struct& cinfo = state_->cinfo;
+  const int width = frame.width;
+  const int height = frame.height;
+  const int padded = align_up(width, 2 * DCTSIZE);
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  const int chroma_padded = padded / 2;
+  rows_.resize(static_cast<size_t>(2 * DCTSIZE) * padded +
+               static_cast<size_t>(2 * DCTSIZE) * chroma_padded);
+
+  uint8_t* y_rows = rows_.data();
+  uint8_t* u_rows = y_rows + static_cast<size_t>(2 * DCTSIZE) * padded;
+  uint8_t* v_rows = u_rows + static_cast<size_t>(DCTSIZE) * chroma_padded;
+  JSAMPROW y_ptr[2 * DCTSIZE];
+  JSAMPROW u_ptr[DCTSIZE];
+  JSAMPROW v_ptr[DCTSIZE];
+  JSAMPARRAY planes[3] = {y_ptr, u_ptr, v_ptr};
+  for (int r = 0; r < 2 * DCTSIZE; r++)
+    y_ptr[r] = y_rows + static_cast<size_t>(r) * padded;
+  for (int r = 0; r < DCTSIZE; r++) {
+    u_ptr[r] = u_rows + static_cast<size_t>(r) * chroma_padded;
+    v_ptr[r] = v_rows + static_cast<size_t>(r) * chroma_padded;
+  }
+
+  for (int top = 0; top < height; top += 2 * DCTSIZE) {
+    for (int r = 0; r < 2 * DCTSIZE; r++) {
+      const int y = std::min(top + r, height - 1);
+      pad_row(frame.data[0] + static_cast<size_t>(y) * frame.stride[0], y_ptr[r], width, padded);
+    }
+    for (int r = 0; r < DCTSIZE; r++) {
+      const int y = std::min(top / 2 + r, chroma_height - 1);
+      if (frame.format == PixelFormat::kNV12) {
+        const uint8_t* uv = frame.data[1] + static_cast<size_t>(y) * frame.stride[1];
+        for (int x = 0; x < chroma_width; x++) {
+          u_ptr[r][x] = uv[2 * x];
+          v_ptr[r][x] = uv[2 * x + 1];
+        }
+        std::memset(u_ptr[r] + chroma_width, u_ptr[r][chroma_width - 1],
+                    chroma_padded - chroma_width);
+        std::memset(v_ptr[r] + chroma_width, v_ptr[r][chroma_width - 1],
+                    chroma_padded - chroma_width);
+      } else {
+        pad_row(frame.data[1] + static_cast<size_t>(y) * frame.stride[1], u_ptr[r], chroma_width,
+                chroma_padded);
+        pad_row(frame.data[2] + static_cast<size_t>(y) * frame.stride[2], v_ptr[r], chroma_width,
+                chroma_padded);
+      }
+    }
+    jpeg_write_raw_data(&cinfo, planes, 2 * DCTSIZE);
+  }
+}
+
+void JpegEncoder::write_rgb(const FrameView& frame) {
+  jpeg_compress_struct& cinfo = state_->cinfo;
+  JSAMPROW rows[2 * DCTSIZE];
+  while (cinfo.next_scanline < cinfo.image_height) {
+    const int top = static_cast<int>(cinfo.next_scanline);
+    const int n = std::min(2 * DCTSIZE, frame.height - top);
+    for (int r = 0; r < n; r++)
+      rows[r] = frame.data[0] + static_cast<size_t>(top + r) * frame.stride[0];
+    jpeg_write_scanlines(&cinfo, rows, static_cast<JDIMENSION>(n));
+  }
+}
+
+// ---- SnapshotEncoder ----
+
+struct SnapshotEncoder::Worker {
+  std::thread thread;
+  JpegEncoder jpeg;
+  const simd::Kernels* kernels = nullptr;
+  // Crops scaled down to max_size.
+  FrameLayout layout;
+  AlignedBuffer scaled;
+  PlaneScaler scalers[3];
+  std::vector<uint8_t> scratch;
+};
+
+SnapshotEncoder::SnapshotEncoder() = default;
+
+SnapshotEncoder::~SnapshotEncoder() {
+  stop();
+}
+
+bool SnapshotEncoder::start(const SnapshotEncoderConfig& config, Done done) {
+  if (config.workers < 1 || config.max_pending < 1 || config.max_size < 0)
+    return false;
+  stop();
+
+  config_ = config;
+  done_ = std::move(done);
+  for (int i = 0; i < config.workers; i++) {
+    workers_.emplace_back(new Worker());
+    workers_.back()->kernels = &simd::kernels(config.simd);
+  }
+  for (auto& worker : workers_)
+    worker->thread = std::thread(&SnapshotEncoder::run, this, worker.get());
+  return true;
+}
+
+void SnapshotEncoder::stop() {
+  if (workers_.empty())
+    return;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto& worker : workers_)
+    worker->thread.join();
+  workers_.clear();
+  stopping_ = false;
+}
+
+SnapshotJob* SnapshotEncoder::acquire() {
+  std::lock_guard<std::mutex> guard(lock_);
+  // Slots are created on demand and kept across restarts; only
+  // max_pending of them are handed out at once.
+  const size_t busy = slots_.size() - free_.size();
+  if (busy >= static_cast<size_t>(config_.max_pending)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  if (free_.empty()) {
+    slots_.emplace_back(new SnapshotJob());
+    return slots_.back().get();
+  }
+  SnapshotJob* job = free_.back();
+  free_.pop_back();
+  return job;
+}
+
+void SnapshotEncoder::submit(SnapshotJob* job) {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    queue_.push_back(job);
+  }
+  wake_.notify_one();
+}
+
+void SnapshotEncoder::release(SnapshotJob* job) {
+  std::lock_guard<std::mutex> guard(lock_);
+  free_.push_back(job);
+}
+
+void SnapshotEncoder::collect(std::vector<SnapshotJob*>* done) {
+  std::lock_guard<std::mutex> guard(lock_);
+  done->insert(done->end(), finished_.begin(), finished_.end());
+  finished_.clear();
+}
+
+void SnapshotEncoder::run(Worker* worker) {
+  std::unique_lock<std::mutex> guard(lock_);
+  for (;;) {
+    wake_.wait(guard, [this] { return stopping_ || !queue_.empty(); });
+    if (queue_.empty())
+      return;
+    SnapshotJob* job = queue_.front();
+    queue_.pop_front();
+    guard.unlock();
+
+    process(worker, job);
+    if (done_)
+      done_(*job);
+
+    guard.lock();
+    if (config_.collect)
+      finished_.push_back(job);
+    else
+      free_.push_back(job);
+  }
+}
+
+void SnapshotEncoder::process(Worker* worker, SnapshotJob* job) {
+  FrameView view = job->image.view();
+  job->error.clear();
+
+  const int longest = std::max(view.width, view.height);
+  if (config_.max_size > 0 && longest > config_.max_size) {
+    const double scale = static_cast<double>(config_.max_size) / longest;
+    int width = std::max(1, static_cast<int>(std::lround(view.width * scale)));
+    int height = std::max(1, static_cast<int>(std::lround(view.height * scale)));
+    if (format_is_yuv(view.format)) {
+      width = std::max(2, width & ~1);
+      height = std::max(2, height & ~1);
+    }
+    worker->layout = make_frame_layout(view.format, width, height);
+    if (!worker->scaled.reserve(worker->layout.size)) {
+      job->error = "out of memory";
+    } else {
+      const FrameView dst = make_frame_view(worker->layout, worker->scaled.data());
+      for (int p = 0; p < worker->layout.n_planes; p++) {
+        PlaneScaler& scaler = worker->scalers[p];
+        scaler.configure(plane_width(view.format, p, view.width),
+                         plane_height(view.format, p, view.height),
+                         plane_width(view.format, p, width), plane_height(view.format, p, height),
+                         plane_pixel_stride(view.format, p));
+        worker->scratch.resize(scaler.scratch_size());
+        scaler.scale_rows(view.data[p], view.stride[p], dst.data[p], dst.stride[p], 0,
+                          scaler.dst_height(), worker->scratch.data(), *worker->kernels);
+      }
+      view = dst;
+    }
+  }
+
+  if (job->error.empty())
+    worker->jpeg.encode(view, config_.quality, &job->jpeg, &job->error);
+  if (job->error.empty() && !job->path.empty())
+    write_file(job->path, job->jpeg, &job->error);
+
+  job->width = view.width;
+  job->height = view.height;
+  if (job->error.empty())
+    encoded_.fetch_add(1, std::memory_order_relaxed);
+  else
+    failed_.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace nvgst
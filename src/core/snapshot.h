@@ -0,0 +1,257 @@
+// JPEG snapshots of objects and frames, encoded off the streaming thread.
+//
+// TrackSnapshots keeps, for every track, a copy of the best crop seen so
+// far, scored by confidence and size, and hands it out once: when the
+// track has not been seen for a while, or when it has been visible for
+// max_age frames. Each track is therefore encoded once, from its best
+// frame, and the streaming thread only copies a crop when it beats the one
+// kept.
+//
+// SnapshotEncoder compresses with libjpeg-turbo on a fixed set of worker
+// threads, each with its own compressor and scaler. Jobs come from a fixed
+// set of slots that are recycled with their pixel and output buffers, so
+// the backlog is bounded and memory stays flat; when every slot is
+// busy acquire() fails and the snapshot is dropped and counted instead of
+// stalling the caller. 4:2:0 input goes to the compressor as raw
+// downsampled planes, so it is never converted to RGB.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "core/aligned_buffer.h"
+#include "core/frame.h"
+#include "core/kernels.h"
+#include "core/objects.h"
+
+namespace nvgst {
+
+// [x0, x1) x [y0, y1) in frame pixels.
+struct SnapshotRect {
+  int x0, y0, x1, y1;
+};
+
+// An owned copy of part of a frame, in a tightly aligned layout.
+class SnapshotImage {
+ public:
+  // Copies rect of frame, clipped to it and grown to even coordinates on
+  // 4:2:0 formats. False when nothing is left or on allocation failure.
+  bool assign(const FrameView& frame, SnapshotRect rect);
+
+  const FrameLayout& layout() const { return layout_; }
+  FrameView view() { return make_frame_view(layout_, pixels_.data()); }
+  // What was copied, in frame pixels.
+  const SnapshotRect& rect() const { return rect_; }
+
+ private:
+  FrameLayout layout_;
+  SnapshotRect rect_ = {0, 0, 0, 0};
+  AlignedBuffer pixels_;
+};
+
+struct SnapshotInfo {
+  uint32_t source = 0;
+  // kNoTrack for frames and untracked objects.
+  uint64_t track_id = kNoTrack;
+  // -1 for whole frames.
+  int32_t class_id = -1;
+  float confidence = 0.0f;
+  // ns, -1 when unknown.
+  int64_t pts = -1;
+  // The crop in the frame it came from, as copied.
+  SnapshotRect rect = {0, 0, 0, 0};
+};
+
+// Crop of an object: its box grown by padding times its size on every
+// side.
+SnapshotRect snapshot_crop(const DetectedObject& object, float padding);
+
+struct TrackSnapshotConfig {
+  // Frames of its source a track may go unseen before it counts as ended.
+  int linger = 15;
+  // Frames after which a track still in view is handed out anyway; it is
+  // never handed out again. 0 waits for the track to end.
+  int max_age = 0;
+  float padding = 0.1f;
+  // Crops narrower or lower than this are not kept.
+  int min_size = 16;
+  // Classes to keep, all when empty.
+  std::vector<int32_t> classes;
+};
+
+struct SnapshotCandidate {
+  SnapshotInfo info;
+  SnapshotImage image;
+  float score = 0.0f;
+};
+
+// Best crop per (source, track). One producing thread.
+class TrackSnapshots {
+ public:
+  void configure(const TrackSnapshotConfig& config);
+  const TrackSnapshotConfig& config() const { return config_; }
+
+  // One frame of source: objects[i] with frame == index are its objects.
+  // Tracks of the source that ended are moved to the ready list.
+  void offer(uint32_t source, int64_t pts, const FrameView& frame,
+             const DetectedObject* objects, size_t n, uint32_t index);
+  // Ends every track, e.g. at end of stream.
+  void flush();
+  // Forgets every track without handing it out.
+  void reset();
+
+  // Appends the candidates ready to encode. Give their images back through
+  // recycle() once done with them.
+  void take(std::vector<SnapshotCandidate>* ready);
+  void recycle(SnapshotImage&& image);
+
+  size_t tracks() const;
+
+  // Higher is better: confidence times the square root of the crop area,
+  // halved when the box is cut by the frame edge.
+  static float score(const DetectedObject& object, int width, int height);
+
+ private:
+  struct Track {
+    SnapshotCandidate best;
+    bool have = false;
+    bool emitted = false;
+    uint64_t first_seen = 0;
+    uint64_t last_seen = 0;
+  };
+
+  struct Source {
+    uint64_t frame = 0;
+    std::unordered_map<uint64_t, Track> tracks;
+  };
+
+  bool wanted(int32_t class_id) const;
+  void emit(Track& track);
+  SnapshotImage take_image();
+
+  TrackSnapshotConfig config_;
+  std::unordered_map<uint32_t, Source> sources_;
+  std::vector<SnapshotCandidate> ready_;
+  std::vector<SnapshotImage> spare_;
+};
+
+// Compresses frames to JPEG. Not thread-safe; one per thread.
+class JpegEncoder {
+ public:
+  JpegEncoder();
+  ~JpegEncoder();
+
+  JpegEncoder(const JpegEncoder&) = delete;
+  JpegEncoder& operator=(const JpegEncoder&) = delete;
+
+  // Replaces *out with frame as a baseline JPEG of quality 1-100. False
+  // with a description in *error on failure.
+  bool encode(const FrameView& frame, int quality, std::vector<uint8_t>* out,
+              std::string* error);
+
+ private:
+  struct State;
+
+  bool compress(const FrameView& frame, int quality, std::vector<uint8_t>* out);
+  void write_yuv(const FrameView& frame);
+  void write_rgb(const FrameView& frame);
+
+  std::unique_ptr<State> state_;
+  // 16 luma and 2 x 8 chroma rows, padded to whole blocks.
+  std::vector<uint8_t> rows_;
+};
+
+struct SnapshotEncoderConfig {
+  int workers = 2;
+  // Job slots: snapshots queued, being encoded or waiting for collect().
+  int max_pending = 16;
+  int quality = 85;
+  // Longest side of the encoded image; larger crops are scaled down. 0
+  // keeps them as they are.
+  int max_size = 0;
+  // Keep finished jobs for collect(); otherwise they are recycled as soon
+  // as done() returns.
+  bool collect = false;
+  SimdLevel simd = SimdLevel::kAvx2;
+};
+
+struct SnapshotJob {
+  SnapshotInfo info;
+  SnapshotImage image;
+  // The worker writes the JPEG there when not empty.
+  std::string path;
+
+  // Set by the worker.
+  std::vector<uint8_t> jpeg;
+  int width = 0;
+  int height = 0;
+  // Empty on success.
+  std::string error;
+};
+
+class SnapshotEncoder {
+ public:
+  // Called on a worker thread for every finished job.
+  using Done = std::function<void(const SnapshotJob&)>;
+
+  SnapshotEncoder();
+  ~SnapshotEncoder();
+
+  SnapshotEncoder(const SnapshotEncoder&) = delete;
+  SnapshotEncoder& operator=(const SnapshotEncoder&) = delete;
+
+  // Restarts when running. Jobs still held by the caller stay valid.
+  bool start(const SnapshotEncoderConfig& config, Done done);
+  // Finishes the queued jobs and joins the workers; collectable jobs stay
+  // until collect().
+  void stop();
+  bool running() const { return !workers_.empty(); }
+  const SnapshotEncoderConfig& config() const { return config_; }
+
+  // Producing thread. A free job, or null when all are busy, in which case
+  // the snapshot counts as dropped. Fill info, image and path, then
+  // submit() or release() it.
+  SnapshotJob* acquire();
+  void submit(SnapshotJob* job);
+  void release(SnapshotJob* job);
+
+  // Moves finished jobs to *done, oldest first; release() each.
+  void collect(std::vector<SnapshotJob*>* done);
+
+  uint64_t encoded() const { return encoded_.load(std::memory_order_relaxed); }
+  uint64_t failed() const { return failed_.load(std::memory_order_relaxed); }
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Worker;
+
+  void run(Worker* worker);
+  void process(Worker* worker, SnapshotJob* job);
+
+  SnapshotEncoderConfig config_;
+  Done done_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  std::mutex lock_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+  std::vector<std::unique_ptr<SnapshotJob>> slots_;
+  std::vector<SnapshotJob*> free_;
+  std::deque<SnapshotJob*> queue_;
+  std::deque<SnapshotJob*> finished_;
+
+  std::atomic<uint64_t> encoded_{0};
+  std::atomic<uint64_t> failed_{0};
+  std::atomic<uint64_t> dropped_{0};
+};
+
+}  // namespace nvgst
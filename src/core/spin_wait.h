@@ -0,0 +1,94 @@
+// Waiting for a condition that one other thread makes true, without a lock
+// on the fast path. The waiter first spins on the condition for a while,
+// then parks on a condition variable; the notifier only takes the lock when
+// the waiter is actually parked, so a busy producer/consumer pair hands
+// items over with a couple of atomics.
+//
+// The spin budget adapts: it doubles (up to the limit) whenever the
+// condition came true while spinning and halves whenever the waiter had to
+// park anyway, so spinning mostly stops costing CPU when the other side is
+// slow. On single-CPU systems the default limit is 0, since the other
+// thread cannot make progress while this one spins.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace nvgst {
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// Pause iterations a waiter may spin for when not configured otherwise.
+inline int default_spin_limit() {
+  return std::thread::hardware_concurrency() > 1 ? 1024 : 0;
+}
+
+// One waiting thread; any thread may notify.
+class SpinWaiter {
+ public:
+  SpinWaiter() = default;
+  SpinWaiter(const SpinWaiter&) = delete;
+  SpinWaiter& operator=(const SpinWaiter&) = delete;
+
+  // Any thread; negative means default_spin_limit().
+  void set_spin_limit(int limit) {
+    limit_.store(limit < 0 ? default_spin_limit() : limit, std::memory_order_relaxed);
+  }
+  int spin_limit() const { return limit_.load(std::memory_order_relaxed); }
+
+  // Waiter side: returns once ready() is true. ready() must read state the
+  // notifier publishes before calling notify().
+  template <typename Ready>
+  void wait(const Ready& ready) {
+    const int limit = limit_.load(std::memory_order_relaxed);
+    const int budget = std::min(spin_, limit);
+    for (int i = 0; i < budget; i++) {
+      if (ready()) {
+        spin_ = std::min(std::max(spin_ * 2, kMinSpin), limit);
+        return;
+      }
+      cpu_relax();
+    }
+
+    std::unique_lock<std::mutex> guard(lock_);
+    parked_.store(true, std::memory_order_relaxed);
+    // Pairs with the fence in notify(): either the notifier sees parked_,
+    // or this thread sees the condition the notifier made true.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    cond_.wait(guard, ready);
+    parked_.store(false, std::memory_order_relaxed);
+    spin_ = std::min(std::max(budget / 2, kMinSpin), limit);
+  }
+
+  // Notifier side: call after making the condition true.
+  void notify() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!parked_.load(std::memory_order_relaxed))
+      return;
+    { std::lock_guard<std::mutex> guard(lock_); }
+    cond_.notify_one();
+  }
+
+ private:
+  // Floor of the adapted budget, so it can grow again.
+  static constexpr int kMinSpin = 16;
+
+  std::atomic<int> limit_{default_spin_limit()};
+  // Waiter thread only.
+  int spin_ = default_spin_limit();
+
+  std::atomic<bool> parked_{false};
+  std::mutex lock_;
+  std::condition_variable cond_;
+};
+
+}  // namespace nvgst
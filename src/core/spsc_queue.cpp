@@ -0,0 +1,125 @@
+#include "core/spsc_queue.h"
+
+namespace nvgst {
+
+bool SpscQueue::init(size_t capacity) {
+  if (capacity < 2 || !ring_.init(capacity))
+    return false;
+  buffers_.store(0, std::memory_order_relaxed);
+  bytes_.store(0, std::memory_order_relaxed);
+  in_time_.store(-1, std::memory_order_relaxed);
+  out_time_.store(-1, std::memory_order_relaxed);
+  return true;
+}
+
+void SpscQueue::set_limits(const QueueLimits& limits) {
+  max_buffers_.store(limits.buffers, std::memory_order_relaxed);
+  max_bytes_.store(limits.bytes, std::memory_order_relaxed);
+  max_time_.store(limits.time, std::memory_order_relaxed);
+  // Raised limits may let a waiting producer in.
+  not_full_.notify();
+}
+
+QueueLimits SpscQueue::limits() const {
+  QueueLimits limits;
+  limits.buffers = max_buffers_.load(std::memory_order_relaxed);
+  limits.bytes = max_bytes_.load(std::memory_order_relaxed);
+  limits.time = max_time_.load(std::memory_order_relaxed);
+  return limits;
+}
+
+uint64_t SpscQueue::time_level() const {
+  const int64_t in = in_time_.load(std::memory_order_relaxed);
+  const int64_t out = out_time_.load(std::memory_order_relaxed);
+  return in >= 0 && out >= 0 && in > out ? static_cast<uint64_t>(in - out) : 0;
+}
+
+QueueLevel SpscQueue::level() const {
+  return {buffers_.load(std::memory_order_relaxed), bytes_.load(std::memory_order_relaxed),
+          time_level()};
+}
+
+void SpscQueue::set_spin_limit(int limit) {
+  not_empty_.set_spin_limit(limit);
+  not_full_.set_spin_limit(limit);
+}
+
+void SpscQueue::set_flushing(bool flushing) {
+  flushing_.store(flushing, std::memory_order_release);
+  not_empty_.notify();
+  not_full_.notify();
+}
+
+// Levels are compared before adding the item, so one item larger than a
+// limit still goes into an empty queue.
+bool SpscQueue::fits(const Item& item) const {
+  if (ring_.size() >= ring_.capacity())
+    return false;
+  if (!item.counted)
+    return true;
+  const uint64_t max_buffers = max_buffers_.load(std::memory_order_relaxed);
+  const uint64_t max_bytes = max_bytes_.load(std::memory_order_relaxed);
+  const uint64_t max_time = max_time_.load(std::memory_order_relaxed);
+  return (max_buffers == 0 || buffers_.load(std::memory_order_relaxed) < max_buffers) &&
+         (max_bytes == 0 || bytes_.load(std::memory_order_relaxed) < max_bytes) &&
+         (max_time == 0 || time_level() < max_time);
+}
+
+bool SpscQueue::try_push(const Item& item) {
+  if (flushing() || !fits(item))
+    return false;
+
+  // Levels first, so the consumer never takes out more than went in.
+  if (item.counted) {
+    buffers_.fetch_add(1, std::memory_order_relaxed);
+    bytes_.fetch_add(item.bytes, std::memory_order_relaxed);
+    if (item.start >= 0) {
+      int64_t none = -1;
+      out_time_.compare_exchange_strong(none, item.start, std::memory_order_relaxed);
+    }
+    if (item.end >= 0)
+      in_time_.store(item.end, std::memory_order_relaxed);
+  }
+  ring_.try_push(item);
+  not_empty_.notify();
+  return true;
+}
+
+bool SpscQueue::push(const Item& item) {
+  while (!try_push(item)) {
+    if (flushing())
+      return false;
+    not_full_.wait([&] { return flushing() || fits(item); });
+  }
+  return true;
+}
+
+bool SpscQueue::try_pop(Item* item) {
+  while (popping_.exchange(true, std::memory_order_acquire))
+    cpu_relax();
+  const bool popped = ring_.try_pop(item);
+  popping_.store(false, std::memory_order_release);
+  if (!popped)
+    return false;
+
+  if (item->counted) {
+    buffers_.fetch_sub(1, std::memory_order_relaxed);
+    bytes_.fetch_sub(item->bytes, std::memory_order_relaxed);
+    if (item->end >= 0)
+      out_time_.store(item->end, std::memory_order_relaxed);
+  }
+  not_full_.notify();
+  return true;
+}
+
+bool SpscQueue::pop(Item* item) {
+  for (;;) {
+    if (flushing())
+      return false;
+    if (try_pop(item))
+      return true;
+    not_empty_.wait([this] { return flushing() || !ring_.empty(); });
+  }
+}
+
+}  // namespace nvgst
@@ -0,0 +1,113 @@
+// Bounded queue between one producing and one consuming thread, the core of
+// nvqueue. Items sit in an SpscRing and both sides wait with a SpinWaiter,
+// so handing an item over takes no lock unless the other side is asleep.
+//
+// Like GStreamer's queue, fullness is judged on levels rather than slots:
+// counted items (buffers) add to a buffer, byte and time level, and the
+// queue is full once any level reaches its limit. Uncounted items (events,
+// queries) only need a free slot. The time level is the running time
+// between the end of the newest item and the end of the last one popped,
+// or the start of the oldest one when nothing was popped yet.
+//
+// The ring is single-consumer, but the producer may take the consumer's
+// place for a moment to drop the oldest items (leaky downstream); a
+// one-word token that the consumer holds only while popping keeps the two
+// apart.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "core/spin_wait.h"
+#include "core/spsc_ring.h"
+
+namespace nvgst {
+
+// Limits of 0 are unlimited.
+struct QueueLimits {
+  uint64_t buffers = 200;
+  uint64_t bytes = 10 * 1024 * 1024;
+  uint64_t time = 1000000000;
+};
+
+struct QueueLevel {
+  uint64_t buffers;
+  uint64_t bytes;
+  uint64_t time;
+};
+
+class SpscQueue {
+ public:
+  struct Item {
+    void* object;
+    // Adds to the levels.
+    bool counted;
+    uint64_t bytes;
+    // Running time in ns, -1 when unknown.
+    int64_t start;
+    int64_t end;
+  };
+
+  SpscQueue() = default;
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  // Room for at least capacity items. Not thread-safe; call while neither
+  // side uses the queue.
+  bool init(size_t capacity);
+  size_t capacity() const { return ring_.capacity(); }
+
+  // Any thread.
+  void set_limits(const QueueLimits& limits);
+  QueueLimits limits() const;
+  QueueLevel level() const;
+  void set_spin_limit(int limit);
+
+  // Any thread: makes waiting and future push()/pop() calls fail until
+  // cleared.
+  void set_flushing(bool flushing);
+  bool flushing() const { return flushing_.load(std::memory_order_acquire); }
+
+  // Producer side. push() waits until the item fits and returns false when
+  // flushing; try_push() returns false at once instead of waiting.
+  bool push(const Item& item);
+  bool try_push(const Item& item);
+
+  // Consumer side: waits for an item and returns false when flushing.
+  bool pop(Item* item);
+  // Either side: the oldest item, or false at once when empty. The
+  // producer uses it to drop items on overflow.
+  bool try_pop(Item* item);
+
+  // Either side: removes every item, calling dispose on each.
+  template <typename Dispose>
+  void clear(const Dispose& dispose) {
+    Item item;
+    while (try_pop(&item))
+      dispose(item);
+    in_time_.store(-1, std::memory_order_relaxed);
+    out_time_.store(-1, std::memory_order_relaxed);
+  }
+
+ private:
+  bool fits(const Item& item) const;
+  uint64_t time_level() const;
+
+  SpscRing<Item> ring_;
+  std::atomic<bool> popping_{false};
+  SpinWaiter not_empty_;
+  SpinWaiter not_full_;
+  std::atomic<bool> flushing_{false};
+
+  std::atomic<uint64_t> max_buffers_{QueueLimits().buffers};
+  std::atomic<uint64_t> max_bytes_{QueueLimits().bytes};
+  std::atomic<uint64_t> max_time_{QueueLimits().time};
+
+  std::atomic<uint64_t> buffers_{0};
+  std::atomic<uint64_t> bytes_{0};
+  std::atomic<int64_t> in_time_{-1};
+  std::atomic<int64_t> out_time_{-1};
+};
+
+}  // namespace nvgst
@@ -0,0 +1,98 @@
+// Bounded single-producer single-consumer ring. Lock-free and wait-free on
+// both sides; each side caches the other's index so the shared cache lines
+// are only touched when the cached view says the ring is full or empty.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+#include "core/frame.h"
+
+namespace nvgst {
+
+template <typename T>
+class SpscRing {
+  static_assert(std::is_trivially_copyable<T>::value, "SpscRing holds trivially copyable values");
+
+ public:
+  SpscRing() = default;
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  // Allocates room for at least capacity items (rounded up to a power of
+  // two). Not thread-safe; call before either side uses the ring.
+  bool init(size_t capacity) {
+    size_t cap = 1;
+    while (cap < capacity)
+      cap <<= 1;
+    slots_.reset(new (std::nothrow) T[cap]);
+    if (!slots_)
+      return false;
+    mask_ = cap - 1;
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_relaxed);
+    cached_head_ = cached_tail_ = 0;
+    return true;
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+  // Producer side.
+  bool try_push(const T& value) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head - cached_tail_ > mask_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head - cached_tail_ > mask_)
+        return false;
+    }
+    slots_[head & mask_] = value;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side.
+  bool try_pop(T* value) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == cached_head_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail == cached_head_)
+        return false;
+    }
+    *value = slots_[tail & mask_];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side: pops up to max items, returns how many.
+  size_t pop_bulk(T* out, size_t max) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    cached_head_ = head_.load(std::memory_order_acquire);
+    size_t n = cached_head_ - tail;
+    if (n > max)
+      n = max;
+    for (size_t i = 0; i < n; i++)
+      out[i] = slots_[(tail + i) & mask_];
+    tail_.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+  // Either side; exact only when the other side is idle.
+  size_t size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+
+ private:
+  std::unique_ptr<T[]> slots_;
+  size_t mask_ = 0;
+
+  alignas(kFrameAlign) std::atomic<size_t> head_{0};
+  size_t cached_tail_ = 0;
+
+  alignas(kFrameAlign) std::atomic<size_t> tail_{0};
+  size_t cached_head_ = 0;
+};
+
+}  // namespace nvgst
@@ -0,0 +1,41 @@
+#include "core/tensor.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "core/frame.h"
+
+namespace nvgst {
+
+TensorPool::~TensorPool() {
+  for (float* block : free_)
+    std::free(block);
+}
+
+std::shared_ptr<float> TensorPool::acquire() {
+  float* block = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (!free_.empty()) {
+      block = free_.back();
+      free_.pop_back();
+    }
+  }
+  if (block == nullptr) {
+    const size_t bytes =
+        align_up(std::max<size_t>(count_, 1) * sizeof(float), static_cast<size_t>(kFrameAlign));
+    block = static_cast<float*>(std::aligned_alloc(kFrameAlign, bytes));
+    if (block == nullptr)
+      return nullptr;
+  }
+
+  std::shared_ptr<TensorPool> self = shared_from_this();
+  return std::shared_ptr<float>(block, [self](float* b) { self->release(b); });
+}
+
+void TensorPool::release(float* block) {
+  std::lock_guard<std::mutex> guard(lock_);
+  free_.push_back(block);
+}
+
+}  // namespace nvgst
@@ -0,0 +1,63 @@
+// Float tensors passed between the inference engine and the elements that
+// read its outputs. Data is reference counted, so the outputs of one
+// request can be handed to several buffers (and downstream elements)
+// without copying, and comes from a TensorPool, so a steady stream of
+// requests reuses the same blocks.
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nvgst {
+
+struct TensorInfo {
+  std::string name;
+  std::vector<int> shape;
+
+  size_t count() const {
+    size_t n = 1;
+    for (int d : shape)
+      n *= static_cast<size_t>(d);
+    return n;
+  }
+};
+
+// A dense row-major float tensor. For request outputs the first dimension
+// is the batch.
+struct Tensor {
+  TensorInfo info;
+  std::shared_ptr<float> data;
+};
+
+// Recycles fixed-size, aligned float blocks. Blocks are returned when the
+// last shared_ptr to them goes away, from any thread; they keep the pool
+// alive until then.
+class TensorPool : public std::enable_shared_from_this<TensorPool> {
+ public:
+  static std::shared_ptr<TensorPool> create(size_t count) {
+    return std::shared_ptr<TensorPool>(new TensorPool(count));
+  }
+  ~TensorPool();
+
+  TensorPool(const TensorPool&) = delete;
+  TensorPool& operator=(const TensorPool&) = delete;
+
+  size_t count() const { return count_; }
+
+  // A block of count() floats with undefined contents, or null when
+  // allocation fails.
+  std::shared_ptr<float> acquire();
+
+ private:
+  explicit TensorPool(size_t count) : count_(count) {}
+  void release(float* block);
+
+  const size_t count_;
+  std::mutex lock_;
+  std::vector<float*> free_;
+};
+
+}  // namespace nvgst
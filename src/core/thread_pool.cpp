@@ -0,0 +1,84 @@
+#include "core/thread_pool.h"
+
+#include <system_error>
+
+namespace nvgst {
+
+bool ThreadPool::start(int threads) {
+  if (threads < 1)
+    return false;
+  if (threads == size())
+    return true;
+
+  stop();
+  stopping_ = false;
+  try {
+    for (int i = 1; i < threads; i++)
+      workers_.emplace_back(&ThreadPool::work, this, i, generation_);
+  } catch (const std::system_error&) {
+    stop();
+    return false;
+  }
+  return true;
+}
+
+void ThreadPool::stop() {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread& t : workers_)
+    t.join();
+  workers_.clear();
+}
+
+void ThreadPool::drain(int worker) {
+  for (int i = next_.fetch_add(1, std::memory_order_relaxed); i < tasks_;
+       i = next_.fetch_add(1, std::memory_order_relaxed))
+    (*task_)(i, worker);
+}
+
+void ThreadPool::run(int tasks, const Task& task) {
+  if (tasks <= 0)
+    return;
+  if (workers_.empty() || tasks == 1) {
+    for (int i = 0; i < tasks; i++)
+      task(i, 0);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    task_ = &task;
+    tasks_ = tasks;
+    next_.store(0, std::memory_order_relaxed);
+    busy_ = static_cast<int>(workers_.size());
+    generation_++;
+  }
+  wake_.notify_all();
+  drain(0);
+
+  std::unique_lock<std::mutex> guard(lock_);
+  done_.wait(guard, [this] { return busy_ == 0; });
+  task_ = nullptr;
+}
+
+// seen is the generation at start, so a new worker does not mistake the
+// last job of an earlier set of workers for a new one.
+void ThreadPool::work(int worker, uint64_t seen) {
+  std::unique_lock<std::mutex> guard(lock_);
+  for (;;) {
+    wake_.wait(guard, [&] { return stopping_ || generation_ != seen; });
+    if (stopping_)
+      return;
+    seen = generation_;
+    guard.unlock();
+    drain(worker);
+    guard.lock();
+    if (--busy_ == 0)
+      done_.notify_one();
+  }
+}
+
+}  // namespace nvgst
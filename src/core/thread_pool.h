@@ -0,0 +1,58 @@
+// Fixed set of threads for data-parallel work on the streaming thread:
+// run() splits a job into tasks that the workers and the calling thread
+// take in order from a shared counter, and returns once all are done. Each
+// call passes a worker index, so callers keep one scratch area per worker
+// and never allocate inside a task.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nvgst {
+
+class ThreadPool {
+ public:
+  using Task = std::function<void(int task, int worker)>;
+
+  ThreadPool() = default;
+  ~ThreadPool() { stop(); }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Starts threads - 1 workers; the caller of run() is worker 0. Restarts
+  // when the count changes.
+  bool start(int threads);
+  void stop();
+
+  // Workers including the calling thread, at least 1.
+  int size() const { return static_cast<int>(workers_.size()) + 1; }
+
+  // Calls task(i, worker) for i in [0, tasks) and waits for all of them.
+  // Not reentrant: one caller at a time.
+  void run(int tasks, const Task& task);
+
+ private:
+  void work(int worker, uint64_t seen);
+  void drain(int worker);
+
+  std::mutex lock_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  std::vector<std::thread> workers_;
+  bool stopping_ = false;
+  // Bumped per run() so sleeping workers see a new job.
+  uint64_t generation_ = 0;
+  const Task* task_ = nullptr;
+  int tasks_ = 0;
+  std::atomic<int> next_{0};
+  // Workers still inside the current job.
+  int busy_ = 0;
+};
+
+}  // namespace nvgst
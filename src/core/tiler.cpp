@@ -0,0 +1,220 @@
+#include "core/tiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace nvgst {
+
+namespace {
+
+// Destinations remembered at once; a pool larger than this just redraws
+// more often.
+constexpr size_t kMaxDestinations = 16;
+
+inline uint8_t* row_ptr(const FrameView& f, int y) {
+  return f.data[0] + static_cast<ptrdiff_t>(y) * f.stride[0];
+}
+
+}  // namespace
+
+void tile_grid_shape(int n_tiles, int* rows, int* columns) {
+  n_tiles = std::max(n_tiles, 1);
+  if (*rows <= 0 && *columns <= 0)
+    *columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(n_tiles))));
+  if (*columns <= 0)
+    *columns = (n_tiles + *rows - 1) / *rows;
+  if (*rows <= 0)
+    *rows = (n_tiles + *columns - 1) / *columns;
+}
+
+bool TileCompositor::configure(const TilerConfig& config) {
+  if (config.format != PixelFormat::kRGBA && config.format != PixelFormat::kBGRx)
+    return false;
+  if (config.rows <= 0 || config.columns <= 0 || config.width < config.columns ||
+      config.height < config.rows)
+    return false;
+
+  config_ = config;
+  kernels_ = &simd::kernels(config.simd);
+
+  const uint8_t r = (config.background >> 16) & 0xff;
+  const uint8_t g = (config.background >> 8) & 0xff;
+  const uint8_t b = config.background & 0xff;
+  const uint8_t pixel[4] = {config.format == PixelFormat::kRGBA ? r : b, g,
+                            config.format == PixelFormat::kRGBA ? b : r, 0xff};
+  std::memcpy(&background_pixel_, pixel, sizeof(pixel));
+
+  // Even split; tiles differ by at most one pixel in each direction.
+  tiles_.clear();
+  for (int row = 0; row < config.rows; row++) {
+    for (int col = 0; col < config.columns; col++) {
+      TileRect rect;
+      rect.x = col * config.width / config.columns;
+      rect.y = row * config.height / config.rows;
+      rect.width = (col + 1) * config.width / config.columns - rect.x;
+      rect.height = (row + 1) * config.height / config.rows - rect.y;
+      tiles_.push_back(rect);
+    }
+  }
+
+  layers_.clear();
+  stack_.clear();
+  stack_.reserve(16);
+  drawn_gen_.clear();
+  tile_gen_.assign(tiles_.size(), ++next_gen_);
+  return true;
+}
+
+void TileCompositor::reset() {
+  tiles_.clear();
+  layers_.clear();
+  stack_.clear();
+  drawn_gen_.clear();
+  tile_gen_.clear();
+}
+
+bool TileCompositor::set_layer(int id, const TileLayerConfig& config) {
+  remove_layer(id);
+  if (config.tile < 0 || config.tile >= n_tiles() || config.alpha < 0 || config.alpha > 255)
+    return false;
+
+  auto layer = std::make_unique<Layer>();
+  const TileRect& rect = tiles_[config.tile];
+  const bool has_alpha = config.format == PixelFormat::kRGBA;
+
+  layer->config = config;
+  layer->opaque = config.alpha == 255 && !has_alpha;
+
+  // Translucent layers are scaled into scratch first. RGBA keeps its alpha
+  // there, so a BGRx destination swaps red and blue while blending instead.
+  ConvertConfig cc;
+  cc.in_format = config.format;
+  cc.in_width = config.width;
+  cc.in_height = config.height;
+  cc.out_format = layer->opaque || !has_alpha ? config_.format : PixelFormat::kRGBA;
+  cc.out_width = rect.width;
+  cc.out_height = rect.height;
+  cc.matrix = config.matrix;
+  cc.simd = config_.simd;
+  if (!layer->converter.configure(cc))
+    return false;
+
+  if (!layer->opaque) {
+    layer->swap_rb = cc.out_format != config_.format;
+    layer->scratch_layout = make_frame_layout(cc.out_format, rect.width, rect.height);
+    if (!layer->scratch.reserve(layer->scratch_layout.size))
+      return false;
+  }
+
+  layers_[id] = std::move(layer);
+  mark_dirty(config.tile);
+  return true;
+}
+
+void TileCompositor::remove_layer(int id) {
+  auto it = layers_.find(id);
+  if (it == layers_.end())
+    return;
+  if (it->second->has_frame)
+    mark_dirty(it->second->config.tile);
+  layers_.erase(it);
+}
+
+void TileCompositor::set_frame(int id, const FrameView& frame) {
+  auto it = layers_.find(id);
+  if (it == layers_.end())
+    return;
+  it->second->frame = frame;
+  it->second->has_frame = true;
+  mark_dirty(it->second->config.tile);
+}
+
+void TileCompositor::invalidate() {
+  drawn_gen_.clear();
+}
+
+void TileCompositor::mark_dirty(int tile) {
+  tile_gen_[tile] = ++next_gen_;
+}
+
+int TileCompositor::render(const FrameView& dst) {
+  const int n = n_tiles();
+  int drawn = 0;
+
+  if (!config_.skip_unchanged) {
+    for (int t = 0; t < n; t++)
+      draw_tile(dst, t);
+    return n;
+  }
+
+  auto it = drawn_gen_.find(dst.data[0]);
+  if (it == drawn_gen_.end()) {
+    if (drawn_gen_.size() >= kMaxDestinations)
+      drawn_gen_.clear();
+    it = drawn_gen_.emplace(dst.data[0], std::vector<uint64_t>(n, 0)).first;
+  }
+  std::vector<uint64_t>& seen = it->second;
+
+  for (int t = 0; t < n; t++) {
+    if (seen[t] == tile_gen_[t])
+      continue;
+    draw_tile(dst, t);
+    seen[t] = tile_gen_[t];
+    drawn++;
+  }
+  return drawn;
+}
+
+FrameView TileCompositor::tile_view(const FrameView& dst, int tile) const {
+  const TileRect& rect = tiles_[tile];
+  FrameView view;
+  view.format = dst.format;
+  view.width = rect.width;
+  view.height = rect.height;
+  view.data[0] = row_ptr(dst, rect.y) + 4 * rect.x;
+  view.stride[0] = dst.stride[0];
+  return view;
+}
+
+void TileCompositor::fill_background(const FrameView& view) const {
+  for (int y = 0; y < view.height; y++) {
+    uint8_t* row = row_ptr(view, y);
+    for (int x = 0; x < view.width; x++)
+      std::memcpy(row + 4 * x, &background_pixel_, 4);
+  }
+}
+
+void TileCompositor::draw_tile(const FrameView& dst, int tile) {
+  const FrameView view = tile_view(dst, tile);
+
+  // Layers are keyed by id, so this walks the tile's stack bottom to top.
+  stack_.clear();
+  size_t first = 0;
+  for (auto& entry : layers_) {
+    Layer* layer = entry.second.get();
+    if (layer->config.tile != tile || !layer->has_frame || layer->config.alpha == 0)
+      continue;
+    if (layer->opaque)
+      first = stack_.size();
+    stack_.push_back(layer);
+  }
+
+  if (stack_.empty() || !stack_[first]->opaque)
+    fill_background(view);
+
+  for (size_t i = first; i < stack_.size(); i++) {
+    Layer* layer = stack_[i];
+    if (layer->opaque) {
+      layer->converter.convert(layer->frame, view);
+      continue;
+    }
+    const FrameView scratch = make_frame_view(layer->scratch_layout, layer->scratch.data());
+    layer->converter.convert(layer->frame, scratch);
+    for (int y = 0; y < view.height; y++)
+      kernels_->blend_row(row_ptr(scratch, y), row_ptr(view, y), view.width, layer->config.alpha,
+                          layer->swap_rb);
+  }
+}
+
+}  // namespace nvgst
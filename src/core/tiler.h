@@ -0,0 +1,119 @@
+// Grid compositor behind nvtiler: layers are scaled straight into their
+// tile of an RGBA or BGRx frame, opaque layers without any intermediate
+// copy, translucent ones through a per-layer scratch tile and
+// Kernels::blend_row.
+//
+// A tile is redrawn only when it changed since the destination last saw
+// it. Destinations are told apart by their first plane pointer, so a
+// recycled pool buffer keeps the tiles it was last rendered with and only
+// the stale ones are drawn again.
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "core/aligned_buffer.h"
+#include "core/convert.h"
+#include "core/frame.h"
+
+namespace nvgst {
+
+struct TileRect {
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+};
+
+// Fills in rows and/or columns when they are 0: the most square grid with
+// at least n_tiles cells, wider than tall when it cannot be square.
+void tile_grid_shape(int n_tiles, int* rows, int* columns);
+
+struct TilerConfig {
+  PixelFormat format = PixelFormat::kRGBA;  // kRGBA or kBGRx
+  int width = 0;
+  int height = 0;
+  int rows = 1;
+  int columns = 1;
+  uint32_t background = 0;  // 0xRRGGBB
+  // When false every tile is drawn into every destination.
+  bool skip_unchanged = false;
+  SimdLevel simd = SimdLevel::kAvx2;
+};
+
+struct TileLayerConfig {
+  int tile = 0;
+  PixelFormat format = PixelFormat::kUnknown;
+  int width = 0;
+  int height = 0;
+  ColorMatrix matrix = ColorMatrix::kBT601;
+  // Layer opacity in [0, 255], multiplied with per-pixel alpha of RGBA
+  // layers. Other formats are opaque at 255.
+  int alpha = 255;
+};
+
+class TileCompositor {
+ public:
+  // Drops all layers and forgets every destination.
+  bool configure(const TilerConfig& config);
+  // Drops all layers and the grid; render() draws nothing until the next
+  // configure().
+  void reset();
+
+  const TilerConfig& config() const { return config_; }
+  int n_tiles() const { return static_cast<int>(tiles_.size()); }
+  const TileRect& tile(int index) const { return tiles_[index]; }
+
+  // Adds or replaces a layer. Layers sharing a tile are stacked in
+  // ascending id order; layers below an opaque one are not drawn at all.
+  // The layer has no frame until set_frame(). Fails when the tile is
+  // outside the grid or the conversion is unsupported.
+  bool set_layer(int id, const TileLayerConfig& config);
+  void remove_layer(int id);
+
+  // Marks a new frame for a layer. The view is read by render() and must
+  // stay valid until it is replaced or the layer is removed.
+  void set_frame(int id, const FrameView& frame);
+
+  // Draws the tiles dst does not have up to date and returns how many were
+  // drawn.
+  int render(const FrameView& dst);
+
+  // Forgets every destination, so the next render() draws all tiles.
+  void invalidate();
+
+ private:
+  struct Layer {
+    TileLayerConfig config;
+    bool opaque = true;
+    bool swap_rb = false;
+    VideoConverter converter;
+    FrameLayout scratch_layout;
+    AlignedBuffer scratch;
+    FrameView frame;
+    bool has_frame = false;
+  };
+
+  void mark_dirty(int tile);
+  FrameView tile_view(const FrameView& dst, int tile) const;
+  void fill_background(const FrameView& view) const;
+  void draw_tile(const FrameView& dst, int tile);
+
+  TilerConfig config_;
+  const simd::Kernels* kernels_ = &simd::kernels(SimdLevel::kScalar);
+  uint32_t background_pixel_ = 0;
+  std::vector<TileRect> tiles_;
+  std::map<int, std::unique_ptr<Layer>> layers_;
+  std::vector<Layer*> stack_;
+
+  // Generation of each tile's content; a destination is up to date for a
+  // tile when it recorded the same generation.
+  std::vector<uint64_t> tile_gen_;
+  uint64_t next_gen_ = 0;
+  std::unordered_map<const uint8_t*, std::vector<uint64_t>> drawn_gen_;
+};
+
+}  // namespace nvgst
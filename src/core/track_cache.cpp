@@ -0,0 +1,161 @@
+#include "core/track_cache.h"
+
+#include <algorithm>
+
+namespace nvgst {
+
+namespace {
+
+constexpr int kMaxCapacity = 1 << 24;
+
+uint32_t source_of(uint64_t track_id) {
+  return static_cast<uint32_t>(track_id >> 32);
+}
+
+bool cacheable(uint64_t track_id) {
+  return track_id != kNoTrack && source_of(track_id) < kMaxCacheSources;
+}
+
+// Track ids of one source are consecutive; mix them so neighbours do not
+// fill one probe run (MurmurHash3 finalizer).
+uint64_t mix(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33;
+  return x;
+}
+
+}  // namespace
+
+bool TrackCache::configure(const TrackCacheConfig& config) {
+  if (config.capacity <= 0 || config.capacity > kMaxCapacity)
+    return false;
+  if (!(config.min_confidence >= 0.0f) || !(config.max_area_ratio >= 1.0f))
+    return false;
+
+  size_t slots = 1;
+  while (slots < static_cast<size_t>(config.capacity) * 2)
+    slots <<= 1;
+  if (slots != keys_.size()) {
+    keys_.assign(slots, kNoTrack);
+    results_.assign(slots, TrackResult());
+    mask_ = slots - 1;
+    size_ = 0;
+  }
+  config_ = config;
+  return true;
+}
+
+void TrackCache::clear() {
+  std::fill(keys_.begin(), keys_.end(), kNoTrack);
+  clocks_.clear();
+  size_ = 0;
+}
+
+size_t TrackCache::slot_of(uint64_t track_id) const {
+  return static_cast<size_t>(mix(track_id)) & mask_;
+}
+
+size_t TrackCache::find(uint64_t track_id) const {
+  for (size_t i = slot_of(track_id);; i = (i + 1) & mask_) {
+    if (keys_[i] == track_id)
+      return i;
+    if (keys_[i] == kNoTrack)
+      return mask_ + 1;
+  }
+}
+
+// Backward-shift deletion: walks the probe run after the hole and moves
+// back every entry whose home slot does not lie between the hole and
+// itself, so lookups never stop early at the hole.
+void TrackCache::erase(size_t slot) {
+  size_t hole = slot;
+  for (size_t i = (slot + 1) & mask_; keys_[i] != kNoTrack; i = (i + 1) & mask_) {
+    const size_t home = slot_of(keys_[i]);
+    const bool stays = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+    if (stays)
+      continue;
+    keys_[hole] = keys_[i];
+    results_[hole] = results_[i];
+    hole = i;
+  }
+  keys_[hole] = kNoTrack;
+  size_--;
+}
+
+const TrackResult* TrackCache::lookup(const DetectedObject& object, uint64_t now) {
+  if (keys_.empty() || !cacheable(object.track_id))
+    return nullptr;
+
+  const uint32_t source = source_of(object.track_id);
+  if (source >= clocks_.size())
+    clocks_.resize(source + 1, 0);
+  clocks_[source] = now;
+
+  const size_t slot = find(object.track_id);
+  if (slot > mask_)
+    return nullptr;
+
+  TrackResult& result = results_[slot];
+  result.seen = now;
+  if (now > result.time && now - result.time > config_.max_age)
+    return nullptr;
+  if (result.confidence < config_.min_confidence)
+    return nullptr;
+  const float area = object.width * object.height;
+  if (area > result.area * config_.max_area_ratio || area * config_.max_area_ratio < result.area)
+    return nullptr;
+  return &result;
+}
+
+bool TrackCache::store(const DetectedObject& object, int32_t label, float confidence,
+                       uint64_t time) {
+  if (keys_.empty() || !cacheable(object.track_id))
+    return false;
+
+  size_t slot = find(object.track_id);
+  if (slot > mask_) {
+    if (size_ >= config_.capacity)
+      expire();
+    if (size_ >= config_.capacity)
+      return false;
+    for (slot = slot_of(object.track_id); keys_[slot] != kNoTrack; slot = (slot + 1) & mask_) {
+    }
+    keys_[slot] = object.track_id;
+    results_[slot].seen = time;
+    size_++;
+  }
+
+  TrackResult& result = results_[slot];
+  result.label = label;
+  result.confidence = confidence;
+  result.area = object.width * object.height;
+  result.time = time;
+  if (time > result.seen)
+    result.seen = time;
+  return true;
+}
+
+int TrackCache::expire() {
+  int dropped = 0;
+  // An erase may move a later entry into slot i, so i only advances past
+  // an entry that stays.
+  for (size_t i = 0; i < keys_.size();) {
+    if (keys_[i] != kNoTrack) {
+      const uint32_t source = source_of(keys_[i]);
+      const uint64_t now = source < clocks_.size() ? clocks_[source] : 0;
+      const uint64_t seen = results_[i].seen;
+      if (now > seen && now - seen > config_.track_timeout) {
+        erase(i);
+        dropped++;
+        continue;
+      }
+    }
+    i++;
+  }
+  return dropped;
+}
+
+}  // namespace nvgst
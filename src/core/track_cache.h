@@ -0,0 +1,94 @@
+// Secondary classifier results per track, so a tracked object is sent to
+// the classifier again only when its result got old, its box changed size
+// a lot or the classifier was unsure, instead of on every frame.
+//
+// Open addressing with linear probing over a power-of-two table: the keys
+// (track ids, never kNoTrack) sit in their own array so a probe touches
+// one cache line for several slots, results in a parallel array, and
+// deletion shifts the rest of the probe run back instead of leaving
+// tombstones, so the table does not degrade as tracks come and go.
+//
+// Tracks end without notice, so every entry remembers when its track was
+// last looked up, and expire() drops those not seen for track_timeout.
+// Time is per source (the upper 32 bits of a track id, see TrackerConfig)
+// and only ever compared within one source, so streams with unrelated
+// timelines age on their own. Sources from kMaxCacheSources up are not
+// cached.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "core/objects.h"
+
+namespace nvgst {
+
+constexpr uint32_t kMaxCacheSources = 4096;
+
+struct TrackCacheConfig {
+  // Times are in the caller's unit; the defaults assume nanoseconds.
+  // Results older than this are recomputed.
+  uint64_t max_age = 2000000000;
+  // Results below this confidence are recomputed.
+  float min_confidence = 0.5f;
+  // Results are recomputed when the box area grew or shrank by more than
+  // this factor since, as the object is seen at a different size.
+  float max_area_ratio = 1.5f;
+  // Entries of tracks not looked up for this long are expired.
+  uint64_t track_timeout = 2000000000;
+  // Most entries held; the table has at least twice as many slots.
+  int capacity = 4096;
+};
+
+struct TrackResult {
+  int32_t label = 0;
+  float confidence = 0.0f;
+  // Box size the result was computed on.
+  float area = 0.0f;
+  // When the result was computed, and when the track was last looked up.
+  uint64_t time = 0;
+  uint64_t seen = 0;
+};
+
+// Not thread-safe.
+class TrackCache {
+ public:
+  // Drops every entry when the capacity changes.
+  bool configure(const TrackCacheConfig& config);
+  const TrackCacheConfig& config() const { return config_; }
+
+  void clear();
+
+  // Marks the object's track as seen at now and returns its result when
+  // it can be reused, or nullptr when the object needs classifying.
+  const TrackResult* lookup(const DetectedObject& object, uint64_t now);
+
+  // Stores the result computed for the object on its frame at time.
+  // Returns false when the cache is full even after expiring, in which
+  // case the result is not kept.
+  bool store(const DetectedObject& object, int32_t label, float confidence, uint64_t time);
+
+  // Drops the entries whose track was not looked up for track_timeout,
+  // measured against the latest time looked up on its source. Returns the
+  // number dropped.
+  int expire();
+
+  int size() const { return size_; }
+
+ private:
+  size_t slot_of(uint64_t track_id) const;
+  // Slot holding track_id, or mask_ + 1.
+  size_t find(uint64_t track_id) const;
+  void erase(size_t slot);
+
+  TrackCacheConfig config_;
+  size_t mask_ = 0;
+  int size_ = 0;
+  std::vector<uint64_t> keys_;  // kNoTrack marks a free slot
+  std::vector<TrackResult> results_;
+  // Latest time looked up, by source.
+  std::vector<uint64_t> clocks_;
+};
+
+}  // namespace nvgst
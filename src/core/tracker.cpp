@@ -0,0 +1,201 @@
+#include "core/tracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace nvgst {
+
+namespace {
+
+// Standard deviations of position and velocity noise, relative to the box
+// height (DeepSORT's values).
+constexpr float kStdPos = 1.0f / 20.0f;
+constexpr float kStdVel = 1.0f / 160.0f;
+
+}  // namespace
+
+bool ObjectTracker::configure(const TrackerConfig& config) {
+  if (!(config.iou_threshold > 0.0f && config.iou_threshold <= 1.0f))
+    return false;
+  if (config.max_age < 0 || config.min_hits < 1)
+    return false;
+
+  config_ = config;
+  kernels_ = &simd::kernels(config.simd);
+  return true;
+}
+
+void ObjectTracker::reset() {
+  size_ = 0;
+  resize(0);
+}
+
+int ObjectTracker::confirmed() const {
+  int n = 0;
+  for (int t = 0; t < size_; t++)
+    n += id_[t] != kNoTrack;
+  return n;
+}
+
+void ObjectTracker::resize(int n) {
+  for (Axis& axis : axes_) {
+    axis.pos.resize(n);
+    axis.vel.resize(n);
+    axis.p00.resize(n);
+    axis.p01.resize(n);
+    axis.p11.resize(n);
+  }
+  scale_.resize(n);
+  x0_.resize(n);
+  y0_.resize(n);
+  x1_.resize(n);
+  y1_.resize(n);
+  class_id_.resize(n);
+  hits_.resize(n);
+  misses_.resize(n);
+  id_.resize(n);
+}
+
+void ObjectTracker::move_track(int from, int to) {
+  for (Axis& axis : axes_) {
+    axis.pos[to] = axis.pos[from];
+    axis.vel[to] = axis.vel[from];
+    axis.p00[to] = axis.p00[from];
+    axis.p01[to] = axis.p01[from];
+    axis.p11[to] = axis.p11[from];
+  }
+  scale_[to] = scale_[from];
+  class_id_[to] = class_id_[from];
+  hits_[to] = hits_[from];
+  misses_[to] = misses_[from];
+  id_[to] = id_[from];
+}
+
+void ObjectTracker::add_track(const DetectedObject& object) {
+  const int t = size_++;
+  resize(size_);
+
+  const float h = std::max(object.height, 1.0f);
+  const float z[kAxes] = {object.x + object.width * 0.5f, object.y + object.height * 0.5f,
+                          object.width, object.height};
+  for (int a = 0; a < kAxes; a++) {
+    axes_[a].pos[t] = z[a];
+    axes_[a].vel[t] = 0.0f;
+    axes_[a].p00[t] = (2.0f * kStdPos * h) * (2.0f * kStdPos * h);
+    axes_[a].p01[t] = 0.0f;
+    axes_[a].p11[t] = (10.0f * kStdVel * h) * (10.0f * kStdVel * h);
+  }
+  scale_[t] = h;
+  class_id_[t] = object.class_id;
+  hits_[t] = 1;
+  misses_[t] = 0;
+  id_[t] = kNoTrack;
+}
+
+void ObjectTracker::predict() {
+  const Axis& height = axes_[kHeight];
+  for (int t = 0; t < size_; t++)
+    scale_[t] = std::max(height.pos[t], 1.0f);
+
+  for (Axis& axis : axes_) {
+    kernels_->kalman_predict(axis.pos.data(), axis.vel.data(), axis.p00.data(), axis.p01.data(),
+                             axis.p11.data(), scale_.data(), kStdPos * kStdPos,
+                             kStdVel * kStdVel, size_);
+  }
+
+  const float* cx = axes_[kCenterX].pos.data();
+  const float* cy = axes_[kCenterY].pos.data();
+  const float* w = axes_[kWidth].pos.data();
+  const float* h = axes_[kHeight].pos.data();
+  for (int t = 0; t < size_; t++) {
+    const float hw = std::max(w[t], 0.0f) * 0.5f;
+    const float hh = std::max(h[t], 0.0f) * 0.5f;
+    x0_[t] = cx[t] - hw;
+    y0_[t] = cy[t] - hh;
+    x1_[t] = cx[t] + hw;
+    y1_[t] = cy[t] + hh;
+  }
+}
+
+void ObjectTracker::update(DetectedObject* const* objects, int n) {
+  predict();
+
+  // Detections are rows, tracks columns.
+  score_.resize(static_cast<size_t>(n) * size_);
+  for (int d = 0; d < n; d++) {
+    const DetectedObject& o = *objects[d];
+    const float box[4] = {o.x, o.y, o.x + o.width, o.y + o.height};
+    float* row = score_.data() + static_cast<size_t>(d) * size_;
+    kernels_->iou_row(x0_.data(), y0_.data(), x1_.data(), y1_.data(), size_, box, row);
+    if (config_.class_aware) {
+      for (int t = 0; t < size_; t++)
+        row[t] = class_id_[t] == o.class_id ? row[t] : 0.0f;
+    }
+  }
+  det_match_.resize(n);
+  solver_.solve(score_.data(), n, size_, config_.iou_threshold, config_.association,
+                det_match_.data());
+
+  // Unmatched tracks are updated with an infinitely noisy measurement,
+  // which leaves their prediction as it is.
+  track_match_.assign(size_, -1);
+  r_.assign(size_, INFINITY);
+  for (int a = 0; a < kAxes; a++)
+    z_[a].assign(axes_[a].pos.begin(), axes_[a].pos.begin() + size_);
+  for (int d = 0; d < n; d++) {
+    const int t = det_match_[d];
+    if (t < 0)
+      continue;
+    const DetectedObject& o = *objects[d];
+    track_match_[t] = d;
+    z_[kCenterX][t] = o.x + o.width * 0.5f;
+    z_[kCenterY][t] = o.y + o.height * 0.5f;
+    z_[kWidth][t] = o.width;
+    z_[kHeight][t] = o.height;
+    r_[t] = (kStdPos * scale_[t]) * (kStdPos * scale_[t]);
+  }
+  for (int a = 0; a < kAxes; a++) {
+    Axis& axis = axes_[a];
+    kernels_->kalman_update(axis.pos.data(), axis.vel.data(), axis.p00.data(), axis.p01.data(),
+                            axis.p11.data(), z_[a].data(), r_.data(), size_);
+  }
+
+  for (int d = 0; d < n; d++)
+    objects[d]->track_id = kNoTrack;
+  for (int t = 0; t < size_; t++) {
+    const int d = track_match_[t];
+    if (d < 0) {
+      misses_[t]++;
+      continue;
+    }
+    hits_[t]++;
+    misses_[t] = 0;
+    class_id_[t] = objects[d]->class_id;
+    if (id_[t] == kNoTrack && hits_[t] >= config_.min_hits)
+      id_[t] = config_.id_base | next_id_++;
+    objects[d]->track_id = id_[t];
+  }
+
+  // Tentative tracks die on their first miss, confirmed ones after
+  // max_age. Removal swaps the last track in, so track order is not kept.
+  for (int t = 0; t < size_;) {
+    const bool dead = id_[t] == kNoTrack ? misses_[t] > 0 : misses_[t] > config_.max_age;
+    if (dead)
+      move_track(--size_, t);
+    else
+      t++;
+  }
+  resize(size_);
+
+  for (int d = 0; d < n; d++) {
+    if (det_match_[d] >= 0)
+      continue;
+    add_track(*objects[d]);
+    if (config_.min_hits <= 1) {
+      id_[size_ - 1] = config_.id_base | next_id_++;
+      objects[d]->track_id = id_[size_ - 1];
+    }
+  }
+}
+
+}  // namespace nvgst
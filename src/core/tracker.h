@@ -0,0 +1,98 @@
+// Multi-object tracker behind nvtracker, one instance per source. Tracks
+// are kept structure-of-arrays: every box coordinate (center x, center y,
+// width, height) has its own constant-velocity Kalman filter, with state
+// and covariance terms in separate arrays, so predicting and correcting all
+// tracks is a handful of Kernels::kalman_* calls and the IoU matrix one
+// Kernels::iou_row call per detection.
+//
+// Noise is relative to the box height, as in SORT/DeepSORT, so the filters
+// behave the same for near and far objects. New tracks are tentative until
+// they have been matched min_hits frames in a row, get their id when
+// confirmed, and are dropped after max_age frames without a match.
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/assignment.h"
+#include "core/kernels.h"
+#include "core/objects.h"
+
+namespace nvgst {
+
+struct TrackerConfig {
+  // Detections only continue a track whose predicted box overlaps them by
+  // at least this much.
+  float iou_threshold = 0.3f;
+  // Frames a confirmed track survives without a match.
+  int max_age = 30;
+  // Consecutive matches that confirm a track; 1 confirms on sight.
+  int min_hits = 3;
+  AssignmentMethod association = AssignmentMethod::kHungarian;
+  // Only match detections to tracks of the same class.
+  bool class_aware = true;
+  // Or'ed into every id, to keep ids of different sources apart.
+  uint64_t id_base = 0;
+  SimdLevel simd = SimdLevel::kAvx2;
+};
+
+class ObjectTracker {
+ public:
+  // May be called between updates; existing tracks are kept.
+  bool configure(const TrackerConfig& config);
+  const TrackerConfig& config() const { return config_; }
+
+  // Drops all tracks; ids keep counting.
+  void reset();
+
+  // Advances every track by one frame and matches it against the n
+  // detections of that frame. Writes the track id of each detection that
+  // continues a confirmed track, and kNoTrack to all others.
+  void update(DetectedObject* const* objects, int n);
+
+  int tracks() const { return size_; }
+  int confirmed() const;
+
+ private:
+  // One Kalman filter per track over one box coordinate.
+  struct Axis {
+    std::vector<float> pos;
+    std::vector<float> vel;
+    std::vector<float> p00;
+    std::vector<float> p01;
+    std::vector<float> p11;
+  };
+  enum { kCenterX, kCenterY, kWidth, kHeight, kAxes };
+
+  void predict();
+  void add_track(const DetectedObject& object);
+  void move_track(int from, int to);
+  void resize(int n);
+
+  TrackerConfig config_;
+  const simd::Kernels* kernels_ = nullptr;
+  AssignmentSolver solver_;
+  uint64_t next_id_ = 1;
+  int size_ = 0;
+
+  Axis axes_[kAxes];
+  std::vector<float> scale_;  // height the noise is relative to
+  // Predicted corners, what detections are matched against.
+  std::vector<float> x0_;
+  std::vector<float> y0_;
+  std::vector<float> x1_;
+  std::vector<float> y1_;
+  std::vector<int32_t> class_id_;
+  std::vector<int> hits_;
+  std::vector<int> misses_;
+  std::vector<uint64_t> id_;  // kNoTrack while tentative
+
+  // Per frame scratch.
+  std::vector<float> score_;
+  std::vector<int> det_match_;
+  std::vector<int> track_match_;
+  std::vector<float> z_[kAxes];
+  std::vector<float> r_;
+};
+
+}  // namespace nvgst
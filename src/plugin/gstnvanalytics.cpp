@@ -0,0 +1,694 @@
+/**
+ * SECTION:element-nvanalytics
+ *
+ * Counts line crossings, zone occupancy and dwell time for the tracked
+ * objects of a #GstNvObjectMeta, and attaches the events and counts of
+ * every frame as a #GstNvAnalyticsMeta. Place it behind nvtracker.
+ *
+ * Lines and zones come from the key file at
+ * #GstNvAnalytics:config-location, one group per line or zone:
+ * |[
+ * [line:entrance]
+ * points=100,620;1180,620
+ * # both, positive (ending on the right of the line as drawn) or negative
+ * direction=positive
+ * # class ids counted, all when missing
+ * classes=0
+ *
+ * [zone:checkout-1]
+ * points=200,300;480,300;480,560;200,560
+ * # seconds inside after which a dwell event is raised once per visit
+ * dwell-time=30
+ * # batch source ids the group applies to, all when missing
+ * sources=0,2
+ * ]|
+ *
+ * Coordinates are pixels of the frame. Objects count by one anchor point
+ * of their box, see #GstNvAnalytics:anchor. Each source keeps its lines
+ * and zones in a uniform grid, so an object is only tested against the
+ * lines and zones near it however many a scene has. Times are the PTS of
+ * each frame; frames without one are skipped. Counts start over when the
+ * configuration changes. Only the meta is changed; frames are never
+ * mapped, and buffers without a #GstNvObjectMeta pass through.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 filesrc location=store.mp4 ! decodebin ! nvconvert ! \
+ *     video/x-raw,format=NV12 ! nvinfer ! nvpostprocess ! nvtracker ! \
+ *     nvanalytics config-location=store.ini ! fakesink
+ * ]|
+ */
+
+#include "gstnvanalytics.h"
+#include "gstnvanalyticsmeta.h"
+#include "gstnvbatchmeta.h"
+#include "gstnvobjectmeta.h"
+#include "gstnvutils.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_analytics_debug);
+#define GST_CAT_DEFAULT gst_nv_analytics_debug
+
+#define DEFAULT_ANCHOR GST_NV_ANALYTICS_ANCHOR_BOTTOM_CENTER
+#define DEFAULT_CELL_SIZE 64.0f
+#define DEFAULT_TRACK_TIMEOUT (2 * GST_SECOND)
+
+enum
+{
+  PROP_0,
+  PROP_CONFIG_LOCATION,
+  PROP_ANCHOR,
+  PROP_CELL_SIZE,
+  PROP_TRACK_TIMEOUT,
+};
+
+#define NV_ANALYTICS_CAPS \
+  "video/x-raw; " GST_NV_BATCH_CAPS_MAKE (GST_VIDEO_FORMATS_ALL)
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_ANALYTICS_CAPS));
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_ANALYTICS_CAPS));
+
+struct GstNvAnalyticsRois
+{
+  /* every line and zone, with the anchor, cell size and timeout */
+  nvgst::AnalyticsConfig config;
+  /* per line and zone, the sources it applies to; empty for all */
+  std::vector < std::vector < gint > >line_sources;
+  std::vector < std::vector < gint > >zone_sources;
+};
+
+struct GstNvAnalyticsSource
+{
+  nvgst::RoiAnalytics analytics;
+  std::vector < GQuark > line_names;
+  std::vector < GQuark > zone_names;
+};
+
+GType
+gst_nv_analytics_anchor_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_NV_ANALYTICS_ANCHOR_BOTTOM_CENTER,
+        "Middle of the bottom edge, where the object stands", "bottom-center"},
+    {GST_NV_ANALYTICS_ANCHOR_CENTER, "Center of the box", "center"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = g_enum_register_static ("GstNvAnalyticsAnchor", values);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+#define gst_nv_analytics_parent_class parent_class
+G_DEFINE_TYPE (GstNvAnalytics, gst_nv_analytics, GST_TYPE_BASE_TRANSFORM);
+GST_ELEMENT_REGISTER_DEFINE (nvanalytics, "nvanalytics", GST_RANK_NONE,
+    GST_TYPE_NV_ANALYTICS);
+
+static void gst_nv_analytics_finalize (GObject * object);
+static void gst_nv_analytics_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_analytics_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static gboolean gst_nv_analytics_stop (GstBaseTransform * trans);
+static gboolean gst_nv_analytics_set_caps (GstBaseTransform * trans,
+    GstCaps * incaps, GstCaps * outcaps);
+static gboolean gst_nv_analytics_sink_event (GstBaseTransform * trans,
+    GstEvent * event);
+static GstFlowReturn gst_nv_analytics_transform_ip (GstBaseTransform * trans,
+    GstBuffer * buffer);
+
+static void
+gst_nv_analytics_class_init (GstNvAnalyticsClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_analytics_debug, "nvanalytics", 0,
+      "nvanalytics element");
+
+  gobject_class->finalize = gst_nv_analytics_finalize;
+  gobject_class->set_property = gst_nv_analytics_set_property;
+  gobject_class->get_property = gst_nv_analytics_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_CONFIG_LOCATION,
+      g_param_spec_string ("config-location", "Config location",
+          "Key file with one [line:NAME] or [zone:NAME] group per line or "
+          "zone", NULL,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_ANCHOR,
+      g_param_spec_enum ("anchor", "Anchor",
+          "Point of the box that crosses lines and enters zones",
+          GST_TYPE_NV_ANALYTICS_ANCHOR, DEFAULT_ANCHOR,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CELL_SIZE,
+      g_param_spec_float ("cell-size", "Cell size",
+          "Side in pixels of the grid cells lines and zones are indexed by",
+          1.0f, 4096.0f, DEFAULT_CELL_SIZE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_TRACK_TIMEOUT,
+      g_param_spec_uint64 ("track-timeout", "Track timeout",
+          "Nanoseconds a track may go unseen on its source before it leaves "
+          "its zones",
+          0, G_MAXUINT64, DEFAULT_TRACK_TIMEOUT,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV ROI analytics", "Filter/Analyzer/Video",
+      "Line crossing, zone occupancy and dwell time for tracked objects, "
+      "with lines and zones indexed in a uniform grid per source",
+      "nv_gst_plugins developers");
+
+  trans_class->stop = GST_DEBUG_FUNCPTR (gst_nv_analytics_stop);
+  trans_class->set_caps = GST_DEBUG_FUNCPTR (gst_nv_analytics_set_caps);
+  trans_class->sink_event = GST_DEBUG_FUNCPTR (gst_nv_analytics_sink_event);
+  trans_class->transform_ip =
+      GST_DEBUG_FUNCPTR (gst_nv_analytics_transform_ip);
+  trans_class->passthrough_on_same_caps = FALSE;
+
+  gst_type_mark_as_plugin_api (GST_TYPE_NV_ANALYTICS_ANCHOR,
+      (GstPluginAPIFlags) 0);
+}
+
+static void
+gst_nv_analytics_init (GstNvAnalytics * self)
+{
+  self->anchor = DEFAULT_ANCHOR;
+  self->cell_size = DEFAULT_CELL_SIZE;
+  self->track_timeout = DEFAULT_TRACK_TIMEOUT;
+  self->reconfigure = TRUE;
+  self->batched = FALSE;
+  self->rois = new GstNvAnalyticsRois ();
+  self->sources =
+      new std::unordered_map < guint, GstNvAnalyticsSource > ();
+  self->frame_objects = new std::vector < const nvgst::DetectedObject * >();
+  self->events = new std::vector < nvgst::AnalyticsEvent > ();
+
+  gst_base_transform_set_in_place (GST_BASE_TRANSFORM (self), TRUE);
+}
+
+static void
+gst_nv_analytics_finalize (GObject * object)
+{
+  GstNvAnalytics *self = GST_NV_ANALYTICS (object);
+
+  g_free (self->config_location);
+  delete self->events;
+  delete self->frame_objects;
+  delete self->sources;
+  delete self->rois;
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_analytics_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvAnalytics *self = GST_NV_ANALYTICS (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_CONFIG_LOCATION:
+      g_free (self->config_location);
+      self->config_location = g_value_dup_string (value);
+      break;
+    case PROP_ANCHOR:
+      self->anchor = (GstNvAnalyticsAnchor) g_value_get_enum (value);
+      break;
+    case PROP_CELL_SIZE:
+      self->cell_size = g_value_get_float (value);
+      break;
+    case PROP_TRACK_TIMEOUT:
+      self->track_timeout = g_value_get_uint64 (value);
+      break;
+    default:
+      GST_OBJECT_UNLOCK (self);
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      return;
+  }
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_analytics_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstNvAnalytics *self = GST_NV_ANALYTICS (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_CONFIG_LOCATION:
+      g_value_set_string (value, self->config_location);
+      break;
+    case PROP_ANCHOR:
+      g_value_set_enum (value, self->anchor);
+      break;
+    case PROP_CELL_SIZE:
+      g_value_set_float (value, self->cell_size);
+      break;
+    case PROP_TRACK_TIMEOUT:
+      g_value_set_uint64 (value, self->track_timeout);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static gboolean
+gst_nv_analytics_stop (GstBaseTransform * trans)
+{
+  GstNvAnalytics *self = GST_NV_ANALYTICS (trans);
+
+  self->sources->clear ();
+
+  return TRUE;
+}
+
+static gboolean
+gst_nv_analytics_set_caps (GstBaseTransform * trans, GstCaps * incaps,
+    GstCaps * outcaps)
+{
+  GstNvAnalytics *self = GST_NV_ANALYTICS (trans);
+  GstCapsFeatures *features = gst_caps_get_features (incaps, 0);
+
+  self->batched = features != NULL &&
+      gst_caps_features_contains (features, GST_CAPS_FEATURE_META_GST_NV_BATCH);
+
+  return TRUE;
+}
+
+/* After a flush the objects jump, so tracks start over; counts are kept. */
+static gboolean
+gst_nv_analytics_sink_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstNvAnalytics *self = GST_NV_ANALYTICS (trans);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+    for (auto & entry : *self->sources)
+      entry.second.analytics.clear_tracks ();
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->sink_event (trans, event);
+}
+
+/* "x,y;x,y;..." in pixels; FALSE on bad input. */
+static gboolean
+gst_nv_analytics_parse_points (const gchar * str,
+    std::vector < nvgst::AnalyticsPoint > *points)
+{
+  gchar **entries;
+  gboolean ok = TRUE;
+
+  points->clear ();
+  if (str == NULL)
+    return FALSE;
+
+  entries = g_strsplit (str, ";", -1);
+  for (gint i = 0; ok && entries[i] != NULL; i++) {
+    gchar *s = g_strstrip (entries[i]);
+    gchar *end;
+    nvgst::AnalyticsPoint point;
+
+    /* tolerate a trailing separator */
+    if (*s == '\0' && entries[i + 1] == NULL)
+      break;
+    point.x = (gfloat) g_ascii_strtod (s, &end);
+    ok = end != s && *end == ',';
+    if (ok) {
+      s = end + 1;
+      point.y = (gfloat) g_ascii_strtod (s, &end);
+      while (g_ascii_isspace (*end))
+        end++;
+      ok = end != s && *end == '\0';
+    }
+    if (ok)
+      points->push_back (point);
+  }
+  g_strfreev (entries);
+
+  return ok;
+}
+
+/* Reads one [line:NAME] or [zone:NAME] group into @rois. */
+static gboolean
+gst_nv_analytics_parse_group (GstNvAnalytics * self, GKeyFile * file,
+    const gchar * group, GstNvAnalyticsRois * rois)
+{
+  gboolean is_line = g_str_has_prefix (group, "line:");
+  const gchar *name = group + 5;
+  std::vector < nvgst::AnalyticsPoint > points;
+  std::vector < gint > classes, sources;
+  gchar *value;
+  gboolean ok;
+
+  if (*name == '\0') {
+    GST_ERROR_OBJECT (self, "[%s] has no name", group);
+    return FALSE;
+  }
+
+  value = g_key_file_get_string (file, group, "points", NULL);
+  ok = gst_nv_analytics_parse_points (value, &points) &&
+      (is_line ? points.size () == 2 : points.size () >= 3);
+  g_free (value);
+  if (!ok) {
+    GST_ERROR_OBJECT (self, "[%s] needs points=x,y;x,y%s", group,
+        is_line ? "" : ";x,y;...");
+    return FALSE;
+  }
+
+  value = g_key_file_get_string (file, group, "classes", NULL);
+  ok = gst_nv_parse_class_ids (value, &classes);
+  g_free (value);
+  value = g_key_file_get_string (file, group, "sources", NULL);
+  ok = ok && gst_nv_parse_class_ids (value, &sources);
+  g_free (value);
+  if (!ok) {
+    GST_ERROR_OBJECT (self, "[%s] classes and sources must be id lists",
+        group);
+    return FALSE;
+  }
+
+  if (is_line) {
+    nvgst::AnalyticsLine line;
+
+    line.name = name;
+    line.a = points[0];
+    line.b = points[1];
+    line.classes.assign (classes.begin (), classes.end ());
+    value = g_key_file_get_string (file, group, "direction", NULL);
+    if (value == NULL || g_strcmp0 (value, "both") == 0) {
+      line.direction = nvgst::LineDirection::kBoth;
+    } else if (g_strcmp0 (value, "positive") == 0) {
+      line.direction = nvgst::LineDirection::kPositive;
+    } else if (g_strcmp0 (value, "negative") == 0) {
+      line.direction = nvgst::LineDirection::kNegative;
+    } else {
+      GST_ERROR_OBJECT (self, "[%s] direction must be both, positive or "
+          "negative", group);
+      g_free (value);
+      return FALSE;
+    }
+    g_free (value);
+    rois->config.lines.push_back (line);
+    rois->line_sources.push_back (sources);
+  } else {
+    nvgst::AnalyticsZone zone;
+
+    zone.name = name;
+    zone.polygon = points;
+    zone.classes.assign (classes.begin (), classes.end ());
+    if (g_key_file_has_key (file, group, "dwell-time", NULL)) {
+      gdouble seconds = g_key_file_get_double (file, group, "dwell-time",
+          NULL);
+
+      if (!(seconds >= 0.0)) {
+        GST_ERROR_OBJECT (self, "[%s] dwell-time must be seconds", group);
+        return FALSE;
+      }
+      zone.dwell_threshold = (guint64) (seconds * GST_SECOND);
+    }
+    rois->config.zones.push_back (zone);
+    rois->zone_sources.push_back (sources);
+  }
+
+  return TRUE;
+}
+
+/* Loads every line and zone of @location; NULL on errors. */
+static GstNvAnalyticsRois *
+gst_nv_analytics_load_rois (GstNvAnalytics * self, const gchar * location)
+{
+  GstNvAnalyticsRois *rois = new GstNvAnalyticsRois ();
+  GKeyFile *file = g_key_file_new ();
+  GError *error = NULL;
+  gchar **groups;
+  gboolean ok = TRUE;
+
+  if (!g_key_file_load_from_file (file, location, G_KEY_FILE_NONE, &error)) {
+    GST_ERROR_OBJECT (self, "cannot read %s: %s", location, error->message);
+    g_clear_error (&error);
+    g_key_file_free (file);
+    delete rois;
+    return NULL;
+  }
+
+  groups = g_key_file_get_groups (file, NULL);
+  for (gint i = 0; ok && groups[i] != NULL; i++) {
+    if (g_str_has_prefix (groups[i], "line:") ||
+        g_str_has_prefix (groups[i], "zone:"))
+      ok = gst_nv_analytics_parse_group (self, file, groups[i], rois);
+    else
+      GST_WARNING_OBJECT (self, "ignoring group [%s] of %s", groups[i],
+          location);
+  }
+  g_strfreev (groups);
+  g_key_file_free (file);
+
+  if (!ok) {
+    delete rois;
+    return NULL;
+  }
+  return rois;
+}
+
+/* Takes property changes into the lines and zones, reloading the config
+ * file. Sources are rebuilt on their next frame, so tracks and counts
+ * start over. Returns FALSE when the file cannot be used. */
+static gboolean
+gst_nv_analytics_apply_config (GstNvAnalytics * self)
+{
+  GstNvAnalyticsRois *rois;
+  nvgst::RoiAnalytics check;
+  gchar *location;
+  GstNvAnalyticsAnchor anchor;
+  gfloat cell_size;
+  guint64 track_timeout;
+
+  GST_OBJECT_LOCK (self);
+  if (!self->reconfigure) {
+    GST_OBJECT_UNLOCK (self);
+    return TRUE;
+  }
+  location = g_strdup (self->config_location);
+  anchor = self->anchor;
+  cell_size = self->cell_size;
+  track_timeout = self->track_timeout;
+  self->reconfigure = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  if (location == NULL) {
+    GST_WARNING_OBJECT (self, "no config-location, nothing to analyze");
+    rois = new GstNvAnalyticsRois ();
+  } else {
+    rois = gst_nv_analytics_load_rois (self, location);
+  }
+  if (rois == NULL) {
+    g_free (location);
+    return FALSE;
+  }
+
+  rois->config.anchor = anchor == GST_NV_ANALYTICS_ANCHOR_CENTER ?
+      nvgst::AnalyticsAnchor::kCenter : nvgst::AnalyticsAnchor::kBottomCenter;
+  rois->config.cell_size = cell_size;
+  rois->config.track_timeout = track_timeout;
+  /* catches degenerate lines before any source needs them */
+  if (!check.configure (rois->config)) {
+    GST_ERROR_OBJECT (self, "%s has a line with both points equal",
+        location);
+    g_free (location);
+    delete rois;
+    return FALSE;
+  }
+
+  delete self->rois;
+  self->rois = rois;
+  self->sources->clear ();
+
+  GST_INFO_OBJECT (self, "%" G_GSIZE_FORMAT " lines and %" G_GSIZE_FORMAT
+      " zones from %s, track timeout %" GST_TIME_FORMAT,
+      rois->config.lines.size (), rois->config.zones.size (),
+      GST_STR_NULL (location), GST_TIME_ARGS (track_timeout));
+  g_free (location);
+
+  return TRUE;
+}
+
+static gboolean
+gst_nv_analytics_applies (const std::vector < gint > &sources,
+    guint source_id)
+{
+  if (sources.empty ())
+    return TRUE;
+  for (gint id : sources) {
+    if (id >= 0 && (guint) id == source_id)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+/* The analytics of source_id, with the lines and zones that apply to it. */
+static GstNvAnalyticsSource &
+gst_nv_analytics_get_source (GstNvAnalytics * self, guint source_id)
+{
+  const GstNvAnalyticsRois *rois = self->rois;
+  auto it = self->sources->find (source_id);
+
+  if (it == self->sources->end ()) {
+    nvgst::AnalyticsConfig config = rois->config;
+    GstNvAnalyticsSource source;
+
+    config.lines.clear ();
+    config.zones.clear ();
+    for (gsize i = 0; i < rois->config.lines.size (); i++) {
+      if (gst_nv_analytics_applies (rois->line_sources[i], source_id)) {
+        config.lines.push_back (rois->config.lines[i]);
+        source.line_names.push_back (g_quark_from_string (rois->config.
+                lines[i].name.c_str ()));
+      }
+    }
+    for (gsize i = 0; i < rois->config.zones.size (); i++) {
+      if (gst_nv_analytics_applies (rois->zone_sources[i], source_id)) {
+        config.zones.push_back (rois->config.zones[i]);
+        source.zone_names.push_back (g_quark_from_string (rois->config.
+                zones[i].name.c_str ()));
+      }
+    }
+    /* a subset of a config that configured fine */
+    source.analytics.configure (config);
+
+    GST_DEBUG_OBJECT (self, "source %u: %" G_GSIZE_FORMAT " lines, %"
+        G_GSIZE_FORMAT " zones", source_id, config.lines.size (),
+        config.zones.size ());
+    it = self->sources->emplace (source_id, std::move (source)).first;
+  }
+
+  return it->second;
+}
+
+/* Analyzes the objects of frame frame_index with the analytics of
+ * source_id and adds its events and counts to @ameta. */
+static void
+gst_nv_analytics_analyze_frame (GstNvAnalytics * self,
+    GstNvAnalyticsMeta * ameta, const nvgst::ObjectList * objects,
+    guint frame_index, guint source_id, GstClockTime time)
+{
+  std::vector < const nvgst::DetectedObject *>&frame = *self->frame_objects;
+  std::vector < nvgst::AnalyticsEvent > &events = *self->events;
+  GstNvAnalyticsSource & source =
+      gst_nv_analytics_get_source (self, source_id);
+  const std::vector < nvgst::AnalyticsCount > &line_counts =
+      source.analytics.line_counts ();
+  const std::vector < nvgst::AnalyticsCount > &zone_counts =
+      source.analytics.zone_counts ();
+
+  if (!GST_CLOCK_TIME_IS_VALID (time)) {
+    GST_LOG_OBJECT (self, "frame %u has no PTS, skipped", frame_index);
+    return;
+  }
+  if (source.line_names.empty () && source.zone_names.empty ())
+    return;
+
+  frame.clear ();
+  for (const nvgst::DetectedObject & object : *objects) {
+    if (object.frame == frame_index)
+      frame.push_back (&object);
+  }
+
+  events.clear ();
+  source.analytics.update (frame.data (), (int) frame.size (), time, &events);
+
+  for (const nvgst::AnalyticsEvent & e : events) {
+    GstNvAnalyticsEvent event;
+
+    switch (e.type) {
+      case nvgst::AnalyticsEventType::kLineCrossed:
+        event.type = GST_NV_ANALYTICS_LINE_CROSSED;
+        break;
+      case nvgst::AnalyticsEventType::kZoneEntered:
+        event.type = GST_NV_ANALYTICS_ZONE_ENTERED;
+        break;
+      case nvgst::AnalyticsEventType::kZoneExited:
+        event.type = GST_NV_ANALYTICS_ZONE_EXITED;
+        break;
+      default:
+        event.type = GST_NV_ANALYTICS_DWELL;
+        break;
+    }
+    event.frame = frame_index;
+    event.roi = e.type == nvgst::AnalyticsEventType::kLineCrossed ?
+        source.line_names[e.roi] : source.zone_names[e.roi];
+    event.track_id = e.track_id;
+    event.object = e.object < 0 ? -1 : (gint) (frame[e.object] -
+        objects->data ());
+    event.direction = e.direction;
+    event.duration = e.duration;
+    ameta->events->push_back (event);
+  }
+
+  for (gsize i = 0; i < line_counts.size (); i++)
+    ameta->counts->push_back ({frame_index, source.line_names[i], FALSE, 0,
+          line_counts[i].in, line_counts[i].out});
+  for (gsize i = 0; i < zone_counts.size (); i++)
+    ameta->counts->push_back ({frame_index, source.zone_names[i], TRUE,
+          zone_counts[i].occupancy, zone_counts[i].in, zone_counts[i].out});
+}
+
+static GstFlowReturn
+gst_nv_analytics_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
+{
+  GstNvAnalytics *self = GST_NV_ANALYTICS (trans);
+  GstNvObjectMeta *ometa = gst_buffer_get_nv_object_meta (buffer);
+  GstNvAnalyticsMeta *ameta;
+  GstNvBatchMeta *bmeta;
+
+  if (ometa == NULL)
+    return GST_FLOW_OK;
+
+  if (!gst_nv_analytics_apply_config (self)) {
+    GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS, (NULL),
+        ("invalid analytics configuration"));
+    return GST_FLOW_ERROR;
+  }
+  if (self->rois->config.lines.empty () && self->rois->config.zones.empty ())
+    return GST_FLOW_OK;
+
+  ameta = gst_buffer_add_nv_analytics_meta (buffer);
+
+  if (!self->batched) {
+    gst_nv_analytics_analyze_frame (self, ameta, ometa->objects, 0, 0,
+        GST_BUFFER_PTS (buffer));
+  } else {
+    bmeta = gst_buffer_get_nv_batch_meta (buffer);
+    if (bmeta == NULL) {
+      GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
+          ("batched buffer without GstNvBatchMeta"));
+      return GST_FLOW_ERROR;
+    }
+    for (guint i = 0; i < bmeta->n_frames; i++)
+      gst_nv_analytics_analyze_frame (self, ameta, ometa->objects, i,
+          bmeta->frames[i].source_id, bmeta->frames[i].pts);
+  }
+
+  GST_LOG_OBJECT (self, "%" G_GSIZE_FORMAT " events for %" G_GSIZE_FORMAT
+      " objects", ameta->events->size (), ometa->objects->size ());
+
+  return GST_FLOW_OK;
+}
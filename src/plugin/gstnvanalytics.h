@@ -0,0 +1,71 @@
+#ifndef __GST_NV_ANALYTICS_H__
+#define __GST_NV_ANALYTICS_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include <gst/video/video.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "core/analytics.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+  GST_NV_ANALYTICS_ANCHOR_BOTTOM_CENTER,
+  GST_NV_ANALYTICS_ANCHOR_CENTER,
+} GstNvAnalyticsAnchor;
+
+#define GST_TYPE_NV_ANALYTICS_ANCHOR (gst_nv_analytics_anchor_get_type ())
+GType gst_nv_analytics_anchor_get_type (void);
+
+#define GST_TYPE_NV_ANALYTICS \
+  (gst_nv_analytics_get_type())
+#define GST_NV_ANALYTICS(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_ANALYTICS,GstNvAnalytics))
+#define GST_NV_ANALYTICS_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_ANALYTICS,GstNvAnalyticsClass))
+#define GST_IS_NV_ANALYTICS(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_ANALYTICS))
+
+typedef struct _GstNvAnalytics GstNvAnalytics;
+typedef struct _GstNvAnalyticsClass GstNvAnalyticsClass;
+
+/* Lines and zones of the config file, and the sources each applies to. */
+struct GstNvAnalyticsRois;
+/* Analytics and ROI names of one source. */
+struct GstNvAnalyticsSource;
+
+struct _GstNvAnalytics
+{
+  GstBaseTransform parent;
+
+  /* properties, protected by the object lock */
+  gchar *config_location;
+  GstNvAnalyticsAnchor anchor;
+  gfloat cell_size;
+  guint64 track_timeout;
+  gboolean reconfigure;
+
+  /* streaming thread only */
+  gboolean batched;
+  GstNvAnalyticsRois *rois;
+  /* one analytics instance per source id; single frames use source 0 */
+  std::unordered_map<guint, GstNvAnalyticsSource> *sources;
+  std::vector<const nvgst::DetectedObject *> *frame_objects;
+  std::vector<nvgst::AnalyticsEvent> *events;
+};
+
+struct _GstNvAnalyticsClass
+{
+  GstBaseTransformClass parent_class;
+};
+
+GType gst_nv_analytics_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvanalytics);
+
+G_END_DECLS
+
+#endif /* __GST_NV_ANALYTICS_H__ */
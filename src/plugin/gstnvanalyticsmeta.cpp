@@ -0,0 +1,87 @@
+#include "gstnvanalyticsmeta.h"
+
+GType
+gst_nv_analytics_meta_api_get_type (void)
+{
+  static GType type = 0;
+  static const gchar *tags[] = { GST_META_TAG_VIDEO_STR, NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = gst_meta_api_type_register ("GstNvAnalyticsMetaAPI", tags);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+static gboolean
+gst_nv_analytics_meta_init (GstMeta * meta, gpointer params,
+    GstBuffer * buffer)
+{
+  GstNvAnalyticsMeta *ameta = (GstNvAnalyticsMeta *) meta;
+
+  ameta->events = new std::vector < GstNvAnalyticsEvent > ();
+  ameta->counts = new std::vector < GstNvAnalyticsCount > ();
+
+  return TRUE;
+}
+
+static void
+gst_nv_analytics_meta_free (GstMeta * meta, GstBuffer * buffer)
+{
+  GstNvAnalyticsMeta *ameta = (GstNvAnalyticsMeta *) meta;
+
+  delete ameta->events;
+  delete ameta->counts;
+  ameta->events = NULL;
+  ameta->counts = NULL;
+}
+
+/* Events point at objects of the object meta, so the meta goes where it
+ * goes: full copies only. */
+static gboolean
+gst_nv_analytics_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstNvAnalyticsMeta *src = (GstNvAnalyticsMeta *) meta;
+  GstNvAnalyticsMeta *ameta;
+  GstMetaTransformCopy *copy;
+
+  if (!GST_META_TRANSFORM_IS_COPY (type))
+    return FALSE;
+
+  copy = (GstMetaTransformCopy *) data;
+  if (copy->region)
+    return FALSE;
+
+  ameta = gst_buffer_add_nv_analytics_meta (dest);
+  if (ameta == NULL)
+    return FALSE;
+
+  *ameta->events = *src->events;
+  *ameta->counts = *src->counts;
+
+  return TRUE;
+}
+
+const GstMetaInfo *
+gst_nv_analytics_meta_get_info (void)
+{
+  static const GstMetaInfo *info = NULL;
+
+  if (g_once_init_enter (&info)) {
+    const GstMetaInfo *tmp =
+        gst_meta_register (GST_NV_ANALYTICS_META_API_TYPE,
+        "GstNvAnalyticsMeta", sizeof (GstNvAnalyticsMeta),
+        gst_nv_analytics_meta_init, gst_nv_analytics_meta_free,
+        gst_nv_analytics_meta_transform);
+    g_once_init_leave (&info, tmp);
+  }
+  return info;
+}
+
+GstNvAnalyticsMeta *
+gst_buffer_add_nv_analytics_meta (GstBuffer * buffer)
+{
+  return (GstNvAnalyticsMeta *) gst_buffer_add_meta (buffer,
+      GST_NV_ANALYTICS_META_INFO, NULL);
+}
@@ -0,0 +1,94 @@
+/* Line crossings, zone visits and counts found by nvanalytics. */
+#ifndef __GST_NV_ANALYTICS_META_H__
+#define __GST_NV_ANALYTICS_META_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include <vector>
+
+G_BEGIN_DECLS
+
+typedef enum {
+  GST_NV_ANALYTICS_LINE_CROSSED,
+  GST_NV_ANALYTICS_ZONE_ENTERED,
+  GST_NV_ANALYTICS_ZONE_EXITED,
+  GST_NV_ANALYTICS_DWELL,
+} GstNvAnalyticsEventType;
+
+typedef struct _GstNvAnalyticsEvent GstNvAnalyticsEvent;
+typedef struct _GstNvAnalyticsCount GstNvAnalyticsCount;
+typedef struct _GstNvAnalyticsMeta GstNvAnalyticsMeta;
+
+/**
+ * GstNvAnalyticsEvent:
+ * @type: what happened
+ * @frame: frame index in a batch, 0 on single frames
+ * @roi: name of the line or zone
+ * @track_id: the object's track
+ * @object: index of the object in the buffer's #GstNvObjectMeta, or -1
+ *     when the track left a zone by not being seen for track-timeout
+ * @direction: line crossings: 1 when the object ended on the right of the
+ *     line as drawn from its first point to its second, -1 on its left
+ * @duration: exits and dwell: time since the track entered the zone
+ */
+struct _GstNvAnalyticsEvent
+{
+  GstNvAnalyticsEventType type;
+  guint frame;
+  GQuark roi;
+  guint64 track_id;
+  gint object;
+  gint direction;
+  GstClockTime duration;
+};
+
+/**
+ * GstNvAnalyticsCount:
+ * @frame: frame index in a batch, 0 on single frames
+ * @roi: name of the line or zone
+ * @zone: whether @roi is a zone
+ * @occupancy: zones: objects inside on this frame
+ * @in: lines: positive crossings; zones: entries, since the configuration
+ *     was loaded
+ * @out: lines: negative crossings; zones: exits
+ */
+struct _GstNvAnalyticsCount
+{
+  guint frame;
+  GQuark roi;
+  gboolean zone;
+  guint occupancy;
+  guint64 in;
+  guint64 out;
+};
+
+/**
+ * GstNvAnalyticsMeta:
+ * @meta: parent #GstMeta
+ * @events: events of the buffer's frames, owned by the meta
+ * @counts: per frame, one entry for every line and zone of its source,
+ *     owned by the meta
+ */
+struct _GstNvAnalyticsMeta
+{
+  GstMeta meta;
+
+  std::vector<GstNvAnalyticsEvent> *events;
+  std::vector<GstNvAnalyticsCount> *counts;
+};
+
+GType gst_nv_analytics_meta_api_get_type (void);
+#define GST_NV_ANALYTICS_META_API_TYPE (gst_nv_analytics_meta_api_get_type ())
+
+const GstMetaInfo *gst_nv_analytics_meta_get_info (void);
+#define GST_NV_ANALYTICS_META_INFO (gst_nv_analytics_meta_get_info ())
+
+#define gst_buffer_get_nv_analytics_meta(b) \
+  ((GstNvAnalyticsMeta *) gst_buffer_get_meta ((b), GST_NV_ANALYTICS_META_API_TYPE))
+
+GstNvAnalyticsMeta *gst_buffer_add_nv_analytics_meta (GstBuffer * buffer);
+
+G_END_DECLS
+
+#endif /* __GST_NV_ANALYTICS_META_H__ */
@@ -0,0 +1,396 @@
+/**
+ * SECTION:element-nvbatchdemux
+ *
+ * Splits batches produced by nvbatchmux back into one stream per source.
+ * A src_%u pad is added the first time a source id shows up in the
+ * #GstNvBatchMeta; the pad number is the source id.
+ *
+ * Per-source buffers never copy pixels: their memories are sub-memories
+ * (gst_memory_share()) of the frame's region in the batch, so they keep the
+ * batch memory alive. Frame layouts that differ from the default are
+ * described with #GstVideoMeta. Buffers keep the original duration and
+ * frame number (as the buffer offset) of the source frame. Their PTS is the
+ * frame's running time mapped into the batch segment, which is the segment
+ * every src pad gets, so downstream syncs each frame as its source would
+ * have.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 nvbatchmux name=mux zero-copy=false ! nvbatchdemux name=demux \
+ *     videotestsrc ! mux.sink_0  videotestsrc pattern=ball ! mux.sink_1 \
+ *     demux.src_0 ! queue ! fakesink  demux.src_1 ! queue ! fakesink
+ * ]|
+ */
+
+#include "gstnvbatchdemux.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_batch_demux_debug);
+#define GST_CAT_DEFAULT gst_nv_batch_demux_debug
+
+#define NV_BATCH_DEMUX_FORMATS "{ NV12, I420, RGBA, BGRx }"
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (GST_NV_BATCH_CAPS_MAKE (NV_BATCH_DEMUX_FORMATS)));
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src_%u",
+    GST_PAD_SRC,
+    GST_PAD_SOMETIMES,
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (NV_BATCH_DEMUX_FORMATS)));
+
+#define gst_nv_batch_demux_parent_class parent_class
+G_DEFINE_TYPE (GstNvBatchDemux, gst_nv_batch_demux, GST_TYPE_ELEMENT);
+GST_ELEMENT_REGISTER_DEFINE (nvbatchdemux, "nvbatchdemux", GST_RANK_NONE,
+    GST_TYPE_NV_BATCH_DEMUX);
+
+static void gst_nv_batch_demux_finalize (GObject * object);
+static GstStateChangeReturn gst_nv_batch_demux_change_state (GstElement *
+    element, GstStateChange transition);
+static GstFlowReturn gst_nv_batch_demux_chain (GstPad * pad,
+    GstObject * parent, GstBuffer * buffer);
+static gboolean gst_nv_batch_demux_sink_event (GstPad * pad,
+    GstObject * parent, GstEvent * event);
+static gboolean gst_nv_batch_demux_sink_query (GstPad * pad,
+    GstObject * parent, GstQuery * query);
+
+static void
+gst_nv_batch_demux_class_init (GstNvBatchDemuxClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_batch_demux_debug, "nvbatchdemux", 0,
+      "nvbatchdemux element");
+
+  gobject_class->finalize = gst_nv_batch_demux_finalize;
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV batch demuxer", "Demuxer/Video",
+      "Splits batched video into one stream per source without copying",
+      "nv_gst_plugins developers");
+
+  element_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_nv_batch_demux_change_state);
+}
+
+static void
+gst_nv_batch_demux_init (GstNvBatchDemux * self)
+{
+  self->sinkpad = gst_pad_new_from_static_template (&sink_template, "sink");
+  gst_pad_set_chain_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_nv_batch_demux_chain));
+  gst_pad_set_event_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_nv_batch_demux_sink_event));
+  gst_pad_set_query_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_nv_batch_demux_sink_query));
+  gst_element_add_pad (GST_ELEMENT (self), self->sinkpad);
+
+  gst_video_info_init (&self->info);
+  gst_segment_init (&self->segment, GST_FORMAT_TIME);
+  self->src_pads = g_hash_table_new (g_direct_hash, g_direct_equal);
+  self->flow_combiner = gst_flow_combiner_new ();
+}
+
+static void
+gst_nv_batch_demux_finalize (GObject * object)
+{
+  GstNvBatchDemux *self = GST_NV_BATCH_DEMUX (object);
+
+  g_hash_table_unref (self->src_pads);
+  gst_flow_combiner_free (self->flow_combiner);
+  gst_clear_caps (&self->src_caps);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_batch_demux_remove_src_pads (GstNvBatchDemux * self)
+{
+  GHashTableIter iter;
+  gpointer value;
+
+  g_hash_table_iter_init (&iter, self->src_pads);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    GstPad *srcpad = GST_PAD (value);
+
+    gst_flow_combiner_remove_pad (self->flow_combiner, srcpad);
+    gst_pad_set_active (srcpad, FALSE);
+    gst_element_remove_pad (GST_ELEMENT (self), srcpad);
+  }
+  g_hash_table_remove_all (self->src_pads);
+}
+
+static GstStateChangeReturn
+gst_nv_batch_demux_change_state (GstElement * element,
+    GstStateChange transition)
+{
+  GstNvBatchDemux *self = GST_NV_BATCH_DEMUX (element);
+  GstStateChangeReturn ret;
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+  if (ret == GST_STATE_CHANGE_FAILURE)
+    return ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_nv_batch_demux_remove_src_pads (self);
+      gst_flow_combiner_reset (self->flow_combiner);
+      gst_clear_caps (&self->src_caps);
+      gst_video_info_init (&self->info);
+      gst_segment_init (&self->segment, GST_FORMAT_TIME);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
+/* Per-source pads get their own stream-start, then the current caps and
+ * the batch segment. */
+static GstPad *
+gst_nv_batch_demux_get_src_pad (GstNvBatchDemux * self, guint source_id)
+{
+  GstPad *srcpad;
+  GstEvent *event;
+  gchar *name, *stream_id;
+
+  srcpad = GST_PAD (g_hash_table_lookup (self->src_pads,
+          GUINT_TO_POINTER (source_id)));
+  if (srcpad)
+    return srcpad;
+
+  name = g_strdup_printf ("src_%u", source_id);
+  srcpad = gst_pad_new_from_static_template (&src_template, name);
+  g_free (name);
+
+  gst_pad_use_fixed_caps (srcpad);
+  gst_pad_set_active (srcpad, TRUE);
+
+  stream_id = gst_pad_create_stream_id_printf (srcpad, GST_ELEMENT (self),
+      "%u", source_id);
+  event = gst_event_new_stream_start (stream_id);
+  g_free (stream_id);
+  if (self->group_id != GST_GROUP_ID_INVALID)
+    gst_event_set_group_id (event, self->group_id);
+  gst_pad_push_event (srcpad, event);
+
+  if (self->src_caps)
+    gst_pad_push_event (srcpad, gst_event_new_caps (self->src_caps));
+
+  event = gst_pad_get_sticky_event (self->sinkpad, GST_EVENT_SEGMENT, 0);
+  if (event)
+    gst_pad_push_event (srcpad, event);
+
+  g_hash_table_insert (self->src_pads, GUINT_TO_POINTER (source_id), srcpad);
+  gst_flow_combiner_add_pad (self->flow_combiner, srcpad);
+  gst_element_add_pad (GST_ELEMENT (self), srcpad);
+
+  GST_INFO_OBJECT (self, "added pad for source %u", source_id);
+
+  return srcpad;
+}
+
+/* Wraps [offset, offset + size) of @src in sub-memories of its memories. */
+static GstBuffer *
+gst_nv_batch_demux_share_region (GstNvBatchDemux * self, GstBuffer * src,
+    gsize offset, gsize size)
+{
+  GstBuffer *out;
+  guint idx, length;
+  gsize skip;
+
+  if (!gst_buffer_find_memory (src, offset, size, &idx, &length, &skip))
+    return NULL;
+
+  out = gst_buffer_new ();
+  for (guint i = idx; i < idx + length; i++) {
+    GstMemory *mem = gst_buffer_peek_memory (src, i);
+    gsize take = MIN (gst_memory_get_sizes (mem, NULL, NULL) - skip, size);
+
+    if (GST_MEMORY_FLAG_IS_SET (mem, GST_MEMORY_FLAG_NO_SHARE)) {
+      GST_WARNING_OBJECT (self, "memory %p cannot be shared, copying", mem);
+      gst_buffer_append_memory (out, gst_memory_copy (mem, skip, take));
+    } else {
+      gst_buffer_append_memory (out, gst_memory_share (mem, skip, take));
+    }
+    size -= take;
+    skip = 0;
+  }
+
+  return out;
+}
+
+/* Describes the frame's planes with a video meta when they are not where a
+ * plain buffer of the source caps would have them. */
+static void
+gst_nv_batch_demux_add_video_meta (GstNvBatchDemux * self, GstBuffer * out,
+    const GstNvBatchFrame * frame)
+{
+  const GstVideoInfo *info = &self->info;
+  gboolean is_default = TRUE;
+
+  for (guint i = 0; i < GST_VIDEO_INFO_N_PLANES (info); i++) {
+    if (frame->plane_offset[i] != GST_VIDEO_INFO_PLANE_OFFSET (info, i) ||
+        frame->stride[i] != GST_VIDEO_INFO_PLANE_STRIDE (info, i))
+      is_default = FALSE;
+  }
+  if (is_default)
+    return;
+
+  gst_buffer_add_video_meta_full (out, GST_VIDEO_FRAME_FLAG_NONE,
+      GST_VIDEO_INFO_FORMAT (info), GST_VIDEO_INFO_WIDTH (info),
+      GST_VIDEO_INFO_HEIGHT (info), GST_VIDEO_INFO_N_PLANES (info),
+      frame->plane_offset, frame->stride);
+}
+
+static GstFlowReturn
+gst_nv_batch_demux_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buffer)
+{
+  GstNvBatchDemux *self = GST_NV_BATCH_DEMUX (parent);
+  GstNvBatchMeta *meta;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  meta = gst_buffer_get_nv_batch_meta (buffer);
+  if (meta == NULL) {
+    GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
+        ("received a buffer without batch meta"));
+    gst_buffer_unref (buffer);
+    return GST_FLOW_ERROR;
+  }
+
+  for (guint i = 0; i < meta->n_frames; i++) {
+    const GstNvBatchFrame *frame = &meta->frames[i];
+    GstPad *srcpad;
+    GstBuffer *out;
+
+    out = gst_nv_batch_demux_share_region (self,
+        frame->buffer ? frame->buffer : buffer, frame->offset, frame->size);
+    if (out == NULL) {
+      GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
+          ("frame %u of source %u is outside its buffer", i,
+              frame->source_id));
+      ret = GST_FLOW_ERROR;
+      break;
+    }
+
+    /* the source's own PTS belongs to a segment downstream never saw */
+    GST_BUFFER_PTS (out) = GST_CLOCK_TIME_IS_VALID (frame->running_time) ?
+        gst_segment_position_from_running_time (&self->segment,
+        GST_FORMAT_TIME, frame->running_time) : GST_CLOCK_TIME_NONE;
+    GST_BUFFER_DURATION (out) = frame->duration;
+    GST_BUFFER_OFFSET (out) = frame->frame_num;
+    gst_nv_batch_demux_add_video_meta (self, out, frame);
+
+    srcpad = gst_nv_batch_demux_get_src_pad (self, frame->source_id);
+    ret = gst_flow_combiner_update_pad_flow (self->flow_combiner, srcpad,
+        gst_pad_push (srcpad, out));
+    if (ret != GST_FLOW_OK)
+      break;
+  }
+
+  gst_buffer_unref (buffer);
+
+  return ret;
+}
+
+static gboolean
+gst_nv_batch_demux_set_caps (GstNvBatchDemux * self, GstCaps * caps)
+{
+  GHashTableIter iter;
+  gpointer value;
+  GstCaps *src_caps;
+
+  if (!gst_video_info_from_caps (&self->info, caps)) {
+    GST_ERROR_OBJECT (self, "invalid caps %" GST_PTR_FORMAT, caps);
+    return FALSE;
+  }
+
+  /* same video, one frame per buffer, in system memory */
+  src_caps = gst_caps_copy (caps);
+  gst_caps_set_features (src_caps, 0, NULL);
+  gst_structure_remove_field (gst_caps_get_structure (src_caps, 0),
+      "batch-size");
+  gst_caps_replace (&self->src_caps, src_caps);
+  gst_caps_unref (src_caps);
+
+  g_hash_table_iter_init (&iter, self->src_pads);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    gst_pad_push_event (GST_PAD (value), gst_event_new_caps (self->src_caps));
+
+  return TRUE;
+}
+
+static gboolean
+gst_nv_batch_demux_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstNvBatchDemux *self = GST_NV_BATCH_DEMUX (parent);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_STREAM_START:
+      /* every src pad sends its own, see get_src_pad() */
+      if (!gst_event_parse_group_id (event, &self->group_id))
+        self->group_id = gst_util_group_id_next ();
+      gst_event_unref (event);
+      return TRUE;
+    case GST_EVENT_CAPS:{
+      GstCaps *caps;
+      gboolean ret;
+
+      gst_event_parse_caps (event, &caps);
+      ret = gst_nv_batch_demux_set_caps (self, caps);
+      gst_event_unref (event);
+      return ret;
+    }
+    case GST_EVENT_SEGMENT:
+      gst_event_copy_segment (event, &self->segment);
+      if (self->segment.format != GST_FORMAT_TIME) {
+        GST_ERROR_OBJECT (self, "batch segment is not in time");
+        gst_event_unref (event);
+        return FALSE;
+      }
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      gst_flow_combiner_reset (self->flow_combiner);
+      break;
+    default:
+      break;
+  }
+
+  return gst_pad_event_default (pad, parent, event);
+}
+
+static gboolean
+gst_nv_batch_demux_sink_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_CAPS:{
+      GstCaps *filter, *caps;
+
+      gst_query_parse_caps (query, &filter);
+      caps = gst_pad_get_pad_template_caps (pad);
+      if (filter) {
+        GstCaps *tmp =
+            gst_caps_intersect_full (filter, caps, GST_CAPS_INTERSECT_FIRST);
+        gst_caps_unref (caps);
+        caps = tmp;
+      }
+      gst_query_set_caps_result (query, caps);
+      gst_caps_unref (caps);
+      return TRUE;
+    }
+    case GST_QUERY_ALLOCATION:
+      /* batches are not allocated by per-source downstream elements */
+      return FALSE;
+    default:
+      break;
+  }
+
+  return gst_pad_query_default (pad, parent, query);
+}
@@ -0,0 +1,52 @@
+#ifndef __GST_NV_BATCH_DEMUX_H__
+#define __GST_NV_BATCH_DEMUX_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstflowcombiner.h>
+#include <gst/video/video.h>
+
+#include "gstnvbatchmeta.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_NV_BATCH_DEMUX \
+  (gst_nv_batch_demux_get_type())
+#define GST_NV_BATCH_DEMUX(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_BATCH_DEMUX,GstNvBatchDemux))
+#define GST_NV_BATCH_DEMUX_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_BATCH_DEMUX,GstNvBatchDemuxClass))
+#define GST_IS_NV_BATCH_DEMUX(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_BATCH_DEMUX))
+
+typedef struct _GstNvBatchDemux GstNvBatchDemux;
+typedef struct _GstNvBatchDemuxClass GstNvBatchDemuxClass;
+
+struct _GstNvBatchDemux
+{
+  GstElement parent;
+
+  GstPad *sinkpad;
+
+  /* streaming thread only */
+  GstVideoInfo info;
+  GstCaps *src_caps;
+  /* batch segment, forwarded on every src pad */
+  GstSegment segment;
+  guint group_id;
+  /* source id -> src pad, owned by the element */
+  GHashTable *src_pads;
+  GstFlowCombiner *flow_combiner;
+};
+
+struct _GstNvBatchDemuxClass
+{
+  GstElementClass parent_class;
+};
+
+GType gst_nv_batch_demux_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvbatchdemux);
+
+G_END_DECLS
+
+#endif /* __GST_NV_BATCH_DEMUX_H__ */
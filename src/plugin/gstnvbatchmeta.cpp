@@ -0,0 +1,166 @@
+#include "gstnvbatchmeta.h"
+#include "gstnvutils.h"
+
+GType
+gst_nv_batch_meta_api_get_type (void)
+{
+  static GType type = 0;
+  static const gchar *tags[] = { GST_META_TAG_VIDEO_STR,
+    GST_META_TAG_MEMORY_STR, NULL
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = gst_meta_api_type_register ("GstNvBatchMetaAPI", tags);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+static gboolean
+gst_nv_batch_meta_init (GstMeta * meta, gpointer params, GstBuffer * buffer)
+{
+  GstNvBatchMeta *bmeta = (GstNvBatchMeta *) meta;
+
+  bmeta->max_frames = 0;
+  bmeta->n_frames = 0;
+
+  return TRUE;
+}
+
+static void
+gst_nv_batch_meta_free (GstMeta * meta, GstBuffer * buffer)
+{
+  GstNvBatchMeta *bmeta = (GstNvBatchMeta *) meta;
+
+  for (guint i = 0; i < bmeta->n_frames; i++)
+    gst_clear_buffer (&bmeta->frames[i].buffer);
+  bmeta->n_frames = 0;
+}
+
+/* Frames in the batch memory only stay valid when all memory is copied;
+ * frames held in their own buffers are shared by reference. */
+static gboolean
+gst_nv_batch_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstNvBatchMeta *src = (GstNvBatchMeta *) meta;
+  GstNvBatchMeta *dmeta;
+  GstMetaTransformCopy *copy;
+
+  if (!GST_META_TRANSFORM_IS_COPY (type))
+    return FALSE;
+
+  copy = (GstMetaTransformCopy *) data;
+  if (copy->region)
+    return FALSE;
+
+  dmeta = gst_buffer_add_nv_batch_meta (dest, src->max_frames);
+  if (dmeta == NULL)
+    return FALSE;
+
+  dmeta->n_frames = src->n_frames;
+  for (guint i = 0; i < src->n_frames; i++) {
+    dmeta->frames[i] = src->frames[i];
+    if (dmeta->frames[i].buffer)
+      gst_buffer_ref (dmeta->frames[i].buffer);
+  }
+
+  return TRUE;
+}
+
+const GstMetaInfo *
+gst_nv_batch_meta_get_info (void)
+{
+  static const GstMetaInfo *info = NULL;
+
+  if (g_once_init_enter (&info)) {
+    const GstMetaInfo *tmp = gst_meta_register (GST_NV_BATCH_META_API_TYPE,
+        "GstNvBatchMeta", sizeof (GstNvBatchMeta),
+        gst_nv_batch_meta_init, gst_nv_batch_meta_free,
+        gst_nv_batch_meta_transform);
+    g_once_init_leave (&info, tmp);
+  }
+  return info;
+}
+
+GstNvBatchMeta *
+gst_buffer_add_nv_batch_meta (GstBuffer * buffer, guint max_frames)
+{
+  GstNvBatchMeta *meta;
+
+  g_return_val_if_fail (max_frames <= GST_NV_BATCH_MAX_FRAMES, NULL);
+
+  meta = (GstNvBatchMeta *) gst_buffer_add_meta (buffer,
+      GST_NV_BATCH_META_INFO, NULL);
+  meta->max_frames = max_frames;
+
+  return meta;
+}
+
+/**
+ * gst_nv_batch_meta_map_frame:
+ *
+ * Maps the memory holding frame @index of @batch. The frame starts at
+ * map->data + frame->offset; see gst_nv_batch_frame_view().
+ */
+gboolean
+gst_nv_batch_meta_map_frame (GstNvBatchMeta * meta, GstBuffer * batch,
+    guint index, GstMapInfo * map, GstMapFlags flags)
+{
+  GstNvBatchFrame *frame;
+
+  g_return_val_if_fail (index < meta->n_frames, FALSE);
+
+  frame = &meta->frames[index];
+  return gst_buffer_map (frame->buffer ? frame->buffer : batch, map, flags);
+}
+
+void
+gst_nv_batch_meta_unmap_frame (GstNvBatchMeta * meta, GstBuffer * batch,
+    guint index, GstMapInfo * map)
+{
+  GstNvBatchFrame *frame = &meta->frames[index];
+
+  gst_buffer_unmap (frame->buffer ? frame->buffer : batch, map);
+}
+
+/**
+ * gst_nv_batch_meta_make_frames_writable:
+ *
+ * Ensures every frame held in its own buffer can be mapped for writing.
+ * Frames shared with another batch (after gst_buffer_make_writable() on the
+ * batch, or a tee upstream) are copied. The batch buffer itself must already
+ * be writable.
+ */
+gboolean
+gst_nv_batch_meta_make_frames_writable (GstNvBatchMeta * meta)
+{
+  for (guint i = 0; i < meta->n_frames; i++) {
+    GstNvBatchFrame *frame = &meta->frames[i];
+
+    if (frame->buffer == NULL)
+      continue;
+    frame->buffer = gst_buffer_make_writable (frame->buffer);
+    if (frame->buffer == NULL)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+nvgst::FrameView
+gst_nv_batch_frame_view (const GstNvBatchFrame * frame,
+    const GstVideoInfo * info, const GstMapInfo * map)
+{
+  nvgst::FrameView view;
+  guint8 *base = map->data + frame->offset;
+
+  view.format =
+      gst_nv_pixel_format_from_video_format (GST_VIDEO_INFO_FORMAT (info));
+  view.width = GST_VIDEO_INFO_WIDTH (info);
+  view.height = GST_VIDEO_INFO_HEIGHT (info);
+  for (guint i = 0; i < GST_VIDEO_INFO_N_PLANES (info) && i < 3; i++) {
+    view.data[i] = base + frame->plane_offset[i];
+    view.stride[i] = frame->stride[i];
+  }
+  return view;
+}
@@ -0,0 +1,102 @@
+/* Batch metadata attached by nvbatchmux and read by every batch-aware
+ * element: one entry per frame with its source, timing and location. */
+#ifndef __GST_NV_BATCH_META_H__
+#define __GST_NV_BATCH_META_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "core/frame.h"
+
+G_BEGIN_DECLS
+
+/* Caps feature carried by batched video; keeps plain video elements from
+ * linking to a buffer that holds several frames. */
+#define GST_CAPS_FEATURE_META_GST_NV_BATCH "meta:GstNvBatch"
+
+#define GST_NV_BATCH_CAPS_MAKE(format) \
+  GST_VIDEO_CAPS_MAKE_WITH_FEATURES (GST_CAPS_FEATURE_META_GST_NV_BATCH, \
+      format) ", batch-size = (int) [ 1, 64 ]"
+
+#define GST_NV_BATCH_MAX_FRAMES 64
+
+typedef struct _GstNvBatchFrame GstNvBatchFrame;
+typedef struct _GstNvBatchMeta GstNvBatchMeta;
+
+/**
+ * GstNvBatchFrame:
+ * @source_id: index of the muxer sink pad the frame arrived on
+ * @frame_num: per-source frame counter, starting at 0
+ * @pts: the frame's original presentation timestamp
+ * @duration: the frame's original duration
+ * @running_time: running time of @pts in the source's segment; the batch
+ *     PTS is the earliest of these, and nvbatchdemux maps it back into the
+ *     batch segment
+ * @buffer: the buffer holding the frame (zero-copy batches), or %NULL when
+ *     the frame lives in the batch buffer's own memory
+ * @offset: byte offset of the frame in @buffer or in the batch buffer
+ * @size: size of the frame in bytes
+ * @plane_offset: plane offsets relative to @offset
+ * @stride: plane strides
+ *
+ * Format, width and height are those of the batch caps.
+ */
+struct _GstNvBatchFrame
+{
+  guint source_id;
+  guint64 frame_num;
+  GstClockTime pts;
+  GstClockTime duration;
+  GstClockTime running_time;
+
+  GstBuffer *buffer;
+  gsize offset;
+  gsize size;
+  gsize plane_offset[GST_VIDEO_MAX_PLANES];
+  gint stride[GST_VIDEO_MAX_PLANES];
+};
+
+/**
+ * GstNvBatchMeta:
+ * @meta: parent #GstMeta
+ * @max_frames: configured batch size
+ * @n_frames: number of valid entries in @frames; less than @max_frames
+ *     when late sources were skipped
+ * @frames: per-frame entries
+ */
+struct _GstNvBatchMeta
+{
+  GstMeta meta;
+
+  guint max_frames;
+  guint n_frames;
+  GstNvBatchFrame frames[GST_NV_BATCH_MAX_FRAMES];
+};
+
+GType gst_nv_batch_meta_api_get_type (void);
+#define GST_NV_BATCH_META_API_TYPE (gst_nv_batch_meta_api_get_type ())
+
+const GstMetaInfo *gst_nv_batch_meta_get_info (void);
+#define GST_NV_BATCH_META_INFO (gst_nv_batch_meta_get_info ())
+
+#define gst_buffer_get_nv_batch_meta(b) \
+  ((GstNvBatchMeta *) gst_buffer_get_meta ((b), GST_NV_BATCH_META_API_TYPE))
+
+GstNvBatchMeta *gst_buffer_add_nv_batch_meta (GstBuffer * buffer,
+    guint max_frames);
+
+gboolean gst_nv_batch_meta_map_frame (GstNvBatchMeta * meta,
+    GstBuffer * batch, guint index, GstMapInfo * map, GstMapFlags flags);
+
+void gst_nv_batch_meta_unmap_frame (GstNvBatchMeta * meta, GstBuffer * batch,
+    guint index, GstMapInfo * map);
+
+gboolean gst_nv_batch_meta_make_frames_writable (GstNvBatchMeta * meta);
+
+G_END_DECLS
+
+/* View of a frame mapped with gst_nv_batch_meta_map_frame(). */
+nvgst::FrameView gst_nv_batch_frame_view (const GstNvBatchFrame * frame,
+    const GstVideoInfo * info, const GstMapInfo * map);
+
+#endif /* __GST_NV_BATCH_META_H__ */
@@ -0,0 +1,815 @@
+/**
+ * SECTION:element-nvbatchmux
+ *
+ * Groups frames from N sources into one batched buffer per tick. Every
+ * batch carries a #GstNvBatchMeta listing, per frame, the source id (the
+ * sink pad index), the original PTS and a per-source frame number.
+ *
+ * With #GstNvBatchMux:zero-copy (the default) each frame keeps its input
+ * buffer, referenced from the meta; only sources whose format or size
+ * differ from the batch caps are converted, into a per-source pool. With
+ * zero-copy disabled all frames are converted or copied into one
+ * contiguous, 64-byte aligned buffer from a preallocated pool.
+ *
+ * With live sources a batch is pushed once every source delivered a frame,
+ * or #GstNvBatchMux:push-timeout after the batch was due, without the late
+ * sources.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 nvbatchmux name=mux ! fakesink \
+ *     videotestsrc is-live=true ! mux.sink_0 \
+ *     videotestsrc is-live=true pattern=ball ! mux.sink_1
+ * ]|
+ */
+
+#include <stdio.h>
+
+#include "gstnvbatchmux.h"
+#include "gstnvbufferpool.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_batch_mux_debug);
+#define GST_CAT_DEFAULT gst_nv_batch_mux_debug
+
+#define DEFAULT_BATCH_SIZE 0
+#define DEFAULT_PUSH_TIMEOUT (40 * GST_MSECOND)
+#define DEFAULT_ZERO_COPY TRUE
+#define DEFAULT_WIDTH 0
+#define DEFAULT_HEIGHT 0
+#define DEFAULT_SIMD GST_NV_SIMD_LEVEL_AUTO
+
+/* batches in flight before the contiguous pool has to grow */
+#define BATCH_POOL_MIN_BUFFERS 4
+#define PAD_POOL_MIN_BUFFERS 4
+
+enum
+{
+  PROP_0,
+  PROP_BATCH_SIZE,
+  PROP_PUSH_TIMEOUT,
+  PROP_ZERO_COPY,
+  PROP_WIDTH,
+  PROP_HEIGHT,
+  PROP_SIMD,
+};
+
+#define NV_BATCH_MUX_FORMATS "{ NV12, I420, RGBA, BGRx }"
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink_%u",
+    GST_PAD_SINK,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (NV_BATCH_MUX_FORMATS)));
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (GST_NV_BATCH_CAPS_MAKE (NV_BATCH_MUX_FORMATS)));
+
+/* GstNvBatchMuxPad */
+
+G_DEFINE_TYPE (GstNvBatchMuxPad, gst_nv_batch_mux_pad,
+    GST_TYPE_AGGREGATOR_PAD);
+
+static void
+gst_nv_batch_mux_pad_finalize (GObject * object)
+{
+  GstNvBatchMuxPad *pad = GST_NV_BATCH_MUX_PAD (object);
+
+  if (pad->pool) {
+    gst_buffer_pool_set_active (pad->pool, FALSE);
+    gst_object_unref (pad->pool);
+  }
+  delete pad->converter;
+
+  G_OBJECT_CLASS (gst_nv_batch_mux_pad_parent_class)->finalize (object);
+}
+
+static void
+gst_nv_batch_mux_pad_class_init (GstNvBatchMuxPadClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->finalize = gst_nv_batch_mux_pad_finalize;
+}
+
+static void
+gst_nv_batch_mux_pad_init (GstNvBatchMuxPad * pad)
+{
+  gst_video_info_init (&pad->info);
+  pad->converter = new nvgst::VideoConverter ();
+}
+
+/* GstNvBatchMux */
+
+#define gst_nv_batch_mux_parent_class parent_class
+G_DEFINE_TYPE (GstNvBatchMux, gst_nv_batch_mux, GST_TYPE_AGGREGATOR);
+GST_ELEMENT_REGISTER_DEFINE (nvbatchmux, "nvbatchmux", GST_RANK_NONE,
+    GST_TYPE_NV_BATCH_MUX);
+
+static void gst_nv_batch_mux_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_batch_mux_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static GstPad *gst_nv_batch_mux_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
+static void gst_nv_batch_mux_release_pad (GstElement * element, GstPad * pad);
+static GstAggregatorPad *gst_nv_batch_mux_create_new_pad (GstAggregator * agg,
+    GstPadTemplate * templ, const gchar * req_name, const GstCaps * caps);
+static gboolean gst_nv_batch_mux_sink_event (GstAggregator * agg,
+    GstAggregatorPad * aggpad, GstEvent * event);
+static GstFlowReturn gst_nv_batch_mux_update_src_caps (GstAggregator * agg,
+    GstCaps * caps, GstCaps ** ret);
+static gboolean gst_nv_batch_mux_negotiated_src_caps (GstAggregator * agg,
+    GstCaps * caps);
+static GstFlowReturn gst_nv_batch_mux_aggregate (GstAggregator * agg,
+    gboolean timeout);
+static gboolean gst_nv_batch_mux_stop (GstAggregator * agg);
+
+static void
+gst_nv_batch_mux_class_init (GstNvBatchMuxClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstAggregatorClass *agg_class = GST_AGGREGATOR_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_batch_mux_debug, "nvbatchmux", 0,
+      "nvbatchmux element");
+
+  gobject_class->set_property = gst_nv_batch_mux_set_property;
+  gobject_class->get_property = gst_nv_batch_mux_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_BATCH_SIZE,
+      g_param_spec_uint ("batch-size", "Batch size",
+          "Maximum number of frames per batch (0 = number of sink pads)",
+          0, GST_NV_BATCH_MAX_FRAMES, DEFAULT_BATCH_SIZE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_PUSH_TIMEOUT,
+      g_param_spec_uint64 ("push-timeout", "Push timeout",
+          "With live sources, how long (in ns) to wait past the batch "
+          "deadline for late sources before pushing a partial batch",
+          0, G_MAXUINT64, DEFAULT_PUSH_TIMEOUT,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_ZERO_COPY,
+      g_param_spec_boolean ("zero-copy", "Zero copy",
+          "Reference input buffers from the batch meta instead of copying "
+          "frames into one contiguous batch buffer",
+          DEFAULT_ZERO_COPY,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_WIDTH,
+      g_param_spec_uint ("width", "Width",
+          "Width of batched frames (0 = width of the first source)",
+          0, G_MAXINT, DEFAULT_WIDTH,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_HEIGHT,
+      g_param_spec_uint ("height", "Height",
+          "Height of batched frames (0 = height of the first source)",
+          0, G_MAXINT, DEFAULT_HEIGHT,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SIMD,
+      g_param_spec_enum ("simd", "SIMD",
+          "Highest SIMD level to use when sources need conversion",
+          GST_TYPE_NV_SIMD_LEVEL, DEFAULT_SIMD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template_with_gtype (element_class,
+      &sink_template, GST_TYPE_NV_BATCH_MUX_PAD);
+  gst_element_class_add_static_pad_template_with_gtype (element_class,
+      &src_template, GST_TYPE_AGGREGATOR_PAD);
+  gst_element_class_set_static_metadata (element_class,
+      "NV batch muxer", "Muxer/Video",
+      "Batches frames from several video sources into one buffer with "
+      "per-source batch meta",
+      "nv_gst_plugins developers");
+
+  element_class->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_nv_batch_mux_request_new_pad);
+  element_class->release_pad = GST_DEBUG_FUNCPTR (gst_nv_batch_mux_release_pad);
+
+  agg_class->create_new_pad = GST_DEBUG_FUNCPTR (gst_nv_batch_mux_create_new_pad);
+  agg_class->sink_event = GST_DEBUG_FUNCPTR (gst_nv_batch_mux_sink_event);
+  agg_class->update_src_caps =
+      GST_DEBUG_FUNCPTR (gst_nv_batch_mux_update_src_caps);
+  agg_class->negotiated_src_caps =
+      GST_DEBUG_FUNCPTR (gst_nv_batch_mux_negotiated_src_caps);
+  agg_class->aggregate = GST_DEBUG_FUNCPTR (gst_nv_batch_mux_aggregate);
+  agg_class->stop = GST_DEBUG_FUNCPTR (gst_nv_batch_mux_stop);
+  agg_class->get_next_time = gst_aggregator_simple_get_next_time;
+
+  gst_type_mark_as_plugin_api (GST_TYPE_NV_BATCH_MUX_PAD, (GstPluginAPIFlags) 0);
+}
+
+static void
+gst_nv_batch_mux_init (GstNvBatchMux * self)
+{
+  self->batch_size = DEFAULT_BATCH_SIZE;
+  self->push_timeout = DEFAULT_PUSH_TIMEOUT;
+  self->zero_copy = DEFAULT_ZERO_COPY;
+  self->width = DEFAULT_WIDTH;
+  self->height = DEFAULT_HEIGHT;
+  self->simd = DEFAULT_SIMD;
+  gst_video_info_init (&self->out_info);
+
+  gst_aggregator_set_latency (GST_AGGREGATOR (self), self->push_timeout,
+      self->push_timeout);
+}
+
+static void
+gst_nv_batch_mux_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvBatchMux *self = GST_NV_BATCH_MUX (object);
+  GstClockTime push_timeout = GST_CLOCK_TIME_NONE;
+  gboolean reconfigure = TRUE;
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_BATCH_SIZE:
+      self->batch_size = g_value_get_uint (value);
+      break;
+    case PROP_PUSH_TIMEOUT:
+      self->push_timeout = push_timeout = g_value_get_uint64 (value);
+      reconfigure = FALSE;
+      break;
+    case PROP_ZERO_COPY:
+      self->zero_copy = g_value_get_boolean (value);
+      break;
+    case PROP_WIDTH:
+      self->width = g_value_get_uint (value);
+      break;
+    case PROP_HEIGHT:
+      self->height = g_value_get_uint (value);
+      break;
+    case PROP_SIMD:
+      self->simd = (GstNvSimdLevel) g_value_get_enum (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      reconfigure = FALSE;
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  if (GST_CLOCK_TIME_IS_VALID (push_timeout))
+    gst_aggregator_set_latency (GST_AGGREGATOR (self), push_timeout,
+        push_timeout);
+  if (reconfigure)
+    gst_pad_mark_reconfigure (GST_AGGREGATOR_SRC_PAD (self));
+}
+
+static void
+gst_nv_batch_mux_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstNvBatchMux *self = GST_NV_BATCH_MUX (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_BATCH_SIZE:
+      g_value_set_uint (value, self->batch_size);
+      break;
+    case PROP_PUSH_TIMEOUT:
+      g_value_set_uint64 (value, self->push_timeout);
+      break;
+    case PROP_ZERO_COPY:
+      g_value_set_boolean (value, self->zero_copy);
+      break;
+    case PROP_WIDTH:
+      g_value_set_uint (value, self->width);
+      break;
+    case PROP_HEIGHT:
+      g_value_set_uint (value, self->height);
+      break;
+    case PROP_SIMD:
+      g_value_set_enum (value, self->simd);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+/* An automatic batch size follows the number of sink pads. */
+static GstPad *
+gst_nv_batch_mux_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps)
+{
+  GstPad *pad;
+
+  if (element->numsinkpads >= GST_NV_BATCH_MAX_FRAMES) {
+    GST_WARNING_OBJECT (element, "at most %d sources can be batched",
+        GST_NV_BATCH_MAX_FRAMES);
+    return NULL;
+  }
+
+  pad = GST_ELEMENT_CLASS (parent_class)->request_new_pad (element, templ,
+      name, caps);
+  if (pad)
+    gst_pad_mark_reconfigure (GST_AGGREGATOR_SRC_PAD (element));
+
+  return pad;
+}
+
+static void
+gst_nv_batch_mux_release_pad (GstElement * element, GstPad * pad)
+{
+  GST_ELEMENT_CLASS (parent_class)->release_pad (element, pad);
+  gst_pad_mark_reconfigure (GST_AGGREGATOR_SRC_PAD (element));
+}
+
+static GstAggregatorPad *
+gst_nv_batch_mux_create_new_pad (GstAggregator * agg, GstPadTemplate * templ,
+    const gchar * req_name, const GstCaps * caps)
+{
+  GstAggregatorPad *aggpad;
+  GstNvBatchMuxPad *pad;
+  gchar *name;
+
+  aggpad = GST_AGGREGATOR_CLASS (parent_class)->create_new_pad (agg, templ,
+      req_name, caps);
+  if (aggpad == NULL)
+    return NULL;
+
+  pad = GST_NV_BATCH_MUX_PAD (aggpad);
+  name = gst_pad_get_name (GST_PAD (pad));
+  if (sscanf (name, "sink_%u", &pad->source_id) != 1)
+    pad->source_id = 0;
+  g_free (name);
+
+  GST_DEBUG_OBJECT (agg, "new pad %" GST_PTR_FORMAT " for source %u", pad,
+      pad->source_id);
+
+  return aggpad;
+}
+
+static gboolean
+gst_nv_batch_mux_sink_event (GstAggregator * agg, GstAggregatorPad * aggpad,
+    GstEvent * event)
+{
+  GstNvBatchMuxPad *pad = GST_NV_BATCH_MUX_PAD (aggpad);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS) {
+    GstCaps *caps;
+
+    gst_event_parse_caps (event, &caps);
+    if (!gst_video_info_from_caps (&pad->info, caps)) {
+      GST_ERROR_OBJECT (pad, "invalid caps %" GST_PTR_FORMAT, caps);
+      gst_event_unref (event);
+      return FALSE;
+    }
+    pad->have_info = TRUE;
+    pad->needs_configure = TRUE;
+    gst_pad_mark_reconfigure (GST_AGGREGATOR_SRC_PAD (agg));
+  }
+
+  return GST_AGGREGATOR_CLASS (parent_class)->sink_event (agg, aggpad, event);
+}
+
+/* Batch caps follow the first source with caps, overridden by the width and
+ * height properties. */
+static GstFlowReturn
+gst_nv_batch_mux_update_src_caps (GstAggregator * agg, GstCaps * caps,
+    GstCaps ** ret)
+{
+  GstNvBatchMux *self = GST_NV_BATCH_MUX (agg);
+  GstVideoInfo src, info;
+  gboolean have_src = FALSE;
+  guint width, height, batch_size;
+  GstCaps *batch_caps;
+
+  GST_OBJECT_LOCK (self);
+  for (GList * l = GST_ELEMENT (self)->sinkpads; l; l = l->next) {
+    GstNvBatchMuxPad *pad = GST_NV_BATCH_MUX_PAD (l->data);
+    if (pad->have_info) {
+      src = pad->info;
+      have_src = TRUE;
+      break;
+    }
+  }
+  width = self->width;
+  height = self->height;
+  batch_size = self->batch_size;
+  if (batch_size == 0)
+    batch_size = MAX (GST_ELEMENT (self)->numsinkpads, 1);
+  GST_OBJECT_UNLOCK (self);
+
+  if (!have_src)
+    return GST_AGGREGATOR_FLOW_NEED_DATA;
+
+  if (width == 0)
+    width = GST_VIDEO_INFO_WIDTH (&src);
+  if (height == 0)
+    height = GST_VIDEO_INFO_HEIGHT (&src);
+
+  gst_video_info_init (&info);
+  gst_video_info_set_format (&info, GST_VIDEO_INFO_FORMAT (&src), width,
+      height);
+  info.fps_n = src.fps_n;
+  info.fps_d = src.fps_d;
+  info.colorimetry = src.colorimetry;
+
+  batch_caps = gst_video_info_to_caps (&info);
+  gst_caps_set_features (batch_caps, 0,
+      gst_caps_features_new (GST_CAPS_FEATURE_META_GST_NV_BATCH, NULL));
+  gst_caps_set_simple (batch_caps, "batch-size", G_TYPE_INT,
+      (gint) batch_size, NULL);
+
+  if (caps && !gst_caps_can_intersect (batch_caps, caps)) {
+    GST_ELEMENT_ERROR (self, CORE, NEGOTIATION, (NULL),
+        ("downstream does not accept %" GST_PTR_FORMAT, batch_caps));
+    gst_caps_unref (batch_caps);
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
+
+  *ret = batch_caps;
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+gst_nv_batch_mux_negotiated_src_caps (GstAggregator * agg, GstCaps * caps)
+{
+  GstNvBatchMux *self = GST_NV_BATCH_MUX (agg);
+  GstStructure *s = gst_caps_get_structure (caps, 0);
+  gint batch_size = 0;
+
+  if (!gst_video_info_from_caps (&self->out_info, caps) ||
+      !gst_structure_get_int (s, "batch-size", &batch_size) ||
+      batch_size < 1 || batch_size > GST_NV_BATCH_MAX_FRAMES)
+    return FALSE;
+
+  self->have_out_info = TRUE;
+  self->out_batch_size = batch_size;
+  GST_OBJECT_LOCK (self);
+  self->out_zero_copy = self->zero_copy;
+  GST_OBJECT_UNLOCK (self);
+
+  self->layout = nvgst::make_batch_layout (gst_nv_pixel_format_from_video_format
+      (GST_VIDEO_INFO_FORMAT (&self->out_info)),
+      GST_VIDEO_INFO_WIDTH (&self->out_info),
+      GST_VIDEO_INFO_HEIGHT (&self->out_info), batch_size);
+
+  if (self->batch_pool) {
+    gst_buffer_pool_set_active (self->batch_pool, FALSE);
+    gst_clear_object (&self->batch_pool);
+  }
+
+  if (!self->out_zero_copy) {
+    GstAllocationParams params;
+    GstStructure *config;
+
+    self->batch_pool = gst_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (self->batch_pool);
+    gst_buffer_pool_config_set_params (config, caps, self->layout.size,
+        BATCH_POOL_MIN_BUFFERS, 0);
+    gst_allocation_params_init (&params);
+    params.align = GST_NV_BUFFER_POOL_ALIGN - 1;
+    gst_buffer_pool_config_set_allocator (config, NULL, &params);
+    if (!gst_buffer_pool_set_config (self->batch_pool, config) ||
+        !gst_buffer_pool_set_active (self->batch_pool, TRUE)) {
+      GST_ERROR_OBJECT (self, "failed to set up a pool of %" G_GSIZE_FORMAT
+          " byte batches", self->layout.size);
+      gst_clear_object (&self->batch_pool);
+      return FALSE;
+    }
+  }
+
+  GST_OBJECT_LOCK (self);
+  for (GList * l = GST_ELEMENT (self)->sinkpads; l; l = l->next)
+    GST_NV_BATCH_MUX_PAD (l->data)->needs_configure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  GST_INFO_OBJECT (self, "batching up to %d frames, %s, as %" GST_PTR_FORMAT,
+      batch_size, self->out_zero_copy ? "zero-copy" : "contiguous", caps);
+
+  if (GST_AGGREGATOR_CLASS (parent_class)->negotiated_src_caps)
+    return GST_AGGREGATOR_CLASS (parent_class)->negotiated_src_caps (agg,
+        caps);
+  return TRUE;
+}
+
+static gboolean
+gst_nv_batch_mux_configure_pad (GstNvBatchMux * self, GstNvBatchMuxPad * pad)
+{
+  const GstVideoInfo *in = &pad->info;
+  const GstVideoInfo *out = &self->out_info;
+  nvgst::ConvertConfig config;
+  GstNvSimdLevel simd;
+
+  GST_OBJECT_LOCK (self);
+  simd = self->simd;
+  GST_OBJECT_UNLOCK (self);
+
+  pad->passthrough = self->out_zero_copy &&
+      GST_VIDEO_INFO_FORMAT (in) == GST_VIDEO_INFO_FORMAT (out) &&
+      GST_VIDEO_INFO_WIDTH (in) == GST_VIDEO_INFO_WIDTH (out) &&
+      GST_VIDEO_INFO_HEIGHT (in) == GST_VIDEO_INFO_HEIGHT (out);
+
+  if (pad->pool) {
+    gst_buffer_pool_set_active (pad->pool, FALSE);
+    gst_clear_object (&pad->pool);
+  }
+
+  if (!pad->passthrough) {
+    config.in_format =
+        gst_nv_pixel_format_from_video_format (GST_VIDEO_INFO_FORMAT (in));
+    config.in_width = GST_VIDEO_INFO_WIDTH (in);
+    config.in_height = GST_VIDEO_INFO_HEIGHT (in);
+    config.out_format =
+        gst_nv_pixel_format_from_video_format (GST_VIDEO_INFO_FORMAT (out));
+    config.out_width = GST_VIDEO_INFO_WIDTH (out);
+    config.out_height = GST_VIDEO_INFO_HEIGHT (out);
+    config.matrix = gst_nv_color_matrix_from_video_info (GST_VIDEO_INFO_IS_YUV
+        (in) ? in : out);
+    config.simd = gst_nv_simd_level_resolve (simd);
+
+    if (!pad->converter->configure (config)) {
+      GST_ERROR_OBJECT (pad, "unsupported conversion from source %u",
+          pad->source_id);
+      return FALSE;
+    }
+  }
+
+  if (self->out_zero_copy && !pad->passthrough) {
+    GstCaps *caps = gst_video_info_to_caps (out);
+
+    pad->pool = gst_nv_buffer_pool_new_configured (caps, PAD_POOL_MIN_BUFFERS,
+        0, TRUE);
+    gst_caps_unref (caps);
+    if (pad->pool == NULL || !gst_buffer_pool_set_active (pad->pool, TRUE)) {
+      GST_ERROR_OBJECT (pad, "failed to set up conversion pool");
+      gst_clear_object (&pad->pool);
+      return FALSE;
+    }
+  }
+
+  GST_DEBUG_OBJECT (pad, "source %u: %s", pad->source_id,
+      pad->passthrough ? "referenced" : "converted");
+
+  pad->needs_configure = FALSE;
+  return TRUE;
+}
+
+/* Plane layout of a referenced buffer: its video meta when present,
+ * otherwise the default layout of its caps. */
+static void
+gst_nv_batch_mux_set_frame_planes (GstNvBatchFrame * frame,
+    const GstVideoInfo * info, GstBuffer * buffer)
+{
+  GstVideoMeta *vmeta = gst_buffer_get_video_meta (buffer);
+
+  for (guint i = 0; i < GST_VIDEO_MAX_PLANES; i++) {
+    frame->plane_offset[i] = vmeta ? vmeta->offset[i] : info->offset[i];
+    frame->stride[i] = vmeta ? vmeta->stride[i] : info->stride[i];
+  }
+  frame->offset = 0;
+  frame->size = gst_buffer_get_size (buffer);
+}
+
+static gboolean
+gst_nv_batch_mux_convert_frame (GstNvBatchMux * self, GstNvBatchMuxPad * pad,
+    GstBuffer * inbuf, const nvgst::FrameView & dst)
+{
+  GstVideoFrame in_frame;
+
+  if (!gst_video_frame_map (&in_frame, &pad->info, inbuf, GST_MAP_READ)) {
+    GST_ERROR_OBJECT (pad, "failed to map input frame");
+    return FALSE;
+  }
+  pad->converter->convert (gst_nv_frame_view_from_video_frame (&in_frame),
+      dst);
+  gst_video_frame_unmap (&in_frame);
+
+  return TRUE;
+}
+
+/* Zero-copy: the frame keeps its input buffer, or a pooled converted copy
+ * when the source does not match the batch caps. */
+static gboolean
+gst_nv_batch_mux_add_frame_ref (GstNvBatchMux * self, GstNvBatchMuxPad * pad,
+    GstBuffer * inbuf, GstNvBatchFrame * frame)
+{
+  GstBuffer *outbuf = NULL;
+  GstVideoFrame out_frame;
+  gboolean ret;
+
+  if (pad->passthrough) {
+    gst_nv_batch_mux_set_frame_planes (frame, &pad->info, inbuf);
+    frame->buffer = gst_buffer_ref (inbuf);
+    return TRUE;
+  }
+
+  if (gst_buffer_pool_acquire_buffer (pad->pool, &outbuf, NULL) != GST_FLOW_OK)
+    return FALSE;
+  if (!gst_video_frame_map (&out_frame, &self->out_info, outbuf,
+          GST_MAP_WRITE)) {
+    gst_buffer_unref (outbuf);
+    return FALSE;
+  }
+  ret = gst_nv_batch_mux_convert_frame (self, pad, inbuf,
+      gst_nv_frame_view_from_video_frame (&out_frame));
+  gst_video_frame_unmap (&out_frame);
+
+  if (!ret) {
+    gst_buffer_unref (outbuf);
+    return FALSE;
+  }
+
+  gst_nv_batch_mux_set_frame_planes (frame, &self->out_info, outbuf);
+  frame->buffer = outbuf;
+  return TRUE;
+}
+
+/* Contiguous: the frame is converted (or copied) into its batch slot. */
+static gboolean
+gst_nv_batch_mux_add_frame_copy (GstNvBatchMux * self, GstNvBatchMuxPad * pad,
+    GstBuffer * inbuf, guint index, guint8 * base, GstNvBatchFrame * frame)
+{
+  const nvgst::FrameLayout & layout = self->layout.frame;
+
+  frame->buffer = NULL;
+  frame->offset = self->layout.slot_offset (index);
+  frame->size = layout.size;
+  for (guint i = 0; i < GST_VIDEO_MAX_PLANES; i++) {
+    frame->plane_offset[i] = i < 3 ? layout.offset[i] : 0;
+    frame->stride[i] = i < 3 ? layout.stride[i] : 0;
+  }
+
+  return gst_nv_batch_mux_convert_frame (self, pad, inbuf,
+      nvgst::make_frame_view (layout, base + frame->offset));
+}
+
+/* Pops at most one buffer per pad, starting after the pad that was last
+ * served so that a batch size below the pad count stays fair. Returns the
+ * number of frames selected; sets @all_eos when no pad can produce more. */
+static guint
+gst_nv_batch_mux_select_frames (GstNvBatchMux * self, gboolean * all_eos)
+{
+  GstElement *element = GST_ELEMENT (self);
+  guint n = 0, n_pads, i;
+
+  *all_eos = TRUE;
+
+  GST_OBJECT_LOCK (self);
+  n_pads = element->numsinkpads;
+  for (i = 0; i < n_pads && n < self->out_batch_size; i++) {
+    guint idx = (self->next_pad + i) % n_pads;
+    GstAggregatorPad *aggpad =
+        GST_AGGREGATOR_PAD (g_list_nth_data (element->sinkpads, idx));
+    GstBuffer *buf = gst_aggregator_pad_pop_buffer (aggpad);
+
+    if (buf == NULL) {
+      if (!gst_aggregator_pad_is_eos (aggpad))
+        *all_eos = FALSE;
+      continue;
+    }
+
+    *all_eos = FALSE;
+    self->sel_pads[n] = GST_NV_BATCH_MUX_PAD (gst_object_ref (aggpad));
+    self->sel_bufs[n] = buf;
+    n++;
+  }
+  if (n_pads > 0)
+    self->next_pad = (self->next_pad + i) % n_pads;
+  GST_OBJECT_UNLOCK (self);
+
+  return n;
+}
+
+static GstFlowReturn
+gst_nv_batch_mux_aggregate (GstAggregator * agg, gboolean timeout)
+{
+  GstNvBatchMux *self = GST_NV_BATCH_MUX (agg);
+  GstSegment *out_segment = &GST_AGGREGATOR_PAD (agg->srcpad)->segment;
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstBuffer *outbuf = NULL;
+  GstNvBatchMeta *meta;
+  GstMapInfo map;
+  GstClockTime pts = GST_CLOCK_TIME_NONE, duration = GST_CLOCK_TIME_NONE;
+  gboolean all_eos, mapped = FALSE;
+  guint n;
+
+  if (!self->have_out_info)
+    return GST_FLOW_NOT_NEGOTIATED;
+
+  n = gst_nv_batch_mux_select_frames (self, &all_eos);
+  if (n == 0)
+    return all_eos ? GST_FLOW_EOS : GST_FLOW_OK;
+
+  if (self->out_zero_copy) {
+    outbuf = gst_buffer_new ();
+  } else {
+    ret = gst_buffer_pool_acquire_buffer (self->batch_pool, &outbuf, NULL);
+    if (ret != GST_FLOW_OK)
+      goto done;
+    if (!gst_buffer_map (outbuf, &map, GST_MAP_WRITE)) {
+      ret = GST_FLOW_ERROR;
+      goto done;
+    }
+    mapped = TRUE;
+  }
+
+  meta = gst_buffer_add_nv_batch_meta (outbuf, self->out_batch_size);
+
+  for (guint i = 0; i < n; i++) {
+    GstNvBatchMuxPad *pad = self->sel_pads[i];
+    GstBuffer *inbuf = self->sel_bufs[i];
+    GstNvBatchFrame *frame = &meta->frames[meta->n_frames];
+    GstClockTime running_time;
+    gboolean ok;
+
+    if (pad->needs_configure && !gst_nv_batch_mux_configure_pad (self, pad)) {
+      GST_ELEMENT_ERROR (self, CORE, NEGOTIATION, (NULL),
+          ("cannot batch source %u", pad->source_id));
+      ret = GST_FLOW_NOT_NEGOTIATED;
+      goto done;
+    }
+
+    frame->source_id = pad->source_id;
+    frame->frame_num = pad->frame_num++;
+    frame->pts = GST_BUFFER_PTS (inbuf);
+    frame->duration = GST_BUFFER_DURATION (inbuf);
+    frame->running_time = gst_segment_to_running_time (&GST_AGGREGATOR_PAD
+        (pad)->segment, GST_FORMAT_TIME, GST_BUFFER_PTS (inbuf));
+
+    if (self->out_zero_copy)
+      ok = gst_nv_batch_mux_add_frame_ref (self, pad, inbuf, frame);
+    else
+      ok = gst_nv_batch_mux_add_frame_copy (self, pad, inbuf, meta->n_frames,
+          map.data, frame);
+    if (!ok) {
+      GST_ELEMENT_ERROR (self, STREAM, FAILED, (NULL),
+          ("failed to batch frame from source %u", pad->source_id));
+      ret = GST_FLOW_ERROR;
+      goto done;
+    }
+    meta->n_frames++;
+
+    running_time = frame->running_time;
+    if (GST_CLOCK_TIME_IS_VALID (running_time) &&
+        (!GST_CLOCK_TIME_IS_VALID (pts) || running_time < pts))
+      pts = running_time;
+    if (!GST_CLOCK_TIME_IS_VALID (duration))
+      duration = GST_BUFFER_DURATION (inbuf);
+  }
+
+  if (GST_VIDEO_INFO_FPS_N (&self->out_info) > 0)
+    duration = gst_util_uint64_scale_int (GST_SECOND,
+        GST_VIDEO_INFO_FPS_D (&self->out_info),
+        GST_VIDEO_INFO_FPS_N (&self->out_info));
+
+  GST_BUFFER_PTS (outbuf) = pts;
+  GST_BUFFER_DURATION (outbuf) = duration;
+  if (GST_CLOCK_TIME_IS_VALID (pts))
+    out_segment->position = GST_CLOCK_TIME_IS_VALID (duration) ?
+        pts + duration : pts;
+
+  GST_LOG_OBJECT (self, "batch of %u/%u frames%s, pts %" GST_TIME_FORMAT, n,
+      self->out_batch_size, timeout ? " (timeout)" : "", GST_TIME_ARGS (pts));
+
+done:
+  if (mapped)
+    gst_buffer_unmap (outbuf, &map);
+  for (guint i = 0; i < n; i++) {
+    gst_buffer_unref (self->sel_bufs[i]);
+    gst_object_unref (self->sel_pads[i]);
+    self->sel_bufs[i] = NULL;
+    self->sel_pads[i] = NULL;
+  }
+
+  if (ret != GST_FLOW_OK) {
+    gst_clear_buffer (&outbuf);
+    return ret;
+  }
+
+  return gst_aggregator_finish_buffer (agg, outbuf);
+}
+
+static gboolean
+gst_nv_batch_mux_stop (GstAggregator * agg)
+{
+  GstNvBatchMux *self = GST_NV_BATCH_MUX (agg);
+
+  if (self->batch_pool) {
+    gst_buffer_pool_set_active (self->batch_pool, FALSE);
+    gst_clear_object (&self->batch_pool);
+  }
+  self->have_out_info = FALSE;
+  self->next_pad = 0;
+
+  GST_OBJECT_LOCK (self);
+  for (GList * l = GST_ELEMENT (self)->sinkpads; l; l = l->next) {
+    GstNvBatchMuxPad *pad = GST_NV_BATCH_MUX_PAD (l->data);
+
+    pad->frame_num = 0;
+    pad->needs_configure = TRUE;
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  return TRUE;
+}
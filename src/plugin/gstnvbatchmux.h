@@ -0,0 +1,94 @@
+#ifndef __GST_NV_BATCH_MUX_H__
+#define __GST_NV_BATCH_MUX_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstaggregator.h>
+#include <gst/video/video.h>
+
+#include "gstnvbatchmeta.h"
+#include "gstnvutils.h"
+#include "core/batch.h"
+#include "core/convert.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_NV_BATCH_MUX_PAD \
+  (gst_nv_batch_mux_pad_get_type())
+#define GST_NV_BATCH_MUX_PAD(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_BATCH_MUX_PAD,GstNvBatchMuxPad))
+
+#define GST_TYPE_NV_BATCH_MUX \
+  (gst_nv_batch_mux_get_type())
+#define GST_NV_BATCH_MUX(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_BATCH_MUX,GstNvBatchMux))
+#define GST_NV_BATCH_MUX_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_BATCH_MUX,GstNvBatchMuxClass))
+#define GST_IS_NV_BATCH_MUX(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_BATCH_MUX))
+
+typedef struct _GstNvBatchMuxPad GstNvBatchMuxPad;
+typedef struct _GstNvBatchMuxPadClass GstNvBatchMuxPadClass;
+typedef struct _GstNvBatchMux GstNvBatchMux;
+typedef struct _GstNvBatchMuxClass GstNvBatchMuxClass;
+
+struct _GstNvBatchMuxPad
+{
+  GstAggregatorPad parent;
+
+  /* set at creation from the pad name */
+  guint source_id;
+
+  /* aggregate thread only */
+  GstVideoInfo info;
+  gboolean have_info;
+  gboolean needs_configure;
+  guint64 frame_num;
+  /* frame can be referenced without conversion (zero-copy mode) */
+  gboolean passthrough;
+  nvgst::VideoConverter *converter;
+  /* destination of converted frames in zero-copy mode */
+  GstBufferPool *pool;
+};
+
+struct _GstNvBatchMuxPadClass
+{
+  GstAggregatorPadClass parent_class;
+};
+
+struct _GstNvBatchMux
+{
+  GstAggregator parent;
+
+  /* properties, protected by the object lock */
+  guint batch_size;
+  GstClockTime push_timeout;
+  gboolean zero_copy;
+  guint width;
+  guint height;
+  GstNvSimdLevel simd;
+
+  /* aggregate thread only */
+  GstVideoInfo out_info;
+  gboolean have_out_info;
+  guint out_batch_size;
+  gboolean out_zero_copy;
+  nvgst::BatchLayout layout;
+  GstBufferPool *batch_pool;
+  guint next_pad;
+  GstNvBatchMuxPad *sel_pads[GST_NV_BATCH_MAX_FRAMES];
+  GstBuffer *sel_bufs[GST_NV_BATCH_MAX_FRAMES];
+};
+
+struct _GstNvBatchMuxClass
+{
+  GstAggregatorClass parent_class;
+};
+
+GType gst_nv_batch_mux_pad_get_type (void);
+GType gst_nv_batch_mux_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvbatchmux);
+
+G_END_DECLS
+
+#endif /* __GST_NV_BATCH_MUX_H__ */
@@ -0,0 +1,485 @@
+/**
+ * SECTION:element-nvbgsub
+ *
+ * Finds moving objects without a detector, by classical background
+ * subtraction, and adds them to the #GstNvObjectMeta of the buffer so the
+ * rest of the pipeline (nvtracker, nvanalytics, nvosd) treats them like
+ * detections.
+ *
+ * Frames are box-filtered down by #GstNvBgSub:scale to a luma thumbnail,
+ * and each thumbnail pixel keeps a mixture of three Gaussians, stored as
+ * planar int16 arrays and updated with SIMD kernels. Thumbnail pixels that
+ * match no established component are foreground; they are labelled into
+ * 8-connected blobs, and each blob of at least min-area frame pixels
+ * becomes an object of class class-id whose confidence is the share of its
+ * box that is foreground. Objects that stay still for about
+ * 1 / learning-rate frames fade into the background.
+ *
+ * On nvbatchmux batches every source keeps its own model. The first frame
+ * of a source, and the first after a flush, is taken as the background.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 rtspsrc location=rtsp://camera/stream ! decodebin ! \
+ *     nvconvert ! video/x-raw,format=NV12 ! nvbgsub scale=4 min-area=900 ! \
+ *     nvtracker ! nvanalytics config-location=zones.ini ! fakesink
+ * ]|
+ */
+
+#include "gstnvbgsub.h"
+#include "gstnvbatchmeta.h"
+#include "gstnvobjectmeta.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_bg_sub_debug);
+#define GST_CAT_DEFAULT gst_nv_bg_sub_debug
+
+#define DEFAULT_SCALE 4
+#define DEFAULT_LEARNING_RATE 0.005f
+#define DEFAULT_THRESHOLD 2.5f
+#define DEFAULT_BACKGROUND_WEIGHT 0.25f
+#define DEFAULT_MIN_AREA 256
+#define DEFAULT_CLASS_ID 0
+#define DEFAULT_SIMD GST_NV_SIMD_LEVEL_AUTO
+
+enum
+{
+  PROP_0,
+  PROP_SCALE,
+  PROP_LEARNING_RATE,
+  PROP_THRESHOLD,
+  PROP_BACKGROUND_WEIGHT,
+  PROP_MIN_AREA,
+  PROP_CLASS_ID,
+  PROP_SIMD,
+};
+
+#define NV_BG_SUB_FORMATS "{ NV12, I420, RGBA, BGRx }"
+
+#define NV_BG_SUB_CAPS \
+  GST_VIDEO_CAPS_MAKE (NV_BG_SUB_FORMATS) "; " \
+  GST_NV_BATCH_CAPS_MAKE (NV_BG_SUB_FORMATS)
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_BG_SUB_CAPS));
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_BG_SUB_CAPS));
+
+#define gst_nv_bg_sub_parent_class parent_class
+G_DEFINE_TYPE (GstNvBgSub, gst_nv_bg_sub, GST_TYPE_BASE_TRANSFORM);
+GST_ELEMENT_REGISTER_DEFINE (nvbgsub, "nvbgsub", GST_RANK_NONE,
+    GST_TYPE_NV_BG_SUB);
+
+static void gst_nv_bg_sub_finalize (GObject * object);
+static void gst_nv_bg_sub_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_bg_sub_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static gboolean gst_nv_bg_sub_stop (GstBaseTransform * trans);
+static gboolean gst_nv_bg_sub_set_caps (GstBaseTransform * trans,
+    GstCaps * incaps, GstCaps * outcaps);
+static gboolean gst_nv_bg_sub_sink_event (GstBaseTransform * trans,
+    GstEvent * event);
+static GstFlowReturn gst_nv_bg_sub_transform_ip (GstBaseTransform * trans,
+    GstBuffer * buffer);
+
+static void
+gst_nv_bg_sub_class_init (GstNvBgSubClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_bg_sub_debug, "nvbgsub", 0,
+      "nvbgsub element");
+
+  gobject_class->finalize = gst_nv_bg_sub_finalize;
+  gobject_class->set_property = gst_nv_bg_sub_set_property;
+  gobject_class->get_property = gst_nv_bg_sub_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_SCALE,
+      g_param_spec_uint ("scale", "Scale",
+          "Frame pixels per model pixel along each axis", 1, 256,
+          DEFAULT_SCALE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_LEARNING_RATE,
+      g_param_spec_float ("learning-rate", "Learning rate",
+          "How fast the model adapts; still objects become background "
+          "after about 1 / learning-rate frames",
+          0.0001f, 1.0f, DEFAULT_LEARNING_RATE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_THRESHOLD,
+      g_param_spec_float ("threshold", "Threshold",
+          "Distance in standard deviations within which a pixel matches a "
+          "component of its model", 0.5f, 10.0f, DEFAULT_THRESHOLD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_BACKGROUND_WEIGHT,
+      g_param_spec_float ("background-weight", "Background weight",
+          "Weight a matched component needs for the pixel to be background",
+          0.0f, 1.0f, DEFAULT_BACKGROUND_WEIGHT,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MIN_AREA,
+      g_param_spec_uint ("min-area", "Minimum area",
+          "Foreground frame pixels a blob needs to become an object",
+          0, G_MAXINT, DEFAULT_MIN_AREA,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CLASS_ID,
+      g_param_spec_int ("class-id", "Class id",
+          "Class id of the objects added for foreground blobs",
+          0, G_MAXINT, DEFAULT_CLASS_ID,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SIMD,
+      g_param_spec_enum ("simd", "SIMD",
+          "Highest SIMD level to use, capped at what the CPU supports",
+          GST_TYPE_NV_SIMD_LEVEL, DEFAULT_SIMD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV background subtraction", "Filter/Analyzer/Video",
+      "Adds the foreground blobs of a per-source SIMD Gaussian mixture "
+      "background model as objects",
+      "nv_gst_plugins developers");
+
+  trans_class->stop = GST_DEBUG_FUNCPTR (gst_nv_bg_sub_stop);
+  trans_class->set_caps = GST_DEBUG_FUNCPTR (gst_nv_bg_sub_set_caps);
+  trans_class->sink_event = GST_DEBUG_FUNCPTR (gst_nv_bg_sub_sink_event);
+  trans_class->transform_ip = GST_DEBUG_FUNCPTR (gst_nv_bg_sub_transform_ip);
+  trans_class->passthrough_on_same_caps = FALSE;
+}
+
+static void
+gst_nv_bg_sub_init (GstNvBgSub * self)
+{
+  self->scale = DEFAULT_SCALE;
+  self->learning_rate = DEFAULT_LEARNING_RATE;
+  self->threshold = DEFAULT_THRESHOLD;
+  self->background_weight = DEFAULT_BACKGROUND_WEIGHT;
+  self->min_area = DEFAULT_MIN_AREA;
+  self->class_id = DEFAULT_CLASS_ID;
+  self->simd = DEFAULT_SIMD;
+  self->reconfigure = TRUE;
+
+  gst_video_info_init (&self->info);
+  self->batched = FALSE;
+  self->object_class_id = DEFAULT_CLASS_ID;
+  self->config = new nvgst::BackgroundConfig ();
+  self->models =
+      new std::unordered_map < guint, nvgst::BackgroundSubtractor > ();
+  self->blobs = new std::vector < nvgst::ForegroundBlob > ();
+
+  gst_base_transform_set_in_place (GST_BASE_TRANSFORM (self), TRUE);
+}
+
+static void
+gst_nv_bg_sub_finalize (GObject * object)
+{
+  GstNvBgSub *self = GST_NV_BG_SUB (object);
+
+  delete self->blobs;
+  delete self->models;
+  delete self->config;
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_bg_sub_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvBgSub *self = GST_NV_BG_SUB (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_SCALE:
+      self->scale = g_value_get_uint (value);
+      break;
+    case PROP_LEARNING_RATE:
+      self->learning_rate = g_value_get_float (value);
+      break;
+    case PROP_THRESHOLD:
+      self->threshold = g_value_get_float (value);
+      break;
+    case PROP_BACKGROUND_WEIGHT:
+      self->background_weight = g_value_get_float (value);
+      break;
+    case PROP_MIN_AREA:
+      self->min_area = g_value_get_uint (value);
+      break;
+    case PROP_CLASS_ID:
+      self->class_id = g_value_get_int (value);
+      break;
+    case PROP_SIMD:
+      self->simd = (GstNvSimdLevel) g_value_get_enum (value);
+      break;
+    default:
+      GST_OBJECT_UNLOCK (self);
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      return;
+  }
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_bg_sub_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstNvBgSub *self = GST_NV_BG_SUB (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_SCALE:
+      g_value_set_uint (value, self->scale);
+      break;
+    case PROP_LEARNING_RATE:
+      g_value_set_float (value, self->learning_rate);
+      break;
+    case PROP_THRESHOLD:
+      g_value_set_float (value, self->threshold);
+      break;
+    case PROP_BACKGROUND_WEIGHT:
+      g_value_set_float (value, self->background_weight);
+      break;
+    case PROP_MIN_AREA:
+      g_value_set_uint (value, self->min_area);
+      break;
+    case PROP_CLASS_ID:
+      g_value_set_int (value, self->class_id);
+      break;
+    case PROP_SIMD:
+      g_value_set_enum (value, self->simd);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static gboolean
+gst_nv_bg_sub_stop (GstBaseTransform * trans)
+{
+  GstNvBgSub *self = GST_NV_BG_SUB (trans);
+
+  self->models->clear ();
+
+  return TRUE;
+}
+
+static gboolean
+gst_nv_bg_sub_set_caps (GstBaseTransform * trans, GstCaps * incaps,
+    GstCaps * outcaps)
+{
+  GstNvBgSub *self = GST_NV_BG_SUB (trans);
+  GstCapsFeatures *features = gst_caps_get_features (incaps, 0);
+
+  if (!gst_video_info_from_caps (&self->info, incaps)) {
+    GST_ERROR_OBJECT (self, "invalid caps %" GST_PTR_FORMAT, incaps);
+    return FALSE;
+  }
+  self->batched = features != NULL &&
+      gst_caps_features_contains (features, GST_CAPS_FEATURE_META_GST_NV_BATCH);
+
+  GST_OBJECT_LOCK (self);
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  return TRUE;
+}
+
+/* After a flush the scene may have jumped; every source relearns its
+ * background from its next frame. */
+static gboolean
+gst_nv_bg_sub_sink_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstNvBgSub *self = GST_NV_BG_SUB (trans);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+    for (auto & entry : *self->models)
+      entry.second.reset ();
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->sink_event (trans, event);
+}
+
+/* Takes property and caps changes into every model; models are kept unless
+ * their layout changed. */
+static gboolean
+gst_nv_bg_sub_apply_config (GstNvBgSub * self)
+{
+  nvgst::BackgroundConfig *config = self->config;
+  GstNvSimdLevel simd;
+
+  GST_OBJECT_LOCK (self);
+  if (!self->reconfigure) {
+    GST_OBJECT_UNLOCK (self);
+    return TRUE;
+  }
+  config->scale = (int) self->scale;
+  config->learning_rate = self->learning_rate;
+  config->threshold = self->threshold;
+  config->background_weight = self->background_weight;
+  config->min_area = (int) self->min_area;
+  self->object_class_id = self->class_id;
+  simd = self->simd;
+  self->reconfigure = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  config->format =
+      gst_nv_pixel_format_from_video_format (GST_VIDEO_INFO_FORMAT
+      (&self->info));
+  config->width = GST_VIDEO_INFO_WIDTH (&self->info);
+  config->height = GST_VIDEO_INFO_HEIGHT (&self->info);
+  config->simd = gst_nv_simd_level_resolve (simd);
+
+  for (auto & entry : *self->models) {
+    if (!entry.second.configure (*config))
+      return FALSE;
+  }
+
+  GST_INFO_OBJECT (self, "modelling %s%dx%d frames at 1/%d scale, learning "
+      "rate %g, threshold %.2f, using %s kernels",
+      self->batched ? "batched " : "", config->width, config->height,
+      config->scale, config->learning_rate, config->threshold,
+      nvgst::simd_level_name (config->simd));
+
+  return TRUE;
+}
+
+static nvgst::BackgroundSubtractor *
+gst_nv_bg_sub_get_model (GstNvBgSub * self, guint source_id)
+{
+  auto it = self->models->find (source_id);
+
+  if (it == self->models->end ()) {
+    GST_DEBUG_OBJECT (self, "new model for source %u", source_id);
+    it = self->models->emplace (source_id,
+        nvgst::BackgroundSubtractor ()).first;
+    if (!it->second.configure (*self->config)) {
+      self->models->erase (it);
+      return NULL;
+    }
+  }
+
+  return &it->second;
+}
+
+/* Appends the blobs of frame frame_index to objects. */
+static void
+gst_nv_bg_sub_store (GstNvBgSub * self, guint frame_index,
+    nvgst::ObjectList * objects)
+{
+  for (const nvgst::ForegroundBlob & blob : *self->blobs) {
+    const gint box = (blob.x1 - blob.x0) * (blob.y1 - blob.y0);
+    nvgst::DetectedObject object = { };
+
+    object.frame = frame_index;
+    object.class_id = self->object_class_id;
+    object.confidence = MIN (1.0f, (gfloat) blob.area / box);
+    object.x = (gfloat) blob.x0;
+    object.y = (gfloat) blob.y0;
+    object.width = (gfloat) (blob.x1 - blob.x0);
+    object.height = (gfloat) (blob.y1 - blob.y0);
+    object.track_id = nvgst::kNoTrack;
+    objects->push_back (object);
+  }
+}
+
+static GstFlowReturn
+gst_nv_bg_sub_update_batch (GstNvBgSub * self, GstBuffer * buffer,
+    nvgst::ObjectList * objects)
+{
+  GstNvBatchMeta *bmeta = gst_buffer_get_nv_batch_meta (buffer);
+  GstMapInfo map;
+
+  if (bmeta == NULL) {
+    GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
+        ("batched buffer without GstNvBatchMeta"));
+    return GST_FLOW_ERROR;
+  }
+
+  for (guint i = 0; i < bmeta->n_frames; i++) {
+    nvgst::BackgroundSubtractor *model =
+        gst_nv_bg_sub_get_model (self, bmeta->frames[i].source_id);
+
+    if (model == NULL) {
+      GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS, (NULL),
+          ("invalid background model configuration"));
+      return GST_FLOW_ERROR;
+    }
+    if (!gst_nv_batch_meta_map_frame (bmeta, buffer, i, &map, GST_MAP_READ)) {
+      GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL),
+          ("failed to map frame %u of the batch", i));
+      return GST_FLOW_ERROR;
+    }
+    model->update (gst_nv_batch_frame_view (&bmeta->frames[i], &self->info,
+            &map), self->blobs);
+    gst_nv_batch_meta_unmap_frame (bmeta, buffer, i, &map);
+
+    gst_nv_bg_sub_store (self, i, objects);
+  }
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_nv_bg_sub_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
+{
+  GstNvBgSub *self = GST_NV_BG_SUB (trans);
+  GstNvObjectMeta *ometa;
+  gsize before;
+
+  if (!gst_nv_bg_sub_apply_config (self)) {
+    GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS, (NULL),
+        ("invalid background model configuration"));
+    return GST_FLOW_ERROR;
+  }
+
+  ometa = gst_buffer_get_nv_object_meta (buffer);
+  if (ometa == NULL)
+    ometa = gst_buffer_add_nv_object_meta (buffer);
+  before = ometa->objects->size ();
+
+  if (self->batched) {
+    GstFlowReturn ret = gst_nv_bg_sub_update_batch (self, buffer,
+        ometa->objects);
+
+    if (ret != GST_FLOW_OK)
+      return ret;
+  } else {
+    nvgst::BackgroundSubtractor *model = gst_nv_bg_sub_get_model (self, 0);
+    GstVideoFrame frame;
+
+    if (model == NULL) {
+      GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS, (NULL),
+          ("invalid background model configuration"));
+      return GST_FLOW_ERROR;
+    }
+    if (!gst_video_frame_map (&frame, &self->info, buffer, GST_MAP_READ)) {
+      GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL),
+          ("failed to map frame"));
+      return GST_FLOW_ERROR;
+    }
+    model->update (gst_nv_frame_view_from_video_frame (&frame), self->blobs);
+    gst_video_frame_unmap (&frame);
+
+    gst_nv_bg_sub_store (self, 0, ometa->objects);
+  }
+
+  GST_LOG_OBJECT (self, "%" G_GSIZE_FORMAT " foreground objects",
+      ometa->objects->size () - before);
+
+  return GST_FLOW_OK;
+}
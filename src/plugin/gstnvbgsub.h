@@ -0,0 +1,63 @@
+#ifndef __GST_NV_BG_SUB_H__
+#define __GST_NV_BG_SUB_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include <gst/video/video.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "gstnvutils.h"
+#include "core/background.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_NV_BG_SUB \
+  (gst_nv_bg_sub_get_type())
+#define GST_NV_BG_SUB(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_BG_SUB,GstNvBgSub))
+#define GST_NV_BG_SUB_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_BG_SUB,GstNvBgSubClass))
+#define GST_IS_NV_BG_SUB(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_BG_SUB))
+
+typedef struct _GstNvBgSub GstNvBgSub;
+typedef struct _GstNvBgSubClass GstNvBgSubClass;
+
+struct _GstNvBgSub
+{
+  GstBaseTransform parent;
+
+  /* properties, protected by the object lock */
+  guint scale;
+  gfloat learning_rate;
+  gfloat threshold;
+  gfloat background_weight;
+  guint min_area;
+  gint class_id;
+  GstNvSimdLevel simd;
+  gboolean reconfigure;
+
+  /* streaming thread only */
+  GstVideoInfo info;
+  gboolean batched;
+  gint object_class_id;
+  nvgst::BackgroundConfig *config;
+  /* one model per source id; single frames use source 0 */
+  std::unordered_map<guint, nvgst::BackgroundSubtractor> *models;
+  std::vector<nvgst::ForegroundBlob> *blobs;
+};
+
+struct _GstNvBgSubClass
+{
+  GstBaseTransformClass parent_class;
+};
+
+GType gst_nv_bg_sub_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvbgsub);
+
+G_END_DECLS
+
+#endif /* __GST_NV_BG_SUB_H__ */
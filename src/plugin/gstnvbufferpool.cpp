@@ -0,0 +1,112 @@
+#include "gstnvbufferpool.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_buffer_pool_debug);
+#define GST_CAT_DEFAULT gst_nv_buffer_pool_debug
+
+#define gst_nv_buffer_pool_parent_class parent_class
+G_DEFINE_TYPE_WITH_CODE (GstNvBufferPool, gst_nv_buffer_pool,
+    GST_TYPE_VIDEO_BUFFER_POOL,
+    GST_DEBUG_CATEGORY_INIT (gst_nv_buffer_pool_debug, "nvbufferpool", 0,
+        "aligned preallocated video buffer pool"));
+
+static gboolean
+gst_nv_buffer_pool_set_config (GstBufferPool * pool, GstStructure * config)
+{
+  GstAllocator *allocator = NULL;
+  GstAllocationParams params;
+
+  if (!gst_buffer_pool_config_get_allocator (config, &allocator, &params))
+    return FALSE;
+
+  /* align is a mask: 63 asks for 64-byte aligned memory */
+  params.align |= GST_NV_BUFFER_POOL_ALIGN - 1;
+  gst_buffer_pool_config_set_allocator (config, allocator, &params);
+
+  /* Padded strides are only safe when the consumer reads them from
+   * GstVideoMeta; without it the default layout is kept. */
+  if (gst_buffer_pool_config_has_option (config,
+          GST_BUFFER_POOL_OPTION_VIDEO_META)) {
+    GstVideoAlignment align;
+
+    if (gst_buffer_pool_config_has_option (config,
+            GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT)) {
+      gst_buffer_pool_config_get_video_alignment (config, &align);
+    } else {
+      gst_video_alignment_reset (&align);
+      gst_buffer_pool_config_add_option (config,
+          GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT);
+    }
+    for (guint i = 0; i < GST_VIDEO_MAX_PLANES; i++)
+      align.stride_align[i] |= GST_NV_BUFFER_POOL_ALIGN - 1;
+    gst_buffer_pool_config_set_video_alignment (config, &align);
+  }
+
+  GST_DEBUG_OBJECT (pool, "config %" GST_PTR_FORMAT, config);
+
+  return GST_BUFFER_POOL_CLASS (parent_class)->set_config (pool, config);
+}
+
+static void
+gst_nv_buffer_pool_class_init (GstNvBufferPoolClass * klass)
+{
+  GstBufferPoolClass *pool_class = GST_BUFFER_POOL_CLASS (klass);
+
+  pool_class->set_config = gst_nv_buffer_pool_set_config;
+}
+
+static void
+gst_nv_buffer_pool_init (GstNvBufferPool * pool)
+{
+}
+
+GstBufferPool *
+gst_nv_buffer_pool_new (void)
+{
+  GstBufferPool *pool;
+
+  pool = GST_BUFFER_POOL (g_object_new (GST_TYPE_NV_BUFFER_POOL, NULL));
+  gst_object_ref_sink (pool);
+
+  return pool;
+}
+
+GstBufferPool *
+gst_nv_buffer_pool_new_configured (GstCaps * caps, guint min, guint max,
+    gboolean video_meta)
+{
+  GstBufferPool *pool;
+  GstStructure *config;
+  GstVideoInfo info;
+
+  if (!gst_video_info_from_caps (&info, caps))
+    return NULL;
+
+  pool = gst_nv_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, caps, info.size, min, max);
+  if (video_meta)
+    gst_buffer_pool_config_add_option (config,
+        GST_BUFFER_POOL_OPTION_VIDEO_META);
+
+  if (!gst_buffer_pool_set_config (pool, config)) {
+    GST_WARNING_OBJECT (pool, "failed to configure pool for %" GST_PTR_FORMAT,
+        caps);
+    gst_object_unref (pool);
+    return NULL;
+  }
+
+  return pool;
+}
+
+guint
+gst_nv_buffer_pool_get_buffer_size (GstBufferPool * pool)
+{
+  GstStructure *config;
+  guint size = 0;
+
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_get_params (config, NULL, &size, NULL, NULL);
+  gst_structure_free (config);
+
+  return size;
+}
@@ -0,0 +1,59 @@
+/* Video buffer pool with cache-line aligned planes and a fully preallocated
+ * working set. */
+#ifndef __GST_NV_BUFFER_POOL_H__
+#define __GST_NV_BUFFER_POOL_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include <gst/video/gstvideopool.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_NV_BUFFER_POOL \
+  (gst_nv_buffer_pool_get_type())
+#define GST_NV_BUFFER_POOL(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_BUFFER_POOL,GstNvBufferPool))
+#define GST_IS_NV_BUFFER_POOL(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_BUFFER_POOL))
+
+/* Byte alignment of the buffer start and of every plane stride. */
+#define GST_NV_BUFFER_POOL_ALIGN 64
+
+typedef struct _GstNvBufferPool GstNvBufferPool;
+typedef struct _GstNvBufferPoolClass GstNvBufferPoolClass;
+
+/**
+ * GstNvBufferPool:
+ *
+ * A #GstVideoBufferPool that always aligns plane strides and the memory
+ * start to %GST_NV_BUFFER_POOL_ALIGN when the consumer supports
+ * #GstVideoMeta, and keeps all of its buffers allocated from start() on.
+ * Once the pool is active, acquire/release cycles do not touch the heap.
+ */
+struct _GstNvBufferPool
+{
+  GstVideoBufferPool parent;
+};
+
+struct _GstNvBufferPoolClass
+{
+  GstVideoBufferPoolClass parent_class;
+};
+
+GType gst_nv_buffer_pool_get_type (void);
+
+GstBufferPool *gst_nv_buffer_pool_new (void);
+
+/* Creates a configured pool for @caps. @min buffers are allocated when the
+ * pool is activated; @max of 0 means unlimited. @video_meta must be TRUE
+ * only when the consumer supports #GstVideoMeta, otherwise the default
+ * unpadded layout is used. Returns NULL if the configuration is rejected. */
+GstBufferPool *gst_nv_buffer_pool_new_configured (GstCaps * caps, guint min,
+    guint max, gboolean video_meta);
+
+/* Size of one buffer of a configured pool. */
+guint gst_nv_buffer_pool_get_buffer_size (GstBufferPool * pool);
+
+G_END_DECLS
+
+#endif /* __GST_NV_BUFFER_POOL_H__ */
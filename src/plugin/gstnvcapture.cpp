@@ -0,0 +1,479 @@
+#include "gstnvcapture.h"
+
+#include <string.h>
+
+#include "gstnvanalyticsmeta.h"
+#include "gstnvbatchmeta.h"
+#include "gstnvmotionmeta.h"
+#include "gstnvobjectmeta.h"
+#include "gstnvreidmeta.h"
+#include "gstnvroimeta.h"
+#include "gstnvtensormeta.h"
+
+/* GstVideoMeta */
+typedef struct
+{
+  guint32 format;
+  guint32 width;
+  guint32 height;
+  guint32 n_planes;
+  guint64 offset[GST_VIDEO_MAX_PLANES];
+  gint32 stride[GST_VIDEO_MAX_PLANES];
+} GstNvCaptureVideo;
+
+/* GstNvBatchMeta: the header, then n_frames of these */
+typedef struct
+{
+  guint32 max_frames;
+  guint32 n_frames;
+  guint64 reserved;
+} GstNvCaptureBatch;
+
+typedef struct
+{
+  guint32 source_id;
+  /* data block of the record holding the frame */
+  guint32 block;
+  guint64 frame_num;
+  guint64 pts;
+  guint64 duration;
+  guint64 running_time;
+  guint64 offset;
+  guint64 size;
+  guint64 plane_offset[GST_VIDEO_MAX_PLANES];
+  gint32 stride[GST_VIDEO_MAX_PLANES];
+} GstNvCaptureBatchFrame;
+
+/* Every other block is an array of items copied as they are. After the
+ * header come rank int32 dimensions and a name of name_len bytes (for the
+ * analytics blocks, the NUL-terminated names of the lines and zones, which
+ * the items refer to by index); the items start on the next 16 bytes, so
+ * float tensors can be used in place. */
+typedef struct
+{
+  guint32 item_size;
+  guint32 count;
+  guint32 name_len;
+  guint32 rank;
+  /* which meta of its API on the buffer the block came from */
+  guint32 group;
+  guint32 reserved[3];
+} GstNvCaptureArray;
+
+typedef struct
+{
+  const GstNvCaptureArray *header;
+  const gint32 *dims;
+  const gchar *name;
+  const guint8 *items;
+} GstNvCaptureArrayView;
+
+#define GST_NV_CAPTURE_ARRAY_HEAD(rank, name_len) \
+  GST_ROUND_UP_16 (sizeof (GstNvCaptureArray) + (rank) * sizeof (gint32) + \
+      (name_len))
+
+static void
+gst_nv_capture_add_array (nvgst::CaptureBlocks * blocks, guint32 type,
+    guint group, const gint32 * dims, guint rank, const gchar * name,
+    gsize name_len, gconstpointer items, gsize item_size, gsize count)
+{
+  gsize head = GST_NV_CAPTURE_ARRAY_HEAD (rank, name_len);
+  guint8 *data = blocks->add (type, head + item_size * count);
+  GstNvCaptureArray *array = (GstNvCaptureArray *) data;
+
+  array->item_size = item_size;
+  array->count = count;
+  array->name_len = name_len;
+  array->rank = rank;
+  array->group = group;
+  data += sizeof (GstNvCaptureArray);
+  if (rank > 0)
+    memcpy (data, dims, rank * sizeof (gint32));
+  if (name_len > 0)
+    memcpy (data + rank * sizeof (gint32), name, name_len);
+  if (count > 0)
+    memcpy ((guint8 *) array + head, items, item_size * count);
+}
+
+static gboolean
+gst_nv_capture_parse_array (const nvgst::CaptureBlock & block,
+    gsize item_size, GstNvCaptureArrayView * view)
+{
+  const GstNvCaptureArray *array = (const GstNvCaptureArray *) block.data;
+  gsize head;
+
+  if (block.size < sizeof (GstNvCaptureArray) || array->item_size != item_size
+      || array->rank > 8 || array->name_len > 4096)
+    return FALSE;
+  head = GST_NV_CAPTURE_ARRAY_HEAD (array->rank, array->name_len);
+  if (head > block.size || array->count > (block.size - head) / item_size)
+    return FALSE;
+
+  view->header = array;
+  view->dims = (const gint32 *) (block.data + sizeof (GstNvCaptureArray));
+  view->name = (const gchar *) (view->dims + array->rank);
+  view->items = block.data + head;
+  return TRUE;
+}
+
+/* Names of the lines and zones of an analytics block, NUL-terminated back
+ * to back; items carry their index instead of the quark. */
+static guint32
+gst_nv_capture_roi_index (GQuark roi, std::vector<GQuark> *rois,
+    std::string * names)
+{
+  for (gsize i = 0; i < rois->size (); i++) {
+    if ((*rois)[i] == roi)
+      return i;
+  }
+  rois->push_back (roi);
+  names->append (g_quark_to_string (roi));
+  names->push_back ('\0');
+  return rois->size () - 1;
+}
+
+static void
+gst_nv_capture_write_analytics (GstNvAnalyticsMeta * ameta, guint group,
+    nvgst::CaptureBlocks * blocks)
+{
+  std::vector<GQuark> rois;
+  std::string names;
+  std::vector<GstNvAnalyticsEvent> events (*ameta->events);
+  std::vector<GstNvAnalyticsCount> counts (*ameta->counts);
+
+  for (GstNvAnalyticsEvent & event : events)
+    event.roi = gst_nv_capture_roi_index (event.roi, &rois, &names);
+  gst_nv_capture_add_array (blocks, GST_NV_CAPTURE_BLOCK_ANALYTICS_EVENTS,
+      group, NULL, 0, names.data (), names.size (), events.data (),
+      sizeof (GstNvAnalyticsEvent), events.size ());
+
+  rois.clear ();
+  names.clear ();
+  for (GstNvAnalyticsCount & count : counts)
+    count.roi = gst_nv_capture_roi_index (count.roi, &rois, &names);
+  gst_nv_capture_add_array (blocks, GST_NV_CAPTURE_BLOCK_ANALYTICS_COUNTS,
+      group, NULL, 0, names.data (), names.size (), counts.data (),
+      sizeof (GstNvAnalyticsCount), counts.size ());
+}
+
+static void
+gst_nv_capture_write_batch (GstNvBatchMeta * bmeta,
+    nvgst::CaptureBlocks * blocks, std::vector<GstBuffer *> *frames)
+{
+  guint8 *data = blocks->add (GST_NV_CAPTURE_BLOCK_BATCH,
+      sizeof (GstNvCaptureBatch) +
+      bmeta->n_frames * sizeof (GstNvCaptureBatchFrame));
+  GstNvCaptureBatch *batch = (GstNvCaptureBatch *) data;
+  GstNvCaptureBatchFrame *out =
+      (GstNvCaptureBatchFrame *) (data + sizeof (GstNvCaptureBatch));
+
+  batch->max_frames = bmeta->max_frames;
+  batch->n_frames = bmeta->n_frames;
+  for (guint i = 0; i < bmeta->n_frames; i++) {
+    const GstNvBatchFrame *frame = &bmeta->frames[i];
+    guint32 block = 0;
+
+    if (frame->buffer) {
+      while (block < frames->size () && (*frames)[block] != frame->buffer)
+        block++;
+      if (block == frames->size ())
+        frames->push_back (frame->buffer);
+      block++;
+    }
+    out[i].source_id = frame->source_id;
+    out[i].block = block;
+    out[i].frame_num = frame->frame_num;
+    out[i].pts = frame->pts;
+    out[i].duration = frame->duration;
+    out[i].running_time = frame->running_time;
+    out[i].offset = frame->offset;
+    out[i].size = frame->size;
+    for (guint p = 0; p < GST_VIDEO_MAX_PLANES; p++) {
+      out[i].plane_offset[p] = frame->plane_offset[p];
+      out[i].stride[p] = frame->stride[p];
+    }
+  }
+}
+
+void
+gst_nv_capture_write_metas (GstBuffer * buffer, nvgst::CaptureBlocks * blocks,
+    std::vector<GstBuffer *> *frames)
+{
+  GstVideoMeta *vmeta = gst_buffer_get_video_meta (buffer);
+  GstNvBatchMeta *bmeta = gst_buffer_get_nv_batch_meta (buffer);
+  GstNvObjectMeta *ometa = gst_buffer_get_nv_object_meta (buffer);
+  GstNvMotionMeta *mmeta = gst_buffer_get_nv_motion_meta (buffer);
+  GstNvReidMeta *rmeta = gst_buffer_get_nv_reid_meta (buffer);
+  gpointer state;
+  GstMeta *meta;
+  guint group;
+
+  if (vmeta && vmeta->n_planes <= GST_VIDEO_MAX_PLANES) {
+    GstNvCaptureVideo *video = (GstNvCaptureVideo *)
+        blocks->add (GST_NV_CAPTURE_BLOCK_VIDEO, sizeof (GstNvCaptureVideo));
+
+    video->format = vmeta->format;
+    video->width = vmeta->width;
+    video->height = vmeta->height;
+    video->n_planes = vmeta->n_planes;
+    for (guint p = 0; p < vmeta->n_planes; p++) {
+      video->offset[p] = vmeta->offset[p];
+      video->stride[p] = vmeta->stride[p];
+    }
+  }
+
+  if (bmeta)
+    gst_nv_capture_write_batch (bmeta, blocks, frames);
+
+  if (ometa)
+    gst_nv_capture_add_array (blocks, GST_NV_CAPTURE_BLOCK_OBJECTS, 0, NULL,
+        0, NULL, 0, ometa->objects->data (), sizeof (nvgst::DetectedObject),
+        ometa->objects->size ());
+
+  state = NULL;
+  group = 0;
+  while ((meta = gst_buffer_iterate_meta_filtered (buffer, &state,
+              GST_NV_TENSOR_META_API_TYPE)) != NULL) {
+    for (const nvgst::Tensor & tensor : *((GstNvTensorMeta *) meta)->tensors)
+      gst_nv_capture_add_array (blocks, GST_NV_CAPTURE_BLOCK_TENSOR, group,
+          tensor.info.shape.data (), tensor.info.shape.size (),
+          tensor.info.name.data (), tensor.info.name.size (),
+          tensor.data.get (), sizeof (gfloat), tensor.info.count ());
+    group++;
+  }
+
+  state = NULL;
+  group = 0;
+  while ((meta = gst_buffer_iterate_meta_filtered (buffer, &state,
+              GST_NV_ROI_META_API_TYPE)) != NULL) {
+    GstNvRoiMeta *roi = (GstNvRoiMeta *) meta;
+    const gchar *name = g_quark_to_string (roi->tensor);
+
+    gst_nv_capture_add_array (blocks, GST_NV_CAPTURE_BLOCK_ROIS, group++,
+        NULL, 0, name, strlen (name), roi->rois->data (),
+        sizeof (GstNvRoiRef), roi->rois->size ());
+  }
+
+  state = NULL;
+  group = 0;
+  while ((meta = gst_buffer_iterate_meta_filtered (buffer, &state,
+              GST_NV_ANALYTICS_META_API_TYPE)) != NULL)
+    gst_nv_capture_write_analytics ((GstNvAnalyticsMeta *) meta, group++,
+        blocks);
+
+  if (mmeta)
+    gst_nv_capture_add_array (blocks, GST_NV_CAPTURE_BLOCK_MOTION, 0, NULL, 0,
+        NULL, 0, mmeta->frames, sizeof (GstNvMotionFrame), mmeta->n_frames);
+
+  if (rmeta)
+    gst_nv_capture_add_array (blocks, GST_NV_CAPTURE_BLOCK_REID, 0, NULL, 0,
+        NULL, 0, rmeta->matches->data (), sizeof (GstNvReidMatch),
+        rmeta->matches->size ());
+}
+
+static void
+gst_nv_capture_read_batch (GstBuffer * buffer,
+    const nvgst::CaptureBlock & block,
+    const std::vector<GstBuffer *> & frames)
+{
+  const GstNvCaptureBatch *batch = (const GstNvCaptureBatch *) block.data;
+  const GstNvCaptureBatchFrame *in;
+  GstNvBatchMeta *bmeta;
+
+  if (block.size < sizeof (GstNvCaptureBatch)
+      || batch->max_frames > GST_NV_BATCH_MAX_FRAMES
+      || batch->n_frames > batch->max_frames
+      || block.size < sizeof (GstNvCaptureBatch) +
+      batch->n_frames * sizeof (GstNvCaptureBatchFrame))
+    return;
+
+  in = (const GstNvCaptureBatchFrame *) (block.data +
+      sizeof (GstNvCaptureBatch));
+  bmeta = gst_buffer_add_nv_batch_meta (buffer, batch->max_frames);
+  for (guint i = 0; i < batch->n_frames; i++) {
+    GstNvBatchFrame *frame = &bmeta->frames[bmeta->n_frames];
+
+    if (in[i].block >= frames.size ())
+      continue;
+    frame->source_id = in[i].source_id;
+    frame->frame_num = in[i].frame_num;
+    frame->pts = in[i].pts;
+    frame->duration = in[i].duration;
+    frame->running_time = in[i].running_time;
+    frame->buffer = in[i].block > 0 ?
+        gst_buffer_ref (frames[in[i].block]) : NULL;
+    frame->offset = in[i].offset;
+    frame->size = in[i].size;
+    for (guint p = 0; p < GST_VIDEO_MAX_PLANES; p++) {
+      frame->plane_offset[p] = in[i].plane_offset[p];
+      frame->stride[p] = in[i].stride[p];
+    }
+    bmeta->n_frames++;
+  }
+}
+
+/* Quarks of the names of an analytics block, in index order. */
+static gboolean
+gst_nv_capture_read_rois (const GstNvCaptureArrayView * view,
+    std::vector<GQuark> *rois)
+{
+  const gchar *name = view->name;
+  const gchar *end = view->name + view->header->name_len;
+
+  while (name < end) {
+    const gchar *nul = (const gchar *) memchr (name, '\0', end - name);
+
+    if (nul == NULL)
+      return FALSE;
+    rois->push_back (g_quark_from_string (name));
+    name = nul + 1;
+  }
+  return TRUE;
+}
+
+void
+gst_nv_capture_read_metas (GstBuffer * buffer,
+    const nvgst::CaptureRecord * record,
+    const std::vector<GstBuffer *> & frames,
+    const std::shared_ptr<nvgst::CaptureReader> & reader)
+{
+  GstNvTensorMeta *tmeta = NULL;
+  GstNvAnalyticsMeta *ameta = NULL;
+  guint tensor_group = 0;
+  guint analytics_group = 0;
+  GstNvCaptureArrayView view;
+  std::vector<GQuark> rois;
+
+  for (const nvgst::CaptureBlock & block : record->blocks) {
+    switch (block.type) {
+      case GST_NV_CAPTURE_BLOCK_VIDEO:{
+        const GstNvCaptureVideo *video = (const GstNvCaptureVideo *) block.data;
+        gsize offset[GST_VIDEO_MAX_PLANES] = { 0, };
+        gint stride[GST_VIDEO_MAX_PLANES] = { 0, };
+
+        if (block.size < sizeof (GstNvCaptureVideo)
+            || video->n_planes > GST_VIDEO_MAX_PLANES)
+          break;
+        for (guint p = 0; p < video->n_planes; p++) {
+          offset[p] = video->offset[p];
+          stride[p] = video->stride[p];
+        }
+        gst_buffer_add_video_meta_full (buffer, GST_VIDEO_FRAME_FLAG_NONE,
+            (GstVideoFormat) video->format, video->width, video->height,
+            video->n_planes, offset, stride);
+        break;
+      }
+      case GST_NV_CAPTURE_BLOCK_BATCH:
+        gst_nv_capture_read_batch (buffer, block, frames);
+        break;
+      case GST_NV_CAPTURE_BLOCK_OBJECTS:{
+        GstNvObjectMeta *ometa;
+        const nvgst::DetectedObject *objects;
+
+        if (!gst_nv_capture_parse_array (block, sizeof (nvgst::DetectedObject),
+                &view))
+          break;
+        objects = (const nvgst::DetectedObject *) view.items;
+        ometa = gst_buffer_add_nv_object_meta (buffer);
+        ometa->objects->assign (objects, objects + view.header->count);
+        break;
+      }
+      case GST_NV_CAPTURE_BLOCK_TENSOR:{
+        nvgst::Tensor tensor;
+        std::shared_ptr<nvgst::CaptureReader> owner = reader;
+
+        if (!gst_nv_capture_parse_array (block, sizeof (gfloat), &view))
+          break;
+        tensor.info.name.assign (view.name, view.header->name_len);
+        tensor.info.shape.assign (view.dims, view.dims + view.header->rank);
+        if (tensor.info.count () != view.header->count)
+          break;
+        /* read-only, like every tensor; the mapping outlives it */
+        tensor.data = std::shared_ptr<gfloat> ((gfloat *) view.items,
+            [owner] (gfloat *) { });
+        if (tmeta == NULL || view.header->group != tensor_group) {
+          tmeta = gst_buffer_add_nv_tensor_meta (buffer);
+          tensor_group = view.header->group;
+        }
+        tmeta->tensors->push_back (std::move (tensor));
+        break;
+      }
+      case GST_NV_CAPTURE_BLOCK_ROIS:{
+        GstNvRoiMeta *roi;
+        const GstNvRoiRef *refs;
+        gchar *name;
+
+        if (!gst_nv_capture_parse_array (block, sizeof (GstNvRoiRef), &view))
+          break;
+        name = g_strndup (view.name, view.header->name_len);
+        roi = gst_buffer_add_nv_roi_meta (buffer, name);
+        g_free (name);
+        refs = (const GstNvRoiRef *) view.items;
+        roi->rois->assign (refs, refs + view.header->count);
+        break;
+      }
+      case GST_NV_CAPTURE_BLOCK_ANALYTICS_EVENTS:
+      case GST_NV_CAPTURE_BLOCK_ANALYTICS_COUNTS:{
+        gboolean events = block.type == GST_NV_CAPTURE_BLOCK_ANALYTICS_EVENTS;
+
+        if (!gst_nv_capture_parse_array (block, events ?
+                sizeof (GstNvAnalyticsEvent) : sizeof (GstNvAnalyticsCount),
+                &view))
+          break;
+        rois.clear ();
+        if (!gst_nv_capture_read_rois (&view, &rois))
+          break;
+        if (ameta == NULL || view.header->group != analytics_group) {
+          ameta = gst_buffer_add_nv_analytics_meta (buffer);
+          analytics_group = view.header->group;
+        }
+        for (guint i = 0; i < view.header->count; i++) {
+          if (events) {
+            GstNvAnalyticsEvent event;
+
+            memcpy (&event, view.items + i * sizeof (event), sizeof (event));
+            if (event.roi >= rois.size ())
+              continue;
+            event.roi = rois[event.roi];
+            ameta->events->push_back (event);
+          } else {
+            GstNvAnalyticsCount count;
+
+            memcpy (&count, view.items + i * sizeof (count), sizeof (count));
+            if (count.roi >= rois.size ())
+              continue;
+            count.roi = rois[count.roi];
+            ameta->counts->push_back (count);
+          }
+        }
+        break;
+      }
+      case GST_NV_CAPTURE_BLOCK_MOTION:{
+        GstNvMotionMeta *mmeta;
+
+        if (!gst_nv_capture_parse_array (block, sizeof (GstNvMotionFrame),
+                &view) || view.header->count > GST_NV_BATCH_MAX_FRAMES)
+          break;
+        mmeta = gst_buffer_add_nv_motion_meta (buffer);
+        mmeta->n_frames = view.header->count;
+        memcpy (mmeta->frames, view.items,
+            view.header->count * sizeof (GstNvMotionFrame));
+        break;
+      }
+      case GST_NV_CAPTURE_BLOCK_REID:{
+        GstNvReidMeta *rmeta;
+        const GstNvReidMatch *matches;
+
+        if (!gst_nv_capture_parse_array (block, sizeof (GstNvReidMatch),
+                &view))
+          break;
+        rmeta = gst_buffer_add_nv_reid_meta (buffer);
+        matches = (const GstNvReidMatch *) view.items;
+        rmeta->matches->assign (matches, matches + view.header->count);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+}
@@ -0,0 +1,48 @@
+/* Contents of the capture files nvcapturesink writes and nvreplaysrc
+ * replays: the caps, and the plane layout and nv metadata of each buffer.
+ * Draw lists and snapshots are not captured; they are outputs, not inputs
+ * of the elements being measured. */
+#ifndef __GST_NV_CAPTURE_H__
+#define __GST_NV_CAPTURE_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include <memory>
+#include <vector>
+
+#include "core/capture.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+  GST_NV_CAPTURE_BLOCK_CAPS = nvgst::kCaptureUserBlock,
+  GST_NV_CAPTURE_BLOCK_VIDEO,
+  GST_NV_CAPTURE_BLOCK_BATCH,
+  GST_NV_CAPTURE_BLOCK_OBJECTS,
+  GST_NV_CAPTURE_BLOCK_TENSOR,
+  GST_NV_CAPTURE_BLOCK_ROIS,
+  GST_NV_CAPTURE_BLOCK_ANALYTICS_EVENTS,
+  GST_NV_CAPTURE_BLOCK_ANALYTICS_COUNTS,
+  GST_NV_CAPTURE_BLOCK_MOTION,
+  GST_NV_CAPTURE_BLOCK_REID,
+} GstNvCaptureBlockType;
+
+/* Adds the plane layout and metadata of @buffer to @blocks. The frames of
+ * a zero-copy batch live in buffers of their own: they are appended to
+ * @frames, once each, and the batch block names them as data blocks 1 and
+ * up, data block 0 being @buffer's own memory. */
+void gst_nv_capture_write_metas (GstBuffer * buffer,
+    nvgst::CaptureBlocks * blocks, std::vector<GstBuffer *> * frames);
+
+/* Attaches the plane layout and metadata of @record to @buffer. @frames
+ * wraps the record's data blocks in order, @buffer's own memory at 0.
+ * Tensors point into the mapping and keep @reader alive. */
+void gst_nv_capture_read_metas (GstBuffer * buffer,
+    const nvgst::CaptureRecord * record,
+    const std::vector<GstBuffer *> & frames,
+    const std::shared_ptr<nvgst::CaptureReader> & reader);
+
+G_END_DECLS
+
+#endif /* __GST_NV_CAPTURE_H__ */
@@ -0,0 +1,416 @@
+/**
+ * SECTION:element-nvcapturesink
+ *
+ * Writes a stream, raw frames and all, to a capture file that nvreplaysrc
+ * plays back: the caps, then every buffer with its timestamps, flags,
+ * plane layout and nv metadata (batch, objects, tensors, ROI references,
+ * analytics, motion and re-ID results). Frames are stored as they are,
+ * 64-byte aligned, so the replay source can hand out the mapped file
+ * without copying or decoding. Zero-copy batches are stored with every
+ * frame buffer and replayed as such.
+ *
+ * Writing happens on a thread of its own through io_uring, or pwritev()
+ * where the kernel does not allow io_uring. A capture is only useful
+ * complete, so nothing is dropped: when more than
+ * #GstNvCaptureSink:max-backlog bytes are waiting for the disk, the
+ * streaming thread waits. Raw video is large; put the file on a disk that
+ * keeps up, or capture a short clip and replay it with
+ * #GstNvReplaySrc:loops.
+ *
+ * The index of the records is written when the element stops, and an
+ * element message "nvcapture-done" with the location, records and bytes
+ * is posted then. A file cut short (a crash, a full disk) still replays
+ * up to its last complete record.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 -e filesrc location=store.mp4 ! decodebin ! nvconvert ! \
+ *     video/x-raw,format=NV12 ! nvinfer ! nvpostprocess ! nvtracker ! \
+ *     nvcapturesink location=store.nvcap
+ * ]|
+ */
+
+#include "gstnvcapturesink.h"
+
+#include "gstnvcapture.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_capture_sink_debug);
+#define GST_CAT_DEFAULT gst_nv_capture_sink_debug
+
+#define DEFAULT_LOCATION "capture.nvcap"
+#define DEFAULT_MAX_BACKLOG (256 * 1024 * 1024)
+
+enum
+{
+  PROP_0,
+  PROP_LOCATION,
+  PROP_MAX_BACKLOG,
+  PROP_RECORDS,
+  PROP_BYTES,
+};
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+/* A mapped buffer handed to the writer. */
+typedef struct
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+} GstNvCaptureSinkChunk;
+
+static void
+gst_nv_capture_sink_release_chunk (void *token)
+{
+  GstNvCaptureSinkChunk *chunk = (GstNvCaptureSinkChunk *) token;
+
+  gst_buffer_unmap (chunk->buffer, &chunk->map);
+  gst_buffer_unref (chunk->buffer);
+  g_free (chunk);
+}
+
+#define gst_nv_capture_sink_parent_class parent_class
+G_DEFINE_TYPE (GstNvCaptureSink, gst_nv_capture_sink, GST_TYPE_BASE_SINK);
+GST_ELEMENT_REGISTER_DEFINE (nvcapturesink, "nvcapturesink", GST_RANK_NONE,
+    GST_TYPE_NV_CAPTURE_SINK);
+
+static void gst_nv_capture_sink_finalize (GObject * object);
+static void gst_nv_capture_sink_set_property (GObject * object,
+    guint prop_id, const GValue * value, GParamSpec * pspec);
+static void gst_nv_capture_sink_get_property (GObject * object,
+    guint prop_id, GValue * value, GParamSpec * pspec);
+static gboolean gst_nv_capture_sink_start (GstBaseSink * sink);
+static gboolean gst_nv_capture_sink_stop (GstBaseSink * sink);
+static gboolean gst_nv_capture_sink_unlock (GstBaseSink * sink);
+static gboolean gst_nv_capture_sink_unlock_stop (GstBaseSink * sink);
+static gboolean gst_nv_capture_sink_set_caps (GstBaseSink * sink,
+    GstCaps * caps);
+static GstFlowReturn gst_nv_capture_sink_render (GstBaseSink * sink,
+    GstBuffer * buffer);
+
+static void
+gst_nv_capture_sink_class_init (GstNvCaptureSinkClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseSinkClass *base_sink_class = GST_BASE_SINK_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_capture_sink_debug, "nvcapturesink", 0,
+      "nvcapturesink element");
+
+  gobject_class->finalize = gst_nv_capture_sink_finalize;
+  gobject_class->set_property = gst_nv_capture_sink_set_property;
+  gobject_class->get_property = gst_nv_capture_sink_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_LOCATION,
+      g_param_spec_string ("location", "Location",
+          "Capture file to write", DEFAULT_LOCATION,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_BACKLOG,
+      g_param_spec_uint64 ("max-backlog", "Max backlog",
+          "Bytes waiting for the disk before the streaming thread waits "
+          "(0 = unlimited)", 0, G_MAXUINT64, DEFAULT_MAX_BACKLOG,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_RECORDS,
+      g_param_spec_uint64 ("records", "Records",
+          "Buffers and caps written to the current file", 0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_BYTES,
+      g_param_spec_uint64 ("bytes", "Bytes",
+          "Size of the current file so far", 0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV capture sink", "Sink/File",
+      "Writes raw buffers and their metadata to an indexed capture file "
+      "for nvreplaysrc", "nv_gst_plugins developers");
+
+  base_sink_class->start = GST_DEBUG_FUNCPTR (gst_nv_capture_sink_start);
+  base_sink_class->stop = GST_DEBUG_FUNCPTR (gst_nv_capture_sink_stop);
+  base_sink_class->unlock = GST_DEBUG_FUNCPTR (gst_nv_capture_sink_unlock);
+  base_sink_class->unlock_stop =
+      GST_DEBUG_FUNCPTR (gst_nv_capture_sink_unlock_stop);
+  base_sink_class->set_caps = GST_DEBUG_FUNCPTR (gst_nv_capture_sink_set_caps);
+  base_sink_class->render = GST_DEBUG_FUNCPTR (gst_nv_capture_sink_render);
+}
+
+static void
+gst_nv_capture_sink_init (GstNvCaptureSink * self)
+{
+  self->location = g_strdup (DEFAULT_LOCATION);
+  self->max_backlog = DEFAULT_MAX_BACKLOG;
+  self->blocks = new nvgst::CaptureBlocks ();
+  self->frames = new std::vector < GstBuffer * >();
+
+  /* a capture runs as fast as the disk takes it */
+  gst_base_sink_set_sync (GST_BASE_SINK (self), FALSE);
+}
+
+static void
+gst_nv_capture_sink_finalize (GObject * object)
+{
+  GstNvCaptureSink *self = GST_NV_CAPTURE_SINK (object);
+
+  g_free (self->location);
+  delete self->blocks;
+  delete self->frames;
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_capture_sink_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvCaptureSink *self = GST_NV_CAPTURE_SINK (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_LOCATION:
+      g_free (self->location);
+      self->location = g_value_dup_string (value);
+      break;
+    case PROP_MAX_BACKLOG:
+      self->max_backlog = g_value_get_uint64 (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_capture_sink_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstNvCaptureSink *self = GST_NV_CAPTURE_SINK (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_LOCATION:
+      g_value_set_string (value, self->location);
+      break;
+    case PROP_MAX_BACKLOG:
+      g_value_set_uint64 (value, self->max_backlog);
+      break;
+    case PROP_RECORDS:
+      g_value_set_uint64 (value, self->records);
+      break;
+    case PROP_BYTES:
+      g_value_set_uint64 (value, self->bytes);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static gboolean
+gst_nv_capture_sink_start (GstBaseSink * sink)
+{
+  GstNvCaptureSink *self = GST_NV_CAPTURE_SINK (sink);
+  nvgst::CaptureWriter *writer =
+      new nvgst::CaptureWriter (gst_nv_capture_sink_release_chunk);
+  gchar *location;
+
+  GST_OBJECT_LOCK (self);
+  location = g_strdup (self->location);
+  self->records = 0;
+  self->bytes = 0;
+  GST_OBJECT_UNLOCK (self);
+
+  if (location == NULL || !writer->open (location)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, OPEN_WRITE,
+        ("Could not open capture file %s", GST_STR_NULL (location)),
+        ("%s", g_strerror (errno)));
+    g_free (location);
+    delete writer;
+    return FALSE;
+  }
+  GST_INFO_OBJECT (self, "capturing to %s", location);
+
+  self->writer = writer;
+  self->active_location = location;
+  g_atomic_int_set (&self->flushing, FALSE);
+  return TRUE;
+}
+
+static gboolean
+gst_nv_capture_sink_stop (GstBaseSink * sink)
+{
+  GstNvCaptureSink *self = GST_NV_CAPTURE_SINK (sink);
+  guint64 records, bytes;
+  int error;
+
+  if (self->writer == NULL)
+    return TRUE;
+
+  /* writes the index and waits for the disk */
+  records = self->writer->records ();
+  error = self->writer->close ();
+  bytes = self->writer->bytes ();
+  delete self->writer;
+  self->writer = NULL;
+
+  if (error != 0) {
+    GST_ELEMENT_WARNING (self, RESOURCE, WRITE,
+        ("Could not write capture file %s", self->active_location),
+        ("%s", g_strerror (error)));
+  }
+  GST_INFO_OBJECT (self, "closed %s, %" G_GUINT64_FORMAT " records, %"
+      G_GUINT64_FORMAT " bytes", self->active_location, records, bytes);
+
+  gst_element_post_message (GST_ELEMENT (self),
+      gst_message_new_element (GST_OBJECT (self),
+          gst_structure_new ("nvcapture-done",
+              "location", G_TYPE_STRING, self->active_location,
+              "records", G_TYPE_UINT64, records,
+              "bytes", G_TYPE_UINT64, bytes, NULL)));
+
+  g_free (self->active_location);
+  self->active_location = NULL;
+  return TRUE;
+}
+
+static gboolean
+gst_nv_capture_sink_unlock (GstBaseSink * sink)
+{
+  GstNvCaptureSink *self = GST_NV_CAPTURE_SINK (sink);
+
+  g_atomic_int_set (&self->flushing, TRUE);
+  return TRUE;
+}
+
+static gboolean
+gst_nv_capture_sink_unlock_stop (GstBaseSink * sink)
+{
+  GstNvCaptureSink *self = GST_NV_CAPTURE_SINK (sink);
+
+  g_atomic_int_set (&self->flushing, FALSE);
+  return TRUE;
+}
+
+/* Queues a record, waiting while the disk is behind; the chunks go back to
+ * the caller only when flushing. */
+static GstFlowReturn
+gst_nv_capture_sink_write (GstNvCaptureSink * self,
+    const nvgst::CaptureRecordInfo & info,
+    const std::vector<nvgst::CaptureWriter::Segment> & segments)
+{
+  guint64 max_backlog;
+
+  GST_OBJECT_LOCK (self);
+  max_backlog = self->max_backlog;
+  GST_OBJECT_UNLOCK (self);
+  self->writer->set_max_backlog (max_backlog);
+
+  while (!self->writer->write (info, *self->blocks, segments.data (),
+          segments.size ())) {
+    if (g_atomic_int_get (&self->flushing))
+      return GST_FLOW_FLUSHING;
+    /* the writer has no per-chunk completion to wait on; at these sizes
+     * the disk is what everyone waits for anyway */
+    g_usleep (1000);
+  }
+
+  GST_OBJECT_LOCK (self);
+  self->records = self->writer->records ();
+  self->bytes = self->writer->bytes ();
+  GST_OBJECT_UNLOCK (self);
+  return GST_FLOW_OK;
+}
+
+static gboolean
+gst_nv_capture_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
+{
+  GstNvCaptureSink *self = GST_NV_CAPTURE_SINK (sink);
+  nvgst::CaptureRecordInfo info;
+  gchar *str = gst_caps_to_string (caps);
+  GstFlowReturn ret;
+
+  GST_DEBUG_OBJECT (self, "caps %s", str);
+  info.kind = nvgst::CaptureRecordKind::kCaps;
+  self->blocks->clear ();
+  self->blocks->add (GST_NV_CAPTURE_BLOCK_CAPS, str, strlen (str) + 1);
+  g_free (str);
+
+  ret = gst_nv_capture_sink_write (self, info, {});
+  return ret == GST_FLOW_OK;
+}
+
+static void
+gst_nv_capture_sink_release_segments (const
+    std::vector<nvgst::CaptureWriter::Segment> & segments)
+{
+  for (const nvgst::CaptureWriter::Segment & segment : segments) {
+    if (segment.token)
+      gst_nv_capture_sink_release_chunk (segment.token);
+  }
+}
+
+/* Maps @buffer for the writer; an empty segment when it has no memory. */
+static gboolean
+gst_nv_capture_sink_map (GstBuffer * buffer,
+    std::vector<nvgst::CaptureWriter::Segment> * segments)
+{
+  GstNvCaptureSinkChunk *chunk;
+
+  if (gst_buffer_n_memory (buffer) == 0) {
+    segments->push_back ({NULL, 0, NULL});
+    return TRUE;
+  }
+  chunk = g_new (GstNvCaptureSinkChunk, 1);
+  if (!gst_buffer_map (buffer, &chunk->map, GST_MAP_READ)) {
+    g_free (chunk);
+    return FALSE;
+  }
+  chunk->buffer = gst_buffer_ref (buffer);
+  segments->push_back ({chunk->map.data, chunk->map.size, chunk});
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_nv_capture_sink_render (GstBaseSink * sink, GstBuffer * buffer)
+{
+  GstNvCaptureSink *self = GST_NV_CAPTURE_SINK (sink);
+  std::vector<nvgst::CaptureWriter::Segment> segments;
+  nvgst::CaptureRecordInfo info;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  self->blocks->clear ();
+  self->frames->clear ();
+  gst_nv_capture_write_metas (buffer, self->blocks, self->frames);
+
+  if (!gst_nv_capture_sink_map (buffer, &segments))
+    ret = GST_FLOW_ERROR;
+  for (gsize i = 0; ret == GST_FLOW_OK && i < self->frames->size (); i++) {
+    if (!gst_nv_capture_sink_map ((*self->frames)[i], &segments))
+      ret = GST_FLOW_ERROR;
+  }
+  if (ret != GST_FLOW_OK) {
+    gst_nv_capture_sink_release_segments (segments);
+    GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL),
+        ("could not map buffer %" GST_PTR_FORMAT, buffer));
+    return ret;
+  }
+
+  info.flags = GST_BUFFER_FLAGS (buffer);
+  info.pts = GST_BUFFER_PTS (buffer);
+  info.dts = GST_BUFFER_DTS (buffer);
+  info.duration = GST_BUFFER_DURATION (buffer);
+  info.offset = GST_BUFFER_OFFSET (buffer);
+  info.offset_end = GST_BUFFER_OFFSET_END (buffer);
+
+  ret = gst_nv_capture_sink_write (self, info, segments);
+  if (ret != GST_FLOW_OK)
+    gst_nv_capture_sink_release_segments (segments);
+  return ret;
+}
@@ -0,0 +1,59 @@
+#ifndef __GST_NV_CAPTURE_SINK_H__
+#define __GST_NV_CAPTURE_SINK_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasesink.h>
+
+#include <vector>
+
+#include "core/capture.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_NV_CAPTURE_SINK \
+  (gst_nv_capture_sink_get_type())
+#define GST_NV_CAPTURE_SINK(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_CAPTURE_SINK,GstNvCaptureSink))
+#define GST_NV_CAPTURE_SINK_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_CAPTURE_SINK,GstNvCaptureSinkClass))
+#define GST_IS_NV_CAPTURE_SINK(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_CAPTURE_SINK))
+
+typedef struct _GstNvCaptureSink GstNvCaptureSink;
+typedef struct _GstNvCaptureSinkClass GstNvCaptureSinkClass;
+
+struct _GstNvCaptureSink
+{
+  GstBaseSink parent;
+
+  /* properties, protected by the object lock */
+  gchar *location;
+  guint64 max_backlog;
+  guint64 records;
+  guint64 bytes;
+
+  /* set by unlock() while the streaming thread waits for the disk, atomic */
+  gint flushing;
+
+  /* between start() and stop() */
+  nvgst::CaptureWriter *writer;
+  gchar *active_location;
+
+  /* streaming thread only */
+  nvgst::CaptureBlocks *blocks;
+  /* frame buffers of the current zero-copy batch, not reffed */
+  std::vector<GstBuffer *> *frames;
+};
+
+struct _GstNvCaptureSinkClass
+{
+  GstBaseSinkClass parent_class;
+};
+
+GType gst_nv_capture_sink_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvcapturesink);
+
+G_END_DECLS
+
+#endif /* __GST_NV_CAPTURE_SINK_H__ */
@@ -0,0 +1,521 @@
+/**
+ * SECTION:element-nvclassifycache
+ *
+ * Keeps the result of a secondary classifier (vehicle make, color, ...)
+ * per track, so a tracked object is classified once and again only when
+ * its result got old, its box changed size a lot or the classifier was
+ * unsure, instead of on every frame it is seen in.
+ *
+ * The element sits around the classifier with two pairs of pads sharing
+ * one cache. Buffers going through sink/src, in front of the classifier,
+ * have every tracked object in their #GstNvObjectMeta looked up; objects
+ * with a reusable result get it as a cached attribute of classifier-id,
+ * which tells the classifier to skip them. Buffers going through
+ * result_sink/result_src, behind the classifier, have the attributes the
+ * classifier computed stored under the object's track id.
+ *
+ * The cache is an open-addressing hash table keyed by track id. Results
+ * age by the PTS of their frame on each source of a batch separately, and
+ * entries of tracks not seen for track-timeout are evicted, as tracks end
+ * without notice. Objects without a track id or a PTS are never cached.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 filesrc location=road.mp4 ! decodebin ! nvconvert ! \
+ *     video/x-raw,format=NV12 ! nvinfer ! nvpostprocess ! nvtracker ! \
+ *     nvclassifycache name=cache classifier-id=1 max-age=5000000000 \
+ *     cache.src ! <color classifier, id 1> ! cache.result_sink \
+ *     cache.result_src ! fakesink
+ * ]|
+ */
+
+#include "gstnvclassifycache.h"
+#include "gstnvbatchmeta.h"
+#include "gstnvobjectmeta.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_classify_cache_debug);
+#define GST_CAT_DEFAULT gst_nv_classify_cache_debug
+
+#define DEFAULT_CLASSIFIER_ID 0
+#define DEFAULT_MAX_AGE (2 * GST_SECOND)
+#define DEFAULT_MIN_CONFIDENCE 0.5f
+#define DEFAULT_MAX_AREA_RATIO 1.5f
+#define DEFAULT_TRACK_TIMEOUT (2 * GST_SECOND)
+#define DEFAULT_CAPACITY 4096
+
+enum
+{
+  PROP_0,
+  PROP_CLASSIFIER_ID,
+  PROP_MAX_AGE,
+  PROP_MIN_CONFIDENCE,
+  PROP_MAX_AREA_RATIO,
+  PROP_TRACK_TIMEOUT,
+  PROP_CAPACITY,
+};
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate result_sink_template =
+GST_STATIC_PAD_TEMPLATE ("result_sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate result_src_template =
+GST_STATIC_PAD_TEMPLATE ("result_src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+#define gst_nv_classify_cache_parent_class parent_class
+G_DEFINE_TYPE (GstNvClassifyCache, gst_nv_classify_cache, GST_TYPE_ELEMENT);
+GST_ELEMENT_REGISTER_DEFINE (nvclassifycache, "nvclassifycache",
+    GST_RANK_NONE, GST_TYPE_NV_CLASSIFY_CACHE);
+
+static void gst_nv_classify_cache_finalize (GObject * object);
+static void gst_nv_classify_cache_set_property (GObject * object,
+    guint prop_id, const GValue * value, GParamSpec * pspec);
+static void gst_nv_classify_cache_get_property (GObject * object,
+    guint prop_id, GValue * value, GParamSpec * pspec);
+static GstStateChangeReturn gst_nv_classify_cache_change_state (GstElement *
+    element, GstStateChange transition);
+static GstFlowReturn gst_nv_classify_cache_chain (GstPad * pad,
+    GstObject * parent, GstBuffer * buffer);
+static GstFlowReturn gst_nv_classify_cache_result_chain (GstPad * pad,
+    GstObject * parent, GstBuffer * buffer);
+static gboolean gst_nv_classify_cache_sink_event (GstPad * pad,
+    GstObject * parent, GstEvent * event);
+static GstIterator *gst_nv_classify_cache_iterate_internal_links (GstPad *
+    pad, GstObject * parent);
+
+static void
+gst_nv_classify_cache_class_init (GstNvClassifyCacheClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_classify_cache_debug, "nvclassifycache", 0,
+      "nvclassifycache element");
+
+  gobject_class->finalize = gst_nv_classify_cache_finalize;
+  gobject_class->set_property = gst_nv_classify_cache_set_property;
+  gobject_class->get_property = gst_nv_classify_cache_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_CLASSIFIER_ID,
+      g_param_spec_int ("classifier-id", "Classifier id",
+          "Id of the classifier whose object attributes are cached",
+          0, G_MAXINT, DEFAULT_CLASSIFIER_ID,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_AGE,
+      g_param_spec_uint64 ("max-age", "Max age",
+          "Age in nanoseconds after which a track is classified again",
+          0, G_MAXUINT64, DEFAULT_MAX_AGE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MIN_CONFIDENCE,
+      g_param_spec_float ("min-confidence", "Min confidence",
+          "Results below this confidence are not reused",
+          0.0f, 1.0f, DEFAULT_MIN_CONFIDENCE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_AREA_RATIO,
+      g_param_spec_float ("max-area-ratio", "Max area ratio",
+          "Factor by which the box area may grow or shrink before a track is "
+          "classified again",
+          1.0f, G_MAXFLOAT, DEFAULT_MAX_AREA_RATIO,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_TRACK_TIMEOUT,
+      g_param_spec_uint64 ("track-timeout", "Track timeout",
+          "Nanoseconds a track may go unseen on its source before its entry "
+          "is evicted",
+          0, G_MAXUINT64, DEFAULT_TRACK_TIMEOUT,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CAPACITY,
+      g_param_spec_uint ("capacity", "Capacity",
+          "Most tracks kept; results of new tracks are dropped while full",
+          1, 1 << 24, DEFAULT_CAPACITY,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_add_static_pad_template (element_class,
+      &result_sink_template);
+  gst_element_class_add_static_pad_template (element_class,
+      &result_src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV classify cache", "Filter/Analyzer/Video",
+      "Reuses secondary classifier results per track id from an "
+      "open-addressing cache, so objects are only classified again when "
+      "their result went stale",
+      "nv_gst_plugins developers");
+
+  element_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_nv_classify_cache_change_state);
+}
+
+static GstPad *
+gst_nv_classify_cache_add_pad (GstNvClassifyCache * self,
+    GstStaticPadTemplate * templ, GstPadChainFunction chain)
+{
+  GstPad *pad = gst_pad_new_from_static_template (templ, templ->name_template);
+
+  if (chain != NULL)
+    gst_pad_set_chain_function (pad, chain);
+  gst_pad_set_iterate_internal_links_function (pad,
+      GST_DEBUG_FUNCPTR (gst_nv_classify_cache_iterate_internal_links));
+  GST_PAD_SET_PROXY_CAPS (pad);
+  GST_PAD_SET_PROXY_ALLOCATION (pad);
+  gst_element_add_pad (GST_ELEMENT (self), pad);
+
+  return pad;
+}
+
+static void
+gst_nv_classify_cache_init (GstNvClassifyCache * self)
+{
+  self->sinkpad = gst_nv_classify_cache_add_pad (self, &sink_template,
+      GST_DEBUG_FUNCPTR (gst_nv_classify_cache_chain));
+  gst_pad_set_event_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_nv_classify_cache_sink_event));
+  self->srcpad = gst_nv_classify_cache_add_pad (self, &src_template, NULL);
+  self->result_sinkpad = gst_nv_classify_cache_add_pad (self,
+      &result_sink_template,
+      GST_DEBUG_FUNCPTR (gst_nv_classify_cache_result_chain));
+  self->result_srcpad = gst_nv_classify_cache_add_pad (self,
+      &result_src_template, NULL);
+
+  self->classifier_id = DEFAULT_CLASSIFIER_ID;
+  self->max_age = DEFAULT_MAX_AGE;
+  self->min_confidence = DEFAULT_MIN_CONFIDENCE;
+  self->max_area_ratio = DEFAULT_MAX_AREA_RATIO;
+  self->track_timeout = DEFAULT_TRACK_TIMEOUT;
+  self->capacity = DEFAULT_CAPACITY;
+  self->reconfigure = TRUE;
+
+  g_mutex_init (&self->cache_lock);
+  self->cache = new nvgst::TrackCache ();
+  self->hits = 0;
+  self->misses = 0;
+}
+
+static void
+gst_nv_classify_cache_finalize (GObject * object)
+{
+  GstNvClassifyCache *self = GST_NV_CLASSIFY_CACHE (object);
+
+  delete self->cache;
+  g_mutex_clear (&self->cache_lock);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_classify_cache_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvClassifyCache *self = GST_NV_CLASSIFY_CACHE (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_CLASSIFIER_ID:
+      self->classifier_id = g_value_get_int (value);
+      break;
+    case PROP_MAX_AGE:
+      self->max_age = g_value_get_uint64 (value);
+      break;
+    case PROP_MIN_CONFIDENCE:
+      self->min_confidence = g_value_get_float (value);
+      break;
+    case PROP_MAX_AREA_RATIO:
+      self->max_area_ratio = g_value_get_float (value);
+      break;
+    case PROP_TRACK_TIMEOUT:
+      self->track_timeout = g_value_get_uint64 (value);
+      break;
+    case PROP_CAPACITY:
+      self->capacity = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      GST_OBJECT_UNLOCK (self);
+      return;
+  }
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_classify_cache_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstNvClassifyCache *self = GST_NV_CLASSIFY_CACHE (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_CLASSIFIER_ID:
+      g_value_set_int (value, self->classifier_id);
+      break;
+    case PROP_MAX_AGE:
+      g_value_set_uint64 (value, self->max_age);
+      break;
+    case PROP_MIN_CONFIDENCE:
+      g_value_set_float (value, self->min_confidence);
+      break;
+    case PROP_MAX_AREA_RATIO:
+      g_value_set_float (value, self->max_area_ratio);
+      break;
+    case PROP_TRACK_TIMEOUT:
+      g_value_set_uint64 (value, self->track_timeout);
+      break;
+    case PROP_CAPACITY:
+      g_value_set_uint (value, self->capacity);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_classify_cache_clear (GstNvClassifyCache * self)
+{
+  g_mutex_lock (&self->cache_lock);
+  self->cache->clear ();
+  g_mutex_unlock (&self->cache_lock);
+}
+
+static GstStateChangeReturn
+gst_nv_classify_cache_change_state (GstElement * element,
+    GstStateChange transition)
+{
+  GstNvClassifyCache *self = GST_NV_CLASSIFY_CACHE (element);
+  GstStateChangeReturn ret;
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  if (transition == GST_STATE_CHANGE_PAUSED_TO_READY) {
+    g_mutex_lock (&self->cache_lock);
+    GST_INFO_OBJECT (self, "%" G_GUINT64_FORMAT " cache hits, %"
+        G_GUINT64_FORMAT " misses", self->hits, self->misses);
+    self->cache->clear ();
+    self->hits = 0;
+    self->misses = 0;
+    g_mutex_unlock (&self->cache_lock);
+  }
+
+  return ret;
+}
+
+/* Each pad only links to its partner on the same path, so default event
+ * and query handling never crosses over to the other path. */
+static GstIterator *
+gst_nv_classify_cache_iterate_internal_links (GstPad * pad, GstObject * parent)
+{
+  GstNvClassifyCache *self = GST_NV_CLASSIFY_CACHE (parent);
+  GValue value = G_VALUE_INIT;
+  GstIterator *it;
+  GstPad *other;
+
+  if (pad == self->sinkpad)
+    other = self->srcpad;
+  else if (pad == self->srcpad)
+    other = self->sinkpad;
+  else if (pad == self->result_sinkpad)
+    other = self->result_srcpad;
+  else
+    other = self->result_sinkpad;
+
+  g_value_init (&value, GST_TYPE_PAD);
+  g_value_set_object (&value, other);
+  it = gst_iterator_new_single (GST_TYPE_PAD, &value);
+  g_value_unset (&value);
+
+  return it;
+}
+
+/* After a seek timestamps jump, so entries could neither age nor expire
+ * correctly; start over. */
+static gboolean
+gst_nv_classify_cache_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstNvClassifyCache *self = GST_NV_CLASSIFY_CACHE (parent);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP)
+    gst_nv_classify_cache_clear (self);
+
+  return gst_pad_event_default (pad, parent, event);
+}
+
+/* Takes property changes into the cache; returns the classifier id. */
+static gboolean
+gst_nv_classify_cache_apply_config (GstNvClassifyCache * self,
+    gint * classifier_id)
+{
+  nvgst::TrackCacheConfig config;
+  gboolean ok;
+
+  GST_OBJECT_LOCK (self);
+  *classifier_id = self->classifier_id;
+  if (!self->reconfigure) {
+    GST_OBJECT_UNLOCK (self);
+    return TRUE;
+  }
+  config.max_age = self->max_age;
+  config.min_confidence = self->min_confidence;
+  config.max_area_ratio = self->max_area_ratio;
+  config.track_timeout = self->track_timeout;
+  config.capacity = (int) self->capacity;
+  self->reconfigure = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  g_mutex_lock (&self->cache_lock);
+  ok = self->cache->configure (config);
+  g_mutex_unlock (&self->cache_lock);
+
+  if (!ok) {
+    GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS, (NULL),
+        ("invalid classify cache configuration"));
+    return FALSE;
+  }
+
+  GST_INFO_OBJECT (self, "caching classifier %d for up to %d tracks, max age "
+      "%" GST_TIME_FORMAT ", track timeout %" GST_TIME_FORMAT, *classifier_id,
+      config.capacity, GST_TIME_ARGS (config.max_age),
+      GST_TIME_ARGS (config.track_timeout));
+
+  return TRUE;
+}
+
+/* PTS of the frame the object was found in. */
+static GstClockTime
+gst_nv_classify_cache_object_time (GstBuffer * buffer, GstNvBatchMeta * bmeta,
+    const nvgst::DetectedObject & object)
+{
+  if (bmeta == NULL)
+    return GST_BUFFER_PTS (buffer);
+  if (object.frame >= bmeta->n_frames)
+    return GST_CLOCK_TIME_NONE;
+  return bmeta->frames[object.frame].pts;
+}
+
+static GstFlowReturn
+gst_nv_classify_cache_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buffer)
+{
+  GstNvClassifyCache *self = GST_NV_CLASSIFY_CACHE (parent);
+  GstNvObjectMeta *ometa;
+  GstNvBatchMeta *bmeta;
+  gint classifier_id;
+  guint hits = 0, misses = 0;
+
+  if (!gst_nv_classify_cache_apply_config (self, &classifier_id)) {
+    gst_buffer_unref (buffer);
+    return GST_FLOW_ERROR;
+  }
+
+  if (gst_buffer_get_nv_object_meta (buffer) == NULL)
+    return gst_pad_push (self->srcpad, buffer);
+
+  buffer = gst_buffer_make_writable (buffer);
+  ometa = gst_buffer_get_nv_object_meta (buffer);
+  bmeta = gst_buffer_get_nv_batch_meta (buffer);
+
+  g_mutex_lock (&self->cache_lock);
+  for (nvgst::DetectedObject & object : *ometa->objects) {
+    const nvgst::ObjectAttribute *attribute =
+        nvgst::find_attribute (object, classifier_id);
+    const nvgst::TrackResult *result;
+    GstClockTime time;
+
+    /* already classified upstream */
+    if (attribute != NULL && !attribute->cached)
+      continue;
+    if (object.track_id == nvgst::kNoTrack)
+      continue;
+    time = gst_nv_classify_cache_object_time (buffer, bmeta, object);
+    if (!GST_CLOCK_TIME_IS_VALID (time))
+      continue;
+
+    result = self->cache->lookup (object, time);
+    if (result != NULL) {
+      nvgst::ObjectAttribute *slot =
+          nvgst::add_attribute (object, classifier_id);
+
+      if (slot != NULL) {
+        slot->label = result->label;
+        slot->confidence = result->confidence;
+        slot->cached = true;
+        hits++;
+        continue;
+      }
+    } else if (attribute != NULL) {
+      /* a stale cached label must not stop the classifier */
+      nvgst::find_attribute (object, classifier_id)->classifier =
+          nvgst::kNoClassifier;
+    }
+    misses++;
+  }
+  self->cache->expire ();
+  self->hits += hits;
+  self->misses += misses;
+  g_mutex_unlock (&self->cache_lock);
+
+  GST_LOG_OBJECT (self, "%u of %u tracked objects answered from the cache",
+      hits, hits + misses);
+
+  return gst_pad_push (self->srcpad, buffer);
+}
+
+static GstFlowReturn
+gst_nv_classify_cache_result_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buffer)
+{
+  GstNvClassifyCache *self = GST_NV_CLASSIFY_CACHE (parent);
+  GstNvObjectMeta *ometa = gst_buffer_get_nv_object_meta (buffer);
+  GstNvBatchMeta *bmeta = gst_buffer_get_nv_batch_meta (buffer);
+  gint classifier_id;
+  guint stored = 0;
+
+  if (!gst_nv_classify_cache_apply_config (self, &classifier_id)) {
+    gst_buffer_unref (buffer);
+    return GST_FLOW_ERROR;
+  }
+
+  if (ometa == NULL)
+    return gst_pad_push (self->result_srcpad, buffer);
+
+  g_mutex_lock (&self->cache_lock);
+  for (const nvgst::DetectedObject & object : *ometa->objects) {
+    const nvgst::ObjectAttribute *attribute =
+        nvgst::find_attribute (object, classifier_id);
+    GstClockTime time;
+
+    if (attribute == NULL || attribute->cached)
+      continue;
+    time = gst_nv_classify_cache_object_time (buffer, bmeta, object);
+    if (!GST_CLOCK_TIME_IS_VALID (time))
+      continue;
+    if (self->cache->store (object, attribute->label, attribute->confidence,
+            time))
+      stored++;
+  }
+  g_mutex_unlock (&self->cache_lock);
+
+  GST_LOG_OBJECT (self, "stored %u results", stored);
+
+  return gst_pad_push (self->result_srcpad, buffer);
+}
@@ -0,0 +1,61 @@
+#ifndef __GST_NV_CLASSIFY_CACHE_H__
+#define __GST_NV_CLASSIFY_CACHE_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "core/track_cache.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_NV_CLASSIFY_CACHE \
+  (gst_nv_classify_cache_get_type())
+#define GST_NV_CLASSIFY_CACHE(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_CLASSIFY_CACHE,GstNvClassifyCache))
+#define GST_NV_CLASSIFY_CACHE_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_CLASSIFY_CACHE,GstNvClassifyCacheClass))
+#define GST_IS_NV_CLASSIFY_CACHE(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_CLASSIFY_CACHE))
+
+typedef struct _GstNvClassifyCache GstNvClassifyCache;
+typedef struct _GstNvClassifyCacheClass GstNvClassifyCacheClass;
+
+struct _GstNvClassifyCache
+{
+  GstElement parent;
+
+  /* in front of the classifier */
+  GstPad *sinkpad;
+  GstPad *srcpad;
+  /* behind the classifier */
+  GstPad *result_sinkpad;
+  GstPad *result_srcpad;
+
+  /* properties, protected by the object lock */
+  gint classifier_id;
+  guint64 max_age;
+  gfloat min_confidence;
+  gfloat max_area_ratio;
+  guint64 track_timeout;
+  guint capacity;
+  gboolean reconfigure;
+
+  /* both streaming threads, protected by cache_lock */
+  GMutex cache_lock;
+  nvgst::TrackCache *cache;
+  guint64 hits;
+  guint64 misses;
+};
+
+struct _GstNvClassifyCacheClass
+{
+  GstElementClass parent_class;
+};
+
+GType gst_nv_classify_cache_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvclassifycache);
+
+G_END_DECLS
+
+#endif /* __GST_NV_CLASSIFY_CACHE_H__ */
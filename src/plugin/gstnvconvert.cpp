@@ -0,0 +1,392 @@
+/**
+ * SECTION:element-nvconvert
+ *
+ * Converts and scales raw video between NV12, I420, RGBA and BGRx on the
+ * CPU. Row kernels are picked at runtime (AVX2, SSE4.1 or scalar) and
+ * output frames come from a #GstNvBufferPool whose buffers are all
+ * allocated when the pool starts, so steady-state streaming performs no
+ * per-frame heap allocation.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 videotestsrc ! video/x-raw,format=NV12,width=1920,height=1080 ! \
+ *     nvconvert ! video/x-raw,format=RGBA,width=1280,height=720 ! fakesink
+ * ]|
+ */
+
+#include "gstnvconvert.h"
+#include "gstnvbufferpool.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_convert_debug);
+#define GST_CAT_DEFAULT gst_nv_convert_debug
+
+#define DEFAULT_SIMD GST_NV_SIMD_LEVEL_AUTO
+#define DEFAULT_OUTPUT_BUFFERS 4
+
+enum
+{
+  PROP_0,
+  PROP_SIMD,
+  PROP_OUTPUT_BUFFERS,
+};
+
+#define NV_CONVERT_CAPS GST_VIDEO_CAPS_MAKE ("{ NV12, I420, RGBA, BGRx }")
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_CONVERT_CAPS));
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_CONVERT_CAPS));
+
+#define gst_nv_convert_parent_class parent_class
+G_DEFINE_TYPE (GstNvConvert, gst_nv_convert, GST_TYPE_VIDEO_FILTER);
+GST_ELEMENT_REGISTER_DEFINE (nvconvert, "nvconvert", GST_RANK_NONE,
+    GST_TYPE_NV_CONVERT);
+
+static void gst_nv_convert_finalize (GObject * object);
+static void gst_nv_convert_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_convert_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static GstCaps *gst_nv_convert_transform_caps (GstBaseTransform * trans,
+    GstPadDirection direction, GstCaps * caps, GstCaps * filter);
+static GstCaps *gst_nv_convert_fixate_caps (GstBaseTransform * trans,
+    GstPadDirection direction, GstCaps * caps, GstCaps * othercaps);
+static gboolean gst_nv_convert_propose_allocation (GstBaseTransform * trans,
+    GstQuery * decide_query, GstQuery * query);
+static gboolean gst_nv_convert_decide_allocation (GstBaseTransform * trans,
+    GstQuery * query);
+static gboolean gst_nv_convert_set_info (GstVideoFilter * filter,
+    GstCaps * incaps, GstVideoInfo * in_info, GstCaps * outcaps,
+    GstVideoInfo * out_info);
+static GstFlowReturn gst_nv_convert_transform_frame (GstVideoFilter * filter,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame);
+
+static void
+gst_nv_convert_class_init (GstNvConvertClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+  GstVideoFilterClass *filter_class = GST_VIDEO_FILTER_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_convert_debug, "nvconvert", 0,
+      "nvconvert element");
+
+  gobject_class->finalize = gst_nv_convert_finalize;
+  gobject_class->set_property = gst_nv_convert_set_property;
+  gobject_class->get_property = gst_nv_convert_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_SIMD,
+      g_param_spec_enum ("simd", "SIMD",
+          "Highest SIMD level to use, capped at what the CPU supports "
+          "(applied on the next caps change)",
+          GST_TYPE_NV_SIMD_LEVEL, DEFAULT_SIMD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_OUTPUT_BUFFERS,
+      g_param_spec_uint ("output-buffers", "Output buffers",
+          "Number of output buffers preallocated in the pool",
+          1, 64, DEFAULT_OUTPUT_BUFFERS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV video converter", "Filter/Converter/Video/Scaler",
+      "Converts and scales NV12, I420, RGBA and BGRx with SIMD kernels "
+      "into a preallocated aligned buffer pool",
+      "nv_gst_plugins developers");
+
+  trans_class->transform_caps =
+      GST_DEBUG_FUNCPTR (gst_nv_convert_transform_caps);
+  trans_class->fixate_caps = GST_DEBUG_FUNCPTR (gst_nv_convert_fixate_caps);
+  trans_class->propose_allocation =
+      GST_DEBUG_FUNCPTR (gst_nv_convert_propose_allocation);
+  trans_class->decide_allocation =
+      GST_DEBUG_FUNCPTR (gst_nv_convert_decide_allocation);
+  trans_class->passthrough_on_same_caps = TRUE;
+
+  filter_class->set_info = GST_DEBUG_FUNCPTR (gst_nv_convert_set_info);
+  filter_class->transform_frame =
+      GST_DEBUG_FUNCPTR (gst_nv_convert_transform_frame);
+
+  gst_type_mark_as_plugin_api (GST_TYPE_NV_SIMD_LEVEL, (GstPluginAPIFlags) 0);
+}
+
+static void
+gst_nv_convert_init (GstNvConvert * self)
+{
+  self->simd = DEFAULT_SIMD;
+  self->output_buffers = DEFAULT_OUTPUT_BUFFERS;
+  self->converter = new nvgst::VideoConverter ();
+
+  gst_base_transform_set_qos_enabled (GST_BASE_TRANSFORM (self), TRUE);
+}
+
+static void
+gst_nv_convert_finalize (GObject * object)
+{
+  GstNvConvert *self = GST_NV_CONVERT (object);
+
+  delete self->converter;
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_convert_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvConvert *self = GST_NV_CONVERT (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_SIMD:
+      self->simd = (GstNvSimdLevel) g_value_get_enum (value);
+      break;
+    case PROP_OUTPUT_BUFFERS:
+      self->output_buffers = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_convert_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstNvConvert *self = GST_NV_CONVERT (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_SIMD:
+      g_value_set_enum (value, self->simd);
+      break;
+    case PROP_OUTPUT_BUFFERS:
+      g_value_set_uint (value, self->output_buffers);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+/* Opens up format and size on system memory structures; everything else
+ * (framerate, pixel-aspect-ratio, other caps features) passes through. */
+static GstCaps *
+gst_nv_convert_transform_caps (GstBaseTransform * trans,
+    GstPadDirection direction, GstCaps * caps, GstCaps * filter)
+{
+  GstCaps *ret = gst_caps_new_empty ();
+  guint n = gst_caps_get_size (caps);
+
+  for (guint i = 0; i < n; i++) {
+    GstStructure *s = gst_caps_get_structure (caps, i);
+    GstCapsFeatures *f = gst_caps_get_features (caps, i);
+
+    if (i > 0 && gst_caps_is_subset_structure_full (ret, s, f))
+      continue;
+
+    s = gst_structure_copy (s);
+    if (gst_caps_features_is_equal (f, GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY)) {
+      gst_structure_set (s,
+          "width", GST_TYPE_INT_RANGE, 1, G_MAXINT,
+          "height", GST_TYPE_INT_RANGE, 1, G_MAXINT, NULL);
+      gst_structure_remove_fields (s, "format", "colorimetry", "chroma-site",
+          NULL);
+    }
+    gst_caps_append_structure_full (ret, s, gst_caps_features_copy (f));
+  }
+
+  if (filter) {
+    GstCaps *tmp =
+        gst_caps_intersect_full (filter, ret, GST_CAPS_INTERSECT_FIRST);
+    gst_caps_unref (ret);
+    ret = tmp;
+  }
+
+  GST_DEBUG_OBJECT (trans, "transformed %" GST_PTR_FORMAT " into %"
+      GST_PTR_FORMAT, caps, ret);
+
+  return ret;
+}
+
+/* Prefers the input size and format so that an unconstrained nvconvert is a
+ * passthrough. */
+static GstCaps *
+gst_nv_convert_fixate_caps (GstBaseTransform * trans,
+    GstPadDirection direction, GstCaps * caps, GstCaps * othercaps)
+{
+  GstStructure *ins, *outs;
+  const gchar *format;
+  gint width, height;
+
+  othercaps = gst_caps_truncate (othercaps);
+  othercaps = gst_caps_make_writable (othercaps);
+
+  ins = gst_caps_get_structure (caps, 0);
+  outs = gst_caps_get_structure (othercaps, 0);
+
+  if (gst_structure_get_int (ins, "width", &width))
+    gst_structure_fixate_field_nearest_int (outs, "width", width);
+  if (gst_structure_get_int (ins, "height", &height))
+    gst_structure_fixate_field_nearest_int (outs, "height", height);
+  if ((format = gst_structure_get_string (ins, "format")))
+    gst_structure_fixate_field_string (outs, "format", format);
+
+  othercaps = gst_caps_fixate (othercaps);
+
+  GST_DEBUG_OBJECT (trans, "fixated to %" GST_PTR_FORMAT, othercaps);
+
+  return othercaps;
+}
+
+static gboolean
+gst_nv_convert_propose_allocation (GstBaseTransform * trans,
+    GstQuery * decide_query, GstQuery * query)
+{
+  GstBufferPool *pool = NULL;
+  GstVideoInfo info;
+  GstCaps *caps;
+  gboolean need_pool;
+  guint size;
+
+  /* passthrough, let downstream answer */
+  if (decide_query == NULL)
+    return GST_BASE_TRANSFORM_CLASS (parent_class)->propose_allocation (trans,
+        decide_query, query);
+
+  gst_query_parse_allocation (query, &caps, &need_pool);
+  if (caps == NULL || !gst_video_info_from_caps (&info, caps))
+    return FALSE;
+
+  size = info.size;
+  if (need_pool) {
+    pool = gst_nv_buffer_pool_new_configured (caps, 0, 0, TRUE);
+    if (pool == NULL)
+      return FALSE;
+    size = gst_nv_buffer_pool_get_buffer_size (pool);
+  }
+
+  gst_query_add_allocation_pool (query, pool, size, 0, 0);
+  gst_query_add_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+
+  if (pool)
+    gst_object_unref (pool);
+
+  return TRUE;
+}
+
+/* Always allocates output from our own pool, sized to what downstream asked
+ * for but never below output-buffers. */
+static gboolean
+gst_nv_convert_decide_allocation (GstBaseTransform * trans, GstQuery * query)
+{
+  GstNvConvert *self = GST_NV_CONVERT (trans);
+  GstBufferPool *pool;
+  GstCaps *outcaps;
+  guint size = 0, min = 0, max = 0, output_buffers;
+  gboolean video_meta;
+
+  gst_query_parse_allocation (query, &outcaps, NULL);
+  if (outcaps == NULL)
+    return FALSE;
+
+  if (gst_query_get_n_allocation_pools (query) > 0)
+    gst_query_parse_nth_allocation_pool (query, 0, NULL, &size, &min, &max);
+
+  GST_OBJECT_LOCK (self);
+  output_buffers = self->output_buffers;
+  GST_OBJECT_UNLOCK (self);
+
+  min = MAX (min, output_buffers);
+  if (max != 0)
+    max = MAX (max, min);
+
+  video_meta =
+      gst_query_find_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+
+  pool = gst_nv_buffer_pool_new_configured (outcaps, min, max, video_meta);
+  if (pool == NULL) {
+    GST_ERROR_OBJECT (self, "failed to create output pool for %"
+        GST_PTR_FORMAT, outcaps);
+    return FALSE;
+  }
+  size = gst_nv_buffer_pool_get_buffer_size (pool);
+
+  if (gst_query_get_n_allocation_pools (query) > 0)
+    gst_query_set_nth_allocation_pool (query, 0, pool, size, min, max);
+  else
+    gst_query_add_allocation_pool (query, pool, size, min, max);
+
+  GST_DEBUG_OBJECT (self, "output pool: %u buffers of %u bytes (max %u), "
+      "video meta %d", min, size, max, video_meta);
+
+  gst_object_unref (pool);
+
+  return TRUE;
+}
+
+static gboolean
+gst_nv_convert_set_info (GstVideoFilter * filter, GstCaps * incaps,
+    GstVideoInfo * in_info, GstCaps * outcaps, GstVideoInfo * out_info)
+{
+  GstNvConvert *self = GST_NV_CONVERT (filter);
+  nvgst::ConvertConfig config;
+  GstNvSimdLevel simd;
+
+  GST_OBJECT_LOCK (self);
+  simd = self->simd;
+  GST_OBJECT_UNLOCK (self);
+
+  config.in_format =
+      gst_nv_pixel_format_from_video_format (GST_VIDEO_INFO_FORMAT (in_info));
+  config.in_width = GST_VIDEO_INFO_WIDTH (in_info);
+  config.in_height = GST_VIDEO_INFO_HEIGHT (in_info);
+  config.out_format =
+      gst_nv_pixel_format_from_video_format (GST_VIDEO_INFO_FORMAT (out_info));
+  config.out_width = GST_VIDEO_INFO_WIDTH (out_info);
+  config.out_height = GST_VIDEO_INFO_HEIGHT (out_info);
+  /* the matrix of whichever side is YUV */
+  config.matrix = gst_nv_color_matrix_from_video_info (GST_VIDEO_INFO_IS_YUV
+      (in_info) ? in_info : out_info);
+  config.simd = gst_nv_simd_level_resolve (simd);
+
+  if (!self->converter->configure (config)) {
+    GST_ERROR_OBJECT (self, "unsupported conversion %" GST_PTR_FORMAT
+        " -> %" GST_PTR_FORMAT, incaps, outcaps);
+    return FALSE;
+  }
+
+  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (filter),
+      self->converter->is_identity ());
+
+  GST_INFO_OBJECT (self, "%s %dx%d -> %s %dx%d using %s kernels",
+      nvgst::format_name (config.in_format), config.in_width,
+      config.in_height, nvgst::format_name (config.out_format),
+      config.out_width, config.out_height,
+      nvgst::simd_level_name (self->converter->simd_level ()));
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_nv_convert_transform_frame (GstVideoFilter * filter,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame)
+{
+  GstNvConvert *self = GST_NV_CONVERT (filter);
+
+  self->converter->convert (gst_nv_frame_view_from_video_frame (in_frame),
+      gst_nv_frame_view_from_video_frame (out_frame));
+
+  return GST_FLOW_OK;
+}
@@ -0,0 +1,48 @@
+#ifndef __GST_NV_CONVERT_H__
+#define __GST_NV_CONVERT_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include <gst/video/gstvideofilter.h>
+
+#include "gstnvutils.h"
+#include "core/convert.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_NV_CONVERT \
+  (gst_nv_convert_get_type())
+#define GST_NV_CONVERT(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_CONVERT,GstNvConvert))
+#define GST_NV_CONVERT_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_CONVERT,GstNvConvertClass))
+#define GST_IS_NV_CONVERT(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_CONVERT))
+
+typedef struct _GstNvConvert GstNvConvert;
+typedef struct _GstNvConvertClass GstNvConvertClass;
+
+struct _GstNvConvert
+{
+  GstVideoFilter parent;
+
+  /* properties, protected by the object lock */
+  GstNvSimdLevel simd;
+  guint output_buffers;
+
+  /* streaming thread only */
+  nvgst::VideoConverter *converter;
+};
+
+struct _GstNvConvertClass
+{
+  GstVideoFilterClass parent_class;
+};
+
+GType gst_nv_convert_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvconvert);
+
+G_END_DECLS
+
+#endif /* __GST_NV_CONVERT_H__ */
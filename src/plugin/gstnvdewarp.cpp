@@ -0,0 +1,721 @@
+/**
+ * SECTION:element-nvdewarp
+ *
+ * Dewarps fisheye or equirectangular (360°) video into perspective views
+ * for analytics. Each view is a pan, tilt and field of view in degrees,
+ * listed in #GstNvDewarp:views; the views are laid out in a grid of one
+ * output frame from a preallocated pool, view 0 at the top left.
+ *
+ * The projection is evaluated once per configuration into remap tables
+ * holding a source tap and bilinear weights per output sample. Frames are
+ * then only sampled through the tables with SIMD kernels, in slices of
+ * rows spread over #GstNvDewarp:threads threads. Tables are also written
+ * to #GstNvDewarp:cache-dir, so a restart with the same lens and views
+ * loads them instead of computing them again.
+ *
+ * Fisheye views assume a ceiling mount: tilt is the angle from the lens
+ * axis and the lens axis is down in every view. For equirectangular input
+ * pan is the longitude and tilt the latitude.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 filesrc location=fisheye.mp4 ! decodebin ! nvdewarp \
+ *     views="0,55,90;90,55,90;180,55,90;270,55,90" view-width=960 \
+ *     view-height=540 ! autovideosink
+ * ]|
+ */
+
+#include <errno.h>
+
+#include "gstnvdewarp.h"
+#include "gstnvbufferpool.h"
+#include "core/tiler.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_dewarp_debug);
+#define GST_CAT_DEFAULT gst_nv_dewarp_debug
+
+#define DEFAULT_VIEWS "0,55,90;90,55,90;180,55,90;270,55,90"
+#define DEFAULT_VIEW_WIDTH 640
+#define DEFAULT_VIEW_HEIGHT 480
+#define DEFAULT_PROJECTION GST_NV_DEWARP_PROJECTION_FISHEYE
+#define DEFAULT_LENS_FOV 180.0
+#define DEFAULT_CENTER_X 0.5
+#define DEFAULT_CENTER_Y 0.5
+#define DEFAULT_RADIUS 1.0
+#define DEFAULT_THREADS 0
+#define DEFAULT_SIMD GST_NV_SIMD_LEVEL_AUTO
+#define DEFAULT_OUTPUT_BUFFERS 4
+
+enum
+{
+  PROP_0,
+  PROP_VIEWS,
+  PROP_VIEW_WIDTH,
+  PROP_VIEW_HEIGHT,
+  PROP_PROJECTION,
+  PROP_LENS_FOV,
+  PROP_CENTER_X,
+  PROP_CENTER_Y,
+  PROP_RADIUS,
+  PROP_CACHE_DIR,
+  PROP_THREADS,
+  PROP_SIMD,
+  PROP_OUTPUT_BUFFERS,
+};
+
+#define NV_DEWARP_CAPS GST_VIDEO_CAPS_MAKE ("{ NV12, I420, RGBA, BGRx }")
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_DEWARP_CAPS));
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_DEWARP_CAPS));
+
+GType
+gst_nv_dewarp_projection_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_NV_DEWARP_PROJECTION_FISHEYE, "Equidistant fisheye", "fisheye"},
+    {GST_NV_DEWARP_PROJECTION_EQUIRECT, "Equirectangular 360°",
+        "equirect"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = g_enum_register_static ("GstNvDewarpProjection", values);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+#define gst_nv_dewarp_parent_class parent_class
+G_DEFINE_TYPE (GstNvDewarp, gst_nv_dewarp, GST_TYPE_VIDEO_FILTER);
+GST_ELEMENT_REGISTER_DEFINE (nvdewarp, "nvdewarp", GST_RANK_NONE,
+    GST_TYPE_NV_DEWARP);
+
+static void gst_nv_dewarp_finalize (GObject * object);
+static void gst_nv_dewarp_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_dewarp_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static gboolean gst_nv_dewarp_stop (GstBaseTransform * trans);
+static GstCaps *gst_nv_dewarp_transform_caps (GstBaseTransform * trans,
+    GstPadDirection direction, GstCaps * caps, GstCaps * filter);
+static gboolean gst_nv_dewarp_decide_allocation (GstBaseTransform * trans,
+    GstQuery * query);
+static gboolean gst_nv_dewarp_set_info (GstVideoFilter * filter,
+    GstCaps * incaps, GstVideoInfo * in_info, GstCaps * outcaps,
+    GstVideoInfo * out_info);
+static GstFlowReturn gst_nv_dewarp_transform_frame (GstVideoFilter * filter,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame);
+
+static void
+gst_nv_dewarp_class_init (GstNvDewarpClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+  GstVideoFilterClass *filter_class = GST_VIDEO_FILTER_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_dewarp_debug, "nvdewarp", 0,
+      "nvdewarp element");
+
+  gobject_class->finalize = gst_nv_dewarp_finalize;
+  gobject_class->set_property = gst_nv_dewarp_set_property;
+  gobject_class->get_property = gst_nv_dewarp_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_VIEWS,
+      g_param_spec_string ("views", "Views",
+          "Views as \"pan,tilt,fov;...\" in degrees, up to 16",
+          DEFAULT_VIEWS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_VIEW_WIDTH,
+      g_param_spec_uint ("view-width", "View width",
+          "Width of each view (even for NV12 and I420)", 2, 8192,
+          DEFAULT_VIEW_WIDTH,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_VIEW_HEIGHT,
+      g_param_spec_uint ("view-height", "View height",
+          "Height of each view (even for NV12 and I420)", 2, 8192,
+          DEFAULT_VIEW_HEIGHT,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_PROJECTION,
+      g_param_spec_enum ("projection", "Projection", "Input projection",
+          GST_TYPE_NV_DEWARP_PROJECTION, DEFAULT_PROJECTION,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_LENS_FOV,
+      g_param_spec_double ("lens-fov", "Lens field of view",
+          "Fisheye field of view across the image circle, in degrees",
+          1.0, 360.0, DEFAULT_LENS_FOV,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CENTER_X,
+      g_param_spec_double ("center-x", "Center X",
+          "Fisheye circle center as a fraction of the frame width",
+          0.0, 1.0, DEFAULT_CENTER_X,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CENTER_Y,
+      g_param_spec_double ("center-y", "Center Y",
+          "Fisheye circle center as a fraction of the frame height",
+          0.0, 1.0, DEFAULT_CENTER_Y,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_RADIUS,
+      g_param_spec_double ("radius", "Radius",
+          "Fisheye circle radius as a fraction of half the shorter side",
+          0.01, 4.0, DEFAULT_RADIUS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CACHE_DIR,
+      g_param_spec_string ("cache-dir", "Cache directory",
+          "Where remap tables are kept between runs (NULL = the user "
+          "cache directory, \"\" = no disk cache)", NULL,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_THREADS,
+      g_param_spec_uint ("threads", "Threads",
+          "Threads sampling view slices, including the streaming thread "
+          "(0 = one per CPU)", 0, 64, DEFAULT_THREADS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SIMD,
+      g_param_spec_enum ("simd", "SIMD",
+          "Highest SIMD level to use, capped at what the CPU supports",
+          GST_TYPE_NV_SIMD_LEVEL, DEFAULT_SIMD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_OUTPUT_BUFFERS,
+      g_param_spec_uint ("output-buffers", "Output buffers",
+          "Number of output buffers preallocated in the pool",
+          1, 64, DEFAULT_OUTPUT_BUFFERS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV dewarp", "Filter/Effect/Video",
+      "Dewarps fisheye and 360° video into perspective views through "
+      "cached remap tables and SIMD bilinear sampling",
+      "nv_gst_plugins developers");
+
+  trans_class->stop = GST_DEBUG_FUNCPTR (gst_nv_dewarp_stop);
+  trans_class->transform_caps =
+      GST_DEBUG_FUNCPTR (gst_nv_dewarp_transform_caps);
+  trans_class->decide_allocation =
+      GST_DEBUG_FUNCPTR (gst_nv_dewarp_decide_allocation);
+
+  filter_class->set_info = GST_DEBUG_FUNCPTR (gst_nv_dewarp_set_info);
+  filter_class->transform_frame =
+      GST_DEBUG_FUNCPTR (gst_nv_dewarp_transform_frame);
+
+  gst_type_mark_as_plugin_api (GST_TYPE_NV_DEWARP_PROJECTION,
+      (GstPluginAPIFlags) 0);
+  gst_type_mark_as_plugin_api (GST_TYPE_NV_SIMD_LEVEL, (GstPluginAPIFlags) 0);
+}
+
+static void
+gst_nv_dewarp_init (GstNvDewarp * self)
+{
+  self->views = g_strdup (DEFAULT_VIEWS);
+  self->view_width = DEFAULT_VIEW_WIDTH;
+  self->view_height = DEFAULT_VIEW_HEIGHT;
+  self->projection = DEFAULT_PROJECTION;
+  self->lens_fov = DEFAULT_LENS_FOV;
+  self->center_x = DEFAULT_CENTER_X;
+  self->center_y = DEFAULT_CENTER_Y;
+  self->radius = DEFAULT_RADIUS;
+  self->threads = DEFAULT_THREADS;
+  self->simd = DEFAULT_SIMD;
+  self->output_buffers = DEFAULT_OUTPUT_BUFFERS;
+  self->reconfigure = TRUE;
+  self->dewarper = new nvgst::Dewarper ();
+  self->pool = new nvgst::ThreadPool ();
+
+  gst_base_transform_set_qos_enabled (GST_BASE_TRANSFORM (self), TRUE);
+}
+
+static void
+gst_nv_dewarp_finalize (GObject * object)
+{
+  GstNvDewarp *self = GST_NV_DEWARP (object);
+
+  g_free (self->views);
+  g_free (self->cache_dir);
+  delete self->dewarper;
+  delete self->pool;
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_dewarp_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvDewarp *self = GST_NV_DEWARP (object);
+  gboolean resize = FALSE;
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_VIEWS:
+      g_free (self->views);
+      self->views = g_value_dup_string (value);
+      resize = TRUE;
+      break;
+    case PROP_VIEW_WIDTH:
+      self->view_width = g_value_get_uint (value);
+      resize = TRUE;
+      break;
+    case PROP_VIEW_HEIGHT:
+      self->view_height = g_value_get_uint (value);
+      resize = TRUE;
+      break;
+    case PROP_PROJECTION:
+      self->projection = (GstNvDewarpProjection) g_value_get_enum (value);
+      break;
+    case PROP_LENS_FOV:
+      self->lens_fov = g_value_get_double (value);
+      break;
+    case PROP_CENTER_X:
+      self->center_x = g_value_get_double (value);
+      break;
+    case PROP_CENTER_Y:
+      self->center_y = g_value_get_double (value);
+      break;
+    case PROP_RADIUS:
+      self->radius = g_value_get_double (value);
+      break;
+    case PROP_CACHE_DIR:
+      g_free (self->cache_dir);
+      self->cache_dir = g_value_dup_string (value);
+      break;
+    case PROP_THREADS:
+      self->threads = g_value_get_uint (value);
+      break;
+    case PROP_SIMD:
+      self->simd = (GstNvSimdLevel) g_value_get_enum (value);
+      break;
+    case PROP_OUTPUT_BUFFERS:
+      self->output_buffers = g_value_get_uint (value);
+      break;
+    default:
+      GST_OBJECT_UNLOCK (self);
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      return;
+  }
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  /* the output frame is the grid of views */
+  if (resize)
+    gst_base_transform_reconfigure_src (GST_BASE_TRANSFORM (self));
+}
+
+static void
+gst_nv_dewarp_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstNvDewarp *self = GST_NV_DEWARP (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_VIEWS:
+      g_value_set_string (value, self->views);
+      break;
+    case PROP_VIEW_WIDTH:
+      g_value_set_uint (value, self->view_width);
+      break;
+    case PROP_VIEW_HEIGHT:
+      g_value_set_uint (value, self->view_height);
+      break;
+    case PROP_PROJECTION:
+      g_value_set_enum (value, self->projection);
+      break;
+    case PROP_LENS_FOV:
+      g_value_set_double (value, self->lens_fov);
+      break;
+    case PROP_CENTER_X:
+      g_value_set_double (value, self->center_x);
+      break;
+    case PROP_CENTER_Y:
+      g_value_set_double (value, self->center_y);
+      break;
+    case PROP_RADIUS:
+      g_value_set_double (value, self->radius);
+      break;
+    case PROP_CACHE_DIR:
+      g_value_set_string (value, self->cache_dir);
+      break;
+    case PROP_THREADS:
+      g_value_set_uint (value, self->threads);
+      break;
+    case PROP_SIMD:
+      g_value_set_enum (value, self->simd);
+      break;
+    case PROP_OUTPUT_BUFFERS:
+      g_value_set_uint (value, self->output_buffers);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+/* "pan,tilt,fov;..."; FALSE on bad input or more than
+ * GST_NV_DEWARP_MAX_VIEWS views. */
+static gboolean
+gst_nv_dewarp_parse_views (const gchar * str,
+    std::vector < nvgst::DewarpView > *views)
+{
+  gchar **entries;
+  gboolean ok = TRUE;
+
+  views->clear ();
+  if (str == NULL)
+    return FALSE;
+
+  entries = g_strsplit (str, ";", -1);
+  for (gint i = 0; ok && entries[i] != NULL; i++) {
+    gfloat values[3];
+
+    /* tolerate a trailing separator */
+    if (*g_strstrip (entries[i]) == '\0' && entries[i + 1] == NULL)
+      break;
+    ok = gst_nv_parse_triplet (entries[i], values) &&
+        views->size () < GST_NV_DEWARP_MAX_VIEWS;
+    if (ok) {
+      nvgst::DewarpView view;
+
+      view.pan = values[0];
+      view.tilt = values[1];
+      view.fov = values[2];
+      views->push_back (view);
+    }
+  }
+  g_strfreev (entries);
+
+  return ok && !views->empty ();
+}
+
+static gboolean
+gst_nv_dewarp_stop (GstBaseTransform * trans)
+{
+  GstNvDewarp *self = GST_NV_DEWARP (trans);
+
+  self->pool->stop ();
+
+  GST_OBJECT_LOCK (self);
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  return TRUE;
+}
+
+/* The output is the grid of views in the input format; everything else
+ * (framerate, colorimetry, other caps features) passes through. */
+static GstCaps *
+gst_nv_dewarp_transform_caps (GstBaseTransform * trans,
+    GstPadDirection direction, GstCaps * caps, GstCaps * filter)
+{
+  GstNvDewarp *self = GST_NV_DEWARP (trans);
+  std::vector < nvgst::DewarpView > views;
+  GstCaps *ret = gst_caps_new_empty ();
+  guint view_width, view_height;
+  gint rows = 0, columns = 0;
+  gboolean parsed;
+  guint n = gst_caps_get_size (caps);
+
+  GST_OBJECT_LOCK (self);
+  parsed = gst_nv_dewarp_parse_views (self->views, &views);
+  view_width = self->view_width;
+  view_height = self->view_height;
+  GST_OBJECT_UNLOCK (self);
+
+  if (!parsed) {
+    GST_WARNING_OBJECT (self, "views must look like \"pan,tilt,fov;...\" "
+        "with at most %d views", GST_NV_DEWARP_MAX_VIEWS);
+    return ret;
+  }
+  nvgst::tile_grid_shape ((int) views.size (), &rows, &columns);
+
+  for (guint i = 0; i < n; i++) {
+    GstStructure *s = gst_caps_get_structure (caps, i);
+    GstCapsFeatures *f = gst_caps_get_features (caps, i);
+
+    if (i > 0 && gst_caps_is_subset_structure_full (ret, s, f))
+      continue;
+
+    s = gst_structure_copy (s);
+    if (gst_caps_features_is_equal (f, GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY)) {
+      if (direction == GST_PAD_SINK) {
+        gst_structure_set (s,
+            "width", G_TYPE_INT, columns * (gint) view_width,
+            "height", G_TYPE_INT, rows * (gint) view_height, NULL);
+      } else {
+        gst_structure_set (s,
+            "width", GST_TYPE_INT_RANGE, 2, G_MAXINT,
+            "height", GST_TYPE_INT_RANGE, 2, G_MAXINT, NULL);
+      }
+      /* views are rectilinear whatever the input aspect */
+      gst_structure_remove_field (s, "pixel-aspect-ratio");
+    }
+    gst_caps_append_structure_full (ret, s, gst_caps_features_copy (f));
+  }
+
+  if (filter) {
+    GstCaps *tmp =
+        gst_caps_intersect_full (filter, ret, GST_CAPS_INTERSECT_FIRST);
+    gst_caps_unref (ret);
+    ret = tmp;
+  }
+
+  GST_DEBUG_OBJECT (trans, "transformed %" GST_PTR_FORMAT " into %"
+      GST_PTR_FORMAT, caps, ret);
+
+  return ret;
+}
+
+/* Always allocates output from our own pool, sized to what downstream asked
+ * for but never below output-buffers. */
+static gboolean
+gst_nv_dewarp_decide_allocation (GstBaseTransform * trans, GstQuery * query)
+{
+  GstNvDewarp *self = GST_NV_DEWARP (trans);
+  GstBufferPool *pool;
+  GstCaps *outcaps;
+  guint size = 0, min = 0, max = 0, output_buffers;
+  gboolean video_meta;
+
+  gst_query_parse_allocation (query, &outcaps, NULL);
+  if (outcaps == NULL)
+    return FALSE;
+
+  if (gst_query_get_n_allocation_pools (query) > 0)
+    gst_query_parse_nth_allocation_pool (query, 0, NULL, &size, &min, &max);
+
+  GST_OBJECT_LOCK (self);
+  output_buffers = self->output_buffers;
+  GST_OBJECT_UNLOCK (self);
+
+  min = MAX (min, output_buffers);
+  if (max != 0)
+    max = MAX (max, min);
+
+  video_meta =
+      gst_query_find_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+
+  pool = gst_nv_buffer_pool_new_configured (outcaps, min, max, video_meta);
+  if (pool == NULL) {
+    GST_ERROR_OBJECT (self, "failed to create output pool for %"
+        GST_PTR_FORMAT, outcaps);
+    return FALSE;
+  }
+  size = gst_nv_buffer_pool_get_buffer_size (pool);
+
+  if (gst_query_get_n_allocation_pools (query) > 0)
+    gst_query_set_nth_allocation_pool (query, 0, pool, size, min, max);
+  else
+    gst_query_add_allocation_pool (query, pool, size, min, max);
+
+  gst_object_unref (pool);
+
+  return TRUE;
+}
+
+/* Takes property and caps changes into the remap tables and the thread
+ * pool. Tables are rebuilt, or loaded from the disk cache, only when the
+ * geometry changed. */
+static gboolean
+gst_nv_dewarp_apply_config (GstNvDewarp * self, const GstVideoInfo * in_info,
+    const GstVideoInfo * out_info)
+{
+  nvgst::DewarpConfig config;
+  GstNvSimdLevel simd;
+  gchar *cache_dir;
+  gboolean parsed;
+  guint threads;
+  gint rows = 0, columns = 0;
+  gboolean ok;
+
+  GST_OBJECT_LOCK (self);
+  if (!self->reconfigure) {
+    GST_OBJECT_UNLOCK (self);
+    return TRUE;
+  }
+  parsed = gst_nv_dewarp_parse_views (self->views, &config.views);
+  config.view_width = (int) self->view_width;
+  config.view_height = (int) self->view_height;
+  config.projection = self->projection == GST_NV_DEWARP_PROJECTION_EQUIRECT ?
+      nvgst::DewarpProjection::kEquirect : nvgst::DewarpProjection::kFisheye;
+  config.lens_fov = (float) self->lens_fov;
+  config.center_x = (float) self->center_x;
+  config.center_y = (float) self->center_y;
+  config.radius = (float) self->radius;
+  if (self->cache_dir)
+    cache_dir = g_strdup (self->cache_dir);
+  else
+    cache_dir = g_build_filename (g_get_user_cache_dir (), "nv_gst_plugins",
+        "dewarp", NULL);
+  threads = self->threads;
+  simd = self->simd;
+  self->reconfigure = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  if (!parsed) {
+    g_free (cache_dir);
+    GST_ERROR_OBJECT (self, "views must look like \"pan,tilt,fov;...\"");
+    return FALSE;
+  }
+
+  nvgst::tile_grid_shape ((int) config.views.size (), &rows, &columns);
+  if (columns * config.view_width != GST_VIDEO_INFO_WIDTH (out_info) ||
+      rows * config.view_height != GST_VIDEO_INFO_HEIGHT (out_info)) {
+    /* views changed after negotiation; wait for the new caps */
+    GST_DEBUG_OBJECT (self, "views do not match the output size yet");
+    g_free (cache_dir);
+    GST_OBJECT_LOCK (self);
+    self->reconfigure = TRUE;
+    GST_OBJECT_UNLOCK (self);
+    return TRUE;
+  }
+
+  config.format =
+      gst_nv_pixel_format_from_video_format (GST_VIDEO_INFO_FORMAT (in_info));
+  config.width = GST_VIDEO_INFO_WIDTH (in_info);
+  config.height = GST_VIDEO_INFO_HEIGHT (in_info);
+  config.simd = gst_nv_simd_level_resolve (simd);
+
+  if (threads == 0)
+    threads = g_get_num_processors ();
+  if (!self->pool->start ((int) threads)) {
+    g_free (cache_dir);
+    return FALSE;
+  }
+
+  if (*cache_dir != '\0' && g_mkdir_with_parents (cache_dir, 0755) != 0)
+    GST_WARNING_OBJECT (self, "cannot create cache directory %s: %s",
+        cache_dir, g_strerror (errno));
+  ok = self->dewarper->configure (config, cache_dir, self->pool);
+  if (!ok) {
+    GST_ERROR_OBJECT (self, "cannot dewarp %s %dx%d into %dx%d views",
+        nvgst::format_name (config.format), config.width, config.height,
+        config.view_width, config.view_height);
+  } else {
+    self->rows = rows;
+    self->columns = columns;
+    GST_INFO_OBJECT (self, "%d views of %dx%d from %s %dx%d, %s %"
+        G_GSIZE_FORMAT " KiB of tables, %d threads, using %s kernels",
+        self->dewarper->n_views (), config.view_width, config.view_height,
+        nvgst::format_name (config.format), config.width, config.height,
+        self->dewarper->from_cache ()? "loaded" : "built",
+        self->dewarper->table_bytes () / 1024, self->pool->size (),
+        nvgst::simd_level_name (config.simd));
+  }
+  g_free (cache_dir);
+
+  return ok;
+}
+
+static gboolean
+gst_nv_dewarp_set_info (GstVideoFilter * filter, GstCaps * incaps,
+    GstVideoInfo * in_info, GstCaps * outcaps, GstVideoInfo * out_info)
+{
+  GstNvDewarp *self = GST_NV_DEWARP (filter);
+
+  if (GST_VIDEO_INFO_FORMAT (in_info) != GST_VIDEO_INFO_FORMAT (out_info)) {
+    GST_ERROR_OBJECT (self, "input and output formats differ");
+    return FALSE;
+  }
+
+  /* tables are built here rather than on the first buffer */
+  GST_OBJECT_LOCK (self);
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  return gst_nv_dewarp_apply_config (self, in_info, out_info);
+}
+
+/* Cell of the grid as a view into the output frame. */
+static nvgst::FrameView
+gst_nv_dewarp_cell (const nvgst::FrameView & frame, gint x, gint y,
+    gint width, gint height)
+{
+  nvgst::FrameView cell = frame;
+
+  cell.width = width;
+  cell.height = height;
+  for (gint p = 0; p < nvgst::format_n_planes (frame.format); p++) {
+    cell.data[p] += (gsize) nvgst::plane_height (frame.format, p, y) *
+        frame.stride[p] + (gsize) nvgst::plane_width (frame.format, p, x) *
+        nvgst::plane_pixel_stride (frame.format, p);
+  }
+  return cell;
+}
+
+/* Black for cells without a view. */
+static void
+gst_nv_dewarp_fill_cell (const nvgst::FrameView & cell)
+{
+  const nvgst::simd::Kernels & k = nvgst::simd::kernels ();
+  gboolean yuv = nvgst::format_is_yuv (cell.format);
+
+  for (gint p = 0; p < nvgst::format_n_planes (cell.format); p++) {
+    gint bpp = nvgst::plane_pixel_stride (cell.format, p);
+    guint32 pattern = !yuv ? 0xff000000u : p == 0 ? 16 : 0x8080;
+    gint w = nvgst::plane_width (cell.format, p, cell.width);
+    gint h = nvgst::plane_height (cell.format, p, cell.height);
+
+    for (gint y = 0; y < h; y++)
+      k.fill_span (cell.data[p] + (gsize) y * cell.stride[p], w, pattern, bpp);
+  }
+}
+
+static GstFlowReturn
+gst_nv_dewarp_transform_frame (GstVideoFilter * filter,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame)
+{
+  GstNvDewarp *self = GST_NV_DEWARP (filter);
+  nvgst::FrameView cells[GST_NV_DEWARP_MAX_VIEWS];
+  nvgst::FrameView out;
+  gint n_views, view_width, view_height;
+
+  if (!gst_nv_dewarp_apply_config (self, &filter->in_info, &filter->out_info))
+    return GST_FLOW_NOT_NEGOTIATED;
+
+  n_views = self->dewarper->n_views ();
+  view_width = self->dewarper->config ().view_width;
+  view_height = self->dewarper->config ().view_height;
+  if (n_views == 0 || self->columns * view_width > GST_VIDEO_FRAME_WIDTH
+      (out_frame) || self->rows * view_height > GST_VIDEO_FRAME_HEIGHT
+      (out_frame)) {
+    GST_DEBUG_OBJECT (self, "no views for this output size, dropping");
+    return GST_BASE_TRANSFORM_FLOW_DROPPED;
+  }
+
+  out = gst_nv_frame_view_from_video_frame (out_frame);
+  for (gint i = 0; i < self->rows * self->columns; i++) {
+    nvgst::FrameView cell = gst_nv_dewarp_cell (out,
+        i % self->columns * view_width, i / self->columns * view_height,
+        view_width, view_height);
+
+    if (i < n_views)
+      cells[i] = cell;
+    else
+      gst_nv_dewarp_fill_cell (cell);
+  }
+
+  self->dewarper->run (gst_nv_frame_view_from_video_frame (in_frame), cells,
+      self->pool);
+
+  return GST_FLOW_OK;
+}
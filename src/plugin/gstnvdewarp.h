@@ -0,0 +1,74 @@
+#ifndef __GST_NV_DEWARP_H__
+#define __GST_NV_DEWARP_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include <gst/video/gstvideofilter.h>
+
+#include "gstnvutils.h"
+#include "core/dewarp.h"
+#include "core/thread_pool.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+  GST_NV_DEWARP_PROJECTION_FISHEYE,
+  GST_NV_DEWARP_PROJECTION_EQUIRECT,
+} GstNvDewarpProjection;
+
+#define GST_TYPE_NV_DEWARP_PROJECTION (gst_nv_dewarp_projection_get_type ())
+GType gst_nv_dewarp_projection_get_type (void);
+
+#define GST_TYPE_NV_DEWARP \
+  (gst_nv_dewarp_get_type())
+#define GST_NV_DEWARP(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_DEWARP,GstNvDewarp))
+#define GST_NV_DEWARP_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_DEWARP,GstNvDewarpClass))
+#define GST_IS_NV_DEWARP(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_DEWARP))
+
+#define GST_NV_DEWARP_MAX_VIEWS 16
+
+typedef struct _GstNvDewarp GstNvDewarp;
+typedef struct _GstNvDewarpClass GstNvDewarpClass;
+
+struct _GstNvDewarp
+{
+  GstVideoFilter parent;
+
+  /* properties, protected by the object lock */
+  gchar *views;
+  guint view_width;
+  guint view_height;
+  GstNvDewarpProjection projection;
+  gdouble lens_fov;
+  gdouble center_x;
+  gdouble center_y;
+  gdouble radius;
+  gchar *cache_dir;
+  guint threads;
+  GstNvSimdLevel simd;
+  guint output_buffers;
+  gboolean reconfigure;
+
+  /* streaming thread only */
+  nvgst::Dewarper *dewarper;
+  nvgst::ThreadPool *pool;
+  /* grid of views in the output frame */
+  gint rows;
+  gint columns;
+};
+
+struct _GstNvDewarpClass
+{
+  GstVideoFilterClass parent_class;
+};
+
+GType gst_nv_dewarp_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvdewarp);
+
+G_END_DECLS
+
+#endif /* __GST_NV_DEWARP_H__ */
@@ -0,0 +1,83 @@
+#include "gstnvdrawmeta.h"
+
+GType
+gst_nv_draw_meta_api_get_type (void)
+{
+  static GType type = 0;
+  static const gchar *tags[] = { GST_META_TAG_VIDEO_STR,
+    GST_META_TAG_VIDEO_SIZE_STR, NULL
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = gst_meta_api_type_register ("GstNvDrawMetaAPI", tags);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+static gboolean
+gst_nv_draw_meta_init (GstMeta * meta, gpointer params, GstBuffer * buffer)
+{
+  GstNvDrawMeta *dmeta = (GstNvDrawMeta *) meta;
+
+  dmeta->list = new nvgst::DrawList ();
+
+  return TRUE;
+}
+
+static void
+gst_nv_draw_meta_free (GstMeta * meta, GstBuffer * buffer)
+{
+  GstNvDrawMeta *dmeta = (GstNvDrawMeta *) meta;
+
+  delete dmeta->list;
+  dmeta->list = NULL;
+}
+
+/* Coordinates only hold for the whole frame, so region copies drop the
+ * commands. */
+static gboolean
+gst_nv_draw_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstNvDrawMeta *src = (GstNvDrawMeta *) meta;
+  GstNvDrawMeta *dmeta;
+  GstMetaTransformCopy *copy;
+
+  if (!GST_META_TRANSFORM_IS_COPY (type))
+    return FALSE;
+
+  copy = (GstMetaTransformCopy *) data;
+  if (copy->region)
+    return FALSE;
+
+  dmeta = gst_buffer_add_nv_draw_meta (dest);
+  if (dmeta == NULL)
+    return FALSE;
+
+  *dmeta->list = *src->list;
+
+  return TRUE;
+}
+
+const GstMetaInfo *
+gst_nv_draw_meta_get_info (void)
+{
+  static const GstMetaInfo *info = NULL;
+
+  if (g_once_init_enter (&info)) {
+    const GstMetaInfo *tmp = gst_meta_register (GST_NV_DRAW_META_API_TYPE,
+        "GstNvDrawMeta", sizeof (GstNvDrawMeta),
+        gst_nv_draw_meta_init, gst_nv_draw_meta_free,
+        gst_nv_draw_meta_transform);
+    g_once_init_leave (&info, tmp);
+  }
+  return info;
+}
+
+GstNvDrawMeta *
+gst_buffer_add_nv_draw_meta (GstBuffer * buffer)
+{
+  return (GstNvDrawMeta *) gst_buffer_add_meta (buffer, GST_NV_DRAW_META_INFO,
+      NULL);
+}
@@ -0,0 +1,43 @@
+/* Draw commands (boxes, lines, labels) attached to a buffer by analytics
+ * elements and rendered by nvosd. */
+#ifndef __GST_NV_DRAW_META_H__
+#define __GST_NV_DRAW_META_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "core/draw_list.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GstNvDrawMeta GstNvDrawMeta;
+
+/**
+ * GstNvDrawMeta:
+ * @meta: parent #GstMeta
+ * @list: the commands, owned by the meta. Coordinates are in pixels of the
+ *     buffer's frames; on batches each command names its frame index.
+ *
+ * Fill it with the nvgst::DrawList methods from core/draw_list.h.
+ */
+struct _GstNvDrawMeta
+{
+  GstMeta meta;
+
+  nvgst::DrawList *list;
+};
+
+GType gst_nv_draw_meta_api_get_type (void);
+#define GST_NV_DRAW_META_API_TYPE (gst_nv_draw_meta_api_get_type ())
+
+const GstMetaInfo *gst_nv_draw_meta_get_info (void);
+#define GST_NV_DRAW_META_INFO (gst_nv_draw_meta_get_info ())
+
+#define gst_buffer_get_nv_draw_meta(b) \
+  ((GstNvDrawMeta *) gst_buffer_get_meta ((b), GST_NV_DRAW_META_API_TYPE))
+
+GstNvDrawMeta *gst_buffer_add_nv_draw_meta (GstBuffer * buffer);
+
+G_END_DECLS
+
+#endif /* __GST_NV_DRAW_META_H__ */
@@ -0,0 +1,725 @@
+/**
+ * SECTION:element-nvinfer
+ *
+ * Runs a neural network on every frame and attaches its outputs as a
+ * #GstNvTensorMeta. The network runs behind a backend interface; the
+ * built-in "reference" backend is a small CPU network that needs no
+ * runtime or GPU, for tests and benchmarks.
+ *
+ * Frames are scaled, converted, normalized and packed into planar float
+ * tensors with SIMD kernels on the streaming thread, straight into a
+ * tensor arena allocated once per configuration. Inference then runs
+ * asynchronously on a pool of worker threads, so preprocessing of the next
+ * frames overlaps inference of the previous ones, and a source pad task
+ * pushes buffers and serialized events downstream in their original
+ * order.
+ *
+ * Up to batch-size frames are collected into one request: consecutive
+ * single frames, or whole nvbatchmux batches. A request is sent off when
+ * it is full or when a serialized event (EOS, segment, caps) arrives, so
+ * with batch-size > 1 on a live stream frames wait for the next ones.
+ * Serialized queries (drain, allocation) also send it off, and wait until
+ * every frame before them has been pushed before they go downstream.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 filesrc location=cam.mp4 ! decodebin ! nvconvert ! \
+ *     video/x-raw,format=NV12 ! nvinfer workers=4 batch-size=4 ! fakesink
+ * ]|
+ */
+
+#include "gstnvinfer.h"
+#include "gstnvbatchmeta.h"
+#include "gstnvtensormeta.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_infer_debug);
+#define GST_CAT_DEFAULT gst_nv_infer_debug
+
+#define DEFAULT_BACKEND "reference"
+#define DEFAULT_BATCH_SIZE 1
+#define DEFAULT_WORKERS 2
+#define DEFAULT_INFLIGHT 4
+#define DEFAULT_BGR FALSE
+#define DEFAULT_OFFSET 0.0f
+#define DEFAULT_SCALE (1.0f / 255.0f)
+#define DEFAULT_SIMD GST_NV_SIMD_LEVEL_AUTO
+
+enum
+{
+  PROP_0,
+  PROP_BACKEND,
+  PROP_MODEL_LOCATION,
+  PROP_BATCH_SIZE,
+  PROP_WORKERS,
+  PROP_INFLIGHT,
+  PROP_BGR,
+  PROP_OFFSETS,
+  PROP_SCALES,
+  PROP_SIMD,
+};
+
+#define NV_INFER_FORMATS "{ NV12, I420, RGBA, BGRx }"
+
+#define NV_INFER_CAPS \
+  GST_VIDEO_CAPS_MAKE (NV_INFER_FORMATS) "; " \
+  GST_NV_BATCH_CAPS_MAKE (NV_INFER_FORMATS)
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_INFER_CAPS));
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_INFER_CAPS));
+
+#define gst_nv_infer_parent_class parent_class
+G_DEFINE_TYPE (GstNvInfer, gst_nv_infer, GST_TYPE_ELEMENT);
+GST_ELEMENT_REGISTER_DEFINE (nvinfer, "nvinfer", GST_RANK_NONE,
+    GST_TYPE_NV_INFER);
+
+static void gst_nv_infer_finalize (GObject * object);
+static void gst_nv_infer_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_infer_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static GstStateChangeReturn gst_nv_infer_change_state (GstElement * element,
+    GstStateChange transition);
+static GstFlowReturn gst_nv_infer_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buffer);
+static gboolean gst_nv_infer_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event);
+static gboolean gst_nv_infer_sink_query (GstPad * pad, GstObject * parent,
+    GstQuery * query);
+static void gst_nv_infer_loop (gpointer user_data);
+
+static void
+gst_nv_infer_class_init (GstNvInferClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_infer_debug, "nvinfer", 0,
+      "nvinfer element");
+
+  gobject_class->finalize = gst_nv_infer_finalize;
+  gobject_class->set_property = gst_nv_infer_set_property;
+  gobject_class->get_property = gst_nv_infer_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_BACKEND,
+      g_param_spec_string ("backend", "Backend",
+          "Inference backend (applied on the next caps change)",
+          DEFAULT_BACKEND,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MODEL_LOCATION,
+      g_param_spec_string ("model-location", "Model location",
+          "Model for the backend; the reference backend uses built-in "
+          "weights when unset (applied on the next caps change)",
+          NULL, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_BATCH_SIZE,
+      g_param_spec_uint ("batch-size", "Batch size",
+          "Frames collected into one inference request; nvbatchmux batches "
+          "always go into one request whole (applied on the next caps change)",
+          1, GST_NV_BATCH_MAX_FRAMES, DEFAULT_BATCH_SIZE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_WORKERS,
+      g_param_spec_uint ("workers", "Workers",
+          "Inference threads, each with its own backend instance "
+          "(applied on the next caps change)",
+          1, 64, DEFAULT_WORKERS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_INFLIGHT,
+      g_param_spec_uint ("inflight", "In flight",
+          "Requests being filled, inferred or pushed at once; upstream "
+          "blocks when all are in use (applied on the next caps change)",
+          2, 64, DEFAULT_INFLIGHT,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_BGR,
+      g_param_spec_boolean ("bgr", "BGR",
+          "Feed the network B, G, R planes instead of R, G, B "
+          "(applied on the next caps change)",
+          DEFAULT_BGR,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_OFFSETS,
+      g_param_spec_string ("offsets", "Offsets",
+          "Per-plane values subtracted from 0-255 samples, as \"a,b,c\" in "
+          "plane order (applied on the next caps change)",
+          "0,0,0", (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SCALES,
+      g_param_spec_string ("scales", "Scales",
+          "Per-plane factors applied after the offsets, as \"a,b,c\" in "
+          "plane order (applied on the next caps change)",
+          "0.00392157,0.00392157,0.00392157",
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SIMD,
+      g_param_spec_enum ("simd", "SIMD",
+          "Highest SIMD level to use, capped at what the CPU supports "
+          "(applied on the next caps change)",
+          GST_TYPE_NV_SIMD_LEVEL, DEFAULT_SIMD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV inference", "Filter/Analyzer/Video",
+      "Runs a network on every frame with SIMD preprocessing and an "
+      "ordered pool of inference workers, attaching GstNvTensorMeta",
+      "nv_gst_plugins developers");
+
+  element_class->change_state = GST_DEBUG_FUNCPTR (gst_nv_infer_change_state);
+}
+
+static void
+gst_nv_infer_init (GstNvInfer * self)
+{
+  self->sinkpad = gst_pad_new_from_static_template (&sink_template, "sink");
+  gst_pad_set_chain_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_nv_infer_chain));
+  gst_pad_set_event_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_nv_infer_sink_event));
+  gst_pad_set_query_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_nv_infer_sink_query));
+  GST_PAD_SET_PROXY_CAPS (self->sinkpad);
+  GST_PAD_SET_PROXY_ALLOCATION (self->sinkpad);
+  gst_element_add_pad (GST_ELEMENT (self), self->sinkpad);
+
+  self->srcpad = gst_pad_new_from_static_template (&src_template, "src");
+  GST_PAD_SET_PROXY_CAPS (self->srcpad);
+  gst_element_add_pad (GST_ELEMENT (self), self->srcpad);
+
+  self->backend = g_strdup (DEFAULT_BACKEND);
+  self->model_location = NULL;
+  self->batch_size = DEFAULT_BATCH_SIZE;
+  self->workers = DEFAULT_WORKERS;
+  self->inflight = DEFAULT_INFLIGHT;
+  self->bgr = DEFAULT_BGR;
+  for (gint c = 0; c < 3; c++) {
+    self->offsets[c] = DEFAULT_OFFSET;
+    self->scales[c] = DEFAULT_SCALE;
+  }
+  self->simd = DEFAULT_SIMD;
+
+  gst_video_info_init (&self->info);
+  self->batched = FALSE;
+  self->buffer_frames = 1;
+  self->request_frames = 1;
+  self->preprocess = new nvgst::TensorPreprocessor ();
+  self->current = NULL;
+  self->engine = new nvgst::InferenceEngine ();
+  self->items = new std::vector < std::vector < GstNvInferItem > >();
+  self->src_result = GST_FLOW_OK;
+}
+
+static void
+gst_nv_infer_finalize (GObject * object)
+{
+  GstNvInfer *self = GST_NV_INFER (object);
+
+  delete self->engine;
+  delete self->items;
+  delete self->preprocess;
+  g_free (self->backend);
+  g_free (self->model_location);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_infer_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvInfer *self = GST_NV_INFER (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_BACKEND:
+      g_free (self->backend);
+      self->backend = g_value_dup_string (value);
+      break;
+    case PROP_MODEL_LOCATION:
+      g_free (self->model_location);
+      self->model_location = g_value_dup_string (value);
+      break;
+    case PROP_BATCH_SIZE:
+      self->batch_size = g_value_get_uint (value);
+      break;
+    case PROP_WORKERS:
+      self->workers = g_value_get_uint (value);
+      break;
+    case PROP_INFLIGHT:
+      self->inflight = g_value_get_uint (value);
+      break;
+    case PROP_BGR:
+      self->bgr = g_value_get_boolean (value);
+      break;
+    case PROP_OFFSETS:
+      if (!gst_nv_parse_triplet (g_value_get_string (value),
+              self->offsets))
+        GST_WARNING_OBJECT (self, "offsets must be three numbers \"a,b,c\"");
+      break;
+    case PROP_SCALES:
+      if (!gst_nv_parse_triplet (g_value_get_string (value),
+              self->scales))
+        GST_WARNING_OBJECT (self, "scales must be three numbers \"a,b,c\"");
+      break;
+    case PROP_SIMD:
+      self->simd = (GstNvSimdLevel) g_value_get_enum (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_infer_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstNvInfer *self = GST_NV_INFER (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_BACKEND:
+      g_value_set_string (value, self->backend);
+      break;
+    case PROP_MODEL_LOCATION:
+      g_value_set_string (value, self->model_location);
+      break;
+    case PROP_BATCH_SIZE:
+      g_value_set_uint (value, self->batch_size);
+      break;
+    case PROP_WORKERS:
+      g_value_set_uint (value, self->workers);
+      break;
+    case PROP_INFLIGHT:
+      g_value_set_uint (value, self->inflight);
+      break;
+    case PROP_BGR:
+      g_value_set_boolean (value, self->bgr);
+      break;
+    case PROP_OFFSETS:
+      g_value_take_string (value, gst_nv_format_triplet (self->offsets));
+      break;
+    case PROP_SCALES:
+      g_value_take_string (value, gst_nv_format_triplet (self->scales));
+      break;
+    case PROP_SIMD:
+      g_value_set_enum (value, self->simd);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+/* Drops everything queued; only called while neither the streaming thread
+ * nor the src task is using the items. */
+static void
+gst_nv_infer_clear_items (GstNvInfer * self)
+{
+  for (std::vector < GstNvInferItem > &items:*self->items) {
+    for (GstNvInferItem & item:items)
+      gst_mini_object_unref (item.object);
+    items.clear ();
+  }
+  self->current = NULL;
+}
+
+static GstStateChangeReturn
+gst_nv_infer_change_state (GstElement * element, GstStateChange transition)
+{
+  GstNvInfer *self = GST_NV_INFER (element);
+  GstStateChangeReturn ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      GST_OBJECT_LOCK (self);
+      self->src_result = GST_FLOW_OK;
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* unblocks the streaming thread and the src task */
+      self->engine->set_flushing (true);
+      gst_pad_stop_task (self->srcpad);
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+  if (ret == GST_STATE_CHANGE_FAILURE)
+    return ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      self->engine->stop ();
+      gst_nv_infer_clear_items (self);
+      self->items->clear ();
+      gst_video_info_init (&self->info);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
+static void
+gst_nv_infer_submit (GstNvInfer * self)
+{
+  self->engine->submit (self->current);
+  self->current = NULL;
+}
+
+/* Starts the engine, or restarts it after pushing out everything queued
+ * when its configuration changed. */
+static gboolean
+gst_nv_infer_set_caps (GstNvInfer * self, GstCaps * caps)
+{
+  GstCapsFeatures *features;
+  nvgst::InferenceConfig config;
+  nvgst::PreprocessConfig pre;
+  const nvgst::InferenceConfig *old = &self->engine->config ();
+  GstNvSimdLevel simd;
+  gint batch = 1;
+  std::string error;
+
+  if (!gst_video_info_from_caps (&self->info, caps)) {
+    GST_ERROR_OBJECT (self, "invalid caps %" GST_PTR_FORMAT, caps);
+    return FALSE;
+  }
+
+  features = gst_caps_get_features (caps, 0);
+  self->batched = features != NULL &&
+      gst_caps_features_contains (features, GST_CAPS_FEATURE_META_GST_NV_BATCH);
+  if (self->batched)
+    gst_structure_get_int (gst_caps_get_structure (caps, 0), "batch-size",
+        &batch);
+  self->buffer_frames = (guint) MAX (batch, 1);
+
+  GST_OBJECT_LOCK (self);
+  config.backend = self->backend ? self->backend : "";
+  config.model = self->model_location ? self->model_location : "";
+  config.workers = (int) self->workers;
+  config.requests = (int) self->inflight;
+  config.max_batch = (int) MAX (self->batch_size, self->buffer_frames);
+  self->request_frames = self->batch_size;
+  pre.bgr = self->bgr;
+  for (gint c = 0; c < 3; c++) {
+    pre.offset[c] = self->offsets[c];
+    pre.scale[c] = self->scales[c];
+  }
+  simd = self->simd;
+  GST_OBJECT_UNLOCK (self);
+
+  if (!self->engine->running () || config.backend != old->backend ||
+      config.model != old->model || config.workers != old->workers ||
+      config.requests != old->requests || config.max_batch != old->max_batch) {
+    if (self->engine->running ()) {
+      if (self->current != NULL)
+        gst_nv_infer_submit (self);
+      if (!self->engine->drain ())
+        return FALSE;
+      self->engine->stop ();
+      gst_pad_pause_task (self->srcpad);
+    }
+
+    if (!self->engine->start (config, &error)) {
+      GST_ELEMENT_ERROR (self, LIBRARY, INIT, (NULL),
+          ("cannot start %s backend: %s", config.backend.c_str (),
+              error.c_str ()));
+      return FALSE;
+    }
+    self->items->assign (config.requests, std::vector < GstNvInferItem > ());
+    gst_pad_start_task (self->srcpad, gst_nv_infer_loop, self, NULL);
+  }
+
+  pre.format =
+      gst_nv_pixel_format_from_video_format (GST_VIDEO_INFO_FORMAT
+      (&self->info));
+  pre.width = GST_VIDEO_INFO_WIDTH (&self->info);
+  pre.height = GST_VIDEO_INFO_HEIGHT (&self->info);
+  pre.matrix = gst_nv_color_matrix_from_video_info (&self->info);
+  pre.out_width = self->engine->input ().shape[2];
+  pre.out_height = self->engine->input ().shape[1];
+  pre.simd = gst_nv_simd_level_resolve (simd);
+  if (!self->preprocess->configure (pre)) {
+    GST_ERROR_OBJECT (self, "unsupported caps %" GST_PTR_FORMAT, caps);
+    return FALSE;
+  }
+
+  GST_INFO_OBJECT (self, "%s%s %dx%d into %s %dx%d tensors, %d workers, "
+      "up to %d frames per request, %s kernels",
+      self->batched ? "batched " : "", nvgst::format_name (pre.format),
+      pre.width, pre.height, config.backend.c_str (), pre.out_width,
+      pre.out_height, config.workers, config.max_batch,
+      nvgst::simd_level_name (pre.simd));
+
+  return TRUE;
+}
+
+/* Serialized events travel in the request order, behind the frames that
+ * came before them. */
+static gboolean
+gst_nv_infer_queue_event (GstNvInfer * self, GstEvent * event)
+{
+  if (self->current == NULL) {
+    self->current = self->engine->acquire ();
+    if (self->current == NULL) {
+      gst_event_unref (event);
+      return FALSE;
+    }
+  }
+
+  (*self->items)[self->current->index].push_back ({GST_MINI_OBJECT_CAST
+          (event), 0});
+  gst_nv_infer_submit (self);
+  return TRUE;
+}
+
+static gboolean
+gst_nv_infer_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  GstNvInfer *self = GST_NV_INFER (parent);
+  gboolean ret;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_START:
+      ret = gst_pad_push_event (self->srcpad, event);
+      self->engine->set_flushing (true);
+      gst_pad_pause_task (self->srcpad);
+      return ret;
+    case GST_EVENT_FLUSH_STOP:
+      self->engine->set_flushing (false);
+      gst_nv_infer_clear_items (self);
+      GST_OBJECT_LOCK (self);
+      self->src_result = GST_FLOW_OK;
+      GST_OBJECT_UNLOCK (self);
+      ret = gst_pad_push_event (self->srcpad, event);
+      if (self->engine->running ())
+        gst_pad_start_task (self->srcpad, gst_nv_infer_loop, self, NULL);
+      return ret;
+    case GST_EVENT_CAPS:{
+      GstCaps *caps;
+
+      gst_event_parse_caps (event, &caps);
+      if (!gst_nv_infer_set_caps (self, caps)) {
+        gst_event_unref (event);
+        return FALSE;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+
+  /* before the first caps nothing is queued, so order is kept either way */
+  if (!GST_EVENT_IS_SERIALIZED (event) || !self->engine->running ())
+    return gst_pad_event_default (pad, parent, event);
+
+  return gst_nv_infer_queue_event (self, event);
+}
+
+/* Serialized queries must not overtake the frames before them: the open
+ * request is sent off and every request pushed before the query is
+ * forwarded. */
+static gboolean
+gst_nv_infer_sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  GstNvInfer *self = GST_NV_INFER (parent);
+  GstFlowReturn src_result;
+
+  if (GST_QUERY_IS_SERIALIZED (query) && self->engine->running ()) {
+    GST_OBJECT_LOCK (self);
+    src_result = self->src_result;
+    GST_OBJECT_UNLOCK (self);
+    /* a paused src task would never release the queued requests */
+    if (src_result != GST_FLOW_OK)
+      return FALSE;
+
+    if (self->current != NULL)
+      gst_nv_infer_submit (self);
+    if (!self->engine->drain ())
+      return FALSE;
+  }
+
+  return gst_pad_query_default (pad, parent, query);
+}
+
+static gboolean
+gst_nv_infer_preprocess (GstNvInfer * self, GstBuffer * buffer,
+    GstNvBatchMeta * bmeta, guint n_frames, float *dst)
+{
+  const size_t frame_size = self->engine->input ().count ();
+  GstVideoFrame frame;
+  GstMapInfo map;
+
+  if (bmeta == NULL) {
+    if (!gst_video_frame_map (&frame, &self->info, buffer, GST_MAP_READ))
+      return FALSE;
+    self->preprocess->run (gst_nv_frame_view_from_video_frame (&frame), dst);
+    gst_video_frame_unmap (&frame);
+    return TRUE;
+  }
+
+  for (guint i = 0; i < n_frames; i++) {
+    if (!gst_nv_batch_meta_map_frame (bmeta, buffer, i, &map, GST_MAP_READ))
+      return FALSE;
+    self->preprocess->run (gst_nv_batch_frame_view (&bmeta->frames[i],
+            &self->info, &map), dst + i * frame_size);
+    gst_nv_batch_meta_unmap_frame (bmeta, buffer, i, &map);
+  }
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_nv_infer_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstNvInfer *self = GST_NV_INFER (parent);
+  GstNvBatchMeta *bmeta = NULL;
+  GstFlowReturn ret;
+  guint n_frames = 1;
+  float *dst;
+
+  GST_OBJECT_LOCK (self);
+  ret = self->src_result;
+  GST_OBJECT_UNLOCK (self);
+  if (ret != GST_FLOW_OK) {
+    gst_buffer_unref (buffer);
+    return ret;
+  }
+
+  if (!self->engine->running ()) {
+    gst_buffer_unref (buffer);
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
+
+  if (self->batched) {
+    bmeta = gst_buffer_get_nv_batch_meta (buffer);
+    if (bmeta == NULL) {
+      GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
+          ("batched buffer without GstNvBatchMeta"));
+      gst_buffer_unref (buffer);
+      return GST_FLOW_ERROR;
+    }
+    n_frames = bmeta->n_frames;
+  }
+
+  if (self->current != NULL && self->current->batch + (int) n_frames >
+      self->engine->config ().max_batch)
+    gst_nv_infer_submit (self);
+  if (self->current == NULL) {
+    self->current = self->engine->acquire ();
+    if (self->current == NULL) {
+      gst_buffer_unref (buffer);
+      return GST_FLOW_FLUSHING;
+    }
+  }
+
+  dst = self->current->input +
+      self->current->batch * self->engine->input ().count ();
+  if (!gst_nv_infer_preprocess (self, buffer, bmeta, n_frames, dst)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL), ("failed to map frame"));
+    gst_buffer_unref (buffer);
+    return GST_FLOW_ERROR;
+  }
+
+  (*self->items)[self->current->index].push_back ({GST_MINI_OBJECT_CAST
+          (buffer), n_frames});
+  self->current->batch += (int) n_frames;
+  if ((guint) self->current->batch >= self->request_frames)
+    gst_nv_infer_submit (self);
+
+  return GST_FLOW_OK;
+}
+
+/* Gives buffer the outputs of its n_frames frames, starting at frame
+ * first of the request. The tensors alias the request's output blocks. */
+static GstBuffer *
+gst_nv_infer_attach (GstNvInfer * self, GstBuffer * buffer,
+    const nvgst::InferenceEngine::Request * request, guint first,
+    guint n_frames)
+{
+  GstNvTensorMeta *meta;
+
+  buffer = gst_buffer_make_writable (buffer);
+  meta = gst_buffer_add_nv_tensor_meta (buffer);
+  meta->tensors->reserve (request->outputs.size ());
+  for (const nvgst::Tensor & out:request->outputs) {
+    const size_t per_frame = out.info.count () / request->batch;
+    nvgst::Tensor tensor;
+
+    tensor.info = out.info;
+    tensor.info.shape[0] = (int) n_frames;
+    tensor.data = std::shared_ptr < float >(out.data,
+        out.data.get () + first * per_frame);
+    meta->tensors->push_back (std::move (tensor));
+  }
+  return buffer;
+}
+
+static void
+gst_nv_infer_loop (gpointer user_data)
+{
+  GstNvInfer *self = GST_NV_INFER (user_data);
+  nvgst::InferenceEngine::Request * request = self->engine->next ();
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint first = 0;
+
+  if (request == NULL) {
+    GST_DEBUG_OBJECT (self, "engine stopped or flushing, pausing");
+    gst_pad_pause_task (self->srcpad);
+    return;
+  }
+
+  if (!request->ok) {
+    GST_ELEMENT_ERROR (self, LIBRARY, FAILED, (NULL),
+        ("inference failed on a request of %d frames", request->batch));
+    ret = GST_FLOW_ERROR;
+  }
+
+  std::vector < GstNvInferItem > &items = (*self->items)[request->index];
+  for (GstNvInferItem & item:items) {
+    if (GST_IS_EVENT (item.object)) {
+      gst_pad_push_event (self->srcpad, GST_EVENT_CAST (item.object));
+      continue;
+    }
+
+    if (ret != GST_FLOW_OK) {
+      gst_mini_object_unref (item.object);
+    } else {
+      GstBuffer *buffer = gst_nv_infer_attach (self,
+          GST_BUFFER_CAST (item.object), request, first, item.n_frames);
+      ret = gst_pad_push (self->srcpad, buffer);
+    }
+    first += item.n_frames;
+  }
+  items.clear ();
+  self->engine->release (request);
+
+  if (ret == GST_FLOW_OK)
+    return;
+
+  GST_OBJECT_LOCK (self);
+  self->src_result = ret;
+  GST_OBJECT_UNLOCK (self);
+
+  GST_DEBUG_OBJECT (self, "pausing task, reason %s", gst_flow_get_name (ret));
+  if (ret == GST_FLOW_NOT_LINKED || ret < GST_FLOW_EOS) {
+    GST_ELEMENT_ERROR (self, STREAM, FAILED, ("Internal data stream error."),
+        ("streaming stopped, reason %s", gst_flow_get_name (ret)));
+    gst_pad_push_event (self->srcpad, gst_event_new_eos ());
+  }
+  gst_pad_pause_task (self->srcpad);
+}
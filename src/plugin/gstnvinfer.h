@@ -0,0 +1,83 @@
+#ifndef __GST_NV_INFER_H__
+#define __GST_NV_INFER_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include <vector>
+
+#include "gstnvutils.h"
+#include "core/inference_engine.h"
+#include "core/preprocess.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_NV_INFER \
+  (gst_nv_infer_get_type())
+#define GST_NV_INFER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_INFER,GstNvInfer))
+#define GST_NV_INFER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_INFER,GstNvInferClass))
+#define GST_IS_NV_INFER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_INFER))
+
+typedef struct _GstNvInfer GstNvInfer;
+typedef struct _GstNvInferClass GstNvInferClass;
+typedef struct _GstNvInferItem GstNvInferItem;
+
+/* A buffer (with the number of frames it put into the request) or a
+ * serialized event, in stream order. */
+struct _GstNvInferItem
+{
+  GstMiniObject *object;
+  guint n_frames;
+};
+
+struct _GstNvInfer
+{
+  GstElement parent;
+
+  GstPad *sinkpad;
+  GstPad *srcpad;
+
+  /* properties, protected by the object lock */
+  gchar *backend;
+  gchar *model_location;
+  guint batch_size;
+  guint workers;
+  guint inflight;
+  gboolean bgr;
+  gfloat offsets[3];
+  gfloat scales[3];
+  GstNvSimdLevel simd;
+
+  /* streaming thread only */
+  GstVideoInfo info;
+  gboolean batched;
+  /* frames per buffer, and frames that complete a request */
+  guint buffer_frames;
+  guint request_frames;
+  nvgst::TensorPreprocessor *preprocess;
+  nvgst::InferenceEngine::Request *current;
+
+  /* shared with the src task; a request's items belong to whichever side
+   * holds the request */
+  nvgst::InferenceEngine *engine;
+  std::vector < std::vector < GstNvInferItem > >*items;
+
+  /* protected by the object lock */
+  GstFlowReturn src_result;
+};
+
+struct _GstNvInferClass
+{
+  GstElementClass parent_class;
+};
+
+GType gst_nv_infer_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvinfer);
+
+G_END_DECLS
+
+#endif /* __GST_NV_INFER_H__ */
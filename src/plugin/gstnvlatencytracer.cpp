@@ -0,0 +1,223 @@
+/**
+ * SECTION:tracer-nvlatency
+ *
+ * Measures how long each buffer spends in every element. On each pad push
+ * the streaming thread appends one small record (timestamp, pushing
+ * element, receiving element, PTS) to its own lock-free ring; nothing is
+ * locked, formatted or logged on the streaming thread. A background thread
+ * drains the rings, matches the buffer entering and leaving each element by
+ * PTS and writes one line (or shared-memory record) per match:
+ *
+ * - `proc`: the buffer left on the thread it entered on (processing time)
+ * - `dwell`: it left on another thread (time spent in a queue)
+ *
+ * Elements that change timestamps (batching, rate changes) and sinks
+ * produce no records. Ghost pads are transparent.
+ *
+ * Parameters, passed as `GST_TRACERS="nvlatency(key=value,...)"`:
+ *
+ * - `output`: `file` (default) or `shm`
+ * - `location`: file path (default `nvlatency.log`) or shared memory
+ *   object name (default `/nvlatency`)
+ * - `ring-size`: events buffered per streaming thread (default 16384);
+ *   events that do not fit are counted as dropped
+ * - `flush-interval`: milliseconds between drains (default 100)
+ * - `shm-records`: records kept in the shared memory ring (default 65536)
+ *
+ * The shared memory layout is #nvgst::ShmTraceHeader followed by
+ * #nvgst::LatencyRecord entries, see core/latency_trace.h.
+ *
+ * ## Example
+ * |[
+ * GST_TRACERS="nvlatency(location=/tmp/latency.log)" \
+ *     gst-launch-1.0 videotestsrc num-buffers=300 ! nvconvert ! queue ! fakesink
+ * ]|
+ */
+
+#include "gstnvlatencytracer.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_latency_tracer_debug);
+#define GST_CAT_DEFAULT gst_nv_latency_tracer_debug
+
+#define DEFAULT_LOCATION_FILE "nvlatency.log"
+#define DEFAULT_LOCATION_SHM "/nvlatency"
+#define DEFAULT_SHM_RECORDS 65536
+
+#define gst_nv_latency_tracer_parent_class parent_class
+G_DEFINE_TYPE (GstNvLatencyTracer, gst_nv_latency_tracer, GST_TYPE_TRACER);
+GST_TRACER_REGISTER_DEFINE (nvlatency, "nvlatency",
+    GST_TYPE_NV_LATENCY_TRACER);
+
+/* Element owning a pad; NULL for ghost and proxy pads so that bins do not
+ * show up as elements of their own. */
+static inline const void *
+pad_element (GstPad * pad)
+{
+  if (pad == NULL || GST_IS_PROXY_PAD (pad))
+    return NULL;
+  return GST_OBJECT_PARENT (pad);
+}
+
+static inline void
+record_push (GstNvLatencyTracer * self, GstClockTime ts, GstPad * pad,
+    GstClockTime pts)
+{
+  nvgst::TraceEvent ev;
+
+  ev.ts_ns = ts;
+  ev.from = pad_element (pad);
+  ev.to = pad_element (GST_PAD_PEER (pad));
+  ev.pts = pts;
+
+  if (ev.from || ev.to)
+    self->collector->record (ev);
+}
+
+static void
+do_push_buffer_pre (GstNvLatencyTracer * self, GstClockTime ts, GstPad * pad,
+    GstBuffer * buffer)
+{
+  record_push (self, ts, pad, GST_BUFFER_PTS (buffer));
+}
+
+static void
+do_push_buffer_list_pre (GstNvLatencyTracer * self, GstClockTime ts,
+    GstPad * pad, GstBufferList * list)
+{
+  if (gst_buffer_list_length (list) > 0)
+    record_push (self, ts, pad, GST_BUFFER_PTS (gst_buffer_list_get (list, 0)));
+}
+
+static void
+do_element_new (GstNvLatencyTracer * self, GstClockTime ts,
+    GstElement * element)
+{
+  self->collector->set_element_name (element, GST_OBJECT_NAME (element));
+}
+
+/* Picks up names set after creation. */
+static void
+do_element_change_state_pre (GstNvLatencyTracer * self, GstClockTime ts,
+    GstElement * element, GstStateChange transition)
+{
+  if (transition == GST_STATE_CHANGE_READY_TO_PAUSED)
+    self->collector->set_element_name (element, GST_OBJECT_NAME (element));
+}
+
+static GstStructure *
+gst_nv_latency_tracer_parse_params (GstNvLatencyTracer * self)
+{
+  GstStructure *params = NULL;
+  gchar *str = NULL;
+
+  g_object_get (self, "params", &str, NULL);
+  if (str) {
+    gchar *tmp = g_strdup_printf ("nvlatency,%s", str);
+
+    params = gst_structure_from_string (tmp, NULL);
+    if (params == NULL)
+      GST_WARNING_OBJECT (self, "cannot parse params '%s'", str);
+    g_free (tmp);
+    g_free (str);
+  }
+
+  if (params == NULL)
+    params = gst_structure_new_empty ("nvlatency");
+
+  return params;
+}
+
+static void
+gst_nv_latency_tracer_constructed (GObject * object)
+{
+  GstNvLatencyTracer *self = GST_NV_LATENCY_TRACER (object);
+  GstTracer *tracer = GST_TRACER (object);
+  nvgst::TraceCollector::Config config;
+  std::unique_ptr<nvgst::TraceSink> sink;
+  GstStructure *params;
+  const gchar *output, *location;
+  guint value;
+
+  G_OBJECT_CLASS (parent_class)->constructed (object);
+
+  params = gst_nv_latency_tracer_parse_params (self);
+  output = gst_structure_get_string (params, "output");
+  location = gst_structure_get_string (params, "location");
+  if (gst_structure_get_uint (params, "ring-size", &value) && value > 0)
+    config.ring_capacity = value;
+  if (gst_structure_get_uint (params, "flush-interval", &value) && value > 0)
+    config.flush_interval_ms = value;
+
+  if (g_strcmp0 (output, "shm") == 0) {
+    guint records = DEFAULT_SHM_RECORDS;
+
+    gst_structure_get_uint (params, "shm-records", &records);
+    if (location == NULL)
+      location = DEFAULT_LOCATION_SHM;
+    sink = nvgst::open_shm_trace_sink (location, records);
+  } else {
+    if (output != NULL && g_strcmp0 (output, "file") != 0)
+      GST_WARNING_OBJECT (self, "unknown output '%s', using file", output);
+    if (location == NULL)
+      location = DEFAULT_LOCATION_FILE;
+    sink = nvgst::open_file_trace_sink (location);
+  }
+
+  if (!sink) {
+    GST_ERROR_OBJECT (self, "cannot open %s, tracer disabled", location);
+    gst_structure_free (params);
+    return;
+  }
+
+  GST_INFO_OBJECT (self, "writing to %s, %" G_GSIZE_FORMAT
+      " events per thread, flushing every %d ms", location,
+      config.ring_capacity, config.flush_interval_ms);
+  gst_structure_free (params);
+
+  self->collector = new nvgst::TraceCollector (std::move (sink), config);
+
+  gst_tracing_register_hook (tracer, "pad-push-pre",
+      G_CALLBACK (do_push_buffer_pre));
+  gst_tracing_register_hook (tracer, "pad-push-list-pre",
+      G_CALLBACK (do_push_buffer_list_pre));
+  gst_tracing_register_hook (tracer, "element-new",
+      G_CALLBACK (do_element_new));
+  gst_tracing_register_hook (tracer, "element-change-state-pre",
+      G_CALLBACK (do_element_change_state_pre));
+}
+
+static void
+gst_nv_latency_tracer_finalize (GObject * object)
+{
+  GstNvLatencyTracer *self = GST_NV_LATENCY_TRACER (object);
+
+  if (self->collector) {
+    guint64 dropped = self->collector->dropped ();
+
+    if (dropped > 0)
+      GST_WARNING_OBJECT (self, "%" G_GUINT64_FORMAT " events dropped, "
+          "increase ring-size", dropped);
+    /* joins the flush thread after a final drain */
+    delete self->collector;
+    self->collector = NULL;
+  }
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_latency_tracer_class_init (GstNvLatencyTracerClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_latency_tracer_debug, "nvlatency", 0,
+      "nvlatency tracer");
+
+  gobject_class->constructed = gst_nv_latency_tracer_constructed;
+  gobject_class->finalize = gst_nv_latency_tracer_finalize;
+}
+
+static void
+gst_nv_latency_tracer_init (GstNvLatencyTracer * self)
+{
+}
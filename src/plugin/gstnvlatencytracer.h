@@ -0,0 +1,41 @@
+#ifndef __GST_NV_LATENCY_TRACER_H__
+#define __GST_NV_LATENCY_TRACER_H__
+
+#include <gst/gst.h>
+
+#include "core/latency_trace.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_NV_LATENCY_TRACER \
+  (gst_nv_latency_tracer_get_type())
+#define GST_NV_LATENCY_TRACER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_LATENCY_TRACER,GstNvLatencyTracer))
+#define GST_NV_LATENCY_TRACER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_LATENCY_TRACER,GstNvLatencyTracerClass))
+#define GST_IS_NV_LATENCY_TRACER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_LATENCY_TRACER))
+
+typedef struct _GstNvLatencyTracer GstNvLatencyTracer;
+typedef struct _GstNvLatencyTracerClass GstNvLatencyTracerClass;
+
+struct _GstNvLatencyTracer
+{
+  GstTracer parent;
+
+  /* set in constructed(), NULL when the output could not be opened */
+  nvgst::TraceCollector *collector;
+};
+
+struct _GstNvLatencyTracerClass
+{
+  GstTracerClass parent_class;
+};
+
+GType gst_nv_latency_tracer_get_type (void);
+
+GST_TRACER_REGISTER_DECLARE (nvlatency);
+
+G_END_DECLS
+
+#endif /* __GST_NV_LATENCY_TRACER_H__ */
@@ -0,0 +1,562 @@
+/**
+ * SECTION:element-nvmotiongate
+ *
+ * Lets frames through only when the scene changed, so an inference branch
+ * can skip static cameras. Every frame is box-filtered to a small luma
+ * thumbnail and compared with the thumbnail of the last frame the gate
+ * passed by a SIMD sum of absolute differences; the mean difference per
+ * thumbnail pixel is the frame's motion score.
+ *
+ * Frames scoring above the threshold of their source pass, and so does
+ * one static frame after refresh-interval static frames in a row, so
+ * downstream results never get too old. Every buffer gets a
+ * #GstNvMotionMeta with the verdict of each of its frames. With mode=tag
+ * nothing else changes; with mode=drop single frames that did not pass
+ * are dropped, and batches when none of their frames passed.
+ *
+ * On nvbatchmux batches each source is gated on its own, with the
+ * threshold from source-thresholds when it names the source.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 filesrc location=corridor.mp4 ! decodebin ! nvconvert ! \
+ *     video/x-raw,format=NV12 ! tee name=t \
+ *     t. ! queue ! nvmotiongate mode=drop threshold=1.5 ! nvinfer ! \
+ *     fakesink \
+ *     t. ! queue ! autovideosink
+ * ]|
+ */
+
+#include "gstnvmotiongate.h"
+#include "gstnvbatchmeta.h"
+#include "gstnvmotionmeta.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_motion_gate_debug);
+#define GST_CAT_DEFAULT gst_nv_motion_gate_debug
+
+#define DEFAULT_MODE GST_NV_MOTION_GATE_MODE_TAG
+#define DEFAULT_THRESHOLD 1.0f
+#define DEFAULT_REFRESH_INTERVAL 30
+#define DEFAULT_THUMB_WIDTH 64
+#define DEFAULT_THUMB_HEIGHT 36
+#define DEFAULT_SIMD GST_NV_SIMD_LEVEL_AUTO
+
+enum
+{
+  PROP_0,
+  PROP_MODE,
+  PROP_THRESHOLD,
+  PROP_SOURCE_THRESHOLDS,
+  PROP_REFRESH_INTERVAL,
+  PROP_THUMB_WIDTH,
+  PROP_THUMB_HEIGHT,
+  PROP_SIMD,
+};
+
+#define NV_MOTION_GATE_FORMATS "{ NV12, I420, RGBA, BGRx }"
+
+#define NV_MOTION_GATE_CAPS \
+  GST_VIDEO_CAPS_MAKE (NV_MOTION_GATE_FORMATS) "; " \
+  GST_NV_BATCH_CAPS_MAKE (NV_MOTION_GATE_FORMATS)
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_MOTION_GATE_CAPS));
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_MOTION_GATE_CAPS));
+
+GType
+gst_nv_motion_gate_mode_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_NV_MOTION_GATE_MODE_TAG,
+        "Pass everything, only attach GstNvMotionMeta", "tag"},
+    {GST_NV_MOTION_GATE_MODE_DROP,
+        "Drop buffers without a frame that passed", "drop"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = g_enum_register_static ("GstNvMotionGateMode", values);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+#define gst_nv_motion_gate_parent_class parent_class
+G_DEFINE_TYPE (GstNvMotionGate, gst_nv_motion_gate, GST_TYPE_BASE_TRANSFORM);
+GST_ELEMENT_REGISTER_DEFINE (nvmotiongate, "nvmotiongate", GST_RANK_NONE,
+    GST_TYPE_NV_MOTION_GATE);
+
+static void gst_nv_motion_gate_finalize (GObject * object);
+static void gst_nv_motion_gate_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_motion_gate_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static gboolean gst_nv_motion_gate_stop (GstBaseTransform * trans);
+static gboolean gst_nv_motion_gate_set_caps (GstBaseTransform * trans,
+    GstCaps * incaps, GstCaps * outcaps);
+static gboolean gst_nv_motion_gate_sink_event (GstBaseTransform * trans,
+    GstEvent * event);
+static GstFlowReturn gst_nv_motion_gate_transform_ip (GstBaseTransform *
+    trans, GstBuffer * buffer);
+
+static void
+gst_nv_motion_gate_class_init (GstNvMotionGateClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_motion_gate_debug, "nvmotiongate", 0,
+      "nvmotiongate element");
+
+  gobject_class->finalize = gst_nv_motion_gate_finalize;
+  gobject_class->set_property = gst_nv_motion_gate_set_property;
+  gobject_class->get_property = gst_nv_motion_gate_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_MODE,
+      g_param_spec_enum ("mode", "Mode",
+          "What happens to buffers without motion",
+          GST_TYPE_NV_MOTION_GATE_MODE, DEFAULT_MODE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_THRESHOLD,
+      g_param_spec_float ("threshold", "Threshold",
+          "Mean absolute luma difference per thumbnail pixel (0-255) above "
+          "which a frame counts as moving",
+          0.0f, 255.0f, DEFAULT_THRESHOLD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SOURCE_THRESHOLDS,
+      g_param_spec_string ("source-thresholds", "Source thresholds",
+          "Per-source thresholds overriding threshold, as "
+          "\"source:threshold,...\" with batch source ids",
+          NULL, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_REFRESH_INTERVAL,
+      g_param_spec_uint ("refresh-interval", "Refresh interval",
+          "Static frames in a row after which one is passed anyway "
+          "(0 = never)",
+          0, G_MAXINT, DEFAULT_REFRESH_INTERVAL,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_THUMB_WIDTH,
+      g_param_spec_uint ("thumb-width", "Thumbnail width",
+          "Width frames are box-filtered down to before comparing",
+          1, 1024, DEFAULT_THUMB_WIDTH,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_THUMB_HEIGHT,
+      g_param_spec_uint ("thumb-height", "Thumbnail height",
+          "Height frames are box-filtered down to before comparing",
+          1, 1024, DEFAULT_THUMB_HEIGHT,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SIMD,
+      g_param_spec_enum ("simd", "SIMD",
+          "Highest SIMD level to use, capped at what the CPU supports",
+          GST_TYPE_NV_SIMD_LEVEL, DEFAULT_SIMD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV motion gate", "Filter/Analyzer/Video",
+      "Tags or drops frames without motion, from the SIMD SAD of box-filtered "
+      "thumbnails against the last passed frame, per source",
+      "nv_gst_plugins developers");
+
+  trans_class->stop = GST_DEBUG_FUNCPTR (gst_nv_motion_gate_stop);
+  trans_class->set_caps = GST_DEBUG_FUNCPTR (gst_nv_motion_gate_set_caps);
+  trans_class->sink_event = GST_DEBUG_FUNCPTR (gst_nv_motion_gate_sink_event);
+  trans_class->transform_ip =
+      GST_DEBUG_FUNCPTR (gst_nv_motion_gate_transform_ip);
+  trans_class->passthrough_on_same_caps = FALSE;
+
+  gst_type_mark_as_plugin_api (GST_TYPE_NV_MOTION_GATE_MODE,
+      (GstPluginAPIFlags) 0);
+}
+
+static void
+gst_nv_motion_gate_init (GstNvMotionGate * self)
+{
+  self->mode = DEFAULT_MODE;
+  self->threshold = DEFAULT_THRESHOLD;
+  self->source_thresholds = NULL;
+  self->refresh_interval = DEFAULT_REFRESH_INTERVAL;
+  self->thumb_width = DEFAULT_THUMB_WIDTH;
+  self->thumb_height = DEFAULT_THUMB_HEIGHT;
+  self->simd = DEFAULT_SIMD;
+  self->reconfigure = TRUE;
+
+  gst_video_info_init (&self->info);
+  self->batched = FALSE;
+  self->config = new nvgst::MotionConfig ();
+  self->thresholds = new std::unordered_map < guint, gfloat > ();
+  self->gates = new std::unordered_map < guint, nvgst::MotionGate > ();
+
+  gst_base_transform_set_in_place (GST_BASE_TRANSFORM (self), TRUE);
+}
+
+static void
+gst_nv_motion_gate_finalize (GObject * object)
+{
+  GstNvMotionGate *self = GST_NV_MOTION_GATE (object);
+
+  delete self->gates;
+  delete self->thresholds;
+  delete self->config;
+  g_free (self->source_thresholds);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_motion_gate_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvMotionGate *self = GST_NV_MOTION_GATE (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_MODE:
+      self->mode = (GstNvMotionGateMode) g_value_get_enum (value);
+      break;
+    case PROP_THRESHOLD:
+      self->threshold = g_value_get_float (value);
+      break;
+    case PROP_SOURCE_THRESHOLDS:
+      g_free (self->source_thresholds);
+      self->source_thresholds = g_value_dup_string (value);
+      break;
+    case PROP_REFRESH_INTERVAL:
+      self->refresh_interval = g_value_get_uint (value);
+      break;
+    case PROP_THUMB_WIDTH:
+      self->thumb_width = g_value_get_uint (value);
+      break;
+    case PROP_THUMB_HEIGHT:
+      self->thumb_height = g_value_get_uint (value);
+      break;
+    case PROP_SIMD:
+      self->simd = (GstNvSimdLevel) g_value_get_enum (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      GST_OBJECT_UNLOCK (self);
+      return;
+  }
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_motion_gate_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstNvMotionGate *self = GST_NV_MOTION_GATE (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_MODE:
+      g_value_set_enum (value, self->mode);
+      break;
+    case PROP_THRESHOLD:
+      g_value_set_float (value, self->threshold);
+      break;
+    case PROP_SOURCE_THRESHOLDS:
+      g_value_set_string (value, self->source_thresholds);
+      break;
+    case PROP_REFRESH_INTERVAL:
+      g_value_set_uint (value, self->refresh_interval);
+      break;
+    case PROP_THUMB_WIDTH:
+      g_value_set_uint (value, self->thumb_width);
+      break;
+    case PROP_THUMB_HEIGHT:
+      g_value_set_uint (value, self->thumb_height);
+      break;
+    case PROP_SIMD:
+      g_value_set_enum (value, self->simd);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static gboolean
+gst_nv_motion_gate_stop (GstBaseTransform * trans)
+{
+  GstNvMotionGate *self = GST_NV_MOTION_GATE (trans);
+
+  self->gates->clear ();
+
+  return TRUE;
+}
+
+static gboolean
+gst_nv_motion_gate_set_caps (GstBaseTransform * trans, GstCaps * incaps,
+    GstCaps * outcaps)
+{
+  GstNvMotionGate *self = GST_NV_MOTION_GATE (trans);
+  GstCapsFeatures *features = gst_caps_get_features (incaps, 0);
+
+  if (!gst_video_info_from_caps (&self->info, incaps)) {
+    GST_ERROR_OBJECT (self, "invalid caps %" GST_PTR_FORMAT, incaps);
+    return FALSE;
+  }
+  self->batched = features != NULL &&
+      gst_caps_features_contains (features, GST_CAPS_FEATURE_META_GST_NV_BATCH);
+
+  GST_OBJECT_LOCK (self);
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  return TRUE;
+}
+
+/* After a flush the scene may have jumped; every source passes its next
+ * frame and starts over from it. */
+static gboolean
+gst_nv_motion_gate_sink_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstNvMotionGate *self = GST_NV_MOTION_GATE (trans);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+    for (auto & entry : *self->gates)
+      entry.second.reset ();
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->sink_event (trans, event);
+}
+
+/* "source:threshold,..." into thresholds; FALSE on anything else. */
+static gboolean
+gst_nv_motion_gate_parse_thresholds (const gchar * str,
+    std::unordered_map < guint, gfloat > *thresholds)
+{
+  gchar **entries;
+  gboolean ok = TRUE;
+
+  thresholds->clear ();
+  if (str == NULL || *str == '\0')
+    return TRUE;
+
+  entries = g_strsplit (str, ",", -1);
+  for (gint i = 0; ok && entries[i] != NULL; i++) {
+    gchar *entry = g_strstrip (entries[i]);
+    gchar *end;
+    guint64 source;
+    gdouble threshold;
+
+    source = g_ascii_strtoull (entry, &end, 10);
+    ok = end != entry && *end == ':' && source <= G_MAXUINT;
+    if (!ok)
+      break;
+    entry = end + 1;
+    threshold = g_ascii_strtod (entry, &end);
+    ok = end != entry && *end == '\0' && threshold >= 0.0;
+    if (ok)
+      (*thresholds)[(guint) source] = (gfloat) threshold;
+  }
+  g_strfreev (entries);
+
+  return ok;
+}
+
+static gboolean
+gst_nv_motion_gate_configure_gate (GstNvMotionGate * self,
+    nvgst::MotionGate & gate, guint source_id)
+{
+  nvgst::MotionConfig config = *self->config;
+  auto it = self->thresholds->find (source_id);
+
+  if (it != self->thresholds->end ())
+    config.threshold = it->second;
+
+  return gate.configure (config);
+}
+
+/* Takes property and caps changes into every gate; reference frames are
+ * kept unless the thumbnail layout changed. */
+static gboolean
+gst_nv_motion_gate_apply_config (GstNvMotionGate * self)
+{
+  nvgst::MotionConfig *config = self->config;
+  GstNvSimdLevel simd;
+  gboolean parsed;
+
+  GST_OBJECT_LOCK (self);
+  if (!self->reconfigure) {
+    GST_OBJECT_UNLOCK (self);
+    return TRUE;
+  }
+  config->threshold = self->threshold;
+  config->refresh_interval = (int) self->refresh_interval;
+  config->thumb_width = (int) self->thumb_width;
+  config->thumb_height = (int) self->thumb_height;
+  parsed = gst_nv_motion_gate_parse_thresholds (self->source_thresholds,
+      self->thresholds);
+  simd = self->simd;
+  self->reconfigure = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  if (!parsed) {
+    GST_ERROR_OBJECT (self, "source-thresholds must look like "
+        "\"0:1.5,3:4\"");
+    return FALSE;
+  }
+
+  config->format =
+      gst_nv_pixel_format_from_video_format (GST_VIDEO_INFO_FORMAT
+      (&self->info));
+  config->width = GST_VIDEO_INFO_WIDTH (&self->info);
+  config->height = GST_VIDEO_INFO_HEIGHT (&self->info);
+  config->simd = gst_nv_simd_level_resolve (simd);
+
+  for (auto & entry : *self->gates) {
+    if (!gst_nv_motion_gate_configure_gate (self, entry.second, entry.first))
+      return FALSE;
+  }
+
+  GST_INFO_OBJECT (self, "gating %dx%d frames on %dx%d thumbnails, "
+      "threshold %.2f (%" G_GSIZE_FORMAT " source overrides), refresh every "
+      "%d frames, using %s kernels", config->width, config->height,
+      config->thumb_width, config->thumb_height, config->threshold,
+      self->thresholds->size (), config->refresh_interval,
+      nvgst::simd_level_name (config->simd));
+
+  return TRUE;
+}
+
+static nvgst::MotionGate *
+gst_nv_motion_gate_get_gate (GstNvMotionGate * self, guint source_id)
+{
+  auto it = self->gates->find (source_id);
+
+  if (it == self->gates->end ()) {
+    GST_DEBUG_OBJECT (self, "new gate for source %u", source_id);
+    it = self->gates->emplace (source_id, nvgst::MotionGate ()).first;
+    if (!gst_nv_motion_gate_configure_gate (self, it->second, source_id)) {
+      self->gates->erase (it);
+      return NULL;
+    }
+  }
+
+  return &it->second;
+}
+
+static void
+gst_nv_motion_gate_store (GstNvMotionFrame * frame,
+    const nvgst::MotionResult & result)
+{
+  frame->score = result.score;
+  frame->moving = result.moving;
+  frame->refresh = result.refresh;
+}
+
+static GstFlowReturn
+gst_nv_motion_gate_update_batch (GstNvMotionGate * self, GstBuffer * buffer,
+    GstNvMotionMeta * mmeta, gboolean * passed)
+{
+  GstNvBatchMeta *bmeta = gst_buffer_get_nv_batch_meta (buffer);
+  GstMapInfo map;
+
+  if (bmeta == NULL) {
+    GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
+        ("batched buffer without GstNvBatchMeta"));
+    return GST_FLOW_ERROR;
+  }
+
+  for (guint i = 0; i < bmeta->n_frames; i++) {
+    nvgst::MotionGate *gate =
+        gst_nv_motion_gate_get_gate (self, bmeta->frames[i].source_id);
+    nvgst::MotionResult result;
+
+    if (gate == NULL) {
+      GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS, (NULL),
+          ("invalid motion gate configuration"));
+      return GST_FLOW_ERROR;
+    }
+    if (!gst_nv_batch_meta_map_frame (bmeta, buffer, i, &map, GST_MAP_READ)) {
+      GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL),
+          ("failed to map frame %u of the batch", i));
+      return GST_FLOW_ERROR;
+    }
+    result = gate->update (gst_nv_batch_frame_view (&bmeta->frames[i],
+            &self->info, &map));
+    gst_nv_batch_meta_unmap_frame (bmeta, buffer, i, &map);
+
+    gst_nv_motion_gate_store (&mmeta->frames[i], result);
+    *passed |= result.passed ();
+  }
+  mmeta->n_frames = bmeta->n_frames;
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_nv_motion_gate_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
+{
+  GstNvMotionGate *self = GST_NV_MOTION_GATE (trans);
+  GstNvMotionMeta *mmeta;
+  GstNvMotionGateMode mode;
+  gboolean passed = FALSE;
+
+  if (!gst_nv_motion_gate_apply_config (self)) {
+    GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS, (NULL),
+        ("invalid motion gate configuration"));
+    return GST_FLOW_ERROR;
+  }
+
+  GST_OBJECT_LOCK (self);
+  mode = self->mode;
+  GST_OBJECT_UNLOCK (self);
+
+  mmeta = gst_buffer_add_nv_motion_meta (buffer);
+
+  if (self->batched) {
+    GstFlowReturn ret =
+        gst_nv_motion_gate_update_batch (self, buffer, mmeta, &passed);
+
+    if (ret != GST_FLOW_OK)
+      return ret;
+  } else {
+    nvgst::MotionGate *gate = gst_nv_motion_gate_get_gate (self, 0);
+    nvgst::MotionResult result;
+    GstVideoFrame frame;
+
+    if (gate == NULL) {
+      GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS, (NULL),
+          ("invalid motion gate configuration"));
+      return GST_FLOW_ERROR;
+    }
+    if (!gst_video_frame_map (&frame, &self->info, buffer, GST_MAP_READ)) {
+      GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL),
+          ("failed to map frame"));
+      return GST_FLOW_ERROR;
+    }
+    result = gate->update (gst_nv_frame_view_from_video_frame (&frame));
+    gst_video_frame_unmap (&frame);
+
+    mmeta->n_frames = 1;
+    gst_nv_motion_gate_store (&mmeta->frames[0], result);
+    passed = result.passed ();
+  }
+
+  GST_LOG_OBJECT (self, "%u frames, %s", mmeta->n_frames,
+      passed ? "passed" : "static");
+
+  if (mode == GST_NV_MOTION_GATE_MODE_DROP && !passed)
+    return GST_BASE_TRANSFORM_FLOW_DROPPED;
+
+  return GST_FLOW_OK;
+}
@@ -0,0 +1,70 @@
+#ifndef __GST_NV_MOTION_GATE_H__
+#define __GST_NV_MOTION_GATE_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include <gst/video/video.h>
+
+#include <unordered_map>
+
+#include "gstnvutils.h"
+#include "core/motion.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+  GST_NV_MOTION_GATE_MODE_TAG,
+  GST_NV_MOTION_GATE_MODE_DROP,
+} GstNvMotionGateMode;
+
+#define GST_TYPE_NV_MOTION_GATE_MODE (gst_nv_motion_gate_mode_get_type ())
+GType gst_nv_motion_gate_mode_get_type (void);
+
+#define GST_TYPE_NV_MOTION_GATE \
+  (gst_nv_motion_gate_get_type())
+#define GST_NV_MOTION_GATE(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_MOTION_GATE,GstNvMotionGate))
+#define GST_NV_MOTION_GATE_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_MOTION_GATE,GstNvMotionGateClass))
+#define GST_IS_NV_MOTION_GATE(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_MOTION_GATE))
+
+typedef struct _GstNvMotionGate GstNvMotionGate;
+typedef struct _GstNvMotionGateClass GstNvMotionGateClass;
+
+struct _GstNvMotionGate
+{
+  GstBaseTransform parent;
+
+  /* properties, protected by the object lock */
+  GstNvMotionGateMode mode;
+  gfloat threshold;
+  gchar *source_thresholds;
+  guint refresh_interval;
+  guint thumb_width;
+  guint thumb_height;
+  GstNvSimdLevel simd;
+  gboolean reconfigure;
+
+  /* streaming thread only */
+  GstVideoInfo info;
+  gboolean batched;
+  nvgst::MotionConfig *config;
+  /* thresholds that differ from the default, by source id */
+  std::unordered_map<guint, gfloat> *thresholds;
+  /* one gate per source id; single frames use source 0 */
+  std::unordered_map<guint, nvgst::MotionGate> *gates;
+};
+
+struct _GstNvMotionGateClass
+{
+  GstBaseTransformClass parent_class;
+};
+
+GType gst_nv_motion_gate_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvmotiongate);
+
+G_END_DECLS
+
+#endif /* __GST_NV_MOTION_GATE_H__ */
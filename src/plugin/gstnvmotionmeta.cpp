@@ -0,0 +1,74 @@
+#include "gstnvmotionmeta.h"
+
+GType
+gst_nv_motion_meta_api_get_type (void)
+{
+  static GType type = 0;
+  static const gchar *tags[] = { GST_META_TAG_VIDEO_STR, NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = gst_meta_api_type_register ("GstNvMotionMetaAPI", tags);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+static gboolean
+gst_nv_motion_meta_init (GstMeta * meta, gpointer params, GstBuffer * buffer)
+{
+  GstNvMotionMeta *mmeta = (GstNvMotionMeta *) meta;
+
+  mmeta->n_frames = 0;
+
+  return TRUE;
+}
+
+/* Verdicts hold for the frames whatever their size; region copies would
+ * cut frames out of a batch, so they drop the meta. */
+static gboolean
+gst_nv_motion_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstNvMotionMeta *src = (GstNvMotionMeta *) meta;
+  GstNvMotionMeta *mmeta;
+
+  if (GST_META_TRANSFORM_IS_COPY (type)) {
+    GstMetaTransformCopy *copy = (GstMetaTransformCopy *) data;
+
+    if (copy->region)
+      return FALSE;
+  } else if (!GST_VIDEO_META_TRANSFORM_IS_SCALE (type)) {
+    return FALSE;
+  }
+
+  mmeta = gst_buffer_add_nv_motion_meta (dest);
+  if (mmeta == NULL)
+    return FALSE;
+
+  mmeta->n_frames = src->n_frames;
+  for (guint i = 0; i < src->n_frames; i++)
+    mmeta->frames[i] = src->frames[i];
+
+  return TRUE;
+}
+
+const GstMetaInfo *
+gst_nv_motion_meta_get_info (void)
+{
+  static const GstMetaInfo *info = NULL;
+
+  if (g_once_init_enter (&info)) {
+    const GstMetaInfo *tmp = gst_meta_register (GST_NV_MOTION_META_API_TYPE,
+        "GstNvMotionMeta", sizeof (GstNvMotionMeta),
+        gst_nv_motion_meta_init, NULL, gst_nv_motion_meta_transform);
+    g_once_init_leave (&info, tmp);
+  }
+  return info;
+}
+
+GstNvMotionMeta *
+gst_buffer_add_nv_motion_meta (GstBuffer * buffer)
+{
+  return (GstNvMotionMeta *) gst_buffer_add_meta (buffer,
+      GST_NV_MOTION_META_INFO, NULL);
+}
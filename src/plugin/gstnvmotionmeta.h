@@ -0,0 +1,58 @@
+/* Per-frame motion verdicts of nvmotiongate. */
+#ifndef __GST_NV_MOTION_META_H__
+#define __GST_NV_MOTION_META_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "gstnvbatchmeta.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GstNvMotionFrame GstNvMotionFrame;
+typedef struct _GstNvMotionMeta GstNvMotionMeta;
+
+/**
+ * GstNvMotionFrame:
+ * @score: mean absolute luma difference (0-255) between the frame's
+ *     thumbnail and that of the last frame the gate passed
+ * @moving: @score is above the source's threshold
+ * @refresh: static, but passed because the refresh interval ran out
+ */
+struct _GstNvMotionFrame
+{
+  gfloat score;
+  gboolean moving;
+  gboolean refresh;
+};
+
+/**
+ * GstNvMotionMeta:
+ * @meta: parent #GstMeta
+ * @n_frames: number of valid entries in @frames, 1 on single frames
+ * @frames: per-frame verdicts, in batch order
+ *
+ * A frame should be processed when @moving or @refresh is set.
+ */
+struct _GstNvMotionMeta
+{
+  GstMeta meta;
+
+  guint n_frames;
+  GstNvMotionFrame frames[GST_NV_BATCH_MAX_FRAMES];
+};
+
+GType gst_nv_motion_meta_api_get_type (void);
+#define GST_NV_MOTION_META_API_TYPE (gst_nv_motion_meta_api_get_type ())
+
+const GstMetaInfo *gst_nv_motion_meta_get_info (void);
+#define GST_NV_MOTION_META_INFO (gst_nv_motion_meta_get_info ())
+
+#define gst_buffer_get_nv_motion_meta(b) \
+  ((GstNvMotionMeta *) gst_buffer_get_meta ((b), GST_NV_MOTION_META_API_TYPE))
+
+GstNvMotionMeta *gst_buffer_add_nv_motion_meta (GstBuffer * buffer);
+
+G_END_DECLS
+
+#endif /* __GST_NV_MOTION_META_H__ */
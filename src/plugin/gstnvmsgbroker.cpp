@@ -0,0 +1,558 @@
+/**
+ * SECTION:element-nvmsgbroker
+ *
+ * Sends the objects of #GstNvObjectMeta off the pipeline: one message per
+ * frame (per batch frame on batches) with its source, frame number, PTS
+ * and every object's class, track id, confidence, box and classifier
+ * labels, as newline-delimited JSON or a compact binary layout (see
+ * core/msg_broker.h).
+ *
+ * Messages are serialized into reusable batch buffers on the streaming
+ * thread without per-message allocation. A batch is handed to a sender
+ * thread once it holds #GstNvMsgBroker:batch-size frames; the sender
+ * thread also takes it once its first frame is
+ * #GstNvMsgBroker:batch-interval old, whether or not more buffers arrive.
+ * The sender writes batches to #GstNvMsgBroker:location, a file://,
+ * unix:// or tcp://host:port URI, and reconnects on its own after
+ * failures. At most
+ * #GstNvMsgBroker:max-pending batches wait for the transport;
+ * #GstNvMsgBroker:backpressure decides what happens beyond that.
+ *
+ * location, max-pending and backpressure take effect when the element
+ * starts.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 nvbatchmux name=mux ! nvinfer ! nvpostprocess ! nvtracker ! \
+ *     nvmsgbroker location=tcp://127.0.0.1:5000 batch-size=64 \
+ *     uridecodebin uri=file:///cam0.mp4 ! mux.sink_0 \
+ *     uridecodebin uri=file:///cam1.mp4 ! mux.sink_1
+ * ]|
+ */
+
+#include "gstnvmsgbroker.h"
+
+#include "gstnvbatchmeta.h"
+#include "gstnvobjectmeta.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_msg_broker_debug);
+#define GST_CAT_DEFAULT gst_nv_msg_broker_debug
+
+#define DEFAULT_LOCATION "unix:///tmp/nvmsgbroker.sock"
+#define DEFAULT_FORMAT GST_NV_MSG_FORMAT_JSON
+#define DEFAULT_BATCH_SIZE 32
+#define DEFAULT_BATCH_INTERVAL (100 * GST_MSECOND)
+#define DEFAULT_MAX_PENDING 16
+#define DEFAULT_BACKPRESSURE GST_NV_MSG_BACKPRESSURE_DROP_OLDEST
+#define DEFAULT_SKIP_EMPTY TRUE
+#define DEFAULT_SOURCE_ID 0
+
+enum
+{
+  PROP_0,
+  PROP_LOCATION,
+  PROP_FORMAT,
+  PROP_BATCH_SIZE,
+  PROP_BATCH_INTERVAL,
+  PROP_MAX_PENDING,
+  PROP_BACKPRESSURE,
+  PROP_SKIP_EMPTY,
+  PROP_SOURCE_ID,
+  PROP_SENT,
+  PROP_DROPPED,
+  PROP_CONNECTED,
+};
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+GType
+gst_nv_msg_format_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_NV_MSG_FORMAT_JSON, "Newline-delimited JSON, one object per frame",
+        "json"},
+    {GST_NV_MSG_FORMAT_BINARY, "Packed little-endian records", "binary"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = g_enum_register_static ("GstNvMsgFormat", values);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+GType
+gst_nv_msg_backpressure_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_NV_MSG_BACKPRESSURE_BLOCK, "Wait for the sender", "block"},
+    {GST_NV_MSG_BACKPRESSURE_DROP_OLDEST,
+        "Drop the oldest batch not being sent", "drop-oldest"},
+    {GST_NV_MSG_BACKPRESSURE_DROP_NEWEST, "Drop the new batch",
+        "drop-newest"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = g_enum_register_static ("GstNvMsgBackpressure", values);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+static nvgst::SendBackpressure
+gst_nv_msg_backpressure_to_core (GstNvMsgBackpressure mode)
+{
+  switch (mode) {
+    case GST_NV_MSG_BACKPRESSURE_BLOCK:
+      return nvgst::SendBackpressure::kBlock;
+    case GST_NV_MSG_BACKPRESSURE_DROP_NEWEST:
+      return nvgst::SendBackpressure::kDropNewest;
+    case GST_NV_MSG_BACKPRESSURE_DROP_OLDEST:
+      break;
+  }
+  return nvgst::SendBackpressure::kDropOldest;
+}
+
+#define gst_nv_msg_broker_parent_class parent_class
+G_DEFINE_TYPE (GstNvMsgBroker, gst_nv_msg_broker, GST_TYPE_BASE_SINK);
+GST_ELEMENT_REGISTER_DEFINE (nvmsgbroker, "nvmsgbroker", GST_RANK_NONE,
+    GST_TYPE_NV_MSG_BROKER);
+
+static void gst_nv_msg_broker_finalize (GObject * object);
+static void gst_nv_msg_broker_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_msg_broker_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static gboolean gst_nv_msg_broker_start (GstBaseSink * sink);
+static gboolean gst_nv_msg_broker_stop (GstBaseSink * sink);
+static gboolean gst_nv_msg_broker_unlock (GstBaseSink * sink);
+static gboolean gst_nv_msg_broker_unlock_stop (GstBaseSink * sink);
+static gboolean gst_nv_msg_broker_event (GstBaseSink * sink,
+    GstEvent * event);
+static GstFlowReturn gst_nv_msg_broker_render (GstBaseSink * sink,
+    GstBuffer * buffer);
+static void gst_nv_msg_broker_flush_batch (GstNvMsgBroker * self);
+static void gst_nv_msg_broker_check_dropped (GstNvMsgBroker * self);
+
+static void
+gst_nv_msg_broker_class_init (GstNvMsgBrokerClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseSinkClass *base_sink_class = GST_BASE_SINK_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_msg_broker_debug, "nvmsgbroker", 0,
+      "nvmsgbroker element");
+
+  gobject_class->finalize = gst_nv_msg_broker_finalize;
+  gobject_class->set_property = gst_nv_msg_broker_set_property;
+  gobject_class->get_property = gst_nv_msg_broker_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_LOCATION,
+      g_param_spec_string ("location", "Location",
+          "Where messages go: file:///path, unix:///path or tcp://host:port",
+          DEFAULT_LOCATION,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_FORMAT,
+      g_param_spec_enum ("format", "Format", "Message format",
+          GST_TYPE_NV_MSG_FORMAT, DEFAULT_FORMAT,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_BATCH_SIZE,
+      g_param_spec_uint ("batch-size", "Batch size",
+          "Frames per batch handed to the sender", 1, G_MAXUINT16,
+          DEFAULT_BATCH_SIZE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_BATCH_INTERVAL,
+      g_param_spec_uint64 ("batch-interval", "Batch interval",
+          "Age in ns at which a batch is sent even if not full "
+          "(0 = only when full)", 0, G_MAXINT64, DEFAULT_BATCH_INTERVAL,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_PENDING,
+      g_param_spec_uint ("max-pending", "Max pending",
+          "Batches waiting for the transport before backpressure applies",
+          1, 4096, DEFAULT_MAX_PENDING,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_BACKPRESSURE,
+      g_param_spec_enum ("backpressure", "Backpressure",
+          "What to do when max-pending batches wait for the transport",
+          GST_TYPE_NV_MSG_BACKPRESSURE, DEFAULT_BACKPRESSURE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SKIP_EMPTY,
+      g_param_spec_boolean ("skip-empty", "Skip empty",
+          "Send no message for frames without objects", DEFAULT_SKIP_EMPTY,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SOURCE_ID,
+      g_param_spec_uint ("source-id", "Source id",
+          "Source of single-frame buffers (batches carry their own)", 0,
+          G_MAXUINT, DEFAULT_SOURCE_ID,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SENT,
+      g_param_spec_uint64 ("sent", "Sent", "Frames sent", 0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_DROPPED,
+      g_param_spec_uint64 ("dropped", "Dropped",
+          "Frames dropped because of backpressure or an unreachable "
+          "transport at shutdown", 0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CONNECTED,
+      g_param_spec_boolean ("connected", "Connected",
+          "The transport is connected", FALSE,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV metadata broker", "Sink",
+      "Serializes detection and track metadata in batches and sends them "
+      "to a file, unix socket or TCP endpoint", "nv_gst_plugins developers");
+
+  base_sink_class->start = GST_DEBUG_FUNCPTR (gst_nv_msg_broker_start);
+  base_sink_class->stop = GST_DEBUG_FUNCPTR (gst_nv_msg_broker_stop);
+  base_sink_class->unlock = GST_DEBUG_FUNCPTR (gst_nv_msg_broker_unlock);
+  base_sink_class->unlock_stop =
+      GST_DEBUG_FUNCPTR (gst_nv_msg_broker_unlock_stop);
+  base_sink_class->event = GST_DEBUG_FUNCPTR (gst_nv_msg_broker_event);
+  base_sink_class->render = GST_DEBUG_FUNCPTR (gst_nv_msg_broker_render);
+
+  gst_type_mark_as_plugin_api (GST_TYPE_NV_MSG_FORMAT,
+      (GstPluginAPIFlags) 0);
+  gst_type_mark_as_plugin_api (GST_TYPE_NV_MSG_BACKPRESSURE,
+      (GstPluginAPIFlags) 0);
+}
+
+static void
+gst_nv_msg_broker_init (GstNvMsgBroker * self)
+{
+  self->location = g_strdup (DEFAULT_LOCATION);
+  self->format = DEFAULT_FORMAT;
+  self->batch_size = DEFAULT_BATCH_SIZE;
+  self->batch_interval = DEFAULT_BATCH_INTERVAL;
+  self->max_pending = DEFAULT_MAX_PENDING;
+  self->backpressure = DEFAULT_BACKPRESSURE;
+  self->skip_empty = DEFAULT_SKIP_EMPTY;
+  self->source_id = DEFAULT_SOURCE_ID;
+  self->reconfigure = TRUE;
+
+  /* metadata egress has no presentation time to wait for */
+  gst_base_sink_set_sync (GST_BASE_SINK (self), FALSE);
+}
+
+static void
+gst_nv_msg_broker_finalize (GObject * object)
+{
+  GstNvMsgBroker *self = GST_NV_MSG_BROKER (object);
+
+  g_free (self->location);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_msg_broker_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvMsgBroker *self = GST_NV_MSG_BROKER (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_LOCATION:
+      g_free (self->location);
+      self->location = g_value_dup_string (value);
+      break;
+    case PROP_FORMAT:
+      self->format = (GstNvMsgFormat) g_value_get_enum (value);
+      break;
+    case PROP_BATCH_SIZE:
+      self->batch_size = g_value_get_uint (value);
+      break;
+    case PROP_BATCH_INTERVAL:
+      self->batch_interval = g_value_get_uint64 (value);
+      break;
+    case PROP_MAX_PENDING:
+      self->max_pending = g_value_get_uint (value);
+      break;
+    case PROP_BACKPRESSURE:
+      self->backpressure = (GstNvMsgBackpressure) g_value_get_enum (value);
+      break;
+    case PROP_SKIP_EMPTY:
+      self->skip_empty = g_value_get_boolean (value);
+      break;
+    case PROP_SOURCE_ID:
+      self->source_id = g_value_get_uint (value);
+      break;
+    default:
+      GST_OBJECT_UNLOCK (self);
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      return;
+  }
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_msg_broker_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstNvMsgBroker *self = GST_NV_MSG_BROKER (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_LOCATION:
+      g_value_set_string (value, self->location);
+      break;
+    case PROP_FORMAT:
+      g_value_set_enum (value, self->format);
+      break;
+    case PROP_BATCH_SIZE:
+      g_value_set_uint (value, self->batch_size);
+      break;
+    case PROP_BATCH_INTERVAL:
+      g_value_set_uint64 (value, self->batch_interval);
+      break;
+    case PROP_MAX_PENDING:
+      g_value_set_uint (value, self->max_pending);
+      break;
+    case PROP_BACKPRESSURE:
+      g_value_set_enum (value, self->backpressure);
+      break;
+    case PROP_SKIP_EMPTY:
+      g_value_set_boolean (value, self->skip_empty);
+      break;
+    case PROP_SOURCE_ID:
+      g_value_set_uint (value, self->source_id);
+      break;
+    case PROP_SENT:
+      g_value_set_uint64 (value, self->sent +
+          (self->sender ? self->sender->sent () : 0));
+      break;
+    case PROP_DROPPED:
+      g_value_set_uint64 (value, self->dropped +
+          (self->sender ? self->sender->dropped () : 0));
+      break;
+    case PROP_CONNECTED:
+      g_value_set_boolean (value,
+          self->sender ? self->sender->connected () : FALSE);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static gboolean
+gst_nv_msg_broker_start (GstBaseSink * sink)
+{
+  GstNvMsgBroker *self = GST_NV_MSG_BROKER (sink);
+  std::unique_ptr < nvgst::MessageTransport > transport;
+  nvgst::MessageSender *sender;
+  GstNvMsgBackpressure backpressure;
+  guint max_pending;
+  gchar *location;
+
+  GST_OBJECT_LOCK (self);
+  location = g_strdup (self->location);
+  max_pending = self->max_pending;
+  backpressure = self->backpressure;
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  if (location != NULL)
+    transport = nvgst::create_message_transport (location);
+  if (!transport) {
+    GST_ELEMENT_ERROR (self, RESOURCE, SETTINGS,
+        ("Unsupported location %s", GST_STR_NULL (location)),
+        ("expected file:///path, unix:///path or tcp://host:port"));
+    g_free (location);
+    return FALSE;
+  }
+  GST_INFO_OBJECT (self, "sending to %s", location);
+  g_free (location);
+
+  sender = new nvgst::MessageSender ();
+  sender->start (std::move (transport), max_pending,
+      gst_nv_msg_backpressure_to_core (backpressure));
+
+  GST_OBJECT_LOCK (self);
+  self->sender = sender;
+  GST_OBJECT_UNLOCK (self);
+
+  self->frame_num = 0;
+  self->last_dropped = 0;
+  return TRUE;
+}
+
+static gboolean
+gst_nv_msg_broker_stop (GstBaseSink * sink)
+{
+  GstNvMsgBroker *self = GST_NV_MSG_BROKER (sink);
+  nvgst::MessageSender *sender = self->sender;
+
+  if (sender == NULL)
+    return TRUE;
+
+  /* sends the open batch and what is queued while the transport is up */
+  sender->stop ();
+
+  GST_OBJECT_LOCK (self);
+  self->sender = NULL;
+  self->sent += sender->sent ();
+  self->dropped += sender->dropped ();
+  GST_OBJECT_UNLOCK (self);
+
+  delete sender;
+  return TRUE;
+}
+
+static gboolean
+gst_nv_msg_broker_unlock (GstBaseSink * sink)
+{
+  GstNvMsgBroker *self = GST_NV_MSG_BROKER (sink);
+
+  if (self->sender)
+    self->sender->set_flushing (true);
+  return TRUE;
+}
+
+static gboolean
+gst_nv_msg_broker_unlock_stop (GstBaseSink * sink)
+{
+  GstNvMsgBroker *self = GST_NV_MSG_BROKER (sink);
+
+  if (self->sender)
+    self->sender->set_flushing (false);
+  return TRUE;
+}
+
+/* Hands the open batch, if any, to the sender. */
+static void
+gst_nv_msg_broker_flush_batch (GstNvMsgBroker * self)
+{
+  self->sender->flush ();
+  gst_nv_msg_broker_check_dropped (self);
+}
+
+static void
+gst_nv_msg_broker_check_dropped (GstNvMsgBroker * self)
+{
+  nvgst::MessageSender *sender = self->sender;
+  guint64 dropped = sender->dropped ();
+
+  if (dropped != self->last_dropped) {
+    std::string error = sender->last_error ();
+
+    GST_WARNING_OBJECT (self, "transport fell behind, %" G_GUINT64_FORMAT
+        " frames dropped so far%s%s", dropped, error.empty ()? "" : ": ",
+        error.c_str ());
+    self->last_dropped = dropped;
+  }
+}
+
+static gboolean
+gst_nv_msg_broker_event (GstBaseSink * sink, GstEvent * event)
+{
+  GstNvMsgBroker *self = GST_NV_MSG_BROKER (sink);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS)
+    gst_nv_msg_broker_flush_batch (self);
+
+  return GST_BASE_SINK_CLASS (parent_class)->event (sink, event);
+}
+
+static void
+gst_nv_msg_broker_apply_config (GstNvMsgBroker * self)
+{
+  nvgst::MessageFormat format;
+  guint frames_per_batch;
+  gint64 max_batch_age;
+
+  GST_OBJECT_LOCK (self);
+  if (!self->reconfigure) {
+    GST_OBJECT_UNLOCK (self);
+    return;
+  }
+  format = self->format == GST_NV_MSG_FORMAT_BINARY ?
+      nvgst::MessageFormat::kBinary : nvgst::MessageFormat::kJson;
+  frames_per_batch = self->batch_size;
+  max_batch_age = (gint64) self->batch_interval;
+  self->skip = self->skip_empty;
+  self->source = self->source_id;
+  self->reconfigure = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  /* a batch holds one format */
+  if (format != self->wire_format)
+    gst_nv_msg_broker_flush_batch (self);
+  self->wire_format = format;
+  self->sender->set_batching (format, frames_per_batch, max_batch_age);
+}
+
+static gboolean
+gst_nv_msg_broker_has_objects (const nvgst::ObjectList * objects,
+    guint index)
+{
+  for (const nvgst::DetectedObject & object : *objects) {
+    if (object.frame == index)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+static GstFlowReturn
+gst_nv_msg_broker_render (GstBaseSink * sink, GstBuffer * buffer)
+{
+  GstNvMsgBroker *self = GST_NV_MSG_BROKER (sink);
+  static const nvgst::ObjectList no_objects;
+  GstNvObjectMeta *object_meta = gst_buffer_get_nv_object_meta (buffer);
+  GstNvBatchMeta *batch_meta = gst_buffer_get_nv_batch_meta (buffer);
+  const nvgst::ObjectList *objects =
+      object_meta ? object_meta->objects : &no_objects;
+  guint n_frames = batch_meta ? batch_meta->n_frames : 1;
+
+  gst_nv_msg_broker_apply_config (self);
+
+  for (guint i = 0; i < n_frames; i++) {
+    nvgst::FrameMessage message;
+    GstClockTime pts;
+
+    if (batch_meta) {
+      message.source = batch_meta->frames[i].source_id;
+      message.frame = batch_meta->frames[i].frame_num;
+      pts = batch_meta->frames[i].pts;
+    } else {
+      message.source = self->source;
+      message.frame = self->frame_num;
+      pts = GST_BUFFER_PTS (buffer);
+    }
+    message.pts = GST_CLOCK_TIME_IS_VALID (pts) ? (gint64) pts : -1;
+    message.index = i;
+    message.objects = objects->data ();
+    message.count = objects->size ();
+
+    if (self->skip && !gst_nv_msg_broker_has_objects (objects, i))
+      continue;
+    self->sender->append (message);
+  }
+  if (!batch_meta)
+    self->frame_num++;
+
+  gst_nv_msg_broker_check_dropped (self);
+
+  return GST_FLOW_OK;
+}
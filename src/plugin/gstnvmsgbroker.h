@@ -0,0 +1,80 @@
+#ifndef __GST_NV_MSG_BROKER_H__
+#define __GST_NV_MSG_BROKER_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasesink.h>
+
+#include "core/msg_broker.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+  GST_NV_MSG_FORMAT_JSON,
+  GST_NV_MSG_FORMAT_BINARY,
+} GstNvMsgFormat;
+
+#define GST_TYPE_NV_MSG_FORMAT (gst_nv_msg_format_get_type ())
+GType gst_nv_msg_format_get_type (void);
+
+typedef enum {
+  GST_NV_MSG_BACKPRESSURE_BLOCK,
+  GST_NV_MSG_BACKPRESSURE_DROP_OLDEST,
+  GST_NV_MSG_BACKPRESSURE_DROP_NEWEST,
+} GstNvMsgBackpressure;
+
+#define GST_TYPE_NV_MSG_BACKPRESSURE (gst_nv_msg_backpressure_get_type ())
+GType gst_nv_msg_backpressure_get_type (void);
+
+#define GST_TYPE_NV_MSG_BROKER \
+  (gst_nv_msg_broker_get_type())
+#define GST_NV_MSG_BROKER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_MSG_BROKER,GstNvMsgBroker))
+#define GST_NV_MSG_BROKER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_MSG_BROKER,GstNvMsgBrokerClass))
+#define GST_IS_NV_MSG_BROKER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_MSG_BROKER))
+
+typedef struct _GstNvMsgBroker GstNvMsgBroker;
+typedef struct _GstNvMsgBrokerClass GstNvMsgBrokerClass;
+
+struct _GstNvMsgBroker
+{
+  GstBaseSink parent;
+
+  /* properties, protected by the object lock */
+  gchar *location;
+  GstNvMsgFormat format;
+  guint batch_size;
+  guint64 batch_interval;
+  guint max_pending;
+  GstNvMsgBackpressure backpressure;
+  gboolean skip_empty;
+  guint source_id;
+  gboolean reconfigure;
+  /* totals of earlier runs */
+  guint64 sent;
+  guint64 dropped;
+
+  /* between start() and stop(), set and cleared under the object lock */
+  nvgst::MessageSender *sender;
+
+  /* streaming thread only */
+  nvgst::MessageFormat wire_format;
+  gboolean skip;
+  guint source;
+  guint64 frame_num;
+  guint64 last_dropped;
+};
+
+struct _GstNvMsgBrokerClass
+{
+  GstBaseSinkClass parent_class;
+};
+
+GType gst_nv_msg_broker_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvmsgbroker);
+
+G_END_DECLS
+
+#endif /* __GST_NV_MSG_BROKER_H__ */
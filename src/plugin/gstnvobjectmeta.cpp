@@ -0,0 +1,107 @@
+#include "gstnvobjectmeta.h"
+
+GType
+gst_nv_object_meta_api_get_type (void)
+{
+  static GType type = 0;
+  static const gchar *tags[] = { GST_META_TAG_VIDEO_STR,
+    GST_META_TAG_VIDEO_SIZE_STR, NULL
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = gst_meta_api_type_register ("GstNvObjectMetaAPI", tags);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+static gboolean
+gst_nv_object_meta_init (GstMeta * meta, gpointer params, GstBuffer * buffer)
+{
+  GstNvObjectMeta *ometa = (GstNvObjectMeta *) meta;
+
+  ometa->objects = new nvgst::ObjectList ();
+
+  return TRUE;
+}
+
+static void
+gst_nv_object_meta_free (GstMeta * meta, GstBuffer * buffer)
+{
+  GstNvObjectMeta *ometa = (GstNvObjectMeta *) meta;
+
+  delete ometa->objects;
+  ometa->objects = NULL;
+}
+
+/* Full copies keep the objects and scaling moves the boxes with the frame;
+ * region copies drop them, like the draw meta. */
+static gboolean
+gst_nv_object_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstNvObjectMeta *src = (GstNvObjectMeta *) meta;
+  GstNvObjectMeta *ometa;
+
+  if (GST_META_TRANSFORM_IS_COPY (type)) {
+    GstMetaTransformCopy *copy = (GstMetaTransformCopy *) data;
+
+    if (copy->region)
+      return FALSE;
+
+    ometa = gst_buffer_add_nv_object_meta (dest);
+    if (ometa == NULL)
+      return FALSE;
+    *ometa->objects = *src->objects;
+    return TRUE;
+  }
+
+  if (GST_VIDEO_META_TRANSFORM_IS_SCALE (type)) {
+    GstVideoMetaTransform *trans = (GstVideoMetaTransform *) data;
+    gint in_width = GST_VIDEO_INFO_WIDTH (trans->in_info);
+    gint in_height = GST_VIDEO_INFO_HEIGHT (trans->in_info);
+    gfloat sx, sy;
+
+    if (in_width <= 0 || in_height <= 0)
+      return FALSE;
+
+    ometa = gst_buffer_add_nv_object_meta (dest);
+    if (ometa == NULL)
+      return FALSE;
+
+    sx = (gfloat) GST_VIDEO_INFO_WIDTH (trans->out_info) / in_width;
+    sy = (gfloat) GST_VIDEO_INFO_HEIGHT (trans->out_info) / in_height;
+    *ometa->objects = *src->objects;
+    for (nvgst::DetectedObject & object : *ometa->objects) {
+      object.x *= sx;
+      object.y *= sy;
+      object.width *= sx;
+      object.height *= sy;
+    }
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+const GstMetaInfo *
+gst_nv_object_meta_get_info (void)
+{
+  static const GstMetaInfo *info = NULL;
+
+  if (g_once_init_enter (&info)) {
+    const GstMetaInfo *tmp = gst_meta_register (GST_NV_OBJECT_META_API_TYPE,
+        "GstNvObjectMeta", sizeof (GstNvObjectMeta),
+        gst_nv_object_meta_init, gst_nv_object_meta_free,
+        gst_nv_object_meta_transform);
+    g_once_init_leave (&info, tmp);
+  }
+  return info;
+}
+
+GstNvObjectMeta *
+gst_buffer_add_nv_object_meta (GstBuffer * buffer)
+{
+  return (GstNvObjectMeta *) gst_buffer_add_meta (buffer,
+      GST_NV_OBJECT_META_INFO, NULL);
+}
@@ -0,0 +1,44 @@
+/* Objects found in a buffer's frames: boxes and classes written by
+ * detectors, track ids written by nvtracker. */
+#ifndef __GST_NV_OBJECT_META_H__
+#define __GST_NV_OBJECT_META_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "core/objects.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GstNvObjectMeta GstNvObjectMeta;
+
+/**
+ * GstNvObjectMeta:
+ * @meta: parent #GstMeta
+ * @objects: the objects, owned by the meta. Boxes are in pixels of the
+ *     buffer's frames; on batches each object names its frame index.
+ *
+ * Fill it with nvgst::DetectedObject entries from core/objects.h, leaving
+ * track_id at nvgst::kNoTrack.
+ */
+struct _GstNvObjectMeta
+{
+  GstMeta meta;
+
+  nvgst::ObjectList *objects;
+};
+
+GType gst_nv_object_meta_api_get_type (void);
+#define GST_NV_OBJECT_META_API_TYPE (gst_nv_object_meta_api_get_type ())
+
+const GstMetaInfo *gst_nv_object_meta_get_info (void);
+#define GST_NV_OBJECT_META_INFO (gst_nv_object_meta_get_info ())
+
+#define gst_buffer_get_nv_object_meta(b) \
+  ((GstNvObjectMeta *) gst_buffer_get_meta ((b), GST_NV_OBJECT_META_API_TYPE))
+
+GstNvObjectMeta *gst_buffer_add_nv_object_meta (GstBuffer * buffer);
+
+G_END_DECLS
+
+#endif /* __GST_NV_OBJECT_META_H__ */
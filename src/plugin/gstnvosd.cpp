@@ -0,0 +1,279 @@
+/**
+ * SECTION:element-nvosd
+ *
+ * Draws the boxes, lines and labels of a #GstNvDrawMeta onto the frames
+ * carrying it, in place. All commands of a frame are rasterized into spans
+ * and drawn in a single pass over the frame with SIMD span fills and
+ * blends; label text is copied from glyph atlases rasterized once per text
+ * size, so nothing is rendered from scratch per frame.
+ *
+ * Works on single frames and on nvbatchmux batches, where every command
+ * addresses one frame of the batch. Buffers without a #GstNvDrawMeta pass
+ * through untouched and are never copied.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 filesrc location=cam.mp4 ! decodebin ! nvconvert ! \
+ *     video/x-raw,format=NV12 ! <detector> ! nvosd ! videoconvert ! autovideosink
+ * ]|
+ */
+
+#include "gstnvosd.h"
+#include "gstnvbatchmeta.h"
+#include "gstnvdrawmeta.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_osd_debug);
+#define GST_CAT_DEFAULT gst_nv_osd_debug
+
+#define DEFAULT_SIMD GST_NV_SIMD_LEVEL_AUTO
+
+enum
+{
+  PROP_0,
+  PROP_SIMD,
+};
+
+#define NV_OSD_FORMATS "{ NV12, I420, RGBA, BGRx }"
+
+#define NV_OSD_CAPS \
+  GST_VIDEO_CAPS_MAKE (NV_OSD_FORMATS) "; " \
+  GST_NV_BATCH_CAPS_MAKE (NV_OSD_FORMATS)
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_OSD_CAPS));
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_OSD_CAPS));
+
+#define gst_nv_osd_parent_class parent_class
+G_DEFINE_TYPE (GstNvOsd, gst_nv_osd, GST_TYPE_BASE_TRANSFORM);
+GST_ELEMENT_REGISTER_DEFINE (nvosd, "nvosd", GST_RANK_NONE, GST_TYPE_NV_OSD);
+
+static void gst_nv_osd_finalize (GObject * object);
+static void gst_nv_osd_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_osd_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static gboolean gst_nv_osd_set_caps (GstBaseTransform * trans,
+    GstCaps * incaps, GstCaps * outcaps);
+static GstFlowReturn gst_nv_osd_prepare_output_buffer (GstBaseTransform *
+    trans, GstBuffer * input, GstBuffer ** outbuf);
+static GstFlowReturn gst_nv_osd_transform_ip (GstBaseTransform * trans,
+    GstBuffer * buffer);
+
+static void
+gst_nv_osd_class_init (GstNvOsdClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_osd_debug, "nvosd", 0, "nvosd element");
+
+  gobject_class->finalize = gst_nv_osd_finalize;
+  gobject_class->set_property = gst_nv_osd_set_property;
+  gobject_class->get_property = gst_nv_osd_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_SIMD,
+      g_param_spec_enum ("simd", "SIMD",
+          "Highest SIMD level to use, capped at what the CPU supports "
+          "(applied on the next caps change)",
+          GST_TYPE_NV_SIMD_LEVEL, DEFAULT_SIMD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV on-screen display", "Filter/Editor/Video",
+      "Draws boxes, lines and labels from GstNvDrawMeta in one SIMD pass "
+      "per frame, with cached glyph atlases for text",
+      "nv_gst_plugins developers");
+
+  trans_class->set_caps = GST_DEBUG_FUNCPTR (gst_nv_osd_set_caps);
+  trans_class->prepare_output_buffer =
+      GST_DEBUG_FUNCPTR (gst_nv_osd_prepare_output_buffer);
+  trans_class->transform_ip = GST_DEBUG_FUNCPTR (gst_nv_osd_transform_ip);
+  trans_class->passthrough_on_same_caps = FALSE;
+}
+
+static void
+gst_nv_osd_init (GstNvOsd * self)
+{
+  self->simd = DEFAULT_SIMD;
+  self->batched = FALSE;
+  self->renderer = new nvgst::OsdRenderer ();
+
+  gst_base_transform_set_in_place (GST_BASE_TRANSFORM (self), TRUE);
+}
+
+static void
+gst_nv_osd_finalize (GObject * object)
+{
+  GstNvOsd *self = GST_NV_OSD (object);
+
+  delete self->renderer;
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_osd_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvOsd *self = GST_NV_OSD (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_SIMD:
+      self->simd = (GstNvSimdLevel) g_value_get_enum (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_osd_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstNvOsd *self = GST_NV_OSD (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_SIMD:
+      g_value_set_enum (value, self->simd);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static gboolean
+gst_nv_osd_set_caps (GstBaseTransform * trans, GstCaps * incaps,
+    GstCaps * outcaps)
+{
+  GstNvOsd *self = GST_NV_OSD (trans);
+  GstCapsFeatures *features;
+  nvgst::OsdConfig config;
+  GstNvSimdLevel simd;
+
+  if (!gst_video_info_from_caps (&self->info, incaps)) {
+    GST_ERROR_OBJECT (self, "invalid caps %" GST_PTR_FORMAT, incaps);
+    return FALSE;
+  }
+
+  features = gst_caps_get_features (incaps, 0);
+  self->batched = features != NULL &&
+      gst_caps_features_contains (features, GST_CAPS_FEATURE_META_GST_NV_BATCH);
+
+  GST_OBJECT_LOCK (self);
+  simd = self->simd;
+  GST_OBJECT_UNLOCK (self);
+
+  config.format =
+      gst_nv_pixel_format_from_video_format (GST_VIDEO_INFO_FORMAT
+      (&self->info));
+  config.width = GST_VIDEO_INFO_WIDTH (&self->info);
+  config.height = GST_VIDEO_INFO_HEIGHT (&self->info);
+  config.matrix = gst_nv_color_matrix_from_video_info (&self->info);
+  config.simd = gst_nv_simd_level_resolve (simd);
+
+  if (!self->renderer->configure (config)) {
+    GST_ERROR_OBJECT (self, "unsupported caps %" GST_PTR_FORMAT, incaps);
+    return FALSE;
+  }
+
+  GST_INFO_OBJECT (self, "drawing on %s%s %dx%d using %s kernels",
+      self->batched ? "batched " : "", nvgst::format_name (config.format),
+      config.width, config.height, nvgst::simd_level_name (config.simd));
+
+  return TRUE;
+}
+
+/* Buffers with nothing to draw go through as they are; the base class
+ * would otherwise copy every non-writable one. */
+static GstFlowReturn
+gst_nv_osd_prepare_output_buffer (GstBaseTransform * trans,
+    GstBuffer * input, GstBuffer ** outbuf)
+{
+  GstNvDrawMeta *meta = gst_buffer_get_nv_draw_meta (input);
+
+  if (meta == NULL || meta->list->empty ()) {
+    *outbuf = input;
+    return GST_FLOW_OK;
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->prepare_output_buffer
+      (trans, input, outbuf);
+}
+
+static GstFlowReturn
+gst_nv_osd_draw_batch (GstNvOsd * self, GstBuffer * buffer,
+    const nvgst::DrawList * list)
+{
+  GstNvBatchMeta *bmeta = gst_buffer_get_nv_batch_meta (buffer);
+  GstMapInfo map;
+  gint drawn = 0;
+
+  if (bmeta == NULL) {
+    GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
+        ("batched buffer without GstNvBatchMeta"));
+    return GST_FLOW_ERROR;
+  }
+  if (!gst_nv_batch_meta_make_frames_writable (bmeta))
+    return GST_FLOW_ERROR;
+
+  for (guint i = 0; i < bmeta->n_frames; i++) {
+    if (!gst_nv_batch_meta_map_frame (bmeta, buffer, i, &map,
+            GST_MAP_READWRITE)) {
+      GST_ELEMENT_ERROR (self, RESOURCE, WRITE, (NULL),
+          ("failed to map frame %u of the batch", i));
+      return GST_FLOW_ERROR;
+    }
+    drawn += self->renderer->draw (gst_nv_batch_frame_view (&bmeta->frames[i],
+            &self->info, &map), *list, i);
+    gst_nv_batch_meta_unmap_frame (bmeta, buffer, i, &map);
+  }
+
+  GST_LOG_OBJECT (self, "drew %d of %" G_GSIZE_FORMAT " commands on %u frames",
+      drawn, list->size (), bmeta->n_frames);
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_nv_osd_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
+{
+  GstNvOsd *self = GST_NV_OSD (trans);
+  GstNvDrawMeta *meta = gst_buffer_get_nv_draw_meta (buffer);
+  GstVideoFrame frame;
+  gint drawn;
+
+  if (meta == NULL || meta->list->empty ())
+    return GST_FLOW_OK;
+
+  if (self->batched)
+    return gst_nv_osd_draw_batch (self, buffer, meta->list);
+
+  if (!gst_video_frame_map (&frame, &self->info, buffer, GST_MAP_READWRITE)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, WRITE, (NULL),
+        ("failed to map frame"));
+    return GST_FLOW_ERROR;
+  }
+  drawn = self->renderer->draw (gst_nv_frame_view_from_video_frame (&frame),
+      *meta->list, 0);
+  gst_video_frame_unmap (&frame);
+
+  GST_LOG_OBJECT (self, "drew %d of %" G_GSIZE_FORMAT " commands", drawn,
+      meta->list->size ());
+
+  return GST_FLOW_OK;
+}
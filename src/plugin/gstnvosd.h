@@ -0,0 +1,49 @@
+#ifndef __GST_NV_OSD_H__
+#define __GST_NV_OSD_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include <gst/video/video.h>
+
+#include "gstnvutils.h"
+#include "core/osd.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_NV_OSD \
+  (gst_nv_osd_get_type())
+#define GST_NV_OSD(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_OSD,GstNvOsd))
+#define GST_NV_OSD_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_OSD,GstNvOsdClass))
+#define GST_IS_NV_OSD(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_OSD))
+
+typedef struct _GstNvOsd GstNvOsd;
+typedef struct _GstNvOsdClass GstNvOsdClass;
+
+struct _GstNvOsd
+{
+  GstBaseTransform parent;
+
+  /* properties, protected by the object lock */
+  GstNvSimdLevel simd;
+
+  /* streaming thread only */
+  GstVideoInfo info;
+  gboolean batched;
+  nvgst::OsdRenderer *renderer;
+};
+
+struct _GstNvOsdClass
+{
+  GstBaseTransformClass parent_class;
+};
+
+GType gst_nv_osd_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvosd);
+
+G_END_DECLS
+
+#endif /* __GST_NV_OSD_H__ */
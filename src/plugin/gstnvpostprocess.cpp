@@ -0,0 +1,525 @@
+/**
+ * SECTION:element-nvpostprocess
+ *
+ * Turns the raw output tensor of a detector, as attached by nvinfer in a
+ * #GstNvTensorMeta, into objects in a #GstNvObjectMeta. Boxes and scores
+ * are decoded from an anchor-free (YOLOv8 style, channels first) or an
+ * anchor-based (raw YOLOv5 style heads) layout, candidates under
+ * confidence-threshold are dropped, and class-aware non-maximum
+ * suppression keeps the best box of each overlapping group.
+ *
+ * All frames of an nvbatchmux batch go through one call: their candidates
+ * are decoded with SIMD kernels into one structure-of-arrays list, sorted
+ * once, and suppressed with SIMD IoU rows. Scratch memory is kept from
+ * buffer to buffer. Boxes are scaled from network-width x network-height
+ * to the frame size of the caps; objects are appended when the buffer
+ * already has a #GstNvObjectMeta. Buffers without tensors pass through.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 filesrc location=cam.mp4 ! decodebin ! nvconvert ! \
+ *     nvinfer backend=<detector> model-location=yolov8s.onnx ! \
+ *     nvpostprocess confidence-threshold=0.4 ! nvtracker ! fakesink
+ * ]|
+ */
+
+#include "gstnvpostprocess.h"
+#include "gstnvbatchmeta.h"
+#include "gstnvobjectmeta.h"
+#include "gstnvtensormeta.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_postprocess_debug);
+#define GST_CAT_DEFAULT gst_nv_postprocess_debug
+
+#define DEFAULT_LAYOUT GST_NV_DETECTION_LAYOUT_ANCHOR_FREE
+#define DEFAULT_NETWORK_WIDTH 640
+#define DEFAULT_NETWORK_HEIGHT 640
+#define DEFAULT_CONFIDENCE_THRESHOLD 0.25f
+#define DEFAULT_IOU_THRESHOLD 0.45f
+#define DEFAULT_PRE_NMS_TOP_K 1000
+#define DEFAULT_MAX_DETECTIONS 300
+#define DEFAULT_CLASS_AGNOSTIC FALSE
+#define DEFAULT_STRIDES "8,16,32"
+#define DEFAULT_ANCHORS \
+  "10,13,16,30,33,23,30,61,62,45,59,119,116,90,156,198,373,326"
+#define DEFAULT_SIMD GST_NV_SIMD_LEVEL_AUTO
+
+enum
+{
+  PROP_0,
+  PROP_LAYOUT,
+  PROP_TENSOR_NAME,
+  PROP_NETWORK_WIDTH,
+  PROP_NETWORK_HEIGHT,
+  PROP_CONFIDENCE_THRESHOLD,
+  PROP_IOU_THRESHOLD,
+  PROP_PRE_NMS_TOP_K,
+  PROP_MAX_DETECTIONS,
+  PROP_CLASS_AGNOSTIC,
+  PROP_STRIDES,
+  PROP_ANCHORS,
+  PROP_SIMD,
+};
+
+#define NV_POSTPROCESS_CAPS \
+  "video/x-raw; " GST_NV_BATCH_CAPS_MAKE (GST_VIDEO_FORMATS_ALL)
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_POSTPROCESS_CAPS));
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_POSTPROCESS_CAPS));
+
+GType
+gst_nv_detection_layout_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_NV_DETECTION_LAYOUT_ANCHOR_FREE,
+        "{4 + classes, candidates}: boxes in network pixels, class "
+          "probabilities", "anchor-free"},
+    {GST_NV_DETECTION_LAYOUT_ANCHOR_BASED,
+        "{candidates, 5 + classes}: logits decoded against strides and "
+          "anchors", "anchor-based"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = g_enum_register_static ("GstNvDetectionLayout", values);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+#define gst_nv_postprocess_parent_class parent_class
+G_DEFINE_TYPE (GstNvPostprocess, gst_nv_postprocess, GST_TYPE_BASE_TRANSFORM);
+GST_ELEMENT_REGISTER_DEFINE (nvpostprocess, "nvpostprocess", GST_RANK_NONE,
+    GST_TYPE_NV_POSTPROCESS);
+
+static void gst_nv_postprocess_finalize (GObject * object);
+static void gst_nv_postprocess_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_postprocess_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static gboolean gst_nv_postprocess_set_caps (GstBaseTransform * trans,
+    GstCaps * incaps, GstCaps * outcaps);
+static GstFlowReturn gst_nv_postprocess_transform_ip (GstBaseTransform *
+    trans, GstBuffer * buffer);
+
+static void
+gst_nv_postprocess_class_init (GstNvPostprocessClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_postprocess_debug, "nvpostprocess", 0,
+      "nvpostprocess element");
+
+  gobject_class->finalize = gst_nv_postprocess_finalize;
+  gobject_class->set_property = gst_nv_postprocess_set_property;
+  gobject_class->get_property = gst_nv_postprocess_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_LAYOUT,
+      g_param_spec_enum ("layout", "Layout",
+          "How the detector lays out its output tensor",
+          GST_TYPE_NV_DETECTION_LAYOUT, DEFAULT_LAYOUT,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_TENSOR_NAME,
+      g_param_spec_string ("tensor-name", "Tensor name",
+          "Output tensor to decode; the first one when unset",
+          NULL, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_NETWORK_WIDTH,
+      g_param_spec_uint ("network-width", "Network width",
+          "Width of the network input, the pixels boxes are decoded in",
+          1, G_MAXINT, DEFAULT_NETWORK_WIDTH,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_NETWORK_HEIGHT,
+      g_param_spec_uint ("network-height", "Network height",
+          "Height of the network input, the pixels boxes are decoded in",
+          1, G_MAXINT, DEFAULT_NETWORK_HEIGHT,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CONFIDENCE_THRESHOLD,
+      g_param_spec_float ("confidence-threshold", "Confidence threshold",
+          "Least score of a detection",
+          0.0f, 1.0f, DEFAULT_CONFIDENCE_THRESHOLD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_IOU_THRESHOLD,
+      g_param_spec_float ("iou-threshold", "IoU threshold",
+          "Detections overlapping a better one of the same class by more "
+          "than this are suppressed",
+          0.01f, 1.0f, DEFAULT_IOU_THRESHOLD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_PRE_NMS_TOP_K,
+      g_param_spec_uint ("pre-nms-top-k", "Pre-NMS top k",
+          "Best candidates per frame that go into suppression (0 = all)",
+          0, G_MAXINT, DEFAULT_PRE_NMS_TOP_K,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_DETECTIONS,
+      g_param_spec_uint ("max-detections", "Max detections",
+          "Best detections kept per frame (0 = all)",
+          0, G_MAXINT, DEFAULT_MAX_DETECTIONS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CLASS_AGNOSTIC,
+      g_param_spec_boolean ("class-agnostic", "Class agnostic",
+          "Suppress overlapping detections of different classes too",
+          DEFAULT_CLASS_AGNOSTIC,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_STRIDES,
+      g_param_spec_string ("strides", "Strides",
+          "anchor-based: comma-separated feature map strides",
+          DEFAULT_STRIDES,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_ANCHORS,
+      g_param_spec_string ("anchors", "Anchors",
+          "anchor-based: comma-separated anchor width,height pairs in "
+          "network pixels, the same number for each stride in turn",
+          DEFAULT_ANCHORS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SIMD,
+      g_param_spec_enum ("simd", "SIMD",
+          "Highest SIMD level to use, capped at what the CPU supports",
+          GST_TYPE_NV_SIMD_LEVEL, DEFAULT_SIMD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV detection post-processing", "Filter/Analyzer/Video",
+      "Decodes detector tensors of GstNvTensorMeta into GstNvObjectMeta "
+      "with SIMD thresholding and class-aware NMS over whole batches",
+      "nv_gst_plugins developers");
+
+  trans_class->set_caps = GST_DEBUG_FUNCPTR (gst_nv_postprocess_set_caps);
+  trans_class->transform_ip =
+      GST_DEBUG_FUNCPTR (gst_nv_postprocess_transform_ip);
+  trans_class->passthrough_on_same_caps = FALSE;
+
+  gst_type_mark_as_plugin_api (GST_TYPE_NV_DETECTION_LAYOUT,
+      (GstPluginAPIFlags) 0);
+}
+
+static void
+gst_nv_postprocess_init (GstNvPostprocess * self)
+{
+  self->layout = DEFAULT_LAYOUT;
+  self->tensor_name = NULL;
+  self->network_width = DEFAULT_NETWORK_WIDTH;
+  self->network_height = DEFAULT_NETWORK_HEIGHT;
+  self->confidence_threshold = DEFAULT_CONFIDENCE_THRESHOLD;
+  self->iou_threshold = DEFAULT_IOU_THRESHOLD;
+  self->pre_nms_top_k = DEFAULT_PRE_NMS_TOP_K;
+  self->max_detections = DEFAULT_MAX_DETECTIONS;
+  self->class_agnostic = DEFAULT_CLASS_AGNOSTIC;
+  self->strides = g_strdup (DEFAULT_STRIDES);
+  self->anchors = g_strdup (DEFAULT_ANCHORS);
+  self->simd = DEFAULT_SIMD;
+  self->reconfigure = TRUE;
+
+  gst_video_info_init (&self->info);
+  self->batched = FALSE;
+  self->tensor = NULL;
+  self->postprocess = new nvgst::DetectionPostprocessor ();
+
+  gst_base_transform_set_in_place (GST_BASE_TRANSFORM (self), TRUE);
+}
+
+static void
+gst_nv_postprocess_finalize (GObject * object)
+{
+  GstNvPostprocess *self = GST_NV_POSTPROCESS (object);
+
+  delete self->postprocess;
+  g_free (self->tensor);
+  g_free (self->anchors);
+  g_free (self->strides);
+  g_free (self->tensor_name);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_postprocess_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvPostprocess *self = GST_NV_POSTPROCESS (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_LAYOUT:
+      self->layout = (GstNvDetectionLayout) g_value_get_enum (value);
+      break;
+    case PROP_TENSOR_NAME:
+      g_free (self->tensor_name);
+      self->tensor_name = g_value_dup_string (value);
+      break;
+    case PROP_NETWORK_WIDTH:
+      self->network_width = g_value_get_uint (value);
+      break;
+    case PROP_NETWORK_HEIGHT:
+      self->network_height = g_value_get_uint (value);
+      break;
+    case PROP_CONFIDENCE_THRESHOLD:
+      self->confidence_threshold = g_value_get_float (value);
+      break;
+    case PROP_IOU_THRESHOLD:
+      self->iou_threshold = g_value_get_float (value);
+      break;
+    case PROP_PRE_NMS_TOP_K:
+      self->pre_nms_top_k = g_value_get_uint (value);
+      break;
+    case PROP_MAX_DETECTIONS:
+      self->max_detections = g_value_get_uint (value);
+      break;
+    case PROP_CLASS_AGNOSTIC:
+      self->class_agnostic = g_value_get_boolean (value);
+      break;
+    case PROP_STRIDES:
+      g_free (self->strides);
+      self->strides = g_value_dup_string (value);
+      break;
+    case PROP_ANCHORS:
+      g_free (self->anchors);
+      self->anchors = g_value_dup_string (value);
+      break;
+    case PROP_SIMD:
+      self->simd = (GstNvSimdLevel) g_value_get_enum (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      GST_OBJECT_UNLOCK (self);
+      return;
+  }
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_postprocess_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstNvPostprocess *self = GST_NV_POSTPROCESS (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_LAYOUT:
+      g_value_set_enum (value, self->layout);
+      break;
+    case PROP_TENSOR_NAME:
+      g_value_set_string (value, self->tensor_name);
+      break;
+    case PROP_NETWORK_WIDTH:
+      g_value_set_uint (value, self->network_width);
+      break;
+    case PROP_NETWORK_HEIGHT:
+      g_value_set_uint (value, self->network_height);
+      break;
+    case PROP_CONFIDENCE_THRESHOLD:
+      g_value_set_float (value, self->confidence_threshold);
+      break;
+    case PROP_IOU_THRESHOLD:
+      g_value_set_float (value, self->iou_threshold);
+      break;
+    case PROP_PRE_NMS_TOP_K:
+      g_value_set_uint (value, self->pre_nms_top_k);
+      break;
+    case PROP_MAX_DETECTIONS:
+      g_value_set_uint (value, self->max_detections);
+      break;
+    case PROP_CLASS_AGNOSTIC:
+      g_value_set_boolean (value, self->class_agnostic);
+      break;
+    case PROP_STRIDES:
+      g_value_set_string (value, self->strides);
+      break;
+    case PROP_ANCHORS:
+      g_value_set_string (value, self->anchors);
+      break;
+    case PROP_SIMD:
+      g_value_set_enum (value, self->simd);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static gboolean
+gst_nv_postprocess_set_caps (GstBaseTransform * trans, GstCaps * incaps,
+    GstCaps * outcaps)
+{
+  GstNvPostprocess *self = GST_NV_POSTPROCESS (trans);
+  GstCapsFeatures *features = gst_caps_get_features (incaps, 0);
+
+  if (!gst_video_info_from_caps (&self->info, incaps)) {
+    GST_ERROR_OBJECT (self, "invalid caps %" GST_PTR_FORMAT, incaps);
+    return FALSE;
+  }
+  self->batched = features != NULL &&
+      gst_caps_features_contains (features, GST_CAPS_FEATURE_META_GST_NV_BATCH);
+
+  /* boxes are scaled to the new frame size */
+  GST_OBJECT_LOCK (self);
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  return TRUE;
+}
+
+/* Comma-separated numbers; FALSE on anything else. */
+static gboolean
+gst_nv_postprocess_parse_list (const gchar * str, std::vector < float >*values)
+{
+  gchar **parts;
+  gboolean ok = TRUE;
+
+  values->clear ();
+  if (str == NULL)
+    return FALSE;
+
+  parts = g_strsplit (str, ",", -1);
+  for (gint i = 0; ok && parts[i] != NULL; i++) {
+    gchar *end;
+    gdouble v = g_ascii_strtod (g_strstrip (parts[i]), &end);
+
+    ok = end != parts[i] && *end == '\0';
+    values->push_back ((float) v);
+  }
+  g_strfreev (parts);
+
+  return ok && !values->empty ();
+}
+
+/* Takes property and caps changes into the postprocessor. Returns FALSE
+ * when they make no valid config. */
+static gboolean
+gst_nv_postprocess_apply_config (GstNvPostprocess * self)
+{
+  nvgst::DetectionConfig config;
+  std::vector < float >strides;
+  GstNvSimdLevel simd;
+  gboolean lists_ok;
+
+  GST_OBJECT_LOCK (self);
+  if (!self->reconfigure) {
+    GST_OBJECT_UNLOCK (self);
+    return TRUE;
+  }
+  config.layout = self->layout == GST_NV_DETECTION_LAYOUT_ANCHOR_BASED ?
+      nvgst::DetectionLayout::kAnchorBased : nvgst::DetectionLayout::kAnchorFree;
+  config.input_width = (int) self->network_width;
+  config.input_height = (int) self->network_height;
+  config.confidence_threshold = self->confidence_threshold;
+  config.iou_threshold = self->iou_threshold;
+  config.pre_nms_top_k = (int) self->pre_nms_top_k;
+  config.max_detections = (int) self->max_detections;
+  config.class_agnostic = self->class_agnostic;
+  lists_ok = gst_nv_postprocess_parse_list (self->strides, &strides) &&
+      gst_nv_postprocess_parse_list (self->anchors, &config.anchors);
+  g_free (self->tensor);
+  self->tensor = g_strdup (self->tensor_name);
+  simd = self->simd;
+  self->reconfigure = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  config.frame_width = GST_VIDEO_INFO_WIDTH (&self->info);
+  config.frame_height = GST_VIDEO_INFO_HEIGHT (&self->info);
+  config.simd = gst_nv_simd_level_resolve (simd);
+  config.strides.assign (strides.begin (), strides.end ());
+
+  if (!lists_ok && config.layout == nvgst::DetectionLayout::kAnchorBased) {
+    GST_ERROR_OBJECT (self, "strides and anchors must be comma-separated "
+        "numbers");
+    return FALSE;
+  }
+  if (!self->postprocess->configure (config))
+    return FALSE;
+
+  GST_INFO_OBJECT (self, "decoding %s %dx%d outputs for %dx%d frames, "
+      "confidence >= %.2f, %s NMS at IoU > %.2f, using %s kernels",
+      config.layout == nvgst::DetectionLayout::kAnchorBased ?
+      "anchor-based" : "anchor-free", config.input_width, config.input_height,
+      config.frame_width, config.frame_height, config.confidence_threshold,
+      config.class_agnostic ? "class-agnostic" : "class-aware",
+      config.iou_threshold, nvgst::simd_level_name (config.simd));
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_nv_postprocess_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
+{
+  GstNvPostprocess *self = GST_NV_POSTPROCESS (trans);
+  GstNvTensorMeta *tmeta = gst_buffer_get_nv_tensor_meta (buffer);
+  GstNvObjectMeta *ometa;
+  const nvgst::Tensor *tensor;
+  gint frames = 1;
+  gsize before;
+
+  if (tmeta == NULL || tmeta->tensors->empty ())
+    return GST_FLOW_OK;
+
+  if (!gst_nv_postprocess_apply_config (self)) {
+    GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS, (NULL),
+        ("invalid post-processing configuration"));
+    return GST_FLOW_ERROR;
+  }
+
+  if (self->tensor != NULL) {
+    tensor = gst_nv_tensor_meta_find (tmeta, self->tensor);
+    if (tensor == NULL) {
+      GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
+          ("no output tensor named %s", self->tensor));
+      return GST_FLOW_ERROR;
+    }
+  } else {
+    tensor = &tmeta->tensors->front ();
+  }
+
+  if (self->batched) {
+    GstNvBatchMeta *bmeta = gst_buffer_get_nv_batch_meta (buffer);
+
+    if (bmeta == NULL) {
+      GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
+          ("batched buffer without GstNvBatchMeta"));
+      return GST_FLOW_ERROR;
+    }
+    frames = (gint) bmeta->n_frames;
+  }
+
+  ometa = gst_buffer_get_nv_object_meta (buffer);
+  if (ometa == NULL)
+    ometa = gst_buffer_add_nv_object_meta (buffer);
+  before = ometa->objects->size ();
+
+  if (!self->postprocess->run (*tensor, frames, ometa->objects)) {
+    GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
+        ("tensor %s does not match the %s layout for %d frames",
+            tensor->info.name.c_str (),
+            self->postprocess->config ().layout ==
+            nvgst::DetectionLayout::kAnchorBased ? "anchor-based" :
+            "anchor-free", frames));
+    return GST_FLOW_ERROR;
+  }
+
+  GST_LOG_OBJECT (self, "%" G_GSIZE_FORMAT " objects on %d frames",
+      ometa->objects->size () - before, frames);
+
+  return GST_FLOW_OK;
+}
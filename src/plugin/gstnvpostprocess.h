@@ -0,0 +1,70 @@
+#ifndef __GST_NV_POSTPROCESS_H__
+#define __GST_NV_POSTPROCESS_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include <gst/video/video.h>
+
+#include "gstnvutils.h"
+#include "core/postprocess.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+  GST_NV_DETECTION_LAYOUT_ANCHOR_FREE,
+  GST_NV_DETECTION_LAYOUT_ANCHOR_BASED,
+} GstNvDetectionLayout;
+
+#define GST_TYPE_NV_DETECTION_LAYOUT (gst_nv_detection_layout_get_type ())
+GType gst_nv_detection_layout_get_type (void);
+
+#define GST_TYPE_NV_POSTPROCESS \
+  (gst_nv_postprocess_get_type())
+#define GST_NV_POSTPROCESS(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_POSTPROCESS,GstNvPostprocess))
+#define GST_NV_POSTPROCESS_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_POSTPROCESS,GstNvPostprocessClass))
+#define GST_IS_NV_POSTPROCESS(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_POSTPROCESS))
+
+typedef struct _GstNvPostprocess GstNvPostprocess;
+typedef struct _GstNvPostprocessClass GstNvPostprocessClass;
+
+struct _GstNvPostprocess
+{
+  GstBaseTransform parent;
+
+  /* properties, protected by the object lock */
+  GstNvDetectionLayout layout;
+  gchar *tensor_name;
+  guint network_width;
+  guint network_height;
+  gfloat confidence_threshold;
+  gfloat iou_threshold;
+  guint pre_nms_top_k;
+  guint max_detections;
+  gboolean class_agnostic;
+  gchar *strides;
+  gchar *anchors;
+  GstNvSimdLevel simd;
+  gboolean reconfigure;
+
+  /* streaming thread only */
+  GstVideoInfo info;
+  gboolean batched;
+  gchar *tensor;
+  nvgst::DetectionPostprocessor *postprocess;
+};
+
+struct _GstNvPostprocessClass
+{
+  GstBaseTransformClass parent_class;
+};
+
+GType gst_nv_postprocess_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvpostprocess);
+
+G_END_DECLS
+
+#endif /* __GST_NV_POSTPROCESS_H__ */
@@ -0,0 +1,698 @@
+/**
+ * SECTION:element-nvpyramid
+ *
+ * Scales every frame into several resolutions at once, for multiscale
+ * detection, thumbnails and preview streams, in place of a tee with one
+ * videoscale per branch. #GstNvPyramid:levels lists the sizes; level %u
+ * comes out of src_%u in the input format.
+ *
+ * The source is read in one pass: it is cut into bands of rows spread over
+ * #GstNvPyramid:threads threads, and each band is scaled into every level
+ * while it is in cache. Bilinear taps and weights are computed once per
+ * level when the caps or the levels change.
+ *
+ * All levels of a frame are written into one buffer from a preallocated
+ * pool. The per-level buffers pushed on the src pads wrap their region of
+ * it without copying, and the pyramid buffer goes back to the pool once
+ * every level has been released. Plane strides are aligned, so level
+ * buffers carry a #GstVideoMeta whenever that differs from the default
+ * layout.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 videotestsrc ! video/x-raw,width=1920,height=1080 ! \
+ *     nvpyramid name=p levels=960x540,480x270 \
+ *     p.src_0 ! queue ! autovideosink  p.src_1 ! queue ! autovideosink
+ * ]|
+ */
+
+#include "gstnvpyramid.h"
+#include "gstnvbufferpool.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_pyramid_debug);
+#define GST_CAT_DEFAULT gst_nv_pyramid_debug
+
+#define DEFAULT_LEVELS "1280x720,640x360,320x180"
+#define DEFAULT_THREADS 0
+#define DEFAULT_SIMD GST_NV_SIMD_LEVEL_AUTO
+#define DEFAULT_OUTPUT_BUFFERS 4
+
+enum
+{
+  PROP_0,
+  PROP_LEVELS,
+  PROP_THREADS,
+  PROP_SIMD,
+  PROP_OUTPUT_BUFFERS,
+};
+
+#define NV_PYRAMID_CAPS GST_VIDEO_CAPS_MAKE ("{ NV12, I420, RGBA, BGRx }")
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_PYRAMID_CAPS));
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src_%u",
+    GST_PAD_SRC,
+    GST_PAD_SOMETIMES,
+    GST_STATIC_CAPS (NV_PYRAMID_CAPS));
+
+/* Keeps a pyramid buffer mapped until the last level buffer is freed. */
+struct GstNvPyramidFrameRef
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  gint refs;
+};
+
+#define gst_nv_pyramid_parent_class parent_class
+G_DEFINE_TYPE (GstNvPyramid, gst_nv_pyramid, GST_TYPE_ELEMENT);
+GST_ELEMENT_REGISTER_DEFINE (nvpyramid, "nvpyramid", GST_RANK_NONE,
+    GST_TYPE_NV_PYRAMID);
+
+static void gst_nv_pyramid_finalize (GObject * object);
+static void gst_nv_pyramid_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_pyramid_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static GstStateChangeReturn gst_nv_pyramid_change_state (GstElement *
+    element, GstStateChange transition);
+static GstFlowReturn gst_nv_pyramid_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buffer);
+static gboolean gst_nv_pyramid_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event);
+static gboolean gst_nv_pyramid_sink_query (GstPad * pad, GstObject * parent,
+    GstQuery * query);
+
+static void
+gst_nv_pyramid_class_init (GstNvPyramidClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_pyramid_debug, "nvpyramid", 0,
+      "nvpyramid element");
+
+  gobject_class->finalize = gst_nv_pyramid_finalize;
+  gobject_class->set_property = gst_nv_pyramid_set_property;
+  gobject_class->get_property = gst_nv_pyramid_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_LEVELS,
+      g_param_spec_string ("levels", "Levels",
+          "Output sizes as \"WxH,WxH,...\", up to 8 (even for NV12 and "
+          "I420); level N is pushed on src_N", DEFAULT_LEVELS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_THREADS,
+      g_param_spec_uint ("threads", "Threads",
+          "Threads scaling bands of source rows, including the streaming "
+          "thread (0 = one per CPU)", 0, 64, DEFAULT_THREADS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SIMD,
+      g_param_spec_enum ("simd", "SIMD",
+          "Highest SIMD level to use, capped at what the CPU supports",
+          GST_TYPE_NV_SIMD_LEVEL, DEFAULT_SIMD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_OUTPUT_BUFFERS,
+      g_param_spec_uint ("output-buffers", "Output buffers",
+          "Number of pyramid buffers preallocated in the pool",
+          1, 64, DEFAULT_OUTPUT_BUFFERS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV pyramid", "Filter/Converter/Video/Scaler",
+      "Scales video into several resolutions in one pass over the source, "
+      "all levels sharing one pooled buffer",
+      "nv_gst_plugins developers");
+
+  element_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_nv_pyramid_change_state);
+
+  gst_type_mark_as_plugin_api (GST_TYPE_NV_SIMD_LEVEL, (GstPluginAPIFlags) 0);
+}
+
+static void
+gst_nv_pyramid_init (GstNvPyramid * self)
+{
+  self->sinkpad = gst_pad_new_from_static_template (&sink_template, "sink");
+  gst_pad_set_chain_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_nv_pyramid_chain));
+  gst_pad_set_event_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_nv_pyramid_sink_event));
+  gst_pad_set_query_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_nv_pyramid_sink_query));
+  gst_element_add_pad (GST_ELEMENT (self), self->sinkpad);
+
+  self->levels = g_strdup (DEFAULT_LEVELS);
+  self->threads = DEFAULT_THREADS;
+  self->simd = DEFAULT_SIMD;
+  self->output_buffers = DEFAULT_OUTPUT_BUFFERS;
+  self->reconfigure = TRUE;
+  gst_video_info_init (&self->info);
+  self->flow_combiner = gst_flow_combiner_new ();
+  self->scaler = new nvgst::PyramidScaler ();
+  self->pool = new nvgst::ThreadPool ();
+}
+
+static void
+gst_nv_pyramid_finalize (GObject * object)
+{
+  GstNvPyramid *self = GST_NV_PYRAMID (object);
+
+  g_free (self->levels);
+  gst_flow_combiner_free (self->flow_combiner);
+  gst_clear_caps (&self->caps);
+  gst_clear_object (&self->buffer_pool);
+  delete self->scaler;
+  delete self->pool;
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_pyramid_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvPyramid *self = GST_NV_PYRAMID (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_LEVELS:
+      g_free (self->levels);
+      self->levels = g_value_dup_string (value);
+      break;
+    case PROP_THREADS:
+      self->threads = g_value_get_uint (value);
+      break;
+    case PROP_SIMD:
+      self->simd = (GstNvSimdLevel) g_value_get_enum (value);
+      break;
+    case PROP_OUTPUT_BUFFERS:
+      self->output_buffers = g_value_get_uint (value);
+      break;
+    default:
+      GST_OBJECT_UNLOCK (self);
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      return;
+  }
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_pyramid_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstNvPyramid *self = GST_NV_PYRAMID (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_LEVELS:
+      g_value_set_string (value, self->levels);
+      break;
+    case PROP_THREADS:
+      g_value_set_uint (value, self->threads);
+      break;
+    case PROP_SIMD:
+      g_value_set_enum (value, self->simd);
+      break;
+    case PROP_OUTPUT_BUFFERS:
+      g_value_set_uint (value, self->output_buffers);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+/* "WxH,WxH,..."; FALSE on bad input or more than
+ * GST_NV_PYRAMID_MAX_LEVELS levels. */
+static gboolean
+gst_nv_pyramid_parse_levels (const gchar * str,
+    std::vector < nvgst::PyramidLevel > *levels)
+{
+  gchar **entries;
+  gboolean ok = TRUE;
+
+  levels->clear ();
+  if (str == NULL)
+    return FALSE;
+
+  entries = g_strsplit (str, ",", -1);
+  for (gint i = 0; ok && entries[i] != NULL; i++) {
+    gchar *s = g_strstrip (entries[i]);
+    gchar *end;
+    nvgst::PyramidLevel level;
+
+    /* tolerate a trailing separator */
+    if (*s == '\0' && entries[i + 1] == NULL)
+      break;
+    level.width = (gint) g_ascii_strtoull (s, &end, 10);
+    ok = end != s && *end == 'x';
+    if (ok) {
+      s = end + 1;
+      level.height = (gint) g_ascii_strtoull (s, &end, 10);
+      ok = end != s && *end == '\0' && level.width > 0 &&
+          level.width <= 16384 && level.height > 0 && level.height <= 16384 &&
+          levels->size () < GST_NV_PYRAMID_MAX_LEVELS;
+    }
+    if (ok)
+      levels->push_back (level);
+  }
+  g_strfreev (entries);
+
+  return ok && !levels->empty ();
+}
+
+static void
+gst_nv_pyramid_remove_src_pads (GstNvPyramid * self, guint keep)
+{
+  while (self->n_srcpads > keep) {
+    GstPad *srcpad = self->srcpads[--self->n_srcpads];
+
+    self->srcpads[self->n_srcpads] = NULL;
+    gst_flow_combiner_remove_pad (self->flow_combiner, srcpad);
+    gst_pad_set_active (srcpad, FALSE);
+    gst_element_remove_pad (GST_ELEMENT (self), srcpad);
+  }
+}
+
+static GstStateChangeReturn
+gst_nv_pyramid_change_state (GstElement * element, GstStateChange transition)
+{
+  GstNvPyramid *self = GST_NV_PYRAMID (element);
+  GstStateChangeReturn ret;
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+  if (ret == GST_STATE_CHANGE_FAILURE)
+    return ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_nv_pyramid_remove_src_pads (self, 0);
+      gst_flow_combiner_reset (self->flow_combiner);
+      if (self->buffer_pool) {
+        gst_buffer_pool_set_active (self->buffer_pool, FALSE);
+        gst_clear_object (&self->buffer_pool);
+      }
+      self->pool->stop ();
+      gst_clear_caps (&self->caps);
+      gst_video_info_init (&self->info);
+      GST_OBJECT_LOCK (self);
+      self->reconfigure = TRUE;
+      GST_OBJECT_UNLOCK (self);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
+/* Input caps with the level's size; the pixel aspect ratio follows the
+ * change of shape so the picture keeps its display aspect. */
+static GstCaps *
+gst_nv_pyramid_level_caps (GstNvPyramid * self,
+    const nvgst::PyramidLevel & level)
+{
+  GstCaps *caps = gst_caps_copy (self->caps);
+  gint par_n = 1, par_d = 1;
+
+  gst_util_fraction_multiply (GST_VIDEO_INFO_PAR_N (&self->info),
+      GST_VIDEO_INFO_PAR_D (&self->info),
+      GST_VIDEO_INFO_WIDTH (&self->info) * level.height,
+      GST_VIDEO_INFO_HEIGHT (&self->info) * level.width, &par_n, &par_d);
+  gst_caps_set_simple (caps,
+      "width", G_TYPE_INT, level.width,
+      "height", G_TYPE_INT, level.height,
+      "pixel-aspect-ratio", GST_TYPE_FRACTION, par_n, par_d, NULL);
+
+  return caps;
+}
+
+/* New pads get their own stream-start, then caps and the input segment. */
+static void
+gst_nv_pyramid_add_src_pad (GstNvPyramid * self, GstCaps * caps)
+{
+  guint level = self->n_srcpads;
+  GstPad *srcpad;
+  GstEvent *event;
+  gchar *name, *stream_id;
+
+  name = g_strdup_printf ("src_%u", level);
+  srcpad = gst_pad_new_from_static_template (&src_template, name);
+  g_free (name);
+
+  gst_pad_use_fixed_caps (srcpad);
+  gst_pad_set_active (srcpad, TRUE);
+
+  stream_id = gst_pad_create_stream_id_printf (srcpad, GST_ELEMENT (self),
+      "%u", level);
+  event = gst_event_new_stream_start (stream_id);
+  g_free (stream_id);
+  if (self->group_id != GST_GROUP_ID_INVALID)
+    gst_event_set_group_id (event, self->group_id);
+  gst_pad_push_event (srcpad, event);
+
+  gst_pad_push_event (srcpad, gst_event_new_caps (caps));
+
+  event = gst_pad_get_sticky_event (self->sinkpad, GST_EVENT_SEGMENT, 0);
+  if (event)
+    gst_pad_push_event (srcpad, event);
+
+  self->srcpads[self->n_srcpads++] = srcpad;
+  gst_flow_combiner_add_pad (self->flow_combiner, srcpad);
+  gst_element_add_pad (GST_ELEMENT (self), srcpad);
+
+  GST_INFO_OBJECT (self, "added pad for level %u", level);
+}
+
+/* One src pad per level, each with the caps of its level. */
+static void
+gst_nv_pyramid_update_src_pads (GstNvPyramid * self)
+{
+  const nvgst::PyramidConfig & config = self->scaler->config ();
+  guint n_levels = (guint) self->scaler->n_levels ();
+  gboolean added = FALSE;
+
+  gst_nv_pyramid_remove_src_pads (self, n_levels);
+
+  for (guint i = 0; i < n_levels; i++) {
+    GstCaps *caps = gst_nv_pyramid_level_caps (self, config.levels[i]);
+
+    if (i >= self->n_srcpads) {
+      gst_nv_pyramid_add_src_pad (self, caps);
+      added = TRUE;
+    } else {
+      GstCaps *current = gst_pad_get_current_caps (self->srcpads[i]);
+
+      if (current == NULL || !gst_caps_is_equal (current, caps))
+        gst_pad_push_event (self->srcpads[i], gst_event_new_caps (caps));
+      gst_clear_caps (&current);
+    }
+    gst_caps_unref (caps);
+  }
+
+  if (added)
+    gst_element_no_more_pads (GST_ELEMENT (self));
+}
+
+/* Replaces the pool of pyramid buffers; called on every configuration, so
+ * only when the caps or the properties change. */
+static gboolean
+gst_nv_pyramid_setup_buffer_pool (GstNvPyramid * self, guint output_buffers)
+{
+  gsize size = self->scaler->layout ().size;
+  GstAllocationParams params;
+  GstStructure *config;
+
+  if (self->buffer_pool) {
+    gst_buffer_pool_set_active (self->buffer_pool, FALSE);
+    gst_clear_object (&self->buffer_pool);
+  }
+
+  self->buffer_pool = gst_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (self->buffer_pool);
+  gst_buffer_pool_config_set_params (config, self->caps, (guint) size,
+      output_buffers, 0);
+  gst_allocation_params_init (&params);
+  params.align = GST_NV_BUFFER_POOL_ALIGN - 1;
+  gst_buffer_pool_config_set_allocator (config, NULL, &params);
+  if (!gst_buffer_pool_set_config (self->buffer_pool, config) ||
+      !gst_buffer_pool_set_active (self->buffer_pool, TRUE)) {
+    GST_ERROR_OBJECT (self, "failed to set up a pool of %" G_GSIZE_FORMAT
+        " byte pyramids", size);
+    gst_clear_object (&self->buffer_pool);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Takes property and caps changes into the scaler, the thread pool, the
+ * buffer pool and the src pads. */
+static gboolean
+gst_nv_pyramid_configure (GstNvPyramid * self)
+{
+  nvgst::PyramidConfig config;
+  GstNvSimdLevel simd;
+  guint threads, output_buffers;
+  gboolean parsed;
+
+  GST_OBJECT_LOCK (self);
+  if (!self->reconfigure || self->caps == NULL) {
+    GST_OBJECT_UNLOCK (self);
+    return TRUE;
+  }
+  parsed = gst_nv_pyramid_parse_levels (self->levels, &config.levels);
+  threads = self->threads;
+  simd = self->simd;
+  output_buffers = self->output_buffers;
+  self->reconfigure = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  if (!parsed) {
+    GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS, (NULL),
+        ("levels must look like \"WxH,WxH,...\" with at most %d levels",
+            GST_NV_PYRAMID_MAX_LEVELS));
+    return FALSE;
+  }
+
+  config.format =
+      gst_nv_pixel_format_from_video_format (GST_VIDEO_INFO_FORMAT
+      (&self->info));
+  config.width = GST_VIDEO_INFO_WIDTH (&self->info);
+  config.height = GST_VIDEO_INFO_HEIGHT (&self->info);
+  config.simd = gst_nv_simd_level_resolve (simd);
+
+  if (threads == 0)
+    threads = g_get_num_processors ();
+  if (!self->pool->start ((int) threads))
+    return FALSE;
+
+  if (!self->scaler->configure (config, self->pool)) {
+    GST_ELEMENT_ERROR (self, CORE, NEGOTIATION, (NULL),
+        ("cannot scale %s %dx%d into %d levels",
+            nvgst::format_name (config.format), config.width, config.height,
+            (gint) config.levels.size ()));
+    return FALSE;
+  }
+  if (!gst_nv_pyramid_setup_buffer_pool (self, output_buffers))
+    return FALSE;
+  gst_nv_pyramid_update_src_pads (self);
+
+  GST_INFO_OBJECT (self, "%d levels from %s %dx%d in %" G_GSIZE_FORMAT
+      " byte buffers, %d threads, using %s kernels", self->scaler->n_levels (),
+      nvgst::format_name (config.format), config.width, config.height,
+      self->scaler->layout ().size, self->pool->size (),
+      nvgst::simd_level_name (self->scaler->simd_level ()));
+
+  return TRUE;
+}
+
+static void
+gst_nv_pyramid_frame_ref_unref (gpointer data)
+{
+  GstNvPyramidFrameRef *ref = (GstNvPyramidFrameRef *) data;
+
+  if (!g_atomic_int_dec_and_test (&ref->refs))
+    return;
+  gst_buffer_unmap (ref->buffer, &ref->map);
+  gst_buffer_unref (ref->buffer);
+  delete ref;
+}
+
+/* Level buffer wrapping its region of the pyramid, with the input's
+ * timestamps and flags. A video meta describes the aligned layout. */
+static GstBuffer *
+gst_nv_pyramid_level_buffer (GstNvPyramid * self, GstNvPyramidFrameRef * ref,
+    guint level, GstBuffer * inbuf)
+{
+  const nvgst::PyramidLayout & layout = self->scaler->layout ();
+  const nvgst::FrameLayout & frame = layout.levels[level];
+  GstBuffer *out = gst_buffer_new ();
+  GstVideoInfo info;
+  gsize offset[GST_VIDEO_MAX_PLANES] = { 0, };
+  gint stride[GST_VIDEO_MAX_PLANES] = { 0, };
+  gboolean is_default = TRUE;
+
+  g_atomic_int_inc (&ref->refs);
+  gst_buffer_append_memory (out,
+      gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, ref->map.data,
+          ref->map.size, layout.offset[level], frame.size, ref,
+          gst_nv_pyramid_frame_ref_unref));
+  gst_buffer_copy_into (out, inbuf, (GstBufferCopyFlags)
+      (GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS), 0, -1);
+
+  gst_video_info_set_format (&info, GST_VIDEO_INFO_FORMAT (&self->info),
+      frame.width, frame.height);
+  for (gint p = 0; p < frame.n_planes; p++) {
+    offset[p] = frame.offset[p];
+    stride[p] = frame.stride[p];
+    if (offset[p] != GST_VIDEO_INFO_PLANE_OFFSET (&info, p) ||
+        stride[p] != GST_VIDEO_INFO_PLANE_STRIDE (&info, p))
+      is_default = FALSE;
+  }
+  if (!is_default)
+    gst_buffer_add_video_meta_full (out, GST_VIDEO_FRAME_FLAG_NONE,
+        GST_VIDEO_INFO_FORMAT (&info), frame.width, frame.height,
+        frame.n_planes, offset, stride);
+
+  return out;
+}
+
+static GstFlowReturn
+gst_nv_pyramid_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstNvPyramid *self = GST_NV_PYRAMID (parent);
+  nvgst::FrameView levels[GST_NV_PYRAMID_MAX_LEVELS];
+  GstNvPyramidFrameRef *ref;
+  GstVideoFrame in_frame;
+  GstBuffer *outbuf = NULL;
+  GstFlowReturn ret;
+
+  if (!gst_nv_pyramid_configure (self)) {
+    gst_buffer_unref (buffer);
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
+  if (self->buffer_pool == NULL) {
+    GST_ELEMENT_ERROR (self, CORE, NEGOTIATION, (NULL),
+        ("received a buffer before caps"));
+    gst_buffer_unref (buffer);
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
+
+  ret = gst_buffer_pool_acquire_buffer (self->buffer_pool, &outbuf, NULL);
+  if (ret != GST_FLOW_OK) {
+    gst_buffer_unref (buffer);
+    return ret;
+  }
+
+  if (!gst_video_frame_map (&in_frame, &self->info, buffer, GST_MAP_READ)) {
+    GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
+        ("failed to map the input frame"));
+    gst_buffer_unref (outbuf);
+    gst_buffer_unref (buffer);
+    return GST_FLOW_ERROR;
+  }
+
+  /* the chain holds one reference until every level is pushed */
+  ref = new GstNvPyramidFrameRef ();
+  ref->buffer = outbuf;
+  ref->refs = 1;
+  if (!gst_buffer_map (outbuf, &ref->map, GST_MAP_WRITE)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, WRITE, (NULL),
+        ("failed to map the pyramid buffer"));
+    delete ref;
+    gst_video_frame_unmap (&in_frame);
+    gst_buffer_unref (outbuf);
+    gst_buffer_unref (buffer);
+    return GST_FLOW_ERROR;
+  }
+
+  self->scaler->level_views (ref->map.data, levels);
+  self->scaler->run (gst_nv_frame_view_from_video_frame (&in_frame), levels,
+      self->pool);
+  gst_video_frame_unmap (&in_frame);
+
+  for (guint i = 0; i < self->n_srcpads; i++) {
+    GstBuffer *out = gst_nv_pyramid_level_buffer (self, ref, i, buffer);
+
+    ret = gst_flow_combiner_update_pad_flow (self->flow_combiner,
+        self->srcpads[i], gst_pad_push (self->srcpads[i], out));
+    if (ret != GST_FLOW_OK)
+      break;
+  }
+
+  gst_nv_pyramid_frame_ref_unref (ref);
+  gst_buffer_unref (buffer);
+
+  return ret;
+}
+
+static gboolean
+gst_nv_pyramid_set_caps (GstNvPyramid * self, GstCaps * caps)
+{
+  GstVideoInfo info;
+
+  if (!gst_video_info_from_caps (&info, caps)) {
+    GST_ERROR_OBJECT (self, "invalid caps %" GST_PTR_FORMAT, caps);
+    return FALSE;
+  }
+  self->info = info;
+  gst_caps_replace (&self->caps, caps);
+
+  /* levels are set up here rather than on the first buffer */
+  GST_OBJECT_LOCK (self);
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  return gst_nv_pyramid_configure (self);
+}
+
+static gboolean
+gst_nv_pyramid_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  GstNvPyramid *self = GST_NV_PYRAMID (parent);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_STREAM_START:
+      /* every src pad sends its own, see add_src_pad() */
+      if (!gst_event_parse_group_id (event, &self->group_id))
+        self->group_id = gst_util_group_id_next ();
+      gst_event_unref (event);
+      return TRUE;
+    case GST_EVENT_CAPS:{
+      GstCaps *caps;
+      gboolean ret;
+
+      gst_event_parse_caps (event, &caps);
+      ret = gst_nv_pyramid_set_caps (self, caps);
+      gst_event_unref (event);
+      return ret;
+    }
+    case GST_EVENT_FLUSH_STOP:
+      gst_flow_combiner_reset (self->flow_combiner);
+      break;
+    default:
+      break;
+  }
+
+  return gst_pad_event_default (pad, parent, event);
+}
+
+static gboolean
+gst_nv_pyramid_sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_CAPS:{
+      GstCaps *filter, *caps;
+
+      gst_query_parse_caps (query, &filter);
+      caps = gst_pad_get_pad_template_caps (pad);
+      if (filter) {
+        GstCaps *tmp =
+            gst_caps_intersect_full (filter, caps, GST_CAPS_INTERSECT_FIRST);
+        gst_caps_unref (caps);
+        caps = tmp;
+      }
+      gst_query_set_caps_result (query, caps);
+      gst_caps_unref (caps);
+      return TRUE;
+    }
+    case GST_QUERY_ALLOCATION:
+      /* input is only read, through gst_video_frame_map() */
+      gst_query_add_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+      return TRUE;
+    default:
+      break;
+  }
+
+  return gst_pad_query_default (pad, parent, query);
+}
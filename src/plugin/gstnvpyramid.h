@@ -0,0 +1,66 @@
+#ifndef __GST_NV_PYRAMID_H__
+#define __GST_NV_PYRAMID_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstflowcombiner.h>
+#include <gst/video/video.h>
+
+#include "gstnvutils.h"
+#include "core/pyramid.h"
+#include "core/thread_pool.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_NV_PYRAMID \
+  (gst_nv_pyramid_get_type())
+#define GST_NV_PYRAMID(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_PYRAMID,GstNvPyramid))
+#define GST_NV_PYRAMID_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_PYRAMID,GstNvPyramidClass))
+#define GST_IS_NV_PYRAMID(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_PYRAMID))
+
+#define GST_NV_PYRAMID_MAX_LEVELS 8
+
+typedef struct _GstNvPyramid GstNvPyramid;
+typedef struct _GstNvPyramidClass GstNvPyramidClass;
+
+struct _GstNvPyramid
+{
+  GstElement parent;
+
+  GstPad *sinkpad;
+
+  /* properties, protected by the object lock */
+  gchar *levels;
+  guint threads;
+  GstNvSimdLevel simd;
+  guint output_buffers;
+  gboolean reconfigure;
+
+  /* streaming thread only */
+  GstVideoInfo info;
+  GstCaps *caps;
+  guint group_id;
+  /* src_%u is level %u */
+  GstPad *srcpads[GST_NV_PYRAMID_MAX_LEVELS];
+  guint n_srcpads;
+  GstFlowCombiner *flow_combiner;
+  /* one buffer holds every level */
+  GstBufferPool *buffer_pool;
+  nvgst::PyramidScaler *scaler;
+  nvgst::ThreadPool *pool;
+};
+
+struct _GstNvPyramidClass
+{
+  GstElementClass parent_class;
+};
+
+GType gst_nv_pyramid_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvpyramid);
+
+G_END_DECLS
+
+#endif /* __GST_NV_PYRAMID_H__ */
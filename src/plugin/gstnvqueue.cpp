@@ -0,0 +1,663 @@
+/**
+ * SECTION:element-nvqueue
+ *
+ * A thread boundary like queue, for links that carry many small buffers
+ * (metadata branches, audio, batched tensors) where queue's mutex and
+ * condition variable per buffer show up in profiles. Buffers, serialized
+ * events and serialized queries go through a bounded single-producer,
+ * single-consumer ring in stream order; a side that has to wait spins for
+ * a while before sleeping, with the spin adapted to how often spinning
+ * pays off, and the other side only takes a lock to wake it when it
+ * actually sleeps.
+ *
+ * The max-size-buffers, max-size-bytes, max-size-time, current-level-*
+ * and leaky properties behave as in queue: the queue is full once any
+ * level reaches its limit, and a full queue blocks upstream, drops new
+ * buffers (leaky=upstream) or drops the oldest ones (leaky=downstream,
+ * the next buffer pushed gets the DISCONT flag). ring-size bounds the
+ * number of queued items, events and queries included.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 audiotestsrc is-live=true samplesperbuffer=48 ! \
+ *     nvqueue max-size-buffers=1000 leaky=downstream ! fakesink
+ * ]|
+ */
+
+#include "gstnvqueue.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_queue_debug);
+#define GST_CAT_DEFAULT gst_nv_queue_debug
+
+#define DEFAULT_MAX_SIZE_BUFFERS 200
+#define DEFAULT_MAX_SIZE_BYTES (10 * 1024 * 1024)
+#define DEFAULT_MAX_SIZE_TIME GST_SECOND
+#define DEFAULT_LEAKY GST_NV_QUEUE_NO_LEAK
+#define DEFAULT_RING_SIZE 1024
+#define DEFAULT_SPIN -1
+
+enum
+{
+  PROP_0,
+  PROP_CUR_LEVEL_BUFFERS,
+  PROP_CUR_LEVEL_BYTES,
+  PROP_CUR_LEVEL_TIME,
+  PROP_MAX_SIZE_BUFFERS,
+  PROP_MAX_SIZE_BYTES,
+  PROP_MAX_SIZE_TIME,
+  PROP_LEAKY,
+  PROP_RING_SIZE,
+  PROP_SPIN,
+};
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+GType
+gst_nv_queue_leaky_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_NV_QUEUE_NO_LEAK, "Not Leaky", "no"},
+    {GST_NV_QUEUE_LEAK_UPSTREAM, "Leaky on upstream (new buffers)",
+        "upstream"},
+    {GST_NV_QUEUE_LEAK_DOWNSTREAM, "Leaky on downstream (old buffers)",
+        "downstream"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = g_enum_register_static ("GstNvQueueLeaky", values);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+#define gst_nv_queue_parent_class parent_class
+G_DEFINE_TYPE (GstNvQueue, gst_nv_queue, GST_TYPE_ELEMENT);
+GST_ELEMENT_REGISTER_DEFINE (nvqueue, "nvqueue", GST_RANK_NONE,
+    GST_TYPE_NV_QUEUE);
+
+static void gst_nv_queue_finalize (GObject * object);
+static void gst_nv_queue_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_queue_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static GstFlowReturn gst_nv_queue_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buffer);
+static gboolean gst_nv_queue_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event);
+static gboolean gst_nv_queue_sink_query (GstPad * pad, GstObject * parent,
+    GstQuery * query);
+static gboolean gst_nv_queue_sink_activate_mode (GstPad * pad,
+    GstObject * parent, GstPadMode mode, gboolean active);
+static gboolean gst_nv_queue_src_activate_mode (GstPad * pad,
+    GstObject * parent, GstPadMode mode, gboolean active);
+static void gst_nv_queue_loop (gpointer user_data);
+
+static void
+gst_nv_queue_class_init (GstNvQueueClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_queue_debug, "nvqueue", 0,
+      "nvqueue element");
+
+  gobject_class->finalize = gst_nv_queue_finalize;
+  gobject_class->set_property = gst_nv_queue_set_property;
+  gobject_class->get_property = gst_nv_queue_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_CUR_LEVEL_BUFFERS,
+      g_param_spec_uint ("current-level-buffers", "Current level (buffers)",
+          "Current number of buffers in the queue",
+          0, G_MAXUINT, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CUR_LEVEL_BYTES,
+      g_param_spec_uint ("current-level-bytes", "Current level (kB)",
+          "Current amount of data in the queue (bytes)",
+          0, G_MAXUINT, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CUR_LEVEL_TIME,
+      g_param_spec_uint64 ("current-level-time", "Current level (ns)",
+          "Current amount of data in the queue (in ns)",
+          0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE_BUFFERS,
+      g_param_spec_uint ("max-size-buffers", "Max. size (buffers)",
+          "Max. number of buffers in the queue (0=disable)",
+          0, G_MAXUINT, DEFAULT_MAX_SIZE_BUFFERS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE_BYTES,
+      g_param_spec_uint ("max-size-bytes", "Max. size (kB)",
+          "Max. amount of data in the queue (bytes, 0=disable)",
+          0, G_MAXUINT, DEFAULT_MAX_SIZE_BYTES,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE_TIME,
+      g_param_spec_uint64 ("max-size-time", "Max. size (ns)",
+          "Max. amount of data in the queue (in ns, 0=disable)",
+          0, G_MAXUINT64, DEFAULT_MAX_SIZE_TIME,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_LEAKY,
+      g_param_spec_enum ("leaky", "Leaky",
+          "Where the queue leaks, if at all",
+          GST_TYPE_NV_QUEUE_LEAKY, DEFAULT_LEAKY,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_RING_SIZE,
+      g_param_spec_uint ("ring-size", "Ring size",
+          "Items the ring holds, events and queries included, rounded up to "
+          "a power of two; caps max-size-buffers (applied when going to "
+          "PAUSED)", 2, 1 << 20, DEFAULT_RING_SIZE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SPIN,
+      g_param_spec_int ("spin", "Spin",
+          "Pause iterations a waiting side spins before sleeping, adapted "
+          "down when spinning does not pay off (-1 = automatic, none on "
+          "single-CPU systems; 0 = always sleep)",
+          -1, 1 << 20, DEFAULT_SPIN,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV queue", "Generic",
+      "Thread boundary like queue over a lock-free single-producer, "
+      "single-consumer ring with spin-then-sleep waiting",
+      "nv_gst_plugins developers");
+
+  gst_type_mark_as_plugin_api (GST_TYPE_NV_QUEUE_LEAKY, (GstPluginAPIFlags) 0);
+}
+
+static void
+gst_nv_queue_init (GstNvQueue * self)
+{
+  nvgst::QueueLimits limits;
+
+  self->sinkpad = gst_pad_new_from_static_template (&sink_template, "sink");
+  gst_pad_set_chain_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_nv_queue_chain));
+  gst_pad_set_event_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_nv_queue_sink_event));
+  gst_pad_set_query_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_nv_queue_sink_query));
+  gst_pad_set_activatemode_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_nv_queue_sink_activate_mode));
+  GST_PAD_SET_PROXY_CAPS (self->sinkpad);
+  gst_element_add_pad (GST_ELEMENT (self), self->sinkpad);
+
+  self->srcpad = gst_pad_new_from_static_template (&src_template, "src");
+  gst_pad_set_activatemode_function (self->srcpad,
+      GST_DEBUG_FUNCPTR (gst_nv_queue_src_activate_mode));
+  GST_PAD_SET_PROXY_CAPS (self->srcpad);
+  gst_element_add_pad (GST_ELEMENT (self), self->srcpad);
+
+  self->leaky = DEFAULT_LEAKY;
+  self->ring_size = DEFAULT_RING_SIZE;
+  self->spin = DEFAULT_SPIN;
+
+  gst_segment_init (&self->sink_segment, GST_FORMAT_TIME);
+  self->eos = FALSE;
+  self->queue = new nvgst::SpscQueue ();
+  limits.buffers = DEFAULT_MAX_SIZE_BUFFERS;
+  limits.bytes = DEFAULT_MAX_SIZE_BYTES;
+  limits.time = DEFAULT_MAX_SIZE_TIME;
+  self->queue->set_limits (limits);
+  self->srcresult = GST_FLOW_FLUSHING;
+  self->head_needs_discont = FALSE;
+
+  g_mutex_init (&self->query_lock);
+  g_cond_init (&self->query_cond);
+  self->last_handled_query = NULL;
+  self->last_query_result = FALSE;
+}
+
+static void
+gst_nv_queue_finalize (GObject * object)
+{
+  GstNvQueue *self = GST_NV_QUEUE (object);
+
+  delete self->queue;
+  g_mutex_clear (&self->query_lock);
+  g_cond_clear (&self->query_cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_queue_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvQueue *self = GST_NV_QUEUE (object);
+  nvgst::QueueLimits limits;
+
+  GST_OBJECT_LOCK (self);
+  limits = self->queue->limits ();
+  switch (prop_id) {
+    case PROP_MAX_SIZE_BUFFERS:
+      limits.buffers = g_value_get_uint (value);
+      self->queue->set_limits (limits);
+      break;
+    case PROP_MAX_SIZE_BYTES:
+      limits.bytes = g_value_get_uint (value);
+      self->queue->set_limits (limits);
+      break;
+    case PROP_MAX_SIZE_TIME:
+      limits.time = g_value_get_uint64 (value);
+      self->queue->set_limits (limits);
+      break;
+    case PROP_LEAKY:
+      /* read without the lock by the chain function */
+      g_atomic_int_set (&self->leaky, g_value_get_enum (value));
+      break;
+    case PROP_RING_SIZE:
+      self->ring_size = g_value_get_uint (value);
+      break;
+    case PROP_SPIN:
+      self->spin = g_value_get_int (value);
+      self->queue->set_spin_limit (self->spin);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_queue_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstNvQueue *self = GST_NV_QUEUE (object);
+  nvgst::QueueLimits limits;
+  nvgst::QueueLevel level;
+
+  GST_OBJECT_LOCK (self);
+  limits = self->queue->limits ();
+  level = self->queue->level ();
+  switch (prop_id) {
+    case PROP_CUR_LEVEL_BUFFERS:
+      g_value_set_uint (value, (guint) level.buffers);
+      break;
+    case PROP_CUR_LEVEL_BYTES:
+      g_value_set_uint (value, (guint) MIN (level.bytes, G_MAXUINT));
+      break;
+    case PROP_CUR_LEVEL_TIME:
+      g_value_set_uint64 (value, level.time);
+      break;
+    case PROP_MAX_SIZE_BUFFERS:
+      g_value_set_uint (value, (guint) limits.buffers);
+      break;
+    case PROP_MAX_SIZE_BYTES:
+      g_value_set_uint (value, (guint) limits.bytes);
+      break;
+    case PROP_MAX_SIZE_TIME:
+      g_value_set_uint64 (value, limits.time);
+      break;
+    case PROP_LEAKY:
+      g_value_set_enum (value, g_atomic_int_get (&self->leaky));
+      break;
+    case PROP_RING_SIZE:
+      g_value_set_uint (value, self->ring_size);
+      break;
+    case PROP_SPIN:
+      g_value_set_int (value, self->spin);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_queue_answer_query (GstNvQueue * self, GstQuery * query,
+    gboolean result)
+{
+  g_mutex_lock (&self->query_lock);
+  self->last_handled_query = query;
+  self->last_query_result = result;
+  g_cond_broadcast (&self->query_cond);
+  g_mutex_unlock (&self->query_lock);
+}
+
+/* Stops both sides with @result, which the chain function then returns,
+ * and wakes a sink thread waiting for a query. */
+static void
+gst_nv_queue_set_flushing (GstNvQueue * self, GstFlowReturn result)
+{
+  g_atomic_int_set (&self->srcresult, result);
+  self->queue->set_flushing (true);
+
+  g_mutex_lock (&self->query_lock);
+  g_cond_broadcast (&self->query_cond);
+  g_mutex_unlock (&self->query_lock);
+}
+
+/* Drops an item that will not be pushed. Queries still belong to the
+ * sink thread waiting for them; sticky events dropped by leaking are kept
+ * on the src pad so they still go out before the next buffer. */
+static void
+gst_nv_queue_drop (GstNvQueue * self, const nvgst::SpscQueue::Item & item,
+    gboolean leaked)
+{
+  GstMiniObject *object = GST_MINI_OBJECT_CAST (item.object);
+
+  if (GST_IS_QUERY (object)) {
+    gst_nv_queue_answer_query (self, GST_QUERY_CAST (object), FALSE);
+    return;
+  }
+  if (leaked && GST_IS_EVENT (object) && GST_EVENT_IS_STICKY (object))
+    gst_pad_store_sticky_event (self->srcpad, GST_EVENT_CAST (object));
+  gst_mini_object_unref (object);
+}
+
+static void
+gst_nv_queue_clear (GstNvQueue * self)
+{
+  self->queue->clear ([self](const nvgst::SpscQueue::Item & item) {
+        gst_nv_queue_drop (self, item, FALSE);
+      });
+  g_atomic_int_set (&self->head_needs_discont, FALSE);
+}
+
+/* Flow return for an item the queue refused. */
+static GstFlowReturn
+gst_nv_queue_refused (GstNvQueue * self)
+{
+  GstFlowReturn ret = (GstFlowReturn) g_atomic_int_get (&self->srcresult);
+
+  return ret == GST_FLOW_OK ? GST_FLOW_FLUSHING : ret;
+}
+
+static gboolean
+gst_nv_queue_src_activate_mode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
+{
+  GstNvQueue *self = GST_NV_QUEUE (parent);
+  gboolean ret;
+  guint ring_size;
+  gint spin;
+
+  if (mode != GST_PAD_MODE_PUSH)
+    return FALSE;
+
+  if (active) {
+    /* src pads are activated before sink pads: nothing streams yet */
+    GST_OBJECT_LOCK (self);
+    ring_size = self->ring_size;
+    spin = self->spin;
+    GST_OBJECT_UNLOCK (self);
+
+    if (!self->queue->init (ring_size)) {
+      GST_ERROR_OBJECT (self, "cannot allocate a ring of %u items", ring_size);
+      return FALSE;
+    }
+    self->queue->set_spin_limit (spin);
+    GST_DEBUG_OBJECT (self, "ring of %" G_GSIZE_FORMAT " items",
+        self->queue->capacity ());
+
+    gst_segment_init (&self->sink_segment, GST_FORMAT_TIME);
+    self->eos = FALSE;
+    g_atomic_int_set (&self->head_needs_discont, FALSE);
+    g_atomic_int_set (&self->srcresult, GST_FLOW_OK);
+    self->queue->set_flushing (false);
+    return gst_pad_start_task (pad, gst_nv_queue_loop, self, NULL);
+  }
+
+  gst_nv_queue_set_flushing (self, GST_FLOW_FLUSHING);
+  ret = gst_pad_stop_task (pad);
+  gst_nv_queue_clear (self);
+  return ret;
+}
+
+static gboolean
+gst_nv_queue_sink_activate_mode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
+{
+  GstNvQueue *self = GST_NV_QUEUE (parent);
+
+  if (mode != GST_PAD_MODE_PUSH)
+    return FALSE;
+
+  if (!active) {
+    /* wait for the chain function to leave, then drop what it queued */
+    gst_nv_queue_set_flushing (self, GST_FLOW_FLUSHING);
+    GST_PAD_STREAM_LOCK (pad);
+    gst_nv_queue_clear (self);
+    GST_PAD_STREAM_UNLOCK (pad);
+  }
+  return TRUE;
+}
+
+/* Running time of @buffer in the sink segment, -1 when unknown. */
+static void
+gst_nv_queue_buffer_times (GstNvQueue * self, GstBuffer * buffer,
+    gint64 * start, gint64 * end)
+{
+  GstClockTime ts = GST_BUFFER_DTS_OR_PTS (buffer);
+  GstClockTime rt;
+
+  *start = *end = -1;
+  if (!GST_CLOCK_TIME_IS_VALID (ts) ||
+      self->sink_segment.format != GST_FORMAT_TIME)
+    return;
+
+  rt = gst_segment_to_running_time (&self->sink_segment, GST_FORMAT_TIME, ts);
+  if (!GST_CLOCK_TIME_IS_VALID (rt))
+    return;
+  *start = (gint64) rt;
+  *end = *start;
+  if (GST_BUFFER_DURATION_IS_VALID (buffer))
+    *end += (gint64) GST_BUFFER_DURATION (buffer);
+}
+
+/* Makes room by dropping the oldest items; waits like an unleaky queue
+ * when only the ring's slots are short. */
+static gboolean
+gst_nv_queue_push_leaky (GstNvQueue * self,
+    const nvgst::SpscQueue::Item & item)
+{
+  nvgst::SpscQueue::Item old;
+
+  while (!self->queue->try_push (item)) {
+    if (self->queue->flushing ())
+      return FALSE;
+    if (!self->queue->try_pop (&old))
+      return self->queue->push (item);
+
+    GST_LOG_OBJECT (self, "queue full, leaking %" GST_PTR_FORMAT,
+        old.object);
+    if (old.counted)
+      g_atomic_int_set (&self->head_needs_discont, TRUE);
+    gst_nv_queue_drop (self, old, TRUE);
+  }
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_nv_queue_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstNvQueue *self = GST_NV_QUEUE (parent);
+  GstFlowReturn ret = (GstFlowReturn) g_atomic_int_get (&self->srcresult);
+  nvgst::SpscQueue::Item item;
+  gboolean queued;
+
+  if (ret != GST_FLOW_OK || self->eos) {
+    gst_buffer_unref (buffer);
+    return ret != GST_FLOW_OK ? ret : GST_FLOW_EOS;
+  }
+
+  item.object = buffer;
+  item.counted = true;
+  item.bytes = gst_buffer_get_size (buffer);
+  gst_nv_queue_buffer_times (self, buffer, &item.start, &item.end);
+
+  switch (g_atomic_int_get (&self->leaky)) {
+    case GST_NV_QUEUE_LEAK_UPSTREAM:
+      queued = self->queue->try_push (item);
+      if (!queued && !self->queue->flushing ()) {
+        GST_LOG_OBJECT (self, "queue full, leaking %" GST_PTR_FORMAT, buffer);
+        gst_buffer_unref (buffer);
+        return GST_FLOW_OK;
+      }
+      break;
+    case GST_NV_QUEUE_LEAK_DOWNSTREAM:
+      queued = gst_nv_queue_push_leaky (self, item);
+      break;
+    default:
+      queued = self->queue->push (item);
+      break;
+  }
+
+  if (!queued) {
+    gst_buffer_unref (buffer);
+    return gst_nv_queue_refused (self);
+  }
+  return GST_FLOW_OK;
+}
+
+static gboolean
+gst_nv_queue_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  GstNvQueue *self = GST_NV_QUEUE (parent);
+  nvgst::SpscQueue::Item item = { event, false, 0, -1, -1 };
+  gboolean ret;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_START:
+      ret = gst_pad_push_event (self->srcpad, event);
+      gst_nv_queue_set_flushing (self, GST_FLOW_FLUSHING);
+      gst_pad_pause_task (self->srcpad);
+      return ret;
+    case GST_EVENT_FLUSH_STOP:
+      gst_nv_queue_clear (self);
+      gst_segment_init (&self->sink_segment, GST_FORMAT_TIME);
+      self->eos = FALSE;
+      ret = gst_pad_push_event (self->srcpad, event);
+      g_atomic_int_set (&self->srcresult, GST_FLOW_OK);
+      self->queue->set_flushing (false);
+      if (GST_PAD_MODE (self->srcpad) == GST_PAD_MODE_PUSH)
+        gst_pad_start_task (self->srcpad, gst_nv_queue_loop, self, NULL);
+      return ret;
+    case GST_EVENT_SEGMENT:
+      gst_event_copy_segment (event, &self->sink_segment);
+      break;
+    case GST_EVENT_EOS:
+      self->eos = TRUE;
+      break;
+    default:
+      break;
+  }
+
+  if (!GST_EVENT_IS_SERIALIZED (event))
+    return gst_pad_push_event (self->srcpad, event);
+
+  if (g_atomic_int_get (&self->srcresult) != GST_FLOW_OK ||
+      !self->queue->push (item)) {
+    GST_DEBUG_OBJECT (self, "not queueing %" GST_PTR_FORMAT ", %s", event,
+        gst_flow_get_name (gst_nv_queue_refused (self)));
+    gst_event_unref (event);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/* Serialized queries travel with the data and are answered by the src
+ * task once everything before them went out. */
+static gboolean
+gst_nv_queue_sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  GstNvQueue *self = GST_NV_QUEUE (parent);
+  nvgst::SpscQueue::Item item = { query, false, 0, -1, -1 };
+  gboolean ret;
+
+  if (!GST_QUERY_IS_SERIALIZED (query))
+    return gst_pad_query_default (pad, parent, query);
+
+  g_mutex_lock (&self->query_lock);
+  self->last_handled_query = NULL;
+  g_mutex_unlock (&self->query_lock);
+
+  if (g_atomic_int_get (&self->srcresult) != GST_FLOW_OK ||
+      !self->queue->push (item))
+    return FALSE;
+
+  g_mutex_lock (&self->query_lock);
+  while (self->last_handled_query != query &&
+      g_atomic_int_get (&self->srcresult) == GST_FLOW_OK)
+    g_cond_wait (&self->query_cond, &self->query_lock);
+  ret = self->last_handled_query == query && self->last_query_result;
+  self->last_handled_query = NULL;
+  g_mutex_unlock (&self->query_lock);
+
+  GST_LOG_OBJECT (self, "%" GST_PTR_FORMAT " answered: %d", query, ret);
+  return ret;
+}
+
+static void
+gst_nv_queue_loop (gpointer user_data)
+{
+  GstNvQueue *self = GST_NV_QUEUE (user_data);
+  GstFlowReturn ret = GST_FLOW_OK;
+  nvgst::SpscQueue::Item item;
+  GstMiniObject *object;
+
+  if (!self->queue->pop (&item)) {
+    GST_DEBUG_OBJECT (self, "flushing, pausing");
+    gst_pad_pause_task (self->srcpad);
+    return;
+  }
+
+  object = GST_MINI_OBJECT_CAST (item.object);
+  if (GST_IS_BUFFER (object)) {
+    GstBuffer *buffer = GST_BUFFER_CAST (object);
+
+    if (g_atomic_int_compare_and_exchange (&self->head_needs_discont, TRUE,
+            FALSE)) {
+      buffer = gst_buffer_make_writable (buffer);
+      GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DISCONT);
+    }
+    ret = gst_pad_push (self->srcpad, buffer);
+  } else if (GST_IS_EVENT (object)) {
+    GstEvent *event = GST_EVENT_CAST (object);
+    gboolean eos = GST_EVENT_TYPE (event) == GST_EVENT_EOS;
+
+    gst_pad_push_event (self->srcpad, event);
+    if (eos)
+      ret = GST_FLOW_EOS;
+  } else {
+    GstQuery *query = GST_QUERY_CAST (object);
+
+    gst_nv_queue_answer_query (self, query,
+        gst_pad_peer_query (self->srcpad, query));
+  }
+
+  if (ret == GST_FLOW_OK)
+    return;
+
+  /* unblocks the chain function, which returns ret from now on */
+  gst_nv_queue_set_flushing (self, ret);
+
+  GST_DEBUG_OBJECT (self, "pausing task, reason %s", gst_flow_get_name (ret));
+  if (ret == GST_FLOW_NOT_LINKED || ret < GST_FLOW_EOS) {
+    GST_ELEMENT_ERROR (self, STREAM, FAILED, ("Internal data stream error."),
+        ("streaming stopped, reason %s", gst_flow_get_name (ret)));
+    gst_pad_push_event (self->srcpad, gst_event_new_eos ());
+  }
+  gst_pad_pause_task (self->srcpad);
+}
@@ -0,0 +1,77 @@
+#ifndef __GST_NV_QUEUE_H__
+#define __GST_NV_QUEUE_H__
+
+#include <gst/gst.h>
+
+#include "core/spsc_queue.h"
+
+G_BEGIN_DECLS
+
+/* Same values and nicks as GstQueueLeaky, so launch lines carry over. */
+typedef enum {
+  GST_NV_QUEUE_NO_LEAK,
+  GST_NV_QUEUE_LEAK_UPSTREAM,
+  GST_NV_QUEUE_LEAK_DOWNSTREAM,
+} GstNvQueueLeaky;
+
+#define GST_TYPE_NV_QUEUE_LEAKY (gst_nv_queue_leaky_get_type ())
+GType gst_nv_queue_leaky_get_type (void);
+
+#define GST_TYPE_NV_QUEUE \
+  (gst_nv_queue_get_type())
+#define GST_NV_QUEUE(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_QUEUE,GstNvQueue))
+#define GST_NV_QUEUE_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_QUEUE,GstNvQueueClass))
+#define GST_IS_NV_QUEUE(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_QUEUE))
+
+typedef struct _GstNvQueue GstNvQueue;
+typedef struct _GstNvQueueClass GstNvQueueClass;
+
+struct _GstNvQueue
+{
+  GstElement parent;
+
+  GstPad *sinkpad;
+  GstPad *srcpad;
+
+  /* properties, protected by the object lock; the size limits live in
+   * the queue */
+  guint ring_size;
+  gint spin;
+  /* GstNvQueueLeaky, atomic: the chain function reads it without the
+   * lock */
+  gint leaky;
+
+  /* sink streaming thread only */
+  GstSegment sink_segment;
+  gboolean eos;
+
+  /* both threads */
+  nvgst::SpscQueue *queue;
+  /* GstFlowReturn of the src task, atomic */
+  gint srcresult;
+  /* set when leaky=downstream dropped buffers, atomic */
+  gint head_needs_discont;
+
+  /* serialized queries wait on the sink thread until the src task
+   * answered them, protected by query_lock */
+  GMutex query_lock;
+  GCond query_cond;
+  GstQuery *last_handled_query;
+  gboolean last_query_result;
+};
+
+struct _GstNvQueueClass
+{
+  GstElementClass parent_class;
+};
+
+GType gst_nv_queue_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvqueue);
+
+G_END_DECLS
+
+#endif /* __GST_NV_QUEUE_H__ */
@@ -0,0 +1,667 @@
+/**
+ * SECTION:element-nvrecord
+ *
+ * Event-triggered recording of an encoded stream. The element keeps the
+ * last #GstNvRecord:pre-event-time of buffers in a ring of whole GOPs; on
+ * a trigger it opens the next file of #GstNvRecord:location at the
+ * keyframe before the event and writes until
+ * #GstNvRecord:post-event-time after the last trigger. Triggers during a
+ * recording extend it.
+ *
+ * A recording starts with emitting the "trigger" action signal, or on
+ * buffers whose #GstNvMotionMeta reports motion
+ * (#GstNvRecord:trigger-on-motion) or whose #GstNvObjectMeta holds a
+ * detection of #GstNvRecord:trigger-classes; metas only reach the element
+ * through encoders that keep them.
+ *
+ * Files hold the caps' stream headers followed by the buffers as they are,
+ * so the stream must be self-contained: a byte-stream with in-band
+ * parameter sets (h264parse config-interval=-1) or a streamable container
+ * such as MPEG-TS. Buffers without the DELTA_UNIT flag are keyframes.
+ *
+ * Writing happens on a thread of its own through io_uring, or pwritev()
+ * where the kernel does not allow io_uring, so a slow disk never blocks
+ * the streaming thread. When more than #GstNvRecord:max-backlog-bytes are
+ * waiting for the disk, buffers are dropped from the recording up to the
+ * next keyframe and counted in #GstNvRecord:dropped.
+ *
+ * The element posts an element message "nvrecord-started" with the
+ * location and running time of the first buffer when a file is opened,
+ * and "nvrecord-done" with the location and size once it is closed.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 rtspsrc location=rtsp://camera/stream ! rtph264depay ! \
+ *     h264parse config-interval=-1 ! mpegtsmux ! \
+ *     nvrecord location=event%05d.ts pre-event-time=5000000000 \
+ *     post-event-time=10000000000 trigger-on-motion=true
+ * ]|
+ */
+
+#include "gstnvrecord.h"
+
+#include "gstnvmotionmeta.h"
+#include "gstnvobjectmeta.h"
+#include "gstnvutils.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_record_debug);
+#define GST_CAT_DEFAULT gst_nv_record_debug
+
+#define DEFAULT_LOCATION "record%05d.ts"
+#define DEFAULT_PRE_EVENT_TIME (5 * GST_SECOND)
+#define DEFAULT_POST_EVENT_TIME (10 * GST_SECOND)
+#define DEFAULT_TRIGGER_ON_MOTION FALSE
+#define DEFAULT_MAX_RING_BYTES (64 * 1024 * 1024)
+#define DEFAULT_MAX_BACKLOG_BYTES (32 * 1024 * 1024)
+
+enum
+{
+  PROP_0,
+  PROP_LOCATION,
+  PROP_PRE_EVENT_TIME,
+  PROP_POST_EVENT_TIME,
+  PROP_TRIGGER_ON_MOTION,
+  PROP_TRIGGER_CLASSES,
+  PROP_MAX_RING_BYTES,
+  PROP_MAX_BACKLOG_BYTES,
+  PROP_RECORDING,
+  PROP_DROPPED,
+};
+
+enum
+{
+  SIGNAL_TRIGGER,
+  LAST_SIGNAL,
+};
+
+static guint gst_nv_record_signals[LAST_SIGNAL];
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+/* A mapped buffer handed to the writer. */
+typedef struct
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+} GstNvRecordChunk;
+
+static void
+gst_nv_record_release_buffer (void *token)
+{
+  gst_buffer_unref (GST_BUFFER_CAST (token));
+}
+
+static void
+gst_nv_record_release_chunk (void *token)
+{
+  GstNvRecordChunk *chunk = (GstNvRecordChunk *) token;
+
+  gst_buffer_unmap (chunk->buffer, &chunk->map);
+  gst_buffer_unref (chunk->buffer);
+  g_free (chunk);
+}
+
+#define gst_nv_record_parent_class parent_class
+G_DEFINE_TYPE (GstNvRecord, gst_nv_record, GST_TYPE_BASE_SINK);
+GST_ELEMENT_REGISTER_DEFINE (nvrecord, "nvrecord", GST_RANK_NONE,
+    GST_TYPE_NV_RECORD);
+
+static void gst_nv_record_finalize (GObject * object);
+static void gst_nv_record_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_record_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static gboolean gst_nv_record_start (GstBaseSink * sink);
+static gboolean gst_nv_record_stop (GstBaseSink * sink);
+static gboolean gst_nv_record_set_caps (GstBaseSink * sink, GstCaps * caps);
+static gboolean gst_nv_record_event (GstBaseSink * sink, GstEvent * event);
+static GstFlowReturn gst_nv_record_render (GstBaseSink * sink,
+    GstBuffer * buffer);
+static void gst_nv_record_trigger (GstNvRecord * self);
+static void gst_nv_record_finish (GstNvRecord * self);
+
+static void
+gst_nv_record_class_init (GstNvRecordClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseSinkClass *base_sink_class = GST_BASE_SINK_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_record_debug, "nvrecord", 0,
+      "nvrecord element");
+
+  gobject_class->finalize = gst_nv_record_finalize;
+  gobject_class->set_property = gst_nv_record_set_property;
+  gobject_class->get_property = gst_nv_record_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_LOCATION,
+      g_param_spec_string ("location", "Location",
+          "Path pattern of the recordings, formatted with the file index "
+          "(e.g. event%05d.ts)", DEFAULT_LOCATION,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_PRE_EVENT_TIME,
+      g_param_spec_uint64 ("pre-event-time", "Pre-event time",
+          "Stream kept before a trigger, in ns; a recording starts at the "
+          "keyframe at or before this much earlier", 0, G_MAXUINT64,
+          DEFAULT_PRE_EVENT_TIME,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_POST_EVENT_TIME,
+      g_param_spec_uint64 ("post-event-time", "Post-event time",
+          "Stream recorded after the last trigger, in ns", 0, G_MAXUINT64,
+          DEFAULT_POST_EVENT_TIME,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_TRIGGER_ON_MOTION,
+      g_param_spec_boolean ("trigger-on-motion", "Trigger on motion",
+          "Trigger on buffers whose GstNvMotionMeta reports motion",
+          DEFAULT_TRIGGER_ON_MOTION,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_TRIGGER_CLASSES,
+      g_param_spec_string ("trigger-classes", "Trigger classes",
+          "Comma-separated class ids whose detections in GstNvObjectMeta "
+          "trigger (empty = none)", NULL,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_RING_BYTES,
+      g_param_spec_uint64 ("max-ring-bytes", "Max ring bytes",
+          "Bytes kept before a trigger at most (0 = unlimited); the GOP "
+          "being received is always kept", 0, G_MAXUINT64,
+          DEFAULT_MAX_RING_BYTES,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_BACKLOG_BYTES,
+      g_param_spec_uint64 ("max-backlog-bytes", "Max backlog bytes",
+          "Bytes waiting for the disk before buffers are dropped from the "
+          "recording (0 = unlimited)", 0, G_MAXUINT64,
+          DEFAULT_MAX_BACKLOG_BYTES,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_RECORDING,
+      g_param_spec_boolean ("recording", "Recording",
+          "A trigger is being recorded", FALSE,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_DROPPED,
+      g_param_spec_uint64 ("dropped", "Dropped",
+          "Buffers left out of recordings because the disk fell behind", 0,
+          G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  /**
+   * GstNvRecord::trigger:
+   *
+   * Starts a recording, or extends the current one, as if an event
+   * happened at the next buffer. Safe to emit from any thread.
+   */
+  gst_nv_record_signals[SIGNAL_TRIGGER] =
+      g_signal_new ("trigger", G_TYPE_FROM_CLASS (klass),
+      (GSignalFlags) (G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION),
+      G_STRUCT_OFFSET (GstNvRecordClass, trigger), NULL, NULL, NULL,
+      G_TYPE_NONE, 0);
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV event recorder", "Sink/File",
+      "Records encoded streams around events, with a pre-event keyframe "
+      "ring and asynchronous file writes", "nv_gst_plugins developers");
+
+  base_sink_class->start = GST_DEBUG_FUNCPTR (gst_nv_record_start);
+  base_sink_class->stop = GST_DEBUG_FUNCPTR (gst_nv_record_stop);
+  base_sink_class->set_caps = GST_DEBUG_FUNCPTR (gst_nv_record_set_caps);
+  base_sink_class->event = GST_DEBUG_FUNCPTR (gst_nv_record_event);
+  base_sink_class->render = GST_DEBUG_FUNCPTR (gst_nv_record_render);
+
+  klass->trigger = gst_nv_record_trigger;
+}
+
+static void
+gst_nv_record_init (GstNvRecord * self)
+{
+  self->location = g_strdup (DEFAULT_LOCATION);
+  self->pre_event_time = DEFAULT_PRE_EVENT_TIME;
+  self->post_event_time = DEFAULT_POST_EVENT_TIME;
+  self->trigger_on_motion = DEFAULT_TRIGGER_ON_MOTION;
+  self->trigger_classes = NULL;
+  self->max_ring_bytes = DEFAULT_MAX_RING_BYTES;
+  self->max_backlog_bytes = DEFAULT_MAX_BACKLOG_BYTES;
+  self->reconfigure = TRUE;
+  self->class_ids = new std::vector < gint > ();
+
+  /* recording is about the stream, not its presentation */
+  gst_base_sink_set_sync (GST_BASE_SINK (self), FALSE);
+}
+
+static void
+gst_nv_record_finalize (GObject * object)
+{
+  GstNvRecord *self = GST_NV_RECORD (object);
+
+  g_free (self->location);
+  g_free (self->trigger_classes);
+  delete self->class_ids;
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_record_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvRecord *self = GST_NV_RECORD (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_LOCATION:
+      g_free (self->location);
+      self->location = g_value_dup_string (value);
+      break;
+    case PROP_PRE_EVENT_TIME:
+      self->pre_event_time = g_value_get_uint64 (value);
+      break;
+    case PROP_POST_EVENT_TIME:
+      self->post_event_time = g_value_get_uint64 (value);
+      break;
+    case PROP_TRIGGER_ON_MOTION:
+      self->trigger_on_motion = g_value_get_boolean (value);
+      break;
+    case PROP_TRIGGER_CLASSES:
+      g_free (self->trigger_classes);
+      self->trigger_classes = g_value_dup_string (value);
+      break;
+    case PROP_MAX_RING_BYTES:
+      self->max_ring_bytes = g_value_get_uint64 (value);
+      break;
+    case PROP_MAX_BACKLOG_BYTES:
+      self->max_backlog_bytes = g_value_get_uint64 (value);
+      break;
+    default:
+      GST_OBJECT_UNLOCK (self);
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      return;
+  }
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_record_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstNvRecord *self = GST_NV_RECORD (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_LOCATION:
+      g_value_set_string (value, self->location);
+      break;
+    case PROP_PRE_EVENT_TIME:
+      g_value_set_uint64 (value, self->pre_event_time);
+      break;
+    case PROP_POST_EVENT_TIME:
+      g_value_set_uint64 (value, self->post_event_time);
+      break;
+    case PROP_TRIGGER_ON_MOTION:
+      g_value_set_boolean (value, self->trigger_on_motion);
+      break;
+    case PROP_TRIGGER_CLASSES:
+      g_value_set_string (value, self->trigger_classes);
+      break;
+    case PROP_MAX_RING_BYTES:
+      g_value_set_uint64 (value, self->max_ring_bytes);
+      break;
+    case PROP_MAX_BACKLOG_BYTES:
+      g_value_set_uint64 (value, self->max_backlog_bytes);
+      break;
+    case PROP_RECORDING:
+      g_value_set_boolean (value, self->recording);
+      break;
+    case PROP_DROPPED:
+      g_value_set_uint64 (value, self->dropped);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_record_trigger (GstNvRecord * self)
+{
+  GST_DEBUG_OBJECT (self, "triggered");
+  g_atomic_int_set (&self->pending_trigger, TRUE);
+}
+
+/* Writer thread: a file is complete. */
+static void
+gst_nv_record_file_done (GstNvRecord * self,
+    const nvgst::RecordWriter::FileResult & result)
+{
+  GstStructure *s;
+
+  if (result.error != 0) {
+    GST_ELEMENT_WARNING (self, RESOURCE, WRITE,
+        ("Could not write recording %s", result.path.c_str ()),
+        ("%s", g_strerror (result.error)));
+  }
+  GST_INFO_OBJECT (self, "closed %s, %" G_GUINT64_FORMAT " bytes",
+      result.path.c_str (), result.bytes);
+
+  s = gst_structure_new ("nvrecord-done",
+      "location", G_TYPE_STRING, result.path.c_str (),
+      "bytes", G_TYPE_UINT64, (guint64) result.bytes, NULL);
+  gst_element_post_message (GST_ELEMENT (self),
+      gst_message_new_element (GST_OBJECT (self), s));
+}
+
+static gboolean
+gst_nv_record_start (GstBaseSink * sink)
+{
+  GstNvRecord *self = GST_NV_RECORD (sink);
+
+  self->ring = new nvgst::PreEventRing (gst_nv_record_release_buffer);
+  self->writer = new nvgst::RecordWriter (gst_nv_record_release_chunk);
+  self->writer->start ([self] (const nvgst::RecordWriter::FileResult & r) {
+        gst_nv_record_file_done (self, r);
+      });
+  GST_INFO_OBJECT (self, "writing through %s",
+      self->writer->uring () ? "io_uring" : "pwritev");
+
+  GST_OBJECT_LOCK (self);
+  self->reconfigure = TRUE;
+  self->recording = FALSE;
+  self->dropped = 0;
+  GST_OBJECT_UNLOCK (self);
+
+  g_atomic_int_set (&self->pending_trigger, FALSE);
+  self->active = FALSE;
+  self->starting = FALSE;
+  self->skipping = FALSE;
+  return TRUE;
+}
+
+static gboolean
+gst_nv_record_stop (GstBaseSink * sink)
+{
+  GstNvRecord *self = GST_NV_RECORD (sink);
+
+  gst_nv_record_finish (self);
+  /* writes out and closes what is queued */
+  delete self->writer;
+  self->writer = NULL;
+  delete self->ring;
+  self->ring = NULL;
+
+  if (self->headers) {
+    gst_buffer_list_unref (self->headers);
+    self->headers = NULL;
+  }
+  return TRUE;
+}
+
+/* Keeps the caps' stream headers for the start of every file. */
+static gboolean
+gst_nv_record_set_caps (GstBaseSink * sink, GstCaps * caps)
+{
+  GstNvRecord *self = GST_NV_RECORD (sink);
+  GstStructure *s = gst_caps_get_structure (caps, 0);
+  const GValue *headers = gst_structure_get_value (s, "streamheader");
+
+  if (self->headers) {
+    gst_buffer_list_unref (self->headers);
+    self->headers = NULL;
+  }
+  if (headers == NULL || !GST_VALUE_HOLDS_ARRAY (headers))
+    return TRUE;
+
+  self->headers = gst_buffer_list_new ();
+  for (guint i = 0; i < gst_value_array_get_size (headers); i++) {
+    const GValue *header = gst_value_array_get_value (headers, i);
+
+    if (G_VALUE_HOLDS (header, GST_TYPE_BUFFER))
+      gst_buffer_list_add (self->headers,
+          gst_buffer_ref (gst_value_get_buffer (header)));
+  }
+  GST_DEBUG_OBJECT (self, "%u stream headers",
+      gst_buffer_list_length (self->headers));
+  return TRUE;
+}
+
+static gboolean
+gst_nv_record_event (GstBaseSink * sink, GstEvent * event)
+{
+  GstNvRecord *self = GST_NV_RECORD (sink);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_EOS:
+      gst_nv_record_finish (self);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      /* running times start over */
+      gst_nv_record_finish (self);
+      self->ring->clear ();
+      break;
+    default:
+      break;
+  }
+  return GST_BASE_SINK_CLASS (parent_class)->event (sink, event);
+}
+
+static void
+gst_nv_record_apply_config (GstNvRecord * self)
+{
+  gboolean parsed;
+
+  GST_OBJECT_LOCK (self);
+  if (!self->reconfigure) {
+    GST_OBJECT_UNLOCK (self);
+    return;
+  }
+  self->pre_event = self->pre_event_time;
+  self->post_event = self->post_event_time;
+  self->motion = self->trigger_on_motion;
+  parsed = gst_nv_parse_class_ids (self->trigger_classes, self->class_ids);
+  self->ring->set_limits ((int64_t) MIN (self->pre_event_time,
+          (guint64) G_MAXINT64), self->max_ring_bytes);
+  self->writer->set_max_backlog (self->max_backlog_bytes);
+  self->reconfigure = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  if (!parsed) {
+    GST_WARNING_OBJECT (self, "trigger-classes must look like \"0,2,7\"");
+    self->class_ids->clear ();
+  }
+}
+
+static void
+gst_nv_record_set_recording (GstNvRecord * self, gboolean recording)
+{
+  GST_OBJECT_LOCK (self);
+  self->recording = recording;
+  GST_OBJECT_UNLOCK (self);
+}
+
+/* Ends the current recording, or a trigger still waiting for a keyframe. */
+static void
+gst_nv_record_finish (GstNvRecord * self)
+{
+  if (self->active) {
+    GST_DEBUG_OBJECT (self, "recording ends");
+    self->writer->close ();
+  }
+  if (self->active || self->starting)
+    gst_nv_record_set_recording (self, FALSE);
+  self->active = FALSE;
+  self->starting = FALSE;
+  self->skipping = FALSE;
+}
+
+static gboolean
+gst_nv_record_write (GstNvRecord * self, GstBuffer * buffer)
+{
+  GstNvRecordChunk *chunk = g_new (GstNvRecordChunk, 1);
+
+  if (!gst_buffer_map (buffer, &chunk->map, GST_MAP_READ)) {
+    g_free (chunk);
+    return FALSE;
+  }
+  chunk->buffer = gst_buffer_ref (buffer);
+  if (self->writer->write ({chunk->map.data, chunk->map.size, chunk}))
+    return TRUE;
+
+  gst_nv_record_release_chunk (chunk);
+  return FALSE;
+}
+
+/* Adds a buffer to the recording unless the writer fell behind, in which
+ * case the rest of the GOP goes too. */
+static void
+gst_nv_record_append (GstNvRecord * self, GstBuffer * buffer,
+    gboolean keyframe)
+{
+  if (self->skipping && keyframe)
+    self->skipping = FALSE;
+  if (!self->skipping && gst_nv_record_write (self, buffer))
+    return;
+
+  if (!self->skipping)
+    GST_WARNING_OBJECT (self, "disk fell behind by %" G_GUINT64_FORMAT
+        " bytes, dropping up to the next keyframe", self->writer->backlog ());
+  self->skipping = TRUE;
+  GST_OBJECT_LOCK (self);
+  self->dropped++;
+  GST_OBJECT_UNLOCK (self);
+}
+
+/* Opens the next file at the keyframe before the event and writes the
+ * ring from there; FALSE while the ring has no keyframe yet. */
+static gboolean
+gst_nv_record_begin (GstNvRecord * self)
+{
+  nvgst::PreEventRing & ring = *self->ring;
+  GstClockTime from;
+  gchar *location;
+  guint index;
+  long first;
+
+  from = self->event_time > self->pre_event ?
+      self->event_time - self->pre_event : 0;
+  first = ring.find_keyframe ((int64_t) from);
+  if (first < 0)
+    return FALSE;
+
+  GST_OBJECT_LOCK (self);
+  index = self->next_file++;
+  location = g_strdup_printf (self->location, index);
+  GST_OBJECT_UNLOCK (self);
+
+  GST_INFO_OBJECT (self, "recording to %s from %" GST_TIME_FORMAT, location,
+      GST_TIME_ARGS (ring[first].time));
+  self->writer->open (index, location);
+  self->active = TRUE;
+  self->skipping = FALSE;
+
+  if (self->headers) {
+    for (guint i = 0; i < gst_buffer_list_length (self->headers); i++)
+      gst_nv_record_append (self, gst_buffer_list_get (self->headers, i),
+          TRUE);
+  }
+  for (size_t i = first; i < ring.size (); i++)
+    gst_nv_record_append (self, GST_BUFFER_CAST (ring[i].token),
+        ring[i].keyframe);
+
+  gst_element_post_message (GST_ELEMENT (self),
+      gst_message_new_element (GST_OBJECT (self),
+          gst_structure_new ("nvrecord-started",
+              "location", G_TYPE_STRING, location,
+              "running-time", G_TYPE_UINT64, (guint64) ring[first].time,
+              NULL)));
+  g_free (location);
+  return TRUE;
+}
+
+static gboolean
+gst_nv_record_meta_triggers (GstNvRecord * self, GstBuffer * buffer)
+{
+  if (self->motion) {
+    GstNvMotionMeta *motion = gst_buffer_get_nv_motion_meta (buffer);
+
+    for (guint i = 0; motion && i < motion->n_frames; i++) {
+      if (motion->frames[i].moving)
+        return TRUE;
+    }
+  }
+  if (!self->class_ids->empty ()) {
+    GstNvObjectMeta *meta = gst_buffer_get_nv_object_meta (buffer);
+
+    if (meta == NULL)
+      return FALSE;
+    for (const nvgst::DetectedObject & object : *meta->objects) {
+      if (std::find (self->class_ids->begin (), self->class_ids->end (),
+              object.class_id) != self->class_ids->end ())
+        return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+static GstFlowReturn
+gst_nv_record_render (GstBaseSink * sink, GstBuffer * buffer)
+{
+  GstNvRecord *self = GST_NV_RECORD (sink);
+  gboolean keyframe =
+      !GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+  GstClockTime ts = GST_BUFFER_PTS_IS_VALID (buffer) ?
+      GST_BUFFER_PTS (buffer) : GST_BUFFER_DTS (buffer);
+  GstClockTime time = GST_CLOCK_TIME_NONE;
+  gboolean triggered;
+
+  gst_nv_record_apply_config (self);
+
+  if (GST_CLOCK_TIME_IS_VALID (ts))
+    time = gst_segment_to_running_time (&sink->segment, GST_FORMAT_TIME, ts);
+
+  /* the event window is over */
+  if ((self->active || self->starting) && GST_CLOCK_TIME_IS_VALID (time)
+      && time >= self->stop_time)
+    gst_nv_record_finish (self);
+
+  self->ring->push ({gst_buffer_ref (buffer),
+          GST_CLOCK_TIME_IS_VALID (time) ? (int64_t) time : -1,
+          gst_buffer_get_size (buffer), keyframe != FALSE});
+
+  triggered =
+      g_atomic_int_compare_and_exchange (&self->pending_trigger, TRUE, FALSE);
+  if (!triggered)
+    triggered = gst_nv_record_meta_triggers (self, buffer);
+
+  if (triggered && !GST_CLOCK_TIME_IS_VALID (time)) {
+    GST_WARNING_OBJECT (self, "ignoring a trigger on a buffer without "
+        "timestamps");
+  } else if (triggered) {
+    if (self->active || self->starting) {
+      self->stop_time = MAX (self->stop_time, time + self->post_event);
+    } else {
+      self->starting = TRUE;
+      self->event_time = time;
+      self->stop_time = time + self->post_event;
+      gst_nv_record_set_recording (self, TRUE);
+    }
+  }
+
+  if (self->starting) {
+    /* includes this buffer */
+    if (gst_nv_record_begin (self))
+      self->starting = FALSE;
+  } else if (self->active) {
+    gst_nv_record_append (self, buffer, keyframe);
+  }
+
+  return GST_FLOW_OK;
+}
@@ -0,0 +1,79 @@
+#ifndef __GST_NV_RECORD_H__
+#define __GST_NV_RECORD_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasesink.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "core/record.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_NV_RECORD \
+  (gst_nv_record_get_type())
+#define GST_NV_RECORD(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_RECORD,GstNvRecord))
+#define GST_NV_RECORD_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_RECORD,GstNvRecordClass))
+#define GST_IS_NV_RECORD(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_RECORD))
+
+typedef struct _GstNvRecord GstNvRecord;
+typedef struct _GstNvRecordClass GstNvRecordClass;
+
+struct _GstNvRecord
+{
+  GstBaseSink parent;
+
+  /* properties, protected by the object lock */
+  gchar *location;
+  guint64 pre_event_time;
+  guint64 post_event_time;
+  gboolean trigger_on_motion;
+  gchar *trigger_classes;
+  guint64 max_ring_bytes;
+  guint64 max_backlog_bytes;
+  gboolean recording;
+  guint64 dropped;
+  guint next_file;
+  gboolean reconfigure;
+
+  /* set by the trigger action from any thread, atomic */
+  gint pending_trigger;
+
+  /* between start() and stop() */
+  nvgst::PreEventRing *ring;
+  nvgst::RecordWriter *writer;
+
+  /* streaming thread only */
+  GstBufferList *headers;
+  std::vector < gint > *class_ids;
+  gboolean motion;
+  GstClockTime pre_event;
+  GstClockTime post_event;
+  /* a file is open, or a trigger waits for the first keyframe */
+  gboolean active;
+  gboolean starting;
+  GstClockTime event_time;
+  GstClockTime stop_time;
+  /* the writer fell behind; nothing is written until the next keyframe */
+  gboolean skipping;
+};
+
+struct _GstNvRecordClass
+{
+  GstBaseSinkClass parent_class;
+
+  /* actions */
+  void (*trigger) (GstNvRecord * record);
+};
+
+GType gst_nv_record_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvrecord);
+
+G_END_DECLS
+
+#endif /* __GST_NV_RECORD_H__ */
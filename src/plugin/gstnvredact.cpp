@@ -0,0 +1,469 @@
+/**
+ * SECTION:element-nvredact
+ *
+ * Masks the objects of a #GstNvObjectMeta, typically faces and licence
+ * plates, by pixelating, blurring or filling their boxes in place.
+ *
+ * Only the pixels inside the boxes are read and written: block and window
+ * means come from a summed-area table built over each box (grown by the
+ * blur radius), filled and read with SIMD kernels, so the cost follows the
+ * masked area rather than the frame size and no frame is copied. Several
+ * blur #GstNvRedact:passes approach a Gaussian. Pixelation blocks are
+ * aligned to the frame, so they do not shimmer as boxes move.
+ *
+ * Works on single frames and on nvbatchmux batches. Buffers without
+ * objects pass through untouched; others are redacted in place when
+ * writable, which they are when they come from a buffer pool nothing else
+ * holds.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 filesrc location=street.mp4 ! decodebin ! nvconvert ! \
+ *     video/x-raw,format=NV12 ! nvinfer ! nvpostprocess ! nvtracker ! \
+ *     nvredact classes=0,1 mode=blur radius=12 passes=3 ! x264enc ! \
+ *     mp4mux ! filesink location=redacted.mp4
+ * ]|
+ */
+
+#include "gstnvredact.h"
+#include "gstnvbatchmeta.h"
+#include "gstnvobjectmeta.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_redact_debug);
+#define GST_CAT_DEFAULT gst_nv_redact_debug
+
+#define DEFAULT_MODE GST_NV_REDACT_PIXELATE
+#define DEFAULT_BLOCK_SIZE 16
+#define DEFAULT_RADIUS 8
+#define DEFAULT_PASSES 1
+#define DEFAULT_SIMD GST_NV_SIMD_LEVEL_AUTO
+
+enum
+{
+  PROP_0,
+  PROP_MODE,
+  PROP_BLOCK_SIZE,
+  PROP_RADIUS,
+  PROP_PASSES,
+  PROP_CLASSES,
+  PROP_SIMD,
+};
+
+#define NV_REDACT_FORMATS "{ NV12, I420, RGBA, BGRx }"
+
+#define NV_REDACT_CAPS \
+  GST_VIDEO_CAPS_MAKE (NV_REDACT_FORMATS) "; " \
+  GST_NV_BATCH_CAPS_MAKE (NV_REDACT_FORMATS)
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_REDACT_CAPS));
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_REDACT_CAPS));
+
+GType
+gst_nv_redact_mode_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_NV_REDACT_PIXELATE, "Replace blocks by their mean", "pixelate"},
+    {GST_NV_REDACT_BLUR, "Box blur, repeated passes times", "blur"},
+    {GST_NV_REDACT_FILL, "Fill with black", "fill"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = g_enum_register_static ("GstNvRedactMode", values);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+#define gst_nv_redact_parent_class parent_class
+G_DEFINE_TYPE (GstNvRedact, gst_nv_redact, GST_TYPE_BASE_TRANSFORM);
+GST_ELEMENT_REGISTER_DEFINE (nvredact, "nvredact", GST_RANK_NONE,
+    GST_TYPE_NV_REDACT);
+
+static void gst_nv_redact_finalize (GObject * object);
+static void gst_nv_redact_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_redact_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static gboolean gst_nv_redact_set_caps (GstBaseTransform * trans,
+    GstCaps * incaps, GstCaps * outcaps);
+static GstFlowReturn gst_nv_redact_prepare_output_buffer (GstBaseTransform *
+    trans, GstBuffer * input, GstBuffer ** outbuf);
+static GstFlowReturn gst_nv_redact_transform_ip (GstBaseTransform * trans,
+    GstBuffer * buffer);
+
+static void
+gst_nv_redact_class_init (GstNvRedactClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_redact_debug, "nvredact", 0,
+      "nvredact element");
+
+  gobject_class->finalize = gst_nv_redact_finalize;
+  gobject_class->set_property = gst_nv_redact_set_property;
+  gobject_class->get_property = gst_nv_redact_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_MODE,
+      g_param_spec_enum ("mode", "Mode", "How boxes are masked",
+          GST_TYPE_NV_REDACT_MODE, DEFAULT_MODE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_BLOCK_SIZE,
+      g_param_spec_uint ("block-size", "Block size",
+          "Side of the pixelation blocks in pixels, rounded up to even on "
+          "NV12 and I420", 1, 4096, DEFAULT_BLOCK_SIZE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_RADIUS,
+      g_param_spec_uint ("radius", "Radius",
+          "Blur radius in pixels; the window is 2 * radius + 1 wide",
+          1, 255, DEFAULT_RADIUS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_PASSES,
+      g_param_spec_uint ("passes", "Passes",
+          "Box blur passes; 3 is close to a Gaussian blur", 1, 3,
+          DEFAULT_PASSES,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CLASSES,
+      g_param_spec_string ("classes", "Classes",
+          "Comma-separated class ids of the objects to mask (all when unset)",
+          NULL, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SIMD,
+      g_param_spec_enum ("simd", "SIMD",
+          "Highest SIMD level to use, capped at what the CPU supports",
+          GST_TYPE_NV_SIMD_LEVEL, DEFAULT_SIMD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV redaction", "Filter/Effect/Video",
+      "Pixelates, blurs or fills object boxes in place, with SIMD "
+      "summed-area tables so the cost follows the masked area",
+      "nv_gst_plugins developers");
+
+  trans_class->set_caps = GST_DEBUG_FUNCPTR (gst_nv_redact_set_caps);
+  trans_class->prepare_output_buffer =
+      GST_DEBUG_FUNCPTR (gst_nv_redact_prepare_output_buffer);
+  trans_class->transform_ip = GST_DEBUG_FUNCPTR (gst_nv_redact_transform_ip);
+  trans_class->passthrough_on_same_caps = FALSE;
+
+  gst_type_mark_as_plugin_api (GST_TYPE_NV_REDACT_MODE,
+      (GstPluginAPIFlags) 0);
+}
+
+static void
+gst_nv_redact_init (GstNvRedact * self)
+{
+  self->mode = DEFAULT_MODE;
+  self->block_size = DEFAULT_BLOCK_SIZE;
+  self->radius = DEFAULT_RADIUS;
+  self->passes = DEFAULT_PASSES;
+  self->classes = NULL;
+  self->simd = DEFAULT_SIMD;
+  self->reconfigure = TRUE;
+  self->batched = FALSE;
+  self->class_ids = new std::vector < gint > ();
+  self->redactor = new nvgst::Redactor ();
+  self->rects = new std::vector < nvgst::RedactRect > ();
+
+  gst_base_transform_set_in_place (GST_BASE_TRANSFORM (self), TRUE);
+}
+
+static void
+gst_nv_redact_finalize (GObject * object)
+{
+  GstNvRedact *self = GST_NV_REDACT (object);
+
+  delete self->rects;
+  delete self->redactor;
+  delete self->class_ids;
+  g_free (self->classes);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_redact_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvRedact *self = GST_NV_REDACT (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_MODE:
+      self->mode = (GstNvRedactMode) g_value_get_enum (value);
+      break;
+    case PROP_BLOCK_SIZE:
+      self->block_size = g_value_get_uint (value);
+      break;
+    case PROP_RADIUS:
+      self->radius = g_value_get_uint (value);
+      break;
+    case PROP_PASSES:
+      self->passes = g_value_get_uint (value);
+      break;
+    case PROP_CLASSES:
+      g_free (self->classes);
+      self->classes = g_value_dup_string (value);
+      break;
+    case PROP_SIMD:
+      self->simd = (GstNvSimdLevel) g_value_get_enum (value);
+      break;
+    default:
+      GST_OBJECT_UNLOCK (self);
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      return;
+  }
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_redact_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstNvRedact *self = GST_NV_REDACT (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_MODE:
+      g_value_set_enum (value, self->mode);
+      break;
+    case PROP_BLOCK_SIZE:
+      g_value_set_uint (value, self->block_size);
+      break;
+    case PROP_RADIUS:
+      g_value_set_uint (value, self->radius);
+      break;
+    case PROP_PASSES:
+      g_value_set_uint (value, self->passes);
+      break;
+    case PROP_CLASSES:
+      g_value_set_string (value, self->classes);
+      break;
+    case PROP_SIMD:
+      g_value_set_enum (value, self->simd);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static gboolean
+gst_nv_redact_set_caps (GstBaseTransform * trans, GstCaps * incaps,
+    GstCaps * outcaps)
+{
+  GstNvRedact *self = GST_NV_REDACT (trans);
+  GstCapsFeatures *features = gst_caps_get_features (incaps, 0);
+
+  if (!gst_video_info_from_caps (&self->info, incaps)) {
+    GST_ERROR_OBJECT (self, "invalid caps %" GST_PTR_FORMAT, incaps);
+    return FALSE;
+  }
+  self->batched = features != NULL &&
+      gst_caps_features_contains (features, GST_CAPS_FEATURE_META_GST_NV_BATCH);
+
+  GST_OBJECT_LOCK (self);
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  return TRUE;
+}
+
+static gboolean
+gst_nv_redact_apply_config (GstNvRedact * self)
+{
+  nvgst::RedactConfig config;
+  GstNvSimdLevel simd;
+  gboolean parsed;
+
+  GST_OBJECT_LOCK (self);
+  if (!self->reconfigure) {
+    GST_OBJECT_UNLOCK (self);
+    return TRUE;
+  }
+  switch (self->mode) {
+    case GST_NV_REDACT_BLUR:
+      config.mode = nvgst::RedactMode::kBlur;
+      break;
+    case GST_NV_REDACT_FILL:
+      config.mode = nvgst::RedactMode::kFill;
+      break;
+    default:
+      config.mode = nvgst::RedactMode::kPixelate;
+      break;
+  }
+  config.block_size = (int) self->block_size;
+  config.radius = (int) self->radius;
+  config.passes = (int) self->passes;
+  parsed = gst_nv_parse_class_ids (self->classes, self->class_ids);
+  simd = self->simd;
+  self->reconfigure = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  if (!parsed) {
+    GST_ERROR_OBJECT (self, "classes must look like \"0,2,7\"");
+    return FALSE;
+  }
+
+  config.format =
+      gst_nv_pixel_format_from_video_format (GST_VIDEO_INFO_FORMAT
+      (&self->info));
+  config.width = GST_VIDEO_INFO_WIDTH (&self->info);
+  config.height = GST_VIDEO_INFO_HEIGHT (&self->info);
+  config.simd = gst_nv_simd_level_resolve (simd);
+  if (!self->redactor->configure (config))
+    return FALSE;
+
+  GST_INFO_OBJECT (self, "redacting %s%s %dx%d (block %d, radius %d, %d "
+      "passes) using %s kernels", self->batched ? "batched " : "",
+      nvgst::format_name (config.format), config.width, config.height,
+      self->redactor->config ().block_size, config.radius, config.passes,
+      nvgst::simd_level_name (config.simd));
+
+  return TRUE;
+}
+
+/* Buffers without objects go through as they are; the base class would
+ * otherwise copy every non-writable one. */
+static GstFlowReturn
+gst_nv_redact_prepare_output_buffer (GstBaseTransform * trans,
+    GstBuffer * input, GstBuffer ** outbuf)
+{
+  GstNvObjectMeta *meta = gst_buffer_get_nv_object_meta (input);
+
+  if (meta == NULL || meta->objects->empty ()) {
+    *outbuf = input;
+    return GST_FLOW_OK;
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->prepare_output_buffer
+      (trans, input, outbuf);
+}
+
+static gboolean
+gst_nv_redact_wanted (GstNvRedact * self, const nvgst::DetectedObject & object)
+{
+  const std::vector < gint > &ids = *self->class_ids;
+
+  return ids.empty () ||
+      std::find (ids.begin (), ids.end (), object.class_id) != ids.end ();
+}
+
+/* Collects the boxes of frame frame_index to mask, widened to whole
+ * pixels. */
+static void
+gst_nv_redact_select (GstNvRedact * self, const nvgst::ObjectList & objects,
+    guint frame_index)
+{
+  self->rects->clear ();
+  for (const nvgst::DetectedObject & object : objects) {
+    if (object.frame != frame_index || !gst_nv_redact_wanted (self, object))
+      continue;
+    self->rects->push_back ({(int) std::floor (object.x),
+            (int) std::floor (object.y),
+            (int) std::ceil (object.x + object.width),
+            (int) std::ceil (object.y + object.height)});
+  }
+}
+
+static GstFlowReturn
+gst_nv_redact_process_batch (GstNvRedact * self, GstBuffer * buffer,
+    const nvgst::ObjectList & objects)
+{
+  GstNvBatchMeta *bmeta = gst_buffer_get_nv_batch_meta (buffer);
+  GstMapInfo map;
+  gint64 pixels = 0;
+
+  if (bmeta == NULL) {
+    GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
+        ("batched buffer without GstNvBatchMeta"));
+    return GST_FLOW_ERROR;
+  }
+  /* frames are only made writable when there is something to mask */
+  if (std::none_of (objects.begin (), objects.end (),
+          [self](const nvgst::DetectedObject & object) {
+            return gst_nv_redact_wanted (self, object);
+          }))
+    return GST_FLOW_OK;
+  if (!gst_nv_batch_meta_make_frames_writable (bmeta))
+    return GST_FLOW_ERROR;
+
+  for (guint i = 0; i < bmeta->n_frames; i++) {
+    gst_nv_redact_select (self, objects, i);
+    if (self->rects->empty ())
+      continue;
+
+    if (!gst_nv_batch_meta_map_frame (bmeta, buffer, i, &map,
+            GST_MAP_READWRITE)) {
+      GST_ELEMENT_ERROR (self, RESOURCE, WRITE, (NULL),
+          ("failed to map frame %u of the batch", i));
+      return GST_FLOW_ERROR;
+    }
+    pixels += self->redactor->redact (gst_nv_batch_frame_view (&bmeta->
+            frames[i], &self->info, &map), self->rects->data (),
+        (int) self->rects->size ());
+    gst_nv_batch_meta_unmap_frame (bmeta, buffer, i, &map);
+  }
+
+  GST_LOG_OBJECT (self, "redacted %" G_GINT64_FORMAT " pixels on %u frames",
+      pixels, bmeta->n_frames);
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_nv_redact_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
+{
+  GstNvRedact *self = GST_NV_REDACT (trans);
+  GstNvObjectMeta *meta = gst_buffer_get_nv_object_meta (buffer);
+  GstVideoFrame frame;
+  gint64 pixels;
+
+  if (meta == NULL || meta->objects->empty ())
+    return GST_FLOW_OK;
+
+  if (!gst_nv_redact_apply_config (self)) {
+    GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS, (NULL),
+        ("invalid redaction settings"));
+    return GST_FLOW_ERROR;
+  }
+
+  if (self->batched)
+    return gst_nv_redact_process_batch (self, buffer, *meta->objects);
+
+  gst_nv_redact_select (self, *meta->objects, 0);
+  if (self->rects->empty ())
+    return GST_FLOW_OK;
+
+  if (!gst_video_frame_map (&frame, &self->info, buffer, GST_MAP_READWRITE)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, WRITE, (NULL),
+        ("failed to map frame"));
+    return GST_FLOW_ERROR;
+  }
+  pixels = self->redactor->redact (gst_nv_frame_view_from_video_frame (&frame),
+      self->rects->data (), (int) self->rects->size ());
+  gst_video_frame_unmap (&frame);
+
+  GST_LOG_OBJECT (self, "redacted %" G_GINT64_FORMAT " pixels of %"
+      G_GSIZE_FORMAT " boxes", pixels, self->rects->size ());
+
+  return GST_FLOW_OK;
+}
@@ -0,0 +1,72 @@
+#ifndef __GST_NV_REDACT_H__
+#define __GST_NV_REDACT_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include <gst/video/video.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "gstnvutils.h"
+#include "core/redact.h"
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  GST_NV_REDACT_PIXELATE,
+  GST_NV_REDACT_BLUR,
+  GST_NV_REDACT_FILL,
+} GstNvRedactMode;
+
+#define GST_TYPE_NV_REDACT_MODE (gst_nv_redact_mode_get_type ())
+GType gst_nv_redact_mode_get_type (void);
+
+#define GST_TYPE_NV_REDACT \
+  (gst_nv_redact_get_type())
+#define GST_NV_REDACT(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_REDACT,GstNvRedact))
+#define GST_NV_REDACT_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_REDACT,GstNvRedactClass))
+#define GST_IS_NV_REDACT(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_REDACT))
+
+typedef struct _GstNvRedact GstNvRedact;
+typedef struct _GstNvRedactClass GstNvRedactClass;
+
+struct _GstNvRedact
+{
+  GstBaseTransform parent;
+
+  /* properties, protected by the object lock */
+  GstNvRedactMode mode;
+  guint block_size;
+  guint radius;
+  guint passes;
+  gchar *classes;
+  GstNvSimdLevel simd;
+  gboolean reconfigure;
+
+  /* streaming thread only */
+  GstVideoInfo info;
+  gboolean batched;
+  std::vector<gint> *class_ids;
+  nvgst::Redactor *redactor;
+  /* boxes of the frame being redacted */
+  std::vector<nvgst::RedactRect> *rects;
+};
+
+struct _GstNvRedactClass
+{
+  GstBaseTransformClass parent_class;
+};
+
+GType gst_nv_redact_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvredact);
+
+G_END_DECLS
+
+#endif /* __GST_NV_REDACT_H__ */
@@ -0,0 +1,796 @@
+/**
+ * SECTION:element-nvreid
+ *
+ * Cross-camera re-identification. Appearance embeddings of tracked objects,
+ * from a re-ID network run on nvroipack crops, are averaged per track and
+ * kept in an in-memory index with the tracks of every source, so a person
+ * or vehicle walking out of one camera can be found again on the others.
+ *
+ * Embeddings are read from the #GstNvTensorMeta tensor named
+ * #GstNvReid:tensor, one row per row of the #GstNvRoiMeta of
+ * #GstNvReid:roi-tensor, which names the object each row belongs to. Once
+ * a track has min-samples embeddings it is searched for among the tracks
+ * that ended before it, on other sources with #GstNvReid:cross-camera;
+ * matches above #GstNvReid:threshold are attached to the buffer as a
+ * #GstNvReidMeta and the best one is posted as an element message
+ * "nvreid-match". Tracks without a new embedding for linger nanoseconds
+ * end and are added to the index.
+ *
+ * The index is an inverted file over L2-normalized vectors: the tracks
+ * are spread over #GstNvReid:lists lists by k-means once enough have come
+ * in, and a search scans only the #GstNvReid:probes lists nearest to the
+ * query with SIMD dot products, over int8 rows with #GstNvReid:quantize.
+ * A few hundred thousand tracks, hours of a hundred cameras, are searched
+ * in well under a millisecond. Tracks last seen more than
+ * #GstNvReid:retention ago are evicted. Times are buffer timestamps, which
+ * on nvbatchmux batches all sources share.
+ *
+ * The "search" action signal looks a track up on demand: a live track
+ * by its mean so far, or one in the index by its stored embedding, on one
+ * camera or on any.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 nvbatchmux name=mux ! nvinfer ! nvpostprocess ! \
+ *     nvtracker ! nvroipack classes=0 width=128 height=256 ! \
+ *     <re-ID network> ! nvreid tensor=embeddings threshold=0.7 ! \
+ *     fakesink  rtspsrc location=rtsp://cam1 ! decodebin ! nvconvert ! \
+ *     mux.sink_0  rtspsrc location=rtsp://cam2 ! decodebin ! nvconvert ! \
+ *     mux.sink_1
+ * ]|
+ */
+
+#include "gstnvreid.h"
+#include "gstnvbatchmeta.h"
+#include "gstnvobjectmeta.h"
+#include "gstnvreidmeta.h"
+#include "gstnvroimeta.h"
+#include "gstnvtensormeta.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_reid_debug);
+#define GST_CAT_DEFAULT gst_nv_reid_debug
+
+#define DEFAULT_TENSOR "embeddings"
+#define DEFAULT_ROI_TENSOR "rois"
+#define DEFAULT_LINGER (2 * GST_SECOND)
+#define DEFAULT_MIN_SAMPLES 3
+#define DEFAULT_THRESHOLD 0.6f
+#define DEFAULT_MAX_MATCHES 5
+#define DEFAULT_CROSS_CAMERA TRUE
+#define DEFAULT_RETENTION (2 * 3600 * GST_SECOND)
+#define DEFAULT_QUANTIZE TRUE
+#define DEFAULT_LISTS 128
+#define DEFAULT_PROBES 8
+#define DEFAULT_SIMD GST_NV_SIMD_LEVEL_AUTO
+
+enum
+{
+  PROP_0,
+  PROP_TENSOR,
+  PROP_ROI_TENSOR,
+  PROP_CLASSES,
+  PROP_LINGER,
+  PROP_MIN_SAMPLES,
+  PROP_THRESHOLD,
+  PROP_MAX_MATCHES,
+  PROP_CROSS_CAMERA,
+  PROP_RETENTION,
+  PROP_QUANTIZE,
+  PROP_LISTS,
+  PROP_PROBES,
+  PROP_SIMD,
+  PROP_ENTRIES,
+  PROP_TRACKS,
+};
+
+enum
+{
+  SIGNAL_SEARCH,
+  LAST_SIGNAL,
+};
+
+static guint gst_nv_reid_signals[LAST_SIGNAL];
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+#define gst_nv_reid_parent_class parent_class
+G_DEFINE_TYPE (GstNvReid, gst_nv_reid, GST_TYPE_BASE_TRANSFORM);
+GST_ELEMENT_REGISTER_DEFINE (nvreid, "nvreid", GST_RANK_NONE,
+    GST_TYPE_NV_REID);
+
+static void gst_nv_reid_finalize (GObject * object);
+static void gst_nv_reid_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_reid_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static gboolean gst_nv_reid_stop (GstBaseTransform * trans);
+static gboolean gst_nv_reid_sink_event (GstBaseTransform * trans,
+    GstEvent * event);
+static GstFlowReturn gst_nv_reid_transform_ip (GstBaseTransform * trans,
+    GstBuffer * buffer);
+static GstStructure *gst_nv_reid_search (GstNvReid * self, guint source_id,
+    guint64 track_id, gint camera, guint max_matches);
+
+static void
+gst_nv_reid_class_init (GstNvReidClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_reid_debug, "nvreid", 0, "nvreid element");
+
+  gobject_class->finalize = gst_nv_reid_finalize;
+  gobject_class->set_property = gst_nv_reid_set_property;
+  gobject_class->get_property = gst_nv_reid_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_TENSOR,
+      g_param_spec_string ("tensor", "Tensor",
+          "Name of the tensor holding one embedding per row", DEFAULT_TENSOR,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_ROI_TENSOR,
+      g_param_spec_string ("roi-tensor", "ROI tensor",
+          "Tensor name of the GstNvRoiMeta telling which object each row "
+          "belongs to (nvroipack's tensor-name)", DEFAULT_ROI_TENSOR,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CLASSES,
+      g_param_spec_string ("classes", "Classes",
+          "Comma-separated class ids of the objects to re-identify (all when "
+          "unset)", NULL,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_LINGER,
+      g_param_spec_uint64 ("linger", "Linger",
+          "Nanoseconds without a new embedding after which a track ends and "
+          "is indexed", 0, G_MAXUINT64, DEFAULT_LINGER,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MIN_SAMPLES,
+      g_param_spec_uint ("min-samples", "Minimum samples",
+          "Embeddings a track needs before it is searched for or indexed",
+          1, G_MAXINT, DEFAULT_MIN_SAMPLES,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_THRESHOLD,
+      g_param_spec_float ("threshold", "Threshold",
+          "Cosine similarity a match needs", -1.0f, 1.0f, DEFAULT_THRESHOLD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_MATCHES,
+      g_param_spec_uint ("max-matches", "Maximum matches",
+          "Matches reported per track", 1, 1024, DEFAULT_MAX_MATCHES,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CROSS_CAMERA,
+      g_param_spec_boolean ("cross-camera", "Cross camera",
+          "Only match tracks of other sources", DEFAULT_CROSS_CAMERA,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_RETENTION,
+      g_param_spec_uint64 ("retention", "Retention",
+          "Nanoseconds indexed tracks are kept after they were last seen "
+          "(0 = forever)", 0, G_MAXUINT64, DEFAULT_RETENTION,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_QUANTIZE,
+      g_param_spec_boolean ("quantize", "Quantize",
+          "Store embeddings as int8, a quarter of the memory; changing it "
+          "empties the index", DEFAULT_QUANTIZE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_LISTS,
+      g_param_spec_uint ("lists", "Lists",
+          "Inverted lists the index is split into once 16 tracks per list "
+          "have come in (1 = always search everything)", 1, 65536,
+          DEFAULT_LISTS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_PROBES,
+      g_param_spec_uint ("probes", "Probes",
+          "Lists scanned per search; more find more at a higher cost", 1,
+          65536, DEFAULT_PROBES,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SIMD,
+      g_param_spec_enum ("simd", "SIMD",
+          "Highest SIMD level to use, capped at what the CPU supports",
+          GST_TYPE_NV_SIMD_LEVEL, DEFAULT_SIMD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_ENTRIES,
+      g_param_spec_uint64 ("entries", "Entries", "Tracks in the index", 0,
+          G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_TRACKS,
+      g_param_spec_uint ("tracks", "Tracks",
+          "Live tracks collecting embeddings", 0, G_MAXUINT, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  /**
+   * GstNvReid::search:
+   * @source_id: source of the track
+   * @track_id: the track, live or in the index
+   * @camera: source to search, or -1 for all but the track's own
+   * @max_matches: matches to return at most
+   *
+   * Looks for tracks resembling one, above #GstNvReid:threshold. Safe to
+   * emit from any thread.
+   *
+   * Returns: (transfer full) (nullable): a "nvreid-matches" structure with
+   * source-id, track-id and an array "matches" of "nvreid-match"
+   * structures (source-id, track-id, class-id, similarity, first-seen,
+   * last-seen), best first; %NULL when the track is unknown.
+   */
+  gst_nv_reid_signals[SIGNAL_SEARCH] =
+      g_signal_new ("search", G_TYPE_FROM_CLASS (klass),
+      (GSignalFlags) (G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION),
+      G_STRUCT_OFFSET (GstNvReidClass, search), NULL, NULL, NULL,
+      GST_TYPE_STRUCTURE, 4, G_TYPE_UINT, G_TYPE_UINT64, G_TYPE_INT,
+      G_TYPE_UINT);
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV re-identification", "Filter/Analyzer/Video",
+      "Averages re-ID embeddings per track into an in-memory IVF index and "
+      "matches tracks across cameras",
+      "nv_gst_plugins developers");
+
+  trans_class->stop = GST_DEBUG_FUNCPTR (gst_nv_reid_stop);
+  trans_class->sink_event = GST_DEBUG_FUNCPTR (gst_nv_reid_sink_event);
+  trans_class->transform_ip = GST_DEBUG_FUNCPTR (gst_nv_reid_transform_ip);
+  trans_class->passthrough_on_same_caps = FALSE;
+
+  klass->search = gst_nv_reid_search;
+}
+
+static void
+gst_nv_reid_init (GstNvReid * self)
+{
+  self->tensor = g_strdup (DEFAULT_TENSOR);
+  self->roi_tensor = g_strdup (DEFAULT_ROI_TENSOR);
+  self->classes = NULL;
+  self->linger = DEFAULT_LINGER;
+  self->min_samples = DEFAULT_MIN_SAMPLES;
+  self->threshold = DEFAULT_THRESHOLD;
+  self->max_matches = DEFAULT_MAX_MATCHES;
+  self->cross_camera = DEFAULT_CROSS_CAMERA;
+  self->retention = DEFAULT_RETENTION;
+  self->quantize = DEFAULT_QUANTIZE;
+  self->lists = DEFAULT_LISTS;
+  self->probes = DEFAULT_PROBES;
+  self->simd = DEFAULT_SIMD;
+  self->reconfigure = TRUE;
+
+  self->active_tensor = NULL;
+  self->active_roi_tensor = NULL;
+  self->class_ids = new std::vector < gint > ();
+  self->active_threshold = DEFAULT_THRESHOLD;
+  self->active_max_matches = DEFAULT_MAX_MATCHES;
+  self->active_cross_camera = DEFAULT_CROSS_CAMERA;
+  self->index_config = new nvgst::EmbeddingIndexConfig ();
+  self->last_time = GST_CLOCK_TIME_NONE;
+  self->finished = new std::vector < nvgst::TrackEmbedding > ();
+  self->matches = new std::vector < nvgst::ReidMatch > ();
+  self->found = new std::vector < GstNvReidMatch > ();
+
+  g_mutex_init (&self->index_lock);
+  self->tracks = new nvgst::TrackEmbeddings ();
+  self->index = new nvgst::EmbeddingIndex ();
+  self->index_ready = FALSE;
+
+  gst_base_transform_set_in_place (GST_BASE_TRANSFORM (self), TRUE);
+}
+
+static void
+gst_nv_reid_finalize (GObject * object)
+{
+  GstNvReid *self = GST_NV_REID (object);
+
+  delete self->index;
+  delete self->tracks;
+  g_mutex_clear (&self->index_lock);
+  delete self->found;
+  delete self->matches;
+  delete self->finished;
+  delete self->index_config;
+  delete self->class_ids;
+  g_free (self->active_roi_tensor);
+  g_free (self->active_tensor);
+  g_free (self->classes);
+  g_free (self->roi_tensor);
+  g_free (self->tensor);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_reid_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvReid *self = GST_NV_REID (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_TENSOR:
+      g_free (self->tensor);
+      self->tensor = g_value_dup_string (value);
+      break;
+    case PROP_ROI_TENSOR:
+      g_free (self->roi_tensor);
+      self->roi_tensor = g_value_dup_string (value);
+      break;
+    case PROP_CLASSES:
+      g_free (self->classes);
+      self->classes = g_value_dup_string (value);
+      break;
+    case PROP_LINGER:
+      self->linger = g_value_get_uint64 (value);
+      break;
+    case PROP_MIN_SAMPLES:
+      self->min_samples = g_value_get_uint (value);
+      break;
+    case PROP_THRESHOLD:
+      self->threshold = g_value_get_float (value);
+      break;
+    case PROP_MAX_MATCHES:
+      self->max_matches = g_value_get_uint (value);
+      break;
+    case PROP_CROSS_CAMERA:
+      self->cross_camera = g_value_get_boolean (value);
+      break;
+    case PROP_RETENTION:
+      self->retention = g_value_get_uint64 (value);
+      break;
+    case PROP_QUANTIZE:
+      self->quantize = g_value_get_boolean (value);
+      break;
+    case PROP_LISTS:
+      self->lists = g_value_get_uint (value);
+      break;
+    case PROP_PROBES:
+      self->probes = g_value_get_uint (value);
+      break;
+    case PROP_SIMD:
+      self->simd = (GstNvSimdLevel) g_value_get_enum (value);
+      break;
+    default:
+      GST_OBJECT_UNLOCK (self);
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      return;
+  }
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_reid_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstNvReid *self = GST_NV_REID (object);
+
+  /* the index lock is never taken with the object lock held */
+  if (prop_id == PROP_ENTRIES || prop_id == PROP_TRACKS) {
+    g_mutex_lock (&self->index_lock);
+    if (prop_id == PROP_ENTRIES)
+      g_value_set_uint64 (value, self->index->size ());
+    else
+      g_value_set_uint (value, (guint) self->tracks->size ());
+    g_mutex_unlock (&self->index_lock);
+    return;
+  }
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_TENSOR:
+      g_value_set_string (value, self->tensor);
+      break;
+    case PROP_ROI_TENSOR:
+      g_value_set_string (value, self->roi_tensor);
+      break;
+    case PROP_CLASSES:
+      g_value_set_string (value, self->classes);
+      break;
+    case PROP_LINGER:
+      g_value_set_uint64 (value, self->linger);
+      break;
+    case PROP_MIN_SAMPLES:
+      g_value_set_uint (value, self->min_samples);
+      break;
+    case PROP_THRESHOLD:
+      g_value_set_float (value, self->threshold);
+      break;
+    case PROP_MAX_MATCHES:
+      g_value_set_uint (value, self->max_matches);
+      break;
+    case PROP_CROSS_CAMERA:
+      g_value_set_boolean (value, self->cross_camera);
+      break;
+    case PROP_RETENTION:
+      g_value_set_uint64 (value, self->retention);
+      break;
+    case PROP_QUANTIZE:
+      g_value_set_boolean (value, self->quantize);
+      break;
+    case PROP_LISTS:
+      g_value_set_uint (value, self->lists);
+      break;
+    case PROP_PROBES:
+      g_value_set_uint (value, self->probes);
+      break;
+    case PROP_SIMD:
+      g_value_set_enum (value, self->simd);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+/* Index and tracks go when the element stops; a flush only forgets the
+ * live tracks. */
+static gboolean
+gst_nv_reid_stop (GstBaseTransform * trans)
+{
+  GstNvReid *self = GST_NV_REID (trans);
+
+  g_mutex_lock (&self->index_lock);
+  GST_INFO_OBJECT (self, "%" G_GSIZE_FORMAT " tracks indexed, %"
+      G_GSIZE_FORMAT " bytes", self->index->size (), self->index->memory ());
+  self->tracks->reset ();
+  self->index->clear ();
+  g_mutex_unlock (&self->index_lock);
+  self->last_time = GST_CLOCK_TIME_NONE;
+
+  GST_OBJECT_LOCK (self);
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  return TRUE;
+}
+
+/* Takes property changes in. The index keeps its tracks unless the
+ * embedding layout (quantize) changed. */
+static gboolean
+gst_nv_reid_apply_config (GstNvReid * self)
+{
+  nvgst::TrackEmbeddingConfig tracks;
+  nvgst::EmbeddingIndexConfig *index = self->index_config;
+  GstNvSimdLevel simd;
+  gboolean parsed;
+  gboolean ok = TRUE;
+
+  GST_OBJECT_LOCK (self);
+  if (!self->reconfigure) {
+    GST_OBJECT_UNLOCK (self);
+    return TRUE;
+  }
+  g_free (self->active_tensor);
+  self->active_tensor = g_strdup (self->tensor);
+  g_free (self->active_roi_tensor);
+  self->active_roi_tensor = g_strdup (self->roi_tensor);
+  parsed = gst_nv_parse_class_ids (self->classes, self->class_ids);
+  tracks.linger = self->linger;
+  tracks.min_samples = (int) self->min_samples;
+  self->active_threshold = self->threshold;
+  self->active_max_matches = self->max_matches;
+  self->active_cross_camera = self->cross_camera;
+  index->quantize = self->quantize != FALSE;
+  index->lists = (int) self->lists;
+  index->probes = (int) self->probes;
+  index->train_size = 16 * index->lists;
+  index->retention = self->retention;
+  simd = self->simd;
+  self->reconfigure = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  if (!parsed) {
+    GST_ERROR_OBJECT (self, "classes must look like \"0,2,7\"");
+    return FALSE;
+  }
+  index->simd = gst_nv_simd_level_resolve (simd);
+
+  g_mutex_lock (&self->index_lock);
+  self->tracks->configure (self->tracks->dim (), tracks);
+  if (self->index_ready)
+    ok = self->index->configure (*index);
+  g_mutex_unlock (&self->index_lock);
+
+  GST_INFO_OBJECT (self, "re-identifying from tensor %s, %d lists, %d "
+      "probes, %s rows, %s", self->active_tensor, index->lists,
+      index->probes, index->quantize ? "int8" : "float",
+      nvgst::simd_level_name (index->simd));
+
+  return ok;
+}
+
+static gboolean
+gst_nv_reid_wanted (GstNvReid * self, gint class_id)
+{
+  const std::vector < gint > &ids = *self->class_ids;
+
+  return ids.empty () ||
+      std::find (ids.begin (), ids.end (), class_id) != ids.end ();
+}
+
+/* The first embedding fixes the length; a new length starts over. Called
+ * with the index lock held. */
+static gboolean
+gst_nv_reid_set_dim (GstNvReid * self, gint dim)
+{
+  if (self->index_ready && self->index_config->dim == dim)
+    return TRUE;
+
+  if (self->index_ready)
+    GST_WARNING_OBJECT (self, "embedding length changed from %d to %d, "
+        "dropping the index", self->index_config->dim, dim);
+  self->index_config->dim = dim;
+  self->index_ready = self->index->configure (*self->index_config);
+  self->tracks->configure (dim, self->tracks->config ());
+
+  return self->index_ready;
+}
+
+/* Folds the embeddings of a buffer into their tracks and searches for the
+ * tracks that just got enough of them. Called with the index lock held. */
+static gboolean
+gst_nv_reid_collect (GstNvReid * self, GstBuffer * buffer,
+    const nvgst::Tensor * tensor, GstNvRoiMeta * rmeta,
+    GstNvObjectMeta * ometa, guint64 now)
+{
+  GstNvBatchMeta *bmeta = gst_buffer_get_nv_batch_meta (buffer);
+  const nvgst::ObjectList & objects = *ometa->objects;
+  const std::vector < GstNvRoiRef > &rois = *rmeta->rois;
+  gsize rows, dim, n;
+
+  rows = tensor->info.shape.empty ()? 0 : (gsize) tensor->info.shape[0];
+  if (rows == 0 || tensor->data == nullptr)
+    return TRUE;
+  dim = tensor->info.count () / rows;
+  if (dim == 0 || !gst_nv_reid_set_dim (self, (gint) dim))
+    return FALSE;
+
+  n = MIN (rows, rois.size ());
+  for (gsize i = 0; i < n; i++) {
+    const GstNvRoiRef & ref = rois[i];
+    const nvgst::DetectedObject * object;
+    nvgst::TrackEmbedding * track;
+    nvgst::ReidFilter filter;
+    guint source_id;
+
+    if (ref.object >= objects.size ())
+      continue;
+    object = &objects[ref.object];
+    if (object->track_id == nvgst::kNoTrack || object->track_id != ref.track_id
+        || !gst_nv_reid_wanted (self, object->class_id))
+      continue;
+
+    source_id = bmeta != NULL && ref.frame < bmeta->n_frames ?
+        bmeta->frames[ref.frame].source_id : 0;
+    track = self->tracks->add (source_id, *object, now,
+        tensor->data.get () + i * dim);
+    if (track == NULL || track->searched ||
+        track->samples < self->tracks->config ().min_samples)
+      continue;
+
+    track->searched = TRUE;
+    filter.exclude_source = self->active_cross_camera ? source_id : -1;
+    filter.self_source = source_id;
+    filter.self_track = object->track_id;
+    filter.min_similarity = self->active_threshold;
+    self->index->search (track->sum.data (), filter,
+        (int) self->active_max_matches, self->matches);
+
+    for (const nvgst::ReidMatch & match : *self->matches) {
+      GstNvReidMatch found;
+
+      found.source_id = source_id;
+      found.track_id = object->track_id;
+      found.match_source_id = match.entry.source;
+      found.match_track_id = match.entry.track_id;
+      found.match_class_id = match.entry.class_id;
+      found.similarity = match.similarity;
+      found.match_first_seen = match.entry.first_seen;
+      found.match_last_seen = match.entry.last_seen;
+      self->found->push_back (found);
+    }
+  }
+
+  return TRUE;
+}
+
+/* Indexes the tracks that ended. Called with the index lock held. */
+static void
+gst_nv_reid_index_finished (GstNvReid * self)
+{
+  for (nvgst::TrackEmbedding & track : *self->finished)
+    self->index->add (track.entry, track.sum.data ());
+  if (!self->finished->empty ())
+    GST_LOG_OBJECT (self, "indexed %" G_GSIZE_FORMAT " tracks, %"
+        G_GSIZE_FORMAT " in all", self->finished->size (),
+        self->index->size ());
+  self->finished->clear ();
+}
+
+/* One message per track with a match, naming the best one. */
+static void
+gst_nv_reid_post_matches (GstNvReid * self)
+{
+  guint64 last_track = nvgst::kNoTrack;
+  guint last_source = 0;
+
+  for (const GstNvReidMatch & match : *self->found) {
+    if (match.track_id == last_track && match.source_id == last_source)
+      continue;
+    last_track = match.track_id;
+    last_source = match.source_id;
+
+    GST_DEBUG_OBJECT (self, "track %" G_GUINT64_FORMAT " of source %u "
+        "matches track %" G_GUINT64_FORMAT " of source %u, similarity %.3f",
+        match.track_id, match.source_id, match.match_track_id,
+        match.match_source_id, match.similarity);
+    gst_element_post_message (GST_ELEMENT (self),
+        gst_message_new_element (GST_OBJECT (self),
+            gst_structure_new ("nvreid-match",
+                "source-id", G_TYPE_UINT, match.source_id,
+                "track-id", G_TYPE_UINT64, match.track_id,
+                "match-source-id", G_TYPE_UINT, match.match_source_id,
+                "match-track-id", G_TYPE_UINT64, match.match_track_id,
+                "similarity", G_TYPE_FLOAT, match.similarity, NULL)));
+  }
+}
+
+static gboolean
+gst_nv_reid_sink_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstNvReid *self = GST_NV_REID (trans);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_EOS:
+      /* the tracks still live end with the stream */
+      g_mutex_lock (&self->index_lock);
+      self->tracks->flush (self->finished);
+      gst_nv_reid_index_finished (self);
+      g_mutex_unlock (&self->index_lock);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      g_mutex_lock (&self->index_lock);
+      self->tracks->reset ();
+      g_mutex_unlock (&self->index_lock);
+      self->last_time = GST_CLOCK_TIME_NONE;
+      break;
+    default:
+      break;
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->sink_event (trans, event);
+}
+
+static GstFlowReturn
+gst_nv_reid_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
+{
+  GstNvReid *self = GST_NV_REID (trans);
+  GstNvTensorMeta *tmeta = gst_buffer_get_nv_tensor_meta (buffer);
+  GstNvObjectMeta *ometa = gst_buffer_get_nv_object_meta (buffer);
+  const nvgst::Tensor *tensor;
+  GstNvRoiMeta *rmeta;
+  gboolean ok = TRUE;
+  guint64 now;
+
+  if (!gst_nv_reid_apply_config (self)) {
+    GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS, (NULL),
+        ("invalid re-identification settings"));
+    return GST_FLOW_ERROR;
+  }
+
+  /* buffers without a timestamp count as seen with the previous one */
+  if (GST_BUFFER_PTS_IS_VALID (buffer))
+    self->last_time = GST_BUFFER_PTS (buffer);
+  now = GST_CLOCK_TIME_IS_VALID (self->last_time) ? self->last_time : 0;
+
+  tensor = tmeta != NULL ?
+      gst_nv_tensor_meta_find (tmeta, self->active_tensor) : NULL;
+  rmeta = tensor != NULL ?
+      gst_buffer_find_nv_roi_meta (buffer, self->active_roi_tensor) : NULL;
+
+  g_mutex_lock (&self->index_lock);
+  if (rmeta != NULL && ometa != NULL)
+    ok = gst_nv_reid_collect (self, buffer, tensor, rmeta, ometa, now);
+  self->tracks->expire (now, self->finished);
+  gst_nv_reid_index_finished (self);
+  self->index->evict (now);
+  g_mutex_unlock (&self->index_lock);
+
+  if (!ok) {
+    self->found->clear ();
+    GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS, (NULL),
+        ("invalid index settings for the embedding length"));
+    return GST_FLOW_ERROR;
+  }
+
+  if (!self->found->empty ()) {
+    GstNvReidMeta *meta = gst_buffer_add_nv_reid_meta (buffer);
+
+    meta->matches->assign (self->found->begin (), self->found->end ());
+    gst_nv_reid_post_matches (self);
+    self->found->clear ();
+  }
+
+  return GST_FLOW_OK;
+}
+
+static GstStructure *
+gst_nv_reid_search (GstNvReid * self, guint source_id, guint64 track_id,
+    gint camera, guint max_matches)
+{
+  std::vector < nvgst::ReidMatch > matches;
+  std::vector < gfloat > embedding;
+  const nvgst::TrackEmbedding *track;
+  nvgst::ReidFilter filter;
+  GstStructure *result;
+  GValue array = G_VALUE_INIT;
+  gboolean known;
+
+  GST_OBJECT_LOCK (self);
+  filter.min_similarity = self->threshold;
+  GST_OBJECT_UNLOCK (self);
+  filter.source = camera;
+  filter.exclude_source = camera < 0 ? source_id : -1;
+  filter.self_source = source_id;
+  filter.self_track = track_id;
+
+  g_mutex_lock (&self->index_lock);
+  known = self->index_ready;
+  if (known) {
+    embedding.resize (self->index_config->dim);
+    track = self->tracks->find (source_id, track_id);
+    if (track != NULL)
+      embedding.assign (track->sum.begin (), track->sum.end ());
+    else
+      known = self->index->find (source_id, track_id, embedding.data ());
+  }
+  if (known)
+    self->index->search (embedding.data (), filter, (int) max_matches,
+        &matches);
+  g_mutex_unlock (&self->index_lock);
+
+  if (!known) {
+    GST_DEBUG_OBJECT (self, "track %" G_GUINT64_FORMAT " of source %u is "
+        "not known", track_id, source_id);
+    return NULL;
+  }
+
+  g_value_init (&array, GST_TYPE_ARRAY);
+  for (const nvgst::ReidMatch & match : matches) {
+    GValue item = G_VALUE_INIT;
+
+    g_value_init (&item, GST_TYPE_STRUCTURE);
+    g_value_take_boxed (&item, gst_structure_new ("nvreid-match",
+            "source-id", G_TYPE_UINT, match.entry.source,
+            "track-id", G_TYPE_UINT64, match.entry.track_id,
+            "class-id", G_TYPE_INT, match.entry.class_id,
+            "similarity", G_TYPE_FLOAT, match.similarity,
+            "first-seen", G_TYPE_UINT64, match.entry.first_seen,
+            "last-seen", G_TYPE_UINT64, match.entry.last_seen, NULL));
+    gst_value_array_append_and_take_value (&array, &item);
+  }
+
+  result = gst_structure_new ("nvreid-matches",
+      "source-id", G_TYPE_UINT, source_id,
+      "track-id", G_TYPE_UINT64, track_id, NULL);
+  gst_structure_take_value (result, "matches", &array);
+
+  return result;
+}
@@ -0,0 +1,83 @@
+#ifndef __GST_NV_REID_H__
+#define __GST_NV_REID_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include <gst/video/video.h>
+
+#include <vector>
+
+#include "gstnvreidmeta.h"
+#include "gstnvutils.h"
+#include "core/reid.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_NV_REID \
+  (gst_nv_reid_get_type())
+#define GST_NV_REID(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_REID,GstNvReid))
+#define GST_NV_REID_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_REID,GstNvReidClass))
+#define GST_IS_NV_REID(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_REID))
+
+typedef struct _GstNvReid GstNvReid;
+typedef struct _GstNvReidClass GstNvReidClass;
+
+struct _GstNvReid
+{
+  GstBaseTransform parent;
+
+  /* properties, protected by the object lock */
+  gchar *tensor;
+  gchar *roi_tensor;
+  gchar *classes;
+  guint64 linger;
+  guint min_samples;
+  gfloat threshold;
+  guint max_matches;
+  gboolean cross_camera;
+  guint64 retention;
+  gboolean quantize;
+  guint lists;
+  guint probes;
+  GstNvSimdLevel simd;
+  gboolean reconfigure;
+
+  /* streaming thread only */
+  gchar *active_tensor;
+  gchar *active_roi_tensor;
+  std::vector<gint> *class_ids;
+  gfloat active_threshold;
+  guint active_max_matches;
+  gboolean active_cross_camera;
+  nvgst::EmbeddingIndexConfig *index_config;
+  GstClockTime last_time;
+  std::vector<nvgst::TrackEmbedding> *finished;
+  std::vector<nvgst::ReidMatch> *matches;
+  std::vector<GstNvReidMatch> *found;
+
+  /* streaming thread and the search action, protected by index_lock */
+  GMutex index_lock;
+  nvgst::TrackEmbeddings *tracks;
+  nvgst::EmbeddingIndex *index;
+  gboolean index_ready;
+};
+
+struct _GstNvReidClass
+{
+  GstBaseTransformClass parent_class;
+
+  /* actions */
+  GstStructure *(*search) (GstNvReid * reid, guint source_id,
+      guint64 track_id, gint camera, guint max_matches);
+};
+
+GType gst_nv_reid_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvreid);
+
+G_END_DECLS
+
+#endif /* __GST_NV_REID_H__ */
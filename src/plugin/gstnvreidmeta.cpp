@@ -0,0 +1,76 @@
+#include "gstnvreidmeta.h"
+
+GType
+gst_nv_reid_meta_api_get_type (void)
+{
+  static GType type = 0;
+  static const gchar *tags[] = { GST_META_TAG_VIDEO_STR, NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = gst_meta_api_type_register ("GstNvReidMetaAPI", tags);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+static gboolean
+gst_nv_reid_meta_init (GstMeta * meta, gpointer params, GstBuffer * buffer)
+{
+  GstNvReidMeta *rmeta = (GstNvReidMeta *) meta;
+
+  rmeta->matches = new std::vector < GstNvReidMatch > ();
+
+  return TRUE;
+}
+
+static void
+gst_nv_reid_meta_free (GstMeta * meta, GstBuffer * buffer)
+{
+  GstNvReidMeta *rmeta = (GstNvReidMeta *) meta;
+
+  delete rmeta->matches;
+  rmeta->matches = NULL;
+}
+
+/* Matches name tracks, not pixels, so they survive any copy. */
+static gboolean
+gst_nv_reid_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstNvReidMeta *src = (GstNvReidMeta *) meta;
+  GstNvReidMeta *rmeta;
+
+  if (!GST_META_TRANSFORM_IS_COPY (type))
+    return FALSE;
+
+  rmeta = gst_buffer_add_nv_reid_meta (dest);
+  if (rmeta == NULL)
+    return FALSE;
+
+  *rmeta->matches = *src->matches;
+
+  return TRUE;
+}
+
+const GstMetaInfo *
+gst_nv_reid_meta_get_info (void)
+{
+  static const GstMetaInfo *info = NULL;
+
+  if (g_once_init_enter (&info)) {
+    const GstMetaInfo *tmp =
+        gst_meta_register (GST_NV_REID_META_API_TYPE,
+        "GstNvReidMeta", sizeof (GstNvReidMeta),
+        gst_nv_reid_meta_init, gst_nv_reid_meta_free,
+        gst_nv_reid_meta_transform);
+    g_once_init_leave (&info, tmp);
+  }
+  return info;
+}
+
+GstNvReidMeta *
+gst_buffer_add_nv_reid_meta (GstBuffer * buffer)
+{
+  return (GstNvReidMeta *) gst_buffer_add_meta (buffer,
+      GST_NV_REID_META_INFO, NULL);
+}
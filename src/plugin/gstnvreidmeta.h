@@ -0,0 +1,65 @@
+/* Cross-camera matches found by nvreid. */
+#ifndef __GST_NV_REID_META_H__
+#define __GST_NV_REID_META_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include <vector>
+
+G_BEGIN_DECLS
+
+typedef struct _GstNvReidMatch GstNvReidMatch;
+typedef struct _GstNvReidMeta GstNvReidMeta;
+
+/**
+ * GstNvReidMatch:
+ * @source_id: source of the track that was searched for, 0 on single
+ *     frames
+ * @track_id: the track that was searched for
+ * @match_source_id: source of an earlier track that looked alike
+ * @match_track_id: that track
+ * @match_class_id: its class
+ * @similarity: cosine similarity of the two tracks' mean embeddings
+ * @match_first_seen: buffer time the earlier track was first seen at
+ * @match_last_seen: buffer time it was last seen at
+ */
+struct _GstNvReidMatch
+{
+  guint source_id;
+  guint64 track_id;
+  guint match_source_id;
+  guint64 match_track_id;
+  gint match_class_id;
+  gfloat similarity;
+  GstClockTime match_first_seen;
+  GstClockTime match_last_seen;
+};
+
+/**
+ * GstNvReidMeta:
+ * @meta: parent #GstMeta
+ * @matches: matches of the tracks searched for on this buffer, best first
+ *     per track, owned by the meta
+ */
+struct _GstNvReidMeta
+{
+  GstMeta meta;
+
+  std::vector<GstNvReidMatch> *matches;
+};
+
+GType gst_nv_reid_meta_api_get_type (void);
+#define GST_NV_REID_META_API_TYPE (gst_nv_reid_meta_api_get_type ())
+
+const GstMetaInfo *gst_nv_reid_meta_get_info (void);
+#define GST_NV_REID_META_INFO (gst_nv_reid_meta_get_info ())
+
+#define gst_buffer_get_nv_reid_meta(b) \
+  ((GstNvReidMeta *) gst_buffer_get_meta ((b), GST_NV_REID_META_API_TYPE))
+
+GstNvReidMeta *gst_buffer_add_nv_reid_meta (GstBuffer * buffer);
+
+G_END_DECLS
+
+#endif /* __GST_NV_REID_META_H__ */
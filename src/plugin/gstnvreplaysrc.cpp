@@ -0,0 +1,628 @@
+/**
+ * SECTION:element-nvreplaysrc
+ *
+ * Plays back a capture file written by nvcapturesink, for benchmarks and
+ * regression runs that need the same input every time without cameras or
+ * decoders. The file is mapped read-only and each buffer wraps its frame
+ * in the mapping without copying; timestamps, offsets, flags, plane
+ * layout and nv metadata are restored as they were captured, tensors
+ * pointing into the mapping as well. Caps changes are replayed where they
+ * happened.
+ *
+ * With timing=fast (the default) buffers go out as fast as downstream
+ * takes them, which measures throughput; with timing=original they are
+ * paced by their recorded timestamps on the system clock, which measures
+ * latency under the camera's frame rate. Pacing starts from the first
+ * buffer, and after a seek; a pause is caught up on afterwards.
+ *
+ * #GstNvReplaySrc:loops replays the file several times (0 forever), each
+ * pass shifting the timestamps by the length of the capture so that they
+ * keep going up. With preload=true the whole file is read into memory
+ * before the first buffer, so that page faults on a cold cache do not
+ * show up in the numbers; otherwise the kernel is asked to read
+ * #GstNvReplaySrc:read-ahead records ahead. The source seeks in time
+ * through the file's index.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 nvreplaysrc location=store.nvcap loops=10 preload=true ! \
+ *     nvanalytics config-location=store.ini ! fakesink sync=false
+ * ]|
+ */
+
+#include "gstnvreplaysrc.h"
+
+#include "gstnvbatchmeta.h"
+#include "gstnvcapture.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_replay_src_debug);
+#define GST_CAT_DEFAULT gst_nv_replay_src_debug
+
+#define DEFAULT_LOCATION "capture.nvcap"
+#define DEFAULT_TIMING GST_NV_REPLAY_TIMING_FAST
+#define DEFAULT_LOOPS 1
+#define DEFAULT_PRELOAD FALSE
+#define DEFAULT_READ_AHEAD 16
+
+enum
+{
+  PROP_0,
+  PROP_LOCATION,
+  PROP_TIMING,
+  PROP_LOOPS,
+  PROP_PRELOAD,
+  PROP_READ_AHEAD,
+  PROP_RECORDS,
+};
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+GType
+gst_nv_replay_timing_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_NV_REPLAY_TIMING_FAST, "As fast as downstream takes the buffers",
+        "fast"},
+    {GST_NV_REPLAY_TIMING_ORIGINAL, "Paced by the recorded timestamps",
+        "original"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = g_enum_register_static ("GstNvReplayTiming", values);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+/* Keeps the reader (and its mapping) alive while a buffer is downstream. */
+struct GstNvReplaySrcRef
+{
+  std::shared_ptr<nvgst::CaptureReader> reader;
+};
+
+#define gst_nv_replay_src_parent_class parent_class
+G_DEFINE_TYPE (GstNvReplaySrc, gst_nv_replay_src, GST_TYPE_PUSH_SRC);
+GST_ELEMENT_REGISTER_DEFINE (nvreplaysrc, "nvreplaysrc", GST_RANK_NONE,
+    GST_TYPE_NV_REPLAY_SRC);
+
+static void gst_nv_replay_src_finalize (GObject * object);
+static void gst_nv_replay_src_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_replay_src_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static gboolean gst_nv_replay_src_start (GstBaseSrc * src);
+static gboolean gst_nv_replay_src_stop (GstBaseSrc * src);
+static gboolean gst_nv_replay_src_unlock (GstBaseSrc * src);
+static gboolean gst_nv_replay_src_unlock_stop (GstBaseSrc * src);
+static gboolean gst_nv_replay_src_is_seekable (GstBaseSrc * src);
+static gboolean gst_nv_replay_src_do_seek (GstBaseSrc * src,
+    GstSegment * segment);
+static GstFlowReturn gst_nv_replay_src_create (GstPushSrc * src,
+    GstBuffer ** buffer);
+
+static void
+gst_nv_replay_src_class_init (GstNvReplaySrcClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseSrcClass *base_src_class = GST_BASE_SRC_CLASS (klass);
+  GstPushSrcClass *push_src_class = GST_PUSH_SRC_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_replay_src_debug, "nvreplaysrc", 0,
+      "nvreplaysrc element");
+
+  gobject_class->finalize = gst_nv_replay_src_finalize;
+  gobject_class->set_property = gst_nv_replay_src_set_property;
+  gobject_class->get_property = gst_nv_replay_src_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_LOCATION,
+      g_param_spec_string ("location", "Location",
+          "Capture file written by nvcapturesink", DEFAULT_LOCATION,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_TIMING,
+      g_param_spec_enum ("timing", "Timing",
+          "When buffers go out", GST_TYPE_NV_REPLAY_TIMING, DEFAULT_TIMING,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_LOOPS,
+      g_param_spec_uint ("loops", "Loops",
+          "Times the file is played (0 = forever)", 0, G_MAXUINT,
+          DEFAULT_LOOPS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_PRELOAD,
+      g_param_spec_boolean ("preload", "Preload",
+          "Read the whole file into memory when starting", DEFAULT_PRELOAD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_READ_AHEAD,
+      g_param_spec_uint ("read-ahead", "Read ahead",
+          "Records the kernel is asked to read ahead without preload "
+          "(0 = none)", 0, 4096, DEFAULT_READ_AHEAD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_RECORDS,
+      g_param_spec_uint64 ("records", "Records",
+          "Buffers and caps in the open file", 0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV replay source", "Source/File",
+      "Replays buffers and their metadata from a memory-mapped "
+      "nvcapturesink file without copying", "nv_gst_plugins developers");
+
+  base_src_class->start = GST_DEBUG_FUNCPTR (gst_nv_replay_src_start);
+  base_src_class->stop = GST_DEBUG_FUNCPTR (gst_nv_replay_src_stop);
+  base_src_class->unlock = GST_DEBUG_FUNCPTR (gst_nv_replay_src_unlock);
+  base_src_class->unlock_stop =
+      GST_DEBUG_FUNCPTR (gst_nv_replay_src_unlock_stop);
+  base_src_class->is_seekable =
+      GST_DEBUG_FUNCPTR (gst_nv_replay_src_is_seekable);
+  base_src_class->do_seek = GST_DEBUG_FUNCPTR (gst_nv_replay_src_do_seek);
+  push_src_class->create = GST_DEBUG_FUNCPTR (gst_nv_replay_src_create);
+
+  gst_type_mark_as_plugin_api (GST_TYPE_NV_REPLAY_TIMING,
+      (GstPluginAPIFlags) 0);
+}
+
+static void
+gst_nv_replay_src_init (GstNvReplaySrc * self)
+{
+  self->location = g_strdup (DEFAULT_LOCATION);
+  self->timing = DEFAULT_TIMING;
+  self->loops = DEFAULT_LOOPS;
+  self->preload = DEFAULT_PRELOAD;
+  self->read_ahead = DEFAULT_READ_AHEAD;
+  self->record = new nvgst::CaptureRecord ();
+
+  gst_base_src_set_format (GST_BASE_SRC (self), GST_FORMAT_TIME);
+}
+
+static void
+gst_nv_replay_src_finalize (GObject * object)
+{
+  GstNvReplaySrc *self = GST_NV_REPLAY_SRC (object);
+
+  g_free (self->location);
+  delete self->record;
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_replay_src_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvReplaySrc *self = GST_NV_REPLAY_SRC (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_LOCATION:
+      g_free (self->location);
+      self->location = g_value_dup_string (value);
+      break;
+    case PROP_TIMING:
+      self->timing = (GstNvReplayTiming) g_value_get_enum (value);
+      break;
+    case PROP_LOOPS:
+      self->loops = g_value_get_uint (value);
+      break;
+    case PROP_PRELOAD:
+      self->preload = g_value_get_boolean (value);
+      break;
+    case PROP_READ_AHEAD:
+      self->read_ahead = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_replay_src_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstNvReplaySrc *self = GST_NV_REPLAY_SRC (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_LOCATION:
+      g_value_set_string (value, self->location);
+      break;
+    case PROP_TIMING:
+      g_value_set_enum (value, self->timing);
+      break;
+    case PROP_LOOPS:
+      g_value_set_uint (value, self->loops);
+      break;
+    case PROP_PRELOAD:
+      g_value_set_boolean (value, self->preload);
+      break;
+    case PROP_READ_AHEAD:
+      g_value_set_uint (value, self->read_ahead);
+      break;
+    case PROP_RECORDS:
+      g_value_set_uint64 (value, self->reader ? (*self->reader)->size () : 0);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+/* Starts over from record @next of the first pass. */
+static void
+gst_nv_replay_src_rewind (GstNvReplaySrc * self, gsize next)
+{
+  self->next = next;
+  self->loop = 0;
+  self->loop_offset = 0;
+  self->prefetched = next;
+  self->pace_pts = GST_CLOCK_TIME_NONE;
+}
+
+static gboolean
+gst_nv_replay_src_start (GstBaseSrc * src)
+{
+  GstNvReplaySrc *self = GST_NV_REPLAY_SRC (src);
+  auto reader = std::make_shared<nvgst::CaptureReader> ();
+  GstClockTime end = 0;
+  std::string error;
+  gboolean preload;
+  gchar *path;
+
+  GST_OBJECT_LOCK (self);
+  path = g_strdup (self->location);
+  preload = self->preload;
+  GST_OBJECT_UNLOCK (self);
+
+  if (path == NULL || !reader->open (path, preload, &error)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ,
+        ("Could not open capture file %s", GST_STR_NULL (path)),
+        ("%s", error.c_str ()));
+    g_free (path);
+    return FALSE;
+  }
+  if (!reader->complete ())
+    GST_WARNING_OBJECT (self, "%s has no index, found %" G_GSIZE_FORMAT
+        " records", path, reader->size ());
+  GST_INFO_OBJECT (self, "opened %s, %" G_GSIZE_FORMAT " records", path,
+      reader->size ());
+  g_free (path);
+
+  /* the length of a pass, for the timestamps of the next one */
+  self->first_pts = GST_CLOCK_TIME_NONE;
+  for (gsize i = 0; i < reader->size (); i++) {
+    const nvgst::CaptureIndexEntry & entry = reader->entry (i);
+
+    if (entry.kind != (guint32) nvgst::CaptureRecordKind::kBuffer
+        || !GST_CLOCK_TIME_IS_VALID (entry.pts))
+      continue;
+    if (!GST_CLOCK_TIME_IS_VALID (self->first_pts)
+        || entry.pts < self->first_pts)
+      self->first_pts = entry.pts;
+    end = MAX (end, entry.pts + (GST_CLOCK_TIME_IS_VALID (entry.duration) ?
+            entry.duration : 0));
+  }
+  self->span = GST_CLOCK_TIME_IS_VALID (self->first_pts) ?
+      end - self->first_pts : 0;
+
+  GST_OBJECT_LOCK (self);
+  self->reader = new std::shared_ptr<nvgst::CaptureReader> (reader);
+  self->flushing = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  self->caps_record = -1;
+  gst_nv_replay_src_rewind (self, 0);
+  return TRUE;
+}
+
+static gboolean
+gst_nv_replay_src_stop (GstBaseSrc * src)
+{
+  GstNvReplaySrc *self = GST_NV_REPLAY_SRC (src);
+  std::shared_ptr<nvgst::CaptureReader> *reader;
+
+  GST_OBJECT_LOCK (self);
+  reader = self->reader;
+  self->reader = NULL;
+  GST_OBJECT_UNLOCK (self);
+
+  /* buffers still downstream keep the mapping until they are freed */
+  delete reader;
+  return TRUE;
+}
+
+static gboolean
+gst_nv_replay_src_unlock (GstBaseSrc * src)
+{
+  GstNvReplaySrc *self = GST_NV_REPLAY_SRC (src);
+
+  GST_OBJECT_LOCK (self);
+  self->flushing = TRUE;
+  if (self->clock_id)
+    gst_clock_id_unschedule (self->clock_id);
+  GST_OBJECT_UNLOCK (self);
+  return TRUE;
+}
+
+static gboolean
+gst_nv_replay_src_unlock_stop (GstBaseSrc * src)
+{
+  GstNvReplaySrc *self = GST_NV_REPLAY_SRC (src);
+
+  GST_OBJECT_LOCK (self);
+  self->flushing = FALSE;
+  GST_OBJECT_UNLOCK (self);
+  return TRUE;
+}
+
+static gboolean
+gst_nv_replay_src_is_seekable (GstBaseSrc * src)
+{
+  return TRUE;
+}
+
+static gboolean
+gst_nv_replay_src_do_seek (GstBaseSrc * src, GstSegment * segment)
+{
+  GstNvReplaySrc *self = GST_NV_REPLAY_SRC (src);
+
+  if (self->reader == NULL || segment->format != GST_FORMAT_TIME)
+    return FALSE;
+
+  GST_DEBUG_OBJECT (self, "seek to %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (segment->start));
+  gst_nv_replay_src_rewind (self, (*self->reader)->seek (segment->start));
+  segment->time = segment->start;
+  return TRUE;
+}
+
+static void
+gst_nv_replay_src_ref_free (gpointer data)
+{
+  delete (GstNvReplaySrcRef *) data;
+}
+
+static GstMemory *
+gst_nv_replay_src_wrap (const std::shared_ptr<nvgst::CaptureReader> & reader,
+    const nvgst::CaptureBlock & block)
+{
+  return gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
+      (gpointer) reader->data (), reader->bytes (),
+      block.data - reader->data (), block.size,
+      new GstNvReplaySrcRef { reader }, gst_nv_replay_src_ref_free);
+}
+
+static gboolean
+gst_nv_replay_src_update_caps (GstNvReplaySrc * self,
+    const std::shared_ptr<nvgst::CaptureReader> & reader, glong index)
+{
+  nvgst::CaptureRecord *record = self->record;
+  GstCaps *caps = NULL;
+  gboolean ret;
+
+  if (reader->read (index, record)) {
+    for (const nvgst::CaptureBlock & block : record->blocks) {
+      if (block.type == GST_NV_CAPTURE_BLOCK_CAPS) {
+        gchar *str = g_strndup ((const gchar *) block.data, block.size);
+
+        caps = gst_caps_from_string (str);
+        g_free (str);
+        break;
+      }
+    }
+  }
+  if (caps == NULL) {
+    GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
+        ("capture record %ld holds no valid caps", index));
+    return FALSE;
+  }
+
+  GST_DEBUG_OBJECT (self, "caps from capture: %" GST_PTR_FORMAT, caps);
+  ret = gst_base_src_set_caps (GST_BASE_SRC (self), caps);
+  gst_caps_unref (caps);
+  if (!ret) {
+    GST_ELEMENT_ERROR (self, CORE, NEGOTIATION, (NULL),
+        ("downstream did not accept the captured caps"));
+    return FALSE;
+  }
+  self->caps_record = index;
+  return TRUE;
+}
+
+static GstClockTime
+gst_nv_replay_src_shift (GstNvReplaySrc * self, guint64 time)
+{
+  return GST_CLOCK_TIME_IS_VALID (time) ? time + self->loop_offset : time;
+}
+
+/* Frame running times were taken in the capturing pipeline; keep them as
+ * far from the batch's running time as they were when it was captured. */
+static void
+gst_nv_replay_src_rebase_batch (GstNvReplaySrc * self, GstBuffer * buffer,
+    GstClockTime captured_pts)
+{
+  GstNvBatchMeta *bmeta = gst_buffer_get_nv_batch_meta (buffer);
+  GstClockTime running_time;
+
+  if (bmeta == NULL || !GST_CLOCK_TIME_IS_VALID (captured_pts))
+    return;
+  running_time = gst_segment_to_running_time (&GST_BASE_SRC (self)->segment,
+      GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
+  for (guint i = 0; i < bmeta->n_frames; i++) {
+    GstNvBatchFrame *frame = &bmeta->frames[i];
+    gint64 shifted;
+
+    if (!GST_CLOCK_TIME_IS_VALID (frame->running_time))
+      continue;
+    if (!GST_CLOCK_TIME_IS_VALID (running_time)) {
+      frame->running_time = GST_CLOCK_TIME_NONE;
+      continue;
+    }
+    shifted = (gint64) running_time + (gint64) (frame->running_time -
+        captured_pts);
+    frame->running_time = shifted > 0 ? (GstClockTime) shifted : 0;
+  }
+}
+
+static GstBuffer *
+gst_nv_replay_src_wrap_record (GstNvReplaySrc * self,
+    const std::shared_ptr<nvgst::CaptureReader> & reader)
+{
+  const nvgst::CaptureRecord *record = self->record;
+  GstBuffer *buffer = gst_buffer_new ();
+  std::vector<GstBuffer *> frames;
+
+  /* the first data block is the buffer's own memory, the others hold the
+   * frames of a zero-copy batch */
+  for (const nvgst::CaptureBlock & block : record->blocks) {
+    GstBuffer *target;
+
+    if (block.type != nvgst::kCaptureDataBlock)
+      continue;
+    target = frames.empty () ? buffer : gst_buffer_new ();
+    if (block.size > 0)
+      gst_buffer_append_memory (target, gst_nv_replay_src_wrap (reader, block));
+    frames.push_back (target);
+  }
+  if (frames.empty ())
+    frames.push_back (buffer);
+  gst_nv_capture_read_metas (buffer, record, frames, reader);
+  /* the batch meta holds its own references */
+  for (gsize i = 1; i < frames.size (); i++)
+    gst_buffer_unref (frames[i]);
+
+  GST_BUFFER_PTS (buffer) = gst_nv_replay_src_shift (self, record->info.pts);
+  GST_BUFFER_DTS (buffer) = gst_nv_replay_src_shift (self, record->info.dts);
+  GST_BUFFER_DURATION (buffer) = record->info.duration;
+  GST_BUFFER_OFFSET (buffer) = record->info.offset;
+  GST_BUFFER_OFFSET_END (buffer) = record->info.offset_end;
+  GST_BUFFER_FLAGS (buffer) = record->info.flags;
+  gst_nv_replay_src_rebase_batch (self, buffer, record->info.pts);
+  return buffer;
+}
+
+/* Waits until the system clock is as far from the start of pacing as @pts
+ * is from the pts pacing started from. */
+static GstFlowReturn
+gst_nv_replay_src_pace (GstNvReplaySrc * self, GstClockTime pts)
+{
+  GstClock *clock;
+  GstClockID id;
+  GstClockReturn ret;
+
+  if (!GST_CLOCK_TIME_IS_VALID (pts))
+    return GST_FLOW_OK;
+
+  clock = gst_system_clock_obtain ();
+  if (!GST_CLOCK_TIME_IS_VALID (self->pace_pts)) {
+    self->pace_pts = pts;
+    self->pace_time = gst_clock_get_time (clock);
+    gst_object_unref (clock);
+    return GST_FLOW_OK;
+  }
+  if (pts <= self->pace_pts) {
+    gst_object_unref (clock);
+    return GST_FLOW_OK;
+  }
+
+  id = gst_clock_new_single_shot_id (clock,
+      self->pace_time + (pts - self->pace_pts));
+  gst_object_unref (clock);
+
+  GST_OBJECT_LOCK (self);
+  if (self->flushing) {
+    GST_OBJECT_UNLOCK (self);
+    gst_clock_id_unref (id);
+    return GST_FLOW_FLUSHING;
+  }
+  self->clock_id = id;
+  GST_OBJECT_UNLOCK (self);
+
+  ret = gst_clock_id_wait (id, NULL);
+
+  GST_OBJECT_LOCK (self);
+  self->clock_id = NULL;
+  GST_OBJECT_UNLOCK (self);
+  gst_clock_id_unref (id);
+
+  return ret == GST_CLOCK_UNSCHEDULED ? GST_FLOW_FLUSHING : GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_nv_replay_src_create (GstPushSrc * src, GstBuffer ** buffer)
+{
+  GstNvReplaySrc *self = GST_NV_REPLAY_SRC (src);
+  std::shared_ptr<nvgst::CaptureReader> reader = *self->reader;
+  GstNvReplayTiming timing;
+  guint loops, read_ahead;
+  gboolean preload;
+  GstFlowReturn ret;
+  gsize index;
+  glong caps;
+
+  GST_OBJECT_LOCK (self);
+  timing = self->timing;
+  loops = self->loops;
+  preload = self->preload;
+  read_ahead = self->read_ahead;
+  GST_OBJECT_UNLOCK (self);
+
+  for (;;) {
+    if (self->next >= reader->size ()) {
+      /* a file without buffers would loop forever */
+      if ((loops != 0 && self->loop + 1 >= loops)
+          || !GST_CLOCK_TIME_IS_VALID (self->first_pts))
+        return GST_FLOW_EOS;
+      self->loop++;
+      self->loop_offset += self->span;
+      self->next = 0;
+      self->prefetched = 0;
+      GST_DEBUG_OBJECT (self, "pass %u", self->loop + 1);
+    }
+
+    index = self->next++;
+    if (reader->entry (index).kind !=
+        (guint32) nvgst::CaptureRecordKind::kBuffer)
+      continue;
+
+    /* also picks up the right caps after a seek or at a new pass */
+    caps = reader->caps_before (index);
+    if (caps >= 0 && caps != self->caps_record
+        && !gst_nv_replay_src_update_caps (self, reader, caps))
+      return GST_FLOW_NOT_NEGOTIATED;
+
+    if (!preload && read_ahead > 0
+        && index + read_ahead / 2 >= self->prefetched) {
+      reader->prefetch (MAX (index, self->prefetched), read_ahead);
+      self->prefetched = MAX (index, self->prefetched) + read_ahead;
+    }
+
+    if (!reader->read (index, self->record)) {
+      GST_ELEMENT_ERROR (self, STREAM, DECODE, (NULL),
+          ("capture record %" G_GSIZE_FORMAT " is damaged", index));
+      return GST_FLOW_ERROR;
+    }
+    *buffer = gst_nv_replay_src_wrap_record (self, reader);
+
+    if (timing == GST_NV_REPLAY_TIMING_ORIGINAL) {
+      ret = gst_nv_replay_src_pace (self, GST_BUFFER_PTS (*buffer));
+      if (ret != GST_FLOW_OK) {
+        gst_clear_buffer (buffer);
+        return ret;
+      }
+    }
+    return GST_FLOW_OK;
+  }
+}
@@ -0,0 +1,81 @@
+#ifndef __GST_NV_REPLAY_SRC_H__
+#define __GST_NV_REPLAY_SRC_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstpushsrc.h>
+
+#include <memory>
+
+#include "core/capture.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+  GST_NV_REPLAY_TIMING_FAST,
+  GST_NV_REPLAY_TIMING_ORIGINAL,
+} GstNvReplayTiming;
+
+#define GST_TYPE_NV_REPLAY_TIMING (gst_nv_replay_timing_get_type ())
+GType gst_nv_replay_timing_get_type (void);
+
+#define GST_TYPE_NV_REPLAY_SRC \
+  (gst_nv_replay_src_get_type())
+#define GST_NV_REPLAY_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_REPLAY_SRC,GstNvReplaySrc))
+#define GST_NV_REPLAY_SRC_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_REPLAY_SRC,GstNvReplaySrcClass))
+#define GST_IS_NV_REPLAY_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_REPLAY_SRC))
+
+typedef struct _GstNvReplaySrc GstNvReplaySrc;
+typedef struct _GstNvReplaySrcClass GstNvReplaySrcClass;
+
+struct _GstNvReplaySrc
+{
+  GstPushSrc parent;
+
+  /* properties, protected by the object lock */
+  gchar *location;
+  GstNvReplayTiming timing;
+  guint loops;
+  gboolean preload;
+  guint read_ahead;
+
+  /* between start() and stop(); buffers still downstream share ownership
+   * so the file stays mapped */
+  std::shared_ptr<nvgst::CaptureReader> *reader;
+
+  /* the pacing wait in progress, protected by the object lock */
+  GstClockID clock_id;
+  gboolean flushing;
+
+  /* streaming thread, or do_seek() with the stream lock held */
+  nvgst::CaptureRecord *record;
+  gsize next;
+  guint loop;
+  /* timestamps of the first buffer and the end of the last; every loop
+   * adds their difference to the timestamps */
+  GstClockTime first_pts;
+  GstClockTime span;
+  GstClockTime loop_offset;
+  /* caps record in use, -1 before the first */
+  glong caps_record;
+  /* records the kernel was asked to read ahead up to */
+  gsize prefetched;
+  /* pts and clock time of the buffer pacing started from */
+  GstClockTime pace_pts;
+  GstClockTime pace_time;
+};
+
+struct _GstNvReplaySrcClass
+{
+  GstPushSrcClass parent_class;
+};
+
+GType gst_nv_replay_src_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvreplaysrc);
+
+G_END_DECLS
+
+#endif /* __GST_NV_REPLAY_SRC_H__ */
@@ -0,0 +1,103 @@
+#include "gstnvroimeta.h"
+
+GType
+gst_nv_roi_meta_api_get_type (void)
+{
+  static GType type = 0;
+  static const gchar *tags[] = { GST_META_TAG_VIDEO_STR, NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = gst_meta_api_type_register ("GstNvRoiMetaAPI", tags);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+static gboolean
+gst_nv_roi_meta_init (GstMeta * meta, gpointer params, GstBuffer * buffer)
+{
+  GstNvRoiMeta *rmeta = (GstNvRoiMeta *) meta;
+
+  rmeta->tensor = 0;
+  rmeta->rois = new std::vector < GstNvRoiRef > ();
+
+  return TRUE;
+}
+
+static void
+gst_nv_roi_meta_free (GstMeta * meta, GstBuffer * buffer)
+{
+  GstNvRoiMeta *rmeta = (GstNvRoiMeta *) meta;
+
+  delete rmeta->rois;
+  rmeta->rois = NULL;
+}
+
+/* Goes wherever the tensor and object metas go: full copies only. */
+static gboolean
+gst_nv_roi_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstNvRoiMeta *src = (GstNvRoiMeta *) meta;
+  GstNvRoiMeta *rmeta;
+  GstMetaTransformCopy *copy;
+
+  if (!GST_META_TRANSFORM_IS_COPY (type))
+    return FALSE;
+
+  copy = (GstMetaTransformCopy *) data;
+  if (copy->region)
+    return FALSE;
+
+  rmeta = gst_buffer_add_nv_roi_meta (dest, g_quark_to_string (src->tensor));
+  if (rmeta == NULL)
+    return FALSE;
+
+  *rmeta->rois = *src->rois;
+
+  return TRUE;
+}
+
+const GstMetaInfo *
+gst_nv_roi_meta_get_info (void)
+{
+  static const GstMetaInfo *info = NULL;
+
+  if (g_once_init_enter (&info)) {
+    const GstMetaInfo *tmp = gst_meta_register (GST_NV_ROI_META_API_TYPE,
+        "GstNvRoiMeta", sizeof (GstNvRoiMeta),
+        gst_nv_roi_meta_init, gst_nv_roi_meta_free,
+        gst_nv_roi_meta_transform);
+    g_once_init_leave (&info, tmp);
+  }
+  return info;
+}
+
+GstNvRoiMeta *
+gst_buffer_add_nv_roi_meta (GstBuffer * buffer, const gchar * tensor)
+{
+  GstNvRoiMeta *rmeta = (GstNvRoiMeta *) gst_buffer_add_meta (buffer,
+      GST_NV_ROI_META_INFO, NULL);
+
+  if (rmeta != NULL)
+    rmeta->tensor = g_quark_from_string (tensor);
+  return rmeta;
+}
+
+GstNvRoiMeta *
+gst_buffer_find_nv_roi_meta (GstBuffer * buffer, const gchar * tensor)
+{
+  GQuark name = g_quark_try_string (tensor);
+  gpointer state = NULL;
+  GstMeta *meta;
+
+  if (name == 0)
+    return NULL;
+
+  while ((meta = gst_buffer_iterate_meta_filtered (buffer, &state,
+              GST_NV_ROI_META_API_TYPE)) != NULL) {
+    if (((GstNvRoiMeta *) meta)->tensor == name)
+      return (GstNvRoiMeta *) meta;
+  }
+  return NULL;
+}
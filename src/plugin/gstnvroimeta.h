@@ -0,0 +1,62 @@
+/* Back-references from the rows of an nvroipack tensor to the objects
+ * they were cropped from. */
+#ifndef __GST_NV_ROI_META_H__
+#define __GST_NV_ROI_META_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include <vector>
+
+G_BEGIN_DECLS
+
+typedef struct _GstNvRoiRef GstNvRoiRef;
+typedef struct _GstNvRoiMeta GstNvRoiMeta;
+
+/**
+ * GstNvRoiRef:
+ * @object: index of the object in the buffer's #GstNvObjectMeta
+ * @frame: frame the crop was taken from, 0 on single frames
+ * @track_id: track id of the object at packing time, to check that
+ *     @object still names the same one
+ */
+struct _GstNvRoiRef
+{
+  guint object;
+  guint frame;
+  guint64 track_id;
+};
+
+/**
+ * GstNvRoiMeta:
+ * @meta: parent #GstMeta
+ * @tensor: name of the #GstNvTensorMeta tensor the rows belong to
+ * @rois: one entry per row of the tensor, in row order, owned by the meta
+ */
+struct _GstNvRoiMeta
+{
+  GstMeta meta;
+
+  GQuark tensor;
+  std::vector<GstNvRoiRef> *rois;
+};
+
+GType gst_nv_roi_meta_api_get_type (void);
+#define GST_NV_ROI_META_API_TYPE (gst_nv_roi_meta_api_get_type ())
+
+const GstMetaInfo *gst_nv_roi_meta_get_info (void);
+#define GST_NV_ROI_META_INFO (gst_nv_roi_meta_get_info ())
+
+#define gst_buffer_get_nv_roi_meta(b) \
+  ((GstNvRoiMeta *) gst_buffer_get_meta ((b), GST_NV_ROI_META_API_TYPE))
+
+GstNvRoiMeta *gst_buffer_add_nv_roi_meta (GstBuffer * buffer,
+    const gchar * tensor);
+
+/* The meta of @buffer describing tensor @tensor, or NULL. */
+GstNvRoiMeta *gst_buffer_find_nv_roi_meta (GstBuffer * buffer,
+    const gchar * tensor);
+
+G_END_DECLS
+
+#endif /* __GST_NV_ROI_META_H__ */
@@ -0,0 +1,624 @@
+/**
+ * SECTION:element-nvroipack
+ *
+ * Prepares the objects of every frame for a secondary network in one go:
+ * each box of the buffer's #GstNvObjectMeta is cropped, scaled to the
+ * network size, converted and normalized straight from the frame, and all
+ * of them are packed into a single NCHW float tensor attached as a
+ * #GstNvTensorMeta. A #GstNvRoiMeta tells for each row of the tensor which
+ * object it came from, so results can be written back to the right one.
+ *
+ * On nvbatchmux batches the objects of all frames go into the same
+ * tensor. Crops are cut into slices of rows that run on a pool of threads
+ * with SIMD kernels, and tensors come from blocks of max-rois ROIs that
+ * are reused once downstream lets go of them. Buffers without any object
+ * to pack pass unchanged.
+ *
+ * Objects can be chosen by class and size; with skip-classifier set,
+ * objects that already carry that classifier's attribute, for example one
+ * filled in by nvclassifycache, are left out.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 filesrc location=street.mp4 ! decodebin ! nvconvert ! \
+ *     video/x-raw,format=NV12 ! nvinfer ! nvpostprocess ! nvtracker ! \
+ *     nvroipack classes=2 width=128 height=128 threads=4 ! fakesink
+ * ]|
+ */
+
+#include "gstnvroipack.h"
+#include "gstnvbatchmeta.h"
+#include "gstnvobjectmeta.h"
+#include "gstnvtensormeta.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_roi_pack_debug);
+#define GST_CAT_DEFAULT gst_nv_roi_pack_debug
+
+#define DEFAULT_WIDTH 224
+#define DEFAULT_HEIGHT 224
+#define DEFAULT_TENSOR_NAME "rois"
+#define DEFAULT_BGR FALSE
+#define DEFAULT_OFFSET 0.0f
+#define DEFAULT_SCALE (1.0f / 255.0f)
+#define DEFAULT_MIN_SIZE 16.0f
+#define DEFAULT_MAX_ROIS 32
+#define DEFAULT_SKIP_CLASSIFIER -1
+#define DEFAULT_THREADS 0
+#define DEFAULT_SIMD GST_NV_SIMD_LEVEL_AUTO
+
+enum
+{
+  PROP_0,
+  PROP_WIDTH,
+  PROP_HEIGHT,
+  PROP_TENSOR_NAME,
+  PROP_BGR,
+  PROP_OFFSETS,
+  PROP_SCALES,
+  PROP_CLASSES,
+  PROP_MIN_SIZE,
+  PROP_MAX_ROIS,
+  PROP_SKIP_CLASSIFIER,
+  PROP_THREADS,
+  PROP_SIMD,
+};
+
+#define NV_ROI_PACK_FORMATS "{ NV12, I420, RGBA, BGRx }"
+
+#define NV_ROI_PACK_CAPS \
+  GST_VIDEO_CAPS_MAKE (NV_ROI_PACK_FORMATS) "; " \
+  GST_NV_BATCH_CAPS_MAKE (NV_ROI_PACK_FORMATS)
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_ROI_PACK_CAPS));
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_ROI_PACK_CAPS));
+
+#define gst_nv_roi_pack_parent_class parent_class
+G_DEFINE_TYPE (GstNvRoiPack, gst_nv_roi_pack, GST_TYPE_BASE_TRANSFORM);
+GST_ELEMENT_REGISTER_DEFINE (nvroipack, "nvroipack", GST_RANK_NONE,
+    GST_TYPE_NV_ROI_PACK);
+
+static void gst_nv_roi_pack_finalize (GObject * object);
+static void gst_nv_roi_pack_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_roi_pack_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static gboolean gst_nv_roi_pack_stop (GstBaseTransform * trans);
+static gboolean gst_nv_roi_pack_set_caps (GstBaseTransform * trans,
+    GstCaps * incaps, GstCaps * outcaps);
+static GstFlowReturn gst_nv_roi_pack_transform_ip (GstBaseTransform * trans,
+    GstBuffer * buffer);
+
+static void
+gst_nv_roi_pack_class_init (GstNvRoiPackClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_roi_pack_debug, "nvroipack", 0,
+      "nvroipack element");
+
+  gobject_class->finalize = gst_nv_roi_pack_finalize;
+  gobject_class->set_property = gst_nv_roi_pack_set_property;
+  gobject_class->get_property = gst_nv_roi_pack_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_WIDTH,
+      g_param_spec_uint ("width", "Width",
+          "Width every ROI is scaled to", 1, 4096, DEFAULT_WIDTH,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_HEIGHT,
+      g_param_spec_uint ("height", "Height",
+          "Height every ROI is scaled to", 1, 4096, DEFAULT_HEIGHT,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_TENSOR_NAME,
+      g_param_spec_string ("tensor-name", "Tensor name",
+          "Name of the packed tensor in GstNvTensorMeta and GstNvRoiMeta",
+          DEFAULT_TENSOR_NAME,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_BGR,
+      g_param_spec_boolean ("bgr", "BGR",
+          "Pack B, G, R planes instead of R, G, B", DEFAULT_BGR,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_OFFSETS,
+      g_param_spec_string ("offsets", "Offsets",
+          "Per-plane values subtracted from 0-255 samples, as \"a,b,c\" in "
+          "plane order",
+          "0,0,0", (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SCALES,
+      g_param_spec_string ("scales", "Scales",
+          "Per-plane factors applied after the offsets, as \"a,b,c\" in "
+          "plane order",
+          "0.00392157,0.00392157,0.00392157",
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CLASSES,
+      g_param_spec_string ("classes", "Classes",
+          "Comma-separated class ids of the objects to pack (all when unset)",
+          NULL, (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MIN_SIZE,
+      g_param_spec_float ("min-size", "Minimum size",
+          "Objects narrower or shorter than this many pixels are left out",
+          0.0f, G_MAXFLOAT, DEFAULT_MIN_SIZE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_ROIS,
+      g_param_spec_uint ("max-rois", "Maximum ROIs",
+          "ROIs packed per buffer, in object order; further objects are "
+          "left out", 1, 1024, DEFAULT_MAX_ROIS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SKIP_CLASSIFIER,
+      g_param_spec_int ("skip-classifier", "Skip classifier",
+          "Leave out objects that already have an attribute from this "
+          "classifier id (-1 = pack them all)",
+          -1, G_MAXINT, DEFAULT_SKIP_CLASSIFIER,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_THREADS,
+      g_param_spec_uint ("threads", "Threads",
+          "Threads packing ROI slices, including the streaming thread "
+          "(0 = one per CPU)", 0, 64, DEFAULT_THREADS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SIMD,
+      g_param_spec_enum ("simd", "SIMD",
+          "Highest SIMD level to use, capped at what the CPU supports",
+          GST_TYPE_NV_SIMD_LEVEL, DEFAULT_SIMD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV ROI pack", "Filter/Converter/Video",
+      "Crops, scales and normalizes the objects of all frames into one "
+      "NCHW tensor for a secondary network, with per-row back-references",
+      "nv_gst_plugins developers");
+
+  trans_class->stop = GST_DEBUG_FUNCPTR (gst_nv_roi_pack_stop);
+  trans_class->set_caps = GST_DEBUG_FUNCPTR (gst_nv_roi_pack_set_caps);
+  trans_class->transform_ip = GST_DEBUG_FUNCPTR (gst_nv_roi_pack_transform_ip);
+  trans_class->passthrough_on_same_caps = FALSE;
+}
+
+static void
+gst_nv_roi_pack_init (GstNvRoiPack * self)
+{
+  self->width = DEFAULT_WIDTH;
+  self->height = DEFAULT_HEIGHT;
+  self->tensor_name = g_strdup (DEFAULT_TENSOR_NAME);
+  self->bgr = DEFAULT_BGR;
+  for (gint c = 0; c < 3; c++) {
+    self->offsets[c] = DEFAULT_OFFSET;
+    self->scales[c] = DEFAULT_SCALE;
+  }
+  self->classes = NULL;
+  self->min_size = DEFAULT_MIN_SIZE;
+  self->max_rois = DEFAULT_MAX_ROIS;
+  self->skip_classifier = DEFAULT_SKIP_CLASSIFIER;
+  self->threads = DEFAULT_THREADS;
+  self->simd = DEFAULT_SIMD;
+  self->reconfigure = TRUE;
+
+  gst_video_info_init (&self->info);
+  self->batched = FALSE;
+  self->tensor = NULL;
+  self->class_ids = new std::vector < gint > ();
+  self->roi_min_size = DEFAULT_MIN_SIZE;
+  self->roi_limit = DEFAULT_MAX_ROIS;
+  self->skip_id = DEFAULT_SKIP_CLASSIFIER;
+  self->packer = new nvgst::RoiPacker ();
+  self->pool = new nvgst::ThreadPool ();
+  self->arena = new std::shared_ptr < nvgst::TensorPool > ();
+  self->rois = new std::vector < nvgst::Roi > ();
+  self->refs = new std::vector < GstNvRoiRef > ();
+
+  gst_base_transform_set_in_place (GST_BASE_TRANSFORM (self), TRUE);
+}
+
+static void
+gst_nv_roi_pack_finalize (GObject * object)
+{
+  GstNvRoiPack *self = GST_NV_ROI_PACK (object);
+
+  delete self->refs;
+  delete self->rois;
+  delete self->arena;
+  delete self->pool;
+  delete self->packer;
+  delete self->class_ids;
+  g_free (self->tensor);
+  g_free (self->classes);
+  g_free (self->tensor_name);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_roi_pack_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvRoiPack *self = GST_NV_ROI_PACK (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_WIDTH:
+      self->width = g_value_get_uint (value);
+      break;
+    case PROP_HEIGHT:
+      self->height = g_value_get_uint (value);
+      break;
+    case PROP_TENSOR_NAME:
+      g_free (self->tensor_name);
+      self->tensor_name = g_value_dup_string (value);
+      break;
+    case PROP_BGR:
+      self->bgr = g_value_get_boolean (value);
+      break;
+    case PROP_OFFSETS:
+      if (!gst_nv_parse_triplet (g_value_get_string (value), self->offsets))
+        GST_WARNING_OBJECT (self, "offsets must be three numbers \"a,b,c\"");
+      break;
+    case PROP_SCALES:
+      if (!gst_nv_parse_triplet (g_value_get_string (value), self->scales))
+        GST_WARNING_OBJECT (self, "scales must be three numbers \"a,b,c\"");
+      break;
+    case PROP_CLASSES:
+      g_free (self->classes);
+      self->classes = g_value_dup_string (value);
+      break;
+    case PROP_MIN_SIZE:
+      self->min_size = g_value_get_float (value);
+      break;
+    case PROP_MAX_ROIS:
+      self->max_rois = g_value_get_uint (value);
+      break;
+    case PROP_SKIP_CLASSIFIER:
+      self->skip_classifier = g_value_get_int (value);
+      break;
+    case PROP_THREADS:
+      self->threads = g_value_get_uint (value);
+      break;
+    case PROP_SIMD:
+      self->simd = (GstNvSimdLevel) g_value_get_enum (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      GST_OBJECT_UNLOCK (self);
+      return;
+  }
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_roi_pack_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstNvRoiPack *self = GST_NV_ROI_PACK (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_WIDTH:
+      g_value_set_uint (value, self->width);
+      break;
+    case PROP_HEIGHT:
+      g_value_set_uint (value, self->height);
+      break;
+    case PROP_TENSOR_NAME:
+      g_value_set_string (value, self->tensor_name);
+      break;
+    case PROP_BGR:
+      g_value_set_boolean (value, self->bgr);
+      break;
+    case PROP_OFFSETS:
+      g_value_take_string (value, gst_nv_format_triplet (self->offsets));
+      break;
+    case PROP_SCALES:
+      g_value_take_string (value, gst_nv_format_triplet (self->scales));
+      break;
+    case PROP_CLASSES:
+      g_value_set_string (value, self->classes);
+      break;
+    case PROP_MIN_SIZE:
+      g_value_set_float (value, self->min_size);
+      break;
+    case PROP_MAX_ROIS:
+      g_value_set_uint (value, self->max_rois);
+      break;
+    case PROP_SKIP_CLASSIFIER:
+      g_value_set_int (value, self->skip_classifier);
+      break;
+    case PROP_THREADS:
+      g_value_set_uint (value, self->threads);
+      break;
+    case PROP_SIMD:
+      g_value_set_enum (value, self->simd);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static gboolean
+gst_nv_roi_pack_stop (GstBaseTransform * trans)
+{
+  GstNvRoiPack *self = GST_NV_ROI_PACK (trans);
+
+  self->pool->stop ();
+  self->arena->reset ();
+
+  GST_OBJECT_LOCK (self);
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  return TRUE;
+}
+
+static gboolean
+gst_nv_roi_pack_set_caps (GstBaseTransform * trans, GstCaps * incaps,
+    GstCaps * outcaps)
+{
+  GstNvRoiPack *self = GST_NV_ROI_PACK (trans);
+  GstCapsFeatures *features = gst_caps_get_features (incaps, 0);
+
+  if (!gst_video_info_from_caps (&self->info, incaps)) {
+    GST_ERROR_OBJECT (self, "invalid caps %" GST_PTR_FORMAT, incaps);
+    return FALSE;
+  }
+  self->batched = features != NULL &&
+      gst_caps_features_contains (features, GST_CAPS_FEATURE_META_GST_NV_BATCH);
+
+  GST_OBJECT_LOCK (self);
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  return TRUE;
+}
+
+/* Takes property and caps changes into the packer, the thread pool and
+ * the tensor arena. */
+static gboolean
+gst_nv_roi_pack_apply_config (GstNvRoiPack * self)
+{
+  nvgst::RoiPackConfig config;
+  GstNvSimdLevel simd;
+  gboolean parsed;
+  guint threads;
+  size_t count;
+
+  GST_OBJECT_LOCK (self);
+  if (!self->reconfigure) {
+    GST_OBJECT_UNLOCK (self);
+    return TRUE;
+  }
+  config.out_width = (int) self->width;
+  config.out_height = (int) self->height;
+  config.bgr = self->bgr;
+  for (gint c = 0; c < 3; c++) {
+    config.offset[c] = self->offsets[c];
+    config.scale[c] = self->scales[c];
+  }
+  g_free (self->tensor);
+  self->tensor = g_strdup (self->tensor_name ? self->tensor_name : "");
+  parsed = gst_nv_parse_class_ids (self->classes, self->class_ids);
+  self->roi_min_size = self->min_size;
+  self->roi_limit = self->max_rois;
+  self->skip_id = self->skip_classifier;
+  threads = self->threads;
+  simd = self->simd;
+  self->reconfigure = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  if (!parsed) {
+    GST_ERROR_OBJECT (self, "classes must look like \"0,2,7\"");
+    return FALSE;
+  }
+
+  config.format =
+      gst_nv_pixel_format_from_video_format (GST_VIDEO_INFO_FORMAT
+      (&self->info));
+  config.width = GST_VIDEO_INFO_WIDTH (&self->info);
+  config.height = GST_VIDEO_INFO_HEIGHT (&self->info);
+  config.matrix = gst_nv_color_matrix_from_video_info (&self->info);
+  config.simd = gst_nv_simd_level_resolve (simd);
+  if (!self->packer->configure (config))
+    return FALSE;
+
+  if (threads == 0)
+    threads = g_get_num_processors ();
+  if (!self->pool->start ((int) threads))
+    return FALSE;
+
+  count = self->packer->roi_size () * self->roi_limit;
+  if (!*self->arena || (*self->arena)->count () != count)
+    *self->arena = nvgst::TensorPool::create (count);
+
+  GST_INFO_OBJECT (self, "%s %dx%d objects into %dx%d \"%s\" tensors of up "
+      "to %u ROIs, %d threads, using %s kernels",
+      nvgst::format_name (config.format), config.width, config.height,
+      config.out_width, config.out_height, self->tensor, self->roi_limit,
+      self->pool->size (), nvgst::simd_level_name (config.simd));
+
+  return TRUE;
+}
+
+static gboolean
+gst_nv_roi_pack_wanted (GstNvRoiPack * self,
+    const nvgst::DetectedObject & object, guint n_frames)
+{
+  if (object.frame >= n_frames)
+    return FALSE;
+  if (object.width < self->roi_min_size || object.height < self->roi_min_size)
+    return FALSE;
+  if (!self->class_ids->empty () &&
+      std::find (self->class_ids->begin (), self->class_ids->end (),
+          object.class_id) == self->class_ids->end ())
+    return FALSE;
+  return self->skip_id < 0 ||
+      nvgst::find_attribute (object, self->skip_id) == NULL;
+}
+
+/* Collects the ROIs to pack and marks the frames they need mapped. */
+static void
+gst_nv_roi_pack_select (GstNvRoiPack * self, const nvgst::ObjectList & objects,
+    guint n_frames, gboolean * used)
+{
+  guint skipped = 0;
+
+  self->rois->clear ();
+  self->refs->clear ();
+  for (size_t i = 0; i < objects.size (); i++) {
+    const nvgst::DetectedObject & object = objects[i];
+
+    if (!gst_nv_roi_pack_wanted (self, object, n_frames))
+      continue;
+    if (self->rois->size () >= self->roi_limit) {
+      skipped++;
+      continue;
+    }
+    self->rois->push_back ({(int) object.frame, object.x, object.y,
+            object.width, object.height});
+    self->refs->push_back ({(guint) i, object.frame, object.track_id});
+    used[object.frame] = TRUE;
+  }
+
+  if (skipped > 0)
+    GST_DEBUG_OBJECT (self, "left out %u objects over max-rois", skipped);
+}
+
+/* Packs the selected ROIs into a fresh arena block and attaches it with
+ * its back-references. */
+static GstFlowReturn
+gst_nv_roi_pack_attach (GstNvRoiPack * self, GstBuffer * buffer,
+    const nvgst::FrameView * views)
+{
+  const nvgst::RoiPackConfig & config = self->packer->config ();
+  GstNvTensorMeta *tmeta;
+  GstNvRoiMeta *rmeta;
+  nvgst::Tensor tensor;
+
+  tensor.data = (*self->arena)->acquire ();
+  if (!tensor.data || !self->packer->run (views, self->rois->data (),
+          (int) self->rois->size (), tensor.data.get (), self->pool)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, NO_SPACE_LEFT, (NULL),
+        ("failed to allocate a tensor for %" G_GSIZE_FORMAT " ROIs",
+            self->rois->size ()));
+    return GST_FLOW_ERROR;
+  }
+  tensor.info.name = self->tensor;
+  tensor.info.shape = { (int) self->rois->size (), 3, config.out_height,
+    config.out_width
+  };
+
+  tmeta = gst_buffer_get_nv_tensor_meta (buffer);
+  if (tmeta == NULL)
+    tmeta = gst_buffer_add_nv_tensor_meta (buffer);
+  tmeta->tensors->push_back (std::move (tensor));
+
+  rmeta = gst_buffer_add_nv_roi_meta (buffer, self->tensor);
+  *rmeta->rois = *self->refs;
+
+  GST_LOG_OBJECT (self, "packed %" G_GSIZE_FORMAT " ROIs",
+      self->rois->size ());
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_nv_roi_pack_process_batch (GstNvRoiPack * self, GstBuffer * buffer,
+    const nvgst::ObjectList & objects)
+{
+  GstNvBatchMeta *bmeta = gst_buffer_get_nv_batch_meta (buffer);
+  gboolean used[GST_NV_BATCH_MAX_FRAMES] = { FALSE };
+  nvgst::FrameView views[GST_NV_BATCH_MAX_FRAMES];
+  GstMapInfo maps[GST_NV_BATCH_MAX_FRAMES];
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint mapped = 0;
+
+  if (bmeta == NULL) {
+    GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
+        ("batched buffer without GstNvBatchMeta"));
+    return GST_FLOW_ERROR;
+  }
+
+  gst_nv_roi_pack_select (self, objects, bmeta->n_frames, used);
+  if (self->rois->empty ())
+    return GST_FLOW_OK;
+
+  for (; mapped < bmeta->n_frames; mapped++) {
+    if (!used[mapped])
+      continue;
+    if (!gst_nv_batch_meta_map_frame (bmeta, buffer, mapped, &maps[mapped],
+            GST_MAP_READ)) {
+      GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL),
+          ("failed to map frame %u of the batch", mapped));
+      ret = GST_FLOW_ERROR;
+      break;
+    }
+    views[mapped] = gst_nv_batch_frame_view (&bmeta->frames[mapped],
+        &self->info, &maps[mapped]);
+  }
+
+  if (ret == GST_FLOW_OK)
+    ret = gst_nv_roi_pack_attach (self, buffer, views);
+
+  for (guint i = 0; i < mapped; i++) {
+    if (used[i])
+      gst_nv_batch_meta_unmap_frame (bmeta, buffer, i, &maps[i]);
+  }
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_nv_roi_pack_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
+{
+  GstNvRoiPack *self = GST_NV_ROI_PACK (trans);
+  GstNvObjectMeta *ometa;
+  GstFlowReturn ret;
+  gboolean used = FALSE;
+  nvgst::FrameView view;
+  GstVideoFrame frame;
+
+  if (!gst_nv_roi_pack_apply_config (self)) {
+    GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS, (NULL),
+        ("invalid ROI pack configuration"));
+    return GST_FLOW_ERROR;
+  }
+
+  ometa = gst_buffer_get_nv_object_meta (buffer);
+  if (ometa == NULL || ometa->objects->empty ())
+    return GST_FLOW_OK;
+
+  if (self->batched)
+    return gst_nv_roi_pack_process_batch (self, buffer, *ometa->objects);
+
+  gst_nv_roi_pack_select (self, *ometa->objects, 1, &used);
+  if (self->rois->empty ())
+    return GST_FLOW_OK;
+
+  if (!gst_video_frame_map (&frame, &self->info, buffer, GST_MAP_READ)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL), ("failed to map frame"));
+    return GST_FLOW_ERROR;
+  }
+  view = gst_nv_frame_view_from_video_frame (&frame);
+  ret = gst_nv_roi_pack_attach (self, buffer, &view);
+  gst_video_frame_unmap (&frame);
+
+  return ret;
+}
@@ -0,0 +1,79 @@
+#ifndef __GST_NV_ROI_PACK_H__
+#define __GST_NV_ROI_PACK_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include <gst/video/video.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "gstnvutils.h"
+#include "gstnvroimeta.h"
+#include "core/roi_pack.h"
+#include "core/tensor.h"
+#include "core/thread_pool.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_NV_ROI_PACK \
+  (gst_nv_roi_pack_get_type())
+#define GST_NV_ROI_PACK(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_ROI_PACK,GstNvRoiPack))
+#define GST_NV_ROI_PACK_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_ROI_PACK,GstNvRoiPackClass))
+#define GST_IS_NV_ROI_PACK(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_ROI_PACK))
+
+typedef struct _GstNvRoiPack GstNvRoiPack;
+typedef struct _GstNvRoiPackClass GstNvRoiPackClass;
+
+struct _GstNvRoiPack
+{
+  GstBaseTransform parent;
+
+  /* properties, protected by the object lock */
+  guint width;
+  guint height;
+  gchar *tensor_name;
+  gboolean bgr;
+  gfloat offsets[3];
+  gfloat scales[3];
+  gchar *classes;
+  gfloat min_size;
+  guint max_rois;
+  gint skip_classifier;
+  guint threads;
+  GstNvSimdLevel simd;
+  gboolean reconfigure;
+
+  /* streaming thread only */
+  GstVideoInfo info;
+  gboolean batched;
+  gchar *tensor;
+  /* class ids to pack, all when empty */
+  std::vector<gint> *class_ids;
+  gfloat roi_min_size;
+  guint roi_limit;
+  gint skip_id;
+  nvgst::RoiPacker *packer;
+  nvgst::ThreadPool *pool;
+  /* blocks of roi_limit ROIs; tensors downstream keep theirs alive */
+  std::shared_ptr<nvgst::TensorPool> *arena;
+  std::vector<nvgst::Roi> *rois;
+  std::vector<GstNvRoiRef> *refs;
+};
+
+struct _GstNvRoiPackClass
+{
+  GstBaseTransformClass parent_class;
+};
+
+GType gst_nv_roi_pack_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvroipack);
+
+G_END_DECLS
+
+#endif /* __GST_NV_ROI_PACK_H__ */
@@ -0,0 +1,664 @@
+/**
+ * SECTION:element-nvshmsink
+ *
+ * Hands buffers to nvshmsrc elements in other processes without copying
+ * them through a socket. Frames live in a memfd-backed ring of
+ * num-slots fixed-size slots; consumers connect to socket-path, receive the
+ * memfd once and then only get slot indices and buffer metadata, reading
+ * the frames in place.
+ *
+ * Upstream elements that accept the proposed allocator or pool write
+ * straight into the slots, so the whole path from producer to consumer is
+ * zero-copy. Other buffers are copied into a free slot once.
+ *
+ * A slot is reused only after every consumer that was sent it has released
+ * it. When no slot is free, #GstNvShmSink:backpressure decides what
+ * happens: wait for a consumer (block), take back the oldest frame no
+ * consumer has started reading (drop-oldest), or drop the new frame
+ * (drop-newest). num-slots must be larger than the number of buffers
+ * upstream holds on to.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 videotestsrc ! video/x-raw,format=NV12,width=1920,height=1080 ! \
+ *     nvshmsink socket-path=/tmp/cam0.sock backpressure=drop-oldest
+ * gst-launch-1.0 nvshmsrc socket-path=/tmp/cam0.sock ! nvconvert ! fakesink
+ * ]|
+ */
+
+#include "gstnvshmsink.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_shm_sink_debug);
+#define GST_CAT_DEFAULT gst_nv_shm_sink_debug
+
+#define DEFAULT_SOCKET_PATH "/tmp/nvshm.sock"
+#define DEFAULT_NUM_SLOTS 8
+#define DEFAULT_SLOT_SIZE 0
+#define DEFAULT_BACKPRESSURE GST_NV_SHM_BACKPRESSURE_BLOCK
+
+enum
+{
+  PROP_0,
+  PROP_SOCKET_PATH,
+  PROP_NUM_SLOTS,
+  PROP_SLOT_SIZE,
+  PROP_BACKPRESSURE,
+  PROP_DROPPED,
+  PROP_CONSUMERS,
+};
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+GType
+gst_nv_shm_backpressure_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_NV_SHM_BACKPRESSURE_BLOCK, "Wait for a consumer to release a slot",
+        "block"},
+    {GST_NV_SHM_BACKPRESSURE_DROP_OLDEST,
+        "Take back the oldest frame not yet read by any consumer",
+        "drop-oldest"},
+    {GST_NV_SHM_BACKPRESSURE_DROP_NEWEST, "Drop the new frame",
+        "drop-newest"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = g_enum_register_static ("GstNvShmBackpressure", values);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+static nvgst::ShmBackpressure
+gst_nv_shm_backpressure_to_core (GstNvShmBackpressure mode)
+{
+  switch (mode) {
+    case GST_NV_SHM_BACKPRESSURE_DROP_OLDEST:
+      return nvgst::ShmBackpressure::kDropOldest;
+    case GST_NV_SHM_BACKPRESSURE_DROP_NEWEST:
+      return nvgst::ShmBackpressure::kDropNewest;
+    case GST_NV_SHM_BACKPRESSURE_BLOCK:
+      break;
+  }
+  return nvgst::ShmBackpressure::kBlock;
+}
+
+/* Allocator handing out slot memory to upstream. Each memory holds a slot
+ * (and a ref on the allocator, which owns the producer) until it is
+ * freed. When no slot can be taken the allocation falls back to system
+ * memory and the sink copies or drops the frame at render time. */
+struct _GstNvShmSinkAllocator
+{
+  GstAllocator parent;
+
+  nvgst::ShmProducer *producer;
+  /* GstNvShmBackpressure, atomic */
+  gint backpressure;
+};
+
+typedef struct
+{
+  GstAllocatorClass parent_class;
+} GstNvShmSinkAllocatorClass;
+
+typedef struct
+{
+  GstNvShmSinkAllocator *allocator;
+  guint slot;
+} GstNvShmSlotRef;
+
+#define GST_TYPE_NV_SHM_SINK_ALLOCATOR (gst_nv_shm_sink_allocator_get_type ())
+#define GST_NV_SHM_SINK_ALLOCATOR(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_SHM_SINK_ALLOCATOR,GstNvShmSinkAllocator))
+
+GType gst_nv_shm_sink_allocator_get_type (void);
+G_DEFINE_TYPE (GstNvShmSinkAllocator, gst_nv_shm_sink_allocator,
+    GST_TYPE_ALLOCATOR);
+
+static void
+gst_nv_shm_slot_ref_free (gpointer data)
+{
+  GstNvShmSlotRef *ref = (GstNvShmSlotRef *) data;
+
+  ref->allocator->producer->release (ref->slot);
+  gst_object_unref (ref->allocator);
+  g_free (ref);
+}
+
+/* Drops the sink's ref on zero-copy memory once every consumer is done. */
+static void
+gst_nv_shm_sink_release_token (void *token)
+{
+  gst_memory_unref (GST_MEMORY_CAST (token));
+}
+
+static GstMemory *
+gst_nv_shm_sink_allocator_alloc (GstAllocator * allocator, gsize size,
+    GstAllocationParams * params)
+{
+  GstNvShmSinkAllocator *self = GST_NV_SHM_SINK_ALLOCATOR (allocator);
+  nvgst::ShmProducer *producer = self->producer;
+  GstNvShmBackpressure mode =
+      (GstNvShmBackpressure) g_atomic_int_get (&self->backpressure);
+  gsize maxsize = size + params->prefix + params->padding;
+  GstNvShmSlotRef *ref;
+  guint8 *data;
+  int slot = -1;
+
+  if (producer->configured () && maxsize <= producer->slot_size ())
+    slot = producer->acquire (gst_nv_shm_backpressure_to_core (mode));
+  if (slot < 0)
+    return gst_allocator_alloc (NULL, size, params);
+
+  data = producer->slot_data (slot);
+  if (((guintptr) data + params->prefix) & params->align) {
+    producer->release (slot);
+    return gst_allocator_alloc (NULL, size, params);
+  }
+  if (params->prefix && (params->flags & GST_MEMORY_FLAG_ZERO_PREFIXED))
+    memset (data, 0, params->prefix);
+  if (params->padding && (params->flags & GST_MEMORY_FLAG_ZERO_PADDED))
+    memset (data + params->prefix + size, 0, params->padding);
+
+  ref = g_new (GstNvShmSlotRef, 1);
+  ref->allocator = (GstNvShmSinkAllocator *) gst_object_ref (self);
+  ref->slot = slot;
+
+  return gst_memory_new_wrapped ((GstMemoryFlags) 0, data, maxsize,
+      params->prefix, size, ref, gst_nv_shm_slot_ref_free);
+}
+
+static void
+gst_nv_shm_sink_allocator_finalize (GObject * object)
+{
+  GstNvShmSinkAllocator *self = GST_NV_SHM_SINK_ALLOCATOR (object);
+
+  delete self->producer;
+  self->producer = NULL;
+
+  G_OBJECT_CLASS (gst_nv_shm_sink_allocator_parent_class)->finalize (object);
+}
+
+static void
+gst_nv_shm_sink_allocator_class_init (GstNvShmSinkAllocatorClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstAllocatorClass *allocator_class = GST_ALLOCATOR_CLASS (klass);
+
+  gobject_class->finalize = gst_nv_shm_sink_allocator_finalize;
+  /* memories are wrapped system memory, so there is no free() */
+  allocator_class->alloc = gst_nv_shm_sink_allocator_alloc;
+}
+
+static void
+gst_nv_shm_sink_allocator_init (GstNvShmSinkAllocator * self)
+{
+  GST_OBJECT_FLAG_SET (self, GST_ALLOCATOR_FLAG_CUSTOM_ALLOC);
+  self->producer = new nvgst::ShmProducer (gst_nv_shm_sink_release_token);
+}
+
+#define gst_nv_shm_sink_parent_class parent_class
+G_DEFINE_TYPE (GstNvShmSink, gst_nv_shm_sink, GST_TYPE_BASE_SINK);
+GST_ELEMENT_REGISTER_DEFINE (nvshmsink, "nvshmsink", GST_RANK_NONE,
+    GST_TYPE_NV_SHM_SINK);
+
+static void gst_nv_shm_sink_finalize (GObject * object);
+static void gst_nv_shm_sink_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_shm_sink_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static gboolean gst_nv_shm_sink_start (GstBaseSink * sink);
+static gboolean gst_nv_shm_sink_stop (GstBaseSink * sink);
+static gboolean gst_nv_shm_sink_unlock (GstBaseSink * sink);
+static gboolean gst_nv_shm_sink_unlock_stop (GstBaseSink * sink);
+static gboolean gst_nv_shm_sink_set_caps (GstBaseSink * sink, GstCaps * caps);
+static gboolean gst_nv_shm_sink_propose_allocation (GstBaseSink * sink,
+    GstQuery * query);
+static gboolean gst_nv_shm_sink_event (GstBaseSink * sink, GstEvent * event);
+static GstFlowReturn gst_nv_shm_sink_render (GstBaseSink * sink,
+    GstBuffer * buffer);
+
+static void
+gst_nv_shm_sink_class_init (GstNvShmSinkClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseSinkClass *base_sink_class = GST_BASE_SINK_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_shm_sink_debug, "nvshmsink", 0,
+      "nvshmsink element");
+
+  gobject_class->finalize = gst_nv_shm_sink_finalize;
+  gobject_class->set_property = gst_nv_shm_sink_set_property;
+  gobject_class->get_property = gst_nv_shm_sink_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_SOCKET_PATH,
+      g_param_spec_string ("socket-path", "Socket path",
+          "Unix socket consumers connect to", DEFAULT_SOCKET_PATH,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_NUM_SLOTS,
+      g_param_spec_uint ("num-slots", "Number of slots",
+          "Frames in the shared memory ring", 2, 1024, DEFAULT_NUM_SLOTS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SLOT_SIZE,
+      g_param_spec_uint ("slot-size", "Slot size",
+          "Bytes per slot (0 = size of the first frame); caps changes to "
+          "larger frames need a slot size that covers them", 0, G_MAXUINT,
+          DEFAULT_SLOT_SIZE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_BACKPRESSURE,
+      g_param_spec_enum ("backpressure", "Backpressure",
+          "What to do when every slot is in use",
+          GST_TYPE_NV_SHM_BACKPRESSURE, DEFAULT_BACKPRESSURE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_DROPPED,
+      g_param_spec_uint64 ("dropped", "Dropped",
+          "Frames dropped or taken back because of backpressure", 0,
+          G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CONSUMERS,
+      g_param_spec_uint ("consumers", "Consumers",
+          "Connected consumers", 0, nvgst::kShmMaxConsumers, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV shared memory sink", "Sink",
+      "Zero-copy frame transport to other processes through a memfd ring",
+      "nv_gst_plugins developers");
+
+  base_sink_class->start = GST_DEBUG_FUNCPTR (gst_nv_shm_sink_start);
+  base_sink_class->stop = GST_DEBUG_FUNCPTR (gst_nv_shm_sink_stop);
+  base_sink_class->unlock = GST_DEBUG_FUNCPTR (gst_nv_shm_sink_unlock);
+  base_sink_class->unlock_stop =
+      GST_DEBUG_FUNCPTR (gst_nv_shm_sink_unlock_stop);
+  base_sink_class->set_caps = GST_DEBUG_FUNCPTR (gst_nv_shm_sink_set_caps);
+  base_sink_class->propose_allocation =
+      GST_DEBUG_FUNCPTR (gst_nv_shm_sink_propose_allocation);
+  base_sink_class->event = GST_DEBUG_FUNCPTR (gst_nv_shm_sink_event);
+  base_sink_class->render = GST_DEBUG_FUNCPTR (gst_nv_shm_sink_render);
+
+  gst_type_mark_as_plugin_api (GST_TYPE_NV_SHM_BACKPRESSURE,
+      (GstPluginAPIFlags) 0);
+}
+
+static void
+gst_nv_shm_sink_init (GstNvShmSink * self)
+{
+  self->socket_path = g_strdup (DEFAULT_SOCKET_PATH);
+  self->num_slots = DEFAULT_NUM_SLOTS;
+  self->slot_size = DEFAULT_SLOT_SIZE;
+  self->backpressure = DEFAULT_BACKPRESSURE;
+}
+
+static void
+gst_nv_shm_sink_finalize (GObject * object)
+{
+  GstNvShmSink *self = GST_NV_SHM_SINK (object);
+
+  g_free (self->socket_path);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_shm_sink_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvShmSink *self = GST_NV_SHM_SINK (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_SOCKET_PATH:
+      g_free (self->socket_path);
+      self->socket_path = g_value_dup_string (value);
+      break;
+    case PROP_NUM_SLOTS:
+      self->num_slots = g_value_get_uint (value);
+      break;
+    case PROP_SLOT_SIZE:
+      self->slot_size = g_value_get_uint (value);
+      break;
+    case PROP_BACKPRESSURE:
+      self->backpressure = (GstNvShmBackpressure) g_value_get_enum (value);
+      if (self->allocator)
+        g_atomic_int_set (&self->allocator->backpressure, self->backpressure);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_shm_sink_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstNvShmSink *self = GST_NV_SHM_SINK (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_SOCKET_PATH:
+      g_value_set_string (value, self->socket_path);
+      break;
+    case PROP_NUM_SLOTS:
+      g_value_set_uint (value, self->num_slots);
+      break;
+    case PROP_SLOT_SIZE:
+      g_value_set_uint (value, self->slot_size);
+      break;
+    case PROP_BACKPRESSURE:
+      g_value_set_enum (value, self->backpressure);
+      break;
+    case PROP_DROPPED:
+      g_value_set_uint64 (value, self->dropped +
+          (self->allocator ? self->allocator->producer->dropped () : 0));
+      break;
+    case PROP_CONSUMERS:
+      g_value_set_uint (value,
+          self->allocator ? self->allocator->producer->consumers () : 0);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static gboolean
+gst_nv_shm_sink_start (GstBaseSink * sink)
+{
+  GstNvShmSink *self = GST_NV_SHM_SINK (sink);
+  GstNvShmSinkAllocator *allocator;
+  gchar *path;
+
+  allocator = (GstNvShmSinkAllocator *)
+      g_object_new (GST_TYPE_NV_SHM_SINK_ALLOCATOR, NULL);
+  gst_object_ref_sink (allocator);
+
+  GST_OBJECT_LOCK (self);
+  path = g_strdup (self->socket_path);
+  allocator->backpressure = self->backpressure;
+  GST_OBJECT_UNLOCK (self);
+
+  if (path == NULL || !allocator->producer->start (path)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ_WRITE,
+        ("Could not listen on socket %s", GST_STR_NULL (path)),
+        ("%s", g_strerror (errno)));
+    g_free (path);
+    gst_object_unref (allocator);
+    return FALSE;
+  }
+  GST_INFO_OBJECT (self, "listening on %s", path);
+  g_free (path);
+
+  GST_OBJECT_LOCK (self);
+  self->allocator = allocator;
+  self->dropped = 0;
+  GST_OBJECT_UNLOCK (self);
+
+  self->is_video = FALSE;
+  return TRUE;
+}
+
+static gboolean
+gst_nv_shm_sink_stop (GstBaseSink * sink)
+{
+  GstNvShmSink *self = GST_NV_SHM_SINK (sink);
+  GstNvShmSinkAllocator *allocator;
+
+  GST_OBJECT_LOCK (self);
+  allocator = self->allocator;
+  self->allocator = NULL;
+  if (allocator)
+    self->dropped += allocator->producer->dropped ();
+  GST_OBJECT_UNLOCK (self);
+
+  if (allocator) {
+    /* memories still out in upstream pools keep the segment mapped */
+    allocator->producer->stop ();
+    gst_object_unref (allocator);
+  }
+  return TRUE;
+}
+
+static gboolean
+gst_nv_shm_sink_unlock (GstBaseSink * sink)
+{
+  GstNvShmSink *self = GST_NV_SHM_SINK (sink);
+
+  if (self->allocator)
+    self->allocator->producer->set_flushing (true);
+  return TRUE;
+}
+
+static gboolean
+gst_nv_shm_sink_unlock_stop (GstBaseSink * sink)
+{
+  GstNvShmSink *self = GST_NV_SHM_SINK (sink);
+
+  if (self->allocator)
+    self->allocator->producer->set_flushing (false);
+  return TRUE;
+}
+
+/* Creates the segment on first use, sized for @size byte frames. */
+static gboolean
+gst_nv_shm_sink_ensure_segment (GstNvShmSink * self, gsize size)
+{
+  nvgst::ShmProducer *producer = self->allocator->producer;
+  guint num_slots;
+  gsize slot_size;
+
+  GST_OBJECT_LOCK (self);
+  num_slots = self->num_slots;
+  slot_size = MAX ((gsize) self->slot_size, size);
+  GST_OBJECT_UNLOCK (self);
+
+  if (producer->configured ()) {
+    if (size <= producer->slot_size ())
+      return TRUE;
+    GST_ELEMENT_ERROR (self, STREAM, FORMAT,
+        ("Frames of %" G_GSIZE_FORMAT " bytes do not fit the %"
+            G_GSIZE_FORMAT " byte slots", size, producer->slot_size ()),
+        ("set slot-size to cover the largest frame"));
+    return FALSE;
+  }
+
+  if (!producer->configure (num_slots, slot_size)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, NO_SPACE_LEFT,
+        ("Could not create a shared memory ring of %u x %" G_GSIZE_FORMAT
+            " bytes", num_slots, slot_size), ("%s", g_strerror (errno)));
+    return FALSE;
+  }
+  GST_INFO_OBJECT (self, "created ring of %u slots of %" G_GSIZE_FORMAT
+      " bytes", num_slots, slot_size);
+  return TRUE;
+}
+
+static gboolean
+gst_nv_shm_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
+{
+  GstNvShmSink *self = GST_NV_SHM_SINK (sink);
+  gchar *str;
+
+  self->is_video = gst_video_info_from_caps (&self->info, caps);
+  if (self->is_video
+      && !gst_nv_shm_sink_ensure_segment (self, GST_VIDEO_INFO_SIZE (&self->info)))
+    return FALSE;
+
+  str = gst_caps_to_string (caps);
+  self->allocator->producer->set_caps (str);
+  g_free (str);
+  return TRUE;
+}
+
+static gboolean
+gst_nv_shm_sink_propose_allocation (GstBaseSink * sink, GstQuery * query)
+{
+  GstNvShmSink *self = GST_NV_SHM_SINK (sink);
+  GstAllocator *allocator = GST_ALLOCATOR (self->allocator);
+  GstAllocationParams params;
+  GstCaps *caps;
+  gboolean need_pool;
+  GstVideoInfo info;
+
+  gst_query_parse_allocation (query, &caps, &need_pool);
+  if (caps == NULL || !gst_video_info_from_caps (&info, caps))
+    return FALSE;
+  if (!gst_nv_shm_sink_ensure_segment (self, GST_VIDEO_INFO_SIZE (&info)))
+    return FALSE;
+
+  gst_allocation_params_init (&params);
+
+  if (need_pool) {
+    GstBufferPool *pool = gst_video_buffer_pool_new ();
+    GstStructure *config = gst_buffer_pool_get_config (pool);
+
+    /* no max: buffers whose slots are still being read are discarded by
+     * the pool instead of recycled, and their slots come back once the
+     * consumers release them */
+    gst_buffer_pool_config_set_params (config, caps,
+        GST_VIDEO_INFO_SIZE (&info), 0, 0);
+    gst_buffer_pool_config_set_allocator (config, allocator, &params);
+    gst_buffer_pool_config_add_option (config,
+        GST_BUFFER_POOL_OPTION_VIDEO_META);
+    if (!gst_buffer_pool_set_config (pool, config)) {
+      GST_WARNING_OBJECT (self, "pool rejected the configuration");
+      gst_object_unref (pool);
+      return FALSE;
+    }
+    gst_query_add_allocation_pool (query, pool, GST_VIDEO_INFO_SIZE (&info),
+        0, 0);
+    gst_object_unref (pool);
+  }
+
+  gst_query_add_allocation_param (query, allocator, &params);
+  gst_query_add_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+  return TRUE;
+}
+
+static gboolean
+gst_nv_shm_sink_event (GstBaseSink * sink, GstEvent * event)
+{
+  GstNvShmSink *self = GST_NV_SHM_SINK (sink);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS)
+    self->allocator->producer->send_eos ();
+
+  return GST_BASE_SINK_CLASS (parent_class)->event (sink, event);
+}
+
+static void
+gst_nv_shm_sink_fill_info (GstNvShmSink * self, GstBuffer * buffer,
+    nvgst::ShmFrameInfo * info)
+{
+  GstVideoMeta *meta;
+
+  memset (info, 0, sizeof (*info));
+  info->size = gst_buffer_get_size (buffer);
+  info->pts = GST_BUFFER_PTS (buffer);
+  info->dts = GST_BUFFER_DTS (buffer);
+  info->duration = GST_BUFFER_DURATION (buffer);
+  info->offset = GST_BUFFER_OFFSET (buffer);
+  info->offset_end = GST_BUFFER_OFFSET_END (buffer);
+  info->flags = GST_BUFFER_FLAGS (buffer);
+
+  meta = gst_buffer_get_video_meta (buffer);
+  if (meta) {
+    info->n_planes = MIN (meta->n_planes, nvgst::kShmMaxPlanes);
+    for (guint i = 0; i < info->n_planes; i++) {
+      info->plane_offset[i] = meta->offset[i];
+      info->stride[i] = meta->stride[i];
+    }
+  } else if (self->is_video) {
+    info->n_planes =
+        MIN (GST_VIDEO_INFO_N_PLANES (&self->info), nvgst::kShmMaxPlanes);
+    for (guint i = 0; i < info->n_planes; i++) {
+      info->plane_offset[i] = GST_VIDEO_INFO_PLANE_OFFSET (&self->info, i);
+      info->stride[i] = GST_VIDEO_INFO_PLANE_STRIDE (&self->info, i);
+    }
+  }
+}
+
+/* Publishes the buffer without copying if its only memory is a slot that
+ * is not still in flight. */
+static gboolean
+gst_nv_shm_sink_publish_in_place (GstNvShmSink * self, GstBuffer * buffer,
+    nvgst::ShmFrameInfo * info)
+{
+  nvgst::ShmProducer *producer = self->allocator->producer;
+  gboolean published = FALSE;
+  GstMemory *mem;
+  GstMapInfo map;
+  guint32 slot;
+
+  if (gst_buffer_n_memory (buffer) != 1)
+    return FALSE;
+
+  mem = gst_buffer_peek_memory (buffer, 0);
+  if (!gst_memory_map (mem, &map, GST_MAP_READ))
+    return FALSE;
+
+  if (producer->slot_of (map.data, &slot)) {
+    info->slot = slot;
+    info->data_offset = map.data - producer->slot_data (slot);
+    info->size = map.size;
+    /* the sink's ref keeps the slot away from the pool until released */
+    published = producer->publish (*info, gst_memory_ref (mem));
+    if (!published)
+      gst_memory_unref (mem);
+  }
+  gst_memory_unmap (mem, &map);
+
+  return published;
+}
+
+static GstFlowReturn
+gst_nv_shm_sink_render (GstBaseSink * sink, GstBuffer * buffer)
+{
+  GstNvShmSink *self = GST_NV_SHM_SINK (sink);
+  nvgst::ShmProducer *producer = self->allocator->producer;
+  GstNvShmBackpressure mode;
+  nvgst::ShmFrameInfo info;
+  int slot;
+
+  if (!gst_nv_shm_sink_ensure_segment (self, gst_buffer_get_size (buffer)))
+    return GST_FLOW_ERROR;
+
+  gst_nv_shm_sink_fill_info (self, buffer, &info);
+  if (gst_nv_shm_sink_publish_in_place (self, buffer, &info))
+    return GST_FLOW_OK;
+
+  GST_OBJECT_LOCK (self);
+  mode = self->backpressure;
+  GST_OBJECT_UNLOCK (self);
+
+  slot = producer->acquire (gst_nv_shm_backpressure_to_core (mode));
+  if (slot < 0) {
+    GST_LOG_OBJECT (self, "no free slot, dropping %" GST_PTR_FORMAT, buffer);
+    GST_OBJECT_LOCK (self);
+    self->dropped++;
+    GST_OBJECT_UNLOCK (self);
+    return GST_FLOW_OK;
+  }
+
+  gst_buffer_extract (buffer, 0, producer->slot_data (slot), info.size);
+  info.slot = slot;
+  info.data_offset = 0;
+  producer->publish (info, NULL);
+  producer->release (slot);
+
+  return GST_FLOW_OK;
+}
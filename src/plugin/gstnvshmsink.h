@@ -0,0 +1,65 @@
+#ifndef __GST_NV_SHM_SINK_H__
+#define __GST_NV_SHM_SINK_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasesink.h>
+#include <gst/video/video.h>
+
+#include "core/shm_transport.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+  GST_NV_SHM_BACKPRESSURE_BLOCK,
+  GST_NV_SHM_BACKPRESSURE_DROP_OLDEST,
+  GST_NV_SHM_BACKPRESSURE_DROP_NEWEST,
+} GstNvShmBackpressure;
+
+#define GST_TYPE_NV_SHM_BACKPRESSURE (gst_nv_shm_backpressure_get_type ())
+GType gst_nv_shm_backpressure_get_type (void);
+
+#define GST_TYPE_NV_SHM_SINK \
+  (gst_nv_shm_sink_get_type())
+#define GST_NV_SHM_SINK(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_SHM_SINK,GstNvShmSink))
+#define GST_NV_SHM_SINK_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_SHM_SINK,GstNvShmSinkClass))
+#define GST_IS_NV_SHM_SINK(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_SHM_SINK))
+
+typedef struct _GstNvShmSink GstNvShmSink;
+typedef struct _GstNvShmSinkClass GstNvShmSinkClass;
+typedef struct _GstNvShmSinkAllocator GstNvShmSinkAllocator;
+
+struct _GstNvShmSink
+{
+  GstBaseSink parent;
+
+  /* properties, protected by the object lock */
+  gchar *socket_path;
+  guint num_slots;
+  guint slot_size;
+  GstNvShmBackpressure backpressure;
+  guint64 dropped;
+
+  /* between start() and stop(); owns the producer, which memories handed
+   * to upstream keep alive */
+  GstNvShmSinkAllocator *allocator;
+
+  /* streaming thread only */
+  GstVideoInfo info;
+  gboolean is_video;
+};
+
+struct _GstNvShmSinkClass
+{
+  GstBaseSinkClass parent_class;
+};
+
+GType gst_nv_shm_sink_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvshmsink);
+
+G_END_DECLS
+
+#endif /* __GST_NV_SHM_SINK_H__ */
@@ -0,0 +1,356 @@
+/**
+ * SECTION:element-nvshmsrc
+ *
+ * Receives buffers from an nvshmsink in another process (or the same one).
+ * The source connects to socket-path, maps the sink's memfd ring once and
+ * then wraps each announced slot in a read-only memory without copying.
+ * The slot goes back to the sink when the last reference to the buffer is
+ * dropped, so downstream elements that hold on to buffers throttle the
+ * sink according to its backpressure mode.
+ *
+ * Caps come from the sink. Buffers keep the sink's timestamps, offsets,
+ * stream flags (DISCONT, DELTA_UNIT, HEADER, GAP, ...) and plane layout
+ * (as #GstVideoMeta). With is-live=true and
+ * do-timestamp=true buffers are restamped with this pipeline's clock
+ * instead.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 nvshmsrc socket-path=/tmp/cam0.sock ! nvconvert ! \
+ *     video/x-raw,format=RGBA ! fakesink
+ * ]|
+ */
+
+#include "gstnvshmsrc.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_shm_src_debug);
+#define GST_CAT_DEFAULT gst_nv_shm_src_debug
+
+#define DEFAULT_SOCKET_PATH "/tmp/nvshm.sock"
+#define DEFAULT_IS_LIVE FALSE
+
+/* Buffer flags that describe the stream and so mean the same in this
+ * process. The sink's mini-object flags (locking, leak tracking) and
+ * TAG_MEMORY describe its own buffer and are not taken over. */
+#define NV_SHM_STREAM_FLAGS (GST_BUFFER_FLAG_LIVE | \
+    GST_BUFFER_FLAG_DECODE_ONLY | GST_BUFFER_FLAG_DISCONT | \
+    GST_BUFFER_FLAG_RESYNC | GST_BUFFER_FLAG_CORRUPTED | \
+    GST_BUFFER_FLAG_MARKER | GST_BUFFER_FLAG_HEADER | GST_BUFFER_FLAG_GAP | \
+    GST_BUFFER_FLAG_DROPPABLE | GST_BUFFER_FLAG_DELTA_UNIT | \
+    GST_BUFFER_FLAG_SYNC_AFTER | GST_BUFFER_FLAG_NON_DROPPABLE)
+
+enum
+{
+  PROP_0,
+  PROP_SOCKET_PATH,
+  PROP_IS_LIVE,
+  PROP_SKIPPED,
+};
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+/* Keeps the consumer (and its mapping) alive while a slot is downstream. */
+struct GstNvShmSrcSlotRef
+{
+  std::shared_ptr<nvgst::ShmConsumer> consumer;
+  guint32 slot;
+};
+
+#define gst_nv_shm_src_parent_class parent_class
+G_DEFINE_TYPE (GstNvShmSrc, gst_nv_shm_src, GST_TYPE_PUSH_SRC);
+GST_ELEMENT_REGISTER_DEFINE (nvshmsrc, "nvshmsrc", GST_RANK_NONE,
+    GST_TYPE_NV_SHM_SRC);
+
+static void gst_nv_shm_src_finalize (GObject * object);
+static void gst_nv_shm_src_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_shm_src_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static gboolean gst_nv_shm_src_start (GstBaseSrc * src);
+static gboolean gst_nv_shm_src_stop (GstBaseSrc * src);
+static gboolean gst_nv_shm_src_unlock (GstBaseSrc * src);
+static gboolean gst_nv_shm_src_unlock_stop (GstBaseSrc * src);
+static GstFlowReturn gst_nv_shm_src_create (GstPushSrc * src,
+    GstBuffer ** buffer);
+
+static void
+gst_nv_shm_src_class_init (GstNvShmSrcClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseSrcClass *base_src_class = GST_BASE_SRC_CLASS (klass);
+  GstPushSrcClass *push_src_class = GST_PUSH_SRC_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_shm_src_debug, "nvshmsrc", 0,
+      "nvshmsrc element");
+
+  gobject_class->finalize = gst_nv_shm_src_finalize;
+  gobject_class->set_property = gst_nv_shm_src_set_property;
+  gobject_class->get_property = gst_nv_shm_src_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_SOCKET_PATH,
+      g_param_spec_string ("socket-path", "Socket path",
+          "Unix socket of the nvshmsink to connect to", DEFAULT_SOCKET_PATH,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_IS_LIVE,
+      g_param_spec_boolean ("is-live", "Is live",
+          "Act as a live source", DEFAULT_IS_LIVE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SKIPPED,
+      g_param_spec_uint64 ("skipped", "Skipped",
+          "Frames the sink took back before they could be read", 0,
+          G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV shared memory source", "Source",
+      "Zero-copy frame transport from an nvshmsink through a memfd ring",
+      "nv_gst_plugins developers");
+
+  base_src_class->start = GST_DEBUG_FUNCPTR (gst_nv_shm_src_start);
+  base_src_class->stop = GST_DEBUG_FUNCPTR (gst_nv_shm_src_stop);
+  base_src_class->unlock = GST_DEBUG_FUNCPTR (gst_nv_shm_src_unlock);
+  base_src_class->unlock_stop = GST_DEBUG_FUNCPTR (gst_nv_shm_src_unlock_stop);
+  push_src_class->create = GST_DEBUG_FUNCPTR (gst_nv_shm_src_create);
+}
+
+static void
+gst_nv_shm_src_init (GstNvShmSrc * self)
+{
+  self->socket_path = g_strdup (DEFAULT_SOCKET_PATH);
+  self->is_live = DEFAULT_IS_LIVE;
+
+  gst_base_src_set_format (GST_BASE_SRC (self), GST_FORMAT_TIME);
+  gst_base_src_set_live (GST_BASE_SRC (self), DEFAULT_IS_LIVE);
+}
+
+static void
+gst_nv_shm_src_finalize (GObject * object)
+{
+  GstNvShmSrc *self = GST_NV_SHM_SRC (object);
+
+  g_free (self->socket_path);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_shm_src_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvShmSrc *self = GST_NV_SHM_SRC (object);
+
+  switch (prop_id) {
+    case PROP_SOCKET_PATH:
+      GST_OBJECT_LOCK (self);
+      g_free (self->socket_path);
+      self->socket_path = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_IS_LIVE:
+      GST_OBJECT_LOCK (self);
+      self->is_live = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (self);
+      /* takes the live lock, not the object lock */
+      gst_base_src_set_live (GST_BASE_SRC (self), g_value_get_boolean (value));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_nv_shm_src_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstNvShmSrc *self = GST_NV_SHM_SRC (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_SOCKET_PATH:
+      g_value_set_string (value, self->socket_path);
+      break;
+    case PROP_IS_LIVE:
+      g_value_set_boolean (value, self->is_live);
+      break;
+    case PROP_SKIPPED:
+      g_value_set_uint64 (value,
+          self->consumer ? (*self->consumer)->skipped () : 0);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static gboolean
+gst_nv_shm_src_start (GstBaseSrc * src)
+{
+  GstNvShmSrc *self = GST_NV_SHM_SRC (src);
+  auto consumer = std::make_shared<nvgst::ShmConsumer> ();
+  gchar *path;
+
+  GST_OBJECT_LOCK (self);
+  path = g_strdup (self->socket_path);
+  GST_OBJECT_UNLOCK (self);
+
+  if (path == NULL || !consumer->connect (path)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ,
+        ("Could not connect to socket %s", GST_STR_NULL (path)),
+        ("%s", g_strerror (errno)));
+    g_free (path);
+    return FALSE;
+  }
+  GST_INFO_OBJECT (self, "connected to %s", path);
+  g_free (path);
+
+  GST_OBJECT_LOCK (self);
+  self->consumer = new std::shared_ptr<nvgst::ShmConsumer> (consumer);
+  GST_OBJECT_UNLOCK (self);
+
+  self->is_video = FALSE;
+  return TRUE;
+}
+
+static gboolean
+gst_nv_shm_src_stop (GstBaseSrc * src)
+{
+  GstNvShmSrc *self = GST_NV_SHM_SRC (src);
+  std::shared_ptr<nvgst::ShmConsumer> *consumer;
+
+  GST_OBJECT_LOCK (self);
+  consumer = self->consumer;
+  self->consumer = NULL;
+  GST_OBJECT_UNLOCK (self);
+
+  /* buffers still downstream keep the connection until they are freed */
+  delete consumer;
+  return TRUE;
+}
+
+static gboolean
+gst_nv_shm_src_unlock (GstBaseSrc * src)
+{
+  GstNvShmSrc *self = GST_NV_SHM_SRC (src);
+
+  if (self->consumer)
+    (*self->consumer)->interrupt ();
+  return TRUE;
+}
+
+static gboolean
+gst_nv_shm_src_unlock_stop (GstBaseSrc * src)
+{
+  GstNvShmSrc *self = GST_NV_SHM_SRC (src);
+
+  if (self->consumer)
+    (*self->consumer)->clear_interrupt ();
+  return TRUE;
+}
+
+static void
+gst_nv_shm_src_slot_ref_free (gpointer data)
+{
+  GstNvShmSrcSlotRef *ref = (GstNvShmSrcSlotRef *) data;
+
+  ref->consumer->release (ref->slot);
+  delete ref;
+}
+
+static gboolean
+gst_nv_shm_src_update_caps (GstNvShmSrc * self, const std::string & str)
+{
+  GstCaps *caps = gst_caps_from_string (str.c_str ());
+  gboolean ret;
+
+  if (caps == NULL) {
+    GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
+        ("sink sent invalid caps '%s'", str.c_str ()));
+    return FALSE;
+  }
+
+  GST_DEBUG_OBJECT (self, "caps from sink: %" GST_PTR_FORMAT, caps);
+  self->is_video = gst_video_info_from_caps (&self->info, caps);
+  ret = gst_base_src_set_caps (GST_BASE_SRC (self), caps);
+  gst_caps_unref (caps);
+
+  if (!ret)
+    GST_ELEMENT_ERROR (self, CORE, NEGOTIATION, (NULL),
+        ("downstream did not accept %s", str.c_str ()));
+  return ret;
+}
+
+static GstBuffer *
+gst_nv_shm_src_wrap_frame (GstNvShmSrc * self,
+    const std::shared_ptr<nvgst::ShmConsumer> & consumer,
+    const nvgst::ShmFrameInfo * frame)
+{
+  GstNvShmSrcSlotRef *ref = new GstNvShmSrcSlotRef { consumer, frame->slot };
+  GstBuffer *buffer = gst_buffer_new ();
+  GstMemory *mem;
+
+  mem = gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
+      (gpointer) consumer->slot_data (frame->slot), consumer->slot_size (),
+      frame->data_offset, frame->size, ref, gst_nv_shm_src_slot_ref_free);
+  gst_buffer_append_memory (buffer, mem);
+
+  GST_BUFFER_PTS (buffer) = frame->pts;
+  GST_BUFFER_DTS (buffer) = frame->dts;
+  GST_BUFFER_DURATION (buffer) = frame->duration;
+  GST_BUFFER_OFFSET (buffer) = frame->offset;
+  GST_BUFFER_OFFSET_END (buffer) = frame->offset_end;
+  GST_BUFFER_FLAGS (buffer) = frame->flags & NV_SHM_STREAM_FLAGS;
+
+  if (self->is_video && frame->n_planes == GST_VIDEO_INFO_N_PLANES (&self->info)) {
+    gsize offset[GST_VIDEO_MAX_PLANES] = { 0, };
+    gint stride[GST_VIDEO_MAX_PLANES] = { 0, };
+
+    for (guint i = 0; i < frame->n_planes; i++) {
+      offset[i] = frame->plane_offset[i];
+      stride[i] = frame->stride[i];
+    }
+    gst_buffer_add_video_meta_full (buffer, GST_VIDEO_FRAME_FLAG_NONE,
+        GST_VIDEO_INFO_FORMAT (&self->info), GST_VIDEO_INFO_WIDTH (&self->info),
+        GST_VIDEO_INFO_HEIGHT (&self->info), frame->n_planes, offset, stride);
+  }
+
+  return buffer;
+}
+
+static GstFlowReturn
+gst_nv_shm_src_create (GstPushSrc * src, GstBuffer ** buffer)
+{
+  GstNvShmSrc *self = GST_NV_SHM_SRC (src);
+  std::shared_ptr<nvgst::ShmConsumer> consumer = *self->consumer;
+  nvgst::ShmFrameInfo frame;
+  std::string caps;
+
+  for (;;) {
+    switch (consumer->next (&frame, &caps)) {
+      case nvgst::ShmConsumer::Event::kFrame:
+        *buffer = gst_nv_shm_src_wrap_frame (self, consumer, &frame);
+        return GST_FLOW_OK;
+      case nvgst::ShmConsumer::Event::kCaps:
+        if (!gst_nv_shm_src_update_caps (self, caps))
+          return GST_FLOW_NOT_NEGOTIATED;
+        break;
+      case nvgst::ShmConsumer::Event::kEos:
+        GST_INFO_OBJECT (self, "sink sent EOS");
+        return GST_FLOW_EOS;
+      case nvgst::ShmConsumer::Event::kInterrupted:
+        return GST_FLOW_FLUSHING;
+      case nvgst::ShmConsumer::Event::kClosed:
+        GST_ELEMENT_ERROR (self, RESOURCE, READ,
+            ("The shared memory sink went away"), (NULL));
+        return GST_FLOW_ERROR;
+    }
+  }
+}
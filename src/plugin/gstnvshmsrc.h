@@ -0,0 +1,54 @@
+#ifndef __GST_NV_SHM_SRC_H__
+#define __GST_NV_SHM_SRC_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstpushsrc.h>
+#include <gst/video/video.h>
+
+#include <memory>
+
+#include "core/shm_transport.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_NV_SHM_SRC \
+  (gst_nv_shm_src_get_type())
+#define GST_NV_SHM_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_SHM_SRC,GstNvShmSrc))
+#define GST_NV_SHM_SRC_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_SHM_SRC,GstNvShmSrcClass))
+#define GST_IS_NV_SHM_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_SHM_SRC))
+
+typedef struct _GstNvShmSrc GstNvShmSrc;
+typedef struct _GstNvShmSrcClass GstNvShmSrcClass;
+
+struct _GstNvShmSrc
+{
+  GstPushSrc parent;
+
+  /* properties, protected by the object lock */
+  gchar *socket_path;
+  gboolean is_live;
+
+  /* between start() and stop(); buffers still downstream share ownership
+   * so the segment stays mapped */
+  std::shared_ptr<nvgst::ShmConsumer> *consumer;
+
+  /* streaming thread only */
+  GstVideoInfo info;
+  gboolean is_video;
+};
+
+struct _GstNvShmSrcClass
+{
+  GstPushSrcClass parent_class;
+};
+
+GType gst_nv_shm_src_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvshmsrc);
+
+G_END_DECLS
+
+#endif /* __GST_NV_SHM_SRC_H__ */
@@ -0,0 +1,883 @@
+/**
+ * SECTION:element-nvsnapshot
+ *
+ * JPEG snapshots of objects and frames, for event thumbnails and search
+ * indexes. Encoding runs on #GstNvSnapshot:workers threads of its own with
+ * libjpeg-turbo, so the streaming thread only copies the pixels it needs;
+ * buffers pass through unchanged.
+ *
+ * What gets a snapshot depends on #GstNvSnapshot:mode:
+ *
+ * - tracks: one crop per track of #GstNvObjectMeta, from the frame where
+ *   it scored best (confidence times the square root of its size, halved
+ *   when the frame edge cuts the box), taken once the track has been gone
+ *   for linger frames or has been in view for max-age frames. The kept
+ *   crop is only replaced when a clearly better one comes along, so most
+ *   frames copy nothing. Place the element behind nvtracker.
+ * - events: a crop of the object of every #GstNvAnalyticsMeta event, so
+ *   each line crossing or zone entry gets a picture.
+ * - trigger: nothing automatic.
+ *
+ * In every mode, the "trigger" action signal snapshots the whole frames of
+ * the next buffer. #GstNvSnapshot:classes limits the objects considered.
+ *
+ * Finished snapshots are written to #GstNvSnapshot:location, a pattern
+ * with one integer conversion for a running index, each followed by an
+ * element message "nvsnapshot-done" with the location, source, track and
+ * class; and with #GstNvSnapshot:attach-meta they ride on the next buffer
+ * leaving the element as a #GstNvSnapshotMeta. At most max-pending
+ * snapshots wait for a worker; beyond that new ones are dropped and
+ * counted in #GstNvSnapshot:dropped rather than stalling the stream.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 filesrc location=street.mp4 ! decodebin ! nvconvert ! \
+ *     video/x-raw,format=NV12 ! nvinfer ! nvpostprocess ! nvtracker ! \
+ *     nvsnapshot classes=0,2 max-size=256 location=track%06d.jpg \
+ *     attach-meta=false ! fakesink
+ * ]|
+ */
+
+#include "gstnvsnapshot.h"
+#include "gstnvanalyticsmeta.h"
+#include "gstnvbatchmeta.h"
+#include "gstnvobjectmeta.h"
+#include "gstnvsnapshotmeta.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_snapshot_debug);
+#define GST_CAT_DEFAULT gst_nv_snapshot_debug
+
+#define DEFAULT_MODE GST_NV_SNAPSHOT_TRACKS
+#define DEFAULT_LINGER 15
+#define DEFAULT_MAX_AGE 0
+#define DEFAULT_PADDING 0.1f
+#define DEFAULT_MIN_SIZE 32
+#define DEFAULT_QUALITY 85
+#define DEFAULT_MAX_SIZE 0
+#define DEFAULT_WORKERS 2
+#define DEFAULT_MAX_PENDING 16
+#define DEFAULT_ATTACH_META TRUE
+#define DEFAULT_SIMD GST_NV_SIMD_LEVEL_AUTO
+
+enum
+{
+  PROP_0,
+  PROP_MODE,
+  PROP_CLASSES,
+  PROP_LINGER,
+  PROP_MAX_AGE,
+  PROP_PADDING,
+  PROP_MIN_SIZE,
+  PROP_QUALITY,
+  PROP_MAX_SIZE,
+  PROP_WORKERS,
+  PROP_MAX_PENDING,
+  PROP_LOCATION,
+  PROP_ATTACH_META,
+  PROP_SIMD,
+  PROP_ENCODED,
+  PROP_DROPPED,
+  PROP_FAILED,
+};
+
+enum
+{
+  SIGNAL_TRIGGER,
+  LAST_SIGNAL,
+};
+
+static guint gst_nv_snapshot_signals[LAST_SIGNAL];
+
+#define NV_SNAPSHOT_FORMATS "{ NV12, I420, RGBA, BGRx }"
+
+#define NV_SNAPSHOT_CAPS \
+  GST_VIDEO_CAPS_MAKE (NV_SNAPSHOT_FORMATS) "; " \
+  GST_NV_BATCH_CAPS_MAKE (NV_SNAPSHOT_FORMATS)
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_SNAPSHOT_CAPS));
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_SNAPSHOT_CAPS));
+
+GType
+gst_nv_snapshot_mode_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_NV_SNAPSHOT_TRACKS, "Best crop of every track", "tracks"},
+    {GST_NV_SNAPSHOT_EVENTS, "Crop of the object of every analytics event",
+        "events"},
+    {GST_NV_SNAPSHOT_TRIGGER, "Whole frames on the trigger signal only",
+        "trigger"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = g_enum_register_static ("GstNvSnapshotMode", values);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+#define gst_nv_snapshot_parent_class parent_class
+G_DEFINE_TYPE (GstNvSnapshot, gst_nv_snapshot, GST_TYPE_BASE_TRANSFORM);
+GST_ELEMENT_REGISTER_DEFINE (nvsnapshot, "nvsnapshot", GST_RANK_NONE,
+    GST_TYPE_NV_SNAPSHOT);
+
+static void gst_nv_snapshot_finalize (GObject * object);
+static void gst_nv_snapshot_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_snapshot_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static gboolean gst_nv_snapshot_stop (GstBaseTransform * trans);
+static gboolean gst_nv_snapshot_set_caps (GstBaseTransform * trans,
+    GstCaps * incaps, GstCaps * outcaps);
+static gboolean gst_nv_snapshot_sink_event (GstBaseTransform * trans,
+    GstEvent * event);
+static GstFlowReturn gst_nv_snapshot_transform_ip (GstBaseTransform * trans,
+    GstBuffer * buffer);
+static void gst_nv_snapshot_trigger (GstNvSnapshot * self);
+
+static void
+gst_nv_snapshot_class_init (GstNvSnapshotClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_snapshot_debug, "nvsnapshot", 0,
+      "nvsnapshot element");
+
+  gobject_class->finalize = gst_nv_snapshot_finalize;
+  gobject_class->set_property = gst_nv_snapshot_set_property;
+  gobject_class->get_property = gst_nv_snapshot_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_MODE,
+      g_param_spec_enum ("mode", "Mode", "What gets a snapshot",
+          GST_TYPE_NV_SNAPSHOT_MODE, DEFAULT_MODE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CLASSES,
+      g_param_spec_string ("classes", "Classes",
+          "Comma-separated class ids of the objects to snapshot (all when "
+          "unset)", NULL,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_LINGER,
+      g_param_spec_uint ("linger", "Linger",
+          "Frames of its source a track may go unseen before its snapshot "
+          "is taken", 1, G_MAXINT, DEFAULT_LINGER,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_AGE,
+      g_param_spec_uint ("max-age", "Maximum age",
+          "Frames after which a track still in view gets its snapshot "
+          "(0 = when it ends)", 0, G_MAXINT, DEFAULT_MAX_AGE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_PADDING,
+      g_param_spec_float ("padding", "Padding",
+          "Margin added around object boxes, as a fraction of their size",
+          0.0f, 2.0f, DEFAULT_PADDING,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MIN_SIZE,
+      g_param_spec_uint ("min-size", "Minimum size",
+          "Object crops narrower or lower than this many pixels are "
+          "skipped", 1, 4096, DEFAULT_MIN_SIZE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_QUALITY,
+      g_param_spec_uint ("quality", "Quality", "JPEG quality", 1, 100,
+          DEFAULT_QUALITY,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE,
+      g_param_spec_uint ("max-size", "Maximum size",
+          "Longest side of the snapshots; larger ones are scaled down "
+          "(0 = keep the size)", 0, 65500, DEFAULT_MAX_SIZE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_WORKERS,
+      g_param_spec_uint ("workers", "Workers", "Encoding threads", 1, 64,
+          DEFAULT_WORKERS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_PENDING,
+      g_param_spec_uint ("max-pending", "Maximum pending",
+          "Snapshots waiting to be encoded or attached at most; more are "
+          "dropped", 1, 4096, DEFAULT_MAX_PENDING,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_LOCATION,
+      g_param_spec_string ("location", "Location",
+          "Pattern of the files snapshots are written to, with one integer "
+          "conversion for a running index (e.g. snap%06d.jpg); none when "
+          "unset", NULL,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_ATTACH_META,
+      g_param_spec_boolean ("attach-meta", "Attach meta",
+          "Attach finished snapshots to the next buffer as GstNvSnapshotMeta",
+          DEFAULT_ATTACH_META,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SIMD,
+      g_param_spec_enum ("simd", "SIMD",
+          "Highest SIMD level to use for scaling, capped at what the CPU "
+          "supports", GST_TYPE_NV_SIMD_LEVEL, DEFAULT_SIMD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_ENCODED,
+      g_param_spec_uint64 ("encoded", "Encoded", "Snapshots encoded", 0,
+          G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_DROPPED,
+      g_param_spec_uint64 ("dropped", "Dropped",
+          "Snapshots dropped because max-pending were waiting", 0,
+          G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_FAILED,
+      g_param_spec_uint64 ("failed", "Failed",
+          "Snapshots that could not be encoded or written", 0, G_MAXUINT64,
+          0, (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  /**
+   * GstNvSnapshot::trigger:
+   *
+   * Snapshots the whole frames of the next buffer. Safe to emit from any
+   * thread.
+   */
+  gst_nv_snapshot_signals[SIGNAL_TRIGGER] =
+      g_signal_new ("trigger", G_TYPE_FROM_CLASS (klass),
+      (GSignalFlags) (G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION),
+      G_STRUCT_OFFSET (GstNvSnapshotClass, trigger), NULL, NULL, NULL,
+      G_TYPE_NONE, 0);
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV snapshot", "Filter/Analyzer/Video",
+      "JPEG-encodes the best crop of every track, analytics events or "
+      "whole frames on a worker pool, to files or buffer meta",
+      "nv_gst_plugins developers");
+
+  trans_class->stop = GST_DEBUG_FUNCPTR (gst_nv_snapshot_stop);
+  trans_class->set_caps = GST_DEBUG_FUNCPTR (gst_nv_snapshot_set_caps);
+  trans_class->sink_event = GST_DEBUG_FUNCPTR (gst_nv_snapshot_sink_event);
+  trans_class->transform_ip = GST_DEBUG_FUNCPTR (gst_nv_snapshot_transform_ip);
+  trans_class->passthrough_on_same_caps = FALSE;
+
+  klass->trigger = gst_nv_snapshot_trigger;
+
+  gst_type_mark_as_plugin_api (GST_TYPE_NV_SNAPSHOT_MODE,
+      (GstPluginAPIFlags) 0);
+}
+
+static void
+gst_nv_snapshot_init (GstNvSnapshot * self)
+{
+  self->mode = DEFAULT_MODE;
+  self->classes = NULL;
+  self->linger = DEFAULT_LINGER;
+  self->max_age = DEFAULT_MAX_AGE;
+  self->padding = DEFAULT_PADDING;
+  self->min_size = DEFAULT_MIN_SIZE;
+  self->quality = DEFAULT_QUALITY;
+  self->max_size = DEFAULT_MAX_SIZE;
+  self->workers = DEFAULT_WORKERS;
+  self->max_pending = DEFAULT_MAX_PENDING;
+  self->location = NULL;
+  self->attach_meta = DEFAULT_ATTACH_META;
+  self->simd = DEFAULT_SIMD;
+  self->reconfigure = TRUE;
+  self->pending_trigger = FALSE;
+
+  gst_video_info_init (&self->info);
+  self->batched = FALSE;
+  self->active_mode = DEFAULT_MODE;
+  self->active_location = NULL;
+  self->next_index = 0;
+  self->class_ids = new std::vector < gint > ();
+  self->tracks = new nvgst::TrackSnapshots ();
+  self->encoder = new nvgst::SnapshotEncoder ();
+  self->ready = new std::vector < nvgst::SnapshotCandidate > ();
+  self->done = new std::vector < nvgst::SnapshotJob * >();
+
+  gst_base_transform_set_in_place (GST_BASE_TRANSFORM (self), TRUE);
+}
+
+static void
+gst_nv_snapshot_finalize (GObject * object)
+{
+  GstNvSnapshot *self = GST_NV_SNAPSHOT (object);
+
+  delete self->encoder;
+  delete self->done;
+  delete self->ready;
+  delete self->tracks;
+  delete self->class_ids;
+  g_free (self->active_location);
+  g_free (self->location);
+  g_free (self->classes);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_snapshot_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvSnapshot *self = GST_NV_SNAPSHOT (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_MODE:
+      self->mode = (GstNvSnapshotMode) g_value_get_enum (value);
+      break;
+    case PROP_CLASSES:
+      g_free (self->classes);
+      self->classes = g_value_dup_string (value);
+      break;
+    case PROP_LINGER:
+      self->linger = g_value_get_uint (value);
+      break;
+    case PROP_MAX_AGE:
+      self->max_age = g_value_get_uint (value);
+      break;
+    case PROP_PADDING:
+      self->padding = g_value_get_float (value);
+      break;
+    case PROP_MIN_SIZE:
+      self->min_size = g_value_get_uint (value);
+      break;
+    case PROP_QUALITY:
+      self->quality = g_value_get_uint (value);
+      break;
+    case PROP_MAX_SIZE:
+      self->max_size = g_value_get_uint (value);
+      break;
+    case PROP_WORKERS:
+      self->workers = g_value_get_uint (value);
+      break;
+    case PROP_MAX_PENDING:
+      self->max_pending = g_value_get_uint (value);
+      break;
+    case PROP_LOCATION:
+      g_free (self->location);
+      self->location = g_value_dup_string (value);
+      break;
+    case PROP_ATTACH_META:
+      self->attach_meta = g_value_get_boolean (value);
+      break;
+    case PROP_SIMD:
+      self->simd = (GstNvSimdLevel) g_value_get_enum (value);
+      break;
+    default:
+      GST_OBJECT_UNLOCK (self);
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      return;
+  }
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_snapshot_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstNvSnapshot *self = GST_NV_SNAPSHOT (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_MODE:
+      g_value_set_enum (value, self->mode);
+      break;
+    case PROP_CLASSES:
+      g_value_set_string (value, self->classes);
+      break;
+    case PROP_LINGER:
+      g_value_set_uint (value, self->linger);
+      break;
+    case PROP_MAX_AGE:
+      g_value_set_uint (value, self->max_age);
+      break;
+    case PROP_PADDING:
+      g_value_set_float (value, self->padding);
+      break;
+    case PROP_MIN_SIZE:
+      g_value_set_uint (value, self->min_size);
+      break;
+    case PROP_QUALITY:
+      g_value_set_uint (value, self->quality);
+      break;
+    case PROP_MAX_SIZE:
+      g_value_set_uint (value, self->max_size);
+      break;
+    case PROP_WORKERS:
+      g_value_set_uint (value, self->workers);
+      break;
+    case PROP_MAX_PENDING:
+      g_value_set_uint (value, self->max_pending);
+      break;
+    case PROP_LOCATION:
+      g_value_set_string (value, self->location);
+      break;
+    case PROP_ATTACH_META:
+      g_value_set_boolean (value, self->attach_meta);
+      break;
+    case PROP_SIMD:
+      g_value_set_enum (value, self->simd);
+      break;
+    case PROP_ENCODED:
+      g_value_set_uint64 (value, self->encoder->encoded ());
+      break;
+    case PROP_DROPPED:
+      g_value_set_uint64 (value, self->encoder->dropped ());
+      break;
+    case PROP_FAILED:
+      g_value_set_uint64 (value, self->encoder->failed ());
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_snapshot_trigger (GstNvSnapshot * self)
+{
+  GST_DEBUG_OBJECT (self, "triggered");
+  g_atomic_int_set (&self->pending_trigger, TRUE);
+}
+
+/* Hands finished, uncollected jobs back. */
+static void
+gst_nv_snapshot_release_done (GstNvSnapshot * self)
+{
+  self->encoder->collect (self->done);
+  for (nvgst::SnapshotJob * job : *self->done)
+    self->encoder->release (job);
+  self->done->clear ();
+}
+
+static gboolean
+gst_nv_snapshot_stop (GstBaseTransform * trans)
+{
+  GstNvSnapshot *self = GST_NV_SNAPSHOT (trans);
+
+  /* encodes and writes out what is queued */
+  self->encoder->stop ();
+  gst_nv_snapshot_release_done (self);
+  self->tracks->reset ();
+  self->ready->clear ();
+  g_atomic_int_set (&self->pending_trigger, FALSE);
+
+  GST_OBJECT_LOCK (self);
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  return TRUE;
+}
+
+static gboolean
+gst_nv_snapshot_set_caps (GstBaseTransform * trans, GstCaps * incaps,
+    GstCaps * outcaps)
+{
+  GstNvSnapshot *self = GST_NV_SNAPSHOT (trans);
+  GstCapsFeatures *features = gst_caps_get_features (incaps, 0);
+
+  if (!gst_video_info_from_caps (&self->info, incaps)) {
+    GST_ERROR_OBJECT (self, "invalid caps %" GST_PTR_FORMAT, incaps);
+    return FALSE;
+  }
+  self->batched = features != NULL &&
+      gst_caps_features_contains (features, GST_CAPS_FEATURE_META_GST_NV_BATCH);
+
+  return TRUE;
+}
+
+/* Worker thread: a snapshot is encoded, and written when it has a
+ * location. */
+static void
+gst_nv_snapshot_job_done (GstNvSnapshot * self, const nvgst::SnapshotJob & job)
+{
+  GstStructure *s;
+
+  if (!job.error.empty ()) {
+    GST_ELEMENT_WARNING (self, STREAM, ENCODE,
+        ("Could not save a snapshot"), ("%s", job.error.c_str ()));
+    return;
+  }
+  if (job.path.empty ())
+    return;
+
+  GST_LOG_OBJECT (self, "wrote %s, %" G_GSIZE_FORMAT " bytes",
+      job.path.c_str (), job.jpeg.size ());
+
+  s = gst_structure_new ("nvsnapshot-done",
+      "location", G_TYPE_STRING, job.path.c_str (),
+      "source-id", G_TYPE_UINT, (guint) job.info.source,
+      "track-id", G_TYPE_UINT64, (guint64) job.info.track_id,
+      "class-id", G_TYPE_INT, (gint) job.info.class_id,
+      "bytes", G_TYPE_UINT64, (guint64) job.jpeg.size (), NULL);
+  gst_element_post_message (GST_ELEMENT (self),
+      gst_message_new_element (GST_OBJECT (self), s));
+}
+
+/* Takes property changes in; the encoder is only restarted, after
+ * finishing its queue, when one of its own settings changed. */
+static gboolean
+gst_nv_snapshot_apply_config (GstNvSnapshot * self)
+{
+  nvgst::TrackSnapshotConfig tracks;
+  nvgst::SnapshotEncoderConfig encoder;
+  const nvgst::SnapshotEncoderConfig & running = self->encoder->config ();
+  GstNvSimdLevel simd;
+  gboolean parsed;
+
+  GST_OBJECT_LOCK (self);
+  if (!self->reconfigure) {
+    GST_OBJECT_UNLOCK (self);
+    return TRUE;
+  }
+  self->active_mode = self->mode;
+  tracks.linger = (int) self->linger;
+  tracks.max_age = (int) self->max_age;
+  tracks.padding = self->padding;
+  tracks.min_size = (int) self->min_size;
+  encoder.workers = (int) self->workers;
+  encoder.max_pending = (int) self->max_pending;
+  encoder.quality = (int) self->quality;
+  encoder.max_size = (int) self->max_size;
+  encoder.collect = self->attach_meta != FALSE;
+  g_free (self->active_location);
+  self->active_location = self->location != NULL && *self->location != '\0' ?
+      g_strdup (self->location) : NULL;
+  parsed = gst_nv_parse_class_ids (self->classes, self->class_ids);
+  simd = self->simd;
+  self->reconfigure = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  if (!parsed) {
+    GST_ERROR_OBJECT (self, "classes must look like \"0,2,7\"");
+    return FALSE;
+  }
+  tracks.classes.assign (self->class_ids->begin (), self->class_ids->end ());
+  self->tracks->configure (tracks);
+
+  encoder.simd = gst_nv_simd_level_resolve (simd);
+  if (!self->encoder->running () || encoder.workers != running.workers ||
+      encoder.max_pending != running.max_pending ||
+      encoder.quality != running.quality ||
+      encoder.max_size != running.max_size ||
+      encoder.collect != running.collect || encoder.simd != running.simd) {
+    if (!self->encoder->start (encoder,
+            [self] (const nvgst::SnapshotJob & job) {
+              gst_nv_snapshot_job_done (self, job);
+            }))
+      return FALSE;
+    if (!encoder.collect)
+      gst_nv_snapshot_release_done (self);
+  }
+
+  GST_INFO_OBJECT (self, "snapshots of %s on %d workers, quality %d, max "
+      "size %d, to %s%s", self->active_mode == GST_NV_SNAPSHOT_TRACKS ?
+      "tracks" : self->active_mode == GST_NV_SNAPSHOT_EVENTS ? "events" :
+      "triggers", encoder.workers, encoder.quality, encoder.max_size,
+      self->active_location ? self->active_location : "no files",
+      encoder.collect ? " and meta" : "");
+
+  return TRUE;
+}
+
+static gboolean
+gst_nv_snapshot_wanted (GstNvSnapshot * self, gint class_id)
+{
+  const std::vector < gint > &ids = *self->class_ids;
+
+  return ids.empty () ||
+      std::find (ids.begin (), ids.end (), class_id) != ids.end ();
+}
+
+/* A free job with its location filled in, or NULL when max-pending are
+ * busy. */
+static nvgst::SnapshotJob *
+gst_nv_snapshot_acquire (GstNvSnapshot * self)
+{
+  nvgst::SnapshotJob *job = self->encoder->acquire ();
+
+  if (job == NULL) {
+    GST_DEBUG_OBJECT (self, "all %d snapshot slots busy, dropping",
+        self->encoder->config ().max_pending);
+    return NULL;
+  }
+  job->path.clear ();
+  if (self->active_location != NULL) {
+    gchar *path = g_strdup_printf (self->active_location, self->next_index++);
+
+    job->path = path;
+    g_free (path);
+  }
+  return job;
+}
+
+/* Copies rect of frame into a job and queues it. */
+static void
+gst_nv_snapshot_submit_rect (GstNvSnapshot * self,
+    const nvgst::FrameView & frame, const nvgst::SnapshotInfo & info,
+    const nvgst::SnapshotRect & rect)
+{
+  nvgst::SnapshotJob *job = gst_nv_snapshot_acquire (self);
+
+  if (job == NULL)
+    return;
+  if (!job->image.assign (frame, rect)) {
+    self->encoder->release (job);
+    return;
+  }
+  job->info = info;
+  job->info.rect = job->image.rect ();
+  self->encoder->submit (job);
+}
+
+/* Queues the best crops of the tracks that ended; their images swap with
+ * the job's, so nothing is copied. */
+static void
+gst_nv_snapshot_submit_ready (GstNvSnapshot * self)
+{
+  self->tracks->take (self->ready);
+  for (nvgst::SnapshotCandidate & candidate : *self->ready) {
+    nvgst::SnapshotJob *job = gst_nv_snapshot_acquire (self);
+
+    if (job != NULL) {
+      job->info = candidate.info;
+      std::swap (job->image, candidate.image);
+      self->encoder->submit (job);
+    }
+    self->tracks->recycle (std::move (candidate.image));
+  }
+  self->ready->clear ();
+}
+
+static gboolean
+gst_nv_snapshot_frame_needed (GstNvSnapshot * self, guint index,
+    gboolean trigger, GstNvObjectMeta * ometa, GstNvAnalyticsMeta * ameta)
+{
+  if (trigger)
+    return TRUE;
+  if (self->active_mode == GST_NV_SNAPSHOT_TRACKS && ometa != NULL) {
+    for (const nvgst::DetectedObject & object : *ometa->objects) {
+      if (object.frame == index && object.track_id != nvgst::kNoTrack)
+        return TRUE;
+    }
+  }
+  if (self->active_mode == GST_NV_SNAPSHOT_EVENTS && ameta != NULL &&
+      ometa != NULL) {
+    for (const GstNvAnalyticsEvent & event : *ameta->events) {
+      if (event.frame == index && event.object >= 0)
+        return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/* Snapshots of one frame; frame has no pixels when none are needed. */
+static void
+gst_nv_snapshot_process_frame (GstNvSnapshot * self,
+    const nvgst::FrameView & frame, guint index, guint source_id,
+    GstClockTime pts, gboolean trigger, GstNvObjectMeta * ometa,
+    GstNvAnalyticsMeta * ameta)
+{
+  nvgst::SnapshotInfo info;
+
+  info.source = source_id;
+  info.pts = GST_CLOCK_TIME_IS_VALID (pts) ? (int64_t) pts : -1;
+
+  if (trigger) {
+    gst_nv_snapshot_submit_rect (self, frame, info,
+        {0, 0, frame.width, frame.height});
+  }
+
+  switch (self->active_mode) {
+    case GST_NV_SNAPSHOT_TRACKS:
+      if (ometa != NULL) {
+        self->tracks->offer (source_id, info.pts, frame,
+            ometa->objects->data (), ometa->objects->size (), index);
+      } else {
+        self->tracks->offer (source_id, info.pts, frame, NULL, 0, index);
+      }
+      break;
+    case GST_NV_SNAPSHOT_EVENTS:
+      if (ameta == NULL || ometa == NULL)
+        break;
+      for (const GstNvAnalyticsEvent & event : *ameta->events) {
+        const nvgst::DetectedObject * object;
+
+        if (event.frame != index || event.object < 0 ||
+            (gsize) event.object >= ometa->objects->size ())
+          continue;
+        object = &(*ometa->objects)[event.object];
+        if (!gst_nv_snapshot_wanted (self, object->class_id))
+          continue;
+        info.track_id = object->track_id;
+        info.class_id = object->class_id;
+        info.confidence = object->confidence;
+        gst_nv_snapshot_submit_rect (self, frame, info,
+            nvgst::snapshot_crop (*object, self->tracks->config ().padding));
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+static GstFlowReturn
+gst_nv_snapshot_process_batch (GstNvSnapshot * self, GstBuffer * buffer,
+    gboolean trigger, GstNvObjectMeta * ometa, GstNvAnalyticsMeta * ameta)
+{
+  GstNvBatchMeta *bmeta = gst_buffer_get_nv_batch_meta (buffer);
+  GstMapInfo map;
+
+  if (bmeta == NULL) {
+    GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
+        ("batched buffer without GstNvBatchMeta"));
+    return GST_FLOW_ERROR;
+  }
+
+  for (guint i = 0; i < bmeta->n_frames; i++) {
+    const GstNvBatchFrame *frame = &bmeta->frames[i];
+
+    if (!gst_nv_snapshot_frame_needed (self, i, trigger, ometa, ameta)) {
+      gst_nv_snapshot_process_frame (self, nvgst::FrameView (), i,
+          frame->source_id, frame->pts, FALSE, ometa, ameta);
+      continue;
+    }
+    if (!gst_nv_batch_meta_map_frame (bmeta, buffer, i, &map, GST_MAP_READ)) {
+      GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL),
+          ("failed to map frame %u of the batch", i));
+      return GST_FLOW_ERROR;
+    }
+    gst_nv_snapshot_process_frame (self, gst_nv_batch_frame_view (frame,
+            &self->info, &map), i, frame->source_id, frame->pts, trigger,
+        ometa, ameta);
+    gst_nv_batch_meta_unmap_frame (bmeta, buffer, i, &map);
+  }
+
+  return GST_FLOW_OK;
+}
+
+/* Finished snapshots go on this buffer; the JPEG is copied once, out of
+ * the job, which is then free again. */
+static void
+gst_nv_snapshot_attach (GstNvSnapshot * self, GstBuffer * buffer)
+{
+  GstNvSnapshotMeta *smeta;
+
+  self->encoder->collect (self->done);
+  if (self->done->empty ())
+    return;
+
+  smeta = gst_buffer_add_nv_snapshot_meta (buffer);
+  for (nvgst::SnapshotJob * job : *self->done) {
+    const nvgst::SnapshotInfo & info = job->info;
+    GstNvSnapshotItem item;
+
+    if (job->error.empty ()) {
+      item.source_id = info.source;
+      item.pts = info.pts >= 0 ? (GstClockTime) info.pts : GST_CLOCK_TIME_NONE;
+      item.track_id = info.track_id;
+      item.class_id = info.class_id;
+      item.confidence = info.confidence;
+      item.x = info.rect.x0;
+      item.y = info.rect.y0;
+      item.width = info.rect.x1 - info.rect.x0;
+      item.height = info.rect.y1 - info.rect.y0;
+      item.jpeg = gst_buffer_new_memdup (job->jpeg.data (), job->jpeg.size ());
+      smeta->snapshots->push_back (item);
+    }
+    self->encoder->release (job);
+  }
+  self->done->clear ();
+
+  GST_LOG_OBJECT (self, "attached %" G_GSIZE_FORMAT " snapshots",
+      smeta->snapshots->size ());
+}
+
+/* Tracks still waiting get their snapshot at the end of the stream; after
+ * a flush they are forgotten. */
+static gboolean
+gst_nv_snapshot_sink_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstNvSnapshot *self = GST_NV_SNAPSHOT (trans);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_EOS:
+      if (self->encoder->running ()) {
+        self->tracks->flush ();
+        gst_nv_snapshot_submit_ready (self);
+      }
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      self->tracks->reset ();
+      break;
+    default:
+      break;
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->sink_event (trans, event);
+}
+
+static GstFlowReturn
+gst_nv_snapshot_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
+{
+  GstNvSnapshot *self = GST_NV_SNAPSHOT (trans);
+  GstNvObjectMeta *ometa = gst_buffer_get_nv_object_meta (buffer);
+  GstNvAnalyticsMeta *ameta = gst_buffer_get_nv_analytics_meta (buffer);
+  gboolean trigger;
+  GstVideoFrame frame;
+
+  if (!gst_nv_snapshot_apply_config (self)) {
+    GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS, (NULL),
+        ("invalid snapshot settings"));
+    return GST_FLOW_ERROR;
+  }
+
+  trigger =
+      g_atomic_int_compare_and_exchange (&self->pending_trigger, TRUE, FALSE);
+
+  if (self->batched) {
+    GstFlowReturn ret = gst_nv_snapshot_process_batch (self, buffer, trigger,
+        ometa, ameta);
+
+    if (ret != GST_FLOW_OK)
+      return ret;
+  } else if (!gst_nv_snapshot_frame_needed (self, 0, trigger, ometa, ameta)) {
+    gst_nv_snapshot_process_frame (self, nvgst::FrameView (), 0, 0,
+        GST_BUFFER_PTS (buffer), FALSE, ometa, ameta);
+  } else {
+    if (!gst_video_frame_map (&frame, &self->info, buffer, GST_MAP_READ)) {
+      GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL),
+          ("failed to map frame"));
+      return GST_FLOW_ERROR;
+    }
+    gst_nv_snapshot_process_frame (self,
+        gst_nv_frame_view_from_video_frame (&frame), 0, 0,
+        GST_BUFFER_PTS (buffer), trigger, ometa, ameta);
+    gst_video_frame_unmap (&frame);
+  }
+
+  gst_nv_snapshot_submit_ready (self);
+  if (self->encoder->config ().collect)
+    gst_nv_snapshot_attach (self, buffer);
+
+  return GST_FLOW_OK;
+}
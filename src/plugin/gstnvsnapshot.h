@@ -0,0 +1,87 @@
+#ifndef __GST_NV_SNAPSHOT_H__
+#define __GST_NV_SNAPSHOT_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include <gst/video/video.h>
+
+#include <vector>
+
+#include "gstnvutils.h"
+#include "core/snapshot.h"
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  GST_NV_SNAPSHOT_TRACKS,
+  GST_NV_SNAPSHOT_EVENTS,
+  GST_NV_SNAPSHOT_TRIGGER,
+} GstNvSnapshotMode;
+
+#define GST_TYPE_NV_SNAPSHOT_MODE (gst_nv_snapshot_mode_get_type ())
+GType gst_nv_snapshot_mode_get_type (void);
+
+#define GST_TYPE_NV_SNAPSHOT \
+  (gst_nv_snapshot_get_type())
+#define GST_NV_SNAPSHOT(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_SNAPSHOT,GstNvSnapshot))
+#define GST_NV_SNAPSHOT_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_SNAPSHOT,GstNvSnapshotClass))
+#define GST_IS_NV_SNAPSHOT(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_SNAPSHOT))
+
+typedef struct _GstNvSnapshot GstNvSnapshot;
+typedef struct _GstNvSnapshotClass GstNvSnapshotClass;
+
+struct _GstNvSnapshot
+{
+  GstBaseTransform parent;
+
+  /* properties, protected by the object lock */
+  GstNvSnapshotMode mode;
+  gchar *classes;
+  guint linger;
+  guint max_age;
+  gfloat padding;
+  guint min_size;
+  guint quality;
+  guint max_size;
+  guint workers;
+  guint max_pending;
+  gchar *location;
+  gboolean attach_meta;
+  GstNvSimdLevel simd;
+  gboolean reconfigure;
+
+  /* set by the trigger action from any thread, atomic */
+  gint pending_trigger;
+
+  /* streaming thread only */
+  GstVideoInfo info;
+  gboolean batched;
+  GstNvSnapshotMode active_mode;
+  gchar *active_location;
+  guint next_index;
+  std::vector<gint> *class_ids;
+  nvgst::TrackSnapshots *tracks;
+  nvgst::SnapshotEncoder *encoder;
+  std::vector<nvgst::SnapshotCandidate> *ready;
+  std::vector<nvgst::SnapshotJob *> *done;
+};
+
+struct _GstNvSnapshotClass
+{
+  GstBaseTransformClass parent_class;
+
+  /* actions */
+  void (*trigger) (GstNvSnapshot * snapshot);
+};
+
+GType gst_nv_snapshot_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvsnapshot);
+
+G_END_DECLS
+
+#endif /* __GST_NV_SNAPSHOT_H__ */
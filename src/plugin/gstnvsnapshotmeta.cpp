@@ -0,0 +1,83 @@
+#include "gstnvsnapshotmeta.h"
+
+GType
+gst_nv_snapshot_meta_api_get_type (void)
+{
+  static GType type = 0;
+  static const gchar *tags[] = { GST_META_TAG_VIDEO_STR, NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = gst_meta_api_type_register ("GstNvSnapshotMetaAPI", tags);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+static gboolean
+gst_nv_snapshot_meta_init (GstMeta * meta, gpointer params,
+    GstBuffer * buffer)
+{
+  GstNvSnapshotMeta *smeta = (GstNvSnapshotMeta *) meta;
+
+  smeta->snapshots = new std::vector < GstNvSnapshotItem > ();
+
+  return TRUE;
+}
+
+static void
+gst_nv_snapshot_meta_free (GstMeta * meta, GstBuffer * buffer)
+{
+  GstNvSnapshotMeta *smeta = (GstNvSnapshotMeta *) meta;
+
+  for (GstNvSnapshotItem & snapshot : *smeta->snapshots)
+    gst_buffer_unref (snapshot.jpeg);
+  delete smeta->snapshots;
+  smeta->snapshots = NULL;
+}
+
+/* Snapshots do not depend on the frame pixels, so they survive any copy;
+ * the JPEG buffers are shared. */
+static gboolean
+gst_nv_snapshot_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstNvSnapshotMeta *src = (GstNvSnapshotMeta *) meta;
+  GstNvSnapshotMeta *smeta;
+
+  if (!GST_META_TRANSFORM_IS_COPY (type))
+    return FALSE;
+
+  smeta = gst_buffer_add_nv_snapshot_meta (dest);
+  if (smeta == NULL)
+    return FALSE;
+
+  for (const GstNvSnapshotItem & snapshot : *src->snapshots) {
+    smeta->snapshots->push_back (snapshot);
+    gst_buffer_ref (snapshot.jpeg);
+  }
+
+  return TRUE;
+}
+
+const GstMetaInfo *
+gst_nv_snapshot_meta_get_info (void)
+{
+  static const GstMetaInfo *info = NULL;
+
+  if (g_once_init_enter (&info)) {
+    const GstMetaInfo *tmp =
+        gst_meta_register (GST_NV_SNAPSHOT_META_API_TYPE,
+        "GstNvSnapshotMeta", sizeof (GstNvSnapshotMeta),
+        gst_nv_snapshot_meta_init, gst_nv_snapshot_meta_free,
+        gst_nv_snapshot_meta_transform);
+    g_once_init_leave (&info, tmp);
+  }
+  return info;
+}
+
+GstNvSnapshotMeta *
+gst_buffer_add_nv_snapshot_meta (GstBuffer * buffer)
+{
+  return (GstNvSnapshotMeta *) gst_buffer_add_meta (buffer,
+      GST_NV_SNAPSHOT_META_INFO, NULL);
+}
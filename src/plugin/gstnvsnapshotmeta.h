@@ -0,0 +1,69 @@
+/* JPEG snapshots encoded by nvsnapshot. */
+#ifndef __GST_NV_SNAPSHOT_META_H__
+#define __GST_NV_SNAPSHOT_META_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include <vector>
+
+G_BEGIN_DECLS
+
+typedef struct _GstNvSnapshotItem GstNvSnapshotItem;
+typedef struct _GstNvSnapshotMeta GstNvSnapshotMeta;
+
+/**
+ * GstNvSnapshotItem:
+ * @source_id: source of the frame the snapshot was taken from, 0 on
+ *     single frames
+ * @pts: pts of that frame; usually earlier than the buffer's own
+ * @track_id: the object's track, 0 for whole frames and untracked objects
+ * @class_id: the object's class, -1 for whole frames
+ * @confidence: the object's detection confidence
+ * @x: left of the crop in the frame, in pixels
+ * @y: top of the crop
+ * @width: width of the crop in the frame; the JPEG may be scaled down
+ * @height: height of the crop in the frame
+ * @jpeg: the encoded image
+ */
+struct _GstNvSnapshotItem
+{
+  guint source_id;
+  GstClockTime pts;
+  guint64 track_id;
+  gint class_id;
+  gfloat confidence;
+  gint x;
+  gint y;
+  gint width;
+  gint height;
+  GstBuffer *jpeg;
+};
+
+/**
+ * GstNvSnapshotMeta:
+ * @meta: parent #GstMeta
+ * @snapshots: snapshots finished since the previous buffer, owned by the
+ *     meta, which holds a reference to each @jpeg
+ */
+struct _GstNvSnapshotMeta
+{
+  GstMeta meta;
+
+  std::vector<GstNvSnapshotItem> *snapshots;
+};
+
+GType gst_nv_snapshot_meta_api_get_type (void);
+#define GST_NV_SNAPSHOT_META_API_TYPE (gst_nv_snapshot_meta_api_get_type ())
+
+const GstMetaInfo *gst_nv_snapshot_meta_get_info (void);
+#define GST_NV_SNAPSHOT_META_INFO (gst_nv_snapshot_meta_get_info ())
+
+#define gst_buffer_get_nv_snapshot_meta(b) \
+  ((GstNvSnapshotMeta *) gst_buffer_get_meta ((b), GST_NV_SNAPSHOT_META_API_TYPE))
+
+GstNvSnapshotMeta *gst_buffer_add_nv_snapshot_meta (GstBuffer * buffer);
+
+G_END_DECLS
+
+#endif /* __GST_NV_SNAPSHOT_META_H__ */
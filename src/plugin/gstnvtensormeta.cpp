@@ -0,0 +1,91 @@
+#include "gstnvtensormeta.h"
+
+GType
+gst_nv_tensor_meta_api_get_type (void)
+{
+  static GType type = 0;
+  static const gchar *tags[] = { GST_META_TAG_VIDEO_STR, NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = gst_meta_api_type_register ("GstNvTensorMetaAPI", tags);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+static gboolean
+gst_nv_tensor_meta_init (GstMeta * meta, gpointer params, GstBuffer * buffer)
+{
+  GstNvTensorMeta *tmeta = (GstNvTensorMeta *) meta;
+
+  tmeta->tensors = new std::vector < nvgst::Tensor > ();
+
+  return TRUE;
+}
+
+static void
+gst_nv_tensor_meta_free (GstMeta * meta, GstBuffer * buffer)
+{
+  GstNvTensorMeta *tmeta = (GstNvTensorMeta *) meta;
+
+  delete tmeta->tensors;
+  tmeta->tensors = NULL;
+}
+
+/* Copies share the tensor data. Region copies would cut frames out of a
+ * batch, so they drop the tensors. */
+static gboolean
+gst_nv_tensor_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstNvTensorMeta *src = (GstNvTensorMeta *) meta;
+  GstNvTensorMeta *tmeta;
+  GstMetaTransformCopy *copy;
+
+  if (!GST_META_TRANSFORM_IS_COPY (type))
+    return FALSE;
+
+  copy = (GstMetaTransformCopy *) data;
+  if (copy->region)
+    return FALSE;
+
+  tmeta = gst_buffer_add_nv_tensor_meta (dest);
+  if (tmeta == NULL)
+    return FALSE;
+
+  *tmeta->tensors = *src->tensors;
+
+  return TRUE;
+}
+
+const GstMetaInfo *
+gst_nv_tensor_meta_get_info (void)
+{
+  static const GstMetaInfo *info = NULL;
+
+  if (g_once_init_enter (&info)) {
+    const GstMetaInfo *tmp = gst_meta_register (GST_NV_TENSOR_META_API_TYPE,
+        "GstNvTensorMeta", sizeof (GstNvTensorMeta),
+        gst_nv_tensor_meta_init, gst_nv_tensor_meta_free,
+        gst_nv_tensor_meta_transform);
+    g_once_init_leave (&info, tmp);
+  }
+  return info;
+}
+
+GstNvTensorMeta *
+gst_buffer_add_nv_tensor_meta (GstBuffer * buffer)
+{
+  return (GstNvTensorMeta *) gst_buffer_add_meta (buffer,
+      GST_NV_TENSOR_META_INFO, NULL);
+}
+
+const nvgst::Tensor *
+gst_nv_tensor_meta_find (GstNvTensorMeta * meta, const gchar * name)
+{
+  for (const nvgst::Tensor & tensor : *meta->tensors) {
+    if (tensor.info.name == name)
+      return &tensor;
+  }
+  return NULL;
+}
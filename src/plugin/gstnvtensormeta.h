@@ -0,0 +1,50 @@
+/* Output tensors of nvinfer for the frames of a buffer. */
+#ifndef __GST_NV_TENSOR_META_H__
+#define __GST_NV_TENSOR_META_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include <vector>
+
+#include "core/tensor.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GstNvTensorMeta GstNvTensorMeta;
+
+/**
+ * GstNvTensorMeta:
+ * @meta: parent #GstMeta
+ * @tensors: one tensor per network output, owned by the meta. The first
+ *     dimension is the frame: 1 on single frames, the batch size on
+ *     batches, in frame order.
+ *
+ * Tensor data is shared with the engine's pool and with copies of the
+ * meta; treat it as read-only.
+ */
+struct _GstNvTensorMeta
+{
+  GstMeta meta;
+
+  std::vector<nvgst::Tensor> *tensors;
+};
+
+GType gst_nv_tensor_meta_api_get_type (void);
+#define GST_NV_TENSOR_META_API_TYPE (gst_nv_tensor_meta_api_get_type ())
+
+const GstMetaInfo *gst_nv_tensor_meta_get_info (void);
+#define GST_NV_TENSOR_META_INFO (gst_nv_tensor_meta_get_info ())
+
+#define gst_buffer_get_nv_tensor_meta(b) \
+  ((GstNvTensorMeta *) gst_buffer_get_meta ((b), GST_NV_TENSOR_META_API_TYPE))
+
+GstNvTensorMeta *gst_buffer_add_nv_tensor_meta (GstBuffer * buffer);
+
+/* The tensor of @meta named @name, or NULL. */
+const nvgst::Tensor *gst_nv_tensor_meta_find (GstNvTensorMeta * meta,
+    const gchar * name);
+
+G_END_DECLS
+
+#endif /* __GST_NV_TENSOR_META_H__ */
@@ -0,0 +1,902 @@
+/**
+ * SECTION:element-nvtiler
+ *
+ * Lays out N video streams in a grid of one RGBA or BGRx frame, for
+ * monitoring walls and debug views. Each sink pad is scaled straight into
+ * its tile of a pooled output buffer; there is no per-input intermediate
+ * frame as with compositor.
+ *
+ * Sink pad sink_N goes to tile N unless #GstNvTilerPad:tile says
+ * otherwise. Pads sharing a tile are stacked in pad order, so an RGBA
+ * stream (a label or graphics overlay) can sit on top of a camera; its
+ * per-pixel alpha and #GstNvTilerPad:alpha are blended with SIMD kernels.
+ * The grid grows with the pads unless #GstNvTiler:rows or
+ * #GstNvTiler:columns are set.
+ *
+ * With #GstNvTiler:skip-unchanged a tile is only drawn again when one of
+ * its pads delivered a new frame since the output buffer was last filled,
+ * so a wall of low frame rate or stalled cameras costs little more than a
+ * copy-free buffer recycle. This relies on the output buffers coming back
+ * unmodified, which is not the case behind elements that draw in place
+ * such as nvosd or nvredact, so it is off by default.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 nvtiler name=t width=1920 height=1080 ! videoconvert ! autovideosink \
+ *     videotestsrc ! t.sink_0  videotestsrc pattern=ball ! t.sink_1 \
+ *     videotestsrc pattern=snow ! t.sink_2  videotestsrc pattern=smpte ! t.sink_3
+ * ]|
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "gstnvtiler.h"
+#include "gstnvbufferpool.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_tiler_debug);
+#define GST_CAT_DEFAULT gst_nv_tiler_debug
+
+#define DEFAULT_PAD_TILE -1
+#define DEFAULT_PAD_ALPHA 1.0
+
+#define DEFAULT_ROWS 0
+#define DEFAULT_COLUMNS 0
+#define DEFAULT_WIDTH 1920
+#define DEFAULT_HEIGHT 1080
+#define DEFAULT_BACKGROUND 0x000000
+#define DEFAULT_SKIP_UNCHANGED FALSE
+#define DEFAULT_SIMD GST_NV_SIMD_LEVEL_AUTO
+
+/* output buffers in flight before the pool has to grow */
+#define OUTPUT_POOL_MIN_BUFFERS 4
+
+enum
+{
+  PROP_PAD_0,
+  PROP_PAD_TILE,
+  PROP_PAD_ALPHA,
+};
+
+enum
+{
+  PROP_0,
+  PROP_ROWS,
+  PROP_COLUMNS,
+  PROP_WIDTH,
+  PROP_HEIGHT,
+  PROP_BACKGROUND,
+  PROP_SKIP_UNCHANGED,
+  PROP_SIMD,
+};
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink_%u",
+    GST_PAD_SINK,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("{ NV12, I420, RGBA, BGRx }")));
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("{ RGBA, BGRx }")));
+
+/* GstNvTilerPad */
+
+G_DEFINE_TYPE (GstNvTilerPad, gst_nv_tiler_pad, GST_TYPE_AGGREGATOR_PAD);
+
+static void
+gst_nv_tiler_pad_clear_buffer (GstNvTilerPad * pad)
+{
+  if (pad->buffer == NULL)
+    return;
+  gst_video_frame_unmap (&pad->frame);
+  gst_clear_buffer (&pad->buffer);
+}
+
+static void
+gst_nv_tiler_pad_finalize (GObject * object)
+{
+  GstNvTilerPad *pad = GST_NV_TILER_PAD (object);
+
+  gst_nv_tiler_pad_clear_buffer (pad);
+
+  G_OBJECT_CLASS (gst_nv_tiler_pad_parent_class)->finalize (object);
+}
+
+static void
+gst_nv_tiler_pad_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvTilerPad *pad = GST_NV_TILER_PAD (object);
+
+  GST_OBJECT_LOCK (pad);
+  switch (prop_id) {
+    case PROP_PAD_TILE:
+      pad->tile = g_value_get_int (value);
+      break;
+    case PROP_PAD_ALPHA:
+      pad->alpha = g_value_get_double (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (pad);
+}
+
+static void
+gst_nv_tiler_pad_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstNvTilerPad *pad = GST_NV_TILER_PAD (object);
+
+  GST_OBJECT_LOCK (pad);
+  switch (prop_id) {
+    case PROP_PAD_TILE:
+      g_value_set_int (value, pad->tile);
+      break;
+    case PROP_PAD_ALPHA:
+      g_value_set_double (value, pad->alpha);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (pad);
+}
+
+static void
+gst_nv_tiler_pad_class_init (GstNvTilerPadClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->finalize = gst_nv_tiler_pad_finalize;
+  gobject_class->set_property = gst_nv_tiler_pad_set_property;
+  gobject_class->get_property = gst_nv_tiler_pad_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_PAD_TILE,
+      g_param_spec_int ("tile", "Tile",
+          "Grid cell to draw into, in row-major order (-1 = pad index)",
+          -1, G_MAXINT, DEFAULT_PAD_TILE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_PAD_ALPHA,
+      g_param_spec_double ("alpha", "Alpha",
+          "Opacity of this stream over the pads below it in the same tile",
+          0.0, 1.0, DEFAULT_PAD_ALPHA,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+}
+
+static void
+gst_nv_tiler_pad_init (GstNvTilerPad * pad)
+{
+  pad->tile = DEFAULT_PAD_TILE;
+  pad->alpha = DEFAULT_PAD_ALPHA;
+  gst_video_info_init (&pad->info);
+}
+
+/* GstNvTiler */
+
+#define gst_nv_tiler_parent_class parent_class
+G_DEFINE_TYPE (GstNvTiler, gst_nv_tiler, GST_TYPE_AGGREGATOR);
+GST_ELEMENT_REGISTER_DEFINE (nvtiler, "nvtiler", GST_RANK_NONE,
+    GST_TYPE_NV_TILER);
+
+static void gst_nv_tiler_finalize (GObject * object);
+static void gst_nv_tiler_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_tiler_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static GstPad *gst_nv_tiler_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
+static void gst_nv_tiler_release_pad (GstElement * element, GstPad * pad);
+static GstAggregatorPad *gst_nv_tiler_create_new_pad (GstAggregator * agg,
+    GstPadTemplate * templ, const gchar * req_name, const GstCaps * caps);
+static gboolean gst_nv_tiler_sink_event (GstAggregator * agg,
+    GstAggregatorPad * aggpad, GstEvent * event);
+static GstFlowReturn gst_nv_tiler_update_src_caps (GstAggregator * agg,
+    GstCaps * caps, GstCaps ** ret);
+static gboolean gst_nv_tiler_negotiated_src_caps (GstAggregator * agg,
+    GstCaps * caps);
+static gboolean gst_nv_tiler_decide_allocation (GstAggregator * agg,
+    GstQuery * query);
+static GstFlowReturn gst_nv_tiler_aggregate (GstAggregator * agg,
+    gboolean timeout);
+static gboolean gst_nv_tiler_stop (GstAggregator * agg);
+
+static void
+gst_nv_tiler_class_init (GstNvTilerClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstAggregatorClass *agg_class = GST_AGGREGATOR_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_tiler_debug, "nvtiler", 0,
+      "nvtiler element");
+
+  gobject_class->finalize = gst_nv_tiler_finalize;
+  gobject_class->set_property = gst_nv_tiler_set_property;
+  gobject_class->get_property = gst_nv_tiler_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_ROWS,
+      g_param_spec_uint ("rows", "Rows",
+          "Grid rows (0 = derived from the number of tiles)",
+          0, 256, DEFAULT_ROWS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_COLUMNS,
+      g_param_spec_uint ("columns", "Columns",
+          "Grid columns (0 = derived from the number of tiles)",
+          0, 256, DEFAULT_COLUMNS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_WIDTH,
+      g_param_spec_uint ("width", "Width", "Output width",
+          1, G_MAXINT, DEFAULT_WIDTH,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_HEIGHT,
+      g_param_spec_uint ("height", "Height", "Output height",
+          1, G_MAXINT, DEFAULT_HEIGHT,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_BACKGROUND,
+      g_param_spec_uint ("background", "Background",
+          "Color of empty tiles and behind translucent streams, as 0xRRGGBB",
+          0, 0xffffff, DEFAULT_BACKGROUND,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SKIP_UNCHANGED,
+      g_param_spec_boolean ("skip-unchanged", "Skip unchanged",
+          "Only redraw tiles whose input changed since the output buffer was "
+          "last filled; only safe when nothing downstream draws on the output "
+          "in place",
+          DEFAULT_SKIP_UNCHANGED,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SIMD,
+      g_param_spec_enum ("simd", "SIMD",
+          "Highest SIMD level to use for scaling and blending",
+          GST_TYPE_NV_SIMD_LEVEL, DEFAULT_SIMD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template_with_gtype (element_class,
+      &sink_template, GST_TYPE_NV_TILER_PAD);
+  gst_element_class_add_static_pad_template_with_gtype (element_class,
+      &src_template, GST_TYPE_AGGREGATOR_PAD);
+  gst_element_class_set_static_metadata (element_class,
+      "NV tiler", "Filter/Editor/Video/Compositor",
+      "Composites several video streams into a grid, scaling each straight "
+      "into its tile and redrawing only tiles that changed",
+      "nv_gst_plugins developers");
+
+  element_class->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_nv_tiler_request_new_pad);
+  element_class->release_pad = GST_DEBUG_FUNCPTR (gst_nv_tiler_release_pad);
+
+  agg_class->create_new_pad = GST_DEBUG_FUNCPTR (gst_nv_tiler_create_new_pad);
+  agg_class->sink_event = GST_DEBUG_FUNCPTR (gst_nv_tiler_sink_event);
+  agg_class->update_src_caps = GST_DEBUG_FUNCPTR (gst_nv_tiler_update_src_caps);
+  agg_class->negotiated_src_caps =
+      GST_DEBUG_FUNCPTR (gst_nv_tiler_negotiated_src_caps);
+  agg_class->decide_allocation =
+      GST_DEBUG_FUNCPTR (gst_nv_tiler_decide_allocation);
+  agg_class->aggregate = GST_DEBUG_FUNCPTR (gst_nv_tiler_aggregate);
+  agg_class->stop = GST_DEBUG_FUNCPTR (gst_nv_tiler_stop);
+  agg_class->get_next_time = gst_aggregator_simple_get_next_time;
+
+  gst_type_mark_as_plugin_api (GST_TYPE_NV_TILER_PAD, (GstPluginAPIFlags) 0);
+}
+
+static void
+gst_nv_tiler_init (GstNvTiler * self)
+{
+  self->rows = DEFAULT_ROWS;
+  self->columns = DEFAULT_COLUMNS;
+  self->width = DEFAULT_WIDTH;
+  self->height = DEFAULT_HEIGHT;
+  self->background = DEFAULT_BACKGROUND;
+  self->skip_unchanged = DEFAULT_SKIP_UNCHANGED;
+  self->simd = DEFAULT_SIMD;
+  self->reconfigure = TRUE;
+  gst_video_info_init (&self->out_info);
+  self->compositor = new nvgst::TileCompositor ();
+}
+
+static void
+gst_nv_tiler_finalize (GObject * object)
+{
+  GstNvTiler *self = GST_NV_TILER (object);
+
+  delete self->compositor;
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_tiler_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvTiler *self = GST_NV_TILER (object);
+  gboolean renegotiate = FALSE;
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_ROWS:
+      self->rows = g_value_get_uint (value);
+      break;
+    case PROP_COLUMNS:
+      self->columns = g_value_get_uint (value);
+      break;
+    case PROP_WIDTH:
+      self->width = g_value_get_uint (value);
+      renegotiate = TRUE;
+      break;
+    case PROP_HEIGHT:
+      self->height = g_value_get_uint (value);
+      renegotiate = TRUE;
+      break;
+    case PROP_BACKGROUND:
+      self->background = g_value_get_uint (value);
+      break;
+    case PROP_SKIP_UNCHANGED:
+      self->skip_unchanged = g_value_get_boolean (value);
+      break;
+    case PROP_SIMD:
+      self->simd = (GstNvSimdLevel) g_value_get_enum (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      GST_OBJECT_UNLOCK (self);
+      return;
+  }
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  if (renegotiate)
+    gst_pad_mark_reconfigure (GST_AGGREGATOR_SRC_PAD (self));
+}
+
+static void
+gst_nv_tiler_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstNvTiler *self = GST_NV_TILER (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_ROWS:
+      g_value_set_uint (value, self->rows);
+      break;
+    case PROP_COLUMNS:
+      g_value_set_uint (value, self->columns);
+      break;
+    case PROP_WIDTH:
+      g_value_set_uint (value, self->width);
+      break;
+    case PROP_HEIGHT:
+      g_value_set_uint (value, self->height);
+      break;
+    case PROP_BACKGROUND:
+      g_value_set_uint (value, self->background);
+      break;
+    case PROP_SKIP_UNCHANGED:
+      g_value_set_boolean (value, self->skip_unchanged);
+      break;
+    case PROP_SIMD:
+      g_value_set_enum (value, self->simd);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static GstPad *
+gst_nv_tiler_request_new_pad (GstElement * element, GstPadTemplate * templ,
+    const gchar * name, const GstCaps * caps)
+{
+  GstNvTiler *self = GST_NV_TILER (element);
+  GstPad *pad;
+
+  if (element->numsinkpads >= GST_NV_TILER_MAX_PADS) {
+    GST_WARNING_OBJECT (element, "at most %d streams can be tiled",
+        GST_NV_TILER_MAX_PADS);
+    return NULL;
+  }
+
+  pad = GST_ELEMENT_CLASS (parent_class)->request_new_pad (element, templ,
+      name, caps);
+  if (pad) {
+    GST_OBJECT_LOCK (self);
+    self->reconfigure = TRUE;
+    GST_OBJECT_UNLOCK (self);
+  }
+
+  return pad;
+}
+
+static void
+gst_nv_tiler_release_pad (GstElement * element, GstPad * pad)
+{
+  GstNvTiler *self = GST_NV_TILER (element);
+
+  GST_ELEMENT_CLASS (parent_class)->release_pad (element, pad);
+
+  GST_OBJECT_LOCK (self);
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+}
+
+static GstAggregatorPad *
+gst_nv_tiler_create_new_pad (GstAggregator * agg, GstPadTemplate * templ,
+    const gchar * req_name, const GstCaps * caps)
+{
+  GstAggregatorPad *aggpad;
+  GstNvTilerPad *pad;
+  gchar *name;
+
+  aggpad = GST_AGGREGATOR_CLASS (parent_class)->create_new_pad (agg, templ,
+      req_name, caps);
+  if (aggpad == NULL)
+    return NULL;
+
+  pad = GST_NV_TILER_PAD (aggpad);
+  name = gst_pad_get_name (GST_PAD (pad));
+  if (sscanf (name, "sink_%u", &pad->index) != 1)
+    pad->index = 0;
+  g_free (name);
+
+  return aggpad;
+}
+
+static gboolean
+gst_nv_tiler_sink_event (GstAggregator * agg, GstAggregatorPad * aggpad,
+    GstEvent * event)
+{
+  GstNvTilerPad *pad = GST_NV_TILER_PAD (aggpad);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS) {
+    GstCaps *caps;
+    gboolean first;
+
+    gst_event_parse_caps (event, &caps);
+    first = !pad->have_info;
+    if (!gst_video_info_from_caps (&pad->info, caps)) {
+      GST_ERROR_OBJECT (pad, "invalid caps %" GST_PTR_FORMAT, caps);
+      gst_event_unref (event);
+      return FALSE;
+    }
+    pad->have_info = TRUE;
+    pad->needs_configure = TRUE;
+    /* the output frame rate follows the first stream with caps */
+    if (first)
+      gst_pad_mark_reconfigure (GST_AGGREGATOR_SRC_PAD (agg));
+  }
+
+  return GST_AGGREGATOR_CLASS (parent_class)->sink_event (agg, aggpad, event);
+}
+
+/* Size comes from the properties, the frame rate from the first stream
+ * with caps and the format from downstream. */
+static GstFlowReturn
+gst_nv_tiler_update_src_caps (GstAggregator * agg, GstCaps * caps,
+    GstCaps ** ret)
+{
+  GstNvTiler *self = GST_NV_TILER (agg);
+  gint fps_n = 0, fps_d = 1;
+  gboolean have_info = FALSE;
+  GstCaps *tiled, *templ, *result;
+
+  GST_OBJECT_LOCK (self);
+  for (GList * l = GST_ELEMENT (self)->sinkpads; l; l = l->next) {
+    GstNvTilerPad *pad = GST_NV_TILER_PAD (l->data);
+    if (pad->have_info) {
+      fps_n = GST_VIDEO_INFO_FPS_N (&pad->info);
+      fps_d = GST_VIDEO_INFO_FPS_D (&pad->info);
+      have_info = TRUE;
+      break;
+    }
+  }
+  tiled = gst_caps_new_simple ("video/x-raw",
+      "width", G_TYPE_INT, (gint) self->width,
+      "height", G_TYPE_INT, (gint) self->height,
+      "framerate", GST_TYPE_FRACTION, fps_n, fps_d,
+      "pixel-aspect-ratio", GST_TYPE_FRACTION, 1, 1, NULL);
+  GST_OBJECT_UNLOCK (self);
+
+  if (!have_info) {
+    gst_caps_unref (tiled);
+    return GST_AGGREGATOR_FLOW_NEED_DATA;
+  }
+
+  templ = gst_pad_get_pad_template_caps (GST_AGGREGATOR_SRC_PAD (agg));
+  result = gst_caps_intersect (tiled, templ);
+  gst_caps_unref (templ);
+  gst_caps_unref (tiled);
+  if (caps) {
+    GstCaps *tmp = gst_caps_intersect (result, caps);
+    gst_caps_unref (result);
+    result = tmp;
+  }
+
+  if (gst_caps_is_empty (result)) {
+    GST_ELEMENT_ERROR (self, CORE, NEGOTIATION, (NULL),
+        ("downstream accepts neither RGBA nor BGRx at the tiled size"));
+    gst_caps_unref (result);
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
+
+  *ret = gst_caps_fixate (result);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+gst_nv_tiler_negotiated_src_caps (GstAggregator * agg, GstCaps * caps)
+{
+  GstNvTiler *self = GST_NV_TILER (agg);
+
+  if (!gst_video_info_from_caps (&self->out_info, caps))
+    return FALSE;
+  self->have_out_info = TRUE;
+
+  GST_OBJECT_LOCK (self);
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  GST_INFO_OBJECT (self, "tiling into %" GST_PTR_FORMAT, caps);
+
+  if (GST_AGGREGATOR_CLASS (parent_class)->negotiated_src_caps)
+    return GST_AGGREGATOR_CLASS (parent_class)->negotiated_src_caps (agg,
+        caps);
+  return TRUE;
+}
+
+/* Always renders into our own pool: its buffers keep the tiles they were
+ * last drawn with, which is what makes skipping unchanged tiles work. */
+static gboolean
+gst_nv_tiler_decide_allocation (GstAggregator * agg, GstQuery * query)
+{
+  GstNvTiler *self = GST_NV_TILER (agg);
+  GstBufferPool *pool;
+  GstCaps *outcaps;
+  guint size = 0, min = 0, max = 0;
+  gboolean video_meta;
+
+  gst_query_parse_allocation (query, &outcaps, NULL);
+  if (outcaps == NULL)
+    return FALSE;
+
+  if (gst_query_get_n_allocation_pools (query) > 0)
+    gst_query_parse_nth_allocation_pool (query, 0, NULL, &size, &min, &max);
+
+  min = MAX (min, OUTPUT_POOL_MIN_BUFFERS);
+  if (max != 0)
+    max = MAX (max, min);
+
+  video_meta =
+      gst_query_find_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+
+  pool = gst_nv_buffer_pool_new_configured (outcaps, min, max, video_meta);
+  if (pool == NULL) {
+    GST_ERROR_OBJECT (self, "failed to create output pool for %"
+        GST_PTR_FORMAT, outcaps);
+    return FALSE;
+  }
+  size = gst_nv_buffer_pool_get_buffer_size (pool);
+
+  if (gst_query_get_n_allocation_pools (query) > 0)
+    gst_query_set_nth_allocation_pool (query, 0, pool, size, min, max);
+  else
+    gst_query_add_allocation_pool (query, pool, size, min, max);
+
+  gst_object_unref (pool);
+
+  return TRUE;
+}
+
+/* Rebuilds the grid for @n_tiles tiles; every pad's layer is added again
+ * afterwards by gst_nv_tiler_configure_pad(). */
+static gboolean
+gst_nv_tiler_configure (GstNvTiler * self, gint n_tiles)
+{
+  nvgst::TilerConfig config;
+  GstNvSimdLevel simd;
+
+  GST_OBJECT_LOCK (self);
+  config.rows = self->rows;
+  config.columns = self->columns;
+  config.background = self->background;
+  config.skip_unchanged = self->skip_unchanged;
+  simd = self->simd;
+  GST_OBJECT_UNLOCK (self);
+
+  nvgst::tile_grid_shape (n_tiles, &config.rows, &config.columns);
+  config.format = gst_nv_pixel_format_from_video_format
+      (GST_VIDEO_INFO_FORMAT (&self->out_info));
+  config.width = GST_VIDEO_INFO_WIDTH (&self->out_info);
+  config.height = GST_VIDEO_INFO_HEIGHT (&self->out_info);
+  config.simd = gst_nv_simd_level_resolve (simd);
+
+  if (!self->compositor->configure (config)) {
+    GST_ERROR_OBJECT (self, "cannot lay out a %dx%d grid in %dx%d",
+        config.rows, config.columns, config.width, config.height);
+    return FALSE;
+  }
+  self->grid_tiles = n_tiles;
+
+  GST_DEBUG_OBJECT (self, "%dx%d grid for %d tiles", config.rows,
+      config.columns, n_tiles);
+
+  return TRUE;
+}
+
+/* (Re)adds the pad's layer and hands it the frame it already holds, unless
+ * that frame predates a caps change. */
+static void
+gst_nv_tiler_configure_pad (GstNvTiler * self, GstNvTilerPad * pad,
+    gint tile, gint alpha)
+{
+  nvgst::TileLayerConfig config;
+
+  pad->needs_configure = FALSE;
+  pad->layer_tile = tile;
+  pad->layer_alpha = alpha;
+  pad->have_layer = FALSE;
+  self->compositor->remove_layer (pad->index);
+
+  if (!pad->have_info)
+    return;
+
+  if (pad->buffer && !gst_video_info_is_equal (&pad->frame.info, &pad->info))
+    gst_nv_tiler_pad_clear_buffer (pad);
+
+  config.tile = tile;
+  config.format =
+      gst_nv_pixel_format_from_video_format (GST_VIDEO_INFO_FORMAT
+      (&pad->info));
+  config.width = GST_VIDEO_INFO_WIDTH (&pad->info);
+  config.height = GST_VIDEO_INFO_HEIGHT (&pad->info);
+  config.matrix = gst_nv_color_matrix_from_video_info (&pad->info);
+  config.alpha = alpha;
+
+  if (!self->compositor->set_layer (pad->index, config)) {
+    GST_WARNING_OBJECT (pad, "not drawn: tile %d is outside the %d-tile grid "
+        "or the stream cannot be scaled to it", tile,
+        self->compositor->n_tiles ());
+    return;
+  }
+  pad->have_layer = TRUE;
+
+  if (pad->buffer)
+    self->compositor->set_frame (pad->index,
+        gst_nv_frame_view_from_video_frame (&pad->frame));
+}
+
+/* Keeps @buffer mapped as the pad's current frame; takes ownership. */
+static gboolean
+gst_nv_tiler_pad_set_buffer (GstNvTiler * self, GstNvTilerPad * pad,
+    GstBuffer * buffer)
+{
+  gst_nv_tiler_pad_clear_buffer (pad);
+
+  if (!gst_video_frame_map (&pad->frame, &pad->info, buffer, GST_MAP_READ)) {
+    GST_ERROR_OBJECT (pad, "failed to map input frame");
+    gst_buffer_unref (buffer);
+    /* the layer still points at the frame just unmapped */
+    self->compositor->remove_layer (pad->index);
+    pad->have_layer = FALSE;
+    pad->needs_configure = TRUE;
+    return FALSE;
+  }
+  pad->buffer = buffer;
+
+  if (pad->have_layer)
+    self->compositor->set_frame (pad->index,
+        gst_nv_frame_view_from_video_frame (&pad->frame));
+
+  return TRUE;
+}
+
+/* Pads without a new buffer keep showing their last frame. Returns the
+ * number of pads, all referenced in sel_pads; sets @n_new to the number of
+ * new buffers and @n_tiles to the tiles the pads ask for. */
+static guint
+gst_nv_tiler_select_frames (GstNvTiler * self, guint * n_new, gint * n_tiles,
+    gboolean * all_eos, gboolean * reconfigure)
+{
+  GstElement *element = GST_ELEMENT (self);
+  guint n = 0;
+
+  *n_new = 0;
+  *n_tiles = 0;
+  *all_eos = TRUE;
+
+  GST_OBJECT_LOCK (self);
+  for (GList * l = element->sinkpads; l && n < GST_NV_TILER_MAX_PADS;
+      l = l->next) {
+    GstAggregatorPad *aggpad = GST_AGGREGATOR_PAD (l->data);
+    GstNvTilerPad *pad = GST_NV_TILER_PAD (aggpad);
+    GstBuffer *buf = gst_aggregator_pad_pop_buffer (aggpad);
+    gint tile;
+
+    GST_OBJECT_LOCK (pad);
+    tile = pad->tile >= 0 ? pad->tile : (gint) pad->index;
+    GST_OBJECT_UNLOCK (pad);
+    *n_tiles = MAX (*n_tiles, tile + 1);
+
+    if (buf) {
+      (*n_new)++;
+      *all_eos = FALSE;
+    } else if (!gst_aggregator_pad_is_eos (aggpad)) {
+      *all_eos = FALSE;
+    }
+
+    self->sel_pads[n] = GST_NV_TILER_PAD (gst_object_ref (pad));
+    self->sel_bufs[n] = buf;
+    n++;
+  }
+  *reconfigure = self->reconfigure || *n_tiles != self->grid_tiles;
+  self->reconfigure = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  return n;
+}
+
+static GstFlowReturn
+gst_nv_tiler_aggregate (GstAggregator * agg, gboolean timeout)
+{
+  GstNvTiler *self = GST_NV_TILER (agg);
+  GstSegment *out_segment = &GST_AGGREGATOR_PAD (agg->srcpad)->segment;
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstBufferPool *pool = NULL;
+  GstBuffer *outbuf = NULL;
+  GstVideoFrame out_frame;
+  GstClockTime pts = GST_CLOCK_TIME_NONE, duration = GST_CLOCK_TIME_NONE;
+  gboolean all_eos, reconfigure;
+  guint n, n_new;
+  gint n_tiles, drawn;
+
+  if (!self->have_out_info)
+    return GST_FLOW_NOT_NEGOTIATED;
+
+  n = gst_nv_tiler_select_frames (self, &n_new, &n_tiles, &all_eos,
+      &reconfigure);
+  if (n_new == 0) {
+    ret = all_eos ? GST_FLOW_EOS : GST_FLOW_OK;
+    goto done;
+  }
+
+  if (reconfigure) {
+    if (!gst_nv_tiler_configure (self, n_tiles)) {
+      GST_ELEMENT_ERROR (self, CORE, NEGOTIATION, (NULL),
+          ("cannot tile %d streams into %dx%d", n_tiles,
+              GST_VIDEO_INFO_WIDTH (&self->out_info),
+              GST_VIDEO_INFO_HEIGHT (&self->out_info)));
+      ret = GST_FLOW_NOT_NEGOTIATED;
+      goto done;
+    }
+    for (guint i = 0; i < n; i++)
+      self->sel_pads[i]->needs_configure = TRUE;
+  }
+
+  for (guint i = 0; i < n; i++) {
+    GstNvTilerPad *pad = self->sel_pads[i];
+    GstBuffer *inbuf = self->sel_bufs[i];
+    GstClockTime running_time;
+    gint tile, alpha;
+
+    GST_OBJECT_LOCK (pad);
+    tile = pad->tile >= 0 ? pad->tile : (gint) pad->index;
+    alpha = (gint) lround (pad->alpha * 255.0);
+    GST_OBJECT_UNLOCK (pad);
+
+    if (pad->needs_configure || tile != pad->layer_tile ||
+        alpha != pad->layer_alpha)
+      gst_nv_tiler_configure_pad (self, pad, tile, alpha);
+
+    if (inbuf == NULL)
+      continue;
+
+    running_time = gst_segment_to_running_time (&GST_AGGREGATOR_PAD
+        (pad)->segment, GST_FORMAT_TIME, GST_BUFFER_PTS (inbuf));
+    if (GST_CLOCK_TIME_IS_VALID (running_time) &&
+        (!GST_CLOCK_TIME_IS_VALID (pts) || running_time < pts))
+      pts = running_time;
+
+    self->sel_bufs[i] = NULL;
+    if (!gst_nv_tiler_pad_set_buffer (self, pad, inbuf)) {
+      GST_ELEMENT_ERROR (self, STREAM, FAILED, (NULL),
+          ("failed to read frame from %s", GST_PAD_NAME (pad)));
+      ret = GST_FLOW_ERROR;
+      goto done;
+    }
+  }
+
+  pool = gst_aggregator_get_buffer_pool (agg);
+  if (pool == NULL) {
+    ret = GST_FLOW_NOT_NEGOTIATED;
+    goto done;
+  }
+  if (!gst_buffer_pool_is_active (pool) &&
+      !gst_buffer_pool_set_active (pool, TRUE)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, SETTINGS, (NULL),
+        ("failed to activate the output pool"));
+    ret = GST_FLOW_ERROR;
+    goto done;
+  }
+  ret = gst_buffer_pool_acquire_buffer (pool, &outbuf, NULL);
+  if (ret != GST_FLOW_OK)
+    goto done;
+
+  if (!gst_video_frame_map (&out_frame, &self->out_info, outbuf,
+          GST_MAP_WRITE)) {
+    GST_ELEMENT_ERROR (self, STREAM, FAILED, (NULL),
+        ("failed to map output frame"));
+    ret = GST_FLOW_ERROR;
+    goto done;
+  }
+  drawn = self->compositor->render (gst_nv_frame_view_from_video_frame
+      (&out_frame));
+  gst_video_frame_unmap (&out_frame);
+
+  if (GST_VIDEO_INFO_FPS_N (&self->out_info) > 0)
+    duration = gst_util_uint64_scale_int (GST_SECOND,
+        GST_VIDEO_INFO_FPS_D (&self->out_info),
+        GST_VIDEO_INFO_FPS_N (&self->out_info));
+
+  GST_BUFFER_PTS (outbuf) = pts;
+  GST_BUFFER_DURATION (outbuf) = duration;
+  if (GST_CLOCK_TIME_IS_VALID (pts))
+    out_segment->position = GST_CLOCK_TIME_IS_VALID (duration) ?
+        pts + duration : pts;
+
+  GST_LOG_OBJECT (self, "%u new frames%s, drew %d/%d tiles, pts %"
+      GST_TIME_FORMAT, n_new, timeout ? " (timeout)" : "", drawn,
+      self->compositor->n_tiles (), GST_TIME_ARGS (pts));
+
+done:
+  if (pool)
+    gst_object_unref (pool);
+  for (guint i = 0; i < n; i++) {
+    if (self->sel_bufs[i])
+      gst_buffer_unref (self->sel_bufs[i]);
+    gst_object_unref (self->sel_pads[i]);
+    self->sel_bufs[i] = NULL;
+    self->sel_pads[i] = NULL;
+  }
+
+  if (ret != GST_FLOW_OK) {
+    gst_clear_buffer (&outbuf);
+    return ret;
+  }
+
+  return gst_aggregator_finish_buffer (agg, outbuf);
+}
+
+static gboolean
+gst_nv_tiler_stop (GstAggregator * agg)
+{
+  GstNvTiler *self = GST_NV_TILER (agg);
+
+  self->have_out_info = FALSE;
+  self->grid_tiles = 0;
+
+  GST_OBJECT_LOCK (self);
+  self->reconfigure = TRUE;
+  for (GList * l = GST_ELEMENT (self)->sinkpads; l; l = l->next) {
+    GstNvTilerPad *pad = GST_NV_TILER_PAD (l->data);
+
+    pad->needs_configure = TRUE;
+    pad->have_layer = FALSE;
+    gst_nv_tiler_pad_clear_buffer (pad);
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  /* the layers still point at the frames unmapped above */
+  self->compositor->reset ();
+
+  return TRUE;
+}
@@ -0,0 +1,100 @@
+#ifndef __GST_NV_TILER_H__
+#define __GST_NV_TILER_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstaggregator.h>
+#include <gst/video/video.h>
+
+#include "gstnvutils.h"
+#include "core/tiler.h"
+
+G_BEGIN_DECLS
+
+/* Upper bound on sink pads, sized for a few 16-camera walls. */
+#define GST_NV_TILER_MAX_PADS 64
+
+#define GST_TYPE_NV_TILER_PAD \
+  (gst_nv_tiler_pad_get_type())
+#define GST_NV_TILER_PAD(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_TILER_PAD,GstNvTilerPad))
+
+#define GST_TYPE_NV_TILER \
+  (gst_nv_tiler_get_type())
+#define GST_NV_TILER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_TILER,GstNvTiler))
+#define GST_NV_TILER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_TILER,GstNvTilerClass))
+#define GST_IS_NV_TILER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_TILER))
+
+typedef struct _GstNvTilerPad GstNvTilerPad;
+typedef struct _GstNvTilerPadClass GstNvTilerPadClass;
+typedef struct _GstNvTiler GstNvTiler;
+typedef struct _GstNvTilerClass GstNvTilerClass;
+
+struct _GstNvTilerPad
+{
+  GstAggregatorPad parent;
+
+  /* set at creation from the pad name; also the layer id */
+  guint index;
+
+  /* properties, protected by the object lock */
+  gint tile;
+  gdouble alpha;
+
+  /* aggregate thread only */
+  GstVideoInfo info;
+  gboolean have_info;
+  gboolean needs_configure;
+  gboolean have_layer;
+  gint layer_tile;
+  gint layer_alpha;
+  /* last frame, kept mapped while the compositor may read it */
+  GstBuffer *buffer;
+  GstVideoFrame frame;
+};
+
+struct _GstNvTilerPadClass
+{
+  GstAggregatorPadClass parent_class;
+};
+
+struct _GstNvTiler
+{
+  GstAggregator parent;
+
+  /* properties, protected by the object lock */
+  guint rows;
+  guint columns;
+  guint width;
+  guint height;
+  guint background;
+  gboolean skip_unchanged;
+  GstNvSimdLevel simd;
+  /* set when the grid has to be rebuilt: properties or pads changed */
+  gboolean reconfigure;
+
+  /* aggregate thread only */
+  GstVideoInfo out_info;
+  gboolean have_out_info;
+  gint grid_tiles;
+  nvgst::TileCompositor *compositor;
+  GstBufferPool *pool;
+  GstNvTilerPad *sel_pads[GST_NV_TILER_MAX_PADS];
+  GstBuffer *sel_bufs[GST_NV_TILER_MAX_PADS];
+};
+
+struct _GstNvTilerClass
+{
+  GstAggregatorClass parent_class;
+};
+
+GType gst_nv_tiler_pad_get_type (void);
+GType gst_nv_tiler_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvtiler);
+
+G_END_DECLS
+
+#endif /* __GST_NV_TILER_H__ */
@@ -0,0 +1,430 @@
+/**
+ * SECTION:element-nvtracker
+ *
+ * Follows the objects of a #GstNvObjectMeta from frame to frame and writes
+ * a track id into every object that continues a confirmed track. Boxes
+ * are predicted with per-coordinate constant-velocity Kalman filters and
+ * matched to the new detections by IoU, with a Hungarian or greedy
+ * assignment. Track state is kept structure-of-arrays, so prediction,
+ * correction and the IoU matrix all run through SIMD kernels, and every
+ * scratch array is reused from frame to frame.
+ *
+ * On nvbatchmux batches each source gets its own tracker, and ids carry
+ * the source id in their upper 32 bits so they are unique across the
+ * batch. Only the meta is changed; frames are never mapped. Buffers
+ * without a #GstNvObjectMeta pass through and do not age the tracks.
+ * Flushes and stops drop all tracks, but ids are never handed out twice
+ * by the same element.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 nvbatchmux name=mux ! <detector> ! nvtracker min-hits=2 ! \
+ *     nvosd ! fakesink \
+ *     filesrc location=a.mp4 ! decodebin ! nvconvert ! mux.sink_0 \
+ *     filesrc location=b.mp4 ! decodebin ! nvconvert ! mux.sink_1
+ * ]|
+ */
+
+#include "gstnvtracker.h"
+#include "gstnvbatchmeta.h"
+#include "gstnvobjectmeta.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_nv_tracker_debug);
+#define GST_CAT_DEFAULT gst_nv_tracker_debug
+
+#define DEFAULT_IOU_THRESHOLD 0.3f
+#define DEFAULT_MAX_AGE 30
+#define DEFAULT_MIN_HITS 3
+#define DEFAULT_ASSOCIATION GST_NV_TRACKER_ASSOCIATION_HUNGARIAN
+#define DEFAULT_CLASS_AWARE TRUE
+#define DEFAULT_SIMD GST_NV_SIMD_LEVEL_AUTO
+
+enum
+{
+  PROP_0,
+  PROP_IOU_THRESHOLD,
+  PROP_MAX_AGE,
+  PROP_MIN_HITS,
+  PROP_ASSOCIATION,
+  PROP_CLASS_AWARE,
+  PROP_SIMD,
+};
+
+#define NV_TRACKER_CAPS \
+  "video/x-raw; " GST_NV_BATCH_CAPS_MAKE (GST_VIDEO_FORMATS_ALL)
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_TRACKER_CAPS));
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (NV_TRACKER_CAPS));
+
+GType
+gst_nv_tracker_association_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_NV_TRACKER_ASSOCIATION_HUNGARIAN,
+        "Pairs with the highest total IoU", "hungarian"},
+    {GST_NV_TRACKER_ASSOCIATION_GREEDY,
+        "Highest IoU pair first; cheaper on crowded scenes", "greedy"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = g_enum_register_static ("GstNvTrackerAssociation", values);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+#define gst_nv_tracker_parent_class parent_class
+G_DEFINE_TYPE (GstNvTracker, gst_nv_tracker, GST_TYPE_BASE_TRANSFORM);
+GST_ELEMENT_REGISTER_DEFINE (nvtracker, "nvtracker", GST_RANK_NONE,
+    GST_TYPE_NV_TRACKER);
+
+static void gst_nv_tracker_finalize (GObject * object);
+static void gst_nv_tracker_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_nv_tracker_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static gboolean gst_nv_tracker_stop (GstBaseTransform * trans);
+static gboolean gst_nv_tracker_set_caps (GstBaseTransform * trans,
+    GstCaps * incaps, GstCaps * outcaps);
+static gboolean gst_nv_tracker_sink_event (GstBaseTransform * trans,
+    GstEvent * event);
+static GstFlowReturn gst_nv_tracker_transform_ip (GstBaseTransform * trans,
+    GstBuffer * buffer);
+
+static void
+gst_nv_tracker_class_init (GstNvTrackerClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (gst_nv_tracker_debug, "nvtracker", 0,
+      "nvtracker element");
+
+  gobject_class->finalize = gst_nv_tracker_finalize;
+  gobject_class->set_property = gst_nv_tracker_set_property;
+  gobject_class->get_property = gst_nv_tracker_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_IOU_THRESHOLD,
+      g_param_spec_float ("iou-threshold", "IoU threshold",
+          "Least overlap between a detection and the predicted box of a "
+          "track for the detection to continue it",
+          0.01f, 1.0f, DEFAULT_IOU_THRESHOLD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_AGE,
+      g_param_spec_uint ("max-age", "Max age",
+          "Frames a confirmed track is kept without a matching detection",
+          0, G_MAXINT, DEFAULT_MAX_AGE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_MIN_HITS,
+      g_param_spec_uint ("min-hits", "Min hits",
+          "Consecutive matched frames before a track gets an id",
+          1, G_MAXINT, DEFAULT_MIN_HITS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_ASSOCIATION,
+      g_param_spec_enum ("association", "Association",
+          "How detections are assigned to tracks",
+          GST_TYPE_NV_TRACKER_ASSOCIATION, DEFAULT_ASSOCIATION,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_CLASS_AWARE,
+      g_param_spec_boolean ("class-aware", "Class aware",
+          "Only match detections to tracks of the same class",
+          DEFAULT_CLASS_AWARE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SIMD,
+      g_param_spec_enum ("simd", "SIMD",
+          "Highest SIMD level to use, capped at what the CPU supports",
+          GST_TYPE_NV_SIMD_LEVEL, DEFAULT_SIMD,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "NV object tracker", "Filter/Analyzer/Video",
+      "Assigns track ids to GstNvObjectMeta objects with SoA Kalman filters "
+      "and SIMD IoU association, one tracker per batch source",
+      "nv_gst_plugins developers");
+
+  trans_class->stop = GST_DEBUG_FUNCPTR (gst_nv_tracker_stop);
+  trans_class->set_caps = GST_DEBUG_FUNCPTR (gst_nv_tracker_set_caps);
+  trans_class->sink_event = GST_DEBUG_FUNCPTR (gst_nv_tracker_sink_event);
+  trans_class->transform_ip = GST_DEBUG_FUNCPTR (gst_nv_tracker_transform_ip);
+  trans_class->passthrough_on_same_caps = FALSE;
+
+  gst_type_mark_as_plugin_api (GST_TYPE_NV_TRACKER_ASSOCIATION,
+      (GstPluginAPIFlags) 0);
+}
+
+static void
+gst_nv_tracker_init (GstNvTracker * self)
+{
+  self->iou_threshold = DEFAULT_IOU_THRESHOLD;
+  self->max_age = DEFAULT_MAX_AGE;
+  self->min_hits = DEFAULT_MIN_HITS;
+  self->association = DEFAULT_ASSOCIATION;
+  self->class_aware = DEFAULT_CLASS_AWARE;
+  self->simd = DEFAULT_SIMD;
+  self->reconfigure = TRUE;
+  self->batched = FALSE;
+  self->config = new nvgst::TrackerConfig ();
+  self->trackers = new std::unordered_map < guint, nvgst::ObjectTracker > ();
+  self->frame_objects = new std::vector < nvgst::DetectedObject * >();
+
+  gst_base_transform_set_in_place (GST_BASE_TRANSFORM (self), TRUE);
+}
+
+static void
+gst_nv_tracker_finalize (GObject * object)
+{
+  GstNvTracker *self = GST_NV_TRACKER (object);
+
+  delete self->frame_objects;
+  delete self->trackers;
+  delete self->config;
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_nv_tracker_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstNvTracker *self = GST_NV_TRACKER (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_IOU_THRESHOLD:
+      self->iou_threshold = g_value_get_float (value);
+      break;
+    case PROP_MAX_AGE:
+      self->max_age = g_value_get_uint (value);
+      break;
+    case PROP_MIN_HITS:
+      self->min_hits = g_value_get_uint (value);
+      break;
+    case PROP_ASSOCIATION:
+      self->association = (GstNvTrackerAssociation) g_value_get_enum (value);
+      break;
+    case PROP_CLASS_AWARE:
+      self->class_aware = g_value_get_boolean (value);
+      break;
+    case PROP_SIMD:
+      self->simd = (GstNvSimdLevel) g_value_get_enum (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      GST_OBJECT_UNLOCK (self);
+      return;
+  }
+  self->reconfigure = TRUE;
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_nv_tracker_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstNvTracker *self = GST_NV_TRACKER (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_IOU_THRESHOLD:
+      g_value_set_float (value, self->iou_threshold);
+      break;
+    case PROP_MAX_AGE:
+      g_value_set_uint (value, self->max_age);
+      break;
+    case PROP_MIN_HITS:
+      g_value_set_uint (value, self->min_hits);
+      break;
+    case PROP_ASSOCIATION:
+      g_value_set_enum (value, self->association);
+      break;
+    case PROP_CLASS_AWARE:
+      g_value_set_boolean (value, self->class_aware);
+      break;
+    case PROP_SIMD:
+      g_value_set_enum (value, self->simd);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+/* Drops every track. The trackers themselves are kept so their ids keep
+ * counting: a new tracker would hand out ids downstream already saw. */
+static void
+gst_nv_tracker_reset_tracks (GstNvTracker * self)
+{
+  for (auto & entry : *self->trackers)
+    entry.second.reset ();
+}
+
+static gboolean
+gst_nv_tracker_stop (GstBaseTransform * trans)
+{
+  GstNvTracker *self = GST_NV_TRACKER (trans);
+
+  gst_nv_tracker_reset_tracks (self);
+
+  return TRUE;
+}
+
+static gboolean
+gst_nv_tracker_set_caps (GstBaseTransform * trans, GstCaps * incaps,
+    GstCaps * outcaps)
+{
+  GstNvTracker *self = GST_NV_TRACKER (trans);
+  GstCapsFeatures *features = gst_caps_get_features (incaps, 0);
+
+  self->batched = features != NULL &&
+      gst_caps_features_contains (features, GST_CAPS_FEATURE_META_GST_NV_BATCH);
+
+  return TRUE;
+}
+
+/* After a flush the objects jump, so every track starts over. */
+static gboolean
+gst_nv_tracker_sink_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstNvTracker *self = GST_NV_TRACKER (trans);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+    GST_DEBUG_OBJECT (self, "flushed, resetting %" G_GSIZE_FORMAT " trackers",
+        self->trackers->size ());
+    gst_nv_tracker_reset_tracks (self);
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->sink_event (trans, event);
+}
+
+/* Takes property changes into the config of every tracker; tracks are
+ * kept. Returns FALSE when the properties make no valid config. */
+static gboolean
+gst_nv_tracker_apply_config (GstNvTracker * self)
+{
+  nvgst::TrackerConfig *config = self->config;
+  GstNvSimdLevel simd;
+
+  GST_OBJECT_LOCK (self);
+  if (!self->reconfigure) {
+    GST_OBJECT_UNLOCK (self);
+    return TRUE;
+  }
+  config->iou_threshold = self->iou_threshold;
+  config->max_age = (int) self->max_age;
+  config->min_hits = (int) self->min_hits;
+  config->association =
+      self->association == GST_NV_TRACKER_ASSOCIATION_GREEDY ?
+      nvgst::AssignmentMethod::kGreedy : nvgst::AssignmentMethod::kHungarian;
+  config->class_aware = self->class_aware;
+  simd = self->simd;
+  self->reconfigure = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  config->simd = gst_nv_simd_level_resolve (simd);
+
+  for (auto & entry : *self->trackers) {
+    config->id_base = (guint64) entry.first << 32;
+    if (!entry.second.configure (*config))
+      return FALSE;
+  }
+
+  GST_INFO_OBJECT (self, "tracking with %s association, IoU >= %.2f, "
+      "max-age %d, min-hits %d, using %s kernels",
+      config->association == nvgst::AssignmentMethod::kGreedy ?
+      "greedy" : "hungarian", config->iou_threshold, config->max_age,
+      config->min_hits, nvgst::simd_level_name (config->simd));
+
+  return TRUE;
+}
+
+static nvgst::ObjectTracker &
+gst_nv_tracker_get_tracker (GstNvTracker * self, guint source_id)
+{
+  auto it = self->trackers->find (source_id);
+
+  if (it == self->trackers->end ()) {
+    nvgst::TrackerConfig config = *self->config;
+
+    GST_DEBUG_OBJECT (self, "new tracker for source %u", source_id);
+    it = self->trackers->emplace (source_id, nvgst::ObjectTracker ()).first;
+    config.id_base = (guint64) source_id << 32;
+    it->second.configure (config);
+  }
+
+  return it->second;
+}
+
+/* Tracks the objects of frame frame_index with the tracker of source_id. */
+static void
+gst_nv_tracker_track_frame (GstNvTracker * self, nvgst::ObjectList * objects,
+    guint frame_index, guint source_id)
+{
+  std::vector < nvgst::DetectedObject * >&frame = *self->frame_objects;
+
+  frame.clear ();
+  for (nvgst::DetectedObject & object : *objects) {
+    if (object.frame == frame_index)
+      frame.push_back (&object);
+  }
+
+  gst_nv_tracker_get_tracker (self, source_id).update (frame.data (),
+      (int) frame.size ());
+}
+
+static GstFlowReturn
+gst_nv_tracker_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
+{
+  GstNvTracker *self = GST_NV_TRACKER (trans);
+  GstNvObjectMeta *ometa = gst_buffer_get_nv_object_meta (buffer);
+  GstNvBatchMeta *bmeta;
+
+  if (ometa == NULL)
+    return GST_FLOW_OK;
+
+  if (!gst_nv_tracker_apply_config (self)) {
+    GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS, (NULL),
+        ("invalid tracker configuration"));
+    return GST_FLOW_ERROR;
+  }
+
+  if (!self->batched) {
+    gst_nv_tracker_track_frame (self, ometa->objects, 0, 0);
+    GST_LOG_OBJECT (self, "tracked %" G_GSIZE_FORMAT " objects",
+        ometa->objects->size ());
+    return GST_FLOW_OK;
+  }
+
+  bmeta = gst_buffer_get_nv_batch_meta (buffer);
+  if (bmeta == NULL) {
+    GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
+        ("batched buffer without GstNvBatchMeta"));
+    return GST_FLOW_ERROR;
+  }
+
+  for (guint i = 0; i < bmeta->n_frames; i++)
+    gst_nv_tracker_track_frame (self, ometa->objects, i,
+        bmeta->frames[i].source_id);
+
+  GST_LOG_OBJECT (self, "tracked %" G_GSIZE_FORMAT " objects on %u frames",
+      ometa->objects->size (), bmeta->n_frames);
+
+  return GST_FLOW_OK;
+}
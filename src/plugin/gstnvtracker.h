@@ -0,0 +1,68 @@
+#ifndef __GST_NV_TRACKER_H__
+#define __GST_NV_TRACKER_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include <gst/video/video.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "gstnvutils.h"
+#include "core/tracker.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+  GST_NV_TRACKER_ASSOCIATION_HUNGARIAN,
+  GST_NV_TRACKER_ASSOCIATION_GREEDY,
+} GstNvTrackerAssociation;
+
+#define GST_TYPE_NV_TRACKER_ASSOCIATION (gst_nv_tracker_association_get_type ())
+GType gst_nv_tracker_association_get_type (void);
+
+#define GST_TYPE_NV_TRACKER \
+  (gst_nv_tracker_get_type())
+#define GST_NV_TRACKER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_NV_TRACKER,GstNvTracker))
+#define GST_NV_TRACKER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_NV_TRACKER,GstNvTrackerClass))
+#define GST_IS_NV_TRACKER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_NV_TRACKER))
+
+typedef struct _GstNvTracker GstNvTracker;
+typedef struct _GstNvTrackerClass GstNvTrackerClass;
+
+struct _GstNvTracker
+{
+  GstBaseTransform parent;
+
+  /* properties, protected by the object lock */
+  gfloat iou_threshold;
+  guint max_age;
+  guint min_hits;
+  GstNvTrackerAssociation association;
+  gboolean class_aware;
+  GstNvSimdLevel simd;
+  gboolean reconfigure;
+
+  /* streaming thread only */
+  gboolean batched;
+  nvgst::TrackerConfig *config;
+  /* one tracker per source id; single frames use source 0 */
+  std::unordered_map<guint, nvgst::ObjectTracker> *trackers;
+  std::vector<nvgst::DetectedObject *> *frame_objects;
+};
+
+struct _GstNvTrackerClass
+{
+  GstBaseTransformClass parent_class;
+};
+
+GType gst_nv_tracker_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (nvtracker);
+
+G_END_DECLS
+
+#endif /* __GST_NV_TRACKER_H__ */
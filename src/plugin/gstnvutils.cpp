@@ -0,0 +1,141 @@
+#include "gstnvutils.h"
+
+GType
+gst_nv_simd_level_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_NV_SIMD_LEVEL_AUTO, "Best level supported by the CPU", "auto"},
+    {GST_NV_SIMD_LEVEL_SCALAR, "Portable scalar code", "scalar"},
+    {GST_NV_SIMD_LEVEL_SSE41, "SSE4.1", "sse4.1"},
+    {GST_NV_SIMD_LEVEL_AVX2, "AVX2", "avx2"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType tmp = g_enum_register_static ("GstNvSimdLevel", values);
+    g_once_init_leave (&type, tmp);
+  }
+  return type;
+}
+
+nvgst::SimdLevel
+gst_nv_simd_level_resolve (GstNvSimdLevel level)
+{
+  switch (level) {
+    case GST_NV_SIMD_LEVEL_SCALAR:
+      return nvgst::SimdLevel::kScalar;
+    case GST_NV_SIMD_LEVEL_SSE41:
+      return nvgst::clamp_simd_level (nvgst::SimdLevel::kSse41);
+    case GST_NV_SIMD_LEVEL_AVX2:
+      return nvgst::clamp_simd_level (nvgst::SimdLevel::kAvx2);
+    case GST_NV_SIMD_LEVEL_AUTO:
+      break;
+  }
+  return nvgst::detect_simd_level ();
+}
+
+nvgst::PixelFormat
+gst_nv_pixel_format_from_video_format (GstVideoFormat format)
+{
+  switch (format) {
+    case GST_VIDEO_FORMAT_NV12:
+      return nvgst::PixelFormat::kNV12;
+    case GST_VIDEO_FORMAT_I420:
+      return nvgst::PixelFormat::kI420;
+    case GST_VIDEO_FORMAT_RGBA:
+      return nvgst::PixelFormat::kRGBA;
+    case GST_VIDEO_FORMAT_BGRx:
+      return nvgst::PixelFormat::kBGRx;
+    default:
+      break;
+  }
+  return nvgst::PixelFormat::kUnknown;
+}
+
+nvgst::ColorMatrix
+gst_nv_color_matrix_from_video_info (const GstVideoInfo * info)
+{
+  if (GST_VIDEO_INFO_COLORIMETRY (info).matrix == GST_VIDEO_COLOR_MATRIX_BT709)
+    return nvgst::ColorMatrix::kBT709;
+  return nvgst::ColorMatrix::kBT601;
+}
+
+nvgst::FrameView
+gst_nv_frame_view_from_video_frame (const GstVideoFrame * frame)
+{
+  nvgst::FrameView view;
+
+  view.format =
+      gst_nv_pixel_format_from_video_format (GST_VIDEO_FRAME_FORMAT (frame));
+  view.width = GST_VIDEO_FRAME_WIDTH (frame);
+  view.height = GST_VIDEO_FRAME_HEIGHT (frame);
+  for (guint i = 0; i < GST_VIDEO_FRAME_N_PLANES (frame) && i < 3; i++) {
+    view.data[i] = static_cast<uint8_t *> (GST_VIDEO_FRAME_PLANE_DATA (frame, i));
+    view.stride[i] = GST_VIDEO_FRAME_PLANE_STRIDE (frame, i);
+  }
+  return view;
+}
+
+/* "a,b,c" into three floats; FALSE leaves values untouched. */
+gboolean
+gst_nv_parse_triplet (const gchar * str, gfloat values[3])
+{
+  gchar **parts;
+  gfloat parsed[3];
+  gboolean ok;
+
+  if (str == NULL)
+    return FALSE;
+
+  parts = g_strsplit (str, ",", -1);
+  ok = g_strv_length (parts) == 3;
+  for (gint c = 0; ok && c < 3; c++) {
+    gchar *end;
+
+    parsed[c] = (gfloat) g_ascii_strtod (g_strstrip (parts[c]), &end);
+    ok = end != parts[c] && *end == '\0';
+  }
+  g_strfreev (parts);
+
+  if (ok) {
+    for (gint c = 0; c < 3; c++)
+      values[c] = parsed[c];
+  }
+  return ok;
+}
+
+gchar *
+gst_nv_format_triplet (const gfloat values[3])
+{
+  gchar buf[3][G_ASCII_DTOSTR_BUF_SIZE];
+
+  for (gint c = 0; c < 3; c++)
+    g_ascii_formatd (buf[c], sizeof (buf[c]), "%g", values[c]);
+  return g_strdup_printf ("%s,%s,%s", buf[0], buf[1], buf[2]);
+}
+
+gboolean
+gst_nv_parse_class_ids (const gchar * str, std::vector < gint > *ids)
+{
+  gchar **entries;
+  gboolean ok = TRUE;
+
+  ids->clear ();
+  if (str == NULL || *str == '\0')
+    return TRUE;
+
+  entries = g_strsplit (str, ",", -1);
+  for (gint i = 0; ok && entries[i] != NULL; i++) {
+    gchar *entry = g_strstrip (entries[i]);
+    gchar *end;
+    gint64 id = g_ascii_strtoll (entry, &end, 10);
+
+    ok = end != entry && *end == '\0' && id >= G_MININT && id <= G_MAXINT;
+    if (ok)
+      ids->push_back ((gint) id);
+  }
+  g_strfreev (entries);
+
+  return ok;
+}
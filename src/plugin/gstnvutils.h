@@ -0,0 +1,46 @@
+/* Helpers shared by the nv_gst_plugins elements: mapping between GStreamer
+ * video types and the nvgstcore views, and common property enums. */
+#ifndef __GST_NV_UTILS_H__
+#define __GST_NV_UTILS_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include <vector>
+
+#include "core/cpu_features.h"
+#include "core/frame.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+  GST_NV_SIMD_LEVEL_AUTO,
+  GST_NV_SIMD_LEVEL_SCALAR,
+  GST_NV_SIMD_LEVEL_SSE41,
+  GST_NV_SIMD_LEVEL_AVX2,
+} GstNvSimdLevel;
+
+#define GST_TYPE_NV_SIMD_LEVEL (gst_nv_simd_level_get_type ())
+GType gst_nv_simd_level_get_type (void);
+
+G_END_DECLS
+
+/* Resolves a property value to the level the kernels will actually use. */
+nvgst::SimdLevel gst_nv_simd_level_resolve (GstNvSimdLevel level);
+
+nvgst::PixelFormat gst_nv_pixel_format_from_video_format (GstVideoFormat format);
+
+nvgst::ColorMatrix gst_nv_color_matrix_from_video_info (const GstVideoInfo * info);
+
+nvgst::FrameView gst_nv_frame_view_from_video_frame (const GstVideoFrame * frame);
+
+/* Per-plane "a,b,c" property values such as normalization offsets and
+ * scales. Parsing returns FALSE and leaves values untouched on bad input. */
+gboolean gst_nv_parse_triplet (const gchar * str, gfloat values[3]);
+gchar *gst_nv_format_triplet (const gfloat values[3]);
+
+/* "2,7,..." class id lists; NULL or "" is the empty list. Parsing returns
+ * FALSE on anything else. */
+gboolean gst_nv_parse_class_ids (const gchar * str, std::vector < gint > *ids);
+
+#endif /* __GST_NV_UTILS_H__ */
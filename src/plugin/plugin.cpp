@@ -0,0 +1,93 @@
+#include <gst/gst.h>
+
+#include "gstnvanalytics.h"
+#include "gstnvanalyticsmeta.h"
+#include "gstnvbatchdemux.h"
+#include "gstnvbatchmux.h"
+#include "gstnvbgsub.h"
+#include "gstnvcapturesink.h"
+#include "gstnvclassifycache.h"
+#include "gstnvconvert.h"
+#include "gstnvdewarp.h"
+#include "gstnvdrawmeta.h"
+#include "gstnvinfer.h"
+#include "gstnvlatencytracer.h"
+#include "gstnvmotiongate.h"
+#include "gstnvmotionmeta.h"
+#include "gstnvmsgbroker.h"
+#include "gstnvobjectmeta.h"
+#include "gstnvosd.h"
+#include "gstnvpostprocess.h"
+#include "gstnvpyramid.h"
+#include "gstnvqueue.h"
+#include "gstnvrecord.h"
+#include "gstnvredact.h"
+#include "gstnvreid.h"
+#include "gstnvreidmeta.h"
+#include "gstnvreplaysrc.h"
+#include "gstnvroimeta.h"
+#include "gstnvroipack.h"
+#include "gstnvshmsink.h"
+#include "gstnvshmsrc.h"
+#if defined(NVGST_HAVE_JPEG)
+#include "gstnvsnapshot.h"
+#include "gstnvsnapshotmeta.h"
+#endif
+#include "gstnvtensormeta.h"
+#include "gstnvtiler.h"
+#include "gstnvtracker.h"
+
+static gboolean
+plugin_init (GstPlugin * plugin)
+{
+  gboolean ret = FALSE;
+
+  /* registered up front so producers in other plugins can look them up */
+  gst_nv_analytics_meta_get_info ();
+  gst_nv_draw_meta_get_info ();
+  gst_nv_motion_meta_get_info ();
+  gst_nv_object_meta_get_info ();
+  gst_nv_reid_meta_get_info ();
+  gst_nv_roi_meta_get_info ();
+#if defined(NVGST_HAVE_JPEG)
+  gst_nv_snapshot_meta_get_info ();
+#endif
+  gst_nv_tensor_meta_get_info ();
+
+  ret |= GST_ELEMENT_REGISTER (nvconvert, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvbatchmux, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvbatchdemux, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvshmsink, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvshmsrc, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvtiler, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvosd, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvtracker, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvinfer, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvpostprocess, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvmotiongate, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvclassifycache, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvroipack, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvqueue, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvrecord, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvmsgbroker, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvdewarp, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvpyramid, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvanalytics, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvredact, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvbgsub, plugin);
+#if defined(NVGST_HAVE_JPEG)
+  ret |= GST_ELEMENT_REGISTER (nvsnapshot, plugin);
+#endif
+  ret |= GST_ELEMENT_REGISTER (nvreid, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvcapturesink, plugin);
+  ret |= GST_ELEMENT_REGISTER (nvreplaysrc, plugin);
+  ret |= GST_TRACER_REGISTER (nvlatency, plugin);
+
+  return ret;
+}
+
+GST_PLUGIN_DEFINE (GST_VERSION_MAJOR,
+    GST_VERSION_MINOR,
+    nvplugins,
+    "CPU-first video analytics elements with SIMD kernels and pooled buffers",
+    plugin_init, VERSION, GST_LICENSE, GST_PACKAGE_NAME, GST_PACKAGE_ORIGIN)
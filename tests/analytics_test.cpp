@@ -0,0 +1,412 @@
+// RoiAnalytics: a few scenes worked out by hand (crossing direction,
+// class filters, dwell, exits on timeout), then random tracks over random
+// lines and zones against a reference that tests every line and zone for
+// every object without the grid. Events and counts must agree frame by
+// frame.
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "core/analytics.h"
+#include "tests/check.h"
+
+namespace nvgst {
+namespace {
+
+// Object whose bottom-center anchor is at (x, y).
+DetectedObject object_at(uint64_t track_id, float x, float y, int32_t class_id = 0) {
+  DetectedObject object = {};
+  object.track_id = track_id;
+  object.class_id = class_id;
+  object.width = 10.0f;
+  object.height = 20.0f;
+  object.x = x - 5.0f;
+  object.y = y - 20.0f;
+  return object;
+}
+
+std::vector<AnalyticsEvent> run(RoiAnalytics* analytics, std::vector<DetectedObject> objects,
+                                uint64_t time) {
+  std::vector<const DetectedObject*> pointers;
+  for (const DetectedObject& object : objects)
+    pointers.push_back(&object);
+  std::vector<AnalyticsEvent> events;
+  analytics->update(pointers.data(), static_cast<int>(pointers.size()), time, &events);
+  return events;
+}
+
+AnalyticsZone square_zone(float x0, float y0, float x1, float y1) {
+  AnalyticsZone zone;
+  zone.polygon = {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}};
+  return zone;
+}
+
+void test_line_directions() {
+  AnalyticsConfig config;
+  AnalyticsLine line;
+  // Pointing down the screen, whose right is towards smaller x.
+  line.a = {100.0f, 0.0f};
+  line.b = {100.0f, 200.0f};
+  config.lines.push_back(line);
+  line.direction = LineDirection::kNegative;
+  config.lines.push_back(line);
+  line.direction = LineDirection::kBoth;
+  line.classes = {2};
+  config.lines.push_back(line);
+
+  RoiAnalytics analytics;
+  CHECK(analytics.configure(config));
+  CHECK(run(&analytics, {object_at(1, 150.0f, 100.0f)}, 0).empty());
+  std::vector<AnalyticsEvent> events = run(&analytics, {object_at(1, 50.0f, 100.0f)}, 1);
+  CHECK(events.size() == 1);
+  if (events.size() == 1) {
+    CHECK(events[0].type == AnalyticsEventType::kLineCrossed && events[0].roi == 0);
+    CHECK(events[0].direction == 1 && events[0].track_id == 1 && events[0].object == 0);
+  }
+  events = run(&analytics, {object_at(1, 150.0f, 100.0f)}, 2);
+  CHECK(events.size() == 2);
+  // Past the end of the line is no crossing.
+  CHECK(run(&analytics, {object_at(1, 150.0f, 300.0f)}, 3).empty());
+  CHECK(run(&analytics, {object_at(1, 50.0f, 300.0f)}, 4).empty());
+  CHECK(run(&analytics, {object_at(1, 150.0f, 300.0f)}, 5).empty());
+  // A point on the line is on its left: touching it from the left and
+  // going back is no crossing.
+  CHECK(run(&analytics, {object_at(1, 100.0f, 100.0f)}, 6).empty());
+  CHECK(run(&analytics, {object_at(1, 150.0f, 100.0f)}, 7).empty());
+  // Only class 2 counts on the third line.
+  CHECK(run(&analytics, {object_at(1, 150.0f, 100.0f), object_at(2, 150.0f, 50.0f, 2)}, 8)
+            .empty());
+  events = run(&analytics, {object_at(1, 150.0f, 100.0f), object_at(2, 50.0f, 50.0f, 2)}, 9);
+  CHECK(events.size() == 2);
+  if (events.size() == 2)
+    CHECK(events[0].roi == 0 && events[1].roi == 2 && events[1].object == 1);
+
+  const std::vector<AnalyticsCount>& counts = analytics.line_counts();
+  CHECK(counts[0].in == 2 && counts[0].out == 1);
+  CHECK(counts[1].in == 0 && counts[1].out == 1);
+  CHECK(counts[2].in == 1 && counts[2].out == 0);
+}
+
+void test_zones() {
+  AnalyticsConfig config;
+  config.track_timeout = 100;
+  config.zones.push_back(square_zone(0.0f, 0.0f, 100.0f, 100.0f));
+  config.zones.back().dwell_threshold = 30;
+  config.zones.push_back(square_zone(50.0f, 50.0f, 150.0f, 150.0f));
+  config.zones.back().classes = {1};
+
+  RoiAnalytics analytics;
+  CHECK(analytics.configure(config));
+  std::vector<AnalyticsEvent> events = run(
+      &analytics, {object_at(1, 75.0f, 75.0f, 1), object_at(kNoTrack, 10.0f, 10.0f)}, 0);
+  CHECK(events.size() == 2);
+  CHECK(analytics.zone_counts()[0].occupancy == 2 && analytics.zone_counts()[1].occupancy == 1);
+  CHECK(analytics.zone_counts()[0].in == 1);
+
+  CHECK(run(&analytics, {object_at(1, 80.0f, 80.0f, 1)}, 20).empty());
+  events = run(&analytics, {object_at(1, 80.0f, 80.0f, 1)}, 30);
+  CHECK(events.size() == 1);
+  if (events.size() == 1)
+    CHECK(events[0].type == AnalyticsEventType::kDwell && events[0].roi == 0 &&
+          events[0].duration == 30);
+  // Dwell is raised once per visit.
+  CHECK(run(&analytics, {object_at(1, 80.0f, 80.0f, 1)}, 60).empty());
+
+  events = run(&analytics, {object_at(1, 120.0f, 120.0f, 1)}, 70);
+  CHECK(events.size() == 1);
+  if (events.size() == 1)
+    CHECK(events[0].type == AnalyticsEventType::kZoneExited && events[0].roi == 0 &&
+          events[0].duration == 70);
+
+  // Not seen for longer than the timeout: leaves zone 1 without an object.
+  CHECK(run(&analytics, {}, 170).empty());
+  events = run(&analytics, {}, 171);
+  CHECK(events.size() == 1);
+  if (events.size() == 1)
+    CHECK(events[0].type == AnalyticsEventType::kZoneExited && events[0].roi == 1 &&
+          events[0].object == -1 && events[0].duration == 70);
+  CHECK(analytics.n_tracks() == 0);
+  CHECK(analytics.zone_counts()[1].in == 1 && analytics.zone_counts()[1].out == 1);
+}
+
+void test_bad_config() {
+  RoiAnalytics analytics;
+  AnalyticsConfig config;
+  config.cell_size = 0.0f;
+  CHECK(!analytics.configure(config));
+
+  config = AnalyticsConfig();
+  AnalyticsLine line;
+  line.a = line.b = {5.0f, 5.0f};
+  config.lines.push_back(line);
+  CHECK(!analytics.configure(config));
+
+  config = AnalyticsConfig();
+  AnalyticsZone zone;
+  zone.polygon = {{0.0f, 0.0f}, {10.0f, 0.0f}};
+  config.zones.push_back(zone);
+  CHECK(!analytics.configure(config));
+}
+
+// The same rules as RoiAnalytics, testing every line and zone.
+class Reference {
+ public:
+  explicit Reference(const AnalyticsConfig& config)
+      : config_(config), lines_(config.lines.size()), zones_(config.zones.size()) {}
+
+  void update(const std::vector<DetectedObject>& objects, uint64_t time,
+              std::vector<AnalyticsEvent>* events) {
+    for (AnalyticsCount& count : zones_)
+      count.occupancy = 0;
+    for (size_t i = 0; i < objects.size(); i++) {
+      const DetectedObject& object = objects[i];
+      const AnalyticsPoint p = {object.x + object.width * 0.5f, object.y + object.height};
+      std::vector<int32_t> inside;
+      for (size_t z = 0; z < config_.zones.size(); z++) {
+        if (counts(config_.zones[z].classes, object.class_id) &&
+            in_polygon(config_.zones[z].polygon, p)) {
+          zones_[z].occupancy++;
+          inside.push_back(static_cast<int32_t>(z));
+        }
+      }
+      if (object.track_id == kNoTrack)
+        continue;
+      const int index = static_cast<int>(i);
+      auto found = tracks_.find(object.track_id);
+      Track& track = tracks_[object.track_id];
+      if (found != tracks_.end())
+        cross(track.last, p, object, index, events);
+
+      std::map<int32_t, Visit> visits;
+      for (const auto& [zone, visit] : track.visits) {
+        if (std::find(inside.begin(), inside.end(), zone) == inside.end()) {
+          zones_[zone].out++;
+          events->push_back({AnalyticsEventType::kZoneExited, zone, object.track_id, index, 0,
+                             time - visit.entered});
+        }
+      }
+      for (int32_t zone : inside) {
+        auto prev = track.visits.find(zone);
+        if (prev == track.visits.end()) {
+          zones_[zone].in++;
+          events->push_back(
+              {AnalyticsEventType::kZoneEntered, zone, object.track_id, index, 0, 0});
+          visits[zone] = {time, false};
+          continue;
+        }
+        Visit visit = prev->second;
+        const uint64_t threshold = config_.zones[zone].dwell_threshold;
+        if (threshold > 0 && !visit.dwelled && time - visit.entered >= threshold) {
+          visit.dwelled = true;
+          events->push_back({AnalyticsEventType::kDwell, zone, object.track_id, index, 0,
+                             time - visit.entered});
+        }
+        visits[zone] = visit;
+      }
+      track.visits = visits;
+      track.last = p;
+      track.seen = time;
+    }
+
+    for (auto it = tracks_.begin(); it != tracks_.end();) {
+      const Track& track = it->second;
+      if (time < track.seen || time - track.seen <= config_.track_timeout) {
+        ++it;
+        continue;
+      }
+      for (const auto& [zone, visit] : track.visits) {
+        zones_[zone].out++;
+        events->push_back({AnalyticsEventType::kZoneExited, zone, it->first, -1, 0,
+                           track.seen - visit.entered});
+      }
+      it = tracks_.erase(it);
+    }
+  }
+
+  const std::vector<AnalyticsCount>& line_counts() const { return lines_; }
+  const std::vector<AnalyticsCount>& zone_counts() const { return zones_; }
+
+ private:
+  struct Visit {
+    uint64_t entered;
+    bool dwelled;
+  };
+  struct Track {
+    AnalyticsPoint last;
+    uint64_t seen = 0;
+    std::map<int32_t, Visit> visits;
+  };
+
+  static float side(AnalyticsPoint a, AnalyticsPoint b, AnalyticsPoint p) {
+    return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+  }
+
+  static bool counts(const std::vector<int32_t>& classes, int32_t class_id) {
+    return classes.empty() ||
+           std::find(classes.begin(), classes.end(), class_id) != classes.end();
+  }
+
+  static bool in_polygon(const std::vector<AnalyticsPoint>& polygon, AnalyticsPoint p) {
+    bool inside = false;
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+      const AnalyticsPoint& a = polygon[i];
+      const AnalyticsPoint& b = polygon[j];
+      if ((a.y > p.y) != (b.y > p.y) && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x)
+        inside = !inside;
+    }
+    return inside;
+  }
+
+  void cross(AnalyticsPoint q, AnalyticsPoint p, const DetectedObject& object, int index,
+             std::vector<AnalyticsEvent>* events) {
+    if (q.x == p.x && q.y == p.y)
+      return;
+    for (size_t i = 0; i < config_.lines.size(); i++) {
+      const AnalyticsLine& line = config_.lines[i];
+      const bool was_right = side(line.a, line.b, q) > 0.0f;
+      const bool is_right = side(line.a, line.b, p) > 0.0f;
+      if (was_right == is_right || side(q, p, line.a) * side(q, p, line.b) > 0.0f ||
+          !counts(line.classes, object.class_id))
+        continue;
+      const int32_t direction = is_right ? 1 : -1;
+      if ((line.direction == LineDirection::kPositive && direction < 0) ||
+          (line.direction == LineDirection::kNegative && direction > 0))
+        continue;
+      (direction > 0 ? lines_[i].in : lines_[i].out)++;
+      events->push_back({AnalyticsEventType::kLineCrossed, static_cast<int32_t>(i),
+                         object.track_id, index, direction, 0});
+    }
+  }
+
+  AnalyticsConfig config_;
+  std::vector<AnalyticsCount> lines_;
+  std::vector<AnalyticsCount> zones_;
+  std::map<uint64_t, Track> tracks_;
+};
+
+auto event_key(const AnalyticsEvent& e) {
+  return std::make_tuple(static_cast<int>(e.type), e.roi, e.track_id, e.object, e.direction,
+                         e.duration);
+}
+
+bool same_events(std::vector<AnalyticsEvent> a, std::vector<AnalyticsEvent> b) {
+  auto less = [](const AnalyticsEvent& x, const AnalyticsEvent& y) {
+    return event_key(x) < event_key(y);
+  };
+  std::sort(a.begin(), a.end(), less);
+  std::sort(b.begin(), b.end(), less);
+  if (a.size() != b.size())
+    return false;
+  for (size_t i = 0; i < a.size(); i++) {
+    if (event_key(a[i]) != event_key(b[i]))
+      return false;
+  }
+  return true;
+}
+
+bool same_counts(const std::vector<AnalyticsCount>& a, const std::vector<AnalyticsCount>& b) {
+  if (a.size() != b.size())
+    return false;
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].occupancy != b[i].occupancy || a[i].in != b[i].in || a[i].out != b[i].out)
+      return false;
+  }
+  return true;
+}
+
+void test_against_reference(uint32_t seed, float cell_size) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> x_of(0.0f, 640.0f), y_of(0.0f, 480.0f);
+
+  AnalyticsConfig config;
+  config.cell_size = cell_size;
+  config.track_timeout = 40;
+  for (int i = 0; i < 8; i++) {
+    AnalyticsLine line;
+    line.a = {x_of(rng), y_of(rng)};
+    line.b = {x_of(rng), y_of(rng)};
+    line.direction = static_cast<LineDirection>(i % 3);
+    if (i % 4 == 3)
+      line.classes = {1};
+    config.lines.push_back(line);
+  }
+  for (int i = 0; i < 8; i++) {
+    AnalyticsZone zone;
+    // Random polygons of 3 to 8 points around a center: convex, concave
+    // or self-intersecting.
+    const float cx = x_of(rng), cy = y_of(rng);
+    const int points = 3 + i % 6;
+    for (int k = 0; k < points; k++) {
+      zone.polygon.push_back({cx + std::uniform_real_distribution<float>(-150.0f, 150.0f)(rng),
+                              cy + std::uniform_real_distribution<float>(-150.0f, 150.0f)(rng)});
+    }
+    zone.dwell_threshold = i % 2 ? 25 : 0;
+    if (i % 4 == 1)
+      zone.classes = {0, 2};
+    config.zones.push_back(zone);
+  }
+
+  RoiAnalytics analytics;
+  CHECK(analytics.configure(config));
+  Reference reference(config);
+
+  struct Walker {
+    float x, y;
+    int32_t class_id;
+    bool active;
+  };
+  std::vector<Walker> walkers(40);
+  for (Walker& w : walkers)
+    w = {x_of(rng), y_of(rng), static_cast<int32_t>(rng() % 3), true};
+
+  for (uint64_t frame = 0; frame < 3000; frame++) {
+    std::vector<DetectedObject> objects;
+    for (size_t t = 0; t < walkers.size(); t++) {
+      Walker& w = walkers[t];
+      // Tracks pause long enough to time out now and then.
+      if (rng() % 200 == 0)
+        w.active = !w.active;
+      if (!w.active)
+        continue;
+      w.x = std::min(700.0f, std::max(-60.0f, w.x + std::uniform_real_distribution<float>(
+                                                        -25.0f, 25.0f)(rng)));
+      w.y = std::min(540.0f, std::max(-60.0f, w.y + std::uniform_real_distribution<float>(
+                                                        -25.0f, 25.0f)(rng)));
+      const uint64_t track = t % 8 == 7 ? kNoTrack : static_cast<uint64_t>(t + 1);
+      objects.push_back(object_at(track, w.x, w.y, w.class_id));
+    }
+
+    std::vector<const DetectedObject*> pointers;
+    for (const DetectedObject& object : objects)
+      pointers.push_back(&object);
+    std::vector<AnalyticsEvent> got, want;
+    analytics.update(pointers.data(), static_cast<int>(pointers.size()), frame, &got);
+    reference.update(objects, frame, &want);
+
+    CHECK_MSG(same_events(got, want), "seed %u cell %g frame %llu: %zu events, reference %zu",
+              seed, cell_size, static_cast<unsigned long long>(frame), got.size(), want.size());
+    CHECK_MSG(same_counts(analytics.line_counts(), reference.line_counts()) &&
+                  same_counts(analytics.zone_counts(), reference.zone_counts()),
+              "seed %u cell %g frame %llu: counts differ", seed, cell_size,
+              static_cast<unsigned long long>(frame));
+    if (nvgst::test::failures() > 10)
+      return;
+  }
+}
+
+}  // namespace
+}  // namespace nvgst
+
+int main() {
+  nvgst::test_line_directions();
+  nvgst::test_zones();
+  nvgst::test_bad_config();
+  for (uint32_t seed = 1; seed <= 4; seed++) {
+    for (float cell_size : {8.0f, 37.0f, 64.0f, 1000.0f})
+      nvgst::test_against_reference(seed, cell_size);
+  }
+  return nvgst::test::check_result("analytics_test");
+}
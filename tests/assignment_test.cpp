@@ -0,0 +1,145 @@
+// AssignmentSolver against brute force: the Hungarian method must reach
+// the best total score over the feasible pairs, and greedy matching must
+// pick exactly the pairs a straightforward sort would, on dense and sparse
+// random matrices alike.
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "core/assignment.h"
+#include "tests/check.h"
+
+namespace nvgst {
+namespace {
+
+// Best total score of any matching of rows [row, rows) to free columns.
+double best_total(const std::vector<float>& score, int rows, int cols, float min_score, int row,
+                  std::vector<bool>* taken) {
+  if (row == rows)
+    return 0.0;
+  double best = best_total(score, rows, cols, min_score, row + 1, taken);
+  for (int c = 0; c < cols; c++) {
+    const float s = score[row * cols + c];
+    if ((*taken)[c] || s < min_score)
+      continue;
+    (*taken)[c] = true;
+    best = std::max(best, s + best_total(score, rows, cols, min_score, row + 1, taken));
+    (*taken)[c] = false;
+  }
+  return best;
+}
+
+void greedy_reference(const std::vector<float>& score, int rows, int cols, float min_score,
+                      std::vector<int>* match) {
+  struct Pair {
+    float score;
+    int row;
+    int col;
+  };
+  std::vector<Pair> pairs;
+  for (int r = 0; r < rows; r++) {
+    for (int c = 0; c < cols; c++) {
+      if (score[r * cols + c] >= min_score)
+        pairs.push_back({score[r * cols + c], r, c});
+    }
+  }
+  std::sort(pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) {
+    if (a.score != b.score)
+      return a.score > b.score;
+    return a.row != b.row ? a.row < b.row : a.col < b.col;
+  });
+  match->assign(rows, -1);
+  std::vector<bool> col_taken(cols, false);
+  for (const Pair& p : pairs) {
+    if ((*match)[p.row] < 0 && !col_taken[p.col]) {
+      (*match)[p.row] = p.col;
+      col_taken[p.col] = true;
+    }
+  }
+}
+
+// Checks that match is a matching of feasible pairs and returns its total.
+bool valid_matching(const std::vector<float>& score, int rows, int cols, float min_score,
+                    const std::vector<int>& match, int count, double* total) {
+  std::vector<bool> col_taken(cols, false);
+  int matched = 0;
+  *total = 0.0;
+  for (int r = 0; r < rows; r++) {
+    const int c = match[r];
+    if (c < 0)
+      continue;
+    if (c >= cols || col_taken[c] || score[r * cols + c] < min_score)
+      return false;
+    col_taken[c] = true;
+    *total += score[r * cols + c];
+    matched++;
+  }
+  return matched == count;
+}
+
+// Pairs are feasible with probability density; with min_score 0, a share
+// zero_rate of the infeasible ones become feasible at score 0.
+void test_random(std::mt19937* rng, int trials, int max_side, float density, float zero_rate) {
+  AssignmentSolver solver;
+  std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+  for (int t = 0; t < trials; t++) {
+    const int rows = std::uniform_int_distribution<int>(0, max_side)(*rng);
+    const int cols = std::uniform_int_distribution<int>(0, max_side)(*rng);
+    const float min_score = t % 3 == 0 ? 0.0f : 0.3f;
+    std::vector<float> score(static_cast<size_t>(rows) * cols);
+    for (float& s : score) {
+      // Coarse values so ties come up; below min_score when infeasible.
+      s = uniform(*rng) < density ? 0.3f + std::floor(uniform(*rng) * 8.0f) / 10.0f
+                                  : min_score - 0.2f;
+      if (min_score == 0.0f && s < min_score && uniform(*rng) < zero_rate)
+        s = 0.0f;
+    }
+
+    std::vector<int> match(rows, -2);
+    const int count = solver.solve(score.data(), rows, cols, min_score,
+                                   AssignmentMethod::kHungarian, match.data());
+    double total = 0.0;
+    CHECK_MSG(valid_matching(score, rows, cols, min_score, match, count, &total),
+              "hungarian trial %d (%dx%d) returned an invalid matching", t, rows, cols);
+    std::vector<bool> taken(cols, false);
+    const double best = best_total(score, rows, cols, min_score, 0, &taken);
+    CHECK_MSG(std::fabs(total - best) < 1e-4, "hungarian trial %d (%dx%d): %f, best %f", t, rows,
+              cols, total, best);
+
+    std::vector<int> expected;
+    greedy_reference(score, rows, cols, min_score, &expected);
+    match.assign(rows, -2);
+    solver.solve(score.data(), rows, cols, min_score, AssignmentMethod::kGreedy, match.data());
+    CHECK_MSG(match == expected, "greedy trial %d (%dx%d) differs from the reference", t, rows,
+              cols);
+  }
+}
+
+// Isolated one-to-one pairs take the solver's shortcut; they must still be
+// matched, and pairs under the threshold must not.
+void test_isolated_pairs() {
+  const int n = 50;
+  std::vector<float> score(n * n, 0.0f);
+  for (int i = 0; i < n; i++)
+    score[i * n + (n - 1 - i)] = i % 5 == 0 ? 0.2f : 0.9f;
+  AssignmentSolver solver;
+  std::vector<int> match(n);
+  const int count =
+      solver.solve(score.data(), n, n, 0.5f, AssignmentMethod::kHungarian, match.data());
+  CHECK(count == n - n / 5);
+  for (int i = 0; i < n; i++)
+    CHECK_MSG(match[i] == (i % 5 == 0 ? -1 : n - 1 - i), "row %d matched %d", i, match[i]);
+}
+
+}  // namespace
+}  // namespace nvgst
+
+int main() {
+  std::mt19937 rng(7);
+  nvgst::test_random(&rng, 2000, 6, 0.7f, 0.5f);
+  // Sparse and larger: several components per matrix.
+  nvgst::test_random(&rng, 500, 14, 0.12f, 0.02f);
+  nvgst::test_isolated_pairs();
+  return nvgst::test::check_result("assignment_test");
+}
@@ -0,0 +1,277 @@
+// CaptureWriter and CaptureReader: records written through both write
+// paths read back with their blocks, data and alignment intact, every
+// token is released, and files without a usable index (no trailer, a
+// record cut short, damaged entries) are read by rebuilding the index.
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "core/capture.h"
+#include "tests/check.h"
+
+namespace nvgst {
+namespace {
+
+constexpr uint32_t kTestBlock = kCaptureUserBlock + 3;
+constexpr int kBuffers = 40;
+constexpr size_t kTrailerSize = 64;
+constexpr size_t kEntrySize = sizeof(CaptureIndexEntry);
+
+int g_released = 0;
+
+void release(void* token) {
+  g_released++;
+  delete[] static_cast<uint8_t*>(token);
+}
+
+size_t segment_size(int buffer, size_t segment) {
+  return 700 + static_cast<size_t>(buffer) * 37 + segment * 129;
+}
+
+uint8_t segment_byte(int buffer, size_t segment, size_t k) {
+  return static_cast<uint8_t>(buffer * 7 + segment * 31 + k);
+}
+
+// A caps record, then kBuffers buffer records of 0 to 2 segments, with a
+// caps change half way.
+bool write_file(const std::string& path, bool use_uring, int* segments_written) {
+  CaptureWriter writer(release);
+  if (!writer.open(path, use_uring))
+    return false;
+  writer.set_max_backlog(0);
+
+  CaptureBlocks blocks;
+  CaptureRecordInfo caps;
+  caps.kind = CaptureRecordKind::kCaps;
+  blocks.add(kCaptureUserBlock, "video/x-raw", 12);
+  CHECK(writer.write(caps, blocks, nullptr, 0));
+
+  *segments_written = 0;
+  for (int i = 0; i < kBuffers; i++) {
+    if (i == kBuffers / 2) {
+      blocks.clear();
+      blocks.add(kCaptureUserBlock, "video/x-raw,width=2", 20);
+      CHECK(writer.write(caps, blocks, nullptr, 0));
+    }
+    blocks.clear();
+    const uint32_t value = static_cast<uint32_t>(i);
+    blocks.add(kTestBlock, &value, sizeof(value));
+    // An empty block and one of odd size, to move the data blocks about.
+    blocks.add(kTestBlock + 1, nullptr, 0);
+    memset(blocks.add(kTestBlock + 2, 1 + i % 23), 0xab, 1 + i % 23);
+
+    std::vector<CaptureWriter::Segment> segments;
+    for (size_t s = 0; s < static_cast<size_t>(i % 3); s++) {
+      const size_t size = segment_size(i, s);
+      uint8_t* data = new uint8_t[size];
+      for (size_t k = 0; k < size; k++)
+        data[k] = segment_byte(i, s, k);
+      segments.push_back({data, size, data});
+    }
+    CaptureRecordInfo info;
+    info.pts = i == 5 ? UINT64_MAX : static_cast<uint64_t>(i) * 1000;
+    info.duration = 1000;
+    info.flags = static_cast<uint32_t>(i);
+    CHECK(writer.write(info, blocks, segments.data(), segments.size()));
+    *segments_written += static_cast<int>(segments.size());
+  }
+  CHECK(writer.records() == kBuffers + 2);
+  return writer.close() == 0;
+}
+
+// Checks buffer records [0, buffers) and the caps records around them.
+void check_records(const CaptureReader& reader, int buffers, const char* what) {
+  CHECK_MSG(reader.size() == static_cast<size_t>(buffers + (buffers > kBuffers / 2 ? 2 : 1)),
+            "%s: %zu records", what, reader.size());
+  int buffer = 0;
+  for (size_t i = 0; i < reader.size(); i++) {
+    CaptureRecord record;
+    if (!reader.read(i, &record)) {
+      CHECK_MSG(false, "%s: record %zu unreadable", what, i);
+      continue;
+    }
+    if (record.info.kind == CaptureRecordKind::kCaps) {
+      CHECK_MSG(record.blocks.size() == 1 && record.blocks[0].type == kCaptureUserBlock,
+                "%s: caps record %zu", what, i);
+      continue;
+    }
+    const int b = buffer++;
+    const size_t n_segments = static_cast<size_t>(b % 3);
+    CHECK_MSG(record.info.pts == (b == 5 ? UINT64_MAX : static_cast<uint64_t>(b) * 1000) &&
+                  record.info.duration == 1000 && record.info.flags == static_cast<uint32_t>(b),
+              "%s: record %zu info", what, i);
+    CHECK_MSG(reader.entry(i).pts == record.info.pts && reader.entry(i).offset == record.offset,
+              "%s: index entry %zu", what, i);
+    if (record.blocks.size() != 3 + n_segments) {
+      CHECK_MSG(false, "%s: record %zu has %zu blocks", what, i, record.blocks.size());
+      continue;
+    }
+    CHECK_MSG(record.blocks[0].type == kTestBlock && record.blocks[0].size == 4 &&
+                  memcmp(record.blocks[0].data, &b, 4) == 0,
+              "%s: record %zu first block", what, i);
+    CHECK_MSG(record.blocks[1].type == kTestBlock + 1 && record.blocks[1].size == 0,
+              "%s: record %zu empty block", what, i);
+    CHECK_MSG(record.blocks[2].size == static_cast<size_t>(1 + b % 23),
+              "%s: record %zu odd block", what, i);
+    for (size_t s = 0; s < n_segments; s++) {
+      const CaptureBlock& block = record.blocks[3 + s];
+      bool same = block.type == kCaptureDataBlock && block.size == segment_size(b, s);
+      for (size_t k = 0; same && k < block.size; k++)
+        same = block.data[k] == segment_byte(b, s, k);
+      CHECK_MSG(same, "%s: record %zu segment %zu", what, i, s);
+      CHECK_MSG(reinterpret_cast<uintptr_t>(block.data) % kCaptureAlign == 0,
+                "%s: record %zu segment %zu is not aligned", what, i, s);
+    }
+  }
+  CHECK_MSG(buffer == buffers, "%s: %d buffer records", what, buffer);
+}
+
+std::vector<uint8_t> read_bytes(const std::string& path) {
+  std::vector<uint8_t> bytes;
+  FILE* f = fopen(path.c_str(), "rb");
+  if (f == nullptr)
+    return bytes;
+  uint8_t chunk[65536];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+    bytes.insert(bytes.end(), chunk, chunk + n);
+  fclose(f);
+  return bytes;
+}
+
+void write_bytes(const std::string& path, const std::vector<uint8_t>& bytes) {
+  FILE* f = fopen(path.c_str(), "wb");
+  CHECK(f != nullptr);
+  if (f == nullptr)
+    return;
+  CHECK(fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size());
+  fclose(f);
+}
+
+uint64_t load_u64(const std::vector<uint8_t>& bytes, size_t at) {
+  uint64_t value;
+  memcpy(&value, bytes.data() + at, sizeof(value));
+  return value;
+}
+
+void store_u64(std::vector<uint8_t>* bytes, size_t at, uint64_t value) {
+  memcpy(bytes->data() + at, &value, sizeof(value));
+}
+
+void test_round_trip(const std::string& path, bool use_uring) {
+  g_released = 0;
+  int segments = 0;
+  CHECK_MSG(write_file(path, use_uring, &segments), "writing %s failed", path.c_str());
+  CHECK_MSG(g_released == segments, "%d of %d tokens released", g_released, segments);
+
+  CaptureReader reader;
+  std::string error;
+  for (bool populate : {false, true}) {
+    if (!reader.open(path, populate, &error)) {
+      CHECK_MSG(false, "%s", error.c_str());
+      return;
+    }
+    CHECK(reader.complete());
+    check_records(reader, kBuffers, use_uring ? "io_uring" : "pwritev");
+    reader.prefetch(0, reader.size() + 10);
+  }
+
+  // Record 0 is caps, buffers 0..19 are 1..20, caps at 21, buffers on.
+  CHECK(reader.caps_before(0) == 0);
+  CHECK(reader.caps_before(20) == 0);
+  CHECK(reader.caps_before(21) == 21);
+  CHECK(reader.caps_before(30) == 21);
+  CHECK(reader.seek(0) == 1);
+  // Buffer 5 has no pts and is skipped; buffer 6 is record 7.
+  CHECK(reader.seek(4500) == 7);
+  CHECK(reader.seek(25000) == 27);
+  CHECK(reader.seek(UINT64_MAX - 1) == reader.size());
+}
+
+void test_rebuild(const std::string& path, const std::string& damaged) {
+  const std::vector<uint8_t> file = read_bytes(path);
+  CHECK(file.size() > kTrailerSize);
+  if (file.size() <= kTrailerSize)
+    return;
+  const size_t index_offset = static_cast<size_t>(load_u64(file, file.size() - kTrailerSize + 8));
+  CaptureReader reader;
+  std::string error;
+
+  // Cut where the writer would have stopped: no index, no trailer.
+  std::vector<uint8_t> bytes(file.begin(), file.begin() + index_offset);
+  write_bytes(damaged, bytes);
+  CHECK(reader.open(damaged, false, &error));
+  CHECK(!reader.complete());
+  check_records(reader, kBuffers, "no trailer");
+
+  // The last record is cut off after its header.
+  const size_t records = (file.size() - kTrailerSize - index_offset) / kEntrySize;
+  bytes.resize(load_u64(file, index_offset + (records - 1) * kEntrySize) + 80);
+  write_bytes(damaged, bytes);
+  CHECK(reader.open(damaged, false, &error));
+  check_records(reader, kBuffers - 1, "cut short");
+
+  // Index entries that point outside the records, one at a time: an
+  // offset + size that overflows, an offset inside the file header, a size
+  // smaller than a record header and one running into the index.
+  struct Damage {
+    size_t field;
+    uint64_t value;
+  };
+  const Damage damages[] = {
+      {0, UINT64_MAX - 63},
+      {0, 8},
+      {8, 16},
+      {8, index_offset},
+  };
+  for (const Damage& damage : damages) {
+    bytes = file;
+    store_u64(&bytes, index_offset + 3 * kEntrySize + damage.field, damage.value);
+    write_bytes(damaged, bytes);
+    CHECK(reader.open(damaged, false, &error));
+    CHECK_MSG(!reader.complete(), "damaged field %zu = %llu was trusted", damage.field,
+              static_cast<unsigned long long>(damage.value));
+    check_records(reader, kBuffers, "damaged index");
+  }
+
+  // Not a capture file at all.
+  write_bytes(damaged, std::vector<uint8_t>(256, 0x5a));
+  CHECK(!reader.open(damaged, false, &error));
+  CHECK(!error.empty());
+}
+
+std::string temp_path(const char* name) {
+  const char* dir = std::getenv("TMPDIR");
+  std::string path = std::string(dir && *dir ? dir : "/tmp") + "/" + name + "-XXXXXX";
+  std::vector<char> buffer(path.begin(), path.end());
+  buffer.push_back('\0');
+  const int fd = mkstemp(buffer.data());
+  if (fd >= 0)
+    ::close(fd);
+  return buffer.data();
+}
+
+}  // namespace
+}  // namespace nvgst
+
+int main() {
+  const std::string path = nvgst::temp_path("nvgst-capture");
+  const std::string damaged = nvgst::temp_path("nvgst-capture-damaged");
+
+  nvgst::test_round_trip(path, false);
+  nvgst::test_round_trip(path, true);
+  nvgst::test_rebuild(path, damaged);
+
+  nvgst::CaptureWriter writer(nvgst::release);
+  CHECK(!writer.open("/nonexistent-dir/capture.nvcap"));
+
+  unlink(path.c_str());
+  unlink(damaged.c_str());
+  return nvgst::test::check_result("capture_test");
+}
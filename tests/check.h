@@ -0,0 +1,45 @@
+// Minimal assertions for the nvgstcore tests. A failed CHECK reports where
+// it failed and the test carries on, so one run lists every mismatch; main
+// returns check_result().
+#pragma once
+
+#include <cstdio>
+
+namespace nvgst {
+namespace test {
+
+inline int& failures() {
+  static int count = 0;
+  return count;
+}
+
+inline int check_result(const char* name) {
+  if (failures() == 0) {
+    std::printf("%s: ok\n", name);
+    return 0;
+  }
+  std::printf("%s: %d failed checks\n", name, failures());
+  return 1;
+}
+
+}  // namespace test
+}  // namespace nvgst
+
+#define CHECK(cond)                                                                 \
+  do {                                                                              \
+    if (!(cond)) {                                                                  \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      nvgst::test::failures()++;                                                    \
+    }                                                                               \
+  } while (0)
+
+// CHECK with a printf-style description of the case, for loops over inputs.
+#define CHECK_MSG(cond, ...)                                                        \
+  do {                                                                              \
+    if (!(cond)) {                                                                  \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed: ", __FILE__, __LINE__, #cond); \
+      std::fprintf(stderr, __VA_ARGS__);                                            \
+      std::fprintf(stderr, "\n");                                                   \
+      nvgst::test::failures()++;                                                    \
+    }                                                                               \
+  } while (0)
@@ -0,0 +1,448 @@
+// Every Kernels entry at every SIMD level this machine runs, against the
+// scalar table on random rows. Widths cover the vector bodies and every
+// tail length; outputs must match bit for bit, except dot_rows_f32, whose
+// summation order is allowed to differ.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "core/kernels.h"
+#include "tests/check.h"
+
+namespace nvgst {
+namespace {
+
+using simd::Kernels;
+
+const int kWidths[] = {1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 257};
+
+class Rng {
+ public:
+  uint8_t byte() { return static_cast<uint8_t>(engine_() & 0xff); }
+  int range(int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(engine_); }
+  float uniform(float lo, float hi) {
+    return std::uniform_real_distribution<float>(lo, hi)(engine_);
+  }
+  std::vector<uint8_t> bytes(size_t n) {
+    std::vector<uint8_t> v(n);
+    for (uint8_t& b : v)
+      b = byte();
+    return v;
+  }
+  std::vector<float> floats(size_t n, float lo, float hi) {
+    std::vector<float> v(n);
+    for (float& f : v)
+      f = uniform(lo, hi);
+    return v;
+  }
+
+ private:
+  std::mt19937 engine_{20240601};
+};
+
+template <typename T>
+bool same(const std::vector<T>& a, const std::vector<T>& b) {
+  return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+void test_yuv_to_rgb(const Kernels& s, const Kernels& k, Rng& rng) {
+  for (ColorMatrix matrix : {ColorMatrix::kBT601, ColorMatrix::kBT709}) {
+    const simd::YuvToRgbCoeffs& c = simd::yuv_to_rgb_coeffs(matrix);
+    for (int w : kWidths) {
+      for (bool bgr : {false, true}) {
+        std::vector<uint8_t> y = rng.bytes(w), u = rng.bytes((w + 1) / 2),
+                             v = rng.bytes((w + 1) / 2);
+        std::vector<uint8_t> a(4 * w), b(4 * w);
+        s.yuv_to_rgb_row(y.data(), u.data(), v.data(), a.data(), w, c, bgr);
+        k.yuv_to_rgb_row(y.data(), u.data(), v.data(), b.data(), w, c, bgr);
+        CHECK_MSG(same(a, b), "yuv_to_rgb_row width %d bgr %d", w, bgr);
+      }
+    }
+  }
+}
+
+void test_rgb_to_yuv(const Kernels& s, const Kernels& k, Rng& rng) {
+  for (ColorMatrix matrix : {ColorMatrix::kBT601, ColorMatrix::kBT709}) {
+    const simd::RgbToYuvCoeffs& c = simd::rgb_to_yuv_coeffs(matrix);
+    for (int w : kWidths) {
+      for (bool bgr : {false, true}) {
+        std::vector<uint8_t> src0 = rng.bytes(4 * w), src1 = rng.bytes(4 * w);
+        std::vector<uint8_t> ya(w), yb(w);
+        s.rgb_to_y_row(src0.data(), ya.data(), w, c, bgr);
+        k.rgb_to_y_row(src0.data(), yb.data(), w, c, bgr);
+        CHECK_MSG(same(ya, yb), "rgb_to_y_row width %d bgr %d", w, bgr);
+
+        const int cw = (w + 1) / 2;
+        std::vector<uint8_t> ua(cw), va(cw), ub(cw), vb(cw);
+        s.rgb_to_uv_row(src0.data(), src1.data(), ua.data(), va.data(), w, c, bgr);
+        k.rgb_to_uv_row(src0.data(), src1.data(), ub.data(), vb.data(), w, c, bgr);
+        CHECK_MSG(same(ua, ub) && same(va, vb), "rgb_to_uv_row width %d bgr %d", w, bgr);
+      }
+    }
+  }
+}
+
+void test_uv_and_swizzle(const Kernels& s, const Kernels& k, Rng& rng) {
+  for (int n : kWidths) {
+    std::vector<uint8_t> uv = rng.bytes(2 * n);
+    std::vector<uint8_t> ua(n), va(n), ub(n), vb(n);
+    s.split_uv_row(uv.data(), ua.data(), va.data(), n);
+    k.split_uv_row(uv.data(), ub.data(), vb.data(), n);
+    CHECK_MSG(same(ua, ub) && same(va, vb), "split_uv_row n %d", n);
+
+    std::vector<uint8_t> ma(2 * n), mb(2 * n);
+    s.merge_uv_row(ua.data(), va.data(), ma.data(), n);
+    k.merge_uv_row(ua.data(), va.data(), mb.data(), n);
+    CHECK_MSG(same(ma, mb), "merge_uv_row n %d", n);
+
+    for (bool swap : {false, true}) {
+      std::vector<uint8_t> src = rng.bytes(4 * n), a(4 * n), b(4 * n);
+      s.swizzle_rgb_row(src.data(), a.data(), n, swap);
+      k.swizzle_rgb_row(src.data(), b.data(), n, swap);
+      CHECK_MSG(same(a, b), "swizzle_rgb_row n %d swap %d", n, swap);
+    }
+  }
+}
+
+void test_lerp(const Kernels& s, const Kernels& k, Rng& rng) {
+  for (int n : kWidths) {
+    for (int frac : {0, 1, 77, 128, 255, 256}) {
+      std::vector<uint8_t> x = rng.bytes(n), y = rng.bytes(n), a(n), b(n);
+      s.lerp_row(x.data(), y.data(), a.data(), n, frac);
+      k.lerp_row(x.data(), y.data(), b.data(), n, frac);
+      CHECK_MSG(same(a, b), "lerp_row n %d frac %d", n, frac);
+    }
+  }
+}
+
+void test_blend(const Kernels& s, const Kernels& k, Rng& rng) {
+  for (int n : kWidths) {
+    for (int alpha : {0, 1, 128, 254, 255}) {
+      for (bool swap : {false, true}) {
+        std::vector<uint8_t> src = rng.bytes(4 * n), a = rng.bytes(4 * n), b = a;
+        s.blend_row(src.data(), a.data(), n, alpha, swap);
+        k.blend_row(src.data(), b.data(), n, alpha, swap);
+        CHECK_MSG(same(a, b), "blend_row n %d alpha %d swap %d", n, alpha, swap);
+      }
+    }
+  }
+}
+
+void test_spans(const Kernels& s, const Kernels& k, Rng& rng) {
+  for (int n : kWidths) {
+    for (int bpp : {1, 2, 4}) {
+      const uint32_t pattern = static_cast<uint32_t>(rng.range(0, 0x7fffffff)) * 2u + 1u;
+      std::vector<uint8_t> a = rng.bytes(bpp * n), b = a;
+      s.fill_span(a.data(), n, pattern, bpp);
+      k.fill_span(b.data(), n, pattern, bpp);
+      CHECK_MSG(same(a, b), "fill_span n %d bpp %d", n, bpp);
+
+      for (int alpha : {0, 1, 100, 255}) {
+        a = rng.bytes(bpp * n);
+        b = a;
+        s.blend_span(a.data(), n, pattern, bpp, alpha);
+        k.blend_span(b.data(), n, pattern, bpp, alpha);
+        CHECK_MSG(same(a, b), "blend_span n %d bpp %d alpha %d", n, bpp, alpha);
+
+        std::vector<uint8_t> mask = rng.bytes(n);
+        a = rng.bytes(bpp * n);
+        b = a;
+        s.blend_mask_span(a.data(), mask.data(), n, pattern, bpp, alpha);
+        k.blend_mask_span(b.data(), mask.data(), n, pattern, bpp, alpha);
+        CHECK_MSG(same(a, b), "blend_mask_span n %d bpp %d alpha %d", n, bpp, alpha);
+      }
+    }
+  }
+}
+
+void test_iou(const Kernels& s, const Kernels& k, Rng& rng) {
+  for (int n : kWidths) {
+    std::vector<float> x0 = rng.floats(n, 0.0f, 500.0f), y0 = rng.floats(n, 0.0f, 500.0f);
+    std::vector<float> x1(n), y1(n);
+    for (int i = 0; i < n; i++) {
+      // Some empty boxes, where the union can be empty too.
+      x1[i] = x0[i] + (i % 7 == 0 ? 0.0f : rng.uniform(1.0f, 200.0f));
+      y1[i] = y0[i] + (i % 11 == 0 ? 0.0f : rng.uniform(1.0f, 200.0f));
+    }
+    const float box[4] = {100.0f, 120.0f, 260.0f, 300.0f};
+    const float empty[4] = {50.0f, 50.0f, 50.0f, 50.0f};
+    for (const float* b : {box, empty}) {
+      std::vector<float> a(n), c(n);
+      s.iou_row(x0.data(), y0.data(), x1.data(), y1.data(), n, b, a.data());
+      k.iou_row(x0.data(), y0.data(), x1.data(), y1.data(), n, b, c.data());
+      CHECK_MSG(same(a, c), "iou_row n %d", n);
+    }
+  }
+}
+
+void test_kalman(const Kernels& s, const Kernels& k, Rng& rng) {
+  const float inf = std::numeric_limits<float>::infinity();
+  for (int n : kWidths) {
+    std::vector<float> pos = rng.floats(n, 0.0f, 1000.0f), vel = rng.floats(n, -5.0f, 5.0f);
+    std::vector<float> p00 = rng.floats(n, 1.0f, 50.0f), p01 = rng.floats(n, -1.0f, 1.0f);
+    std::vector<float> p11 = rng.floats(n, 1.0f, 10.0f), scale = rng.floats(n, 10.0f, 200.0f);
+    std::vector<float> z = rng.floats(n, 0.0f, 1000.0f), r = rng.floats(n, 0.5f, 20.0f);
+    for (int i = 0; i < n; i += 3)
+      r[i] = inf;
+
+    std::vector<float> a[5] = {pos, vel, p00, p01, p11};
+    std::vector<float> b[5] = {pos, vel, p00, p01, p11};
+    // A few rounds, so differences would compound.
+    for (int round = 0; round < 4; round++) {
+      s.kalman_predict(a[0].data(), a[1].data(), a[2].data(), a[3].data(), a[4].data(),
+                       scale.data(), 0.01f, 0.001f, n);
+      k.kalman_predict(b[0].data(), b[1].data(), b[2].data(), b[3].data(), b[4].data(),
+                       scale.data(), 0.01f, 0.001f, n);
+      s.kalman_update(a[0].data(), a[1].data(), a[2].data(), a[3].data(), a[4].data(), z.data(),
+                      r.data(), n);
+      k.kalman_update(b[0].data(), b[1].data(), b[2].data(), b[3].data(), b[4].data(), z.data(),
+                      r.data(), n);
+    }
+    bool equal = true;
+    for (int j = 0; j < 5; j++)
+      equal = equal && same(a[j], b[j]);
+    CHECK_MSG(equal, "kalman_predict/update n %d", n);
+  }
+}
+
+void test_planar(const Kernels& s, const Kernels& k, Rng& rng) {
+  const float offset[3] = {123.675f, 116.28f, 103.53f};
+  const float scale[3] = {1.0f / 58.395f, 1.0f / 57.12f, 1.0f / 57.375f};
+  for (int n : kWidths) {
+    std::vector<uint8_t> src = rng.bytes(4 * n);
+    std::vector<float> a[3] = {std::vector<float>(n), std::vector<float>(n),
+                               std::vector<float>(n)};
+    std::vector<float> b[3] = {a[0], a[1], a[2]};
+    s.planar_f32_row(src.data(), n, a[0].data(), a[1].data(), a[2].data(), offset, scale);
+    k.planar_f32_row(src.data(), n, b[0].data(), b[1].data(), b[2].data(), offset, scale);
+    CHECK_MSG(same(a[0], b[0]) && same(a[1], b[1]) && same(a[2], b[2]), "planar_f32_row n %d",
+              n);
+  }
+}
+
+void test_argmax_and_select(const Kernels& s, const Kernels& k, Rng& rng) {
+  for (int n : kWidths) {
+    for (int count : {1, 2, 5, 80}) {
+      const size_t stride = n + 3;
+      std::vector<float> rows = rng.floats(stride * count, -10.0f, 10.0f);
+      // Ties must go to the first row at every level.
+      for (int i = 0; i < n; i += 4)
+        rows[(count - 1) * stride + i] = rows[i];
+      std::vector<float> best_a(n), best_b(n);
+      std::vector<int32_t> index_a(n), index_b(n);
+      s.argmax_rows(rows.data(), stride, count, n, best_a.data(), index_a.data());
+      k.argmax_rows(rows.data(), stride, count, n, best_b.data(), index_b.data());
+      CHECK_MSG(same(best_a, best_b) && same(index_a, index_b), "argmax_rows n %d count %d", n,
+                count);
+    }
+
+    std::vector<float> v = rng.floats(n, 0.0f, 1.0f);
+    for (float threshold : {0.0f, 0.5f, 0.99f, 2.0f}) {
+      std::vector<int32_t> ia(n, -1), ib(n, -1);
+      const int ca = s.select_above(v.data(), n, threshold, ia.data());
+      const int cb = k.select_above(v.data(), n, threshold, ib.data());
+      ia.resize(ca);
+      ib.resize(cb);
+      CHECK_MSG(ca == cb && same(ia, ib), "select_above n %d threshold %g", n, threshold);
+    }
+  }
+}
+
+void test_accumulate_and_sad(const Kernels& s, const Kernels& k, Rng& rng) {
+  for (int n : kWidths) {
+    std::vector<uint16_t> a(n), b(n);
+    for (int i = 0; i < n; i++)
+      a[i] = b[i] = static_cast<uint16_t>(rng.range(0, 65535));
+    for (int row = 0; row < 3; row++) {
+      std::vector<uint8_t> src = rng.bytes(n);
+      s.accumulate_row(src.data(), a.data(), n);
+      k.accumulate_row(src.data(), b.data(), n);
+    }
+    CHECK_MSG(same(a, b), "accumulate_row n %d", n);
+
+    std::vector<uint8_t> x = rng.bytes(n), y = rng.bytes(n);
+    CHECK_MSG(s.sad_row(x.data(), y.data(), n) == k.sad_row(x.data(), y.data(), n),
+              "sad_row n %d", n);
+  }
+}
+
+void test_lerp_pixels(const Kernels& s, const Kernels& k, Rng& rng) {
+  const int src_width = 300;
+  std::vector<uint8_t> src = rng.bytes(4 * src_width);
+  for (int n : kWidths) {
+    std::vector<int32_t> x0(n), x1(n);
+    std::vector<uint16_t> frac(n);
+    for (int i = 0; i < n; i++) {
+      const int x = rng.range(0, src_width - 2);
+      x0[i] = 4 * x;
+      x1[i] = 4 * (x + 1);
+      frac[i] = static_cast<uint16_t>(rng.range(0, 256));
+    }
+    std::vector<uint8_t> a(4 * n), b(4 * n);
+    s.lerp_pixels(src.data(), x0.data(), x1.data(), frac.data(), a.data(), n);
+    k.lerp_pixels(src.data(), x0.data(), x1.data(), frac.data(), b.data(), n);
+    CHECK_MSG(same(a, b), "lerp_pixels n %d", n);
+  }
+}
+
+void test_remap(const Kernels& s, const Kernels& k, Rng& rng) {
+  const int width = 90, height = 40;
+  for (int bpp : {1, 2, 4}) {
+    const int stride = width * bpp + 8;
+    std::vector<uint8_t> src = rng.bytes(static_cast<size_t>(stride) * height);
+    for (int n : kWidths) {
+      std::vector<uint32_t> taps(n);
+      std::vector<uint16_t> frac(n);
+      for (int i = 0; i < n; i++) {
+        const uint32_t x = static_cast<uint32_t>(rng.range(0, width - 2));
+        const uint32_t y = static_cast<uint32_t>(rng.range(0, height - 2));
+        taps[i] = y << 16 | x;
+        frac[i] = static_cast<uint16_t>(rng.range(0, 255) << 8 | rng.range(0, 255));
+      }
+      std::vector<uint8_t> a(bpp * n), b(bpp * n);
+      s.remap_row(src.data(), stride, taps.data(), frac.data(), a.data(), n, bpp);
+      k.remap_row(src.data(), stride, taps.data(), frac.data(), b.data(), n, bpp);
+      CHECK_MSG(same(a, b), "remap_row n %d bpp %d", n, bpp);
+    }
+  }
+}
+
+void test_integral_and_box(const Kernels& s, const Kernels& k, Rng& rng) {
+  for (int n : kWidths) {
+    for (int bpp : {1, 3, 4}) {
+      const int len = n * bpp;
+      std::vector<uint8_t> src = rng.bytes(len);
+      std::vector<uint32_t> above(len);
+      for (uint32_t& v : above)
+        v = static_cast<uint32_t>(rng.range(0, 0x7fffffff)) * 2u;
+      std::vector<uint32_t> a(len), b(len);
+      s.integral_row(src.data(), above.data(), a.data(), len, bpp);
+      k.integral_row(src.data(), above.data(), b.data(), len, bpp);
+      CHECK_MSG(same(a, b), "integral_row n %d bpp %d", n, bpp);
+    }
+
+    // Rows whose difference is a running sum, so every box sum is a
+    // plausible non-negative count.
+    for (int width : {1, 4, 9}) {
+      std::vector<uint32_t> top(n + width), bottom(n + width);
+      uint32_t run = 0;
+      for (int i = 0; i < n + width; i++) {
+        top[i] = static_cast<uint32_t>(rng.range(0, 1 << 30));
+        run += static_cast<uint32_t>(rng.range(0, 255 * 16));
+        bottom[i] = top[i] + run;
+      }
+      const float scale = 1.0f / static_cast<float>(width * 16);
+      std::vector<uint8_t> a(n), b(n);
+      s.box_mean_row(top.data(), bottom.data(), width, a.data(), n, scale);
+      k.box_mean_row(top.data(), bottom.data(), width, b.data(), n, scale);
+      CHECK_MSG(same(a, b), "box_mean_row n %d width %d", n, width);
+    }
+  }
+}
+
+void test_mixture(const Kernels& s, const Kernels& k, Rng& rng) {
+  simd::MixtureParams params;
+  params.alpha = 0.02f;
+  params.threshold = 6.25f;
+  params.init_var = 400.0f;
+  params.min_var = 16.0f;
+  params.max_var = 1600.0f;
+  params.background_weight = 0.6f;
+
+  for (int n : kWidths) {
+    const size_t plane = n + 5;
+    std::vector<int16_t> a(3 * simd::kMixtureComponents * plane);
+    for (int c = 0; c < simd::kMixtureComponents; c++) {
+      for (int i = 0; i < n; i++) {
+        a[(3 * c) * plane + i] = static_cast<int16_t>(rng.range(0, 255 * 128));
+        a[(3 * c + 1) * plane + i] = static_cast<int16_t>(rng.range(16 * 16, 1600 * 16));
+        a[(3 * c + 2) * plane + i] = static_cast<int16_t>(rng.range(0, 32767 / 3));
+      }
+    }
+    std::vector<int16_t> b = a;
+    std::vector<uint8_t> background = rng.bytes(n);
+    bool equal = true;
+    for (int frame = 0; frame < 30 && equal; frame++) {
+      std::vector<uint8_t> src(n);
+      for (int i = 0; i < n; i++)
+        src[i] = frame % 7 == 3 ? rng.byte()
+                                : static_cast<uint8_t>(std::min(
+                                      255, std::max(0, background[i] + rng.range(-6, 6))));
+      std::vector<uint8_t> fa(n), fb(n);
+      s.mixture_update(src.data(), a.data(), plane, fa.data(), n, params);
+      k.mixture_update(src.data(), b.data(), plane, fb.data(), n, params);
+      equal = same(a, b) && same(fa, fb);
+    }
+    CHECK_MSG(equal, "mixture_update n %d", n);
+  }
+}
+
+void test_dot_rows(const Kernels& s, const Kernels& k, Rng& rng) {
+  for (int n : kWidths) {
+    for (int count : {1, 3, 16}) {
+      const size_t stride = n + 1;
+      std::vector<float> query = rng.floats(n, -1.0f, 1.0f);
+      std::vector<float> rows = rng.floats(stride * count, -1.0f, 1.0f);
+      std::vector<float> a(count), b(count);
+      s.dot_rows_f32(query.data(), rows.data(), stride, count, n, a.data());
+      k.dot_rows_f32(query.data(), rows.data(), stride, count, n, b.data());
+      bool close = true;
+      for (int r = 0; r < count; r++) {
+        float magnitude = 0.0f;
+        for (int i = 0; i < n; i++)
+          magnitude += std::fabs(query[i] * rows[r * stride + i]);
+        close = close && std::fabs(a[r] - b[r]) <= 1e-5f * magnitude + 1e-6f;
+      }
+      CHECK_MSG(close, "dot_rows_f32 n %d count %d", n, count);
+
+      std::vector<int8_t> q8(n), rows8(stride * count);
+      for (int8_t& v : q8)
+        v = static_cast<int8_t>(rng.range(-127, 127));
+      for (int8_t& v : rows8)
+        v = static_cast<int8_t>(rng.range(-127, 127));
+      std::vector<int32_t> ia(count), ib(count);
+      s.dot_rows_s8(q8.data(), rows8.data(), stride, count, n, ia.data());
+      k.dot_rows_s8(q8.data(), rows8.data(), stride, count, n, ib.data());
+      CHECK_MSG(same(ia, ib), "dot_rows_s8 n %d count %d", n, count);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace nvgst
+
+int main() {
+  using nvgst::SimdLevel;
+
+  const nvgst::simd::Kernels& scalar = nvgst::simd::kernels(SimdLevel::kScalar);
+  for (SimdLevel level : {SimdLevel::kSse41, SimdLevel::kAvx2}) {
+    if (nvgst::clamp_simd_level(level) != level) {
+      std::printf("%s: not available, skipped\n", nvgst::simd_level_name(level));
+      continue;
+    }
+    const nvgst::simd::Kernels& k = nvgst::simd::kernels(level);
+    nvgst::Rng rng;
+    nvgst::test_yuv_to_rgb(scalar, k, rng);
+    nvgst::test_rgb_to_yuv(scalar, k, rng);
+    nvgst::test_uv_and_swizzle(scalar, k, rng);
+    nvgst::test_lerp(scalar, k, rng);
+    nvgst::test_blend(scalar, k, rng);
+    nvgst::test_spans(scalar, k, rng);
+    nvgst::test_iou(scalar, k, rng);
+    nvgst::test_kalman(scalar, k, rng);
+    nvgst::test_planar(scalar, k, rng);
+    nvgst::test_argmax_and_select(scalar, k, rng);
+    nvgst::test_accumulate_and_sad(scalar, k, rng);
+    nvgst::test_lerp_pixels(scalar, k, rng);
+    nvgst::test_remap(scalar, k, rng);
+    nvgst::test_integral_and_box(scalar, k, rng);
+    nvgst::test_mixture(scalar, k, rng);
+    nvgst::test_dot_rows(scalar, k, rng);
+    std::printf("%s: compared against scalar\n", nvgst::simd_level_name(level));
+  }
+  return nvgst::test::check_result("kernels_test");
+}
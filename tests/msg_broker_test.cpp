@@ -0,0 +1,260 @@
+// MessageBatch serialization and MessageSender batching. JSON frames are
+// built from the widest values each field can print and checked against
+// the bounds a frame reserves up front; binary batches are decoded again
+// and compared with the objects they were built from, skipping those of
+// other frames in the batch. The sender must send batches when they fill
+// up, when they are old enough with no further frames arriving, and at
+// stop().
+#include <unistd.h>
+
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/msg_broker.h"
+#include "tests/check.h"
+
+namespace nvgst {
+namespace {
+
+// A float whose shortest round-trip form is as long as any float's.
+constexpr float kWidestFloat = -1.00058055e-36f;
+
+DetectedObject widest_object(int attributes) {
+  DetectedObject object = {};
+  object.class_id = std::numeric_limits<int32_t>::min();
+  object.confidence = kWidestFloat;
+  object.x = kWidestFloat;
+  object.y = kWidestFloat;
+  object.width = kWidestFloat;
+  object.height = kWidestFloat;
+  object.track_id = std::numeric_limits<uint64_t>::max();
+  for (int i = 0; i < attributes; i++)
+    object.attributes[i] = {std::numeric_limits<int32_t>::min(),
+                            std::numeric_limits<int32_t>::min(), kWidestFloat, false};
+  return object;
+}
+
+// Bytes of one JSON frame holding objects.
+size_t json_size(const std::vector<DetectedObject>& objects) {
+  MessageBatch batch;
+  batch.reset(MessageFormat::kJson, 0);
+  batch.append({std::numeric_limits<uint32_t>::max(), std::numeric_limits<uint64_t>::max(),
+                std::numeric_limits<int64_t>::max(), 0, objects.data(), objects.size()});
+  const std::string text(reinterpret_cast<const char*>(batch.data()), batch.size());
+  CHECK(text.size() >= 3 && text.compare(text.size() - 3, 3, "]}\n") == 0);
+  return batch.size();
+}
+
+void test_json_bounds() {
+  char widest[64];
+  const std::to_chars_result r = std::to_chars(widest, widest + sizeof(widest), kWidestFloat);
+  CHECK(r.ptr - widest == 15);
+
+  const size_t frame = json_size({});
+  CHECK_MSG(frame <= kJsonFrameBound, "frame header %zu bytes", frame);
+
+  // The first object has no separator, so objects are measured as the
+  // second of two.
+  size_t previous = 0;
+  for (int attributes = 0; attributes <= kMaxAttributes; attributes++) {
+    const DetectedObject object = widest_object(attributes);
+    const size_t one = json_size({object});
+    const size_t two = json_size({object, object});
+    const size_t size = two - one;
+    CHECK_MSG(size <= kJsonObjectBound, "object with %d attributes: %zu bytes", attributes, size);
+    if (attributes == 0) {
+      // Closing an attribute list costs one more byte.
+      CHECK_MSG(size + 1 <= kJsonObjectBaseBound, "object without attributes: %zu bytes", size);
+    } else {
+      CHECK_MSG(size - previous <= kJsonAttributeBound, "attribute %d: %zu bytes", attributes,
+                size - previous);
+    }
+    previous = size;
+  }
+
+  const std::vector<DetectedObject> crowd(50, widest_object(kMaxAttributes));
+  CHECK(json_size(crowd) <= kJsonFrameBound + crowd.size() * kJsonObjectBound);
+}
+
+template <typename T>
+T load(const uint8_t* p) {
+  T value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+void test_binary_round_trip() {
+  // Objects of three frames, interleaved, with some attribute slots set.
+  std::vector<DetectedObject> objects(12);
+  for (size_t i = 0; i < objects.size(); i++) {
+    DetectedObject& object = objects[i];
+    object = {};
+    object.frame = static_cast<uint32_t>(i % 3);
+    object.class_id = static_cast<int32_t>(i) - 4;
+    object.confidence = 0.5f + static_cast<float>(i) * 0.01f;
+    object.x = static_cast<float>(i) * 10.5f;
+    object.y = static_cast<float>(i) * -3.25f;
+    object.width = 64.0f + static_cast<float>(i);
+    object.height = 48.0f;
+    object.track_id = i % 4 == 0 ? kNoTrack : (uint64_t{7} << 32) + i;
+    for (int a = 0; a < static_cast<int>(i % 5); a++) {
+      // Leaves a hole in the middle slot of full lists.
+      if (a == 2 && i % 5 == 4)
+        continue;
+      object.attributes[a] = {static_cast<int32_t>(a), static_cast<int32_t>(i * 10 + a),
+                              0.25f * static_cast<float>(a), a % 2 == 1};
+    }
+  }
+  const int64_t pts[3] = {0, -1, 1000000000000};
+
+  MessageBatch batch;
+  batch.reset(MessageFormat::kBinary, 0);
+  for (uint32_t f = 0; f < 3; f++)
+    batch.append({f + 2, 100 + f, pts[f], f, objects.data(), objects.size()});
+  batch.finish();
+  CHECK(batch.frames() == 3);
+
+  const uint8_t* p = batch.data();
+  const uint8_t* const end = p + batch.size();
+  CHECK(batch.size() >= sizeof(WireBatchHeader));
+  if (batch.size() < sizeof(WireBatchHeader))
+    return;
+  const WireBatchHeader header = load<WireBatchHeader>(p);
+  CHECK(std::memcmp(header.magic, kWireMagic, sizeof(kWireMagic)) == 0);
+  CHECK(header.version == kWireVersion);
+  CHECK(header.frames == 3);
+  CHECK(header.size == batch.size() - sizeof(WireBatchHeader));
+  p += sizeof(WireBatchHeader);
+
+  for (uint32_t f = 0; f < 3; f++) {
+    CHECK_MSG(end - p >= static_cast<ptrdiff_t>(sizeof(WireFrame)), "frame %u", f);
+    if (end - p < static_cast<ptrdiff_t>(sizeof(WireFrame)))
+      return;
+    const uint8_t* const frame_begin = p;
+    const WireFrame frame = load<WireFrame>(p);
+    p += sizeof(WireFrame);
+    CHECK(frame.source == f + 2);
+    CHECK(frame.frame == 100 + f);
+    CHECK(frame.pts == pts[f]);
+    CHECK(frame.objects == 4);
+
+    for (size_t i = f; i < objects.size(); i += 3) {
+      const DetectedObject& object = objects[i];
+      const WireObject wire = load<WireObject>(p);
+      p += sizeof(WireObject);
+      CHECK_MSG(wire.track_id == object.track_id && wire.class_id == object.class_id &&
+                    wire.confidence == object.confidence && wire.x == object.x &&
+                    wire.y == object.y && wire.width == object.width &&
+                    wire.height == object.height,
+                "object %zu", i);
+
+      uint32_t set = 0;
+      for (const ObjectAttribute& attribute : object.attributes) {
+        if (attribute.classifier == kNoClassifier)
+          continue;
+        const WireAttribute out = load<WireAttribute>(p + set * sizeof(WireAttribute));
+        CHECK_MSG(out.classifier == attribute.classifier && out.label == attribute.label &&
+                      out.confidence == attribute.confidence &&
+                      out.cached == (attribute.cached ? 1u : 0u),
+                  "object %zu attribute %u", i, set);
+        set++;
+      }
+      CHECK_MSG(wire.attributes == set, "object %zu: %u attributes, expected %u", i,
+                wire.attributes, set);
+      p += wire.attributes * sizeof(WireAttribute);
+    }
+    CHECK_MSG(frame.size == static_cast<uint32_t>(p - frame_begin), "frame %u size", f);
+  }
+  CHECK(p == end);
+
+  // A reset batch reuses its memory and starts a new header.
+  batch.reset(MessageFormat::kBinary, 5);
+  batch.finish();
+  CHECK(batch.size() == sizeof(WireBatchHeader));
+  CHECK(batch.frames() == 0);
+  CHECK(batch.opened() == 5);
+}
+
+// Waits up to a second for the sender to have sent frames frames.
+bool wait_for_sent(const MessageSender& sender, uint64_t frames) {
+  for (int i = 0; i < 1000 && sender.sent() < frames; i++)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  return sender.sent() == frames;
+}
+
+void test_sender_batching(const std::string& path) {
+  const DetectedObject object = widest_object(1);
+  const FrameMessage message = {0, 0, 0, 0, &object, 1};
+  MessageSender sender;
+  sender.start(create_message_transport("file://" + path), 4, SendBackpressure::kBlock);
+
+  sender.set_batching(MessageFormat::kJson, 2, 0);
+  for (int i = 0; i < 4; i++)
+    CHECK(sender.append(message));
+  CHECK(wait_for_sent(sender, 4));
+
+  // A batch that never fills goes out by age alone.
+  const int64_t max_age = 20000000;
+  sender.set_batching(MessageFormat::kJson, 100, max_age);
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 3; i++)
+    CHECK(sender.append(message));
+  CHECK(wait_for_sent(sender, 7));
+  CHECK(std::chrono::steady_clock::now() - start >= std::chrono::nanoseconds(max_age));
+
+  // Without an age limit the open batch waits for flush() or stop().
+  sender.set_batching(MessageFormat::kJson, 100, 0);
+  CHECK(sender.append(message));
+  CHECK(sender.flush());
+  CHECK(wait_for_sent(sender, 8));
+  CHECK(sender.append(message));
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  CHECK(sender.sent() == 8);
+  sender.stop();
+  CHECK(sender.sent() == 9);
+  CHECK(sender.dropped() == 0);
+
+  int lines = 0;
+  FILE* f = std::fopen(path.c_str(), "r");
+  CHECK(f != nullptr);
+  if (f != nullptr) {
+    for (int c; (c = std::fgetc(f)) != EOF;)
+      lines += c == '\n';
+    std::fclose(f);
+  }
+  CHECK(lines == 9);
+}
+
+std::string temp_path(const char* name) {
+  const char* dir = std::getenv("TMPDIR");
+  std::string path = std::string(dir && *dir ? dir : "/tmp") + "/" + name + "-XXXXXX";
+  std::vector<char> buffer(path.begin(), path.end());
+  buffer.push_back('\0');
+  const int fd = mkstemp(buffer.data());
+  if (fd >= 0)
+    ::close(fd);
+  return buffer.data();
+}
+
+}  // namespace
+}  // namespace nvgst
+
+int main() {
+  const std::string path = nvgst::temp_path("nvgst-messages");
+
+  nvgst::test_json_bounds();
+  nvgst::test_binary_round_trip();
+  nvgst::test_sender_batching(path);
+
+  unlink(path.c_str());
+  return nvgst::test::check_result("msg_broker_test");
+}
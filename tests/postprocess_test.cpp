@@ -0,0 +1,375 @@
+// DetectionPostprocessor against a straightforward reference: decode every
+// candidate, keep each frame's top k, then per frame and class sort by
+// score and suppress greedily, one IoU at a time. Boxes are clustered so
+// NMS has work to do, batches have several frames and enough classes to
+// fill the sort key's class bits, and both layouts are decoded at every
+// SIMD level; the objects must come out the same and in the same order.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "core/postprocess.h"
+#include "tests/check.h"
+
+namespace nvgst {
+namespace {
+
+struct Candidate {
+  uint32_t frame;
+  int32_t class_id;
+  float score;
+  float x0, y0, x1, y1;
+  // Decode order in the batch, the tie-break after score.
+  int order;
+};
+
+float sigmoid(float x) { return 1.0f / (1.0f + std::exp(-x)); }
+
+// The same arithmetic as Kernels::iou_row, so both sides agree at the
+// threshold.
+float iou(const Candidate& a, const Candidate& b) {
+  const float box_area = (b.x1 - b.x0) * (b.y1 - b.y0);
+  const float iw = std::max(0.0f, std::min(a.x1, b.x1) - std::max(a.x0, b.x0));
+  const float ih = std::max(0.0f, std::min(a.y1, b.y1) - std::max(a.y0, b.y0));
+  const float inter = iw * ih;
+  const float area = (a.x1 - a.x0) * (a.y1 - a.y0);
+  const float uni = area + box_area - inter;
+  return uni > 0.0f ? inter / uni : 0.0f;
+}
+
+// A decoded box before top-k and clipping.
+struct Raw {
+  int index;
+  int32_t class_id;
+  float score;
+  float cx, cy, w, h;
+};
+
+class Reference {
+ public:
+  explicit Reference(const DetectionConfig& config) : config_(config) {}
+
+  // Adds one frame's decoded boxes, in candidate order.
+  void add_frame(uint32_t frame, std::vector<Raw> raw) {
+    if (config_.pre_nms_top_k > 0 && raw.size() > static_cast<size_t>(config_.pre_nms_top_k)) {
+      std::vector<Raw> best = raw;
+      std::sort(best.begin(), best.end(), [](const Raw& a, const Raw& b) {
+        return a.score > b.score || (a.score == b.score && a.index < b.index);
+      });
+      best.resize(config_.pre_nms_top_k);
+      std::sort(best.begin(), best.end(),
+                [](const Raw& a, const Raw& b) { return a.index < b.index; });
+      raw = best;
+    }
+    const float sx = static_cast<float>(config_.frame_width) / config_.input_width;
+    const float sy = static_cast<float>(config_.frame_height) / config_.input_height;
+    const float fw = static_cast<float>(config_.frame_width);
+    const float fh = static_cast<float>(config_.frame_height);
+    for (const Raw& r : raw) {
+      Candidate c;
+      c.frame = frame;
+      c.class_id = r.class_id;
+      c.score = r.score;
+      c.x0 = std::min(std::max((r.cx - 0.5f * r.w) * sx, 0.0f), fw);
+      c.y0 = std::min(std::max((r.cy - 0.5f * r.h) * sy, 0.0f), fh);
+      c.x1 = std::min(std::max((r.cx + 0.5f * r.w) * sx, 0.0f), fw);
+      c.y1 = std::min(std::max((r.cy + 0.5f * r.h) * sy, 0.0f), fh);
+      c.order = static_cast<int>(candidates_.size());
+      if (c.x1 > c.x0 && c.y1 > c.y0)
+        candidates_.push_back(c);
+    }
+  }
+
+  ObjectList run(int frames) const {
+    ObjectList out;
+    for (int f = 0; f < frames; f++) {
+      std::vector<Candidate> frame;
+      for (const Candidate& c : candidates_) {
+        if (c.frame == static_cast<uint32_t>(f))
+          frame.push_back(c);
+      }
+      // Greedy NMS per class (or over the frame), best first.
+      auto group = [this](const Candidate& c) { return config_.class_agnostic ? 0 : c.class_id; };
+      std::sort(frame.begin(), frame.end(), [&](const Candidate& a, const Candidate& b) {
+        if (group(a) != group(b))
+          return group(a) < group(b);
+        return a.score > b.score || (a.score == b.score && a.order < b.order);
+      });
+      std::vector<Candidate> kept;
+      for (const Candidate& c : frame) {
+        bool suppressed = false;
+        for (const Candidate& k : kept) {
+          if (group(k) == group(c) && iou(c, k) > config_.iou_threshold) {
+            suppressed = true;
+            break;
+          }
+        }
+        if (!suppressed)
+          kept.push_back(c);
+      }
+      // Then the frame's survivors best first; kept is still in sorted
+      // order, which breaks ties.
+      std::stable_sort(kept.begin(), kept.end(),
+                       [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+      if (config_.max_detections > 0 && kept.size() > static_cast<size_t>(config_.max_detections))
+        kept.resize(config_.max_detections);
+      for (const Candidate& c : kept) {
+        DetectedObject object;
+        object.frame = c.frame;
+        object.class_id = c.class_id;
+        object.confidence = c.score;
+        object.x = c.x0;
+        object.y = c.y0;
+        object.width = c.x1 - c.x0;
+        object.height = c.y1 - c.y0;
+        object.track_id = kNoTrack;
+        out.push_back(object);
+      }
+    }
+    return out;
+  }
+
+ private:
+  DetectionConfig config_;
+  std::vector<Candidate> candidates_;
+};
+
+bool same_objects(const ObjectList& a, const ObjectList& b) {
+  if (a.size() != b.size())
+    return false;
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].frame != b[i].frame || a[i].class_id != b[i].class_id ||
+        a[i].confidence != b[i].confidence || a[i].x != b[i].x || a[i].y != b[i].y ||
+        a[i].width != b[i].width || a[i].height != b[i].height || a[i].track_id != b[i].track_id)
+      return false;
+  }
+  return true;
+}
+
+// Box centers near a few cluster points, partly outside the network input
+// so clipping is exercised.
+struct Scene {
+  float cx[4];
+  float cy[4];
+};
+
+Scene make_scene(std::mt19937* rng, const DetectionConfig& config) {
+  std::uniform_real_distribution<float> ux(-4.0f, config.input_width + 4.0f);
+  std::uniform_real_distribution<float> uy(-4.0f, config.input_height + 4.0f);
+  Scene scene;
+  for (int i = 0; i < 4; i++) {
+    scene.cx[i] = ux(*rng);
+    scene.cy[i] = uy(*rng);
+  }
+  return scene;
+}
+
+// {frames, 4 + classes, candidates}. With coarse scores, equal scores are
+// common and the tie-breaks are checked too.
+void test_anchor_free(std::mt19937* rng, const DetectionConfig& config, int frames, int classes,
+                      int candidates, bool coarse, const char* what) {
+  const int rows = 4 + classes;
+  Tensor tensor;
+  tensor.info = {"output", {frames, rows, candidates}};
+  const size_t per_frame = static_cast<size_t>(rows) * candidates;
+  tensor.data.reset(new float[per_frame * frames], std::default_delete<float[]>());
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  std::uniform_real_distribution<float> jitter(-6.0f, 6.0f);
+  std::uniform_real_distribution<float> side(4.0f, 24.0f);
+
+  Reference reference(config);
+  for (int f = 0; f < frames; f++) {
+    float* data = tensor.data.get() + per_frame * f;
+    const Scene scene = make_scene(rng, config);
+    std::vector<Raw> raw;
+    for (int i = 0; i < candidates; i++) {
+      const int cluster = i % 4;
+      const float cx = scene.cx[cluster] + jitter(*rng);
+      const float cy = scene.cy[cluster] + jitter(*rng);
+      // Some boxes are degenerate and must be dropped.
+      const float w = i % 37 == 0 ? 0.0f : side(*rng);
+      const float h = side(*rng);
+      data[i] = cx;
+      data[candidates + i] = cy;
+      data[2 * candidates + i] = w;
+      data[3 * candidates + i] = h;
+      int32_t best_class = 0;
+      float best = -1.0f;
+      for (int c = 0; c < classes; c++) {
+        // Most candidates fall into a few classes, so they meet in NMS.
+        float v = unit(*rng) * (c % 50 == i % 3 ? 1.0f : 0.3f);
+        if (coarse)
+          v = std::floor(v * 16.0f) / 16.0f;
+        data[(4 + c) * candidates + i] = v;
+        if (v > best) {
+          best = v;
+          best_class = c;
+        }
+      }
+      if (best >= config.confidence_threshold)
+        raw.push_back({i, best_class, best, cx, cy, w, h});
+    }
+    reference.add_frame(static_cast<uint32_t>(f), raw);
+  }
+
+  DetectionPostprocessor post;
+  CHECK(post.configure(config));
+  ObjectList got;
+  CHECK_MSG(post.run(tensor, frames, &got), "%s: run failed", what);
+  const ObjectList want = reference.run(frames);
+  CHECK_MSG(same_objects(got, want), "%s: %zu objects, reference %zu", what, got.size(),
+            want.size());
+  CHECK_MSG(want.size() > static_cast<size_t>(frames), "%s: too few objects to compare", what);
+}
+
+// {frames, candidates, 5 + classes} against the config's anchor grid.
+void test_anchor_based(std::mt19937* rng, const DetectionConfig& config, int frames, int classes,
+                       const char* what) {
+  DetectionPostprocessor post;
+  CHECK(post.configure(config));
+
+  // The grid in the documented order: stride, row, column, anchor.
+  struct Cell {
+    float x, y, stride, aw, ah;
+  };
+  std::vector<Cell> grid;
+  const size_t per_level = config.anchors.size() / (2 * config.strides.size());
+  for (size_t l = 0; l < config.strides.size(); l++) {
+    const int stride = config.strides[l];
+    for (int y = 0; y < config.input_height / stride; y++) {
+      for (int x = 0; x < config.input_width / stride; x++) {
+        for (size_t a = 0; a < per_level; a++) {
+          grid.push_back({static_cast<float>(x), static_cast<float>(y),
+                          static_cast<float>(stride), config.anchors[2 * (l * per_level + a)],
+                          config.anchors[2 * (l * per_level + a) + 1]});
+        }
+      }
+    }
+  }
+  const int candidates = static_cast<int>(grid.size());
+  CHECK_MSG(post.anchor_candidates() == candidates, "%s: %d anchor candidates, expected %d", what,
+            post.anchor_candidates(), candidates);
+
+  const int row = 5 + classes;
+  Tensor tensor;
+  tensor.info = {"output", {frames, candidates, row}};
+  const size_t per_frame = static_cast<size_t>(row) * candidates;
+  tensor.data.reset(new float[per_frame * frames], std::default_delete<float[]>());
+  std::normal_distribution<float> logit(-1.0f, 2.0f);
+
+  Reference reference(config);
+  for (int f = 0; f < frames; f++) {
+    float* data = tensor.data.get() + per_frame * f;
+    std::vector<Raw> raw;
+    for (int i = 0; i < candidates; i++) {
+      float* r = data + static_cast<size_t>(row) * i;
+      for (int k = 0; k < row; k++)
+        r[k] = logit(*rng);
+      int32_t k = 0;
+      for (int c = 1; c < classes; c++) {
+        if (r[5 + c] > r[5 + k])
+          k = c;
+      }
+      const float score = sigmoid(r[4]) * sigmoid(r[5 + k]);
+      if (score < config.confidence_threshold)
+        continue;
+      const Cell& cell = grid[i];
+      const float tw = sigmoid(r[2]) * 2.0f;
+      const float th = sigmoid(r[3]) * 2.0f;
+      raw.push_back({i, k, score, (sigmoid(r[0]) * 2.0f - 0.5f + cell.x) * cell.stride,
+                     (sigmoid(r[1]) * 2.0f - 0.5f + cell.y) * cell.stride, tw * tw * cell.aw,
+                     th * th * cell.ah});
+    }
+    reference.add_frame(static_cast<uint32_t>(f), raw);
+  }
+
+  ObjectList got;
+  CHECK_MSG(post.run(tensor, frames, &got), "%s: run failed", what);
+  const ObjectList want = reference.run(frames);
+  CHECK_MSG(same_objects(got, want), "%s: %zu objects, reference %zu", what, got.size(),
+            want.size());
+  CHECK_MSG(want.size() > static_cast<size_t>(frames), "%s: too few objects to compare", what);
+
+  // A tensor that does not match the grid is refused.
+  Tensor wrong = tensor;
+  wrong.info.shape = {frames, candidates - 1, row};
+  CHECK(!post.run(wrong, frames, &got));
+}
+
+DetectionConfig base_config(SimdLevel simd) {
+  DetectionConfig config;
+  config.input_width = 96;
+  config.input_height = 64;
+  config.frame_width = 192;
+  config.frame_height = 96;
+  config.confidence_threshold = 0.3f;
+  config.iou_threshold = 0.4f;
+  config.simd = simd;
+  return config;
+}
+
+void test_level(std::mt19937* rng, SimdLevel simd) {
+  DetectionConfig config = base_config(simd);
+
+  config.pre_nms_top_k = 0;
+  config.max_detections = 0;
+  test_anchor_free(rng, config, 5, 6, 400, false, "anchor-free");
+  test_anchor_free(rng, config, 3, 6, 400, true, "anchor-free ties");
+  // Class ids past 255 and frames past 1 in the sort key.
+  test_anchor_free(rng, config, 4, 300, 200, false, "anchor-free many classes");
+
+  config.pre_nms_top_k = 40;
+  config.max_detections = 12;
+  test_anchor_free(rng, config, 5, 6, 400, false, "anchor-free top-k");
+
+  config.class_agnostic = true;
+  test_anchor_free(rng, config, 5, 6, 400, false, "anchor-free class-agnostic");
+  // Top-k leaves the survivors in no particular order, so equal scores
+  // are only compared without it.
+  config.pre_nms_top_k = 0;
+  test_anchor_free(rng, config, 3, 6, 400, true, "anchor-free class-agnostic ties");
+
+  config = base_config(simd);
+  config.layout = DetectionLayout::kAnchorBased;
+  config.pre_nms_top_k = 0;
+  config.max_detections = 0;
+  test_anchor_based(rng, config, 3, 5, "anchor-based");
+  config.pre_nms_top_k = 30;
+  config.max_detections = 10;
+  test_anchor_based(rng, config, 4, 5, "anchor-based top-k");
+  // Two levels of three anchors each, not the default grid.
+  config.strides = {16, 32};
+  config.anchors = {8, 8, 16, 12, 12, 24, 40, 30, 30, 60, 80, 64};
+  test_anchor_based(rng, config, 2, 3, "anchor-based custom grid");
+}
+
+void test_configure() {
+  DetectionPostprocessor post;
+  DetectionConfig config = base_config(SimdLevel::kScalar);
+  CHECK(post.configure(config));
+  config.frame_width = 0;
+  CHECK(!post.configure(config));
+  config = base_config(SimdLevel::kScalar);
+  config.iou_threshold = 0.0f;
+  CHECK(!post.configure(config));
+  config = base_config(SimdLevel::kScalar);
+  config.layout = DetectionLayout::kAnchorBased;
+  config.anchors.pop_back();
+  CHECK(!post.configure(config));
+}
+
+}  // namespace
+}  // namespace nvgst
+
+int main() {
+  std::mt19937 rng(5);
+  for (nvgst::SimdLevel level :
+       {nvgst::SimdLevel::kScalar, nvgst::SimdLevel::kSse41, nvgst::SimdLevel::kAvx2}) {
+    if (nvgst::clamp_simd_level(level) == level)
+      nvgst::test_level(&rng, level);
+  }
+  nvgst::test_configure();
+  return nvgst::test::check_result("postprocess_test");
+}
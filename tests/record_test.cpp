@@ -0,0 +1,340 @@
+// PreEventRing and RecordWriter. The ring is fed GOPs and checked after
+// every push against what its limits promise: it starts on a keyframe,
+// reaches back to the duration, holds no more than the byte limit allows
+// and releases every token it drops. find_keyframe() is compared with a
+// linear search. The writer writes files through both backends, and a file
+// size limit makes the kernel cut a write short, so the rest goes out as a
+// continuation and fails the way a full disk would.
+#include <signal.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "core/record.h"
+#include "tests/check.h"
+
+namespace nvgst {
+namespace {
+
+int g_released = 0;
+
+void release(void* token) {
+  g_released++;
+  delete[] static_cast<uint8_t*>(token);
+}
+
+PreEventRing::Entry make_entry(int64_t time, uint64_t bytes, bool keyframe) {
+  return {new uint8_t[1], time, bytes, keyframe};
+}
+
+void check_ring(const PreEventRing& ring, int64_t duration, uint64_t max_bytes, int pushed,
+                const char* what) {
+  CHECK_MSG(g_released + static_cast<int>(ring.size()) == pushed,
+            "%s: %d pushed, %d released, %zu held", what, pushed, g_released, ring.size());
+  if (ring.size() == 0)
+    return;
+  CHECK_MSG(ring[0].keyframe, "%s: starts on a delta frame", what);
+
+  uint64_t bytes = 0;
+  std::vector<size_t> keyframes;
+  for (size_t i = 0; i < ring.size(); i++) {
+    bytes += ring[i].bytes;
+    if (ring[i].keyframe)
+      keyframes.push_back(i);
+  }
+  CHECK_MSG(bytes == ring.bytes(), "%s: %llu bytes held, ring says %llu", what,
+            static_cast<unsigned long long>(bytes), static_cast<unsigned long long>(ring.bytes()));
+
+  const int64_t newest = ring[ring.size() - 1].time;
+  if (duration > 0 && newest >= 0 && (max_bytes == 0 || bytes <= max_bytes)) {
+    // The oldest GOP starts at or before the cutoff, unless bytes cut it,
+    // and the next one after it, or it would have been dropped.
+    const int64_t cutoff = newest - duration;
+    if (keyframes.size() >= 2)
+      CHECK_MSG(ring[keyframes[1]].time > cutoff, "%s: holds a GOP past the duration", what);
+  }
+  if (max_bytes != 0 && keyframes.size() >= 2)
+    CHECK_MSG(bytes <= max_bytes, "%s: %llu bytes held over the limit", what,
+              static_cast<unsigned long long>(bytes));
+}
+
+// find_keyframe() against a linear search over the held entries.
+void check_find(const PreEventRing& ring, int64_t time, const char* what) {
+  long want = -1;
+  for (size_t i = 0; i < ring.size(); i++) {
+    if (!ring[i].keyframe)
+      continue;
+    if (want < 0 || ring[i].time <= time)
+      want = static_cast<long>(i);
+    if (ring[i].time > time)
+      break;
+  }
+  CHECK_MSG(ring.find_keyframe(time) == want, "%s: find_keyframe(%lld) = %ld, expected %ld", what,
+            static_cast<long long>(time), ring.find_keyframe(time), want);
+}
+
+void test_ring_by_time() {
+  g_released = 0;
+  PreEventRing ring(release);
+  const int64_t frame = 33;
+  ring.set_limits(100 * frame, 0);
+
+  int pushed = 0;
+  // Delta frames before the first keyframe cannot start a recording.
+  for (int i = 0; i < 3; i++) {
+    ring.push(make_entry(i * frame, 100, false));
+    pushed++;
+  }
+  CHECK(ring.size() == 0 && g_released == 3);
+
+  // GOPs of varying length.
+  int64_t t = 3 * frame;
+  for (int gop = 0; gop < 40; gop++) {
+    const int length = 5 + (gop * 7) % 30;
+    for (int i = 0; i < length; i++) {
+      ring.push(make_entry(t, 100 + i, i == 0));
+      pushed++;
+      t += frame;
+      check_ring(ring, 100 * frame, 0, pushed, "by time");
+    }
+    const int64_t newest = t - frame;
+    CHECK_MSG(ring[0].time <= newest - 100 * frame || ring[0].time == 3 * frame,
+              "by time: oldest keyframe %lld is after the cutoff %lld",
+              static_cast<long long>(ring[0].time), static_cast<long long>(newest - 100 * frame));
+    for (int64_t q = ring[0].time - 2 * frame; q <= newest + frame; q += frame / 2)
+      check_find(ring, q, "by time");
+  }
+
+  // Unknown times never trim.
+  const size_t held = ring.size();
+  for (int i = 0; i < 20; i++) {
+    ring.push(make_entry(-1, 10, i % 5 == 0));
+    pushed++;
+  }
+  CHECK(ring.size() == held + 20);
+
+  ring.clear();
+  CHECK(ring.size() == 0 && ring.bytes() == 0);
+  CHECK(g_released == pushed);
+  CHECK(ring.find_keyframe(0) == -1);
+}
+
+void test_ring_by_bytes() {
+  g_released = 0;
+  PreEventRing ring(release);
+  // A long duration, so only bytes trim.
+  ring.set_limits(1000000000, 5000);
+
+  int pushed = 0;
+  int64_t t = 0;
+  for (int gop = 0; gop < 30; gop++) {
+    const int length = 3 + gop % 9;
+    for (int i = 0; i < length; i++) {
+      // Keyframes are large, as they are in real streams.
+      ring.push(make_entry(t, i == 0 ? 900 : 120, i == 0));
+      pushed++;
+      t += 40;
+      check_ring(ring, 0, 5000, pushed, "by bytes");
+    }
+  }
+
+  // One GOP larger than the limit is kept whole: it is being received.
+  ring.push(make_entry(t, 900, true));
+  pushed++;
+  for (int i = 0; i < 60; i++) {
+    t += 40;
+    ring.push(make_entry(t, 120, false));
+    pushed++;
+  }
+  CHECK(ring.size() == 61 && ring[0].keyframe && ring.bytes() > 5000);
+  check_ring(ring, 0, 5000, pushed, "one large GOP");
+  ring.clear();
+  CHECK(g_released == pushed);
+}
+
+std::string temp_path(const char* name) {
+  const char* dir = std::getenv("TMPDIR");
+  std::string path = std::string(dir && *dir ? dir : "/tmp") + "/" + name + "-XXXXXX";
+  std::vector<char> buffer(path.begin(), path.end());
+  buffer.push_back('\0');
+  const int fd = mkstemp(buffer.data());
+  if (fd >= 0)
+    ::close(fd);
+  return buffer.data();
+}
+
+std::vector<uint8_t> read_file(const std::string& path) {
+  std::vector<uint8_t> bytes;
+  FILE* f = fopen(path.c_str(), "rb");
+  if (f == nullptr)
+    return bytes;
+  uint8_t chunk[65536];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+    bytes.insert(bytes.end(), chunk, chunk + n);
+  fclose(f);
+  return bytes;
+}
+
+struct Results {
+  std::mutex lock;
+  std::vector<RecordWriter::FileResult> files;
+};
+
+RecordWriter::FileDone collect(Results* results) {
+  return [results](const RecordWriter::FileResult& result) {
+    std::lock_guard<std::mutex> guard(results->lock);
+    results->files.push_back(result);
+  };
+}
+
+// A chunk of size bytes numbered by seed, as a token of its own.
+RecordWriter::Chunk make_chunk(size_t size, uint32_t seed, std::vector<uint8_t>* expected) {
+  uint8_t* data = new uint8_t[size + 1];
+  for (size_t i = 0; i < size; i++) {
+    data[i] = static_cast<uint8_t>(seed * 31 + i * 7);
+    expected->push_back(data[i]);
+  }
+  return {data, size, data};
+}
+
+// Three files of many small and some large chunks, some empty, back to
+// back; each must read back whole.
+void test_writer(bool use_uring) {
+  const char* what = use_uring ? "io_uring" : "pwritev";
+  g_released = 0;
+  Results results;
+  RecordWriter writer(release);
+  CHECK(writer.start(collect(&results), use_uring));
+  if (use_uring && !writer.uring())
+    std::printf("record_test: io_uring not available, pwritev used\n");
+
+  std::vector<std::string> paths;
+  std::vector<std::vector<uint8_t>> expected(3);
+  int chunks = 0;
+  for (int f = 0; f < 3; f++) {
+    paths.push_back(temp_path("nvgst-record"));
+    writer.open(static_cast<uint64_t>(f + 1), paths.back());
+    for (int i = 0; i < 300; i++) {
+      const size_t size = i % 50 == 0 ? 200000 : i % 7 == 0 ? 0 : static_cast<size_t>(1 + i * 13);
+      CHECK(writer.write(make_chunk(size, static_cast<uint32_t>(f * 1000 + i), &expected[f])));
+      chunks++;
+    }
+    // The third file is closed by stop().
+    if (f < 2)
+      writer.close();
+  }
+
+  // Over the backlog limit, the chunk stays with the caller.
+  writer.set_max_backlog(1000);
+  std::vector<uint8_t> unused;
+  RecordWriter::Chunk big = make_chunk(2000, 0, &unused);
+  CHECK(!writer.write(big));
+  release(big.token);
+  chunks++;
+  writer.set_max_backlog(0);
+
+  writer.stop();
+  CHECK_MSG(g_released == chunks, "%s: %d of %d tokens released", what, g_released, chunks);
+  CHECK(writer.backlog() == 0);
+  CHECK_MSG(results.files.size() == 3, "%s: %zu files closed", what, results.files.size());
+  for (size_t f = 0; f < results.files.size() && f < 3; f++) {
+    const RecordWriter::FileResult& result = results.files[f];
+    CHECK_MSG(result.id == f + 1 && result.path == paths[f], "%s: file %zu out of order", what, f);
+    CHECK_MSG(result.error == 0 && result.bytes == expected[f].size(),
+              "%s: file %zu wrote %llu of %zu bytes, error %d", what, f,
+              static_cast<unsigned long long>(result.bytes), expected[f].size(), result.error);
+    CHECK_MSG(read_file(paths[f]) == expected[f], "%s: file %zu reads back differently", what, f);
+  }
+  for (const std::string& path : paths)
+    unlink(path.c_str());
+}
+
+// A file that cannot be opened fails with its errno; its chunks are still
+// released.
+void test_open_failure(bool use_uring) {
+  g_released = 0;
+  Results results;
+  RecordWriter writer(release);
+  CHECK(writer.start(collect(&results), use_uring));
+  writer.open(7, "/nonexistent-dir/record.bin");
+  std::vector<uint8_t> unused;
+  for (int i = 0; i < 5; i++)
+    CHECK(writer.write(make_chunk(100, static_cast<uint32_t>(i), &unused)));
+  writer.close();
+  writer.stop();
+  CHECK(g_released == 5);
+  CHECK(results.files.size() == 1 && results.files[0].id == 7 &&
+        results.files[0].error == ENOENT && results.files[0].bytes == 0);
+}
+
+// With a file size limit the write that crosses it comes back short; the
+// rest is resubmitted at the right offset, where the kernel refuses it
+// with EFBIG. Everything up to the limit must be on disk, in order.
+void test_short_write(bool use_uring) {
+  const char* what = use_uring ? "io_uring" : "pwritev";
+  constexpr rlim_t kLimit = 300000;
+  rlimit old_limit;
+  getrlimit(RLIMIT_FSIZE, &old_limit);
+  if (old_limit.rlim_cur != RLIM_INFINITY && old_limit.rlim_cur < kLimit) {
+    std::printf("record_test: file size limit already set, short writes skipped\n");
+    return;
+  }
+  // EFBIG instead of SIGXFSZ.
+  signal(SIGXFSZ, SIG_IGN);
+  rlimit limit = old_limit;
+  limit.rlim_cur = kLimit;
+  CHECK(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+
+  g_released = 0;
+  Results results;
+  RecordWriter writer(release);
+  CHECK(writer.start(collect(&results), use_uring));
+  const std::string path = temp_path("nvgst-record-short");
+  writer.open(1, path);
+  std::vector<uint8_t> expected;
+  int chunks = 0;
+  for (int i = 0; i < 40; i++) {
+    CHECK(writer.write(make_chunk(10007, static_cast<uint32_t>(i), &expected)));
+    chunks++;
+  }
+  writer.close();
+  writer.stop();
+  setrlimit(RLIMIT_FSIZE, &old_limit);
+  signal(SIGXFSZ, SIG_DFL);
+
+  CHECK_MSG(g_released == chunks, "%s: %d of %d tokens released", what, g_released, chunks);
+  CHECK(writer.backlog() == 0);
+  CHECK(results.files.size() == 1);
+  if (results.files.size() == 1) {
+    const RecordWriter::FileResult& result = results.files[0];
+    CHECK_MSG(result.error == EFBIG && result.bytes == kLimit,
+              "%s: wrote %llu bytes, error %d; expected %llu and EFBIG", what,
+              static_cast<unsigned long long>(result.bytes), result.error,
+              static_cast<unsigned long long>(kLimit));
+  }
+  expected.resize(kLimit);
+  CHECK_MSG(read_file(path) == expected, "%s: the bytes up to the limit differ", what);
+  unlink(path.c_str());
+}
+
+}  // namespace
+}  // namespace nvgst
+
+int main() {
+  nvgst::test_ring_by_time();
+  nvgst::test_ring_by_bytes();
+  for (bool use_uring : {false, true}) {
+    nvgst::test_writer(use_uring);
+    nvgst::test_open_failure(use_uring);
+    nvgst::test_short_write(use_uring);
+  }
+  return nvgst::test::check_result("record_test");
+}
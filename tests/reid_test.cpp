@@ -0,0 +1,364 @@
+// EmbeddingIndex against brute force over the same normalized vectors:
+// before training every search must return the true best entries that
+// pass the filter, after training the probed lists must still find nearly
+// all of them, int8 rows must score within a hundredth of float ones, and
+// eviction must keep each list's rows, scales and entries together.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "core/reid.h"
+#include "tests/check.h"
+
+namespace nvgst {
+namespace {
+
+constexpr int kDim = 64;
+
+// Noisy views of a few hundred people, the kind of data the index holds.
+class Views {
+ public:
+  Views(int people, uint32_t seed) : rng_(seed), people_(static_cast<size_t>(people) * kDim) {
+    for (float& v : people_)
+      v = gauss_(rng_);
+  }
+
+  std::vector<float> view(int person, float noise) {
+    std::vector<float> v(kDim);
+    for (int d = 0; d < kDim; d++)
+      v[d] = people_[static_cast<size_t>(person) * kDim + d] + noise * gauss_(rng_);
+    return v;
+  }
+
+ private:
+  std::mt19937 rng_;
+  std::normal_distribution<float> gauss_;
+  std::vector<float> people_;
+};
+
+std::vector<float> normalized(const std::vector<float>& v) {
+  float sum = 0.0f;
+  for (float x : v)
+    sum += x * x;
+  std::vector<float> out(v.size());
+  for (size_t i = 0; i < v.size(); i++)
+    out[i] = v[i] / std::sqrt(sum);
+  return out;
+}
+
+float dot(const std::vector<float>& a, const std::vector<float>& b) {
+  double sum = 0.0;
+  for (size_t i = 0; i < a.size(); i++)
+    sum += static_cast<double>(a[i]) * b[i];
+  return static_cast<float>(sum);
+}
+
+// What went into the index, for brute force.
+struct Stored {
+  ReidEntry entry;
+  std::vector<float> unit;
+};
+
+bool passes(const ReidFilter& filter, const ReidEntry& entry) {
+  return (filter.source < 0 || entry.source == filter.source) &&
+         (filter.exclude_source < 0 || entry.source != filter.exclude_source) &&
+         (filter.class_id < 0 || entry.class_id == filter.class_id) &&
+         !(entry.source == filter.self_source && entry.track_id == filter.self_track);
+}
+
+// Similarities of the entries that pass, best first.
+std::vector<float> brute_force(const std::vector<Stored>& stored, const std::vector<float>& query,
+                               const ReidFilter& filter) {
+  const std::vector<float> unit = normalized(query);
+  std::vector<float> scores;
+  for (const Stored& s : stored) {
+    const float score = dot(unit, s.unit);
+    if (passes(filter, s.entry) && score >= filter.min_similarity)
+      scores.push_back(score);
+  }
+  std::sort(scores.begin(), scores.end(), [](float a, float b) { return a > b; });
+  return scores;
+}
+
+const Stored* lookup(const std::vector<Stored>& stored, const ReidEntry& entry) {
+  for (const Stored& s : stored) {
+    if (s.entry.source == entry.source && s.entry.track_id == entry.track_id)
+      return &s;
+  }
+  return nullptr;
+}
+
+EmbeddingIndexConfig make_config(bool quantize, SimdLevel simd) {
+  EmbeddingIndexConfig config;
+  config.dim = kDim;
+  config.quantize = quantize;
+  config.retention = 0;
+  config.simd = simd;
+  return config;
+}
+
+void fill(EmbeddingIndex* index, Views* views, int people, int per_person,
+          std::vector<Stored>* stored) {
+  for (int i = 0; i < people * per_person; i++) {
+    Stored s;
+    s.entry.source = static_cast<uint32_t>(i % 7);
+    s.entry.track_id = static_cast<uint64_t>(i / 7 + 1);
+    s.entry.class_id = i % 3;
+    s.entry.first_seen = s.entry.last_seen = static_cast<uint64_t>(i);
+    const std::vector<float> v = views->view(i % people, 0.7f);
+    s.unit = normalized(v);
+    CHECK(index->add(s.entry, v.data()));
+    stored->push_back(s);
+  }
+}
+
+// Untrained, a search scans everything, so it must return exactly the
+// best entries the filter lets through. Similarities are compared with a
+// tolerance: SIMD sums in another order, and int8 rows round.
+void test_exact(bool quantize, SimdLevel simd) {
+  const char* what = quantize ? "int8" : "f32";
+  EmbeddingIndexConfig config = make_config(quantize, simd);
+  config.train_size = 100000;
+  EmbeddingIndex index;
+  CHECK(index.configure(config));
+  Views views(150, 3);
+  std::vector<Stored> stored;
+  fill(&index, &views, 150, 4, &stored);
+  CHECK(index.lists() == 1);
+  CHECK(index.size() == stored.size());
+
+  const float tolerance = quantize ? 0.01f : 1e-4f;
+  std::vector<ReidMatch> matches;
+  for (int q = 0; q < 200; q++) {
+    ReidFilter filter;
+    switch (q % 5) {
+      case 1:
+        filter.source = q % 7;
+        break;
+      case 2:
+        filter.exclude_source = q % 7;
+        filter.class_id = q % 3;
+        break;
+      case 3: {
+        // Query with a stored track's own vector: it must not come back.
+        const Stored& self = stored[(q * 13) % stored.size()];
+        filter.self_source = self.entry.source;
+        filter.self_track = self.entry.track_id;
+        break;
+      }
+      case 4:
+        filter.min_similarity = 0.5f;
+        break;
+    }
+    std::vector<float> query = views.view(q % 150, 0.7f);
+    if (q % 5 == 3)
+      query = lookup(stored, {filter.self_source, filter.self_track})->unit;
+    const std::vector<float> want = brute_force(stored, query, filter);
+    const size_t n = index.search(query.data(), filter, 5, &matches);
+    CHECK_MSG(n == std::min<size_t>(5, want.size()), "%s query %d: %zu matches, expected %zu",
+              what, q, n, std::min<size_t>(5, want.size()));
+
+    const std::vector<float> unit = normalized(query);
+    for (size_t i = 0; i < n && i < want.size(); i++) {
+      const ReidEntry& entry = matches[i].entry;
+      const Stored* s = lookup(stored, entry);
+      if (s == nullptr) {
+        CHECK_MSG(false, "%s query %d: match %zu is not stored", what, q, i);
+        continue;
+      }
+      CHECK_MSG(passes(filter, entry), "%s query %d: match %zu fails the filter", what, q, i);
+      const float exact = dot(unit, s->unit);
+      CHECK_MSG(std::fabs(matches[i].similarity - exact) < tolerance,
+                "%s query %d: match %zu scored %f, exactly %f", what, q, i, matches[i].similarity,
+                exact);
+      // The i-th match is as good as the i-th best, up to the tolerance.
+      CHECK_MSG(exact > want[i] - 2 * tolerance, "%s query %d: match %zu is %f, best %f", what, q,
+                i, exact, want[i]);
+      if (i > 0)
+        CHECK(matches[i].similarity <= matches[i - 1].similarity);
+    }
+  }
+}
+
+// After training only probes of the lists are scanned; the best match must
+// still be found for nearly every query.
+void test_trained(bool quantize, SimdLevel simd) {
+  const char* what = quantize ? "int8" : "f32";
+  EmbeddingIndexConfig config = make_config(quantize, simd);
+  config.lists = 32;
+  config.probes = 8;
+  config.train_size = 1024;
+  EmbeddingIndex index;
+  CHECK(index.configure(config));
+  Views views(600, 4);
+  std::vector<Stored> stored;
+  fill(&index, &views, 600, 3, &stored);
+  CHECK_MSG(index.lists() == 32, "%s: %zu lists after training", what, index.lists());
+  CHECK(index.size() == stored.size());
+
+  // Every entry landed in some list and reads back as what was stored.
+  std::vector<float> back(kDim);
+  for (const Stored& s : stored) {
+    if (!index.find(s.entry.source, s.entry.track_id, back.data())) {
+      CHECK_MSG(false, "%s: track %u/%llu lost in training", what, s.entry.source,
+                static_cast<unsigned long long>(s.entry.track_id));
+      continue;
+    }
+    CHECK_MSG(dot(back, s.unit) > 0.99f, "%s: track %u/%llu changed in training", what,
+              s.entry.source, static_cast<unsigned long long>(s.entry.track_id));
+  }
+
+  // int8 rows may swap views of one person that score within rounding.
+  const float tolerance = quantize ? 0.01f : 1e-4f;
+  const int queries = 300;
+  int found = 0;
+  std::vector<ReidMatch> matches;
+  for (int q = 0; q < queries; q++) {
+    const std::vector<float> query = views.view((q * 7) % 600, 0.7f);
+    const std::vector<float> want = brute_force(stored, query, ReidFilter());
+    if (index.search(query.data(), ReidFilter(), 1, &matches) == 1 &&
+        dot(normalized(query), lookup(stored, matches[0].entry)->unit) >= want[0] - tolerance)
+      found++;
+  }
+  CHECK_MSG(found >= queries * 9 / 10, "%s: top-1 recall %d/%d against brute force", what, found,
+            queries);
+}
+
+// The same entries as int8 and float rows score alike.
+void test_quantized_scores(SimdLevel simd) {
+  EmbeddingIndexConfig config = make_config(false, simd);
+  config.train_size = 100000;
+  EmbeddingIndex f32;
+  CHECK(f32.configure(config));
+  config.quantize = true;
+  EmbeddingIndex s8;
+  CHECK(s8.configure(config));
+
+  Views views(100, 5);
+  for (int i = 0; i < 400; i++) {
+    ReidEntry entry;
+    entry.source = 0;
+    entry.track_id = static_cast<uint64_t>(i + 1);
+    const std::vector<float> v = views.view(i % 100, 0.7f);
+    f32.add(entry, v.data());
+    s8.add(entry, v.data());
+  }
+
+  // Every entry, negative similarities too.
+  ReidFilter all;
+  all.min_similarity = -2.0f;
+  std::vector<ReidMatch> a, b;
+  float worst = 0.0f;
+  for (int q = 0; q < 100; q++) {
+    const std::vector<float> query = views.view(q, 0.7f);
+    f32.search(query.data(), all, 400, &a);
+    s8.search(query.data(), all, 400, &b);
+    CHECK(a.size() == 400 && b.size() == 400);
+    std::vector<float> by_track(401, 0.0f);
+    for (const ReidMatch& m : a)
+      by_track[m.entry.track_id] = m.similarity;
+    for (const ReidMatch& m : b)
+      worst = std::max(worst, std::fabs(m.similarity - by_track[m.entry.track_id]));
+  }
+  CHECK_MSG(worst < 0.01f, "int8 similarity off by %f", worst);
+}
+
+// Eviction compacts every list; what is left must still read back and be
+// found as itself, so rows, scales and entries moved together.
+void test_evict(bool quantize, SimdLevel simd) {
+  const char* what = quantize ? "int8" : "f32";
+  EmbeddingIndexConfig config = make_config(quantize, simd);
+  config.lists = 16;
+  config.train_size = 512;
+  config.retention = 1000;
+  EmbeddingIndex index;
+  CHECK(index.configure(config));
+
+  Views views(400, 6);
+  std::mt19937 rng(9);
+  std::vector<Stored> stored;
+  for (int i = 0; i < 1600; i++) {
+    Stored s;
+    s.entry.source = static_cast<uint32_t>(i % 5);
+    s.entry.track_id = static_cast<uint64_t>(i + 1);
+    s.entry.last_seen = std::uniform_int_distribution<uint64_t>(0, 3000)(rng);
+    const std::vector<float> v = views.view(i % 400, 0.7f);
+    s.unit = normalized(v);
+    CHECK(index.add(s.entry, v.data()));
+    stored.push_back(s);
+  }
+  CHECK(index.lists() == 16);
+
+  // Nothing is old enough yet.
+  CHECK(index.evict(1000) == 0);
+  const uint64_t now = 3000;
+  size_t expected = 0;
+  for (const Stored& s : stored)
+    expected += s.entry.last_seen < now - config.retention;
+  CHECK_MSG(index.evict(now) == expected, "%s: evict dropped the wrong number", what);
+  CHECK(index.size() == stored.size() - expected);
+  CHECK(index.evict(now) == 0);
+
+  std::vector<float> back(kDim);
+  std::vector<ReidMatch> matches;
+  for (const Stored& s : stored) {
+    const bool kept = s.entry.last_seen >= now - config.retention;
+    const bool found = index.find(s.entry.source, s.entry.track_id, back.data());
+    CHECK_MSG(found == kept, "%s: track %llu found %d, kept %d", what,
+              static_cast<unsigned long long>(s.entry.track_id), found, kept);
+    if (!kept || !found)
+      continue;
+    CHECK_MSG(dot(back, s.unit) > 0.99f, "%s: track %llu has another row after eviction", what,
+              static_cast<unsigned long long>(s.entry.track_id));
+    ReidFilter filter;
+    filter.source = s.entry.source;
+    if (index.search(s.unit.data(), filter, 1, &matches) != 1) {
+      CHECK_MSG(false, "%s: track %llu not found by its own vector", what,
+                static_cast<unsigned long long>(s.entry.track_id));
+      continue;
+    }
+    CHECK_MSG(matches[0].similarity > 0.98f && matches[0].entry.last_seen >= now - 1000,
+              "%s: track %llu searched as itself got %llu (%f)", what,
+              static_cast<unsigned long long>(s.entry.track_id),
+              static_cast<unsigned long long>(matches[0].entry.track_id), matches[0].similarity);
+  }
+}
+
+// A track indexed twice reads back as its newest entry.
+void test_find_newest() {
+  EmbeddingIndex index;
+  CHECK(index.configure(make_config(false, SimdLevel::kScalar)));
+  std::vector<float> a(kDim, 0.0f), b(kDim, 0.0f), back(kDim);
+  a[0] = 1.0f;
+  b[1] = 2.0f;
+  ReidEntry entry;
+  entry.source = 3;
+  entry.track_id = 9;
+  CHECK(index.add(entry, a.data()));
+  CHECK(index.add(entry, b.data()));
+  CHECK(index.find(3, 9, back.data()) && back[1] == 1.0f && back[0] == 0.0f);
+  CHECK(!index.find(2, 9, back.data()));
+  std::vector<float> zero(kDim, 0.0f);
+  CHECK(!index.add(entry, zero.data()));
+}
+
+}  // namespace
+}  // namespace nvgst
+
+int main() {
+  for (nvgst::SimdLevel level :
+       {nvgst::SimdLevel::kScalar, nvgst::SimdLevel::kSse41, nvgst::SimdLevel::kAvx2}) {
+    if (nvgst::clamp_simd_level(level) != level)
+      continue;
+    for (bool quantize : {false, true}) {
+      nvgst::test_exact(quantize, level);
+      nvgst::test_trained(quantize, level);
+      nvgst::test_evict(quantize, level);
+    }
+    nvgst::test_quantized_scores(level);
+  }
+  nvgst::test_find_newest();
+  return nvgst::test::check_result("reid_test");
+}
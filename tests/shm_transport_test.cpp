@@ -0,0 +1,363 @@
+// ShmProducer and ShmConsumer across a fork. The consumer runs in a child
+// process and does what the parent asks over a socketpair, so the segment
+// fd really crosses processes through SCM_RIGHTS and the slot state words
+// are shared memory. Covered: the handshake and caps, frames read in place,
+// a slot kept until every claim is released, drop-newest, drop-oldest
+// taking back the oldest unclaimed frame (whose announcement the consumer
+// then skips) and waiting like block when every slot is claimed, flushing,
+// EOS, and a consumer that exits while holding slots.
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "core/shm_transport.h"
+#include "tests/check.h"
+
+namespace nvgst {
+namespace {
+
+constexpr uint32_t kSlots = 4;
+constexpr size_t kSlotSize = 4096;
+constexpr uint64_t kDataOffset = 64;
+constexpr uint64_t kFrameSize = 1000;
+constexpr char kCaps[] = "video/x-raw,format=NV12,width=64,height=32";
+
+uint8_t pattern(uint64_t pts, uint64_t i) {
+  return static_cast<uint8_t>(pts * 13 + i * 7);
+}
+
+// ---- the child ----
+
+enum Op : uint32_t {
+  kConnect,
+  // Blocks in next() and reports what it returned.
+  kNext,
+  kRelease,
+  // Exits without releasing what it holds.
+  kExit,
+};
+
+struct Command {
+  uint32_t op;
+  uint32_t slot;
+  char path[108];
+};
+
+struct Reply {
+  int32_t event;
+  uint32_t slot;
+  uint32_t seq;
+  uint64_t pts;
+  uint32_t flags;
+  // The frame holds what the parent wrote for its pts.
+  int32_t intact;
+  uint64_t skipped;
+  char caps[64];
+};
+
+[[noreturn]] void run_consumer(int control) {
+  ShmConsumer consumer;
+  Command command;
+  while (recv(control, &command, sizeof(command), 0) == sizeof(command)) {
+    Reply reply = {};
+    switch (command.op) {
+      case kConnect:
+        reply.intact = consumer.connect(command.path);
+        break;
+      case kNext: {
+        ShmFrameInfo frame = {};
+        std::string caps;
+        reply.event = static_cast<int32_t>(consumer.next(&frame, &caps));
+        reply.slot = frame.slot;
+        reply.seq = frame.seq;
+        reply.pts = frame.pts;
+        reply.flags = frame.flags;
+        std::snprintf(reply.caps, sizeof(reply.caps), "%s", caps.c_str());
+        if (reply.event == static_cast<int32_t>(ShmConsumer::Event::kFrame)) {
+          const uint8_t* data = consumer.slot_data(frame.slot) + frame.data_offset;
+          reply.intact = frame.size == kFrameSize;
+          for (uint64_t i = 0; i < frame.size; i++)
+            reply.intact &= data[i] == pattern(frame.pts, i);
+        }
+        break;
+      }
+      case kRelease:
+        consumer.release(command.slot);
+        break;
+      case kExit:
+        _exit(0);
+    }
+    reply.skipped = consumer.skipped();
+    if (send(control, &reply, sizeof(reply), MSG_NOSIGNAL) != sizeof(reply))
+      break;
+  }
+  _exit(1);
+}
+
+// ---- the parent ----
+
+std::mutex g_lock;
+std::set<uintptr_t> g_released;
+
+void release_token(void* token) {
+  std::lock_guard<std::mutex> guard(g_lock);
+  g_released.insert(reinterpret_cast<uintptr_t>(token));
+}
+
+bool released(uintptr_t token) {
+  std::lock_guard<std::mutex> guard(g_lock);
+  return g_released.count(token) != 0;
+}
+
+// Releases travel through the producer's thread; give them time.
+template <typename Pred>
+bool eventually(Pred pred) {
+  for (int i = 0; i < 2000; i++) {
+    if (pred())
+      return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return pred();
+}
+
+class Session {
+ public:
+  explicit Session(int control) : control_(control) {}
+
+  // False when the child does not answer in time.
+  bool ask(uint32_t op, uint32_t slot, Reply* reply, const std::string& path = std::string()) {
+    Command command = {};
+    command.op = op;
+    command.slot = slot;
+    std::snprintf(command.path, sizeof(command.path), "%s", path.c_str());
+    if (send(control_, &command, sizeof(command), MSG_NOSIGNAL) != sizeof(command))
+      return false;
+    pollfd fd = {control_, POLLIN, 0};
+    if (poll(&fd, 1, 5000) != 1)
+      return false;
+    return recv(control_, reply, sizeof(*reply), 0) == sizeof(*reply);
+  }
+
+  // The next event must be a frame of pts, read back intact.
+  Reply expect_frame(uint64_t pts) {
+    Reply reply = {};
+    const bool answered = ask(kNext, 0, &reply);
+    CHECK_MSG(answered && reply.event == static_cast<int32_t>(ShmConsumer::Event::kFrame) &&
+                  reply.pts == pts && reply.intact,
+              "expected frame %llu, got event %d pts %llu intact %d",
+              static_cast<unsigned long long>(pts), reply.event,
+              static_cast<unsigned long long>(reply.pts), reply.intact);
+    return reply;
+  }
+
+  void release(uint32_t slot) {
+    Reply reply;
+    CHECK(ask(kRelease, slot, &reply));
+  }
+
+ private:
+  int control_;
+};
+
+// Writes a frame of pts into a free slot and publishes it with pts as the
+// token. Returns the slot.
+int send_frame(ShmProducer& producer, uint64_t pts, ShmBackpressure mode) {
+  const int slot = producer.acquire(mode);
+  if (slot < 0)
+    return slot;
+  uint8_t* data = producer.slot_data(static_cast<uint32_t>(slot)) + kDataOffset;
+  for (uint64_t i = 0; i < kFrameSize; i++)
+    data[i] = pattern(pts, i);
+  ShmFrameInfo info = {};
+  info.slot = static_cast<uint32_t>(slot);
+  info.data_offset = kDataOffset;
+  info.size = kFrameSize;
+  info.pts = pts;
+  info.dts = UINT64_MAX;
+  info.duration = 33000000;
+  info.flags = static_cast<uint32_t>(pts);
+  CHECK(producer.publish(info, reinterpret_cast<void*>(static_cast<uintptr_t>(pts))));
+  producer.release(static_cast<uint32_t>(slot));
+  return slot;
+}
+
+// acquire() on another thread, to see whether it waits.
+class Acquire {
+ public:
+  Acquire(ShmProducer& producer, ShmBackpressure mode)
+      : thread_([this, &producer, mode] {
+          slot_ = producer.acquire(mode);
+          done_ = true;
+        }) {}
+
+  bool done() const { return done_; }
+  int join() {
+    thread_.join();
+    return slot_;
+  }
+
+ private:
+  std::atomic<bool> done_{false};
+  int slot_ = -1;
+  std::thread thread_;
+};
+
+void test_transport(int control, const std::string& path) {
+  Session child(control);
+  ShmProducer producer(release_token);
+  CHECK(producer.start(path));
+  CHECK(producer.configure(kSlots, kSlotSize));
+  CHECK(producer.configure(kSlots, kSlotSize / 2) && !producer.configure(kSlots, kSlotSize * 2));
+  producer.set_caps(kCaps);
+
+  // The hello carrying the segment fd is taken in by next(); the caps come
+  // right after it.
+  Reply reply = {};
+  CHECK(child.ask(kConnect, 0, &reply, path) && reply.intact);
+  CHECK(eventually([&] { return producer.consumers() == 1; }));
+  CHECK(child.ask(kNext, 0, &reply) &&
+        reply.event == static_cast<int32_t>(ShmConsumer::Event::kCaps) &&
+        std::strcmp(reply.caps, kCaps) == 0);
+
+  // Claimed frames hold their slot, and token, until released; a slot
+  // in flight cannot be published again.
+  int slots[kSlots];
+  for (uint64_t pts = 1; pts <= 3; pts++)
+    slots[pts - 1] = send_frame(producer, pts, ShmBackpressure::kDropNewest);
+  uint32_t last_seq = 0;
+  for (uint64_t pts = 1; pts <= 3; pts++) {
+    reply = child.expect_frame(pts);
+    CHECK(reply.slot == static_cast<uint32_t>(slots[pts - 1]) && reply.flags == pts);
+    CHECK(reply.seq > last_seq);
+    last_seq = reply.seq;
+  }
+  ShmFrameInfo again = {};
+  again.slot = static_cast<uint32_t>(slots[0]);
+  again.size = kFrameSize;
+  CHECK(!producer.publish(again, reinterpret_cast<void*>(uintptr_t{99})));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  CHECK(!released(1) && !released(2) && !released(3) && !released(99));
+  child.release(static_cast<uint32_t>(slots[1]));
+  CHECK(eventually([] { return released(2); }));
+  CHECK(!released(1) && !released(3));
+  child.release(static_cast<uint32_t>(slots[0]));
+  child.release(static_cast<uint32_t>(slots[2]));
+  CHECK(eventually([] { return released(1) && released(3); }));
+
+  // Every slot claimed: drop-newest gives up at once, drop-oldest has
+  // nothing to take back and waits like block.
+  for (uint64_t pts = 10; pts < 10 + kSlots; pts++)
+    slots[pts - 10] = send_frame(producer, pts, ShmBackpressure::kDropNewest);
+  for (uint64_t pts = 10; pts < 10 + kSlots; pts++)
+    child.expect_frame(pts);
+  CHECK(producer.acquire(ShmBackpressure::kDropNewest) == -1);
+  {
+    Acquire waiting(producer, ShmBackpressure::kDropOldest);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!waiting.done());
+    child.release(static_cast<uint32_t>(slots[2]));
+    CHECK(waiting.join() == slots[2]);
+  }
+  // The slot just taken stays held, so block waits too.
+  {
+    Acquire waiting(producer, ShmBackpressure::kBlock);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!waiting.done());
+    child.release(static_cast<uint32_t>(slots[0]));
+    CHECK(waiting.join() == slots[0]);
+  }
+  producer.release(static_cast<uint32_t>(slots[0]));
+  producer.release(static_cast<uint32_t>(slots[2]));
+  child.release(static_cast<uint32_t>(slots[1]));
+  child.release(static_cast<uint32_t>(slots[3]));
+  CHECK(eventually([] { return released(10) && released(11) && released(12) && released(13); }));
+  CHECK(producer.dropped() == 0);
+
+  // Frames announced but not claimed yet: drop-oldest takes back the
+  // oldest one, and the consumer skips its announcement.
+  for (uint64_t pts = 20; pts < 20 + kSlots; pts++)
+    slots[pts - 20] = send_frame(producer, pts, ShmBackpressure::kDropNewest);
+  CHECK(producer.acquire(ShmBackpressure::kDropNewest) == -1);
+  CHECK(send_frame(producer, 20 + kSlots, ShmBackpressure::kDropOldest) == slots[0]);
+  CHECK(producer.dropped() == 1 && released(20));
+  for (uint64_t pts = 21; pts <= 20 + kSlots; pts++)
+    reply = child.expect_frame(pts);
+  CHECK(reply.slot == static_cast<uint32_t>(slots[0]));
+  CHECK_MSG(reply.skipped == 1, "%llu frames skipped",
+            static_cast<unsigned long long>(reply.skipped));
+
+  producer.set_flushing(true);
+  {
+    Acquire waiting(producer, ShmBackpressure::kBlock);
+    CHECK(waiting.join() == -1);
+  }
+  producer.set_flushing(false);
+
+  producer.send_eos();
+  CHECK(child.ask(kNext, 0, &reply) &&
+        reply.event == static_cast<int32_t>(ShmConsumer::Event::kEos));
+
+  // A consumer that goes away gives back every slot it held.
+  CHECK(!released(21) && !released(24));
+  child.ask(kExit, 0, &reply);
+  CHECK(eventually([&] { return producer.consumers() == 0; }));
+  CHECK(eventually([] {
+    for (uintptr_t pts = 21; pts <= 20 + kSlots; pts++)
+      if (!released(pts))
+        return false;
+    return true;
+  }));
+
+  // Without consumers a frame is released as soon as it is published.
+  const int slot = send_frame(producer, 30, ShmBackpressure::kBlock);
+  CHECK(slot >= 0 && released(30));
+  producer.stop();
+}
+
+}  // namespace
+}  // namespace nvgst
+
+int main() {
+  int control[2];
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, control) != 0) {
+    std::perror("socketpair");
+    return 1;
+  }
+  const char* dir = std::getenv("TMPDIR");
+  const std::string path = std::string(dir && *dir ? dir : "/tmp") + "/nvgst-shm-test-" +
+                           std::to_string(getpid()) + ".sock";
+
+  // Forked before the producer starts its thread.
+  const pid_t child = fork();
+  if (child < 0) {
+    std::perror("fork");
+    return 1;
+  }
+  if (child == 0) {
+    close(control[0]);
+    nvgst::run_consumer(control[1]);
+  }
+  close(control[1]);
+  nvgst::test_transport(control[0], path);
+  close(control[0]);
+
+  // A child stuck in next() after a failure would never exit.
+  if (nvgst::test::failures() != 0)
+    kill(child, SIGKILL);
+  int status = 0;
+  CHECK(waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  return nvgst::test::check_result("shm_transport_test");
+}
@@ -0,0 +1,304 @@
+// TrackSnapshots, driven frame by frame with known boxes. A kept crop is
+// only replaced by one scoring kRecopyGain better, tracks are handed out
+// linger frames after they were last seen or once max_age frames old and
+// never twice, and images are recycled: those given back are handed to new
+// tracks, a track that never got a crop gives its image back when it ends,
+// and one already handed out leaves nothing behind. Every crop is compared
+// with the frame it was taken from.
+#include <cstdint>
+#include <cstdio>
+#include <set>
+#include <vector>
+
+#include "core/aligned_buffer.h"
+#include "core/snapshot.h"
+#include "tests/check.h"
+
+namespace nvgst {
+namespace {
+
+// Mirrors kRecopyGain in snapshot.cpp.
+constexpr float kGain = 1.1f;
+
+constexpr int kWidth = 320;
+constexpr int kHeight = 240;
+
+uint8_t pattern(int x, int y, int c, uint64_t frame) {
+  return static_cast<uint8_t>(x * 3 + y * 5 + c + frame * 17);
+}
+
+// An RGBA frame whose pixels tell which frame they belong to.
+class Frames {
+ public:
+  Frames()
+      : layout_(make_frame_layout(PixelFormat::kRGBA, kWidth, kHeight)), pixels_(layout_.size) {}
+
+  FrameView draw(uint64_t frame) {
+    FrameView view = make_frame_view(layout_, pixels_.data());
+    for (int y = 0; y < kHeight; y++) {
+      uint8_t* row = view.data[0] + static_cast<size_t>(y) * view.stride[0];
+      for (int x = 0; x < kWidth; x++)
+        for (int c = 0; c < 4; c++)
+          row[4 * x + c] = pattern(x, y, c, frame);
+    }
+    return view;
+  }
+
+ private:
+  FrameLayout layout_;
+  AlignedBuffer pixels_;
+};
+
+DetectedObject make_object(uint64_t track, float x, float y, float size, float confidence,
+                           int32_t class_id = 0) {
+  DetectedObject object = {};
+  object.frame = 0;
+  object.class_id = class_id;
+  object.confidence = confidence;
+  object.x = x;
+  object.y = y;
+  object.width = size;
+  object.height = size;
+  object.track_id = track;
+  return object;
+}
+
+// The crop holds the frame it claims to come from, at the place it claims.
+bool crop_matches(SnapshotCandidate& candidate, uint64_t frame) {
+  const SnapshotRect& rect = candidate.info.rect;
+  const FrameView view = candidate.image.view();
+  if (view.width != rect.x1 - rect.x0 || view.height != rect.y1 - rect.y0)
+    return false;
+  for (int y = 0; y < view.height; y++) {
+    const uint8_t* row = view.data[0] + static_cast<size_t>(y) * view.stride[0];
+    for (int x = 0; x < view.width; x++)
+      for (int c = 0; c < 4; c++)
+        if (row[4 * x + c] != pattern(rect.x0 + x, rect.y0 + y, c, frame))
+          return false;
+  }
+  return true;
+}
+
+class Driver {
+ public:
+  explicit Driver(const TrackSnapshotConfig& config) { snapshots.configure(config); }
+
+  // One frame of source with objects; returns what became ready.
+  std::vector<SnapshotCandidate> offer(const std::vector<DetectedObject>& objects,
+                                       uint32_t source = 0) {
+    frame++;
+    const FrameView view = frames_.draw(frame);
+    snapshots.offer(source, static_cast<int64_t>(frame) * 1000, view, objects.data(),
+                    objects.size(), 0);
+    std::vector<SnapshotCandidate> ready;
+    snapshots.take(&ready);
+    return ready;
+  }
+
+  TrackSnapshots snapshots;
+  uint64_t frame = 0;
+
+ private:
+  Frames frames_;
+};
+
+void test_best_crop() {
+  TrackSnapshotConfig config;
+  config.linger = 3;
+  config.padding = 0.0f;
+  Driver driver(config);
+
+  // Scores are confidence * sqrt(area), 20 for both to start with. Track
+  // 1 then improves by less than the gain twice, and keeps its first
+  // crop; track 2 improves by more, then by less again, and keeps its
+  // second.
+  const float base = 0.5f * 40.0f;
+  CHECK(driver.offer({make_object(1, 50, 50, 40, 0.5f), make_object(2, 200, 50, 40, 0.5f)})
+            .empty());
+  CHECK(driver.offer({make_object(1, 52, 50, 40, 0.5f * 1.05f),
+                      make_object(2, 202, 56, 40, 0.5f * kGain * 1.05f)})
+            .empty());
+  CHECK(driver.offer({make_object(1, 60, 58, 40, 0.5f * 1.08f),
+                      make_object(2, 210, 60, 40, 0.5f * kGain * 1.05f * 1.05f)})
+            .empty());
+  CHECK(driver.offer({make_object(1, 70, 60, 20, 0.9f), make_object(2, 220, 60, 20, 0.9f)})
+            .empty());
+  CHECK(TrackSnapshots::score(make_object(1, 70, 60, 20, 0.9f), kWidth, kHeight) < base);
+  CHECK(driver.snapshots.tracks() == 2);
+
+  // Last seen on frame 4, so ready on frame 8 and not before.
+  for (int i = 0; i < 3; i++)
+    CHECK(driver.offer({}).empty());
+  std::vector<SnapshotCandidate> ready = driver.offer({});
+  CHECK(ready.size() == 2 && driver.snapshots.tracks() == 0);
+  for (SnapshotCandidate& best : ready) {
+    const bool first = best.info.track_id == 1;
+    const int64_t frame = first ? 1 : 2;
+    CHECK_MSG(best.info.pts == frame * 1000, "track %llu kept pts %lld, expected frame %lld",
+              static_cast<unsigned long long>(best.info.track_id),
+              static_cast<long long>(best.info.pts), static_cast<long long>(frame));
+    CHECK(best.info.source == 0 && best.info.class_id == 0);
+    CHECK(first ? best.info.rect.x0 == 50 && best.info.rect.y0 == 50 && best.info.rect.x1 == 90 &&
+                      best.info.rect.y1 == 90
+                : best.info.rect.x0 == 202 && best.info.rect.y0 == 56 &&
+                      best.info.rect.x1 == 242 && best.info.rect.y1 == 96);
+    CHECK(crop_matches(best, static_cast<uint64_t>(frame)));
+  }
+
+  // A box cut by the frame edge scores half.
+  const float inside = TrackSnapshots::score(make_object(1, 10, 10, 40, 0.5f), kWidth, kHeight);
+  const float cut = TrackSnapshots::score(make_object(1, 0, 10, 40, 0.5f), kWidth, kHeight);
+  CHECK(inside == 20.0f && cut == 10.0f);
+}
+
+void test_linger_and_max_age() {
+  TrackSnapshotConfig config;
+  config.linger = 2;
+  config.max_age = 5;
+  config.padding = 0.1f;
+  Driver driver(config);
+
+  // Track 1 stays in view for 20 frames and is handed out once, on its
+  // fifth; track 2 arrives on frame 3 and leaves on frame 6.
+  int handed_one = 0;
+  int handed_two = 0;
+  for (int f = 1; f <= 24; f++) {
+    std::vector<DetectedObject> objects;
+    if (f <= 20)
+      objects.push_back(make_object(1, 40.0f + f, 40, 30, 0.3f + 0.03f * f));
+    if (f >= 3 && f <= 6)
+      objects.push_back(make_object(2, 200, 100, 30, 0.8f));
+    std::vector<SnapshotCandidate> ready = driver.offer(objects);
+    for (SnapshotCandidate& candidate : ready) {
+      if (candidate.info.track_id == 1) {
+        handed_one++;
+        CHECK_MSG(f == 5, "track 1 handed out on frame %d", f);
+        CHECK(crop_matches(candidate, 5));
+      } else if (candidate.info.track_id == 2) {
+        handed_two++;
+        // Frames 3 to 6 make it 4 frames old: it ends before max_age,
+        // linger frames after it was last seen.
+        CHECK_MSG(f == 9, "track 2 handed out on frame %d", f);
+        CHECK(crop_matches(candidate, 3));
+      }
+    }
+    // Handed out, track 1 is still followed until it ends.
+    if (f == 22)
+      CHECK(driver.snapshots.tracks() == 1);
+  }
+  CHECK(handed_one == 1 && handed_two == 1);
+  CHECK(driver.snapshots.tracks() == 0);
+
+  // Sources count their own frames: track 3 on source 1 lingers while
+  // source 0 moves on.
+  driver.offer({make_object(3, 100, 100, 30, 0.9f)}, 1);
+  for (int i = 0; i < 10; i++)
+    CHECK(driver.offer({}, 0).empty());
+  CHECK(driver.snapshots.tracks() == 1);
+  CHECK(driver.offer({}, 1).empty());
+  CHECK(driver.offer({}, 1).empty());
+  std::vector<SnapshotCandidate> ready = driver.offer({}, 1);
+  CHECK(ready.size() == 1 && ready[0].info.source == 1);
+
+  // flush() hands out what is kept, reset() drops it.
+  driver.offer({make_object(4, 10, 10, 30, 0.9f), make_object(5, 100, 10, 30, 0.9f)});
+  driver.snapshots.flush();
+  ready.clear();
+  driver.snapshots.take(&ready);
+  CHECK(ready.size() == 2 && driver.snapshots.tracks() == 0);
+  driver.offer({make_object(6, 10, 10, 30, 0.9f)});
+  driver.snapshots.reset();
+  ready.clear();
+  driver.snapshots.take(&ready);
+  CHECK(ready.empty() && driver.snapshots.tracks() == 0);
+}
+
+void test_filters() {
+  TrackSnapshotConfig config;
+  config.linger = 0;
+  config.min_size = 16;
+  config.padding = 0.0f;
+  config.classes = {2};
+  Driver driver(config);
+
+  // Untracked, other classes and crops under min_size are not kept.
+  DetectedObject untracked = make_object(kNoTrack, 10, 10, 40, 0.9f, 2);
+  driver.offer({untracked, make_object(1, 60, 10, 40, 0.9f, 1),
+                make_object(2, 120, 10, 10, 0.9f, 2), make_object(3, 180, 10, 40, 0.9f, 2)});
+  CHECK(driver.snapshots.tracks() == 2);
+  std::vector<SnapshotCandidate> ready = driver.offer({});
+  CHECK(ready.size() == 1 && ready[0].info.track_id == 3 && ready[0].info.class_id == 2);
+
+  // Objects of other frames of the batch are not this frame's.
+  DetectedObject other = make_object(4, 10, 10, 40, 0.9f, 2);
+  other.frame = 1;
+  driver.offer({other});
+  CHECK(driver.snapshots.tracks() == 0);
+}
+
+void test_recycling() {
+  TrackSnapshotConfig config;
+  config.linger = 1;
+  config.max_age = 3;
+  config.padding = 0.0f;
+  Driver driver(config);
+
+  // Four tracks make four images; once given back, the next four tracks
+  // take the same buffers, as crops no larger need no allocation.
+  std::vector<SnapshotCandidate> ready;
+  for (int f = 0; f < 3; f++) {
+    std::vector<SnapshotCandidate> more = driver.offer(
+        {make_object(1, 10, 10, 40, 0.9f), make_object(2, 60, 10, 40, 0.9f),
+         make_object(3, 110, 10, 40, 0.9f), make_object(4, 160, 10, 40, 0.9f)});
+    for (SnapshotCandidate& candidate : more)
+      ready.push_back(std::move(candidate));
+  }
+  CHECK(ready.size() == 4);
+  std::set<const uint8_t*> buffers;
+  for (SnapshotCandidate& candidate : ready) {
+    buffers.insert(candidate.image.view().data[0]);
+    driver.snapshots.recycle(std::move(candidate.image));
+  }
+  CHECK(buffers.size() == 4);
+
+  // Tracks 1-4 were handed out by max_age; ending them must not give back
+  // the images they no longer hold, or new tracks would start empty.
+  CHECK(driver.offer({}).empty());
+  CHECK(driver.offer({}).empty());
+  CHECK(driver.offer({}).empty());
+  CHECK(driver.snapshots.tracks() == 0);
+
+  // Track 5 never gets a crop: it is too small. Its image goes back when
+  // it ends, ahead of the others.
+  driver.offer({make_object(5, 10, 10, 8, 0.9f)});
+  CHECK(driver.offer({}).empty());
+  CHECK(driver.offer({}).empty());
+  CHECK(driver.snapshots.tracks() == 0);
+
+  ready.clear();
+  for (int f = 0; f < 3; f++) {
+    std::vector<SnapshotCandidate> more = driver.offer(
+        {make_object(6, 10, 100, 32, 0.9f), make_object(7, 60, 100, 40, 0.9f),
+         make_object(8, 110, 100, 36, 0.9f), make_object(9, 160, 100, 24, 0.9f)});
+    for (SnapshotCandidate& candidate : more)
+      ready.push_back(std::move(candidate));
+  }
+  CHECK(ready.size() == 4);
+  for (SnapshotCandidate& candidate : ready) {
+    CHECK_MSG(buffers.count(candidate.image.view().data[0]) == 1,
+              "track %llu got a new image instead of a recycled one",
+              static_cast<unsigned long long>(candidate.info.track_id));
+    CHECK(crop_matches(candidate, driver.frame - 2));
+  }
+}
+
+}  // namespace
+}  // namespace nvgst
+
+int main() {
+  nvgst::test_best_crop();
+  nvgst::test_linger_and_max_age();
+  nvgst::test_filters();
+  nvgst::test_recycling();
+  return nvgst::test::check_result("snapshot_test");
+}
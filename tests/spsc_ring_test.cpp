@@ -0,0 +1,121 @@
+// SpscRing: capacity rounding, full and empty edges and wrap-around on one
+// thread, then a producer and a consumer thread passing a numbered
+// sequence through a small ring, which must arrive whole and in order.
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "core/spsc_ring.h"
+#include "tests/check.h"
+
+namespace nvgst {
+namespace {
+
+struct Item {
+  uint64_t seq;
+  // ~seq, so a torn slot shows up.
+  uint64_t check;
+};
+
+void test_single_thread() {
+  SpscRing<int> ring;
+  CHECK(ring.init(5));
+  CHECK(ring.capacity() == 8);
+  CHECK(ring.empty());
+
+  int value = -1;
+  CHECK(!ring.try_pop(&value));
+  // Several laps, so the indices wrap the slot array.
+  int next_push = 0, next_pop = 0;
+  for (int lap = 0; lap < 5; lap++) {
+    while (ring.try_push(next_push))
+      next_push++;
+    CHECK(ring.size() == 8);
+    for (int i = 0; i < 3; i++) {
+      CHECK(ring.try_pop(&value));
+      CHECK_MSG(value == next_pop, "lap %d: popped %d, expected %d", lap, value, next_pop);
+      next_pop++;
+    }
+    CHECK(ring.try_push(next_push++));
+    int out[16];
+    const size_t n = ring.pop_bulk(out, 16);
+    CHECK(n == 6);
+    for (size_t i = 0; i < n; i++) {
+      CHECK_MSG(out[i] == next_pop, "lap %d: bulk popped %d, expected %d", lap, out[i],
+                next_pop);
+      next_pop++;
+    }
+    CHECK(ring.empty());
+    CHECK(ring.pop_bulk(out, 16) == 0);
+  }
+
+  // pop_bulk stops at max.
+  for (int i = 0; i < 8; i++)
+    CHECK(ring.try_push(i));
+  int out[3];
+  CHECK(ring.pop_bulk(out, 3) == 3);
+  CHECK(out[0] == 0 && out[2] == 2);
+  CHECK(ring.size() == 5);
+
+  // init() on a used ring starts it over.
+  CHECK(ring.init(1));
+  CHECK(ring.capacity() == 1);
+  CHECK(ring.try_push(42));
+  CHECK(!ring.try_push(43));
+  CHECK(ring.try_pop(&value) && value == 42);
+}
+
+void test_two_threads() {
+  constexpr uint64_t kItems = 2000000;
+  SpscRing<Item> ring;
+  CHECK(ring.init(64));
+
+  std::thread producer([&ring] {
+    for (uint64_t seq = 0; seq < kItems;) {
+      if (ring.try_push({seq, ~seq}))
+        seq++;
+      else
+        std::this_thread::yield();
+    }
+  });
+
+  uint64_t expected = 0;
+  int errors = 0;
+  Item batch[32];
+  while (expected < kItems) {
+    // Alternate between the two ways of consuming.
+    size_t n;
+    if (expected % 3 == 0) {
+      n = ring.try_pop(&batch[0]) ? 1 : 0;
+    } else {
+      n = ring.pop_bulk(batch, 1 + expected % 32);
+    }
+    if (n == 0) {
+      std::this_thread::yield();
+      continue;
+    }
+    for (size_t i = 0; i < n; i++) {
+      if (batch[i].seq != expected || batch[i].check != ~expected) {
+        // Report a few, then carry on from what arrived so the producer
+        // is never left waiting on a full ring.
+        if (errors++ < 10)
+          CHECK_MSG(false, "item %llu arrived as %llu", static_cast<unsigned long long>(expected),
+                    static_cast<unsigned long long>(batch[i].seq));
+        expected = batch[i].seq;
+      }
+      expected++;
+    }
+  }
+  producer.join();
+  CHECK(expected == kItems);
+  CHECK(ring.empty());
+}
+
+}  // namespace
+}  // namespace nvgst
+
+int main() {
+  nvgst::test_single_thread();
+  nvgst::test_two_threads();
+  return nvgst::test::check_result("spsc_ring_test");
+}
@@ -0,0 +1,193 @@
+// TrackCache against a std::unordered_map model under random stores,
+// lookups and expiry. The table is kept small and nearly full so probe
+// runs wrap around and backward-shift deletion moves entries across them;
+// every lookup must agree with the model on whether the track is cached
+// and on what it returns.
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "core/track_cache.h"
+#include "tests/check.h"
+
+namespace nvgst {
+namespace {
+
+class Model {
+ public:
+  explicit Model(const TrackCacheConfig& config) : config_(config) {}
+
+  const TrackResult* lookup(const DetectedObject& object, uint64_t now) {
+    const uint32_t source = static_cast<uint32_t>(object.track_id >> 32);
+    if (object.track_id == kNoTrack || source >= kMaxCacheSources)
+      return nullptr;
+    clocks_[source] = now;
+    auto it = entries_.find(object.track_id);
+    if (it == entries_.end())
+      return nullptr;
+    TrackResult& result = it->second;
+    result.seen = now;
+    if (now > result.time && now - result.time > config_.max_age)
+      return nullptr;
+    if (result.confidence < config_.min_confidence)
+      return nullptr;
+    const float area = object.width * object.height;
+    if (area > result.area * config_.max_area_ratio || area * config_.max_area_ratio < result.area)
+      return nullptr;
+    return &result;
+  }
+
+  bool store(const DetectedObject& object, int32_t label, float confidence, uint64_t time) {
+    if (object.track_id == kNoTrack || (object.track_id >> 32) >= kMaxCacheSources)
+      return false;
+    auto it = entries_.find(object.track_id);
+    if (it == entries_.end()) {
+      if (static_cast<int>(entries_.size()) >= config_.capacity)
+        expire();
+      if (static_cast<int>(entries_.size()) >= config_.capacity)
+        return false;
+      it = entries_.emplace(object.track_id, TrackResult()).first;
+      it->second.seen = time;
+    }
+    TrackResult& result = it->second;
+    result.label = label;
+    result.confidence = confidence;
+    result.area = object.width * object.height;
+    result.time = time;
+    if (time > result.seen)
+      result.seen = time;
+    return true;
+  }
+
+  int expire() {
+    int dropped = 0;
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      auto clock = clocks_.find(static_cast<uint32_t>(it->first >> 32));
+      const uint64_t now = clock == clocks_.end() ? 0 : clock->second;
+      if (now > it->second.seen && now - it->second.seen > config_.track_timeout) {
+        it = entries_.erase(it);
+        dropped++;
+      } else {
+        ++it;
+      }
+    }
+    return dropped;
+  }
+
+  int size() const { return static_cast<int>(entries_.size()); }
+
+ private:
+  TrackCacheConfig config_;
+  std::unordered_map<uint64_t, TrackResult> entries_;
+  std::unordered_map<uint32_t, uint64_t> clocks_;
+};
+
+DetectedObject make_object(uint64_t track_id, float width, float height) {
+  DetectedObject object = {};
+  object.track_id = track_id;
+  object.width = width;
+  object.height = height;
+  return object;
+}
+
+void test_against_model() {
+  TrackCacheConfig config;
+  config.max_age = 40;
+  config.min_confidence = 0.5f;
+  config.max_area_ratio = 1.5f;
+  config.track_timeout = 25;
+  config.capacity = 48;
+
+  TrackCache cache;
+  CHECK(cache.configure(config));
+  Model model(config);
+
+  std::mt19937 rng(11);
+  std::uniform_int_distribution<int> op(0, 99);
+  uint64_t clocks[3] = {0, 0, 0};
+  for (int step = 0; step < 200000; step++) {
+    const int source = std::uniform_int_distribution<int>(0, 2)(rng);
+    // Tracks come and go: ids drift upwards so old ones stop being used.
+    const uint64_t base = static_cast<uint64_t>(step / 50);
+    const uint64_t id = static_cast<uint64_t>(source) << 32 |
+                        (base + std::uniform_int_distribution<uint64_t>(0, 40)(rng));
+    const float side = std::uniform_real_distribution<float>(20.0f, 40.0f)(rng);
+    const DetectedObject object = make_object(id, side, side);
+    clocks[source] += std::uniform_int_distribution<int>(0, 2)(rng);
+    const uint64_t now = clocks[source];
+
+    const int kind = op(rng);
+    if (kind < 55) {
+      const TrackResult* got = cache.lookup(object, now);
+      const TrackResult* want = model.lookup(object, now);
+      CHECK_MSG((got == nullptr) == (want == nullptr), "step %d: lookup of %llx disagrees", step,
+                static_cast<unsigned long long>(id));
+      if (got && want) {
+        CHECK_MSG(got->label == want->label && got->confidence == want->confidence &&
+                      got->time == want->time && got->seen == want->seen,
+                  "step %d: lookup of %llx returned another result", step,
+                  static_cast<unsigned long long>(id));
+      }
+    } else if (kind < 95) {
+      const int32_t label = std::uniform_int_distribution<int32_t>(0, 9)(rng);
+      const float confidence = std::uniform_real_distribution<float>(0.0f, 1.0f)(rng);
+      const bool got = cache.store(object, label, confidence, now);
+      const bool want = model.store(object, label, confidence, now);
+      CHECK_MSG(got == want, "step %d: store of %llx returned %d", step,
+                static_cast<unsigned long long>(id), got);
+    } else {
+      const int got = cache.expire();
+      const int want = model.expire();
+      CHECK_MSG(got == want, "step %d: expire dropped %d, model %d", step, got, want);
+    }
+    CHECK_MSG(cache.size() == model.size(), "step %d: size %d, model %d", step, cache.size(),
+              model.size());
+    if (nvgst::test::failures() > 20)
+      return;
+  }
+}
+
+void test_uncacheable() {
+  TrackCache cache;
+  CHECK(cache.configure(TrackCacheConfig()));
+  CHECK(!cache.store(make_object(kNoTrack, 10, 10), 1, 0.9f, 0));
+  CHECK(!cache.store(make_object(static_cast<uint64_t>(kMaxCacheSources) << 32 | 1, 10, 10), 1,
+                     0.9f, 0));
+  CHECK(cache.size() == 0);
+  CHECK(cache.lookup(make_object(kNoTrack, 10, 10), 0) == nullptr);
+}
+
+// Filling up expires the idle tracks of a source; tracks of a source
+// whose clock stood still are kept.
+void test_full() {
+  TrackCacheConfig config;
+  config.capacity = 8;
+  config.track_timeout = 10;
+  TrackCache cache;
+  CHECK(cache.configure(config));
+  for (uint64_t i = 1; i <= 7; i++)
+    CHECK(cache.store(make_object(i, 10, 10), 1, 0.9f, 0));
+  const uint64_t other = uint64_t{1} << 32 | 1;
+  CHECK(cache.store(make_object(other, 10, 10), 1, 0.9f, 0));
+  CHECK(cache.size() == 8);
+  CHECK(!cache.store(make_object(100, 10, 10), 1, 0.9f, 0));
+
+  // Source 0 moves on while only track 1 is seen.
+  CHECK(cache.lookup(make_object(1, 10, 10), 100) != nullptr);
+  CHECK(cache.store(make_object(100, 10, 10), 1, 0.9f, 100));
+  CHECK(cache.size() == 3);
+  CHECK(cache.lookup(make_object(100, 10, 10), 101) != nullptr);
+  CHECK(cache.lookup(make_object(other, 10, 10), 0) != nullptr);
+  CHECK(cache.lookup(make_object(2, 10, 10), 101) == nullptr);
+}
+
+}  // namespace
+}  // namespace nvgst
+
+int main() {
+  nvgst::test_against_model();
+  nvgst::test_uncacheable();
+  nvgst::test_full();
+  return nvgst::test::check_result("track_cache_test");
+}